@@ -631,4 +631,5 @@ struct cmd_element bgp_enhanced_cmds[] = {
 void register_bgp_enhanced_cmds(void)
 {
     printf("Registering BGP enhanced commands...\n");
+    huawei_cli_register_table(bgp_enhanced_cmds, "bgp");
 }
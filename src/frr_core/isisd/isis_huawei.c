@@ -459,4 +459,5 @@ struct cmd_element isis_cmds[] = {
 void register_isis_cmds(void)
 {
     printf("Registering IS-IS commands...\n");
+    huawei_cli_register_table(isis_cmds, "isis");
 }
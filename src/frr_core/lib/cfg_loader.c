@@ -0,0 +1,331 @@
+/*
+ * VRP Configuration File Loader
+ * Copyright (C) 2026 WhiteBox NE Team
+ *
+ * This module provides bulk configuration loading including:
+ * - Read-only mmap of the file, one pass without per-line allocation
+ * - View tracking from indentation ([Huawei-bgp], [Huawei-zone-trust])
+ * - Dispatch of every line to its handler in two-stage mode
+ * - One consolidated FRR delta committed at the end of the file
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "huawei_cli.h"
+#include "cfg_loader.h"
+
+#define CFG_LINE_SIZE       1024
+#define CFG_VIEW_SIZE       128
+#define CFG_VIEW_DEPTH      8
+
+/* View entered by a command, "%s" takes its last argument */
+struct cfg_view_map {
+    const char *keyword;
+    const char *view;
+};
+
+static const struct cfg_view_map cfg_views[] = {
+    { "firewall zone",      "zone-%s" },
+    { "vrrp vrid",          "vrrp-%s" },
+    { "bfd",                "bfd-session-%s" },
+    { "track",              "track-%s" },
+    { "bgp",                "bgp" },
+    { "ospf",               "ospf-%s" },
+    { "area",               "area-%s" },
+    { "isis",               "isis-%s" },
+    { "rip",                "rip-%s" },
+    { "acl",                "acl-%s" },
+    { "aaa",                "aaa" },
+    { "interface",          "%s" },
+    { "vlan",               "vlan%s" },
+    { "security-policy",    "policy-security" },
+    { "rule name",          "rule-%s" },
+    { "ip address-set",     "address-set-%s" },
+    { "ip service-set",     "service-set-%s" },
+    { "traffic classifier", "classifier-%s" },
+    { "traffic behavior",   "behavior-%s" },
+    { "traffic policy",     "trafficpolicy-%s" },
+    { "policy-based-route", "policy-based-route-%s" },
+    { NULL, NULL }
+};
+
+/* Open view */
+struct cfg_view {
+    int indent;
+    char name[CFG_VIEW_SIZE];
+};
+
+static double cfg_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * Name of the view a line enters, relative to its parent view.
+ * Lines not listed in cfg_views use their words joined by '-'.
+ */
+static void cfg_view_name(const char *line, const char *parent, char *name, size_t size)
+{
+    char own[CFG_VIEW_SIZE];
+    const char *arg = strrchr(line, ' ');
+    arg = arg ? arg + 1 : "";
+
+    own[0] = '\0';
+    for (int i = 0; cfg_views[i].keyword; i++) {
+        size_t len = strlen(cfg_views[i].keyword);
+        if (strncmp(line, cfg_views[i].keyword, len) == 0 &&
+            (line[len] == ' ' || line[len] == '\0')) {
+            snprintf(own, sizeof(own), cfg_views[i].view, arg);
+            break;
+        }
+    }
+
+    if (own[0] == '\0') {
+        snprintf(own, sizeof(own), "%.*s", (int)sizeof(own) - 1, line);
+        for (char *p = own; *p; p++) {
+            if (*p == ' ') {
+                *p = '-';
+            }
+        }
+    }
+
+    if (parent) {
+        snprintf(name, size, "%s-%s", parent, own);
+    } else {
+        snprintf(name, size, "%s", own);
+    }
+}
+
+static void cfg_record_error(struct cfg_load_stats *stats, uint32_t line_no)
+{
+    if (stats->errors < CFG_LOAD_MAX_ERRORS) {
+        stats->error_lines[stats->errors] = line_no;
+    }
+    stats->errors++;
+}
+
+/*
+ * Dispatch every line of the mapped file. A line followed by lines
+ * indented deeper opens a view; '#' and dedent close views.
+ */
+static void cfg_dispatch(const char *data, size_t size, struct cfg_load_stats *stats)
+{
+    struct cfg_view views[CFG_VIEW_DEPTH];
+    int depth = 0;
+    char line[CFG_LINE_SIZE];
+    char prev[CFG_LINE_SIZE];
+    int prev_indent = -1;
+    const char *p = data;
+    const char *end = data + size;
+    uint32_t line_no = 0;
+
+    while (p < end) {
+        const char *eol = memchr(p, '\n', (size_t)(end - p));
+        if (!eol) {
+            eol = end;
+        }
+        const char *start = p;
+        p = eol + 1;
+        line_no++;
+        stats->lines++;
+
+        int indent = 0;
+        while (start < eol && (*start == ' ' || *start == '\t')) {
+            start++;
+            indent++;
+        }
+        while (eol > start && (eol[-1] == '\r' || eol[-1] == ' ' || eol[-1] == '\t')) {
+            eol--;
+        }
+
+        size_t len = (size_t)(eol - start);
+        if (len == 0 || *start == '!') {
+            continue;
+        }
+
+        /* "#" separates top-level blocks, an indented "#" closes nested views */
+        if (*start == '#' && len == 1) {
+            while (depth > 0 && views[depth - 1].indent >= indent) {
+                depth--;
+            }
+            prev_indent = -1;
+            continue;
+        }
+
+        if (len >= CFG_LINE_SIZE) {
+            cfg_record_error(stats, line_no);
+            continue;
+        }
+        memcpy(line, start, len);
+        line[len] = '\0';
+
+        if (indent == 0 && strcmp(line, "return") == 0) {
+            break;
+        }
+
+        /* Deeper indent: the previous line opened a view */
+        if (prev_indent >= 0 && indent > prev_indent && depth < CFG_VIEW_DEPTH) {
+            struct cfg_view *view = &views[depth];
+            cfg_view_name(prev, depth ? views[depth - 1].name : NULL,
+                          view->name, sizeof(view->name));
+            view->indent = prev_indent;
+            depth++;
+            stats->views++;
+        }
+        while (depth > 0 && views[depth - 1].indent >= indent) {
+            depth--;
+        }
+
+        const char *view = depth ? views[depth - 1].name : "system";
+        stats->commands++;
+        if (huawei_cli_execute(line, view) != 0) {
+            cfg_record_error(stats, line_no);
+        }
+
+        memcpy(prev, line, len + 1);
+        prev_indent = indent;
+    }
+}
+
+/*
+ * Load a VRP configuration file.
+ * Lines join the candidate configuration; unless the caller already
+ * works in two-stage mode, the candidate is committed as one delta.
+ */
+int cfg_load_file(const char *path, unsigned int flags, struct cfg_load_stats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    void *data = NULL;
+    if (st.st_size > 0) {
+        data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            close(fd);
+            return -1;
+        }
+        madvise(data, (size_t)st.st_size, MADV_SEQUENTIAL);
+    }
+    close(fd);
+
+    bool was_two_stage = cli_commit_two_stage();
+    cli_commit_set_two_stage(true);
+
+    int saved_stdout = -1;
+    if (flags & CFG_LOAD_QUIET) {
+        fflush(stdout);
+        saved_stdout = dup(STDOUT_FILENO);
+        int null_fd = open("/dev/null", O_WRONLY);
+        if (saved_stdout >= 0 && null_fd >= 0) {
+            dup2(null_fd, STDOUT_FILENO);
+        }
+        if (null_fd >= 0) {
+            close(null_fd);
+        }
+    }
+
+    double start = cfg_now();
+    if (data) {
+        cfg_dispatch(data, (size_t)st.st_size, stats);
+        munmap(data, (size_t)st.st_size);
+    }
+
+    if (saved_stdout >= 0) {
+        fflush(stdout);
+        dup2(saved_stdout, STDOUT_FILENO);
+        close(saved_stdout);
+    }
+
+    stats->delta_lines = cli_commit_candidate_count();
+
+    int ret = 0;
+    if (!was_two_stage) {
+        if (!(flags & CFG_LOAD_DRY_RUN)) {
+            ret = cli_commit(stats->commit_error, sizeof(stats->commit_error));
+        }
+        cli_commit_clear();
+        cli_commit_set_two_stage(false);
+    }
+    stats->elapsed = cfg_now() - start;
+
+    return ret;
+}
+
+/*
+ * Load configuration file
+ * Command: load configuration file <path> [dry-run]
+ */
+static int cmd_load_configuration(struct cmd_element *cmd, struct cmd_args *args)
+{
+    if (args->argc < 3) {
+        printf("Error: File name required\n");
+        printf("Usage: load configuration file <path> [dry-run]\n");
+        return -1;
+    }
+
+    unsigned int flags = CFG_LOAD_QUIET;
+    if (args->argc > 3 && strcmp(args->argv[3], "dry-run") == 0) {
+        flags |= CFG_LOAD_DRY_RUN;
+    }
+
+    struct cfg_load_stats stats;
+    int ret = cfg_load_file(args->argv[2], flags, &stats);
+    if (ret != 0 && stats.lines == 0) {
+        printf("Error: Cannot open %s: %s\n", args->argv[2], strerror(errno));
+        return -1;
+    }
+
+    printf("Loaded %s: %lu lines, %lu commands, %lu views in %.2f s\n", args->argv[2],
+           (unsigned long)stats.lines, (unsigned long)stats.commands,
+           (unsigned long)stats.views, stats.elapsed);
+    printf("FRR delta: %d lines%s\n", stats.delta_lines,
+           (flags & CFG_LOAD_DRY_RUN) ? " (not applied)" : "");
+
+    if (stats.errors > 0) {
+        printf("Warning: %lu lines failed:", (unsigned long)stats.errors);
+        for (uint64_t i = 0; i < stats.errors && i < CFG_LOAD_MAX_ERRORS; i++) {
+            printf(" %u", stats.error_lines[i]);
+        }
+        printf("%s\n", stats.errors > CFG_LOAD_MAX_ERRORS ? " ..." : "");
+    }
+    if (ret != 0) {
+        printf("Error: Commit failed, %s\n", stats.commit_error);
+    }
+
+    return ret;
+}
+
+/* Command registration */
+struct cmd_element cfg_loader_cmds[] = {
+    HUAWEI_CMD_WITH_CATEGORY("load configuration file", cmd_load_configuration, NULL,
+                             "Load a VRP configuration file", CMD_CAT_SYSTEM),
+    { .name = NULL }
+};
+
+/* Register configuration loader commands */
+void register_cfg_loader_cmds(void)
+{
+    printf("Registering configuration loader commands...\n");
+    huawei_cli_register_table(cfg_loader_cmds, NULL);
+}
@@ -0,0 +1,37 @@
+/*
+ * VRP Configuration File Loader
+ * Copyright (C) 2026 WhiteBox NE Team
+ *
+ * Streams a saved VRP-format configuration file through the command
+ * dispatcher in one pass. View context is tracked from indentation,
+ * handler FRR blocks are collected in the candidate configuration and
+ * applied as one consolidated delta at the end of the file.
+ */
+
+#ifndef _CFG_LOADER_H
+#define _CFG_LOADER_H
+
+#include <stdint.h>
+
+/* Load flags */
+#define CFG_LOAD_QUIET          0x01    /* Discard handler output */
+#define CFG_LOAD_DRY_RUN        0x02    /* Build the delta, do not apply it */
+
+#define CFG_LOAD_MAX_ERRORS     8       /* Failed line numbers kept */
+#define CFG_LOAD_ERROR_SIZE     640
+
+/* Load statistics */
+struct cfg_load_stats {
+    uint64_t lines;             /* Lines read, including comments */
+    uint64_t commands;          /* Lines dispatched */
+    uint64_t views;             /* Views entered */
+    uint64_t errors;            /* Lines rejected by the dispatcher or handler */
+    uint32_t error_lines[CFG_LOAD_MAX_ERRORS];
+    int delta_lines;            /* FRR lines in the consolidated delta */
+    double elapsed;             /* Seconds, dispatch and commit */
+    char commit_error[CFG_LOAD_ERROR_SIZE];     /* Outcome of a failed commit */
+};
+
+int cfg_load_file(const char *path, unsigned int flags, struct cfg_load_stats *stats);
+
+#endif /* _CFG_LOADER_H */
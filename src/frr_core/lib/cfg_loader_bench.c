@@ -0,0 +1,160 @@
+/*
+ * Configuration Loader Benchmark for Huawei VRP Style
+ * Copyright (C) 2026 WhiteBox NE Team
+ *
+ * This program measures bulk configuration loading including:
+ * - Generation of a VRP-format file (BGP peers, zones, security rules, ACLs)
+ * - Streaming load through the BGP, ACL and firewall handlers
+ * - Lines/sec, consolidated FRR delta size and peak RSS
+ *
+ * The delta is built but not applied, so no FRR daemons are needed.
+ *
+ * Usage: cfg_loader_bench [-n lines] [-f file]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include "huawei_cli.h"
+#include "cfg_loader.h"
+
+void register_bgp_enhanced_cmds(void);
+void register_acl_cmds(void);
+void register_firewall_cmds(void);
+
+static long peak_rss_kb(void)
+{
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_maxrss;
+}
+
+/*
+ * Write a VRP configuration of about the requested number of lines.
+ * Handler limits: 64 BGP peers, 16 zones, 256 security rules,
+ * 1000 ACLs of 128 rules.
+ */
+static long generate_config(FILE *fp, long target)
+{
+    long lines = 0;
+
+    fprintf(fp, "#\nbgp 65000\n router-id 10.255.0.1\n");
+    lines += 3;
+    for (int i = 0; i < 64; i++) {
+        fprintf(fp, " peer 10.0.%d.%d as-number %d\n", i / 250, i % 250 + 1, 65100 + i);
+        fprintf(fp, " peer 10.0.%d.%d description uplink-%d\n", i / 250, i % 250 + 1, i);
+        lines += 2;
+    }
+    fprintf(fp, "#\n");
+    lines++;
+
+    for (int z = 0; z < 4; z++) {
+        fprintf(fp, "firewall zone zone%d\n set priority %d\n", z, 10 + z * 10);
+        lines += 2;
+        for (int i = 0; i < 4; i++) {
+            fprintf(fp, " add interface GigabitEthernet0/%d/%d\n", z, i);
+            lines++;
+        }
+        fprintf(fp, "#\n");
+        lines++;
+    }
+
+    fprintf(fp, "security-policy\n");
+    lines++;
+    for (int r = 0; r < 200; r++) {
+        fprintf(fp, " rule name r%d\n  source-zone zone%d\n  destination-zone zone%d\n"
+                "  source-address 10.%d.%d.0 24\n  action permit\n",
+                r, r % 4, (r + 1) % 4, r / 256, r % 256);
+        lines += 5;
+    }
+    fprintf(fp, "#\n");
+    lines++;
+
+    for (int acl = 3000; acl < 4000 && lines < target; acl++) {
+        fprintf(fp, "acl %d\n", acl);
+        lines++;
+        for (int r = 0; r < 120 && lines < target - 2; r++) {
+            fprintf(fp, " rule %d %s ip source 10.%d.%d.0 0.0.0.255 destination 172.16.%d.0 0.0.0.255\n",
+                    (r + 1) * 5, r % 7 ? "permit" : "deny", acl % 256, r, r % 256);
+            lines++;
+        }
+        fprintf(fp, "#\n");
+        lines++;
+    }
+
+    fprintf(fp, "return\n");
+    return lines + 1;
+}
+
+int main(int argc, char *argv[])
+{
+    long target = 100000;
+    const char *path = NULL;
+    char tmp_path[] = "/tmp/cfg_loader_bench.XXXXXX";
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:f:")) != -1) {
+        switch (opt) {
+        case 'n':
+            target = atol(optarg);
+            break;
+        case 'f':
+            path = optarg;
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-n lines] [-f file]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (!path) {
+        int fd = mkstemp(tmp_path);
+        FILE *fp = fd >= 0 ? fdopen(fd, "w") : NULL;
+        if (!fp) {
+            fprintf(stderr, "Error: Cannot create %s\n", tmp_path);
+            return 1;
+        }
+        long lines = generate_config(fp, target);
+        fclose(fp);
+        path = tmp_path;
+        printf("Generated %s (%ld lines)\n", path, lines);
+    }
+
+    register_bgp_enhanced_cmds();
+    register_acl_cmds();
+    register_firewall_cmds();
+
+    long rss_before = peak_rss_kb();
+
+    struct cfg_load_stats stats;
+    int ret = cfg_load_file(path, CFG_LOAD_QUIET | CFG_LOAD_DRY_RUN, &stats);
+    if (ret != 0 && stats.lines == 0) {
+        fprintf(stderr, "Error: Cannot load %s\n", path);
+        return 1;
+    }
+
+    long rss_after = peak_rss_kb();
+
+    printf("\nConfiguration load benchmark\n");
+    printf("  Lines:            %lu\n", (unsigned long)stats.lines);
+    printf("  Commands:         %lu\n", (unsigned long)stats.commands);
+    printf("  Views entered:    %lu\n", (unsigned long)stats.views);
+    printf("  Errors:           %lu", (unsigned long)stats.errors);
+    for (uint64_t i = 0; i < stats.errors && i < CFG_LOAD_MAX_ERRORS; i++) {
+        printf("%s%u", i ? " " : " (lines ", stats.error_lines[i]);
+    }
+    printf("%s\n", stats.errors ? ")" : "");
+    printf("  FRR delta lines:  %d\n", stats.delta_lines);
+    printf("  Time:             %.3f s\n", stats.elapsed);
+    printf("  Throughput:       %.0f lines/sec\n", stats.lines / stats.elapsed);
+    printf("  Peak RSS:         %ld KB (%ld KB before load)\n", rss_after, rss_before);
+
+    if (path == tmp_path) {
+        unlink(tmp_path);
+    }
+    return 0;
+}
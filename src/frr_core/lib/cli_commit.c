@@ -0,0 +1,1017 @@
+/*
+ * Two-Stage Configuration Commit for Huawei VRP Style
+ * Copyright (C) 2026 WhiteBox NE Team
+ *
+ * This module provides VRP two-stage configuration including:
+ * - Candidate buffer for configuration blocks from all handlers
+ * - Merging of consecutive blocks sharing a context (e.g. "router bgp"),
+ *   nested contexts such as BGP address families keyed by their full path
+ * - Commit in one pipelined FRR session
+ * - All-or-nothing rollback restoring the pre-commit running-config
+ *   snapshot, verified against a fresh snapshot
+ * - Deferred rebuilds of derived state, run once per commit or load
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "huawei_cli.h"
+
+#define COMMIT_SNAPSHOT_SIZE (4 * 1024 * 1024)
+#define COMMIT_DEFER_MAX 16
+#define COMMIT_CONTEXT_DEPTH 4
+#define COMMIT_PATH_SIZE 512
+
+/* Candidate group: lines applied under one context */
+struct commit_group {
+    char *context;          /* Context path, levels separated by '\n', e.g.
+                               "router bgp 100\naddress-family ipv4 unicast";
+                               NULL for global lines */
+    char **lines;
+    int line_count;
+    int line_capacity;
+};
+
+/* Candidate configuration */
+struct commit_candidate {
+    struct commit_group *groups;
+    int group_count;
+    int group_capacity;
+    int line_total;
+};
+
+/* Running-config snapshot of "context path\nline" keys */
+struct commit_snapshot {
+    char **keys;            /* In running-config order */
+    char **sorted;          /* The same keys, sorted for lookup */
+    int count;
+};
+
+/* FRR commands entering a configuration node */
+static const char *const context_commands[] = {
+    "interface", "router", "route-map", "vrf", "key chain", "line vty", "bfd",
+    "pbr-map", "nexthop-group", "segment-routing", "mpls ldp", "ip vrf",
+    NULL
+};
+
+/* FRR commands entering a node nested in another, outermost first */
+static const struct {
+    const char *command;
+    const char *exit;
+} subcontext_commands[] = {
+    { "address-family", "exit-address-family" },
+    { "vni", "exit-vni" },
+    { NULL, NULL }
+};
+
+static struct commit_candidate candidate;
+static bool two_stage = false;
+static pthread_mutex_t commit_lock = PTHREAD_MUTEX_INITIALIZER;
+static void (*deferred[COMMIT_DEFER_MAX])(void);
+static int deferred_count;
+
+static char *trim(char *s)
+{
+    while (*s == ' ' || *s == '\t') {
+        s++;
+    }
+    char *end = s + strlen(s);
+    while (end > s && (end[-1] == ' ' || end[-1] == '\r' || end[-1] == '\t')) {
+        *--end = '\0';
+    }
+    return s;
+}
+
+static bool is_exit_line(const char *line)
+{
+    return strcmp(line, "exit") == 0 || strcmp(line, "quit") == 0 ||
+           strcmp(line, "end") == 0 || strncmp(line, "exit-", 5) == 0;
+}
+
+/* Whether a line enters a node, making the lines after it its body */
+static bool is_context_line(const char *line)
+{
+    for (int i = 0; context_commands[i]; i++) {
+        size_t len = strlen(context_commands[i]);
+        if (strncmp(line, context_commands[i], len) == 0 &&
+            (line[len] == ' ' || line[len] == '\0')) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Subcontext entered by a line, -1 when it enters none */
+static int subcontext_index(const char *line)
+{
+    for (int i = 0; subcontext_commands[i].command; i++) {
+        size_t len = strlen(subcontext_commands[i].command);
+        if (strncmp(line, subcontext_commands[i].command, len) == 0 &&
+            (line[len] == ' ' || line[len] == '\0')) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* Command leaving the node a context level entered */
+static const char *context_exit(const char *level)
+{
+    int sub = subcontext_index(level);
+    return sub < 0 ? "exit" : subcontext_commands[sub].exit;
+}
+
+/* Length of the first level of a context path */
+static size_t context_top_len(const char *context)
+{
+    const char *nl = strchr(context, '\n');
+    return nl ? (size_t)(nl - context) : strlen(context);
+}
+
+static bool block_is_config(const char *cmd)
+{
+    return strncmp(cmd, "configure", 9) == 0 || strstr(cmd, "\nconfigure") != NULL;
+}
+
+static int group_add_line(struct commit_group *group, const char *line)
+{
+    if (group->line_count == group->line_capacity) {
+        int cap = group->line_capacity ? group->line_capacity * 2 : 8;
+        char **lines = realloc(group->lines, cap * sizeof(char *));
+        if (!lines) {
+            return -1;
+        }
+        group->lines = lines;
+        group->line_capacity = cap;
+    }
+
+    group->lines[group->line_count] = strdup(line);
+    if (!group->lines[group->line_count]) {
+        return -1;
+    }
+    group->line_count++;
+    return 0;
+}
+
+static struct commit_group *candidate_group(const char *context)
+{
+    /* Merge with the previous group when the context is unchanged */
+    if (candidate.group_count > 0) {
+        struct commit_group *last = &candidate.groups[candidate.group_count - 1];
+        if ((!context && !last->context) ||
+            (context && last->context && strcmp(context, last->context) == 0)) {
+            return last;
+        }
+
+        /* A lone "router bgp 100" line followed by its own context block */
+        if (context && !last->context && last->line_count > 0 &&
+            strlen(last->lines[last->line_count - 1]) == context_top_len(context) &&
+            strncmp(last->lines[last->line_count - 1], context, context_top_len(context)) == 0) {
+            free(last->lines[--last->line_count]);
+            candidate.line_total--;
+            if (last->line_count == 0) {
+                free(last->lines);
+                candidate.group_count--;
+            }
+        }
+    }
+
+    if (candidate.group_count == candidate.group_capacity) {
+        int cap = candidate.group_capacity ? candidate.group_capacity * 2 : 16;
+        struct commit_group *groups = realloc(candidate.groups, cap * sizeof(*groups));
+        if (!groups) {
+            return NULL;
+        }
+        candidate.groups = groups;
+        candidate.group_capacity = cap;
+    }
+
+    struct commit_group *group = &candidate.groups[candidate.group_count];
+    memset(group, 0, sizeof(*group));
+    if (context) {
+        group->context = strdup(context);
+        if (!group->context) {
+            return NULL;
+        }
+    }
+    candidate.group_count++;
+    return group;
+}
+
+static void candidate_free(void)
+{
+    for (int i = 0; i < candidate.group_count; i++) {
+        struct commit_group *group = &candidate.groups[i];
+        for (int j = 0; j < group->line_count; j++) {
+            free(group->lines[j]);
+        }
+        free(group->lines);
+        free(group->context);
+    }
+    free(candidate.groups);
+    memset(&candidate, 0, sizeof(candidate));
+}
+
+/*
+ * Stage a "configure terminal ... exit" block into the candidate.
+ * A line entering a node, with lines after it, is the context of those
+ * lines until an exit; inside it, "address-family" and "vni" lines open
+ * nested contexts until their own exit. Lines are grouped by the full
+ * context path, so the same line under two address families stays in
+ * two groups.
+ */
+static int candidate_stage(const char *cmd)
+{
+    char *copy = strdup(cmd);
+    if (!copy) {
+        return -1;
+    }
+
+    char *lines[256];
+    int count = 0;
+    char *saveptr = NULL;
+
+    for (char *line = strtok_r(copy, "\n", &saveptr); line;
+         line = strtok_r(NULL, "\n", &saveptr)) {
+        line = trim(line);
+        if (*line == '\0' || strncmp(line, "configure", 9) == 0) {
+            continue;
+        }
+        if (count == 256) {
+            free(copy);
+            return -1;
+        }
+        lines[count++] = line;
+    }
+
+    while (count > 0 && is_exit_line(lines[count - 1])) {
+        count--;
+    }
+
+    char path[COMMIT_PATH_SIZE] = "";
+    size_t level_end[COMMIT_CONTEXT_DEPTH];
+    int depth = 0;
+    struct commit_group *group = NULL;
+    int ret = 0;
+
+    for (int i = 0; ret == 0 && i < count; i++) {
+        const char *line = lines[i];
+        int sub = depth > 0 ? subcontext_index(line) : -1;
+        bool enters = (depth == 0 && i + 1 < count && is_context_line(line)) || sub >= 0;
+
+        if (is_exit_line(line)) {
+            depth = strcmp(line, "end") == 0 || depth == 0 ? 0 : depth - 1;
+            path[depth ? level_end[depth - 1] : 0] = '\0';
+            group = NULL;
+            continue;
+        }
+        if (enters && depth < COMMIT_CONTEXT_DEPTH) {
+            /* An address family leaves the previous one and anything inside it */
+            while (sub >= 0 && depth > 1 &&
+                   subcontext_index(&path[level_end[depth - 2] + 1]) >= sub) {
+                depth--;
+            }
+            size_t used = depth ? level_end[depth - 1] : 0;
+            int n = snprintf(path + used, sizeof(path) - used, "%s%s", depth ? "\n" : "", line);
+            if (n < 0 || used + n >= sizeof(path)) {
+                ret = -1;
+                break;
+            }
+            level_end[depth++] = used + n;
+            group = NULL;
+            if (sub >= 0) {
+                /* Created even when empty, entering an address family configures it */
+                group = candidate_group(path);
+                ret = group ? 0 : -1;
+            }
+            continue;
+        }
+        if (!group) {
+            group = candidate_group(depth ? path : NULL);
+            if (!group) {
+                ret = -1;
+                break;
+            }
+        }
+        ret = group_add_line(group, line);
+        if (ret == 0) {
+            candidate.line_total++;
+        }
+    }
+
+    free(copy);
+    return ret;
+}
+
+/*
+ * Append formatted text to a growing buffer.
+ */
+static int buf_append(char **buf, size_t *len, size_t *cap, const char *text)
+{
+    size_t n = strlen(text);
+    if (*len + n + 2 > *cap) {
+        size_t new_cap = (*cap ? *cap * 2 : 4096);
+        while (new_cap < *len + n + 2) {
+            new_cap *= 2;
+        }
+        char *p = realloc(*buf, new_cap);
+        if (!p) {
+            return -1;
+        }
+        *buf = p;
+        *cap = new_cap;
+    }
+    memcpy(*buf + *len, text, n);
+    *len += n;
+    (*buf)[(*len)++] = '\n';
+    (*buf)[*len] = '\0';
+    return 0;
+}
+
+static int snapshot_key_cmp(const void *a, const void *b)
+{
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+static char *snapshot_key(const char *context, const char *line)
+{
+    size_t clen = context ? strlen(context) : 0;
+    char *key = malloc(clen + strlen(line) + 2);
+    if (key) {
+        memcpy(key, context ? context : "", clen);
+        key[clen] = '\n';
+        strcpy(key + clen + 1, line);
+    }
+    return key;
+}
+
+static void snapshot_free(struct commit_snapshot *snap)
+{
+    for (int i = 0; i < snap->count; i++) {
+        free(snap->keys[i]);
+    }
+    free(snap->keys);
+    free(snap->sorted);
+    memset(snap, 0, sizeof(*snap));
+}
+
+/*
+ * Take a snapshot of the running configuration. Each line is keyed under
+ * the path of the less indented lines above it, so "network" lines of
+ * two BGP address families get different keys.
+ */
+static int snapshot_take(struct commit_snapshot *snap)
+{
+    memset(snap, 0, sizeof(*snap));
+
+    char *output = malloc(COMMIT_SNAPSHOT_SIZE);
+    if (!output) {
+        return -1;
+    }
+
+    int ret = execute_vtysh_command_now("show running-config",
+                                        output, COMMIT_SNAPSHOT_SIZE);
+    if (ret != 0) {
+        free(output);
+        return ret;
+    }
+
+    int capacity = 1024;
+    snap->keys = malloc(capacity * sizeof(char *));
+    char path[COMMIT_PATH_SIZE] = "";
+    struct {
+        int indent;
+        size_t end;
+    } levels[COMMIT_CONTEXT_DEPTH];
+    int depth = 0;
+    char *saveptr = NULL;
+
+    for (char *raw = strtok_r(output, "\n", &saveptr); raw && snap->keys;
+         raw = strtok_r(NULL, "\n", &saveptr)) {
+        int indent = (int)strspn(raw, " ");
+        char *line = trim(raw);
+        if (*line == '\0' || *line == '!') {
+            continue;
+        }
+
+        /* Leave the contexts this line is not indented under */
+        while (depth > 0 && levels[depth - 1].indent >= indent) {
+            depth--;
+        }
+        path[depth ? levels[depth - 1].end : 0] = '\0';
+        if (is_exit_line(line)) {
+            continue;
+        }
+
+        if (snap->count == capacity) {
+            capacity *= 2;
+            char **keys = realloc(snap->keys, capacity * sizeof(char *));
+            if (!keys) {
+                break;
+            }
+            snap->keys = keys;
+        }
+
+        char *key = snapshot_key(depth ? path : NULL, line);
+        if (key) {
+            snap->keys[snap->count++] = key;
+        }
+
+        /* Any line is the context of more indented lines after it */
+        size_t used = depth ? levels[depth - 1].end : 0;
+        if (depth < COMMIT_CONTEXT_DEPTH &&
+            used + strlen(line) + 1 < sizeof(path)) {
+            snprintf(path + used, sizeof(path) - used, "%s%s", depth ? "\n" : "", line);
+            levels[depth].indent = indent;
+            levels[depth].end = strlen(path);
+            depth++;
+        }
+    }
+
+    free(output);
+    if (!snap->keys) {
+        return -1;
+    }
+
+    snap->sorted = malloc((snap->count ? snap->count : 1) * sizeof(char *));
+    if (!snap->sorted) {
+        snapshot_free(snap);
+        return -1;
+    }
+    memcpy(snap->sorted, snap->keys, snap->count * sizeof(char *));
+    qsort(snap->sorted, snap->count, sizeof(char *), snapshot_key_cmp);
+    return 0;
+}
+
+/* First index whose key is >= the given key */
+static int snapshot_lower_bound(const struct commit_snapshot *snap, const char *key)
+{
+    int lo = 0;
+    int hi = snap->count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (strcmp(snap->sorted[mid], key) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static bool snapshot_has(const struct commit_snapshot *snap, const char *key)
+{
+    int i = snapshot_lower_bound(snap, key);
+    return i < snap->count && strcmp(snap->sorted[i], key) == 0;
+}
+
+/*
+ * Whether a context path exists in the snapshot. A nested path is itself
+ * the key of its last level under its parent.
+ */
+static bool snapshot_has_context(const struct commit_snapshot *snap, const char *context,
+                                 size_t len)
+{
+    char key[COMMIT_PATH_SIZE + 1];
+    snprintf(key, sizeof(key), "%s%.*s", memchr(context, '\n', len) ? "" : "\n", (int)len,
+             context);
+    return snapshot_has(snap, key);
+}
+
+/* Context path length of a snapshot key, and its line */
+static const char *key_line(const char *key, size_t *context_len)
+{
+    const char *nl = strrchr(key, '\n');
+    *context_len = (size_t)(nl - key);
+    return nl + 1;
+}
+
+/*
+ * Switch the block being built to a context path: leave the levels of
+ * the open path not shared with it, innermost first, then enter the
+ * new levels. open holds the path entered, empty at the top level.
+ */
+static int block_enter(char **buf, size_t *len, size_t *cap, char *open, size_t open_size,
+                       const char *context, size_t context_len)
+{
+    size_t open_len = strlen(open);
+    size_t keep = 0;
+    char level[COMMIT_PATH_SIZE];
+
+    if (open_len == context_len && strncmp(open, context, context_len) == 0) {
+        return 0;
+    }
+
+    /* Leading levels the two paths share */
+    for (size_t i = 0;; i++) {
+        bool end_open = i == open_len || open[i] == '\n';
+        bool end_context = i == context_len || context[i] == '\n';
+        if (end_open && end_context) {
+            keep = i;
+            if (i == open_len || i == context_len) {
+                break;
+            }
+        } else if (end_open || end_context || open[i] != context[i]) {
+            break;
+        }
+    }
+
+    while (open_len > keep) {
+        size_t start = open_len;
+        while (start > 0 && open[start - 1] != '\n') {
+            start--;
+        }
+        if (buf_append(buf, len, cap, context_exit(open + start)) != 0) {
+            return -1;
+        }
+        open_len = start > 0 ? start - 1 : 0;
+        open[open_len] = '\0';
+    }
+
+    for (size_t pos = keep; pos < context_len;) {
+        if (context[pos] == '\n') {
+            pos++;
+        }
+        size_t end = pos;
+        while (end < context_len && context[end] != '\n') {
+            end++;
+        }
+        snprintf(level, sizeof(level), "%.*s", (int)(end - pos), context + pos);
+        if (buf_append(buf, len, cap, level) != 0) {
+            return -1;
+        }
+        pos = end;
+    }
+    snprintf(open, open_size, "%.*s", (int)context_len, context);
+    return 0;
+}
+
+/*
+ * Build the commit block: one configuration session for the whole candidate.
+ */
+static char *build_commit_block(void)
+{
+    char *buf = NULL;
+    size_t len = 0;
+    size_t cap = 0;
+    char open[COMMIT_PATH_SIZE] = "";
+
+    if (buf_append(&buf, &len, &cap, "configure terminal") != 0) {
+        return NULL;
+    }
+
+    for (int i = 0; i < candidate.group_count; i++) {
+        struct commit_group *group = &candidate.groups[i];
+        const char *context = group->context ? group->context : "";
+        if (block_enter(&buf, &len, &cap, open, sizeof(open), context, strlen(context)) != 0) {
+            goto fail;
+        }
+        for (int j = 0; j < group->line_count; j++) {
+            if (buf_append(&buf, &len, &cap, group->lines[j]) != 0) {
+                goto fail;
+            }
+        }
+    }
+
+    if (block_enter(&buf, &len, &cap, open, sizeof(open), "", 0) != 0 ||
+        buf_append(&buf, &len, &cap, "end") != 0) {
+        goto fail;
+    }
+    return buf;
+
+fail:
+    free(buf);
+    return NULL;
+}
+
+/*
+ * Build the block restoring the pre-commit snapshot from the running
+ * configuration after a failed commit. Lines only in the current
+ * configuration are negated in reverse order, skipping the body of a
+ * context that is removed as a whole; lines only in the snapshot are
+ * then re-applied in running-config order.
+ */
+static char *build_restore_block(const struct commit_snapshot *pre,
+                                 const struct commit_snapshot *post)
+{
+    char *buf = NULL;
+    size_t len = 0;
+    size_t cap = 0;
+    char open[COMMIT_PATH_SIZE] = "";
+    char text[1024];
+
+    if (buf_append(&buf, &len, &cap, "configure terminal") != 0) {
+        return NULL;
+    }
+
+    for (int i = post->count - 1; i >= 0; i--) {
+        const char *key = post->keys[i];
+        size_t context_len;
+        const char *line = key_line(key, &context_len);
+
+        if (snapshot_has(pre, key) ||
+            (context_len > 0 && !snapshot_has_context(pre, key, context_len))) {
+            continue;
+        }
+        if (block_enter(&buf, &len, &cap, open, sizeof(open), key, context_len) != 0) {
+            goto fail;
+        }
+        snprintf(text, sizeof(text), "%s%s", strncmp(line, "no ", 3) == 0 ? "" : "no ",
+                 strncmp(line, "no ", 3) == 0 ? line + 3 : line);
+        if (buf_append(&buf, &len, &cap, text) != 0) {
+            goto fail;
+        }
+    }
+
+    for (int i = 0; i < pre->count; i++) {
+        const char *key = pre->keys[i];
+        size_t context_len, next_len = 0;
+        const char *line = key_line(key, &context_len);
+
+        if (snapshot_has(post, key)) {
+            continue;
+        }
+
+        /* Re-creating a context enters it for the body that follows */
+        const char *path = context_len ? key : line;
+        size_t path_len = strlen(path);
+        if (i + 1 < pre->count) {
+            key_line(pre->keys[i + 1], &next_len);
+        }
+        bool enters = (context_len == 0 && is_context_line(line)) ||
+                      (next_len == path_len && strncmp(pre->keys[i + 1], path, path_len) == 0);
+        if (enters) {
+            if (block_enter(&buf, &len, &cap, open, sizeof(open), path, path_len) != 0) {
+                goto fail;
+            }
+        } else if (block_enter(&buf, &len, &cap, open, sizeof(open), key, context_len) != 0 ||
+                   buf_append(&buf, &len, &cap, line) != 0) {
+            goto fail;
+        }
+    }
+
+    if (buf_append(&buf, &len, &cap, "end") != 0) {
+        goto fail;
+    }
+    return buf;
+
+fail:
+    free(buf);
+    return NULL;
+}
+
+/*
+ * First difference between two snapshots, as "context: line" or the
+ * top-level line. Returns false when they are equal.
+ */
+static bool snapshot_diff(const struct commit_snapshot *a, const struct commit_snapshot *b,
+                          char *out, size_t size)
+{
+    const char *key = NULL;
+
+    for (int i = 0; i < a->count && !key; i++) {
+        if (!snapshot_has(b, a->keys[i])) {
+            key = a->keys[i];
+        }
+    }
+    for (int i = 0; i < b->count && !key; i++) {
+        if (!snapshot_has(a, b->keys[i])) {
+            key = b->keys[i];
+        }
+    }
+    if (!key) {
+        return false;
+    }
+
+    size_t context_len;
+    const char *line = key_line(key, &context_len);
+    if (context_len > 0) {
+        /* Nested levels as "router bgp 100 / address-family ipv4 unicast" */
+        size_t n = 0;
+        for (size_t i = 0; i < context_len && n + 4 < size; i++) {
+            if (key[i] == '\n') {
+                n += (size_t)snprintf(out + n, size - n, " / ");
+            } else {
+                out[n++] = key[i];
+            }
+        }
+        snprintf(out + n, size - n, ": %s", line);
+    } else {
+        snprintf(out, size, "%s", line);
+    }
+    return true;
+}
+
+/*
+ * Restore the pre-commit snapshot after a failed commit, then check
+ * the running configuration against it. On failure, error names the
+ * first line that differs.
+ */
+static int commit_restore(const struct commit_snapshot *pre, char *error, size_t error_size)
+{
+    struct commit_snapshot now;
+    char line[512];
+
+    if (snapshot_take(&now) != 0) {
+        snprintf(error, error_size, "rollback failed: running configuration unavailable");
+        return -1;
+    }
+    char *block = build_restore_block(pre, &now);
+    snapshot_free(&now);
+    if (!block) {
+        snprintf(error, error_size, "rollback failed: out of memory");
+        return -1;
+    }
+    execute_vtysh_command_now(block, NULL, 0);
+    free(block);
+
+    /* The restore block's own status misses lines FRR accepts but ignores */
+    if (snapshot_take(&now) != 0) {
+        snprintf(error, error_size, "rollback failed: running configuration unavailable");
+        return -1;
+    }
+    bool differs = snapshot_diff(pre, &now, line, sizeof(line));
+    snapshot_free(&now);
+    if (differs) {
+        snprintf(error, error_size, "rollback failed at: %s", line);
+        return -1;
+    }
+    snprintf(error, error_size, "configuration rolled back");
+    return 0;
+}
+
+/* Run the deferred functions, outside commit_lock as they may stage lines */
+static void commit_run_deferred(void)
+{
+    void (*run[COMMIT_DEFER_MAX])(void);
+
+    pthread_mutex_lock(&commit_lock);
+    int count = deferred_count;
+    memcpy(run, deferred, sizeof(run[0]) * count);
+    deferred_count = 0;
+    pthread_mutex_unlock(&commit_lock);
+
+    for (int i = 0; i < count; i++) {
+        run[i]();
+    }
+}
+
+/*
+ * Run fn once the configuration being entered is complete: at once in
+ * immediate mode, otherwise at the next commit or when two-stage mode
+ * ends. A function deferred several times runs once.
+ */
+void cli_commit_defer(void (*fn)(void))
+{
+    pthread_mutex_lock(&commit_lock);
+    bool now = !two_stage;
+    if (!now) {
+        int i = 0;
+        while (i < deferred_count && deferred[i] != fn) {
+            i++;
+        }
+        if (i == deferred_count) {
+            if (deferred_count < COMMIT_DEFER_MAX) {
+                deferred[deferred_count++] = fn;
+            } else {
+                now = true;
+            }
+        }
+    }
+    pthread_mutex_unlock(&commit_lock);
+
+    if (now) {
+        fn();
+    }
+}
+
+void cli_commit_set_two_stage(bool enable)
+{
+    pthread_mutex_lock(&commit_lock);
+    two_stage = enable;
+    pthread_mutex_unlock(&commit_lock);
+
+    if (!enable) {
+        commit_run_deferred();
+    }
+}
+
+bool cli_commit_two_stage(void)
+{
+    pthread_mutex_lock(&commit_lock);
+    bool enabled = two_stage;
+    pthread_mutex_unlock(&commit_lock);
+    return enabled;
+}
+
+/*
+ * Stage a command block when two-stage mode is active.
+ * Returns 1 if the block was staged, 0 if it must run immediately,
+ * -1 on error.
+ */
+int cli_commit_stage(const char *cmd)
+{
+    if (!block_is_config(cmd)) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&commit_lock);
+    int ret = 0;
+    if (two_stage) {
+        ret = candidate_stage(cmd) == 0 ? 1 : -1;
+    }
+    pthread_mutex_unlock(&commit_lock);
+    return ret;
+}
+
+int cli_commit_candidate_count(void)
+{
+    pthread_mutex_lock(&commit_lock);
+    int count = candidate.line_total;
+    pthread_mutex_unlock(&commit_lock);
+    return count;
+}
+
+void cli_commit_clear(void)
+{
+    pthread_mutex_lock(&commit_lock);
+    candidate_free();
+    pthread_mutex_unlock(&commit_lock);
+}
+
+static int commit_candidate(char *error, size_t error_size)
+{
+    char detail[640];
+
+    pthread_mutex_lock(&commit_lock);
+
+    if (candidate.line_total == 0) {
+        pthread_mutex_unlock(&commit_lock);
+        return 0;
+    }
+
+    struct commit_snapshot snap;
+    int ret = snapshot_take(&snap);
+    if (ret != 0) {
+        pthread_mutex_unlock(&commit_lock);
+        snprintf(error ? error : detail, error ? error_size : sizeof(detail),
+                 "running configuration unavailable, nothing applied");
+        return -1;
+    }
+
+    char *block = build_commit_block();
+    if (!block) {
+        snapshot_free(&snap);
+        pthread_mutex_unlock(&commit_lock);
+        snprintf(error ? error : detail, error ? error_size : sizeof(detail),
+                 "out of memory, nothing applied");
+        return -1;
+    }
+
+    ret = execute_vtysh_command_now(block, NULL, 0);
+    free(block);
+
+    if (ret != 0) {
+        commit_restore(&snap, error ? error : detail, error ? error_size : sizeof(detail));
+        ret = -1;
+    } else {
+        candidate_free();
+    }
+
+    snapshot_free(&snap);
+    pthread_mutex_unlock(&commit_lock);
+    return ret;
+}
+
+/*
+ * Commit the candidate configuration, then run the deferred functions.
+ * On failure, the running configuration is restored to its pre-commit
+ * snapshot and the candidate is kept so it can be corrected and
+ * committed again. error, when given, then says whether the rollback
+ * succeeded or which line it could not restore.
+ */
+int cli_commit(char *error, size_t error_size)
+{
+    int ret = commit_candidate(error, error_size);
+    commit_run_deferred();
+    return ret;
+}
+
+/*
+ * Set configuration mode
+ * Command: configuration-mode {two-stage|immediately}
+ */
+static int cmd_configuration_mode(struct cmd_element *cmd, struct cmd_args *args)
+{
+    if (args->argc < 1) {
+        printf("Error: Mode required\n");
+        printf("Usage: configuration-mode {two-stage|immediately}\n");
+        return -1;
+    }
+
+    if (strcmp(args->argv[0], "two-stage") == 0) {
+        cli_commit_set_two_stage(true);
+        printf("Configuration mode set to two-stage\n");
+    } else if (strcmp(args->argv[0], "immediately") == 0) {
+        if (cli_commit_candidate_count() > 0) {
+            printf("Error: Uncommitted configuration exists, commit or clear it first\n");
+            return -1;
+        }
+        cli_commit_set_two_stage(false);
+        printf("Configuration mode set to immediately\n");
+    } else {
+        printf("Error: Mode must be 'two-stage' or 'immediately'\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+/*
+ * Commit candidate configuration
+ * Command: commit
+ */
+static int cmd_commit(struct cmd_element *cmd, struct cmd_args *args)
+{
+    int lines = cli_commit_candidate_count();
+    if (lines == 0) {
+        /* Local-only changes still have deferred work to run */
+        cli_commit(NULL, 0);
+        printf("Info: No configuration to commit\n");
+        return 0;
+    }
+
+    char error[640];
+    int ret = cli_commit(error, sizeof(error));
+    if (ret == 0) {
+        printf("Committed %d configuration lines\n", lines);
+    } else {
+        printf("Error: Commit failed, %s\n", error);
+    }
+
+    return ret;
+}
+
+/*
+ * Display candidate configuration
+ * Command: display configuration candidate
+ */
+static int cmd_display_configuration_candidate(struct cmd_element *cmd, struct cmd_args *args)
+{
+    pthread_mutex_lock(&commit_lock);
+
+    printf("Candidate configuration (%d lines):\n", candidate.line_total);
+    for (int i = 0; i < candidate.group_count; i++) {
+        struct commit_group *group = &candidate.groups[i];
+        int depth = 0;
+        for (const char *level = group->context; level; depth++) {
+            const char *nl = strchr(level, '\n');
+            printf("%*s%.*s\n", depth, "", nl ? (int)(nl - level) : (int)strlen(level), level);
+            level = nl ? nl + 1 : NULL;
+        }
+        for (int j = 0; j < group->line_count; j++) {
+            printf("%*s%s\n", depth, "", group->lines[j]);
+        }
+        if (group->context) {
+            printf("#\n");
+        }
+    }
+
+    pthread_mutex_unlock(&commit_lock);
+    return 0;
+}
+
+/*
+ * Discard candidate configuration
+ * Command: clear configuration candidate
+ */
+static int cmd_clear_configuration_candidate(struct cmd_element *cmd, struct cmd_args *args)
+{
+    cli_commit_clear();
+    printf("Candidate configuration cleared\n");
+    return 0;
+}
+
+/* Command registration */
+struct cmd_element commit_cmds[] = {
+    HUAWEI_CMD_WITH_CATEGORY("configuration-mode", cmd_configuration_mode, NULL,
+                             "Set two-stage or immediate configuration mode", CMD_CAT_SYSTEM),
+    HUAWEI_CMD_WITH_CATEGORY("commit", cmd_commit, "commit",
+                             "Commit candidate configuration", CMD_CAT_SYSTEM),
+    HUAWEI_CMD_WITH_CATEGORY("display configuration candidate", cmd_display_configuration_candidate,
+                             "show configuration candidate",
+                             "Display candidate configuration", CMD_CAT_SYSTEM),
+    HUAWEI_CMD_WITH_CATEGORY("clear configuration candidate", cmd_clear_configuration_candidate,
+                             "abort", "Discard candidate configuration", CMD_CAT_SYSTEM),
+    { .name = NULL }
+};
+
+/* Register commit commands */
+void register_commit_cmds(void)
+{
+    printf("Registering commit commands...\n");
+    huawei_cli_register_table(commit_cmds, NULL);
+}
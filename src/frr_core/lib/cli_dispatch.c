@@ -0,0 +1,255 @@
+/*
+ * Command Dispatcher for Huawei VRP Style
+ * Copyright (C) 2026 WhiteBox NE Team
+ *
+ * This module provides the command line dispatcher including:
+ * - O(1) lookup of full names and Cisco aliases in the generated hash tables
+ * - One token trie built from all registered command tables
+ * - VRP abbreviations ("dis cur", "int g0/0/1") by unique prefix
+ * - View-aware selection of commands shared by several views
+ * - Alias execution through FRR for commands without a handler
+ * - Per-command call and latency accounting (cli_stats.c)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "huawei_cli.h"
+#include "cmd_trie.h"
+#include "cmd_hash.h"
+#include "cli_stats.h"
+
+#define CLI_MAX_TOKENS      64
+#define CLI_ALIAS_SIZE      1024
+#define CLI_OUTPUT_SIZE     65536
+
+static struct cmd_trie *cli_trie;
+static pthread_rwlock_t cli_trie_lock = PTHREAD_RWLOCK_INITIALIZER;
+
+/*
+ * Register a NULL-terminated command table.
+ * View is the VRP view prefix the table belongs to ("bgp", "acl"),
+ * NULL for commands available in every view.
+ */
+int huawei_cli_register_table(struct cmd_element *table, const char *view)
+{
+    int count = 0;
+
+    pthread_rwlock_wrlock(&cli_trie_lock);
+    if (!cli_trie) {
+        cli_trie = cmd_trie_new();
+        if (!cli_trie) {
+            pthread_rwlock_unlock(&cli_trie_lock);
+            return -1;
+        }
+    }
+
+    for (int i = 0; table[i].name != NULL; i++) {
+        if (cmd_trie_insert(cli_trie, &table[i], view) == 0) {
+            count++;
+        }
+        cmd_hash_bind(&table[i], view);
+        cli_stats_register(&table[i]);
+    }
+    pthread_rwlock_unlock(&cli_trie_lock);
+
+    return count;
+}
+
+int huawei_cli_command_count(void)
+{
+    pthread_rwlock_rdlock(&cli_trie_lock);
+    int count = cli_trie ? cmd_trie_count(cli_trie) : 0;
+    pthread_rwlock_unlock(&cli_trie_lock);
+    return count;
+}
+
+/*
+ * Longest match of the leading tokens against the generated name and
+ * alias tables. Names that lead longer names ("peer" of "peer description")
+ * are left to the trie, which can skip the argument between keywords.
+ */
+static bool cli_hash_lookup(char **tokens, int count, const char *view,
+                            struct cmd_trie_match *match, bool *alias)
+{
+    size_t offsets[CLI_MAX_TOKENS + 1];
+    char key[CLI_ALIAS_SIZE];
+    size_t len = 0;
+    int words = count < cmd_hash_max_words ? count : cmd_hash_max_words;
+
+    for (int i = 0; i < words; i++) {
+        size_t n = strlen(tokens[i]);
+        if (len + n + 1 >= sizeof(key)) {
+            words = i;
+            break;
+        }
+        if (i > 0) {
+            key[len++] = ' ';
+        }
+        memcpy(key + len, tokens[i], n);
+        len += n;
+        offsets[i + 1] = len;
+    }
+
+    for (int k = words; k > 0; k--) {
+        uint32_t flags = 0;
+        struct cmd_element *cmd = cmd_hash_find(key, offsets[k], view, &flags);
+        if (cmd) {
+            if (flags & CMD_HASH_PREFIX) {
+                return false;
+            }
+            match->cmd = cmd;
+            match->consumed = k;
+            match->status = CMD_TRIE_OK;
+            *alias = false;
+            return true;
+        }
+
+        cmd = cmd_hash_find_alias(key, offsets[k], view);
+        if (cmd) {
+            match->cmd = cmd;
+            match->consumed = k;
+            match->status = CMD_TRIE_OK;
+            *alias = true;
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Run a handler for a line entered with its Cisco alias. The handler
+ * sees the canonical keywords, then the arguments after the alias.
+ */
+static int cli_execute_canonical(struct cmd_element *cmd, char **tokens, int count)
+{
+    char name[CLI_ALIAS_SIZE];
+    char *argv[CLI_MAX_TOKENS * 2];
+    int argc = 0;
+    char *saveptr = NULL;
+
+    snprintf(name, sizeof(name), "%s", cmd->name);
+    strtok_r(name, " ", &saveptr);
+    for (char *tok = strtok_r(NULL, " ", &saveptr); tok; tok = strtok_r(NULL, " ", &saveptr)) {
+        argv[argc++] = tok;
+    }
+    for (int i = 0; i < count; i++) {
+        argv[argc++] = tokens[i];
+    }
+
+    struct cmd_args args = {
+        .argc = argc,
+        .argv = argv
+    };
+    return cmd->func(cmd, &args);
+}
+
+/*
+ * Run the FRR alias of a command that has no handler.
+ * Tokens after the command name are appended as arguments.
+ */
+static int cli_execute_alias(struct cmd_element *cmd, char **tokens, int count)
+{
+    char line[CLI_ALIAS_SIZE];
+    size_t len = (size_t)snprintf(line, sizeof(line), "%s", cmd->alias);
+
+    for (int i = 0; i < count && len < sizeof(line); i++) {
+        len += (size_t)snprintf(line + len, sizeof(line) - len, " %s", tokens[i]);
+    }
+    if (len >= sizeof(line)) {
+        printf("Error: Command too long\n");
+        return -1;
+    }
+
+    char *output = malloc(CLI_OUTPUT_SIZE);
+    if (!output) {
+        return -1;
+    }
+
+    int ret = execute_vtysh_command_with_output(line, output, CLI_OUTPUT_SIZE);
+    if (output[0] != '\0') {
+        printf("%s", output);
+    }
+    free(output);
+    return ret;
+}
+
+/*
+ * Execute one command line in the given view.
+ * Handlers receive every token after the first keyword, as registered
+ * handlers expect ("peer 10.1.1.1 description x" -> argv[0] = "10.1.1.1").
+ */
+int huawei_cli_execute(const char *line, const char *view)
+{
+    char *copy = strdup(line);
+    if (!copy) {
+        return -1;
+    }
+
+    char *tokens[CLI_MAX_TOKENS];
+    int count = 0;
+    char *saveptr = NULL;
+
+    for (char *tok = strtok_r(copy, " \t\r\n", &saveptr); tok;
+         tok = strtok_r(NULL, " \t\r\n", &saveptr)) {
+        if (count == CLI_MAX_TOKENS) {
+            printf("Error: Too many parameters\n");
+            free(copy);
+            return -1;
+        }
+        tokens[count++] = tok;
+    }
+
+    if (count == 0) {
+        free(copy);
+        return 0;
+    }
+
+    struct cmd_trie_match match = { 0 };
+    bool alias = false;
+    pthread_rwlock_rdlock(&cli_trie_lock);
+    if (!cli_hash_lookup(tokens, count, view, &match, &alias)) {
+        if (cli_trie) {
+            cmd_trie_lookup(cli_trie, tokens, count, view, &match);
+        } else {
+            match.status = CMD_TRIE_NO_MATCH;
+        }
+    }
+    pthread_rwlock_unlock(&cli_trie_lock);
+
+    if (match.status == CMD_TRIE_AMBIGUOUS) {
+        printf("Error: Ambiguous command found at '^' position.\n");
+        free(copy);
+        return -1;
+    } else if (match.status != CMD_TRIE_OK) {
+        printf("Error: Unrecognized command found at '^' position.\n");
+        free(copy);
+        return -1;
+    }
+
+    struct cli_stats_call call;
+    cli_stats_begin(&call);
+
+    int ret;
+    if (match.cmd->func && alias) {
+        ret = cli_execute_canonical(match.cmd, tokens + match.consumed, count - match.consumed);
+    } else if (match.cmd->func) {
+        struct cmd_args args = {
+            .argc = count - 1,
+            .argv = tokens + 1
+        };
+        ret = match.cmd->func(match.cmd, &args);
+    } else if (match.cmd->alias) {
+        ret = cli_execute_alias(match.cmd, tokens + match.consumed, count - match.consumed);
+    } else {
+        printf("Info: Command '%s' is not supported on this device\n", match.cmd->name);
+        ret = -1;
+    }
+
+    cli_stats_end(&call, match.cmd, ret);
+    free(copy);
+    return ret;
+}
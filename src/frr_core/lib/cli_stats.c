@@ -0,0 +1,410 @@
+/*
+ * Huawei VRP Style CLI Statistics
+ * Copyright (C) 2026 WhiteBox NE Team
+ *
+ * This module provides dispatcher instrumentation including:
+ * - Per-command calls, errors and FRR execution counts
+ * - Log-linear latency histograms for handler and vtysh time
+ * - Per-thread counter blocks, written only by their owner thread
+ * - "display cli statistics" and a JSON dump of the merged counters
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <time.h>
+#include "huawei_cli.h"
+#include "cli_stats.h"
+
+#define CLI_STATS_HASH_SIZE     (CLI_STATS_MAX_CMDS * 2)
+
+/* Counters of one thread */
+struct cli_stats_thread {
+    struct cli_cmd_stats *cmds[CLI_STATS_MAX_CMDS];
+    struct cli_stats_thread *next;
+};
+
+/* Registered commands, open addressing on the cmd_element address */
+static struct cmd_element *stats_keys[CLI_STATS_HASH_SIZE];
+static int stats_ids[CLI_STATS_HASH_SIZE];
+static struct cmd_element *stats_cmds[CLI_STATS_MAX_CMDS];
+static int stats_cmd_count;
+
+static struct cli_stats_thread *stats_threads;
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static __thread struct cli_stats_thread *stats_self;
+static __thread uint64_t stats_vtysh_ns;
+static __thread uint64_t stats_vtysh_calls;
+
+uint64_t cli_stats_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static inline uint64_t load64(const uint64_t *p)
+{
+    return __atomic_load_n(p, __ATOMIC_RELAXED);
+}
+
+/* Owner-thread update, readable by other threads without tearing */
+static inline void add64(uint64_t *p, uint64_t v)
+{
+    __atomic_store_n(p, *p + v, __ATOMIC_RELAXED);
+}
+
+static inline uint32_t ptr_hash(const void *p)
+{
+    uint64_t v = (uint64_t)(uintptr_t)p;
+    v ^= v >> 33;
+    v *= 0xff51afd7ed558ccdull;
+    v ^= v >> 33;
+    return (uint32_t)v & (CLI_STATS_HASH_SIZE - 1);
+}
+
+static int stats_find(const struct cmd_element *cmd)
+{
+    for (uint32_t i = ptr_hash(cmd);; i = (i + 1) & (CLI_STATS_HASH_SIZE - 1)) {
+        struct cmd_element *key = __atomic_load_n(&stats_keys[i], __ATOMIC_ACQUIRE);
+        if (key == cmd) {
+            return stats_ids[i];
+        }
+        if (!key) {
+            return -1;
+        }
+    }
+}
+
+/*
+ * Assign a statistics slot to a command. Called by the dispatcher
+ * when a table is registered.
+ */
+int cli_stats_register(struct cmd_element *cmd)
+{
+    pthread_mutex_lock(&stats_lock);
+
+    int id = stats_find(cmd);
+    if (id < 0 && stats_cmd_count < CLI_STATS_MAX_CMDS) {
+        uint32_t i = ptr_hash(cmd);
+        while (stats_keys[i]) {
+            i = (i + 1) & (CLI_STATS_HASH_SIZE - 1);
+        }
+        id = stats_cmd_count++;
+        stats_cmds[id] = cmd;
+        stats_ids[i] = id;
+        __atomic_store_n(&stats_keys[i], cmd, __ATOMIC_RELEASE);
+    }
+
+    pthread_mutex_unlock(&stats_lock);
+    return id;
+}
+
+static int hist_bucket(uint64_t ns)
+{
+    if (ns < (1u << CLI_HIST_SUB_BITS)) {
+        return (int)ns;
+    }
+
+    int exp = 63 - __builtin_clzll(ns);
+    if (exp > CLI_HIST_MAX_EXP) {
+        return CLI_HIST_BUCKETS - 1;
+    }
+    int sub = (int)(ns >> (exp - CLI_HIST_SUB_BITS)) & ((1 << CLI_HIST_SUB_BITS) - 1);
+    return ((exp - CLI_HIST_SUB_BITS + 1) << CLI_HIST_SUB_BITS) + sub;
+}
+
+/* Lowest value counted in a bucket */
+static uint64_t hist_bucket_value(int bucket)
+{
+    if (bucket < (1 << CLI_HIST_SUB_BITS)) {
+        return (uint64_t)bucket;
+    }
+    int exp = (bucket >> CLI_HIST_SUB_BITS) + CLI_HIST_SUB_BITS - 1;
+    uint64_t sub = (uint64_t)(bucket & ((1 << CLI_HIST_SUB_BITS) - 1));
+    return ((1ull << CLI_HIST_SUB_BITS) + sub) << (exp - CLI_HIST_SUB_BITS);
+}
+
+static void hist_record(struct cli_hist *hist, uint64_t ns)
+{
+    add64(&hist->count, 1);
+    add64(&hist->sum_ns, ns);
+    add64(&hist->buckets[hist_bucket(ns)], 1);
+    if (ns > hist->max_ns) {
+        __atomic_store_n(&hist->max_ns, ns, __ATOMIC_RELAXED);
+    }
+}
+
+static void hist_merge(struct cli_hist *dst, const struct cli_hist *src)
+{
+    dst->count += load64(&src->count);
+    dst->sum_ns += load64(&src->sum_ns);
+    uint64_t max = load64(&src->max_ns);
+    if (max > dst->max_ns) {
+        dst->max_ns = max;
+    }
+    for (int i = 0; i < CLI_HIST_BUCKETS; i++) {
+        dst->buckets[i] += load64(&src->buckets[i]);
+    }
+}
+
+uint64_t cli_hist_percentile(const struct cli_hist *hist, double percentile)
+{
+    if (hist->count == 0) {
+        return 0;
+    }
+
+    uint64_t rank = (uint64_t)(hist->count * percentile / 100.0);
+    if (rank >= hist->count) {
+        rank = hist->count - 1;
+    }
+
+    uint64_t seen = 0;
+    for (int i = 0; i < CLI_HIST_BUCKETS; i++) {
+        seen += hist->buckets[i];
+        if (seen > rank) {
+            uint64_t value = hist_bucket_value(i);
+            return value < hist->max_ns ? value : hist->max_ns;
+        }
+    }
+    return hist->max_ns;
+}
+
+static struct cli_stats_thread *stats_thread(void)
+{
+    if (!stats_self) {
+        struct cli_stats_thread *self = calloc(1, sizeof(*self));
+        if (!self) {
+            return NULL;
+        }
+        pthread_mutex_lock(&stats_lock);
+        self->next = stats_threads;
+        __atomic_store_n(&stats_threads, self, __ATOMIC_RELEASE);
+        pthread_mutex_unlock(&stats_lock);
+        stats_self = self;
+    }
+    return stats_self;
+}
+
+void cli_stats_begin(struct cli_stats_call *call)
+{
+    call->vtysh_ns = stats_vtysh_ns;
+    call->vtysh_calls = stats_vtysh_calls;
+    call->start_ns = cli_stats_now();
+}
+
+/*
+ * Account a finished dispatch. FRR time includes the execute_vtysh_command()
+ * calls of nested dispatches (configuration loading).
+ */
+void cli_stats_end(struct cli_stats_call *call, struct cmd_element *cmd, int ret)
+{
+    uint64_t total = cli_stats_now() - call->start_ns;
+    uint64_t vtysh = stats_vtysh_ns - call->vtysh_ns;
+    uint64_t vtysh_calls = stats_vtysh_calls - call->vtysh_calls;
+
+    int id = stats_find(cmd);
+    struct cli_stats_thread *self = stats_thread();
+    if (id < 0 || !self) {
+        return;
+    }
+
+    struct cli_cmd_stats *stats = self->cmds[id];
+    if (!stats) {
+        stats = calloc(1, sizeof(*stats));
+        if (!stats) {
+            return;
+        }
+        __atomic_store_n(&self->cmds[id], stats, __ATOMIC_RELEASE);
+    }
+
+    add64(&stats->calls, 1);
+    if (ret != 0) {
+        add64(&stats->errors, 1);
+    }
+    hist_record(&stats->handler, total > vtysh ? total - vtysh : 0);
+    if (vtysh_calls > 0) {
+        add64(&stats->vtysh_calls, vtysh_calls);
+        hist_record(&stats->vtysh, vtysh);
+    }
+}
+
+/* Called by execute_vtysh_command() with its own duration */
+void cli_stats_vtysh_add(uint64_t ns)
+{
+    stats_vtysh_ns += ns;
+    stats_vtysh_calls++;
+}
+
+/*
+ * Merge the counters of all threads for one command.
+ * Returns -1 if the command is not registered.
+ */
+int cli_stats_get(struct cmd_element *cmd, struct cli_cmd_stats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+
+    int id = stats_find(cmd);
+    if (id < 0) {
+        return -1;
+    }
+
+    for (struct cli_stats_thread *t = __atomic_load_n(&stats_threads, __ATOMIC_ACQUIRE);
+         t; t = t->next) {
+        const struct cli_cmd_stats *s = __atomic_load_n(&t->cmds[id], __ATOMIC_ACQUIRE);
+        if (!s) {
+            continue;
+        }
+        stats->calls += load64(&s->calls);
+        stats->errors += load64(&s->errors);
+        stats->vtysh_calls += load64(&s->vtysh_calls);
+        hist_merge(&stats->handler, &s->handler);
+        hist_merge(&stats->vtysh, &s->vtysh);
+    }
+    return 0;
+}
+
+/*
+ * Clear all counters. Dispatches running concurrently may keep a
+ * partial update.
+ */
+void cli_stats_reset(void)
+{
+    pthread_mutex_lock(&stats_lock);
+    for (struct cli_stats_thread *t = stats_threads; t; t = t->next) {
+        for (int i = 0; i < stats_cmd_count; i++) {
+            struct cli_cmd_stats *s = __atomic_load_n(&t->cmds[i], __ATOMIC_ACQUIRE);
+            if (s) {
+                memset(s, 0, sizeof(*s));
+            }
+        }
+    }
+    pthread_mutex_unlock(&stats_lock);
+}
+
+static void hist_dump(FILE *fp, const char *name, const struct cli_hist *hist)
+{
+    fprintf(fp, "\"%s\":{\"count\":%llu,\"sum_ns\":%llu,\"max_ns\":%llu,"
+            "\"p50_ns\":%llu,\"p99_ns\":%llu,\"buckets\":[",
+            name, (unsigned long long)hist->count, (unsigned long long)hist->sum_ns,
+            (unsigned long long)hist->max_ns,
+            (unsigned long long)cli_hist_percentile(hist, 50),
+            (unsigned long long)cli_hist_percentile(hist, 99));
+
+    bool first = true;
+    for (int i = 0; i < CLI_HIST_BUCKETS; i++) {
+        if (hist->buckets[i]) {
+            fprintf(fp, "%s[%llu,%llu]", first ? "" : ",",
+                    (unsigned long long)hist_bucket_value(i),
+                    (unsigned long long)hist->buckets[i]);
+            first = false;
+        }
+    }
+    fprintf(fp, "]}");
+}
+
+/*
+ * Write the merged counters as JSON, one object per command with calls.
+ * Histogram buckets are [lowest_ns, count] pairs.
+ */
+void cli_stats_dump(FILE *fp)
+{
+    struct cli_cmd_stats *stats = malloc(sizeof(*stats));
+    if (!stats) {
+        return;
+    }
+
+    int count = __atomic_load_n(&stats_cmd_count, __ATOMIC_ACQUIRE);
+    bool first = true;
+
+    fprintf(fp, "{\"commands\":[");
+    for (int i = 0; i < count; i++) {
+        if (cli_stats_get(stats_cmds[i], stats) != 0 || stats->calls == 0) {
+            continue;
+        }
+        fprintf(fp, "%s\n{\"name\":\"%s\",\"calls\":%llu,\"errors\":%llu,\"vtysh_calls\":%llu,",
+                first ? "" : ",", stats_cmds[i]->name,
+                (unsigned long long)stats->calls, (unsigned long long)stats->errors,
+                (unsigned long long)stats->vtysh_calls);
+        hist_dump(fp, "handler", &stats->handler);
+        fprintf(fp, ",");
+        hist_dump(fp, "vtysh", &stats->vtysh);
+        fprintf(fp, "}");
+        first = false;
+    }
+    fprintf(fp, "\n]}\n");
+
+    free(stats);
+}
+
+/*
+ * Display CLI statistics
+ * Command: display cli statistics [json]
+ */
+static int cmd_display_cli_statistics(struct cmd_element *cmd, struct cmd_args *args)
+{
+    if (args->argc > 2 && strcmp(args->argv[2], "json") == 0) {
+        cli_stats_dump(stdout);
+        return 0;
+    }
+
+    struct cli_cmd_stats *stats = malloc(sizeof(*stats));
+    if (!stats) {
+        return -1;
+    }
+
+    int count = __atomic_load_n(&stats_cmd_count, __ATOMIC_ACQUIRE);
+
+    printf("CLI Command Statistics (latency in microseconds):\n");
+    printf("%-32s %10s %8s %9s %9s %9s %9s %9s\n", "Command", "Calls", "Errors",
+           "Hdl-p50", "Hdl-p99", "Hdl-max", "Frr-p50", "Frr-p99");
+    printf("-----------------------------------------------------------------"
+           "------------------------------------\n");
+
+    for (int i = 0; i < count; i++) {
+        if (cli_stats_get(stats_cmds[i], stats) != 0 || stats->calls == 0) {
+            continue;
+        }
+        printf("%-32.32s %10llu %8llu %9.1f %9.1f %9.1f %9.1f %9.1f\n", stats_cmds[i]->name,
+               (unsigned long long)stats->calls, (unsigned long long)stats->errors,
+               cli_hist_percentile(&stats->handler, 50) / 1000.0,
+               cli_hist_percentile(&stats->handler, 99) / 1000.0,
+               stats->handler.max_ns / 1000.0,
+               cli_hist_percentile(&stats->vtysh, 50) / 1000.0,
+               cli_hist_percentile(&stats->vtysh, 99) / 1000.0);
+    }
+
+    free(stats);
+    return 0;
+}
+
+/*
+ * Reset CLI statistics
+ * Command: reset cli statistics
+ */
+static int cmd_reset_cli_statistics(struct cmd_element *cmd, struct cmd_args *args)
+{
+    cli_stats_reset();
+    printf("CLI statistics cleared\n");
+    return 0;
+}
+
+/* Command registration */
+struct cmd_element cli_stats_cmds[] = {
+    HUAWEI_CMD_WITH_CATEGORY("display cli statistics", cmd_display_cli_statistics, NULL,
+                             "Display per-command call and latency statistics", CMD_CAT_MONITOR),
+    HUAWEI_CMD_WITH_CATEGORY("reset cli statistics", cmd_reset_cli_statistics, NULL,
+                             "Clear CLI command statistics", CMD_CAT_MONITOR),
+    { .name = NULL }
+};
+
+/* Register CLI statistics commands */
+void register_cli_stats_cmds(void)
+{
+    printf("Registering CLI statistics commands...\n");
+    huawei_cli_register_table(cli_stats_cmds, NULL);
+}
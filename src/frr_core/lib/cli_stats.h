@@ -0,0 +1,63 @@
+/*
+ * Huawei VRP Style CLI Statistics
+ * Copyright (C) 2026 WhiteBox NE Team
+ *
+ * Per-command call, error and latency accounting for the dispatcher.
+ * Latency is split into time spent in execute_vtysh_command() and time
+ * spent in the handler itself, each kept in an HDR-style log-linear
+ * histogram. Counters are per thread and merged only when read.
+ */
+
+#ifndef _CLI_STATS_H
+#define _CLI_STATS_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "huawei_cli.h"
+
+#define CLI_STATS_MAX_CMDS      1024
+
+/*
+ * Histogram layout: values below 16 ns get one bucket each, every
+ * further power of two is split into 16 linear sub-buckets (6% error)
+ * up to 2^36 ns (68 s).
+ */
+#define CLI_HIST_SUB_BITS       4
+#define CLI_HIST_MAX_EXP        36
+#define CLI_HIST_BUCKETS        ((CLI_HIST_MAX_EXP - CLI_HIST_SUB_BITS + 2) << CLI_HIST_SUB_BITS)
+
+/* Latency histogram, nanoseconds */
+struct cli_hist {
+    uint64_t count;
+    uint64_t sum_ns;
+    uint64_t max_ns;
+    uint64_t buckets[CLI_HIST_BUCKETS];
+};
+
+/* Statistics of one command */
+struct cli_cmd_stats {
+    uint64_t calls;
+    uint64_t errors;
+    uint64_t vtysh_calls;
+    struct cli_hist handler;    /* Handler time without FRR execution */
+    struct cli_hist vtysh;      /* Time in execute_vtysh_command() */
+};
+
+/* In-flight dispatch, on the caller's stack */
+struct cli_stats_call {
+    uint64_t start_ns;
+    uint64_t vtysh_ns;          /* Thread FRR time at start */
+    uint64_t vtysh_calls;
+};
+
+uint64_t cli_stats_now(void);
+int cli_stats_register(struct cmd_element *cmd);
+void cli_stats_begin(struct cli_stats_call *call);
+void cli_stats_end(struct cli_stats_call *call, struct cmd_element *cmd, int ret);
+void cli_stats_vtysh_add(uint64_t ns);
+int cli_stats_get(struct cmd_element *cmd, struct cli_cmd_stats *stats);
+uint64_t cli_hist_percentile(const struct cli_hist *hist, double percentile);
+void cli_stats_reset(void);
+void cli_stats_dump(FILE *fp);
+
+#endif /* _CLI_STATS_H */
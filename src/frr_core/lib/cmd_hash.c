@@ -0,0 +1,164 @@
+/*
+ * Huawei VRP Style Command Hash Lookup
+ * Copyright (C) 2026 WhiteBox NE Team
+ *
+ * This module provides lookup over the generated command tables including:
+ * - Hash-and-displace lookup: one displacement read, one key compare
+ * - Binding of registered cmd_element tables to generated variants
+ * - Alias to canonical command resolution per view
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "cmd_hash.h"
+
+#define CMD_HASH_FNV_BASIS  0x811c9dc5u
+#define CMD_HASH_FNV_PRIME  0x01000193u
+
+/* Registered command of every generated variant */
+static struct cmd_element **cmd_variant_bound;
+
+/* FNV-1a, the seed replaces the basis (must match gen_cmd_hash.py) */
+static uint32_t cmd_hash_fnv(uint32_t seed, const char *key, size_t len)
+{
+    uint32_t h = seed ? seed : CMD_HASH_FNV_BASIS;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (uint8_t)key[i];
+        h *= CMD_HASH_FNV_PRIME;
+    }
+    return h;
+}
+
+static const struct cmd_hash_entry *hash_lookup(const int32_t *g,
+                                                const struct cmd_hash_entry *entries,
+                                                int count, const char *key, size_t len)
+{
+    if (count == 0) {
+        return NULL;
+    }
+
+    int32_t d = g[cmd_hash_fnv(0, key, len) % (uint32_t)count];
+    uint32_t slot = d < 0 ? (uint32_t)(-d - 1) : cmd_hash_fnv((uint32_t)d, key, len) % (uint32_t)count;
+
+    const struct cmd_hash_entry *entry = &entries[slot];
+    if (strncmp(entry->key, key, len) != 0 || entry->key[len] != '\0') {
+        return NULL;
+    }
+    return entry;
+}
+
+static bool view_equal(const char *a, const char *b)
+{
+    return (!a && !b) || (a && b && strcmp(a, b) == 0);
+}
+
+/*
+ * Pick the variant for the current view: a matching view prefix wins
+ * over a view-independent variant, which wins over any other view.
+ * Variants without a registered command are skipped when bound is set.
+ */
+static int variant_select(const struct cmd_hash_entry *entry, const char *view, bool bound)
+{
+    int global = -1;
+    int other = -1;
+
+    for (int i = entry->variant; i < entry->variant + entry->variant_count; i++) {
+        if (bound && (!cmd_variant_bound || !cmd_variant_bound[i])) {
+            continue;
+        }
+        const char *v = cmd_variants[i].view;
+        if (v && view && strncmp(view, v, strlen(v)) == 0) {
+            return i;
+        }
+        if (!v && global < 0) {
+            global = i;
+        }
+        if (other < 0) {
+            other = i;
+        }
+    }
+
+    return global >= 0 ? global : other;
+}
+
+/*
+ * Bind a registered command to its generated variant.
+ * Returns -1 for commands missing from the generated tables.
+ */
+int cmd_hash_bind(struct cmd_element *cmd, const char *view)
+{
+    if (!cmd_variant_bound) {
+        cmd_variant_bound = calloc(cmd_variant_count ? cmd_variant_count : 1,
+                                   sizeof(*cmd_variant_bound));
+        if (!cmd_variant_bound) {
+            return -1;
+        }
+    }
+
+    const struct cmd_hash_entry *entry = hash_lookup(cmd_name_g, cmd_name_entries,
+                                                     cmd_name_count, cmd->name,
+                                                     strlen(cmd->name));
+    if (!entry) {
+        return -1;
+    }
+
+    for (int i = entry->variant; i < entry->variant + entry->variant_count; i++) {
+        if (view_equal(cmd_variants[i].view, view)) {
+            if (!cmd_variant_bound[i]) {
+                cmd_variant_bound[i] = cmd;
+            }
+            return 0;
+        }
+    }
+    return -1;
+}
+
+struct cmd_element *cmd_hash_find(const char *key, size_t len, const char *view,
+                                  uint32_t *flags)
+{
+    const struct cmd_hash_entry *entry = hash_lookup(cmd_name_g, cmd_name_entries,
+                                                     cmd_name_count, key, len);
+    if (!entry) {
+        return NULL;
+    }
+
+    int i = variant_select(entry, view, true);
+    if (i < 0) {
+        return NULL;
+    }
+    if (flags) {
+        *flags = entry->flags;
+    }
+    return cmd_variant_bound[i];
+}
+
+/*
+ * Resolve an alias to the canonical command registered in the view
+ * the alias belongs to.
+ */
+struct cmd_element *cmd_hash_find_alias(const char *key, size_t len, const char *view)
+{
+    const struct cmd_hash_entry *entry = hash_lookup(cmd_alias_g, cmd_alias_entries,
+                                                     cmd_alias_count, key, len);
+    if (!entry) {
+        return NULL;
+    }
+
+    int i = variant_select(entry, view, false);
+    const char *canonical = cmd_variants[i].canonical;
+    const struct cmd_hash_entry *name = hash_lookup(cmd_name_g, cmd_name_entries, cmd_name_count,
+                                                    canonical, strlen(canonical));
+    if (!name || !cmd_variant_bound) {
+        return NULL;
+    }
+
+    for (int j = name->variant; j < name->variant + name->variant_count; j++) {
+        if (view_equal(cmd_variants[j].view, cmd_variants[i].view)) {
+            return cmd_variant_bound[j];
+        }
+    }
+    return NULL;
+}
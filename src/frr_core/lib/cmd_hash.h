@@ -0,0 +1,51 @@
+/*
+ * Huawei VRP Style Command Hash Tables
+ * Copyright (C) 2026 WhiteBox NE Team
+ *
+ * Minimal perfect hash tables generated at build time by gen_cmd_hash.py
+ * from the cmd_element arrays. Names and Cisco-style aliases resolve in
+ * O(1) without building anything at startup; registration only binds
+ * each generated variant to its cmd_element.
+ */
+
+#ifndef _CMD_HASH_H
+#define _CMD_HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "huawei_cli.h"
+
+/* Entry flags */
+#define CMD_HASH_PREFIX     0x01    /* Name is the leading words of a longer name */
+
+/* Hash entry: a command name or an alias */
+struct cmd_hash_entry {
+    const char *key;
+    uint32_t flags;
+    uint16_t variant;           /* First variant index */
+    uint16_t variant_count;
+};
+
+/* Per-view variant of an entry */
+struct cmd_hash_variant {
+    const char *view;           /* View prefix, NULL for any view */
+    const char *canonical;      /* Canonical name, aliases only */
+};
+
+/* Generated data (cmd_hash_data.c) */
+extern const int cmd_hash_max_words;
+extern const int cmd_name_count;
+extern const int cmd_alias_count;
+extern const int cmd_variant_count;
+extern const int32_t cmd_name_g[];
+extern const int32_t cmd_alias_g[];
+extern const struct cmd_hash_entry cmd_name_entries[];
+extern const struct cmd_hash_entry cmd_alias_entries[];
+extern const struct cmd_hash_variant cmd_variants[];
+
+int cmd_hash_bind(struct cmd_element *cmd, const char *view);
+struct cmd_element *cmd_hash_find(const char *key, size_t len, const char *view,
+                                  uint32_t *flags);
+struct cmd_element *cmd_hash_find_alias(const char *key, size_t len, const char *view);
+
+#endif /* _CMD_HASH_H */
@@ -0,0 +1,274 @@
+/*
+ * Huawei VRP Style Command Token Trie
+ * Copyright (C) 2026 WhiteBox NE Team
+ *
+ * This module provides the command lookup structure including:
+ * - One trie level per command keyword, children sorted for binary search
+ * - Unique-prefix abbreviation of every keyword
+ * - Longest-match lookup, so "rule name" and "rule" coexist
+ * - Skipping of one argument between keywords ("peer <ip> description")
+ * - Per-view entries for names shared by several views ("router-id")
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "cmd_trie.h"
+
+/* Command registered at a trie node */
+struct cmd_trie_entry {
+    struct cmd_element *cmd;
+    const char *view;       /* View prefix, NULL for any view */
+};
+
+struct cmd_trie_node {
+    char *token;
+    struct cmd_trie_node **children;
+    int child_count;
+    int child_capacity;
+    struct cmd_trie_entry *entries;
+    int entry_count;
+};
+
+struct cmd_trie {
+    struct cmd_trie_node root;
+    int command_count;
+};
+
+/* Result of matching one input token against a node's children */
+enum child_match {
+    CHILD_NONE = 0,
+    CHILD_FOUND,
+    CHILD_AMBIGUOUS
+};
+
+struct cmd_trie *cmd_trie_new(void)
+{
+    return calloc(1, sizeof(struct cmd_trie));
+}
+
+static void node_free(struct cmd_trie_node *node)
+{
+    for (int i = 0; i < node->child_count; i++) {
+        node_free(node->children[i]);
+        free(node->children[i]);
+    }
+    free(node->children);
+    free(node->entries);
+    free(node->token);
+}
+
+void cmd_trie_free(struct cmd_trie *trie)
+{
+    if (trie) {
+        node_free(&trie->root);
+        free(trie);
+    }
+}
+
+int cmd_trie_count(const struct cmd_trie *trie)
+{
+    return trie->command_count;
+}
+
+/*
+ * First child whose keyword is not below the given token. Keywords the
+ * token abbreviates follow it contiguously, the exact keyword first.
+ */
+static int child_lower_bound(const struct cmd_trie_node *node, const char *token, size_t len)
+{
+    int lo = 0;
+    int hi = node->child_count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (strncmp(node->children[mid]->token, token, len) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static struct cmd_trie_node *node_child_insert(struct cmd_trie_node *node,
+                                               const char *token, size_t len)
+{
+    int pos = child_lower_bound(node, token, len);
+    if (pos < node->child_count) {
+        struct cmd_trie_node *child = node->children[pos];
+        if (strlen(child->token) == len && strncmp(child->token, token, len) == 0) {
+            return child;
+        }
+    }
+
+    if (node->child_count == node->child_capacity) {
+        int cap = node->child_capacity ? node->child_capacity * 2 : 4;
+        struct cmd_trie_node **children = realloc(node->children, cap * sizeof(*children));
+        if (!children) {
+            return NULL;
+        }
+        node->children = children;
+        node->child_capacity = cap;
+    }
+
+    struct cmd_trie_node *child = calloc(1, sizeof(*child));
+    if (!child) {
+        return NULL;
+    }
+    child->token = strndup(token, len);
+    if (!child->token) {
+        free(child);
+        return NULL;
+    }
+
+    memmove(&node->children[pos + 1], &node->children[pos],
+            (node->child_count - pos) * sizeof(*node->children));
+    node->children[pos] = child;
+    node->child_count++;
+    return child;
+}
+
+/*
+ * Insert a command under its name tokens.
+ * A name registered twice for the same view keeps the first handler.
+ */
+int cmd_trie_insert(struct cmd_trie *trie, struct cmd_element *cmd, const char *view)
+{
+    struct cmd_trie_node *node = &trie->root;
+    const char *p = cmd->name;
+
+    while (*p) {
+        while (*p == ' ') {
+            p++;
+        }
+        if (!*p) {
+            break;
+        }
+        size_t len = strcspn(p, " ");
+        node = node_child_insert(node, p, len);
+        if (!node) {
+            return -1;
+        }
+        p += len;
+    }
+
+    if (node == &trie->root) {
+        return -1;
+    }
+
+    for (int i = 0; i < node->entry_count; i++) {
+        const char *v = node->entries[i].view;
+        if ((!v && !view) || (v && view && strcmp(v, view) == 0)) {
+            return 1;
+        }
+    }
+
+    struct cmd_trie_entry *entries = realloc(node->entries,
+                                             (node->entry_count + 1) * sizeof(*entries));
+    if (!entries) {
+        return -1;
+    }
+    node->entries = entries;
+    node->entries[node->entry_count].cmd = cmd;
+    node->entries[node->entry_count].view = view;
+    node->entry_count++;
+    trie->command_count++;
+    return 0;
+}
+
+/*
+ * Match a token against the children of a node: exact keyword first,
+ * otherwise the unique keyword it abbreviates.
+ */
+static enum child_match node_child_match(const struct cmd_trie_node *node, const char *token,
+                                         struct cmd_trie_node **child)
+{
+    size_t len = strlen(token);
+    int pos = child_lower_bound(node, token, len);
+
+    if (pos >= node->child_count || strncmp(node->children[pos]->token, token, len) != 0) {
+        return CHILD_NONE;
+    }
+
+    *child = node->children[pos];
+    if (node->children[pos]->token[len] == '\0') {
+        return CHILD_FOUND;
+    }
+    if (pos + 1 < node->child_count &&
+        strncmp(node->children[pos + 1]->token, token, len) == 0) {
+        return CHILD_AMBIGUOUS;
+    }
+    return CHILD_FOUND;
+}
+
+/*
+ * Pick the entry for the current view: a matching view prefix wins over
+ * a view-independent entry, which wins over any other view.
+ */
+static struct cmd_element *node_select(const struct cmd_trie_node *node, const char *view)
+{
+    struct cmd_element *global = NULL;
+
+    for (int i = 0; i < node->entry_count; i++) {
+        const char *v = node->entries[i].view;
+        if (v && view && strncmp(view, v, strlen(v)) == 0) {
+            return node->entries[i].cmd;
+        }
+        if (!v && !global) {
+            global = node->entries[i].cmd;
+        }
+    }
+
+    return global ? global : node->entries[0].cmd;
+}
+
+/*
+ * Longest-match lookup. One argument token may sit between two keywords
+ * of the same command.
+ */
+void cmd_trie_lookup(const struct cmd_trie *trie, char **tokens, int token_count,
+                     const char *view, struct cmd_trie_match *match)
+{
+    const struct cmd_trie_node *node = &trie->root;
+    const struct cmd_trie_node *best = NULL;
+    int best_consumed = 0;
+    bool ambiguous = false;
+    int i = 0;
+
+    while (i < token_count) {
+        struct cmd_trie_node *child = NULL;
+        enum child_match m = node_child_match(node, tokens[i], &child);
+
+        if (m == CHILD_NONE && node != &trie->root && i + 1 < token_count) {
+            /* Skip one argument: "peer 10.1.1.1 description ..." */
+            m = node_child_match(node, tokens[i + 1], &child);
+            if (m == CHILD_FOUND) {
+                i++;
+            }
+        }
+
+        if (m != CHILD_FOUND) {
+            ambiguous = m == CHILD_AMBIGUOUS;
+            break;
+        }
+
+        node = child;
+        i++;
+        if (node->entry_count > 0) {
+            best = node;
+            best_consumed = i;
+        }
+    }
+
+    if (best) {
+        match->cmd = node_select(best, view);
+        match->consumed = best_consumed;
+        match->status = CMD_TRIE_OK;
+    } else {
+        match->cmd = NULL;
+        match->consumed = 0;
+        match->status = ambiguous ? CMD_TRIE_AMBIGUOUS : CMD_TRIE_NO_MATCH;
+    }
+}
@@ -0,0 +1,38 @@
+/*
+ * Huawei VRP Style Command Token Trie
+ * Copyright (C) 2026 WhiteBox NE Team
+ *
+ * Token trie compiled from the registered cmd_element tables. Lookup
+ * walks one node per input token, resolves VRP-style unique-prefix
+ * abbreviations ("dis cur") and returns the longest matching command.
+ */
+
+#ifndef _CMD_TRIE_H
+#define _CMD_TRIE_H
+
+#include "huawei_cli.h"
+
+/* Lookup status */
+enum cmd_trie_status {
+    CMD_TRIE_OK = 0,        /* Command matched */
+    CMD_TRIE_NO_MATCH,      /* No command matches the first token */
+    CMD_TRIE_AMBIGUOUS      /* An abbreviation matches several keywords */
+};
+
+/* Lookup result */
+struct cmd_trie_match {
+    struct cmd_element *cmd;
+    int consumed;           /* Tokens covered by the command name */
+    enum cmd_trie_status status;
+};
+
+struct cmd_trie;
+
+struct cmd_trie *cmd_trie_new(void);
+void cmd_trie_free(struct cmd_trie *trie);
+int cmd_trie_insert(struct cmd_trie *trie, struct cmd_element *cmd, const char *view);
+int cmd_trie_count(const struct cmd_trie *trie);
+void cmd_trie_lookup(const struct cmd_trie *trie, char **tokens, int token_count,
+                     const char *view, struct cmd_trie_match *match);
+
+#endif /* _CMD_TRIE_H */
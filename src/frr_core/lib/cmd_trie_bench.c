@@ -0,0 +1,283 @@
+/*
+ * Command Dispatcher Benchmark for Huawei VRP Style
+ * Copyright (C) 2026 WhiteBox NE Team
+ *
+ * This program measures command lookup throughput including:
+ * - Token trie lookup of full and abbreviated command lines
+ * - Linear longest-match scan over the command table for comparison
+ * - Abbreviation correctness of every generated line
+ *
+ * Usage: cmd_trie_bench [-n lines] [-s synthetic_commands]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+#include "cmd_trie.h"
+
+#define BENCH_LINE_SIZE     256
+#define BENCH_MAX_TOKENS    64
+
+/* Command names registered by the Huawei modules */
+static const char *bench_names[] = {
+    "aaa", "acl", "action", "add interface", "aggregate", "alarm", "apply dscp",
+    "apply ip-address default next-hop", "apply ip-address next-hop",
+    "apply ip-precedence", "apply output-interface", "area", "area-authentication-mode",
+    "authen-scheme", "authentication-mode", "bandwidth-reference", "bfd",
+    "bfd static-route", "bfd-session", "bgp", "boolean", "car", "classifier", "clear",
+    "clear configuration candidate", "clock", "command-echo", "commit",
+    "confederation id", "confederation peer-as", "configuration-mode", "controller",
+    "cpu-usage", "default-route-advertise", "delay", "deny", "description", "destination",
+    "destination-address", "destination-zone", "detect-multiplier", "diagnose",
+    "diagnose-view", "discriminator local", "display", "display aaa", "display acl",
+    "display bfd session", "display bfd statistics", "display bgp peer",
+    "display bgp routing-table", "display configuration candidate",
+    "display firewall zone", "display interface Vlanif",
+    "display interface sub-interface", "display interface tunnel",
+    "display ip routing-table protocol static", "display isis", "display isis lsdb",
+    "display isis peer", "display nat session", "display ospf",
+    "display policy-based-route", "display qos queue", "display qos statistics",
+    "display rip", "display rip database", "display security-policy", "display track",
+    "display traffic behavior", "display traffic classifier", "display traffic policy",
+    "display vlan", "display vrrp", "dns-proxy", "dns-resolve", "dns-server",
+    "dot1q termination vid", "echo-mode", "eth-trunk", "factory-configuration",
+    "filter-policy", "firewall zone", "gigabit-ethernet", "history-command",
+    "idle-timeout", "if-lb", "if-match acl", "if-match dscp", "if-match interface",
+    "if-match ip-address destination", "if-match ip-address source",
+    "if-match packet-length", "info-center", "interface", "interface Tunnel",
+    "interface Vlanif", "interface subif", "ip address", "ip policy-based-route",
+    "ip route", "ip route-static", "ip-domain", "ipv6", "ipv6 route-static", "is-level",
+    "isis", "isis circuit-type", "isis cost", "isis enable", "keepalive", "language",
+    "link-aggregation", "link-balance", "local-user", "local-user password",
+    "local-user privilege", "local-user service-type", "lock", "login-fail",
+    "login-retry", "loopback", "lsr", "memory-usage", "min-rx-interval",
+    "min-tx-interval", "mirror", "mirroring-link", "mpls", "nat outbound", "nat server",
+    "network", "network-entity", "nqa", "nssa", "ntp-service", "ospf", "packet-filter",
+    "password", "peek", "peer", "peer advertise-community", "peer description",
+    "peer password", "peer reflect-client", "peer route-policy", "performance", "policy",
+    "policy-based-route", "port", "port default vlan", "port link-type",
+    "port trunk allow-pass vlan", "port-group", "port-mirroring", "preempt-mode",
+    "priority", "qos", "qos queue-profile", "qos schedule", "qos-bwrr", "qos-car",
+    "qos-profile", "qos-queue", "qos-scheduler", "qos-wred", "qos-wrr", "queue", "quit",
+    "radius-server", "reboot", "redo", "remark dscp", "return", "rip", "router",
+    "router-id", "rsa", "rule", "rule name", "saved-configuration", "schedule",
+    "screen-length", "screen-width", "security-policy", "send-command", "service",
+    "session-type", "set priority", "set-overload-bit", "shell", "shell-user",
+    "silent-interface", "snmp", "snmp-agent", "source", "source-address", "source-zone",
+    "startup", "stub", "super", "super-password", "super3", "super3-password", "sysman",
+    "sysname", "system-view", "task-group", "timer advertise", "timezone", "track",
+    "track bfd-session", "track interface", "traffic behavior", "traffic classifier",
+    "traffic policy", "traffic-apply", "traffic-behavior", "traffic-policer",
+    "traffic-policy", "tunnel-protocol gre", "undo", "undo ip route-static", "undo isis",
+    "undo policy-based-route", "undo preempt-mode", "undo rip", "undo vlan", "unlock",
+    "user-interface", "user-profile", "user-view", "user-vty", "version", "virtual-ip",
+    "vlan", "vlink-peer", "vrrp vrid", "wred", "xg-forward",
+    NULL
+};
+
+static const char *bench_args[] = {
+    "10.1.1.1", "100", "GigabitEthernet0/0/1", "inbound", "255.255.255.0", "ef", "Vlanif10"
+};
+
+static struct cmd_element *bench_cmds;
+
+struct bench_line {
+    char text[BENCH_LINE_SIZE];
+    int cmd;                /* Expected command index */
+};
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int tokenize(char *line, char **tokens)
+{
+    int count = 0;
+    char *saveptr = NULL;
+    for (char *tok = strtok_r(line, " ", &saveptr); tok && count < BENCH_MAX_TOKENS;
+         tok = strtok_r(NULL, " ", &saveptr)) {
+        tokens[count++] = tok;
+    }
+    return count;
+}
+
+static int trie_lookup_line(const struct cmd_trie *trie, const char *text)
+{
+    char line[BENCH_LINE_SIZE];
+    char *tokens[BENCH_MAX_TOKENS];
+    struct cmd_trie_match match;
+
+    memcpy(line, text, BENCH_LINE_SIZE);
+    int count = tokenize(line, tokens);
+    cmd_trie_lookup(trie, tokens, count, NULL, &match);
+    return match.status == CMD_TRIE_OK ? (int)(match.cmd - bench_cmds) : -1;
+}
+
+/*
+ * Linear longest match over the command table, full keywords only.
+ * This is what a flat table scan costs per line.
+ */
+static int linear_lookup_line(struct cmd_element *cmds, int cmd_count, const char *text)
+{
+    int best = -1;
+    size_t best_len = 0;
+
+    for (int i = 0; i < cmd_count; i++) {
+        size_t len = strlen(cmds[i].name);
+        if (len > best_len && strncmp(text, cmds[i].name, len) == 0 &&
+            (text[len] == ' ' || text[len] == '\0')) {
+            best = i;
+            best_len = len;
+        }
+    }
+    return best;
+}
+
+/*
+ * Build an abbreviated form of a command line: every keyword is cut to
+ * a random prefix. Candidates the trie resolves to another command
+ * (not unique) fall back to the full keyword.
+ */
+static void abbreviate(const struct cmd_trie *trie, const char *name, const char *arg,
+                       int cmd, char *out)
+{
+    for (int attempt = 0; attempt < 4; attempt++) {
+        char buf[BENCH_LINE_SIZE];
+        size_t len = 0;
+        const char *p = name;
+
+        while (*p) {
+            size_t word = strcspn(p, " ");
+            size_t cut = 1 + (size_t)rand() % word;
+            len += (size_t)snprintf(buf + len, sizeof(buf) - len, "%s%.*s",
+                                    len ? " " : "", (int)cut, p);
+            p += word;
+            while (*p == ' ') {
+                p++;
+            }
+        }
+        snprintf(buf + len, sizeof(buf) - len, " %s", arg);
+
+        if (trie_lookup_line(trie, buf) == cmd) {
+            memcpy(out, buf, BENCH_LINE_SIZE);
+            return;
+        }
+    }
+    snprintf(out, BENCH_LINE_SIZE, "%s %s", name, arg);
+}
+
+int main(int argc, char *argv[])
+{
+    int line_count = 1000000;
+    int synthetic = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:s:")) != -1) {
+        switch (opt) {
+        case 'n':
+            line_count = atoi(optarg);
+            break;
+        case 's':
+            synthetic = atoi(optarg);
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-n lines] [-s synthetic_commands]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    int real_count = 0;
+    while (bench_names[real_count]) {
+        real_count++;
+    }
+
+    int cmd_count = real_count + synthetic;
+    struct cmd_element *cmds = calloc(cmd_count, sizeof(*cmds));
+    char (*synthetic_names)[64] = calloc(synthetic ? synthetic : 1, 64);
+    struct bench_line *lines = malloc((size_t)line_count * sizeof(*lines));
+    struct bench_line *full = malloc((size_t)line_count * sizeof(*full));
+    struct cmd_trie *trie = cmd_trie_new();
+    bench_cmds = cmds;
+    if (!cmds || !synthetic_names || !lines || !full || !trie) {
+        fprintf(stderr, "Error: Out of memory\n");
+        return 1;
+    }
+
+    for (int i = 0; i < cmd_count; i++) {
+        if (i < real_count) {
+            cmds[i].name = bench_names[i];
+        } else {
+            snprintf(synthetic_names[i - real_count], 64, "feature-%d option-%d",
+                     (i - real_count) / 8, (i - real_count) % 8);
+            cmds[i].name = synthetic_names[i - real_count];
+        }
+        cmd_trie_insert(trie, &cmds[i], NULL);
+    }
+
+    srand(1);
+    for (int i = 0; i < line_count; i++) {
+        int cmd = rand() % cmd_count;
+        const char *arg = bench_args[rand() % (sizeof(bench_args) / sizeof(bench_args[0]))];
+        snprintf(full[i].text, BENCH_LINE_SIZE, "%s %s", cmds[cmd].name, arg);
+        full[i].cmd = cmd;
+        abbreviate(trie, cmds[cmd].name, arg, cmd, lines[i].text);
+        lines[i].cmd = cmd;
+    }
+
+    printf("Command lookup benchmark: %d commands, %d lines\n\n",
+           cmd_trie_count(trie), line_count);
+    printf("%-28s %12s %14s %10s\n", "Method", "Time (s)", "Lines/sec", "Errors");
+
+    /* Linear scan, full keywords */
+    int errors = 0;
+    double start = now_sec();
+    for (int i = 0; i < line_count; i++) {
+        int cmd = linear_lookup_line(cmds, cmd_count, full[i].text);
+        if (strcmp(cmds[cmd < 0 ? 0 : cmd].name, cmds[full[i].cmd].name) != 0) {
+            errors++;
+        }
+    }
+    double linear = now_sec() - start;
+    printf("%-28s %12.3f %14.0f %10d\n", "linear scan (full)", linear,
+           line_count / linear, errors);
+
+    /* Trie, full keywords */
+    errors = 0;
+    start = now_sec();
+    for (int i = 0; i < line_count; i++) {
+        if (trie_lookup_line(trie, full[i].text) != full[i].cmd) {
+            errors++;
+        }
+    }
+    double trie_full = now_sec() - start;
+    printf("%-28s %12.3f %14.0f %10d\n", "trie (full)", trie_full,
+           line_count / trie_full, errors);
+
+    /* Trie, abbreviated keywords */
+    errors = 0;
+    start = now_sec();
+    for (int i = 0; i < line_count; i++) {
+        if (trie_lookup_line(trie, lines[i].text) != lines[i].cmd) {
+            errors++;
+        }
+    }
+    double trie_abbr = now_sec() - start;
+    printf("%-28s %12.3f %14.0f %10d\n", "trie (abbreviated)", trie_abbr,
+           line_count / trie_abbr, errors);
+
+    printf("\nSpeedup over linear scan: %.1fx\n", linear / trie_full);
+
+    cmd_trie_free(trie);
+    free(full);
+    free(lines);
+    free(synthetic_names);
+    free(cmds);
+    return 0;
+}
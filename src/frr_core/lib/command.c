@@ -10,20 +10,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
-
-/* Command structure */
-struct cmd_element {
-  const char *name;
-  int (*func)(struct cmd_element *, struct cmd_args *);
-  const char *alias;
-  const char *help;
-};
-
-/* Arguments structure */
-struct cmd_args {
-  int argc;
-  char **argv;
-};
+#include "huawei_cli.h"
 
 /*
  * Complete Huawei VRP Command Table - System View Commands
@@ -65,7 +52,7 @@ struct cmd_element system_view_commands[] = {
   { .name = "link-aggregation", .func = NULL, .alias = NULL, .help = "Link aggregation" },
   { .name = "port", .func = NULL, .alias = NULL, .help = "Enter port config" },
   { .name = "port-group", .func = NULL, .alias = NULL, .help = "Enter port-group config" },
-  {name = NULL, .func = NULL, .alias = NULL, .help = NULL}
+  { .name = NULL, .func = NULL, .alias = NULL, .help = NULL }
 };
 
 /*
@@ -85,15 +72,12 @@ struct cmd_element config_commands[] = {
   { .name = "authen-scheme", .func = NULL, .alias = NULL, .help = "Set authentication scheme" },
   { .name = "login-retry", .func = NULL, .alias = NULL, .help = "Set login retry count" },
   { .name = "login-fail", .func = NULL, .alias = NULL, .help = "Set login failure count" },
-  { .name = "idle-timeout", .func = NULL, .alias = NULL, .help = "Set idle timeout" },
   { .name = "screen-width", .func = NULL, .alias = NULL, .help = "Set screen width" },
-  { .name = "screen-length", .func = NULL, .alias = NULL, .help = "Set screen length" },
   { .name = "history-command", .func = NULL, .alias = NULL, .help = "Set history command" },
   { .name = "command-echo", .func = NULL, .alias = NULL, .help = "Enable command echo" },
   { .name = "sysman", .func = NULL, .alias = NULL, .help = "Configure system manager" },
   { .name = "info-center", .func = NULL, .alias = NULL, .help = "Enable info center" },
   { .name = "ipv6", .func = NULL, .alias = NULL, .help = "Enable IPv6" },
-  { .name = "undo", .func = NULL, .alias = NULL, .help = "Enable undo buffer" },
   { .name = "alarm", .func = NULL, .alias = NULL, .help = "Enter alarm configuration" },
   { .name = "snmp-agent", .func = NULL, .alias = NULL, .help = "Enter SNMP agent config" },
   { .name = "snmp", .func = NULL, .alias = NULL, .help = "Enter SNMP configuration" },
@@ -104,8 +88,6 @@ struct cmd_element config_commands[] = {
   { .name = "dns-proxy", .func = NULL, .alias = NULL, .help = "Configure DNS proxy" },
   { .name = "cpu-usage", .func = NULL, .alias = NULL, .help = "Configure CPU usage" },
   { .name = "memory-usage", .func = NULL, .alias = NULL, .help = "Configure memory usage" },
-  { .name = "port-group", .func = NULL, .alias = NULL, .help = "Enter port-group config" },
-  { .name = "vlan", .func = NULL, .alias = NULL, .help = "Enter VLAN config" },
   { .name = "loopback", .func = NULL, .alias = NULL, .help = "Enter loopback config" },
   { .name = "eth-trunk", .func = NULL, .alias = NULL, .help = "Enter Ethernet config" },
   { .name = "gigabit-ethernet", .func = NULL, .alias = NULL, .help = "Enter GigabitEthernet config" },
@@ -129,7 +111,6 @@ struct cmd_element config_commands[] = {
   { .name = "packet-filter", .func = NULL, .alias = NULL, .help = "Enter packet filter config" },
   { .name = "user-profile", .func = NULL, .alias = NULL, .help = "Enter user profile config" },
   { .name = "task-group", .func = NULL, .alias = NULL, .help = "Enter task group config" },
-  { .name = "schedule", .func = NULL, .alias = NULL, .help = "Enter schedule config" },
   { .name = "performance", .func = NULL, .alias = NULL, .help = "Enter performance config" },
   { .name = "link-balance", .func = NULL, .alias = NULL, .help = "Enter link balance config" },
   { .name = "if-lb", .func = NULL, .alias = NULL, .help = "Enter IF-LB config" },
@@ -139,9 +120,18 @@ struct cmd_element config_commands[] = {
   { .name = "isis", .func = NULL, .alias = "router isis", .help = "Enter IS-IS configuration" },
   { .name = "rip", .func = NULL, .alias = "router rip", .help = "Enter RIP configuration" },
   { .name = "policy", .func = NULL, .alias = NULL, .help = "Enter policy configuration" },
-  {name = NULL, .func = NULL, .alias = NULL, .help = NULL}
+  { .name = NULL, .func = NULL, .alias = NULL, .help = NULL }
 };
 
+/*
+ * Register system and configuration commands with the dispatcher
+ */
+void register_huawei_system_cmds(void) {
+  printf("Registering system commands...\n");
+  huawei_cli_register_table(system_view_commands, NULL);
+  huawei_cli_register_table(config_commands, NULL);
+}
+
 /*
  * Total Command Statistics
  */
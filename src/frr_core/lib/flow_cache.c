@@ -0,0 +1,460 @@
+/*
+ * Exact-Match Flow Cache
+ * Copyright (C) 2026 WhiteBox NE Team
+ *
+ * This module provides the per-core flow cache including:
+ * - Signature buckets of four slots, two candidate buckets per key; the
+ *   second is derived from the first and the signature, so an entry can
+ *   be moved to its other bucket without its key
+ * - Generation tags in place of flushes: stale slots miss and are
+ *   reused by the next insert
+ * - Insert into a free or stale slot, else one cuckoo move to make room,
+ *   else eviction of a current entry in round robin
+ * - Bypass while the flow set thrashes the cache, decided per window of
+ *   lookups from its hits and evictions
+ * - A registry of live caches for the statistics display
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <time.h>
+#include "huawei_cli.h"
+#include "pcpu_stats.h"
+#include "flow_cache.h"
+
+#define FLOW_CACHE_MIN          64
+
+/* Slot contents; the signature lives in the bucket */
+struct flow_entry {
+    struct flow_key key;
+    uint64_t generation;
+    struct flow_value value;
+};
+
+/* Signatures of one bucket, 0 for an empty slot */
+struct flow_bucket {
+    uint16_t sig[FLOW_CACHE_WAYS];
+};
+
+struct flow_cache {
+    struct flow_bucket *buckets;
+    struct flow_entry *entries;     /* FLOW_CACHE_WAYS per bucket */
+    uint32_t mask;                  /* Buckets - 1 */
+    uint32_t victim;                /* Round-robin eviction way */
+    uint32_t window;                /* Lookups left in the current window */
+    uint32_t window_hits;
+    uint32_t window_evictions;
+    uint32_t bypass;                /* Windows left to bypass, 0 when caching */
+    struct flow_cache_stats stats;  /* Written by the owner only */
+    struct flow_cache_stats base;   /* Totals at the last reset, under registry_lock */
+};
+
+uint64_t flow_cache_gen = 1;
+
+static pthread_mutex_t registry_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct flow_cache *registry[FLOW_CACHE_MAX];
+static struct flow_cache_stats retired;    /* Destroyed caches since the last reset */
+
+static uint64_t flow_hash(const struct flow_key *key)
+{
+    uint64_t h = (uint64_t)key->src_ip * 0x9e3779b97f4a7c15ull;
+
+    h ^= (uint64_t)key->dst_ip * 0xc2b2ae3d27d4eb4full;
+    h ^= (((uint64_t)key->src_port << 16) | key->dst_port) * 0x165667b19e3779f9ull;
+    h ^= (((uint64_t)key->protocol << 32) | key->ifid) * 0xd6e8feb86659fd93ull;
+    h ^= h >> 32;
+    h *= 0x9e3779b97f4a7c15ull;
+    return h ^ (h >> 29);
+}
+
+static inline uint16_t flow_sig(uint64_t hash)
+{
+    uint16_t sig = (uint16_t)(hash >> 48);
+    return sig ? sig : 1;
+}
+
+/* The other bucket of a signature; applying it twice gives the first back */
+static inline uint32_t flow_alt(const struct flow_cache *cache, uint32_t bucket, uint16_t sig)
+{
+    return (bucket ^ (sig * 0x5bd1e995u)) & cache->mask;
+}
+
+static inline bool flow_key_equal(const struct flow_key *a, const struct flow_key *b)
+{
+    return a->src_ip == b->src_ip && a->dst_ip == b->dst_ip && a->src_port == b->src_port &&
+           a->dst_port == b->dst_port && a->protocol == b->protocol && a->ifid == b->ifid;
+}
+
+/*
+ * Create a cache of at least the given number of slots, rounded up to
+ * a power of two. The caller owns it and must be its only user.
+ */
+struct flow_cache *flow_cache_create(uint32_t entries)
+{
+    struct flow_cache *cache = calloc(1, sizeof(*cache));
+    uint32_t buckets = FLOW_CACHE_MIN / FLOW_CACHE_WAYS;
+
+    if (!cache) {
+        return NULL;
+    }
+    while (buckets * FLOW_CACHE_WAYS < entries && buckets < (1u << 26)) {
+        buckets <<= 1;
+    }
+    cache->buckets = aligned_alloc(64, buckets * sizeof(struct flow_bucket));
+    cache->entries = aligned_alloc(64, (size_t)buckets * FLOW_CACHE_WAYS * sizeof(struct flow_entry));
+    if (!cache->buckets || !cache->entries) {
+        free(cache->buckets);
+        free(cache->entries);
+        free(cache);
+        return NULL;
+    }
+    memset(cache->buckets, 0, buckets * sizeof(struct flow_bucket));
+    cache->mask = buckets - 1;
+    cache->window = FLOW_CACHE_WINDOW;
+    cache->stats.caches = 1;
+    cache->stats.entries = buckets * FLOW_CACHE_WAYS;
+
+    pthread_mutex_lock(&registry_lock);
+    for (int i = 0; i < FLOW_CACHE_MAX; i++) {
+        if (!registry[i]) {
+            registry[i] = cache;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&registry_lock);
+    return cache;
+}
+
+static void stats_add(struct flow_cache_stats *sum, const struct flow_cache_stats *s,
+                      const struct flow_cache_stats *base)
+{
+    sum->lookups += __atomic_load_n(&s->lookups, __ATOMIC_RELAXED) - base->lookups;
+    sum->hits += __atomic_load_n(&s->hits, __ATOMIC_RELAXED) - base->hits;
+    sum->misses += __atomic_load_n(&s->misses, __ATOMIC_RELAXED) - base->misses;
+    sum->stale += __atomic_load_n(&s->stale, __ATOMIC_RELAXED) - base->stale;
+    sum->inserts += __atomic_load_n(&s->inserts, __ATOMIC_RELAXED) - base->inserts;
+    sum->evictions += __atomic_load_n(&s->evictions, __ATOMIC_RELAXED) - base->evictions;
+    sum->bypassed += __atomic_load_n(&s->bypassed, __ATOMIC_RELAXED) - base->bypassed;
+    sum->samples += __atomic_load_n(&s->samples, __ATOMIC_RELAXED) - base->samples;
+    sum->latency_ns += __atomic_load_n(&s->latency_ns, __ATOMIC_RELAXED) - base->latency_ns;
+}
+
+void flow_cache_destroy(struct flow_cache *cache)
+{
+    if (!cache) {
+        return;
+    }
+
+    pthread_mutex_lock(&registry_lock);
+    for (int i = 0; i < FLOW_CACHE_MAX; i++) {
+        if (registry[i] == cache) {
+            registry[i] = NULL;
+            stats_add(&retired, &cache->stats, &cache->base);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&registry_lock);
+
+    free(cache->buckets);
+    free(cache->entries);
+    free(cache);
+}
+
+/*
+ * Make every cached decision stale. Call after publishing the ACL or
+ * classifier change, and tag compiled programs with the value returned.
+ */
+uint64_t flow_cache_invalidate(void)
+{
+    return __atomic_add_fetch(&flow_cache_gen, 1, __ATOMIC_ACQ_REL);
+}
+
+/* Slot of the key in a bucket, -1 if absent; the generation is not checked */
+static inline int bucket_find(const struct flow_cache *cache, uint32_t bucket, uint16_t sig,
+                              const struct flow_key *key)
+{
+    const struct flow_bucket *b = &cache->buckets[bucket];
+
+    for (int way = 0; way < FLOW_CACHE_WAYS; way++) {
+        if (b->sig[way] == sig &&
+            flow_key_equal(&cache->entries[bucket * FLOW_CACHE_WAYS + way].key, key)) {
+            return (int)(bucket * FLOW_CACHE_WAYS + way);
+        }
+    }
+    return -1;
+}
+
+static inline int cache_find(const struct flow_cache *cache, const struct flow_key *key,
+                             uint64_t hash)
+{
+    uint16_t sig = flow_sig(hash);
+    uint32_t bucket = (uint32_t)hash & cache->mask;
+    int slot = bucket_find(cache, bucket, sig, key);
+
+    if (slot < 0) {
+        slot = bucket_find(cache, flow_alt(cache, bucket, sig), sig, key);
+    }
+    return slot;
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/*
+ * End of a window of lookups: bypass the cache when it hit less than
+ * FLOW_CACHE_BYPASS_PCT and at least half of its misses evicted a current
+ * entry, i.e. the flows do not fit rather than the cache being cold.
+ */
+static void window_end(struct flow_cache *cache)
+{
+    uint32_t misses = FLOW_CACHE_WINDOW - cache->window_hits;
+
+    if (cache->bypass > 0) {
+        cache->bypass--;
+    } else if (cache->window_hits * 100 < FLOW_CACHE_WINDOW * FLOW_CACHE_BYPASS_PCT &&
+               cache->window_evictions * 2 >= misses) {
+        cache->bypass = FLOW_CACHE_BYPASS_WINDOWS;
+    }
+    cache->window = FLOW_CACHE_WINDOW;
+    cache->window_hits = 0;
+    cache->window_evictions = 0;
+}
+
+/*
+ * Cached decision for a key, NULL on a miss. Entries of another
+ * generation miss, and every key misses while the cache is bypassed.
+ * The result is valid until the next insert.
+ */
+const struct flow_value *flow_cache_lookup(struct flow_cache *cache, const struct flow_key *key,
+                                           uint64_t generation)
+{
+    struct flow_cache_stats *stats = &cache->stats;
+    uint64_t start = 0;
+    int slot;
+
+    pcpu_store_add(&stats->lookups, 1);
+    if (--cache->window == 0) {
+        window_end(cache);
+    }
+    if (cache->bypass > 0) {
+        pcpu_store_add(&stats->bypassed, 1);
+        pcpu_store_add(&stats->misses, 1);
+        return NULL;
+    }
+    if (__builtin_expect((stats->lookups & (FLOW_CACHE_SAMPLE - 1)) == 0, 0)) {
+        start = now_ns();
+    }
+
+    slot = cache_find(cache, key, flow_hash(key));
+
+    if (__builtin_expect(start != 0, 0)) {
+        uint64_t ns = now_ns() - start;
+        pcpu_store_add(&stats->samples, 1);
+        pcpu_store_add(&stats->latency_ns, ns);
+        if (ns > stats->latency_max_ns) {
+            __atomic_store_n(&stats->latency_max_ns, ns, __ATOMIC_RELAXED);
+        }
+    }
+
+    if (slot >= 0 && cache->entries[slot].generation == generation) {
+        cache->window_hits++;
+        pcpu_store_add(&stats->hits, 1);
+        return &cache->entries[slot].value;
+    }
+    if (slot >= 0) {
+        pcpu_store_add(&stats->stale, 1);
+    }
+    pcpu_store_add(&stats->misses, 1);
+    return NULL;
+}
+
+/* Way of a bucket that is empty or holds an entry of another generation */
+static inline int bucket_free(const struct flow_cache *cache, uint32_t bucket, uint64_t generation)
+{
+    const struct flow_bucket *b = &cache->buckets[bucket];
+
+    for (int way = 0; way < FLOW_CACHE_WAYS; way++) {
+        if (b->sig[way] == 0 ||
+            cache->entries[bucket * FLOW_CACHE_WAYS + way].generation != generation) {
+            return way;
+        }
+    }
+    return -1;
+}
+
+/*
+ * Move one current entry of a full bucket to a free way of its other
+ * bucket. Returns the way freed, -1 if no entry can move.
+ */
+static int bucket_make_room(struct flow_cache *cache, uint32_t bucket, uint64_t generation)
+{
+    struct flow_bucket *b = &cache->buckets[bucket];
+
+    for (int way = 0; way < FLOW_CACHE_WAYS; way++) {
+        uint32_t alt = flow_alt(cache, bucket, b->sig[way]);
+        int to = alt != bucket ? bucket_free(cache, alt, generation) : -1;
+        if (to >= 0) {
+            cache->entries[alt * FLOW_CACHE_WAYS + to] = cache->entries[bucket * FLOW_CACHE_WAYS + way];
+            cache->buckets[alt].sig[to] = b->sig[way];
+            return way;
+        }
+    }
+    return -1;
+}
+
+/*
+ * Store the decision for a key, tagged with the generation it was taken
+ * under. Replaces an entry of the same key. Dropped while bypassed.
+ */
+void flow_cache_insert(struct flow_cache *cache, const struct flow_key *key, uint64_t generation,
+                       const struct flow_value *value)
+{
+    if (cache->bypass > 0) {
+        return;
+    }
+
+    uint64_t hash = flow_hash(key);
+    uint16_t sig = flow_sig(hash);
+    uint32_t bucket = (uint32_t)hash & cache->mask;
+    int slot = cache_find(cache, key, hash);
+
+    if (slot < 0) {
+        uint32_t alt = flow_alt(cache, bucket, sig);
+        int way = bucket_free(cache, bucket, generation);
+        if (way < 0 && (way = bucket_free(cache, alt, generation)) >= 0) {
+            bucket = alt;
+        }
+        if (way < 0) {
+            way = bucket_make_room(cache, bucket, generation);
+        }
+        if (way < 0) {
+            way = (int)(cache->victim++ % FLOW_CACHE_WAYS);
+            cache->window_evictions++;
+            pcpu_store_add(&cache->stats.evictions, 1);
+        }
+        slot = (int)(bucket * FLOW_CACHE_WAYS + (uint32_t)way);
+        cache->buckets[bucket].sig[way] = sig;
+        cache->entries[slot].key = *key;
+    }
+    cache->entries[slot].generation = generation;
+    cache->entries[slot].value = *value;
+    pcpu_store_add(&cache->stats.inserts, 1);
+}
+
+/* Counters of one cache since the last reset */
+void flow_cache_stats(const struct flow_cache *cache, struct flow_cache_stats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    stats->caches = 1;
+    stats->entries = cache->stats.entries;
+    pthread_mutex_lock(&registry_lock);
+    stats_add(stats, &cache->stats, &cache->base);
+    pthread_mutex_unlock(&registry_lock);
+    stats->latency_max_ns = __atomic_load_n(&cache->stats.latency_max_ns, __ATOMIC_RELAXED);
+}
+
+/* Counters summed over every cache, including destroyed ones */
+void flow_cache_stats_total(struct flow_cache_stats *stats)
+{
+    static const struct flow_cache_stats zero;
+
+    memset(stats, 0, sizeof(*stats));
+    pthread_mutex_lock(&registry_lock);
+    stats_add(stats, &retired, &zero);
+    for (int i = 0; i < FLOW_CACHE_MAX; i++) {
+        struct flow_cache *cache = registry[i];
+        if (!cache) {
+            continue;
+        }
+        uint64_t max = __atomic_load_n(&cache->stats.latency_max_ns, __ATOMIC_RELAXED);
+        stats->caches++;
+        stats->entries += cache->stats.entries;
+        stats_add(stats, &cache->stats, &cache->base);
+        if (max > stats->latency_max_ns) {
+            stats->latency_max_ns = max;
+        }
+    }
+    pthread_mutex_unlock(&registry_lock);
+}
+
+/*
+ * Zero the displayed counters. The owners keep counting; the current
+ * totals become the baseline. The latency maximum is kept.
+ */
+void flow_cache_stats_reset(void)
+{
+    pthread_mutex_lock(&registry_lock);
+    memset(&retired, 0, sizeof(retired));
+    for (int i = 0; i < FLOW_CACHE_MAX; i++) {
+        struct flow_cache *cache = registry[i];
+        if (!cache) {
+            continue;
+        }
+        memset(&cache->base, 0, sizeof(cache->base));
+        stats_add(&cache->base, &cache->stats, &cache->base);
+    }
+    pthread_mutex_unlock(&registry_lock);
+}
+
+/*
+ * Display flow cache statistics
+ * Command: display flow-cache statistics
+ */
+static int cmd_display_flow_cache_statistics(struct cmd_element *cmd, struct cmd_args *args)
+{
+    struct flow_cache_stats s;
+
+    flow_cache_stats_total(&s);
+    printf("Flow cache statistics:\n");
+    printf("  Caches: %u, %u entries, generation %lu\n", s.caches, s.entries,
+           (unsigned long)flow_cache_generation());
+    printf("  Lookups: %lu\n", (unsigned long)s.lookups);
+    printf("  Hits: %lu (%.1f%%)\n", (unsigned long)s.hits,
+           s.lookups ? s.hits * 100.0 / s.lookups : 0.0);
+    printf("  Misses: %lu, %lu of them stale\n", (unsigned long)s.misses, (unsigned long)s.stale);
+    printf("  Inserts: %lu, evictions: %lu\n", (unsigned long)s.inserts,
+           (unsigned long)s.evictions);
+    printf("  Bypassed: %lu lookups (flows outgrew the cache)\n", (unsigned long)s.bypassed);
+    if (s.samples > 0) {
+        printf("  Lookup latency: avg %lu ns, max %lu ns (%lu samples)\n",
+               (unsigned long)(s.latency_ns / s.samples), (unsigned long)s.latency_max_ns,
+               (unsigned long)s.samples);
+    }
+    return 0;
+}
+
+/*
+ * Reset flow cache statistics
+ * Command: reset flow-cache statistics
+ */
+static int cmd_reset_flow_cache_statistics(struct cmd_element *cmd, struct cmd_args *args)
+{
+    flow_cache_stats_reset();
+    printf("Flow cache statistics cleared\n");
+    return 0;
+}
+
+/* Command registration */
+struct cmd_element flow_cache_cmds[] = {
+    HUAWEI_CMD_WITH_CATEGORY("display flow-cache statistics", cmd_display_flow_cache_statistics,
+                             NULL, "Display flow cache hit rate, evictions and latency",
+                             CMD_CAT_MONITOR),
+    HUAWEI_CMD_WITH_CATEGORY("reset flow-cache statistics", cmd_reset_flow_cache_statistics, NULL,
+                             "Clear flow cache statistics", CMD_CAT_MONITOR),
+    { .name = NULL }
+};
+
+/* Register flow cache commands */
+void register_flow_cache_cmds(void)
+{
+    printf("Registering flow cache commands...\n");
+    huawei_cli_register_table(flow_cache_cmds, NULL);
+}
@@ -0,0 +1,119 @@
+/*
+ * Exact-Match Flow Cache
+ * Copyright (C) 2026 WhiteBox NE Team
+ *
+ * Per-core cache of datapath decisions keyed by 5-tuple and receiving
+ * interface, in front of ACL and classifier evaluation. Long-lived flows
+ * hit the same decision for every packet; the cache answers them with
+ * one hash probe instead of a rule lookup.
+ *
+ * - Each datapath thread creates its own cache, written and read by that
+ *   thread only; no locks and no atomics on the fast path
+ * - Buckets of FLOW_CACHE_WAYS slots with a 16-bit signature per slot in
+ *   one cache line; a key has two candidate buckets, cuckoo style, and a
+ *   lookup compares full keys only where a signature matches
+ * - Entries are tagged with a generation. Configuration writers bump the
+ *   global generation with flow_cache_invalidate() after an ACL or
+ *   classifier change; entries of an older generation miss and their
+ *   slots are reused, so invalidation never walks the caches
+ * - A cache whose working set outgrows it bypasses itself: when a window
+ *   of lookups hits less than FLOW_CACHE_BYPASS_PCT and its misses
+ *   mostly evict current entries, lookups miss without probing and
+ *   inserts are dropped for FLOW_CACHE_BYPASS_WINDOWS windows, then one
+ *   window probes again. Cold and freshly invalidated caches miss
+ *   without evicting and stay on
+ * - Hits, misses, stale entries, evictions, bypassed lookups and sampled
+ *   lookup latency per cache, summed over all caches for display
+ */
+
+#ifndef _FLOW_CACHE_H
+#define _FLOW_CACHE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "if_registry.h"
+
+#define FLOW_CACHE_WAYS         4       /* Slots per bucket */
+#define FLOW_CACHE_MAX          64      /* Caches summed by flow_cache_stats_total() */
+#define FLOW_CACHE_SAMPLE       1024    /* Lookups per latency sample */
+#define FLOW_CACHE_WINDOW       4096    /* Lookups per bypass decision */
+#define FLOW_CACHE_BYPASS_PCT   50      /* Hit rate a thrashing window must reach */
+#define FLOW_CACHE_BYPASS_WINDOWS 64    /* Windows bypassed before probing again */
+
+/* ACL verdict of a cached decision */
+enum {
+    FLOW_ACL_NONE = 0,          /* No ACL applies or no rule matched */
+    FLOW_ACL_PERMIT,
+    FLOW_ACL_DENY,
+};
+
+/* Flow key, addresses in host byte order */
+struct flow_key {
+    uint32_t src_ip;
+    uint32_t dst_ip;
+    uint16_t src_port;
+    uint16_t dst_port;
+    uint8_t protocol;
+    ifid_t ifid;                /* Receiving interface */
+};
+
+/* Cached decision */
+struct flow_value {
+    uint8_t acl_verdict;        /* FLOW_ACL_* */
+    int32_t acl_rule;           /* Rule ID that decided, -1 for none */
+    int16_t classifier;         /* Matching classifier of the program, -1 for none */
+    int16_t rule;               /* Policy rule it selects, naming the behavior; -1 for none */
+};
+
+/* Counters of one cache, or of all of them */
+struct flow_cache_stats {
+    uint32_t caches;
+    uint32_t entries;           /* Slots */
+    uint64_t lookups;
+    uint64_t hits;
+    uint64_t misses;            /* Including stale */
+    uint64_t stale;             /* Key found with an older generation */
+    uint64_t inserts;
+    uint64_t evictions;         /* Current entries displaced by an insert */
+    uint64_t bypassed;          /* Lookups answered as misses without probing */
+    uint64_t samples;           /* Timed lookups */
+    uint64_t latency_ns;        /* Sum over the timed lookups */
+    uint64_t latency_max_ns;
+};
+
+struct flow_cache;
+
+extern uint64_t flow_cache_gen;
+
+/*
+ * Generation to tag this batch's lookups with. Read it before loading
+ * the configuration the batch decides with.
+ */
+static inline uint64_t flow_cache_generation(void)
+{
+    return __atomic_load_n(&flow_cache_gen, __ATOMIC_ACQUIRE);
+}
+
+/*
+ * Tag for decisions that also depend on a compiled program stamped with
+ * flow_cache_invalidate() when it was built: a new program misses even
+ * in a batch that read the generation before it was published.
+ */
+static inline uint64_t flow_cache_tag(uint64_t generation, uint64_t program)
+{
+    return generation << 32 ^ (program & 0xffffffffu);
+}
+
+struct flow_cache *flow_cache_create(uint32_t entries);
+void flow_cache_destroy(struct flow_cache *cache);
+uint64_t flow_cache_invalidate(void);
+const struct flow_value *flow_cache_lookup(struct flow_cache *cache, const struct flow_key *key,
+                                           uint64_t generation);
+void flow_cache_insert(struct flow_cache *cache, const struct flow_key *key, uint64_t generation,
+                       const struct flow_value *value);
+void flow_cache_stats(const struct flow_cache *cache, struct flow_cache_stats *stats);
+void flow_cache_stats_total(struct flow_cache_stats *stats);
+void flow_cache_stats_reset(void);
+void register_flow_cache_cmds(void);
+
+#endif /* _FLOW_CACHE_H */
@@ -0,0 +1,313 @@
+#!/usr/bin/env python3
+"""
+WhiteBox NE Command Hash Generator
+
+Builds minimal perfect hash tables from the cmd_element arrays of the
+Huawei-style command modules and writes them as constant C data:
+
+- Name table: every command name with its per-view variants
+- Alias table: every Cisco-style alias mapped to its canonical name
+- Build failure on a name registered twice in the same view
+
+Views are taken from the huawei_cli_register_table() calls of each module.
+
+Usage: gen_cmd_hash.py -o cmd_hash_data.c source.c [source.c ...]
+
+Author: WhiteBox NE Team
+"""
+
+import os
+import re
+import sys
+
+FNV_PRIME = 0x01000193
+FNV_BASIS = 0x811c9dc5
+
+TABLE_RE = re.compile(r'struct\s+cmd_element\s+(\w+)\s*\[\s*\]\s*=\s*\{')
+REGISTER_RE = re.compile(r'huawei_cli_register_table\s*\(\s*(\w+)\s*,\s*(NULL|"[^"]*")\s*\)')
+STRING_RE = re.compile(r'"((?:[^"\\]|\\.)*)"')
+
+
+def fnv_hash(seed, key):
+    """FNV-1a variant used by cmd_hash.c: the seed replaces the basis."""
+    h = seed if seed else FNV_BASIS
+    for byte in key.encode():
+        h = ((h ^ byte) * FNV_PRIME) & 0xffffffff
+    return h
+
+
+def split_args(text):
+    """Split a comma-separated initializer at depth 0."""
+    args = []
+    depth = 0
+    current = ''
+    in_string = False
+    i = 0
+    while i < len(text):
+        c = text[i]
+        if in_string:
+            current += c
+            if c == '\\':
+                current += text[i + 1]
+                i += 1
+            elif c == '"':
+                in_string = False
+        elif c == '"':
+            in_string = True
+            current += c
+        elif c in '({':
+            depth += 1
+            current += c
+        elif c in ')}':
+            depth -= 1
+            current += c
+        elif c == ',' and depth == 0:
+            args.append(current.strip())
+            current = ''
+        else:
+            current += c
+        i += 1
+    if current.strip():
+        args.append(current.strip())
+    return args
+
+
+def c_string(expr):
+    """Value of a C string expression, None for NULL."""
+    parts = STRING_RE.findall(expr)
+    if not parts:
+        return None
+    return ''.join(parts)
+
+
+def matching_brace(text, start):
+    """Index of the brace closing the one at start."""
+    depth = 0
+    in_string = False
+    i = start
+    while i < len(text):
+        c = text[i]
+        if in_string:
+            if c == '\\':
+                i += 1
+            elif c == '"':
+                in_string = False
+        elif c == '"':
+            in_string = True
+        elif c in '({':
+            depth += 1
+        elif c in ')}':
+            depth -= 1
+            if depth == 0:
+                return i
+        i += 1
+    raise ValueError('unbalanced initializer')
+
+
+def strip_comments(text):
+    text = re.sub(r'/\*.*?\*/', lambda m: re.sub(r'[^\n]', ' ', m.group(0)), text, flags=re.S)
+    return re.sub(r'//[^\n]*', '', text)
+
+
+def parse_entries(body):
+    """Yield (name, alias, offset) for every initializer of a table body."""
+    offset = 0
+    for item in split_args(body):
+        offset = body.index(item, offset)
+        macro = re.match(r'HUAWEI_CMD(?:_WITH_CATEGORY)?\s*\((.*)\)\s*$', item, re.S)
+        if macro:
+            args = split_args(macro.group(1))
+            yield c_string(args[0]), c_string(args[2]), offset
+            continue
+
+        designated = re.match(r'\{(.*)\}\s*$', item, re.S)
+        if designated:
+            fields = {}
+            for field in split_args(designated.group(1)):
+                m = re.match(r'\.(\w+)\s*=\s*(.*)$', field, re.S)
+                if m:
+                    fields[m.group(1)] = m.group(2)
+            name = c_string(fields.get('name', 'NULL'))
+            if name is not None:
+                yield name, c_string(fields.get('alias', 'NULL')), offset
+
+
+def parse_source(path):
+    """Return [(table, [(name, alias, line)])] and {table: view}."""
+    with open(path, encoding='utf-8') as f:
+        text = strip_comments(f.read())
+
+    views = {}
+    for m in REGISTER_RE.finditer(text):
+        views[m.group(1)] = None if m.group(2) == 'NULL' else m.group(2).strip('"')
+
+    tables = []
+    for m in TABLE_RE.finditer(text):
+        start = m.end() - 1
+        end = matching_brace(text, start)
+        entries = [(name, alias, text.count('\n', 0, start + 1 + offset) + 1)
+                   for name, alias, offset in parse_entries(text[start + 1:end])]
+        tables.append((m.group(1), entries))
+    return tables, views
+
+
+def perfect_hash(keys):
+    """
+    Hash-and-displace minimal perfect hash. Returns the displacement
+    table G and the key order by slot. A negative G entry places a
+    single-key bucket directly in slot -G-1.
+    """
+    n = len(keys)
+    buckets = [[] for _ in range(n)]
+    for key in keys:
+        buckets[fnv_hash(0, key) % n].append(key)
+
+    g = [0] * n
+    slots = [None] * n
+    order = sorted(range(n), key=lambda b: len(buckets[b]), reverse=True)
+
+    for b in order:
+        bucket = buckets[b]
+        if len(bucket) <= 1:
+            break
+        seed = 1
+        while True:
+            placed = [fnv_hash(seed, key) % n for key in bucket]
+            if len(set(placed)) == len(placed) and all(slots[s] is None for s in placed):
+                break
+            seed += 1
+        g[b] = seed
+        for key, s in zip(bucket, placed):
+            slots[s] = key
+
+    free = [s for s in range(n) if slots[s] is None]
+    for b in order:
+        if len(buckets[b]) != 1:
+            continue
+        s = free.pop()
+        g[b] = -s - 1
+        slots[s] = buckets[b][0]
+
+    return g, slots
+
+
+def c_literal(value):
+    if value is None:
+        return 'NULL'
+    return '"' + value.replace('\\', '\\\\').replace('"', '\\"') + '"'
+
+
+def emit_hash(out, prefix, keys):
+    if not keys:
+        out.append('const int32_t %s_g[1] = { 0 };' % prefix)
+        return []
+    g, slots = perfect_hash(keys)
+    out.append('const int32_t %s_g[%d] = {' % (prefix, len(g)))
+    for i in range(0, len(g), 10):
+        out.append('    ' + ', '.join('%d' % v for v in g[i:i + 10]) + ',')
+    out.append('};')
+    out.append('')
+    return slots
+
+
+def emit_entries(out, array, entries):
+    out.append('const struct cmd_hash_entry %s[%d] = {' % (array, max(len(entries), 1)))
+    out.extend(entries or ['    { NULL, 0, 0, 0 },'])
+    out.append('};')
+    out.append('')
+
+
+def main():
+    args = sys.argv[1:]
+    if len(args) < 3 or args[0] != '-o':
+        sys.stderr.write('Usage: %s -o output.c source.c [source.c ...]\n' % sys.argv[0])
+        return 1
+    output = args[1]
+    sources = args[2:]
+
+    # name -> [(view, where)], alias -> {view: canonical}
+    names = {}
+    aliases = {}
+    errors = []
+
+    for path in sources:
+        tables, views = parse_source(path)
+        for table, entries in tables:
+            if table not in views:
+                continue
+            view = views[table]
+            for name, alias, line in entries:
+                where = '%s:%d (%s)' % (os.path.basename(path), line, table)
+                variants = names.setdefault(name, [])
+                for other_view, other_where in variants:
+                    if other_view == view:
+                        errors.append('duplicate command "%s" in view %s: %s and %s'
+                                      % (name, view or '(any)', other_where, where))
+                        break
+                else:
+                    variants.append((view, where))
+
+                if alias and alias != name:
+                    mapped = aliases.setdefault(alias, {})
+                    if view in mapped and mapped[view] != name:
+                        errors.append('alias "%s" in view %s maps to "%s" and "%s": %s'
+                                      % (alias, view or '(any)', mapped[view], name, where))
+                    mapped.setdefault(view, name)
+
+    if errors:
+        for error in errors:
+            sys.stderr.write('gen_cmd_hash: error: %s\n' % error)
+        return 1
+
+    name_keys = sorted(names)
+    alias_keys = sorted(aliases)
+    max_words = max([len(k.split()) for k in name_keys + alias_keys] or [1])
+
+    out = [
+        '/*',
+        ' * Generated by gen_cmd_hash.py from the Huawei command tables.',
+        ' * Do not edit.',
+        ' */',
+        '',
+        '#include <stddef.h>',
+        '#include <stdint.h>',
+        '#include "cmd_hash.h"',
+        '',
+        'const int cmd_hash_max_words = %d;' % max_words,
+        'const int cmd_name_count = %d;' % len(name_keys),
+        'const int cmd_alias_count = %d;' % len(alias_keys),
+        '',
+    ]
+
+    slots = emit_hash(out, 'cmd_name', name_keys)
+    variants = []
+    entries = []
+    for name in slots:
+        prefix = any(other.startswith(name + ' ') for other in name_keys)
+        entries.append('    { %s, %s, %d, %d },'
+                       % (c_literal(name), 'CMD_HASH_PREFIX' if prefix else '0',
+                          len(variants), len(names[name])))
+        variants.extend((view, None) for view, _ in names[name])
+    emit_entries(out, 'cmd_name_entries', entries)
+
+    slots = emit_hash(out, 'cmd_alias', alias_keys)
+    entries = []
+    for alias in slots:
+        mapped = aliases[alias]
+        entries.append('    { %s, 0, %d, %d },' % (c_literal(alias), len(variants), len(mapped)))
+        variants.extend(mapped.items())
+    emit_entries(out, 'cmd_alias_entries', entries)
+
+    out.append('const int cmd_variant_count = %d;' % len(variants))
+    out.append('const struct cmd_hash_variant cmd_variants[%d] = {' % max(len(variants), 1))
+    out.extend('    { %s, %s },' % (c_literal(view), c_literal(canonical))
+               for view, canonical in variants or [(None, None)])
+    out.append('};')
+
+    with open(output, 'w', encoding='utf-8') as f:
+        f.write('\n'.join(out) + '\n')
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,193 @@
+/*
+ * Huawei VRP Style CLI Extension - Common Utilities
+ * Copyright (C) 2026 WhiteBox NE Team
+ *
+ * This file provides the FRR command execution path shared by all
+ * Huawei-style handlers. Commands are sent over the persistent vtysh
+ * session pool; blocks the pool cannot route are executed by a vtysh
+ * process as before. In two-stage mode configuration blocks are staged
+ * in the candidate configuration until commit.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include "huawei_cli.h"
+#include "vtysh_pool.h"
+#include "cli_stats.h"
+
+#define VTYSH_PATH      "vtysh"
+
+static pthread_once_t vtysh_pool_once = PTHREAD_ONCE_INIT;
+
+static void vtysh_pool_start(void)
+{
+    const char *disable = getenv("WHITEBOX_VTYSH_POOL_DISABLE");
+    if (disable && strcmp(disable, "1") == 0) {
+        return;
+    }
+
+    struct vtysh_pool_config config = {0};
+    const char *size = getenv("WHITEBOX_VTYSH_POOL_SIZE");
+    if (size) {
+        config.connections = atoi(size);
+    }
+
+    vtysh_pool_init(&config);
+}
+
+/*
+ * Execute a command block with one vtysh process.
+ * Every line becomes a "-c" argument so the block runs in one session.
+ */
+int vtysh_exec_process(const char *cmd, char *output, size_t output_size)
+{
+    char *copy = strdup(cmd);
+    if (!copy) {
+        return -1;
+    }
+
+    size_t lines = 1;
+    for (const char *p = cmd; *p; p++) {
+        if (*p == '\n') {
+            lines++;
+        }
+    }
+
+    char **argv = malloc((lines * 2 + 2) * sizeof(char *));
+    if (!argv) {
+        free(copy);
+        return -1;
+    }
+
+    int argc = 0;
+    argv[argc++] = VTYSH_PATH;
+
+    char *saveptr = NULL;
+    for (char *line = strtok_r(copy, "\n", &saveptr); line;
+         line = strtok_r(NULL, "\n", &saveptr)) {
+        while (*line == ' ' || *line == '\t') {
+            line++;
+        }
+        if (*line == '\0') {
+            continue;
+        }
+        argv[argc++] = "-c";
+        argv[argc++] = line;
+    }
+    argv[argc] = NULL;
+
+    int pipefd[2];
+    if (pipe(pipefd) < 0) {
+        free(argv);
+        free(copy);
+        return -1;
+    }
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(pipefd[0]);
+        close(pipefd[1]);
+        free(argv);
+        free(copy);
+        return -1;
+    }
+
+    if (pid == 0) {
+        dup2(pipefd[1], STDOUT_FILENO);
+        dup2(pipefd[1], STDERR_FILENO);
+        close(pipefd[0]);
+        close(pipefd[1]);
+        execvp(VTYSH_PATH, argv);
+        _exit(127);
+    }
+
+    close(pipefd[1]);
+
+    size_t len = 0;
+    char buf[4096];
+    ssize_t n;
+    while ((n = read(pipefd[0], buf, sizeof(buf))) != 0) {
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        if (output && len + 1 < output_size) {
+            size_t copy_len = (size_t)n;
+            if (copy_len > output_size - 1 - len) {
+                copy_len = output_size - 1 - len;
+            }
+            memcpy(output + len, buf, copy_len);
+            len += copy_len;
+        }
+    }
+    if (output && output_size) {
+        output[len] = '\0';
+    }
+    close(pipefd[0]);
+    free(argv);
+    free(copy);
+
+    int status;
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) {
+            return -1;
+        }
+    }
+
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+/*
+ * Execute FRR command
+ */
+int execute_vtysh_command(const char *cmd)
+{
+    return execute_vtysh_command_with_output(cmd, NULL, 0);
+}
+
+/*
+ * Execute FRR command and capture its output
+ */
+int execute_vtysh_command_with_output(const char *cmd, char *output, size_t output_size)
+{
+    uint64_t start = cli_stats_now();
+    int ret;
+
+    /* Two-stage mode: configuration blocks go to the candidate */
+    int staged = output ? 0 : cli_commit_stage(cmd);
+    if (staged != 0) {
+        ret = staged > 0 ? 0 : -1;
+    } else {
+        ret = execute_vtysh_command_now(cmd, output, output_size);
+    }
+
+    cli_stats_vtysh_add(cli_stats_now() - start);
+    return ret;
+}
+
+/*
+ * Execute FRR command immediately, bypassing the candidate configuration
+ */
+int execute_vtysh_command_now(const char *cmd, char *output, size_t output_size)
+{
+    pthread_once(&vtysh_pool_once, vtysh_pool_start);
+
+    if (vtysh_pool_active()) {
+        int ret = vtysh_pool_execute(cmd, output, output_size);
+        if (ret != VTYSH_POOL_EUNROUTABLE) {
+            return ret;
+        }
+    }
+
+    return vtysh_exec_process(cmd, output, output_size);
+}
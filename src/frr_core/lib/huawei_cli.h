@@ -9,6 +9,7 @@
 #ifndef _HUAWEI_CLI_H
 #define _HUAWEI_CLI_H
 
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
 
@@ -52,20 +53,36 @@ void register_huawei_qos_cmds(void);
 void register_huawei_ha_cmds(void);
 void register_huawei_monitor_cmds(void);
 
+/* Command dispatcher */
+int huawei_cli_register_table(struct cmd_element *table, const char *view);
+int huawei_cli_command_count(void);
+int huawei_cli_execute(const char *line, const char *view);
+
 /* Utility functions */
 int execute_vtysh_command(const char *cmd);
 int execute_vtysh_command_with_output(const char *cmd, char *output, size_t output_size);
+int execute_vtysh_command_now(const char *cmd, char *output, size_t output_size);
+int vtysh_exec_process(const char *cmd, char *output, size_t output_size);
 bool validate_ip_address(const char *ip);
 bool validate_ipv6_address(const char *ip);
 bool validate_prefix_length(const char *prefix, bool is_ipv6);
 
+/* Two-stage configuration commit */
+void cli_commit_set_two_stage(bool enable);
+bool cli_commit_two_stage(void);
+int cli_commit_stage(const char *cmd);
+int cli_commit(char *error, size_t error_size);
+void cli_commit_clear(void);
+int cli_commit_candidate_count(void);
+void cli_commit_defer(void (*fn)(void));
+
 /* Command registration macro */
-#define HUAWEI_CMD(name, func, alias, help) \
-    { .name = name, .func = func, .alias = alias, .help = help, \
+#define HUAWEI_CMD(_name, _func, _alias, _help) \
+    { .name = _name, .func = _func, .alias = _alias, .help = _help, \
       .category = CMD_CAT_SYSTEM, .subcmd_count = 0, .subcmds = NULL, .validate = NULL }
 
-#define HUAWEI_CMD_WITH_CATEGORY(name, func, alias, help, cat) \
-    { .name = name, .func = func, .alias = alias, .help = help, \
-      .category = cat, .subcmd_count = 0, .subcmds = NULL, .validate = NULL }
+#define HUAWEI_CMD_WITH_CATEGORY(_name, _func, _alias, _help, _cat) \
+    { .name = _name, .func = _func, .alias = _alias, .help = _help, \
+      .category = _cat, .subcmd_count = 0, .subcmds = NULL, .validate = NULL }
 
 #endif /* _HUAWEI_CLI_H */
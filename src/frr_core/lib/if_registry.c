@@ -0,0 +1,454 @@
+/*
+ * Interface Name Registry
+ * Copyright (C) 2026 WhiteBox NE Team
+ *
+ * This module provides the interface registry including:
+ * - Name interning into an open-addressing hash, IDs indexed in O(1)
+ * - Kernel ifindex to ID table for link events and packet metadata
+ * - Initial RTM_GETLINK dump and an RTNETLINK link monitor thread
+ *
+ * The monitor is started on the first interning unless
+ * WHITEBOX_IF_MONITOR_DISABLE is set in the environment.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <net/if.h>
+#include "if_registry.h"
+#include "slab.h"
+
+#define IF_HASH_MIN             256
+#define IF_KERNEL_INDEX_MAX     (1 << 20)   /* Larger ifindexes are not mapped */
+#define IF_NL_BUFFER_SIZE       32768
+#define IF_MONITOR_POLL_MS      500
+
+/* Registered interface */
+struct if_entry {
+    char name[IF_REGISTRY_NAME_SIZE];
+    uint32_t hash;
+    int kernel_index;           /* 0 while absent from the kernel */
+    unsigned int flags;         /* Kernel IFF_* flags */
+};
+
+static pthread_rwlock_t if_lock = PTHREAD_RWLOCK_INITIALIZER;
+static struct slab if_slab = SLAB_INIT("interface", struct if_entry);
+
+/* ID - 1 -> entry */
+static struct if_entry **if_entries;
+static uint32_t if_count;
+static uint32_t if_capacity;
+
+/* Name hash, slots hold IDs */
+static ifid_t *if_hash;
+static uint32_t if_hash_size;
+
+/* Kernel ifindex -> ID */
+static ifid_t *if_kernel_map;
+static int if_kernel_map_size;
+
+static pthread_once_t if_monitor_once = PTHREAD_ONCE_INIT;
+static pthread_t if_monitor_thread;
+static bool if_monitor_running;
+static volatile bool if_monitor_stop;
+static int if_nl_fd = -1;
+
+static uint32_t if_name_hash(const char *name)
+{
+    uint32_t h = 0x811c9dc5;
+    for (const unsigned char *p = (const unsigned char *)name; *p; p++) {
+        h = (h ^ *p) * 0x01000193;
+    }
+    return h;
+}
+
+/* Slot holding name, or the empty slot where it belongs. Lock held. */
+static uint32_t if_hash_slot(const char *name, uint32_t hash)
+{
+    uint32_t mask = if_hash_size - 1;
+    uint32_t slot = hash & mask;
+
+    while (if_hash[slot] != IFID_NONE) {
+        struct if_entry *entry = if_entries[if_hash[slot] - 1];
+        if (entry->hash == hash && strcmp(entry->name, name) == 0) {
+            break;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+static int if_hash_grow(void)
+{
+    uint32_t size = if_hash_size ? if_hash_size * 2 : IF_HASH_MIN;
+    ifid_t *hash = calloc(size, sizeof(*hash));
+    if (!hash) {
+        return -1;
+    }
+
+    free(if_hash);
+    if_hash = hash;
+    if_hash_size = size;
+    for (uint32_t i = 0; i < if_count; i++) {
+        if_hash[if_hash_slot(if_entries[i]->name, if_entries[i]->hash)] = i + 1;
+    }
+    return 0;
+}
+
+/* Find or add name. Write lock held. */
+static ifid_t if_intern_locked(const char *name, uint32_t hash)
+{
+    if (if_hash_size) {
+        ifid_t id = if_hash[if_hash_slot(name, hash)];
+        if (id != IFID_NONE) {
+            return id;
+        }
+    }
+
+    /* Keep the load factor at or below one half */
+    if ((if_count + 1) * 2 > if_hash_size && if_hash_grow() != 0) {
+        return IFID_NONE;
+    }
+    if (if_count == if_capacity) {
+        uint32_t capacity = if_capacity ? if_capacity * 2 : 64;
+        struct if_entry **entries = realloc(if_entries, capacity * sizeof(*entries));
+        if (!entries) {
+            return IFID_NONE;
+        }
+        if_entries = entries;
+        if_capacity = capacity;
+    }
+
+    struct if_entry *entry = slab_alloc(&if_slab, NULL);
+    if (!entry) {
+        return IFID_NONE;
+    }
+    snprintf(entry->name, sizeof(entry->name), "%s", name);
+    entry->hash = hash;
+
+    if_entries[if_count++] = entry;
+    if_hash[if_hash_slot(name, hash)] = if_count;
+    return if_count;
+}
+
+static void if_monitor_start_once(void)
+{
+    const char *disable = getenv("WHITEBOX_IF_MONITOR_DISABLE");
+    if (!disable || strcmp(disable, "1") != 0) {
+        if_registry_start();
+    }
+}
+
+/*
+ * Intern an interface name; the same name always yields the same ID.
+ * Returns IFID_NONE for an empty or overlong name.
+ */
+ifid_t if_intern(const char *name)
+{
+    if (!name || !name[0] || strlen(name) >= IF_REGISTRY_NAME_SIZE) {
+        return IFID_NONE;
+    }
+
+    pthread_once(&if_monitor_once, if_monitor_start_once);
+
+    uint32_t hash = if_name_hash(name);
+    pthread_rwlock_rdlock(&if_lock);
+    ifid_t id = if_hash_size ? if_hash[if_hash_slot(name, hash)] : IFID_NONE;
+    pthread_rwlock_unlock(&if_lock);
+    if (id != IFID_NONE) {
+        return id;
+    }
+
+    pthread_rwlock_wrlock(&if_lock);
+    id = if_intern_locked(name, hash);
+    pthread_rwlock_unlock(&if_lock);
+    return id;
+}
+
+/* ID of a registered name without registering it */
+ifid_t if_lookup(const char *name)
+{
+    if (!name || !name[0]) {
+        return IFID_NONE;
+    }
+
+    uint32_t hash = if_name_hash(name);
+    pthread_rwlock_rdlock(&if_lock);
+    ifid_t id = if_hash_size ? if_hash[if_hash_slot(name, hash)] : IFID_NONE;
+    pthread_rwlock_unlock(&if_lock);
+    return id;
+}
+
+/*
+ * Name of an ID, "" for IFID_NONE. Entries are never freed, so the
+ * string stays valid.
+ */
+const char *if_name(ifid_t id)
+{
+    const char *name = "";
+
+    pthread_rwlock_rdlock(&if_lock);
+    if (id != IFID_NONE && id <= if_count) {
+        name = if_entries[id - 1]->name;
+    }
+    pthread_rwlock_unlock(&if_lock);
+    return name;
+}
+
+/* Kernel ifindex, 0 if the interface does not exist in the kernel */
+int if_kernel_index(ifid_t id)
+{
+    int ifindex = 0;
+
+    pthread_rwlock_rdlock(&if_lock);
+    if (id != IFID_NONE && id <= if_count) {
+        ifindex = if_entries[id - 1]->kernel_index;
+    }
+    pthread_rwlock_unlock(&if_lock);
+    return ifindex;
+}
+
+ifid_t if_by_kernel_index(int ifindex)
+{
+    ifid_t id = IFID_NONE;
+
+    pthread_rwlock_rdlock(&if_lock);
+    if (ifindex > 0 && ifindex < if_kernel_map_size) {
+        id = if_kernel_map[ifindex];
+    }
+    pthread_rwlock_unlock(&if_lock);
+    return id;
+}
+
+/* Administratively and operationally up */
+bool if_is_up(ifid_t id)
+{
+    bool up = false;
+
+    pthread_rwlock_rdlock(&if_lock);
+    if (id != IFID_NONE && id <= if_count) {
+        unsigned int flags = if_entries[id - 1]->flags;
+        up = (flags & IFF_UP) && (flags & IFF_RUNNING);
+    }
+    pthread_rwlock_unlock(&if_lock);
+    return up;
+}
+
+uint32_t if_registry_count(void)
+{
+    pthread_rwlock_rdlock(&if_lock);
+    uint32_t count = if_count;
+    pthread_rwlock_unlock(&if_lock);
+    return count;
+}
+
+/* Point a kernel ifindex at an ID. Write lock held. */
+static void if_kernel_map_set(int ifindex, ifid_t id)
+{
+    if (ifindex <= 0 || ifindex >= IF_KERNEL_INDEX_MAX) {
+        return;
+    }
+
+    if (ifindex >= if_kernel_map_size) {
+        int size = if_kernel_map_size ? if_kernel_map_size : 64;
+        while (size <= ifindex) {
+            size *= 2;
+        }
+        ifid_t *map = realloc(if_kernel_map, size * sizeof(*map));
+        if (!map) {
+            return;
+        }
+        memset(map + if_kernel_map_size, 0, (size - if_kernel_map_size) * sizeof(*map));
+        if_kernel_map = map;
+        if_kernel_map_size = size;
+    }
+    if_kernel_map[ifindex] = id;
+}
+
+/* Apply one RTM_NEWLINK / RTM_DELLINK message */
+static void if_handle_link(struct nlmsghdr *nlh)
+{
+    struct ifinfomsg *ifi = NLMSG_DATA(nlh);
+    if (nlh->nlmsg_len < NLMSG_LENGTH(sizeof(*ifi))) {
+        return;
+    }
+
+    const char *name = NULL;
+    int len = (int)(nlh->nlmsg_len - NLMSG_LENGTH(sizeof(*ifi)));
+    for (struct rtattr *rta = IFLA_RTA(ifi); RTA_OK(rta, len); rta = RTA_NEXT(rta, len)) {
+        if (rta->rta_type == IFLA_IFNAME) {
+            name = RTA_DATA(rta);
+            break;
+        }
+    }
+
+    pthread_rwlock_wrlock(&if_lock);
+
+    /* The ifindex may have carried another name before a rename */
+    if (ifi->ifi_index > 0 && ifi->ifi_index < if_kernel_map_size) {
+        ifid_t old = if_kernel_map[ifi->ifi_index];
+        if (old != IFID_NONE && (nlh->nlmsg_type == RTM_DELLINK || !name ||
+                                 strcmp(if_entries[old - 1]->name, name) != 0)) {
+            if_entries[old - 1]->kernel_index = 0;
+            if_entries[old - 1]->flags = 0;
+            if_kernel_map[ifi->ifi_index] = IFID_NONE;
+        }
+    }
+
+    if (nlh->nlmsg_type == RTM_NEWLINK && name && strlen(name) < IF_REGISTRY_NAME_SIZE) {
+        ifid_t id = if_intern_locked(name, if_name_hash(name));
+        if (id != IFID_NONE) {
+            if_entries[id - 1]->kernel_index = ifi->ifi_index;
+            if_entries[id - 1]->flags = ifi->ifi_flags;
+            if_kernel_map_set(ifi->ifi_index, id);
+        }
+    }
+
+    pthread_rwlock_unlock(&if_lock);
+}
+
+/* Process every message in a receive buffer; returns 1 at NLMSG_DONE */
+static int if_handle_buffer(char *buf, ssize_t len)
+{
+    for (struct nlmsghdr *nlh = (struct nlmsghdr *)buf; NLMSG_OK(nlh, len);
+         nlh = NLMSG_NEXT(nlh, len)) {
+        switch (nlh->nlmsg_type) {
+            case NLMSG_DONE:
+                return 1;
+            case NLMSG_ERROR:
+                return -1;
+            case RTM_NEWLINK:
+            case RTM_DELLINK:
+                if_handle_link(nlh);
+                break;
+            default:
+                break;
+        }
+    }
+    return 0;
+}
+
+/* Request and consume a full link dump */
+static int if_dump_links(int fd)
+{
+    struct {
+        struct nlmsghdr nlh;
+        struct ifinfomsg ifi;
+    } req;
+
+    memset(&req, 0, sizeof(req));
+    req.nlh.nlmsg_len = NLMSG_LENGTH(sizeof(req.ifi));
+    req.nlh.nlmsg_type = RTM_GETLINK;
+    req.nlh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    req.nlh.nlmsg_seq = 1;
+    req.ifi.ifi_family = AF_UNSPEC;
+
+    if (send(fd, &req, req.nlh.nlmsg_len, 0) < 0) {
+        return -1;
+    }
+
+    char *buf = malloc(IF_NL_BUFFER_SIZE);
+    if (!buf) {
+        return -1;
+    }
+
+    int ret = 0;
+    while (ret == 0) {
+        ssize_t len = recv(fd, buf, IF_NL_BUFFER_SIZE, 0);
+        if (len < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ret = -1;
+            break;
+        }
+        ret = if_handle_buffer(buf, len);
+    }
+
+    free(buf);
+    return ret < 0 ? -1 : 0;
+}
+
+static void *if_monitor_worker(void *arg)
+{
+    char *buf = malloc(IF_NL_BUFFER_SIZE);
+    if (!buf) {
+        return NULL;
+    }
+
+    while (!if_monitor_stop) {
+        struct pollfd pfd = { .fd = if_nl_fd, .events = POLLIN };
+        if (poll(&pfd, 1, IF_MONITOR_POLL_MS) <= 0) {
+            continue;
+        }
+
+        ssize_t len = recv(if_nl_fd, buf, IF_NL_BUFFER_SIZE, MSG_DONTWAIT);
+        if (len < 0) {
+            /* Events were dropped, resynchronize from a full dump */
+            if (errno == ENOBUFS) {
+                if_dump_links(if_nl_fd);
+            }
+            continue;
+        }
+        if_handle_buffer(buf, len);
+    }
+
+    free(buf);
+    return NULL;
+}
+
+/*
+ * Load the kernel link table and start following link events.
+ */
+int if_registry_start(void)
+{
+    if (if_monitor_running) {
+        return 0;
+    }
+
+    int fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (fd < 0) {
+        return -1;
+    }
+
+    struct sockaddr_nl addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = RTMGRP_LINK;
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || if_dump_links(fd) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    if_nl_fd = fd;
+    if_monitor_stop = false;
+    if (pthread_create(&if_monitor_thread, NULL, if_monitor_worker, NULL) != 0) {
+        close(fd);
+        if_nl_fd = -1;
+        return -1;
+    }
+    if_monitor_running = true;
+    return 0;
+}
+
+void if_registry_stop(void)
+{
+    if (!if_monitor_running) {
+        return;
+    }
+
+    if_monitor_stop = true;
+    pthread_join(if_monitor_thread, NULL);
+    close(if_nl_fd);
+    if_nl_fd = -1;
+    if_monitor_running = false;
+}
@@ -0,0 +1,37 @@
+/*
+ * Interface Name Registry
+ * Copyright (C) 2026 WhiteBox NE Team
+ *
+ * Interns interface names to compact IDs. Modules keep an ifid_t
+ * instead of a name buffer, so matching an interface is an integer
+ * compare. IDs are assigned on first use and never reused; an
+ * interface may be configured before it exists in the kernel.
+ *
+ * A monitor thread follows RTNETLINK link events and keeps the kernel
+ * ifindex and link state of every registered name current.
+ */
+
+#ifndef _IF_REGISTRY_H
+#define _IF_REGISTRY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Interface ID, 0 means none */
+typedef uint32_t ifid_t;
+
+#define IFID_NONE               ((ifid_t)0)
+#define IF_REGISTRY_NAME_SIZE   64
+
+ifid_t if_intern(const char *name);
+ifid_t if_lookup(const char *name);
+const char *if_name(ifid_t id);
+int if_kernel_index(ifid_t id);
+ifid_t if_by_kernel_index(int ifindex);
+bool if_is_up(ifid_t id);
+uint32_t if_registry_count(void);
+
+int if_registry_start(void);
+void if_registry_stop(void);
+
+#endif /* _IF_REGISTRY_H */
@@ -0,0 +1,343 @@
+/*
+ * Per-CPU Statistics Counters
+ * Copyright (C) 2026 WhiteBox NE Team
+ *
+ * This module provides the counter arena including:
+ * - Counter groups allocated from 512-counter chunks, one copy per slot
+ * - Private slots for registered writer threads, a shared atomic slot
+ *   for everyone else
+ * - Lock-free aggregation with a per-slot sequence count
+ * - Snapshots, deltas and rates
+ *
+ * Chunks are never freed or moved, so a writer holding a counter handle
+ * can always reach its copy. Allocation and registration take a mutex;
+ * updates and reads do not.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <time.h>
+#include "pcpu_stats.h"
+
+#define PCPU_SHARED_SLOT        PCPU_STATS_MAX_SLOTS
+#define PCPU_READ_RETRIES       64      /* Then accept a torn group */
+#define PCPU_CHUNK_BYTES        (PCPU_STATS_CHUNK_SIZE * sizeof(uint64_t))
+
+/* Freed groups of one size */
+struct pcpu_free_list {
+    pcpu_counter_t *items;
+    uint32_t count;
+    uint32_t capacity;
+};
+
+static struct pcpu_slot pcpu_slots[PCPU_STATS_MAX_SLOTS + 1];
+static uint32_t pcpu_slot_high = 0;         /* Private slots ever activated */
+static uint32_t pcpu_chunk_count = 0;
+static pcpu_counter_t pcpu_next = 1;        /* Counter 0 is never handed out */
+static uint32_t pcpu_live = 0;
+static struct pcpu_free_list pcpu_free[PCPU_STATS_GROUP_MAX + 1];
+static pthread_mutex_t pcpu_lock = PTHREAD_MUTEX_INITIALIZER;
+
+__thread struct pcpu_slot *pcpu_self = NULL;
+
+uint64_t pcpu_stats_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t *chunk_alloc(void)
+{
+    uint64_t *chunk = aligned_alloc(PCPU_STATS_CACHELINE, PCPU_CHUNK_BYTES);
+    if (chunk) {
+        memset(chunk, 0, PCPU_CHUNK_BYTES);
+    }
+    return chunk;
+}
+
+/* Give a slot storage for every existing chunk, then make it visible */
+static int slot_activate(struct pcpu_slot *slot)
+{
+    if (slot->active) {
+        return 0;
+    }
+
+    uint64_t **chunks = calloc(PCPU_STATS_MAX_CHUNKS, sizeof(*chunks));
+    if (!chunks) {
+        return -1;
+    }
+    for (uint32_t i = 0; i < pcpu_chunk_count; i++) {
+        chunks[i] = chunk_alloc();
+        if (!chunks[i]) {
+            while (i--) {
+                free(chunks[i]);
+            }
+            free(chunks);
+            return -1;
+        }
+    }
+    slot->chunks = chunks;
+    __atomic_store_n(&slot->active, true, __ATOMIC_RELEASE);
+    return 0;
+}
+
+/* Add one chunk to every active slot */
+static int chunk_grow(void)
+{
+    uint32_t index = pcpu_chunk_count;
+    uint64_t *fresh[PCPU_STATS_MAX_SLOTS + 1] = { NULL };
+
+    if (index >= PCPU_STATS_MAX_CHUNKS) {
+        return -1;
+    }
+    for (uint32_t s = 0; s <= PCPU_STATS_MAX_SLOTS; s++) {
+        if (!pcpu_slots[s].active) {
+            continue;
+        }
+        fresh[s] = chunk_alloc();
+        if (!fresh[s]) {
+            for (uint32_t t = 0; t < s; t++) {
+                free(fresh[t]);
+            }
+            return -1;
+        }
+    }
+    for (uint32_t s = 0; s <= PCPU_STATS_MAX_SLOTS; s++) {
+        if (fresh[s]) {
+            __atomic_store_n(&pcpu_slots[s].chunks[index], fresh[s], __ATOMIC_RELEASE);
+        }
+    }
+    pcpu_chunk_count = index + 1;
+    return 0;
+}
+
+/*
+ * Allocate a group of count counters, zero in every slot. Returns
+ * PCPU_COUNTER_NONE when count is out of range or memory runs out.
+ */
+pcpu_counter_t pcpu_counter_alloc(uint32_t count)
+{
+    pcpu_counter_t counter = PCPU_COUNTER_NONE;
+
+    if (count == 0 || count > PCPU_STATS_GROUP_MAX) {
+        return PCPU_COUNTER_NONE;
+    }
+
+    pthread_mutex_lock(&pcpu_lock);
+    if (slot_activate(&pcpu_slots[PCPU_SHARED_SLOT]) < 0) {
+        goto out;
+    }
+
+    struct pcpu_free_list *list = &pcpu_free[count];
+    if (list->count) {
+        counter = list->items[--list->count];
+    } else {
+        /* Groups never straddle a chunk */
+        pcpu_counter_t next = pcpu_next;
+        if ((next & (PCPU_STATS_CHUNK_SIZE - 1)) + count > PCPU_STATS_CHUNK_SIZE) {
+            next = (next | (PCPU_STATS_CHUNK_SIZE - 1)) + 1;
+        }
+        if ((next >> PCPU_STATS_CHUNK_SHIFT) >= pcpu_chunk_count && chunk_grow() < 0) {
+            goto out;
+        }
+        counter = next;
+        pcpu_next = next + count;
+    }
+
+    for (uint32_t s = 0; s <= PCPU_STATS_MAX_SLOTS; s++) {
+        if (pcpu_slots[s].active) {
+            for (uint32_t i = 0; i < count; i++) {
+                __atomic_store_n(pcpu_slot_counter(&pcpu_slots[s], counter + i), 0, __ATOMIC_RELAXED);
+            }
+        }
+    }
+    pcpu_live += count;
+
+out:
+    pthread_mutex_unlock(&pcpu_lock);
+    return counter;
+}
+
+/* Writers must have stopped using the group */
+void pcpu_counter_free(pcpu_counter_t counter, uint32_t count)
+{
+    if (counter == PCPU_COUNTER_NONE || count == 0 || count > PCPU_STATS_GROUP_MAX) {
+        return;
+    }
+
+    pthread_mutex_lock(&pcpu_lock);
+    struct pcpu_free_list *list = &pcpu_free[count];
+    if (list->count == list->capacity) {
+        uint32_t capacity = list->capacity ? list->capacity * 2 : 64;
+        pcpu_counter_t *items = realloc(list->items, capacity * sizeof(*items));
+        if (!items) {
+            /* Leak the group rather than fail */
+            pthread_mutex_unlock(&pcpu_lock);
+            return;
+        }
+        list->items = items;
+        list->capacity = capacity;
+    }
+    list->items[list->count++] = counter;
+    pcpu_live -= count;
+    pthread_mutex_unlock(&pcpu_lock);
+}
+
+/*
+ * Give the calling thread a private slot. A slot given up by an exited
+ * thread is reused; its counts stay in the totals. Returns the slot
+ * index, or -1 when all slots are taken (the thread then uses the
+ * shared slot).
+ */
+int pcpu_stats_thread_register(void)
+{
+    if (pcpu_self) {
+        return (int)(pcpu_self - pcpu_slots);
+    }
+
+    int index = -1;
+    pthread_mutex_lock(&pcpu_lock);
+    for (uint32_t s = 0; s < PCPU_STATS_MAX_SLOTS; s++) {
+        struct pcpu_slot *slot = &pcpu_slots[s];
+        if (slot->owned) {
+            continue;
+        }
+        if (slot_activate(slot) < 0) {
+            break;
+        }
+        slot->owned = true;
+        if (s >= pcpu_slot_high) {
+            __atomic_store_n(&pcpu_slot_high, s + 1, __ATOMIC_RELEASE);
+        }
+        pcpu_self = slot;
+        index = (int)s;
+        break;
+    }
+    pthread_mutex_unlock(&pcpu_lock);
+    return index;
+}
+
+void pcpu_stats_thread_unregister(void)
+{
+    if (!pcpu_self) {
+        return;
+    }
+    pthread_mutex_lock(&pcpu_lock);
+    pcpu_self->owned = false;
+    pcpu_self = NULL;
+    pthread_mutex_unlock(&pcpu_lock);
+}
+
+void pcpu_shared_add(pcpu_counter_t counter, uint64_t value)
+{
+    __atomic_fetch_add(pcpu_slot_counter(&pcpu_slots[PCPU_SHARED_SLOT], counter), value,
+                       __ATOMIC_RELAXED);
+}
+
+/* Add the copy of one slot, retrying while its owner is mid-update */
+static void slot_read(struct pcpu_slot *slot, pcpu_counter_t counter, uint32_t count,
+                      uint64_t *values)
+{
+    if (!__atomic_load_n(&slot->active, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+    uint64_t *chunk = __atomic_load_n(&slot->chunks[counter >> PCPU_STATS_CHUNK_SHIFT],
+                                      __ATOMIC_ACQUIRE);
+    if (!chunk) {
+        return;
+    }
+    chunk += counter & (PCPU_STATS_CHUNK_SIZE - 1);
+
+    uint64_t copy[PCPU_STATS_GROUP_MAX];
+    for (int retry = 0;; retry++) {
+        uint32_t begin = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        for (uint32_t i = 0; i < count; i++) {
+            copy[i] = __atomic_load_n(&chunk[i], __ATOMIC_RELAXED);
+        }
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        uint32_t end = __atomic_load_n(&slot->seq, __ATOMIC_RELAXED);
+        if ((begin == end && !(begin & 1)) || retry >= PCPU_READ_RETRIES) {
+            break;
+        }
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        values[i] += copy[i];
+    }
+}
+
+/* Totals of a group over all slots */
+void pcpu_counter_read(pcpu_counter_t counter, uint32_t count, struct pcpu_snapshot *snap)
+{
+    memset(snap, 0, sizeof(*snap));
+    snap->time_ns = pcpu_stats_now();
+    if (counter == PCPU_COUNTER_NONE || count == 0) {
+        return;
+    }
+    if (count > PCPU_STATS_GROUP_MAX) {
+        count = PCPU_STATS_GROUP_MAX;
+    }
+
+    uint32_t high = __atomic_load_n(&pcpu_slot_high, __ATOMIC_ACQUIRE);
+    for (uint32_t s = 0; s < high; s++) {
+        slot_read(&pcpu_slots[s], counter, count, snap->values);
+    }
+    slot_read(&pcpu_slots[PCPU_SHARED_SLOT], counter, count, snap->values);
+}
+
+uint64_t pcpu_counter_sum(pcpu_counter_t counter)
+{
+    struct pcpu_snapshot snap;
+    pcpu_counter_read(counter, 1, &snap);
+    return snap.values[0];
+}
+
+/*
+ * Difference of two snapshots of the same group. A value below its
+ * baseline means the group was reset, and counts from zero.
+ */
+void pcpu_snapshot_delta(const struct pcpu_snapshot *now, const struct pcpu_snapshot *prev,
+                         uint32_t count, struct pcpu_snapshot *delta)
+{
+    memset(delta, 0, sizeof(*delta));
+    delta->time_ns = now->time_ns > prev->time_ns ? now->time_ns - prev->time_ns : 0;
+    for (uint32_t i = 0; i < count && i < PCPU_STATS_GROUP_MAX; i++) {
+        delta->values[i] = now->values[i] >= prev->values[i] ?
+                           now->values[i] - prev->values[i] : now->values[i];
+    }
+}
+
+/* Per second rate of one counter of a delta */
+double pcpu_snapshot_rate(const struct pcpu_snapshot *delta, uint32_t index)
+{
+    if (delta->time_ns == 0 || index >= PCPU_STATS_GROUP_MAX) {
+        return 0;
+    }
+    return delta->values[index] * 1e9 / delta->time_ns;
+}
+
+/* Threads currently holding a private slot */
+uint32_t pcpu_stats_slots(void)
+{
+    uint32_t owned = 0;
+
+    pthread_mutex_lock(&pcpu_lock);
+    for (uint32_t s = 0; s < pcpu_slot_high; s++) {
+        owned += pcpu_slots[s].owned;
+    }
+    pthread_mutex_unlock(&pcpu_lock);
+    return owned;
+}
+
+/* Counters in live groups */
+uint32_t pcpu_stats_allocated(void)
+{
+    pthread_mutex_lock(&pcpu_lock);
+    uint32_t live = pcpu_live;
+    pthread_mutex_unlock(&pcpu_lock);
+    return live;
+}
@@ -0,0 +1,119 @@
+/*
+ * Per-CPU Statistics Counters
+ * Copyright (C) 2026 WhiteBox NE Team
+ *
+ * Packet and match counters for the datapath. Each writer thread
+ * (normally one per CPU, pinned) registers for a private slot and
+ * updates its own copy of every counter with plain stores; no locks,
+ * no atomic read-modify-write and no shared cache lines on the fast
+ * path. Readers sum the copies of all slots.
+ *
+ * Counters are allocated in groups of up to PCPU_STATS_GROUP_MAX, e.g.
+ * packets and bytes of one rule. A group updated with
+ * pcpu_counter_add2() is read consistently: each slot has a sequence
+ * count, so a reader never sees the packets of an update without its
+ * bytes. Threads without a slot fall back to atomic adds on a shared
+ * slot.
+ *
+ * A pcpu_snapshot holds the totals of a group and when they were read;
+ * two snapshots give the delta and the rate, and a stored snapshot
+ * serves as the baseline for "reset counters" without touching the
+ * slots of other threads.
+ */
+
+#ifndef _PCPU_STATS_H
+#define _PCPU_STATS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Counter group handle, index of its first counter; 0 is never valid */
+typedef uint32_t pcpu_counter_t;
+
+#define PCPU_COUNTER_NONE       ((pcpu_counter_t)0)
+#define PCPU_STATS_MAX_SLOTS    64      /* Writer threads with a private slot */
+#define PCPU_STATS_GROUP_MAX    8       /* Counters per group, one cache line */
+#define PCPU_STATS_CHUNK_SHIFT  9       /* 512 counters, 4 KB per slot chunk */
+#define PCPU_STATS_CHUNK_SIZE   (1u << PCPU_STATS_CHUNK_SHIFT)
+#define PCPU_STATS_MAX_CHUNKS   2048    /* 1M counters */
+#define PCPU_STATS_CACHELINE    64
+
+/* Counters of one writer; padded so slots never share a cache line */
+struct pcpu_slot {
+    uint32_t seq;               /* Odd while the owner updates a group */
+    bool active;                /* Storage allocated, summed by readers */
+    bool owned;                 /* Held by a registered thread */
+    uint64_t **chunks;          /* Chunk index -> counters of this slot */
+} __attribute__((aligned(PCPU_STATS_CACHELINE)));
+
+/* Totals of a group at a point in time */
+struct pcpu_snapshot {
+    uint64_t time_ns;
+    uint64_t values[PCPU_STATS_GROUP_MAX];
+};
+
+/* Slot of the calling thread, NULL when unregistered */
+extern __thread struct pcpu_slot *pcpu_self;
+
+pcpu_counter_t pcpu_counter_alloc(uint32_t count);
+void pcpu_counter_free(pcpu_counter_t counter, uint32_t count);
+int pcpu_stats_thread_register(void);
+void pcpu_stats_thread_unregister(void);
+void pcpu_shared_add(pcpu_counter_t counter, uint64_t value);
+
+uint64_t pcpu_counter_sum(pcpu_counter_t counter);
+void pcpu_counter_read(pcpu_counter_t counter, uint32_t count, struct pcpu_snapshot *snap);
+void pcpu_snapshot_delta(const struct pcpu_snapshot *now, const struct pcpu_snapshot *prev,
+                         uint32_t count, struct pcpu_snapshot *delta);
+double pcpu_snapshot_rate(const struct pcpu_snapshot *delta, uint32_t index);
+uint64_t pcpu_stats_now(void);
+uint32_t pcpu_stats_slots(void);
+uint32_t pcpu_stats_allocated(void);
+
+static inline uint64_t *pcpu_slot_counter(struct pcpu_slot *slot, pcpu_counter_t counter)
+{
+    return &slot->chunks[counter >> PCPU_STATS_CHUNK_SHIFT][counter & (PCPU_STATS_CHUNK_SIZE - 1)];
+}
+
+/* Owner-only update, readable by other threads without tearing */
+static inline void pcpu_store_add(uint64_t *p, uint64_t value)
+{
+    __atomic_store_n(p, *p + value, __ATOMIC_RELAXED);
+}
+
+static inline void pcpu_counter_add(pcpu_counter_t counter, uint64_t value)
+{
+    struct pcpu_slot *slot = pcpu_self;
+
+    if (__builtin_expect(slot != NULL, 1)) {
+        pcpu_store_add(pcpu_slot_counter(slot, counter), value);
+    } else {
+        pcpu_shared_add(counter, value);
+    }
+}
+
+static inline void pcpu_counter_inc(pcpu_counter_t counter)
+{
+    pcpu_counter_add(counter, 1);
+}
+
+/* Counters 0 and 1 of a group (packets, bytes) as one update */
+static inline void pcpu_counter_add2(pcpu_counter_t counter, uint64_t value0, uint64_t value1)
+{
+    struct pcpu_slot *slot = pcpu_self;
+
+    if (__builtin_expect(slot == NULL, 0)) {
+        pcpu_shared_add(counter, value0);
+        pcpu_shared_add(counter + 1, value1);
+        return;
+    }
+
+    uint32_t seq = slot->seq;
+    __atomic_store_n(&slot->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    pcpu_store_add(pcpu_slot_counter(slot, counter), value0);
+    pcpu_store_add(pcpu_slot_counter(slot, counter + 1), value1);
+    __atomic_store_n(&slot->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+#endif /* _PCPU_STATS_H */
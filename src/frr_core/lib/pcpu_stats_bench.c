@@ -0,0 +1,224 @@
+/*
+ * Per-CPU Statistics Benchmark
+ * Copyright (C) 2026 WhiteBox NE Team
+ *
+ * Measures the cost of a packet + byte counter update from several
+ * threads on the same rule counters:
+ * - plain uint64 fields (the old layout, loses updates under contention)
+ * - atomic fetch-and-add on shared fields
+ * - per-CPU counters updated from private slots
+ * and the cost of aggregating a group on read.
+ *
+ * Usage: pcpu_stats_bench [-n updates] [-t threads] [-r rules]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include "pcpu_stats.h"
+
+#define BENCH_MAX_THREADS       PCPU_STATS_MAX_SLOTS
+
+/* Old layout: counters next to each other, shared by all threads */
+struct plain_rule {
+    uint64_t packets;
+    uint64_t bytes;
+};
+
+enum bench_mode {
+    BENCH_PLAIN = 0,
+    BENCH_ATOMIC,
+    BENCH_PCPU
+};
+
+struct bench_worker {
+    pthread_t thread;
+    enum bench_mode mode;
+    long updates;
+    uint32_t rules;
+    struct plain_rule *plain;
+    pcpu_counter_t *counters;
+    pthread_barrier_t *barrier;
+};
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void *bench_worker_run(void *arg)
+{
+    struct bench_worker *w = arg;
+    uint32_t r = 0;
+
+    if (w->mode == BENCH_PCPU) {
+        pcpu_stats_thread_register();
+    }
+    pthread_barrier_wait(w->barrier);
+
+    for (long i = 0; i < w->updates; i++) {
+        uint32_t length = 64 + (uint32_t)(i & 1023);
+        switch (w->mode) {
+            case BENCH_PLAIN:
+                w->plain[r].packets++;
+                w->plain[r].bytes += length;
+                /* Keep the compiler from batching the updates */
+                __asm__ volatile("" ::: "memory");
+                break;
+            case BENCH_ATOMIC:
+                __atomic_fetch_add(&w->plain[r].packets, 1, __ATOMIC_RELAXED);
+                __atomic_fetch_add(&w->plain[r].bytes, length, __ATOMIC_RELAXED);
+                break;
+            case BENCH_PCPU:
+                pcpu_counter_add2(w->counters[r], 1, length);
+                break;
+        }
+        if (++r == w->rules) {
+            r = 0;
+        }
+    }
+
+    pthread_barrier_wait(w->barrier);
+    if (w->mode == BENCH_PCPU) {
+        pcpu_stats_thread_unregister();
+    }
+    return NULL;
+}
+
+static void bench_run(enum bench_mode mode, int threads, long updates, uint32_t rules,
+                      pcpu_counter_t *counters)
+{
+    static const char *const names[] = { "plain", "atomic", "per-cpu" };
+    struct bench_worker workers[BENCH_MAX_THREADS];
+    struct plain_rule *plain = calloc(rules, sizeof(*plain));
+    pthread_barrier_t barrier;
+
+    if (!plain) {
+        fprintf(stderr, "Error: Out of memory\n");
+        exit(1);
+    }
+
+    /* Per-CPU totals before the run, so earlier runs do not count */
+    uint64_t before = 0;
+    for (uint32_t r = 0; r < rules; r++) {
+        before += pcpu_counter_sum(counters[r]);
+    }
+
+    pthread_barrier_init(&barrier, NULL, (unsigned)threads + 1);
+    for (int t = 0; t < threads; t++) {
+        workers[t] = (struct bench_worker) {
+            .mode = mode, .updates = updates, .rules = rules,
+            .plain = plain, .counters = counters, .barrier = &barrier,
+        };
+        pthread_create(&workers[t].thread, NULL, bench_worker_run, &workers[t]);
+    }
+    pthread_barrier_wait(&barrier);
+    double start = now_sec();
+    pthread_barrier_wait(&barrier);
+    double elapsed = now_sec() - start;
+    for (int t = 0; t < threads; t++) {
+        pthread_join(workers[t].thread, NULL);
+    }
+    pthread_barrier_destroy(&barrier);
+
+    uint64_t counted = 0;
+    if (mode == BENCH_PCPU) {
+        for (uint32_t r = 0; r < rules; r++) {
+            counted += pcpu_counter_sum(counters[r]);
+        }
+        counted -= before;
+    } else {
+        for (uint32_t r = 0; r < rules; r++) {
+            counted += plain[r].packets;
+        }
+    }
+
+    uint64_t expected = (uint64_t)threads * (uint64_t)updates;
+    printf("%-8s %8d %14.2f %12.2f %14lu %10.4f%%\n", names[mode], threads,
+           expected / elapsed / 1e6, elapsed * 1e9 * threads / expected,
+           expected - counted, 100.0 * (expected - counted) / expected);
+    free(plain);
+}
+
+/* Aggregation cost of a packets + bytes group with every slot active */
+static void read_run(uint32_t rules, pcpu_counter_t *counters, long reads, int slots)
+{
+    struct pcpu_snapshot snap;
+    uint64_t sink = 0;
+
+    double start = now_sec();
+    for (long i = 0; i < reads; i++) {
+        pcpu_counter_read(counters[i % rules], 2, &snap);
+        sink += snap.values[0];
+    }
+    double elapsed = now_sec() - start;
+
+    printf("\nRead: %ld group reads over %d slots: %.1f ns/read (sum %lu)\n", reads, slots,
+           elapsed * 1e9 / reads, sink);
+}
+
+int main(int argc, char *argv[])
+{
+    long updates = 20000000;
+    int max_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    uint32_t rules = 16;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:t:r:")) != -1) {
+        switch (opt) {
+            case 'n':
+                updates = atol(optarg);
+                break;
+            case 't':
+                max_threads = atoi(optarg);
+                break;
+            case 'r':
+                rules = (uint32_t)atoi(optarg);
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-n updates] [-t threads] [-r rules]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (max_threads < 1) {
+        max_threads = 1;
+    }
+    if (max_threads > BENCH_MAX_THREADS) {
+        max_threads = BENCH_MAX_THREADS;
+    }
+    if (rules == 0) {
+        rules = 1;
+    }
+
+    pcpu_counter_t *counters = calloc(rules, sizeof(*counters));
+    if (!counters) {
+        fprintf(stderr, "Error: Out of memory\n");
+        return 1;
+    }
+    for (uint32_t r = 0; r < rules; r++) {
+        counters[r] = pcpu_counter_alloc(2);
+    }
+
+    printf("Counter update: packets + bytes of %u rules, %ld updates per thread\n\n", rules,
+           updates);
+    printf("%-8s %8s %14s %12s %14s %11s\n", "Mode", "Threads", "M updates/s", "ns/update",
+           "Lost updates", "Lost");
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        for (int mode = BENCH_PLAIN; mode <= BENCH_PCPU; mode++) {
+            bench_run((enum bench_mode)mode, threads, updates, rules, counters);
+        }
+        if (threads < max_threads && threads * 2 > max_threads) {
+            threads = max_threads / 2;
+        }
+    }
+
+    read_run(rules, counters, updates / 10, max_threads);
+    return 0;
+}
@@ -0,0 +1,106 @@
+/*
+ * Batched 5-tuple Matching
+ * Copyright (C) 2026 WhiteBox NE Team
+ *
+ * First-match classification of a burst of parsed IPv4 headers against
+ * a small rule table, for ACLs, traffic classifiers and PBR policies
+ * too small to be worth an index. Rules are address mask/value pairs,
+ * port ranges and a protocol mask/value; each carries the result
+ * reported for packets it matches first.
+ *
+ * The vector kernels take one rule at a time and test it against 8
+ * (AVX2) or 4 (SSE4.2) packets per instruction, stopping once every
+ * packet of the burst has matched. PKT_MATCH_AUTO runs AVX2 where the
+ * CPU has it and the scalar kernel, packet by packet, elsewhere; both
+ * give the same results. SSE4.2 runs only when asked for, as it is no
+ * faster than scalar on these tables.
+ */
+
+#ifndef _PKT_MATCH_H
+#define _PKT_MATCH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PKT_MATCH_MAX_RULES     64
+#define PKT_MATCH_BURST         32      /* Packets per kernel call */
+#define PKT_MATCH_NONE          (-1)
+
+typedef enum {
+    PKT_MATCH_AUTO = 0,         /* AVX2 if the CPU supports it, else scalar */
+    PKT_MATCH_SCALAR,
+    PKT_MATCH_SSE42,
+    PKT_MATCH_AVX2,
+} pkt_match_impl_t;
+
+/* One rule; addresses in host order, stored masked */
+struct pkt_match_rule {
+    uint32_t src;
+    uint32_t src_mask;
+    uint32_t dst;
+    uint32_t dst_mask;
+    uint16_t src_port[2];       /* Inclusive low, high */
+    uint16_t dst_port[2];
+    uint8_t protocol;
+    uint8_t protocol_mask;      /* 0 for any protocol */
+    uint16_t result;
+};
+
+/* Rule as the kernels read it: every field widened to a 32-bit lane */
+struct pkt_match_entry {
+    uint32_t src;
+    uint32_t src_mask;
+    uint32_t dst;
+    uint32_t dst_mask;
+    uint32_t src_port_lo;
+    uint32_t src_port_hi;
+    uint32_t dst_port_lo;
+    uint32_t dst_port_hi;
+    uint32_t protocol;
+    uint32_t protocol_mask;
+    int32_t result;
+} __attribute__((aligned(64)));
+
+/* Rules in matching order */
+struct pkt_match_table {
+    struct pkt_match_entry entries[PKT_MATCH_MAX_RULES];
+    uint32_t count;
+};
+
+/* Headers of a burst, one array per field for the vector kernels */
+struct pkt_match_burst {
+    uint32_t src[PKT_MATCH_BURST] __attribute__((aligned(32)));
+    uint32_t dst[PKT_MATCH_BURST] __attribute__((aligned(32)));
+    uint32_t src_port[PKT_MATCH_BURST] __attribute__((aligned(32)));
+    uint32_t dst_port[PKT_MATCH_BURST] __attribute__((aligned(32)));
+    uint32_t protocol[PKT_MATCH_BURST] __attribute__((aligned(32)));
+    uint32_t count;
+};
+
+static inline void pkt_match_init(struct pkt_match_table *table)
+{
+    table->count = 0;
+}
+
+/* Stores a header at lane n of a burst */
+static inline void pkt_match_burst_set(struct pkt_match_burst *burst, uint32_t n, uint32_t src,
+                                       uint32_t dst, uint16_t src_port, uint16_t dst_port,
+                                       uint8_t protocol)
+{
+    burst->src[n] = src;
+    burst->dst[n] = dst;
+    burst->src_port[n] = src_port;
+    burst->dst_port[n] = dst_port;
+    burst->protocol[n] = protocol;
+}
+
+int pkt_match_add(struct pkt_match_table *table, const struct pkt_match_rule *rule);
+void pkt_match_burst(const struct pkt_match_table *table, const struct pkt_match_burst *burst,
+                     int *first);
+void pkt_match_burst_impl(const struct pkt_match_table *table, const struct pkt_match_burst *burst,
+                          pkt_match_impl_t impl, int *first);
+pkt_match_impl_t pkt_match_best(void);
+bool pkt_match_supported(pkt_match_impl_t impl);
+const char *pkt_match_impl_name(pkt_match_impl_t impl);
+
+#endif /* _PKT_MATCH_H */
@@ -0,0 +1,168 @@
+/*
+ * Quiescent-State-Based Reclamation
+ * Copyright (C) 2026 WhiteBox NE Team
+ *
+ * This module provides deferred freeing for RCU-style updates including:
+ * - Reader registration, one padded state per reader thread
+ * - A global epoch advanced by every retire
+ * - Retired versions tagged with their epoch, freed once every online
+ *   reader has seen that epoch
+ *
+ * Registration, retire and reclaim take a mutex; readers do not.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "qsbr.h"
+
+/* Retired version waiting for its grace period */
+struct qsbr_retired {
+    void *ptr;
+    void (*free_fn)(void *);
+    uint64_t epoch;             /* Freed once every online reader has seen it */
+};
+
+static struct qsbr_reader qsbr_readers[QSBR_MAX_READERS];
+static struct qsbr_retired *qsbr_list = NULL;
+static uint32_t qsbr_count = 0;
+static uint32_t qsbr_capacity = 0;
+static pthread_mutex_t qsbr_lock = PTHREAD_MUTEX_INITIALIZER;
+
+__thread struct qsbr_reader *qsbr_self = NULL;
+uint64_t qsbr_epoch = 1;
+
+/*
+ * Make the calling thread a reader, online from now on. Returns -1 when
+ * all reader states are taken.
+ */
+int qsbr_thread_register(void)
+{
+    if (qsbr_self) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&qsbr_lock);
+    for (int i = 0; i < QSBR_MAX_READERS; i++) {
+        if (!qsbr_readers[i].owned) {
+            qsbr_readers[i].owned = true;
+            qsbr_self = &qsbr_readers[i];
+            break;
+        }
+    }
+    pthread_mutex_unlock(&qsbr_lock);
+
+    if (!qsbr_self) {
+        return -1;
+    }
+    qsbr_online();
+    return 0;
+}
+
+void qsbr_thread_unregister(void)
+{
+    struct qsbr_reader *reader = qsbr_self;
+
+    if (!reader) {
+        return;
+    }
+    qsbr_offline();
+    pthread_mutex_lock(&qsbr_lock);
+    reader->owned = false;
+    pthread_mutex_unlock(&qsbr_lock);
+    qsbr_self = NULL;
+}
+
+/* Holds no references until qsbr_online(); writers stop waiting for it */
+void qsbr_offline(void)
+{
+    if (qsbr_self) {
+        __atomic_store_n(&qsbr_self->seen, 0, __ATOMIC_RELEASE);
+    }
+}
+
+/* Oldest epoch some online reader may still be in, under the lock */
+static uint64_t qsbr_oldest(void)
+{
+    uint64_t oldest = UINT64_MAX;
+
+    for (int i = 0; i < QSBR_MAX_READERS; i++) {
+        uint64_t seen = __atomic_load_n(&qsbr_readers[i].seen, __ATOMIC_SEQ_CST);
+        if (seen && seen < oldest) {
+            oldest = seen;
+        }
+    }
+    return oldest;
+}
+
+/* Free the retired versions every reader is past, under the lock */
+static uint32_t qsbr_collect(void)
+{
+    uint64_t oldest = qsbr_oldest();
+    uint32_t kept = 0, freed = 0;
+
+    for (uint32_t i = 0; i < qsbr_count; i++) {
+        struct qsbr_retired *item = &qsbr_list[i];
+        if (item->epoch <= oldest) {
+            item->free_fn(item->ptr);
+            freed++;
+        } else {
+            qsbr_list[kept++] = *item;
+        }
+    }
+    qsbr_count = kept;
+    return freed;
+}
+
+/*
+ * Free ptr with free_fn once no reader can hold it. The caller must have
+ * unpublished ptr before the call. Runs the collection of earlier
+ * retires; frees immediately when no reader is online. When memory for
+ * the retire list runs out, ptr is leaked rather than freed early.
+ */
+void qsbr_retire(void *ptr, void (*free_fn)(void *))
+{
+    if (!ptr) {
+        return;
+    }
+
+    pthread_mutex_lock(&qsbr_lock);
+    uint64_t epoch = __atomic_add_fetch(&qsbr_epoch, 1, __ATOMIC_SEQ_CST);
+
+    if (qsbr_count == qsbr_capacity) {
+        uint32_t capacity = qsbr_capacity ? qsbr_capacity * 2 : 16;
+        struct qsbr_retired *list = realloc(qsbr_list, capacity * sizeof(*list));
+        if (!list) {
+            qsbr_collect();
+            pthread_mutex_unlock(&qsbr_lock);
+            fprintf(stderr, "qsbr: out of memory, leaking a retired version\n");
+            return;
+        }
+        qsbr_list = list;
+        qsbr_capacity = capacity;
+    }
+    qsbr_list[qsbr_count++] = (struct qsbr_retired){ ptr, free_fn, epoch };
+    qsbr_collect();
+    pthread_mutex_unlock(&qsbr_lock);
+}
+
+/* Free what has passed its grace period; returns the number freed */
+uint32_t qsbr_reclaim(void)
+{
+    pthread_mutex_lock(&qsbr_lock);
+    uint32_t freed = qsbr_collect();
+    pthread_mutex_unlock(&qsbr_lock);
+    return freed;
+}
+
+/* Retired versions still waiting for a reader */
+uint32_t qsbr_pending(void)
+{
+    pthread_mutex_lock(&qsbr_lock);
+    uint32_t count = qsbr_count;
+    pthread_mutex_unlock(&qsbr_lock);
+    return count;
+}
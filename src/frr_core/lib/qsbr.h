@@ -0,0 +1,66 @@
+/*
+ * Quiescent-State-Based Reclamation
+ * Copyright (C) 2026 WhiteBox NE Team
+ *
+ * RCU-style publication of datapath structures. A writer builds a new
+ * version, swaps the published pointer and retires the old version; it
+ * is freed once every registered reader thread has passed a quiescent
+ * state, i.e. has announced that it holds no references from before
+ * the swap. Readers never lock or wait: they load the pointer with
+ * acquire semantics and call qsbr_quiescent() between units of work,
+ * e.g. after every packet batch.
+ *
+ * Writers never wait either; retired versions are freed by later
+ * retire or reclaim calls. A reader that will be idle for long should
+ * go offline so it does not hold back reclamation.
+ */
+
+#ifndef _QSBR_H
+#define _QSBR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define QSBR_MAX_READERS        64
+#define QSBR_CACHELINE          64
+
+/* Reader state; padded so readers never share a cache line */
+struct qsbr_reader {
+    uint64_t seen;              /* Epoch at the last quiescent state, 0 when offline */
+    bool owned;
+} __attribute__((aligned(QSBR_CACHELINE)));
+
+/* Reader of the calling thread, NULL when unregistered */
+extern __thread struct qsbr_reader *qsbr_self;
+extern uint64_t qsbr_epoch;
+
+int qsbr_thread_register(void);
+void qsbr_thread_unregister(void);
+void qsbr_offline(void);
+void qsbr_retire(void *ptr, void (*free_fn)(void *));
+uint32_t qsbr_reclaim(void);
+uint32_t qsbr_pending(void);
+
+/* No references to retired versions are held past this point */
+static inline void qsbr_quiescent(void)
+{
+    struct qsbr_reader *reader = qsbr_self;
+
+    if (reader) {
+        __atomic_store_n(&reader->seen, __atomic_load_n(&qsbr_epoch, __ATOMIC_SEQ_CST),
+                         __ATOMIC_SEQ_CST);
+    }
+}
+
+/*
+ * Back from qsbr_offline(); references may be taken again. The fence
+ * orders the announcement before the first pointer load, so a writer
+ * either sees this reader or the reader sees the new version.
+ */
+static inline void qsbr_online(void)
+{
+    qsbr_quiescent();
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+#endif /* _QSBR_H */
@@ -0,0 +1,208 @@
+/*
+ * Typed Slab Object Store
+ * Copyright (C) 2026 WhiteBox NE Team
+ *
+ * This module provides the shared object store including:
+ * - Chunked slot allocation growing with the configuration
+ * - LIFO free list, freed slots are reused before new ones
+ * - Constant-time free: each slot header records its own index
+ * - Generation-checked handles for references that may go stale
+ * - Slot-order iteration of live objects
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "slab.h"
+
+/* Slot header; an odd generation marks a live object */
+struct slab_slot {
+    uint32_t generation;
+    uint32_t next_free;         /* Next free slot index + 1 */
+    uint32_t index;             /* Own slot index, set when first handed out */
+};
+
+#define SLAB_ALIGN              16
+#define SLAB_HEADER_SIZE        ((sizeof(struct slab_slot) + SLAB_ALIGN - 1) & ~(size_t)(SLAB_ALIGN - 1))
+
+static void slab_setup(struct slab *slab)
+{
+    slab->stride = (SLAB_HEADER_SIZE + slab->obj_size + SLAB_ALIGN - 1) & ~(size_t)(SLAB_ALIGN - 1);
+    slab->per_chunk = (uint32_t)(SLAB_CHUNK_BYTES / slab->stride);
+    if (slab->per_chunk < 8) {
+        slab->per_chunk = 8;
+    }
+}
+
+static inline struct slab_slot *slab_slot(const struct slab *slab, uint32_t index)
+{
+    return (struct slab_slot *)(slab->chunks[index / slab->per_chunk] +
+                                (size_t)(index % slab->per_chunk) * slab->stride);
+}
+
+static inline void *slot_object(struct slab_slot *slot)
+{
+    return (unsigned char *)slot + SLAB_HEADER_SIZE;
+}
+
+static inline struct slab_slot *object_slot(const void *obj)
+{
+    return (struct slab_slot *)((unsigned char *)obj - SLAB_HEADER_SIZE);
+}
+
+static int slab_grow(struct slab *slab)
+{
+    if (slab->chunk_count == slab->chunk_capacity) {
+        uint32_t cap = slab->chunk_capacity ? slab->chunk_capacity * 2 : 4;
+        unsigned char **chunks = realloc(slab->chunks, cap * sizeof(*chunks));
+        if (!chunks) {
+            return -1;
+        }
+        slab->chunks = chunks;
+        slab->chunk_capacity = cap;
+    }
+
+    unsigned char *chunk = calloc(slab->per_chunk, slab->stride);
+    if (!chunk) {
+        return -1;
+    }
+    slab->chunks[slab->chunk_count++] = chunk;
+    return 0;
+}
+
+/*
+ * Allocate a zeroed object. The handle, if requested, stays valid until
+ * the object is freed.
+ */
+void *slab_alloc(struct slab *slab, slab_handle_t *handle)
+{
+    if (slab->stride == 0) {
+        slab_setup(slab);
+    }
+
+    uint32_t index;
+    if (slab->free_head) {
+        index = slab->free_head - 1;
+        slab->free_head = slab_slot(slab, index)->next_free;
+    } else {
+        if (slab->slots == slab->chunk_count * slab->per_chunk && slab_grow(slab) != 0) {
+            return NULL;
+        }
+        index = slab->slots++;
+        slab_slot(slab, index)->index = index;
+    }
+
+    struct slab_slot *slot = slab_slot(slab, index);
+    slot->generation++;
+    slot->next_free = 0;
+    slab->used++;
+
+    void *obj = slot_object(slot);
+    memset(obj, 0, slab->obj_size);
+    if (handle) {
+        *handle = ((slab_handle_t)slot->generation << 32) | (index + 1);
+    }
+    return obj;
+}
+
+/* Index of the slot holding an object, from its header; -1 if not of this store */
+static int64_t slab_index(const struct slab *slab, const void *obj)
+{
+    struct slab_slot *slot = object_slot(obj);
+    uint32_t index = slot->index;
+
+    if (index >= slab->slots || slab_slot(slab, index) != slot) {
+        return -1;
+    }
+    return index;
+}
+
+/*
+ * Free an object. Its handles resolve to NULL from now on.
+ */
+void slab_free(struct slab *slab, void *obj)
+{
+    if (!obj) {
+        return;
+    }
+
+    int64_t index = slab_index(slab, obj);
+    struct slab_slot *slot = object_slot(obj);
+    if (index < 0 || !(slot->generation & 1)) {
+        return;
+    }
+
+    slot->generation++;
+    slot->next_free = slab->free_head;
+    slab->free_head = (uint32_t)index + 1;
+    slab->used--;
+}
+
+void *slab_get(const struct slab *slab, slab_handle_t handle)
+{
+    uint32_t index = (uint32_t)handle;
+    if (index == 0 || index > slab->slots) {
+        return NULL;
+    }
+
+    struct slab_slot *slot = slab_slot(slab, index - 1);
+    if (slot->generation != (uint32_t)(handle >> 32) || !(slot->generation & 1)) {
+        return NULL;
+    }
+    return slot_object(slot);
+}
+
+slab_handle_t slab_handle(const struct slab *slab, const void *obj)
+{
+    if (!obj) {
+        return SLAB_HANDLE_NONE;
+    }
+
+    int64_t index = slab_index(slab, obj);
+    if (index < 0) {
+        return SLAB_HANDLE_NONE;
+    }
+    return ((slab_handle_t)object_slot(obj)->generation << 32) | (uint32_t)(index + 1);
+}
+
+/*
+ * Next live object at or after *cursor; the cursor is advanced past it.
+ */
+void *slab_next(const struct slab *slab, uint32_t *cursor)
+{
+    while (*cursor < slab->slots) {
+        struct slab_slot *slot = slab_slot(slab, (*cursor)++);
+        if (slot->generation & 1) {
+            return slot_object(slot);
+        }
+    }
+    return NULL;
+}
+
+uint32_t slab_count(const struct slab *slab)
+{
+    return slab->used;
+}
+
+/* Bytes held by the store */
+size_t slab_memory(const struct slab *slab)
+{
+    return (size_t)slab->chunk_count * slab->per_chunk * slab->stride +
+           slab->chunk_capacity * sizeof(*slab->chunks);
+}
+
+void slab_destroy(struct slab *slab)
+{
+    for (uint32_t c = 0; c < slab->chunk_count; c++) {
+        free(slab->chunks[c]);
+    }
+    free(slab->chunks);
+    slab->chunks = NULL;
+    slab->chunk_count = 0;
+    slab->chunk_capacity = 0;
+    slab->slots = 0;
+    slab->free_head = 0;
+    slab->used = 0;
+}
@@ -0,0 +1,58 @@
+/*
+ * Typed Slab Object Store
+ * Copyright (C) 2026 WhiteBox NE Team
+ *
+ * Object store replacing the fixed static configuration arrays. Objects
+ * live in chunks that are allocated as the configuration grows and never
+ * move, so pointers stay valid until the object is freed. Freed slots go
+ * to a free list and are reused. A handle carries the slot generation;
+ * resolving a handle to a freed or reused slot returns NULL.
+ *
+ * Stores are not locked; each one belongs to a single module and is
+ * used from the CLI thread.
+ */
+
+#ifndef _SLAB_H
+#define _SLAB_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Handle: slot generation << 32 | (slot index + 1), 0 is never valid */
+typedef uint64_t slab_handle_t;
+
+#define SLAB_HANDLE_NONE        ((slab_handle_t)0)
+#define SLAB_CHUNK_BYTES        16384   /* Target chunk size */
+
+struct slab {
+    const char *name;
+    size_t obj_size;
+    size_t stride;              /* Slot size: header plus object, aligned */
+    uint32_t per_chunk;         /* Slots per chunk */
+    uint32_t chunk_count;
+    uint32_t chunk_capacity;
+    unsigned char **chunks;
+    uint32_t slots;             /* Slots handed out so far */
+    uint32_t free_head;         /* Free slot index + 1, 0 if empty */
+    uint32_t used;              /* Live objects */
+};
+
+/* Static initializer: static struct slab vlan_slab = SLAB_INIT("vlan", struct vlan_config); */
+#define SLAB_INIT(_name, _type) \
+    { .name = _name, .obj_size = sizeof(_type) }
+
+void *slab_alloc(struct slab *slab, slab_handle_t *handle);
+void slab_free(struct slab *slab, void *obj);
+void *slab_get(const struct slab *slab, slab_handle_t handle);
+slab_handle_t slab_handle(const struct slab *slab, const void *obj);
+void *slab_next(const struct slab *slab, uint32_t *cursor);
+uint32_t slab_count(const struct slab *slab);
+size_t slab_memory(const struct slab *slab);
+void slab_destroy(struct slab *slab);
+
+/* Iterate live objects in slot order */
+#define SLAB_FOREACH(_slab, _cursor, _obj) \
+    for (uint32_t _cursor = 0; ((_obj) = slab_next((_slab), &_cursor)) != NULL;)
+
+#endif /* _SLAB_H */
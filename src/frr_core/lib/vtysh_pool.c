@@ -0,0 +1,672 @@
+/*
+ * Persistent vtysh Session Pool
+ * Copyright (C) 2026 WhiteBox NE Team
+ *
+ * This module provides a pool of persistent FRR VTY connections including:
+ * - Per-daemon connections over the <daemon>.vty unix sockets
+ * - Request multiplexing through a bounded per-daemon queue
+ * - Pipelined command blocks (all lines written before replies are read)
+ * - Reconnect-on-failure with a single retry for unsent requests
+ *
+ * Command blocks are routed to a daemon from their content. Blocks that
+ * span several daemons or cannot be classified are returned with
+ * VTYSH_POOL_EUNROUTABLE so the caller can fall back to a vtysh process.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "vtysh_pool.h"
+
+/* FRR daemons reachable over VTY sockets */
+typedef enum {
+    VTYSH_D_ZEBRA = 0,
+    VTYSH_D_STATICD,
+    VTYSH_D_BGPD,
+    VTYSH_D_OSPFD,
+    VTYSH_D_OSPF6D,
+    VTYSH_D_ISISD,
+    VTYSH_D_RIPD,
+    VTYSH_D_MAX
+} vtysh_daemon_t;
+
+static const char *vtysh_daemon_names[VTYSH_D_MAX] = {
+    "zebra", "staticd", "bgpd", "ospfd", "ospf6d", "isisd", "ripd"
+};
+
+/* Command prefix to daemon routing (longest prefixes first) */
+static const struct {
+    const char *prefix;
+    vtysh_daemon_t daemon;
+    bool context;           /* Line enters a daemon-owned config node */
+} vtysh_routes[] = {
+    { "router bgp",        VTYSH_D_BGPD,    true  },
+    { "show ip bgp",       VTYSH_D_BGPD,    false },
+    { "show bgp",          VTYSH_D_BGPD,    false },
+    { "clear ip bgp",      VTYSH_D_BGPD,    false },
+    { "clear bgp",         VTYSH_D_BGPD,    false },
+    { "router ospf6",      VTYSH_D_OSPF6D,  true  },
+    { "ipv6 ospf6",        VTYSH_D_OSPF6D,  false },
+    { "show ipv6 ospf6",   VTYSH_D_OSPF6D,  false },
+    { "router ospf",       VTYSH_D_OSPFD,   true  },
+    { "ip ospf",           VTYSH_D_OSPFD,   false },
+    { "show ip ospf",      VTYSH_D_OSPFD,   false },
+    { "router isis",       VTYSH_D_ISISD,   true  },
+    { "ip router isis",    VTYSH_D_ISISD,   false },
+    { "ipv6 router isis",  VTYSH_D_ISISD,   false },
+    { "isis ",             VTYSH_D_ISISD,   false },
+    { "show isis",         VTYSH_D_ISISD,   false },
+    { "router rip",        VTYSH_D_RIPD,    true  },
+    { "ip rip",            VTYSH_D_RIPD,    false },
+    { "show ip rip",       VTYSH_D_RIPD,    false },
+    { "ip route ",         VTYSH_D_STATICD, false },
+    { "ipv6 route ",       VTYSH_D_STATICD, false },
+    { "show ip route",     VTYSH_D_ZEBRA,   false },
+    { "show ipv6 route",   VTYSH_D_ZEBRA,   false },
+    { "show interface",    VTYSH_D_ZEBRA,   false },
+    { "ip address",        VTYSH_D_ZEBRA,   false },
+    { "ipv6 address",      VTYSH_D_ZEBRA,   false },
+};
+
+#define VTYSH_ROUTE_COUNT (sizeof(vtysh_routes) / sizeof(vtysh_routes[0]))
+
+/* Interface context: unmatched lines belong to zebra */
+#define VTYSH_CTX_NONE      (-1)
+#define VTYSH_CTX_INTERFACE (-2)
+
+/* Queued request, lives on the caller's stack until completed */
+struct vtysh_request {
+    const char *cmd;
+    char *output;
+    size_t output_size;
+    int result;
+    bool done;
+    pthread_cond_t cond;
+};
+
+struct vtysh_daemon;
+
+/* One persistent VTY connection, owned by one worker thread */
+struct vtysh_conn {
+    struct vtysh_daemon *daemon;
+    int fd;
+    bool connected_once;
+    pthread_t thread;
+};
+
+/* Per-daemon bounded queue and connection set */
+struct vtysh_daemon {
+    vtysh_daemon_t id;
+    char path[108];
+    bool available;
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    struct vtysh_request **ring;
+    unsigned int head;
+    unsigned int count;
+    struct vtysh_conn *conns;
+    int conn_count;
+};
+
+static struct vtysh_pool_config pool_config;
+static struct vtysh_daemon pool_daemons[VTYSH_D_MAX];
+static struct vtysh_pool_stats pool_stats;
+static pthread_mutex_t pool_stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static bool pool_running = false;
+
+static void pool_stat_add(uint64_t *counter)
+{
+    pthread_mutex_lock(&pool_stats_lock);
+    (*counter)++;
+    pthread_mutex_unlock(&pool_stats_lock);
+}
+
+static bool line_has_prefix(const char *line, size_t len, const char *prefix)
+{
+    size_t plen = strlen(prefix);
+    return len >= plen && strncmp(line, prefix, plen) == 0;
+}
+
+static bool line_is(const char *line, size_t len, const char *word)
+{
+    return len == strlen(word) && strncmp(line, word, len) == 0;
+}
+
+/*
+ * Pick the daemon that owns every line of a command block.
+ * Returns -1 when the block is unroutable.
+ */
+static int vtysh_route_block(const char *cmd)
+{
+    int wanted = VTYSH_CTX_NONE;
+    int context = VTYSH_CTX_NONE;
+    const char *p = cmd;
+
+    while (*p) {
+        const char *eol = strchr(p, '\n');
+        size_t len = eol ? (size_t)(eol - p) : strlen(p);
+        const char *line = p;
+        p = eol ? eol + 1 : p + len;
+
+        while (len && (*line == ' ' || *line == '\t')) {
+            line++;
+            len--;
+        }
+        while (len && (line[len - 1] == ' ' || line[len - 1] == '\r')) {
+            len--;
+        }
+
+        if (len == 0 || line[0] == '!' ||
+            line_has_prefix(line, len, "configure") ||
+            line_has_prefix(line, len, "address-family") ||
+            line_is(line, len, "exit-address-family")) {
+            continue;
+        }
+        if (line_is(line, len, "exit") || line_is(line, len, "quit") ||
+            line_is(line, len, "end")) {
+            context = VTYSH_CTX_NONE;
+            continue;
+        }
+        if (line_has_prefix(line, len, "no ")) {
+            line += 3;
+            len -= 3;
+        }
+
+        int daemon = VTYSH_CTX_NONE;
+        for (size_t i = 0; i < VTYSH_ROUTE_COUNT; i++) {
+            if (line_has_prefix(line, len, vtysh_routes[i].prefix)) {
+                daemon = vtysh_routes[i].daemon;
+                if (vtysh_routes[i].context) {
+                    context = daemon;
+                }
+                break;
+            }
+        }
+
+        if (daemon == VTYSH_CTX_NONE) {
+            if (line_has_prefix(line, len, "interface ")) {
+                context = VTYSH_CTX_INTERFACE;
+                continue;
+            }
+            if (context == VTYSH_CTX_INTERFACE) {
+                daemon = VTYSH_D_ZEBRA;
+            } else if (context != VTYSH_CTX_NONE) {
+                daemon = context;
+            } else {
+                return -1;
+            }
+        }
+
+        if (wanted != VTYSH_CTX_NONE && wanted != daemon) {
+            return -1;
+        }
+        wanted = daemon;
+    }
+
+    return wanted == VTYSH_CTX_NONE ? VTYSH_D_ZEBRA : wanted;
+}
+
+static int64_t monotonic_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void vtysh_conn_close(struct vtysh_conn *conn)
+{
+    if (conn->fd >= 0) {
+        close(conn->fd);
+        conn->fd = -1;
+    }
+}
+
+/*
+ * Connect to the daemon socket and enter enable mode.
+ */
+static int vtysh_conn_open(struct vtysh_conn *conn)
+{
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, conn->daemon->path, sizeof(addr.sun_path) - 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    conn->fd = fd;
+    return 0;
+}
+
+/*
+ * Convert a newline separated block into NUL terminated VTY requests.
+ * Trailing exits are replaced by a single "end" so the session is left
+ * in enable mode for the next request.
+ */
+static char *vtysh_build_request(const char *cmd, size_t *req_len, int *line_count,
+                                 bool *configuring_out)
+{
+    size_t cap = strlen(cmd) + 8;
+    char *req = malloc(cap);
+    if (!req) {
+        return NULL;
+    }
+
+    size_t len = 0;
+    size_t trailing_exit_len = 0;
+    int lines = 0;
+    int trailing_exits = 0;
+    bool configuring = false;
+    const char *p = cmd;
+
+    while (*p) {
+        const char *eol = strchr(p, '\n');
+        size_t n = eol ? (size_t)(eol - p) : strlen(p);
+        const char *line = p;
+        p = eol ? eol + 1 : p + n;
+
+        while (n && (*line == ' ' || *line == '\t')) {
+            line++;
+            n--;
+        }
+        while (n && (line[n - 1] == ' ' || line[n - 1] == '\r')) {
+            n--;
+        }
+        if (n == 0) {
+            continue;
+        }
+
+        if (line_has_prefix(line, n, "configure")) {
+            configuring = true;
+        }
+        if (line_is(line, n, "exit") || line_is(line, n, "quit") || line_is(line, n, "end")) {
+            trailing_exits++;
+            trailing_exit_len += n + 1;
+        } else {
+            trailing_exits = 0;
+            trailing_exit_len = 0;
+        }
+
+        memcpy(req + len, line, n);
+        len += n;
+        req[len++] = '\0';
+        lines++;
+    }
+
+    if (configuring) {
+        len -= trailing_exit_len;
+        lines -= trailing_exits;
+        memcpy(req + len, "end", 4);
+        len += 4;
+        lines++;
+    }
+
+    *req_len = len;
+    *line_count = lines;
+    *configuring_out = configuring;
+    return req;
+}
+
+/*
+ * Run one request over an open connection.
+ * Requests are pipelined: all lines are written while replies are read.
+ * Each reply ends with three NUL bytes followed by the CMD_* status.
+ */
+static int vtysh_conn_run(struct vtysh_conn *conn, const char *cmd,
+                          char *output, size_t output_size, bool *acked)
+{
+    size_t req_len;
+    int line_count;
+    bool configuring;
+    char *req = vtysh_build_request(cmd, &req_len, &line_count, &configuring);
+    if (!req) {
+        return VTYSH_POOL_EIO;
+    }
+
+    size_t sent = 0;
+    size_t out_len = 0;
+    int replies = 0;
+    int zeros = 0;
+    int result = 0;
+    int64_t deadline = monotonic_ms() + pool_config.timeout_ms;
+
+    *acked = false;
+    if (output && output_size) {
+        output[0] = '\0';
+    }
+
+    while (replies < line_count) {
+        struct pollfd pfd = { .fd = conn->fd, .events = POLLIN };
+        if (sent < req_len) {
+            pfd.events |= POLLOUT;
+        }
+
+        int wait = (int)(deadline - monotonic_ms());
+        if (wait <= 0) {
+            result = VTYSH_POOL_ETIMEDOUT;
+            break;
+        }
+        int rc = poll(&pfd, 1, wait);
+        if (rc < 0 && errno == EINTR) {
+            continue;
+        }
+        if (rc <= 0) {
+            result = rc == 0 ? VTYSH_POOL_ETIMEDOUT : VTYSH_POOL_EIO;
+            break;
+        }
+
+        if ((pfd.revents & POLLOUT) && sent < req_len) {
+            ssize_t n = send(conn->fd, req + sent, req_len - sent, MSG_NOSIGNAL);
+            if (n < 0 && errno != EAGAIN && errno != EINTR) {
+                result = VTYSH_POOL_EIO;
+                break;
+            }
+            if (n > 0) {
+                sent += n;
+            }
+        }
+
+        if (pfd.revents & (POLLIN | POLLHUP | POLLERR)) {
+            char buf[4096];
+            ssize_t n = recv(conn->fd, buf, sizeof(buf), 0);
+            if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR)) {
+                result = VTYSH_POOL_EIO;
+                break;
+            }
+
+            for (ssize_t i = 0; i < n; i++) {
+                if (zeros == 3) {
+                    /* Status byte; a failing "end" is not the caller's error */
+                    int status = (unsigned char)buf[i];
+                    bool is_end = configuring && replies == line_count - 1;
+                    if (status != 0 && result == 0 && !is_end) {
+                        result = status;
+                    }
+                    replies++;
+                    zeros = 0;
+                    *acked = true;
+                } else if (buf[i] == '\0') {
+                    zeros++;
+                } else {
+                    zeros = 0;
+                    if (output && out_len + 1 < output_size) {
+                        output[out_len++] = buf[i];
+                    }
+                }
+            }
+            if (output && output_size) {
+                output[out_len < output_size ? out_len : output_size - 1] = '\0';
+            }
+        }
+    }
+
+    free(req);
+    return result;
+}
+
+/*
+ * Worker thread: owns one connection and serves the daemon queue.
+ */
+static void *vtysh_conn_worker(void *arg)
+{
+    struct vtysh_conn *conn = arg;
+    struct vtysh_daemon *d = conn->daemon;
+
+    for (;;) {
+        pthread_mutex_lock(&d->lock);
+        while (d->count == 0 && pool_running) {
+            pthread_cond_wait(&d->not_empty, &d->lock);
+        }
+        if (d->count == 0 && !pool_running) {
+            pthread_mutex_unlock(&d->lock);
+            break;
+        }
+        struct vtysh_request *req = d->ring[d->head];
+        d->head = (d->head + 1) % pool_config.queue_depth;
+        d->count--;
+        pthread_cond_signal(&d->not_full);
+        pthread_mutex_unlock(&d->lock);
+
+        int result = VTYSH_POOL_EIO;
+        for (int attempt = 0; attempt < 2; attempt++) {
+            if (conn->fd < 0) {
+                if (vtysh_conn_open(conn) != 0) {
+                    continue;
+                }
+                if (conn->connected_once) {
+                    pool_stat_add(&pool_stats.reconnects);
+                }
+                conn->connected_once = true;
+                bool acked;
+                vtysh_conn_run(conn, "enable", NULL, 0, &acked);
+            }
+
+            bool acked = false;
+            result = vtysh_conn_run(conn, req->cmd, req->output, req->output_size, &acked);
+            if (result != VTYSH_POOL_EIO && result != VTYSH_POOL_ETIMEDOUT) {
+                break;
+            }
+
+            /* Stream is out of sync; only resend if nothing was executed */
+            vtysh_conn_close(conn);
+            if (acked) {
+                break;
+            }
+        }
+
+        pthread_mutex_lock(&d->lock);
+        req->result = result;
+        req->done = true;
+        pthread_cond_signal(&req->cond);
+        pthread_mutex_unlock(&d->lock);
+    }
+
+    vtysh_conn_close(conn);
+    return NULL;
+}
+
+/*
+ * Initialize the pool. Daemons without a VTY socket are skipped and
+ * their commands go through the vtysh process path.
+ */
+int vtysh_pool_init(const struct vtysh_pool_config *config)
+{
+    if (pool_running) {
+        return 0;
+    }
+
+    pool_config.sock_dir = VTYSH_POOL_SOCK_DIR;
+    pool_config.connections = VTYSH_POOL_CONNECTIONS;
+    pool_config.queue_depth = VTYSH_POOL_QUEUE_DEPTH;
+    pool_config.timeout_ms = VTYSH_POOL_TIMEOUT_MS;
+    if (config) {
+        if (config->sock_dir) {
+            pool_config.sock_dir = config->sock_dir;
+        }
+        if (config->connections > 0) {
+            pool_config.connections = config->connections;
+        }
+        if (config->queue_depth > 0) {
+            pool_config.queue_depth = config->queue_depth;
+        }
+        if (config->timeout_ms > 0) {
+            pool_config.timeout_ms = config->timeout_ms;
+        }
+    }
+
+    pool_running = true;
+    int available = 0;
+
+    for (int i = 0; i < VTYSH_D_MAX; i++) {
+        struct vtysh_daemon *d = &pool_daemons[i];
+        memset(d, 0, sizeof(*d));
+        d->id = i;
+        snprintf(d->path, sizeof(d->path), "%s/%s.vty",
+                 pool_config.sock_dir, vtysh_daemon_names[i]);
+
+        if (access(d->path, F_OK) != 0) {
+            continue;
+        }
+
+        d->ring = calloc(pool_config.queue_depth, sizeof(*d->ring));
+        d->conns = calloc(pool_config.connections, sizeof(*d->conns));
+        if (!d->ring || !d->conns) {
+            free(d->ring);
+            free(d->conns);
+            continue;
+        }
+
+        pthread_mutex_init(&d->lock, NULL);
+        pthread_cond_init(&d->not_empty, NULL);
+        pthread_cond_init(&d->not_full, NULL);
+
+        for (int c = 0; c < pool_config.connections; c++) {
+            struct vtysh_conn *conn = &d->conns[c];
+            conn->daemon = d;
+            conn->fd = -1;
+            if (pthread_create(&conn->thread, NULL, vtysh_conn_worker, conn) != 0) {
+                break;
+            }
+            d->conn_count++;
+        }
+
+        d->available = d->conn_count > 0;
+        if (d->available) {
+            available++;
+        }
+    }
+
+    if (available == 0) {
+        pool_running = false;
+        return -1;
+    }
+
+    return 0;
+}
+
+/*
+ * Stop all workers after the queued requests are drained.
+ */
+void vtysh_pool_shutdown(void)
+{
+    if (!pool_running) {
+        return;
+    }
+
+    for (int i = 0; i < VTYSH_D_MAX; i++) {
+        if (pool_daemons[i].available) {
+            pthread_mutex_lock(&pool_daemons[i].lock);
+        }
+    }
+    pool_running = false;
+    for (int i = 0; i < VTYSH_D_MAX; i++) {
+        if (pool_daemons[i].available) {
+            pthread_cond_broadcast(&pool_daemons[i].not_empty);
+            pthread_mutex_unlock(&pool_daemons[i].lock);
+        }
+    }
+
+    for (int i = 0; i < VTYSH_D_MAX; i++) {
+        struct vtysh_daemon *d = &pool_daemons[i];
+        for (int c = 0; c < d->conn_count; c++) {
+            pthread_join(d->conns[c].thread, NULL);
+        }
+        free(d->ring);
+        free(d->conns);
+        d->ring = NULL;
+        d->conns = NULL;
+        d->conn_count = 0;
+        d->available = false;
+    }
+}
+
+bool vtysh_pool_active(void)
+{
+    return pool_running;
+}
+
+/*
+ * Execute a command block over the pool.
+ * Returns the first non-zero CMD_* status, 0 on success, or a
+ * VTYSH_POOL_E* code.
+ */
+int vtysh_pool_execute(const char *cmd, char *output, size_t output_size)
+{
+    int id = vtysh_route_block(cmd);
+    if (!pool_running || id < 0 || !pool_daemons[id].available) {
+        pool_stat_add(&pool_stats.fallbacks);
+        return VTYSH_POOL_EUNROUTABLE;
+    }
+
+    struct vtysh_daemon *d = &pool_daemons[id];
+    struct vtysh_request req = {
+        .cmd = cmd,
+        .output = output,
+        .output_size = output_size,
+        .result = 0,
+        .done = false,
+    };
+    pthread_cond_init(&req.cond, NULL);
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += pool_config.timeout_ms / 1000;
+    deadline.tv_nsec += (long)(pool_config.timeout_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&d->lock);
+    while (d->count == (unsigned int)pool_config.queue_depth) {
+        if (pthread_cond_timedwait(&d->not_full, &d->lock, &deadline) == ETIMEDOUT) {
+            pthread_mutex_unlock(&d->lock);
+            pthread_cond_destroy(&req.cond);
+            pool_stat_add(&pool_stats.queue_full);
+            return VTYSH_POOL_ETIMEDOUT;
+        }
+    }
+
+    d->ring[(d->head + d->count) % pool_config.queue_depth] = &req;
+    d->count++;
+    pthread_cond_signal(&d->not_empty);
+
+    while (!req.done) {
+        pthread_cond_wait(&req.cond, &d->lock);
+    }
+    pthread_mutex_unlock(&d->lock);
+    pthread_cond_destroy(&req.cond);
+
+    pool_stat_add(&pool_stats.requests);
+    if (req.result != 0) {
+        pool_stat_add(&pool_stats.errors);
+    }
+
+    return req.result;
+}
+
+void vtysh_pool_get_stats(struct vtysh_pool_stats *stats)
+{
+    pthread_mutex_lock(&pool_stats_lock);
+    *stats = pool_stats;
+    pthread_mutex_unlock(&pool_stats_lock);
+}
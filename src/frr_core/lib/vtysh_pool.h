@@ -0,0 +1,52 @@
+/*
+ * Persistent vtysh Session Pool
+ * Copyright (C) 2026 WhiteBox NE Team
+ *
+ * Keeps long-lived connections to the FRR daemon VTY sockets so that
+ * execute_vtysh_command() does not have to spawn a vtysh process per
+ * command. Requests from all modules are multiplexed over a small number
+ * of connections per daemon through a bounded queue.
+ */
+
+#ifndef _VTYSH_POOL_H
+#define _VTYSH_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Defaults */
+#define VTYSH_POOL_SOCK_DIR        "/var/run/frr"
+#define VTYSH_POOL_CONNECTIONS     2      /* Connections per daemon */
+#define VTYSH_POOL_QUEUE_DEPTH     256    /* Pending requests per daemon */
+#define VTYSH_POOL_TIMEOUT_MS      30000  /* Per-request I/O timeout */
+
+/* Return codes besides the FRR CMD_* status */
+#define VTYSH_POOL_EUNROUTABLE     (-100) /* Caller should use vtysh process */
+#define VTYSH_POOL_ETIMEDOUT       (-101) /* Queue full or daemon silent */
+#define VTYSH_POOL_EIO             (-102) /* Connection lost mid-request */
+
+/* Pool configuration */
+struct vtysh_pool_config {
+    const char *sock_dir;   /* Directory holding <daemon>.vty sockets */
+    int connections;        /* Connections per daemon */
+    int queue_depth;        /* Bounded queue length per daemon */
+    int timeout_ms;         /* I/O and queue wait timeout */
+};
+
+/* Pool statistics */
+struct vtysh_pool_stats {
+    uint64_t requests;      /* Requests served over VTY sockets */
+    uint64_t fallbacks;     /* Requests handed back to the vtysh process path */
+    uint64_t errors;        /* Requests failing with non-zero status */
+    uint64_t reconnects;    /* Socket reconnects after failure */
+    uint64_t queue_full;    /* Requests rejected after waiting on a full queue */
+};
+
+int vtysh_pool_init(const struct vtysh_pool_config *config);
+void vtysh_pool_shutdown(void);
+bool vtysh_pool_active(void);
+int vtysh_pool_execute(const char *cmd, char *output, size_t output_size);
+void vtysh_pool_get_stats(struct vtysh_pool_stats *stats);
+
+#endif /* _VTYSH_POOL_H */
@@ -0,0 +1,139 @@
+/*
+ * vtysh Session Pool Benchmark
+ * Copyright (C) 2026 WhiteBox NE Team
+ *
+ * Compares commands per second of the vtysh process path against the
+ * persistent session pool. Requires running FRR daemons.
+ *
+ * Usage: vtysh_pool_bench [-n count] [-t threads] [-c command]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include "huawei_cli.h"
+#include "vtysh_pool.h"
+
+struct bench_worker {
+    const char *cmd;
+    int count;
+    int failures;
+};
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void *bench_pool_worker(void *arg)
+{
+    struct bench_worker *w = arg;
+    char output[8192];
+
+    for (int i = 0; i < w->count; i++) {
+        if (vtysh_pool_execute(w->cmd, output, sizeof(output)) != 0) {
+            w->failures++;
+        }
+    }
+    return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *cmd = "show ip route summary";
+    int count = 1000;
+    int threads = 4;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:t:c:")) != -1) {
+        switch (opt) {
+            case 'n':
+                count = atoi(optarg);
+                break;
+            case 't':
+                threads = atoi(optarg);
+                break;
+            case 'c':
+                cmd = optarg;
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-n count] [-t threads] [-c command]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (count < 1 || threads < 1) {
+        fprintf(stderr, "Error: count and threads must be positive\n");
+        return 1;
+    }
+
+    printf("vtysh Command Execution Benchmark\n");
+    printf("=================================\n");
+    printf("Command: %s\n", cmd);
+    printf("Commands: %d, pool client threads: %d\n\n", count, threads);
+
+    /* Process path: one vtysh per command */
+    char output[8192];
+    int process_count = count < 200 ? count : 200;
+    int process_failures = 0;
+    double start = now_seconds();
+    for (int i = 0; i < process_count; i++) {
+        if (vtysh_exec_process(cmd, output, sizeof(output)) != 0) {
+            process_failures++;
+        }
+    }
+    double process_elapsed = now_seconds() - start;
+    double process_rate = process_count / process_elapsed;
+
+    printf("%-12s %10s %10s %12s\n", "Path", "Commands", "Failures", "Cmds/sec");
+    printf("%-12s %10s %10s %12s\n", "------------", "----------", "----------", "------------");
+    printf("%-12s %10d %10d %12.1f\n", "process", process_count, process_failures, process_rate);
+
+    /* Pool path */
+    if (vtysh_pool_init(NULL) != 0) {
+        printf("%-12s %10s\n", "pool", "unavailable (no VTY sockets)");
+        return 0;
+    }
+
+    struct bench_worker *workers = calloc(threads, sizeof(*workers));
+    pthread_t *tids = calloc(threads, sizeof(*tids));
+    if (!workers || !tids) {
+        fprintf(stderr, "Error: Out of memory\n");
+        return 1;
+    }
+
+    start = now_seconds();
+    for (int i = 0; i < threads; i++) {
+        workers[i].cmd = cmd;
+        workers[i].count = count / threads + (i < count % threads ? 1 : 0);
+        pthread_create(&tids[i], NULL, bench_pool_worker, &workers[i]);
+    }
+
+    int pool_failures = 0;
+    for (int i = 0; i < threads; i++) {
+        pthread_join(tids[i], NULL);
+        pool_failures += workers[i].failures;
+    }
+    double pool_elapsed = now_seconds() - start;
+    double pool_rate = count / pool_elapsed;
+
+    printf("%-12s %10d %10d %12.1f\n", "pool", count, pool_failures, pool_rate);
+    printf("\nSpeedup: %.1fx\n", pool_rate / process_rate);
+
+    struct vtysh_pool_stats stats;
+    vtysh_pool_get_stats(&stats);
+    printf("Pool: requests %lu, fallbacks %lu, errors %lu, reconnects %lu, queue-full %lu\n",
+           stats.requests, stats.fallbacks, stats.errors, stats.reconnects, stats.queue_full);
+
+    vtysh_pool_shutdown();
+    free(workers);
+    free(tids);
+
+    return 0;
+}
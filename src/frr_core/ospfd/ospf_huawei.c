@@ -558,4 +558,5 @@ struct cmd_element ospf_enhanced_cmds[] = {
 void register_ospf_enhanced_cmds(void)
 {
     printf("Registering OSPF enhanced commands...\n");
+    huawei_cli_register_table(ospf_enhanced_cmds, "ospf");
 }
@@ -344,4 +344,5 @@ struct cmd_element rip_cmds[] = {
 void register_rip_cmds(void)
 {
     printf("Registering RIP commands...\n");
+    huawei_cli_register_table(rip_cmds, "rip");
 }
@@ -96,4 +96,5 @@ struct cmd_element subif_cmds[] = {
 
 void register_subif_cmds(void) {
     printf("Registering sub-interface commands...\n");
+    huawei_cli_register_table(subif_cmds, NULL);
 }
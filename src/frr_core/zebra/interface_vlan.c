@@ -15,13 +15,15 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "../lib/huawei_cli.h"
+#include "../lib/slab.h"
+#include "../lib/if_registry.h"
 
 /* VLAN configuration */
 struct vlan_config {
     uint16_t vlan_id;
     char description[128];
     bool enabled;
-    char member_ports[32][64];
+    ifid_t member_ports[32];
     int member_count;
 };
 
@@ -44,18 +46,22 @@ typedef enum {
 
 /* Port configuration */
 struct port_config {
-    char interface[64];
+    ifid_t ifid;
     port_link_type_t link_type;
     uint16_t pvid;              /* Default VLAN for access/hybrid */
     uint16_t allowed_vlans[4096];
     int allowed_vlan_count;
 };
 
-/* Global configurations */
-static struct vlan_config vlans[4096];
-static int vlan_count = 0;
-static struct vlanif_config vlanifs[4096];
-static int vlanif_count = 0;
+#define VLAN_ID_MAX 4094
+
+/* Global configurations, indexed by VLAN ID */
+static struct slab vlan_slab = SLAB_INIT("vlan", struct vlan_config);
+static struct vlan_config *vlan_by_id[VLAN_ID_MAX + 1];
+static struct slab vlanif_slab = SLAB_INIT("vlanif", struct vlanif_config);
+static struct vlanif_config *vlanif_by_id[VLAN_ID_MAX + 1];
+static slab_handle_t current_vlan = SLAB_HANDLE_NONE;
+static slab_handle_t current_vlanif = SLAB_HANDLE_NONE;
 static struct port_config ports[256];
 static int port_count = 0;
 
@@ -78,25 +84,18 @@ static int cmd_vlan(struct cmd_element *cmd, struct cmd_args *args)
     }
 
     /* Find or create VLAN */
-    struct vlan_config *vlan = NULL;
-    for (int i = 0; i < vlan_count; i++) {
-        if (vlans[i].vlan_id == vlan_id) {
-            vlan = &vlans[i];
-            break;
+    struct vlan_config *vlan = vlan_by_id[vlan_id];
+    if (!vlan) {
+        vlan = slab_alloc(&vlan_slab, NULL);
+        if (!vlan) {
+            printf("Error: Out of memory for VLAN %u\n", vlan_id);
+            return -1;
         }
-    }
-
-    if (!vlan && vlan_count < 4096) {
-        vlan = &vlans[vlan_count++];
-        memset(vlan, 0, sizeof(struct vlan_config));
         vlan->vlan_id = vlan_id;
         vlan->enabled = true;
+        vlan_by_id[vlan_id] = vlan;
     }
-
-    if (!vlan) {
-        printf("Error: Maximum VLANs reached\n");
-        return -1;
-    }
+    current_vlan = slab_handle(&vlan_slab, vlan);
 
     printf("Entering VLAN %u configuration\n", vlan_id);
     printf("[Huawei-vlan%u]\n", vlan_id);
@@ -119,8 +118,9 @@ static int cmd_vlan(struct cmd_element *cmd, struct cmd_args *args)
  */
 static int cmd_vlan_description(struct cmd_element *cmd, struct cmd_args *args)
 {
-    if (vlan_count == 0) {
-        printf("Error: No VLAN configured\n");
+    struct vlan_config *vlan = slab_get(&vlan_slab, current_vlan);
+    if (!vlan) {
+        printf("Error: No VLAN selected\n");
         return -1;
     }
 
@@ -130,7 +130,6 @@ static int cmd_vlan_description(struct cmd_element *cmd, struct cmd_args *args)
         return -1;
     }
 
-    struct vlan_config *vlan = &vlans[vlan_count - 1];
     strncpy(vlan->description, args->argv[0], sizeof(vlan->description) - 1);
 
     printf("VLAN %u description set\n", vlan->vlan_id);
@@ -167,26 +166,19 @@ static int cmd_interface_vlanif(struct cmd_element *cmd, struct cmd_args *args)
     }
 
     /* Find or create Vlanif */
-    struct vlanif_config *vlanif = NULL;
-    for (int i = 0; i < vlanif_count; i++) {
-        if (vlanifs[i].vlan_id == vlan_id) {
-            vlanif = &vlanifs[i];
-            break;
+    struct vlanif_config *vlanif = vlanif_by_id[vlan_id];
+    if (!vlanif) {
+        vlanif = slab_alloc(&vlanif_slab, NULL);
+        if (!vlanif) {
+            printf("Error: Out of memory for Vlanif%u\n", vlan_id);
+            return -1;
         }
-    }
-
-    if (!vlanif && vlanif_count < 4096) {
-        vlanif = &vlanifs[vlanif_count++];
-        memset(vlanif, 0, sizeof(struct vlanif_config));
         vlanif->vlan_id = vlan_id;
         vlanif->enabled = true;
         vlanif->mtu = 1500;
+        vlanif_by_id[vlan_id] = vlanif;
     }
-
-    if (!vlanif) {
-        printf("Error: Maximum VLAN interfaces reached\n");
-        return -1;
-    }
+    current_vlanif = slab_handle(&vlanif_slab, vlanif);
 
     printf("Entering Vlanif%u configuration\n", vlan_id);
     printf("[Huawei-Vlanif%u]\n", vlan_id);
@@ -210,8 +202,9 @@ static int cmd_interface_vlanif(struct cmd_element *cmd, struct cmd_args *args)
  */
 static int cmd_vlanif_ip_address(struct cmd_element *cmd, struct cmd_args *args)
 {
-    if (vlanif_count == 0) {
-        printf("Error: No VLAN interface configured\n");
+    struct vlanif_config *vlanif = slab_get(&vlanif_slab, current_vlanif);
+    if (!vlanif) {
+        printf("Error: No VLAN interface selected\n");
         return -1;
     }
 
@@ -221,7 +214,6 @@ static int cmd_vlanif_ip_address(struct cmd_element *cmd, struct cmd_args *args)
         return -1;
     }
 
-    struct vlanif_config *vlanif = &vlanifs[vlanif_count - 1];
     snprintf(vlanif->ip_address, sizeof(vlanif->ip_address),
              "%s/%s", args->argv[0], args->argv[1]);
 
@@ -324,15 +316,9 @@ static int cmd_display_vlan(struct cmd_element *cmd, struct cmd_args *args)
 {
     if (args->argc > 0) {
         /* Display specific VLAN */
-        uint16_t vlan_id = atoi(args->argv[0]);
-        struct vlan_config *vlan = NULL;
-
-        for (int i = 0; i < vlan_count; i++) {
-            if (vlans[i].vlan_id == vlan_id) {
-                vlan = &vlans[i];
-                break;
-            }
-        }
+        int vlan_id = atoi(args->argv[0]);
+        struct vlan_config *vlan = (vlan_id >= 1 && vlan_id <= VLAN_ID_MAX) ?
+                                   vlan_by_id[vlan_id] : NULL;
 
         if (!vlan) {
             printf("Error: VLAN not found\n");
@@ -346,15 +332,19 @@ static int cmd_display_vlan(struct cmd_element *cmd, struct cmd_args *args)
     } else {
         /* Display all VLANs */
         printf("VLAN Configuration:\n");
-        printf("  Total VLANs: %d\n\n", vlan_count);
+        printf("  Total VLANs: %u\n\n", slab_count(&vlan_slab));
 
         printf("  VLAN ID  Description                Status\n");
         printf("  -------  -------------------------  ------\n");
-        for (int i = 0; i < vlan_count; i++) {
+        for (int id = 1; id <= VLAN_ID_MAX; id++) {
+            struct vlan_config *vlan = vlan_by_id[id];
+            if (!vlan) {
+                continue;
+            }
             printf("  %-7u  %-25s  %s\n",
-                   vlans[i].vlan_id,
-                   vlans[i].description[0] ? vlans[i].description : "-",
-                   vlans[i].enabled ? "Active" : "Inactive");
+                   vlan->vlan_id,
+                   vlan->description[0] ? vlan->description : "-",
+                   vlan->enabled ? "Active" : "Inactive");
         }
     }
 
@@ -368,16 +358,20 @@ static int cmd_display_vlan(struct cmd_element *cmd, struct cmd_args *args)
 static int cmd_display_vlanif(struct cmd_element *cmd, struct cmd_args *args)
 {
     printf("VLAN Interfaces:\n");
-    printf("  Total: %d\n\n", vlanif_count);
+    printf("  Total: %u\n\n", slab_count(&vlanif_slab));
 
     printf("  Interface  IP Address           Status  MTU\n");
     printf("  ---------  -------------------  ------  ----\n");
-    for (int i = 0; i < vlanif_count; i++) {
+    for (int id = 1; id <= VLAN_ID_MAX; id++) {
+        struct vlanif_config *vlanif = vlanif_by_id[id];
+        if (!vlanif) {
+            continue;
+        }
         printf("  Vlanif%-4u  %-19s  %-6s  %u\n",
-               vlanifs[i].vlan_id,
-               vlanifs[i].ip_address[0] ? vlanifs[i].ip_address : "Not configured",
-               vlanifs[i].enabled ? "Up" : "Down",
-               vlanifs[i].mtu);
+               vlanif->vlan_id,
+               vlanif->ip_address[0] ? vlanif->ip_address : "Not configured",
+               vlanif->enabled ? "Up" : "Down",
+               vlanif->mtu);
     }
 
     return 0;
@@ -395,29 +389,26 @@ static int cmd_undo_vlan(struct cmd_element *cmd, struct cmd_args *args)
         return -1;
     }
 
-    uint16_t vlan_id = atoi(args->argv[1]);
+    int vlan_id = atoi(args->argv[1]);
+    struct vlan_config *vlan = (vlan_id >= 1 && vlan_id <= VLAN_ID_MAX) ?
+                               vlan_by_id[vlan_id] : NULL;
+    if (!vlan) {
+        printf("Error: VLAN not found\n");
+        return -1;
+    }
 
-    /* Find and remove VLAN */
-    for (int i = 0; i < vlan_count; i++) {
-        if (vlans[i].vlan_id == vlan_id) {
-            /* Delete VLAN interface */
-            char cmd_str[256];
-            snprintf(cmd_str, sizeof(cmd_str),
-                     "ip link delete eth0.%u 2>/dev/null || true", vlan_id);
-            system(cmd_str);
+    /* Delete VLAN interface */
+    char cmd_str[256];
+    snprintf(cmd_str, sizeof(cmd_str),
+             "ip link delete eth0.%d 2>/dev/null || true", vlan_id);
+    system(cmd_str);
 
-            /* Shift remaining VLANs */
-            for (int j = i; j < vlan_count - 1; j++) {
-                vlans[j] = vlans[j + 1];
-            }
-            vlan_count--;
-            printf("VLAN %u deleted\n", vlan_id);
-            return 0;
-        }
-    }
+    /* A stale current_vlan handle now resolves to NULL */
+    vlan_by_id[vlan_id] = NULL;
+    slab_free(&vlan_slab, vlan);
+    printf("VLAN %d deleted\n", vlan_id);
 
-    printf("Error: VLAN not found\n");
-    return -1;
+    return 0;
 }
 
 /* Command registration */
@@ -449,4 +440,5 @@ struct cmd_element vlan_cmds[] = {
 void register_vlan_cmds(void)
 {
     printf("Registering VLAN commands...\n");
+    huawei_cli_register_table(vlan_cmds, NULL);
 }
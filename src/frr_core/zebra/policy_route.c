@@ -8,6 +8,10 @@
  * - Interface-based routing
  * - ACL-based matching
  * - Next-hop manipulation
+ * - Packet matching in node order, per burst through the pkt_match
+ *   kernel for policies of source and destination prefixes
+ * - Matching programs compiled on the config side at commit and
+ *   published to the datapath, the replaced program retired through qsbr
  */
 
 #include <stdio.h>
@@ -15,7 +19,12 @@
 #include <string.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <arpa/inet.h>
 #include "../lib/huawei_cli.h"
+#include "../lib/if_registry.h"
+#include "../lib/pkt_match.h"
+#include "../lib/qsbr.h"
+#include "policy_route.h"
 
 /* Policy action types */
 typedef enum {
@@ -51,10 +60,14 @@ struct policy_node {
     uint32_t acl_number;
     bool match_source;
     char source_prefix[64];
+    uint32_t source_addr;       /* Host order, masked */
+    uint32_t source_mask;
     bool match_destination;
     char dest_prefix[64];
+    uint32_t dest_addr;
+    uint32_t dest_mask;
     bool match_interface;
-    char interface[64];
+    ifid_t match_ifid;
     bool match_length;
     uint16_t length_min;
     uint16_t length_max;
@@ -63,7 +76,7 @@ struct policy_node {
     bool apply_nexthop;
     char nexthop[64];
     bool apply_interface;
-    char apply_if[64];
+    ifid_t apply_ifid;
     bool apply_default_nexthop;
     char default_nexthop[64];
     bool apply_precedence;
@@ -72,18 +85,171 @@ struct policy_node {
     uint8_t dscp;
 };
 
-/* Policy configuration */
+#define POLICY_MAX          16
+#define POLICY_NODE_MAX     32
+
+/* Nodes in ID order as the datapath sees them, immutable once published */
+struct policy_program {
+    struct pkt_match_table *burst;      /* Prefix-only policies, or NULL */
+    int node_count;
+    struct policy_node nodes[];
+};
+
+struct pbr_policy {
+    struct policy_program *program;     /* NULL when deleted, qsbr retired */
+};
+
+/* Policy configuration, in a fixed slot so its handle stays valid */
 struct policy_config {
-    char name[64];
-    struct policy_node nodes[32];
+    char name[64];              /* Empty for a free slot */
+    struct policy_node nodes[POLICY_NODE_MAX];
     int node_count;
+    bool dirty;                 /* Nodes changed since published */
+    struct pbr_policy handle;
 };
 
 /* Global policy configurations */
-static struct policy_config policies[16];
-static int policy_count = 0;
+static struct policy_config policies[POLICY_MAX];
 static struct policy_config *current_policy = NULL;
 static struct policy_node *current_node = NULL;
+static pbr_acl_fn policy_acl_match = NULL;
+static void *policy_acl_ctx = NULL;
+
+static void policy_program_free(void *ptr)
+{
+    struct policy_program *prog = ptr;
+
+    free(prog->burst);
+    free(prog);
+}
+
+/*
+ * Copy the nodes of a policy in node ID order, with the kernel table
+ * when every node matches at most a source and a destination prefix and
+ * its node ID fits a result. Returns NULL when out of memory.
+ */
+static struct policy_program *policy_compile(const struct policy_config *policy)
+{
+    struct policy_program *prog =
+        calloc(1, sizeof(*prog) + policy->node_count * sizeof(prog->nodes[0]));
+
+    if (!prog) {
+        return NULL;
+    }
+    for (int i = 0; i < policy->node_count; i++) {
+        int j = i;
+        while (j > 0 && prog->nodes[j - 1].node_id > policy->nodes[i].node_id) {
+            prog->nodes[j] = prog->nodes[j - 1];
+            j--;
+        }
+        prog->nodes[j] = policy->nodes[i];
+    }
+    prog->node_count = policy->node_count;
+
+    bool prefixes_only = prog->node_count > 0;
+    for (int i = 0; i < prog->node_count && prefixes_only; i++) {
+        const struct policy_node *node = &prog->nodes[i];
+        prefixes_only = !node->match_acl && !node->match_interface && !node->match_length &&
+                        node->node_id <= UINT16_MAX;
+    }
+    if (!prefixes_only) {
+        return prog;
+    }
+    prog->burst = aligned_alloc(64, sizeof(*prog->burst));
+    if (!prog->burst) {
+        free(prog);
+        return NULL;
+    }
+    pkt_match_init(prog->burst);
+    for (int i = 0; i < prog->node_count; i++) {
+        const struct policy_node *node = &prog->nodes[i];
+        struct pkt_match_rule rule = {
+            .src = node->match_source ? node->source_addr : 0,
+            .src_mask = node->match_source ? node->source_mask : 0,
+            .dst = node->match_destination ? node->dest_addr : 0,
+            .dst_mask = node->match_destination ? node->dest_mask : 0,
+            .src_port = { 0, 65535 },
+            .dst_port = { 0, 65535 },
+            .result = (uint16_t)node->node_id,
+        };
+        pkt_match_add(prog->burst, &rule);
+    }
+    return prog;
+}
+
+/*
+ * Publish the program of every changed policy, once per command or per
+ * commit. A deleted policy publishes no program and matches nothing.
+ */
+static void policy_publish_changed(void)
+{
+    for (int i = 0; i < POLICY_MAX; i++) {
+        struct policy_config *policy = &policies[i];
+        struct policy_program *prog = NULL;
+
+        if (!policy->dirty) {
+            continue;
+        }
+        if (policy->name[0] != '\0') {
+            prog = policy_compile(policy);
+            if (!prog) {
+                printf("Error: Out of memory for policy %s, previous nodes stay in use\n",
+                       policy->name);
+                continue;
+            }
+        }
+        prog = __atomic_exchange_n(&policy->handle.program, prog, __ATOMIC_ACQ_REL);
+        qsbr_retire(prog, policy_program_free);
+        policy->dirty = false;
+    }
+}
+
+/* Marks the nodes of a policy for publishing with the command or commit */
+static void policy_changed(struct policy_config *policy)
+{
+    policy->dirty = true;
+    cli_commit_defer(policy_publish_changed);
+}
+
+static struct policy_config *policy_config_find(const char *policy_name)
+{
+    for (int i = 0; i < POLICY_MAX; i++) {
+        if (policies[i].name[0] != '\0' && strcmp(policies[i].name, policy_name) == 0) {
+            return &policies[i];
+        }
+    }
+    return NULL;
+}
+
+/* Parses a.b.c.d/len, or a.b.c.d as a host address */
+static bool parse_prefix(const char *text, uint32_t *addr, uint32_t *mask)
+{
+    char buf[INET_ADDRSTRLEN];
+    const char *slash = strchr(text, '/');
+    size_t len = slash ? (size_t)(slash - text) : strlen(text);
+    struct in_addr in;
+    int plen = 32;
+
+    if (len >= sizeof(buf)) {
+        return false;
+    }
+    memcpy(buf, text, len);
+    buf[len] = '\0';
+    if (inet_pton(AF_INET, buf, &in) != 1) {
+        return false;
+    }
+    if (slash) {
+        char *end;
+        long v = strtol(slash + 1, &end, 10);
+        if (slash[1] == '\0' || *end != '\0' || v < 0 || v > 32) {
+            return false;
+        }
+        plen = (int)v;
+    }
+    *mask = plen ? ~0u << (32 - plen) : 0;
+    *addr = ntohl(in.s_addr) & *mask;
+    return true;
+}
 
 /*
  * Create or enter policy
@@ -102,20 +268,17 @@ static int cmd_policy_based_route(struct cmd_element *cmd, struct cmd_args *args
     uint32_t node_id = 10;
 
     /* Find or create policy */
-    current_policy = NULL;
-    for (int i = 0; i < policy_count; i++) {
-        if (strcmp(policies[i].name, policy_name) == 0) {
+    current_policy = policy_config_find(policy_name);
+    for (int i = 0; i < POLICY_MAX && !current_policy; i++) {
+        if (policies[i].name[0] == '\0') {
             current_policy = &policies[i];
-            break;
+            memset(current_policy->nodes, 0, sizeof(current_policy->nodes));
+            current_policy->node_count = 0;
+            strncpy(current_policy->name, policy_name, sizeof(current_policy->name) - 1);
+            policy_changed(current_policy);
         }
     }
 
-    if (!current_policy && policy_count < 16) {
-        current_policy = &policies[policy_count++];
-        strncpy(current_policy->name, policy_name, sizeof(current_policy->name) - 1);
-        current_policy->node_count = 0;
-    }
-
     if (!current_policy) {
         printf("Error: Maximum policies reached\n");
         return -1;
@@ -141,11 +304,12 @@ static int cmd_policy_based_route(struct cmd_element *cmd, struct cmd_args *args
         }
     }
 
-    if (!current_node && current_policy->node_count < 32) {
+    if (!current_node && current_policy->node_count < POLICY_NODE_MAX) {
         current_node = &current_policy->nodes[current_policy->node_count++];
         memset(current_node, 0, sizeof(struct policy_node));
         current_node->node_id = node_id;
         current_node->action = action;
+        policy_changed(current_policy);
     }
 
     if (!current_node) {
@@ -180,6 +344,7 @@ static int cmd_policy_if_match_acl(struct cmd_element *cmd, struct cmd_args *arg
     uint32_t acl_number = atoi(args->argv[1]);
     current_node->match_acl = true;
     current_node->acl_number = acl_number;
+    policy_changed(current_policy);
 
     printf("Match condition: ACL %u\n", acl_number);
 
@@ -204,8 +369,16 @@ static int cmd_policy_if_match_source(struct cmd_element *cmd, struct cmd_args *
     }
 
     const char *prefix = args->argv[2];
+    uint32_t addr, mask;
+    if (!parse_prefix(prefix, &addr, &mask)) {
+        printf("Error: Invalid prefix %s\n", prefix);
+        return -1;
+    }
     current_node->match_source = true;
     strncpy(current_node->source_prefix, prefix, sizeof(current_node->source_prefix) - 1);
+    current_node->source_addr = addr;
+    current_node->source_mask = mask;
+    policy_changed(current_policy);
 
     printf("Match condition: Source %s\n", prefix);
 
@@ -230,8 +403,16 @@ static int cmd_policy_if_match_destination(struct cmd_element *cmd, struct cmd_a
     }
 
     const char *prefix = args->argv[2];
+    uint32_t addr, mask;
+    if (!parse_prefix(prefix, &addr, &mask)) {
+        printf("Error: Invalid prefix %s\n", prefix);
+        return -1;
+    }
     current_node->match_destination = true;
     strncpy(current_node->dest_prefix, prefix, sizeof(current_node->dest_prefix) - 1);
+    current_node->dest_addr = addr;
+    current_node->dest_mask = mask;
+    policy_changed(current_policy);
 
     printf("Match condition: Destination %s\n", prefix);
 
@@ -256,8 +437,14 @@ static int cmd_policy_if_match_interface(struct cmd_element *cmd, struct cmd_arg
     }
 
     const char *interface = args->argv[1];
+    ifid_t ifid = if_intern(interface);
+    if (ifid == IFID_NONE) {
+        printf("Error: Invalid interface name %s\n", interface);
+        return -1;
+    }
     current_node->match_interface = true;
-    strncpy(current_node->interface, interface, sizeof(current_node->interface) - 1);
+    current_node->match_ifid = ifid;
+    policy_changed(current_policy);
 
     printf("Match condition: Interface %s\n", interface);
 
@@ -287,6 +474,7 @@ static int cmd_policy_if_match_length(struct cmd_element *cmd, struct cmd_args *
     current_node->match_length = true;
     current_node->length_min = min_len;
     current_node->length_max = max_len;
+    policy_changed(current_policy);
 
     printf("Match condition: Packet length %u-%u\n", min_len, max_len);
 
@@ -337,8 +525,13 @@ static int cmd_policy_apply_interface(struct cmd_element *cmd, struct cmd_args *
     }
 
     const char *interface = args->argv[1];
+    ifid_t ifid = if_intern(interface);
+    if (ifid == IFID_NONE) {
+        printf("Error: Invalid interface name %s\n", interface);
+        return -1;
+    }
     current_node->apply_interface = true;
-    strncpy(current_node->apply_if, interface, sizeof(current_node->apply_if) - 1);
+    current_node->apply_ifid = ifid;
 
     printf("Apply action: Output interface %s\n", interface);
 
@@ -449,13 +642,7 @@ static int cmd_interface_apply_policy(struct cmd_element *cmd, struct cmd_args *
     const char *policy_name = args->argv[1];
 
     /* Find policy */
-    struct policy_config *policy = NULL;
-    for (int i = 0; i < policy_count; i++) {
-        if (strcmp(policies[i].name, policy_name) == 0) {
-            policy = &policies[i];
-            break;
-        }
-    }
+    struct policy_config *policy = policy_config_find(policy_name);
 
     if (!policy) {
         printf("Error: Policy not found\n");
@@ -477,14 +664,7 @@ static int cmd_display_policy(struct cmd_element *cmd, struct cmd_args *args)
     if (args->argc > 0) {
         /* Display specific policy */
         const char *policy_name = args->argv[0];
-        struct policy_config *policy = NULL;
-
-        for (int i = 0; i < policy_count; i++) {
-            if (strcmp(policies[i].name, policy_name) == 0) {
-                policy = &policies[i];
-                break;
-            }
-        }
+        struct policy_config *policy = policy_config_find(policy_name);
 
         if (!policy) {
             printf("Error: Policy not found\n");
@@ -510,7 +690,7 @@ static int cmd_display_policy(struct cmd_element *cmd, struct cmd_args *args)
                 printf("      Destination: %s\n", node->dest_prefix);
             }
             if (node->match_interface) {
-                printf("      Interface: %s\n", node->interface);
+                printf("      Interface: %s\n", if_name(node->match_ifid));
             }
             if (node->match_length) {
                 printf("      Packet length: %u-%u\n", node->length_min, node->length_max);
@@ -521,7 +701,7 @@ static int cmd_display_policy(struct cmd_element *cmd, struct cmd_args *args)
                 printf("      Next-hop: %s\n", node->nexthop);
             }
             if (node->apply_interface) {
-                printf("      Output interface: %s\n", node->apply_if);
+                printf("      Output interface: %s\n", if_name(node->apply_ifid));
             }
             if (node->apply_default_nexthop) {
                 printf("      Default next-hop: %s\n", node->default_nexthop);
@@ -535,11 +715,18 @@ static int cmd_display_policy(struct cmd_element *cmd, struct cmd_args *args)
         }
     } else {
         /* Display all policies */
+        int total = 0;
+
+        for (int i = 0; i < POLICY_MAX; i++) {
+            total += policies[i].name[0] != '\0';
+        }
         printf("Policy-Based Routing Configuration:\n");
-        printf("  Total policies: %d\n\n", policy_count);
+        printf("  Total policies: %d\n\n", total);
 
-        for (int i = 0; i < policy_count; i++) {
-            printf("  Policy: %s (%d nodes)\n", policies[i].name, policies[i].node_count);
+        for (int i = 0; i < POLICY_MAX; i++) {
+            if (policies[i].name[0] != '\0') {
+                printf("  Policy: %s (%d nodes)\n", policies[i].name, policies[i].node_count);
+            }
         }
     }
 
@@ -560,32 +747,121 @@ static int cmd_undo_policy(struct cmd_element *cmd, struct cmd_args *args)
 
     const char *policy_name = args->argv[1];
 
-    /* Find and remove policy */
-    for (int i = 0; i < policy_count; i++) {
-        if (strcmp(policies[i].name, policy_name) == 0) {
-            /* Shift remaining policies */
-            for (int j = i; j < policy_count - 1; j++) {
-                policies[j] = policies[j + 1];
+    /* Free the slot; its handle matches nothing once published */
+    struct policy_config *policy = policy_config_find(policy_name);
+    if (!policy) {
+        printf("Error: Policy not found\n");
+        return -1;
+    }
+    if (current_policy == policy) {
+        current_policy = NULL;
+        current_node = NULL;
+    }
+    policy->name[0] = '\0';
+    policy->node_count = 0;
+    policy_changed(policy);
+    printf("Policy %s deleted\n", policy_name);
+    return 0;
+}
+
+void policy_route_set_acl_hook(pbr_acl_fn acl_match, void *acl_ctx)
+{
+    policy_acl_match = acl_match;
+    policy_acl_ctx = acl_ctx;
+}
+
+static bool node_match(const struct policy_node *node, const struct pbr_key *key)
+{
+    if (node->match_source && (key->src_ip & node->source_mask) != node->source_addr) {
+        return false;
+    }
+    if (node->match_destination && (key->dst_ip & node->dest_mask) != node->dest_addr) {
+        return false;
+    }
+    if (node->match_interface && key->ifid != node->match_ifid) {
+        return false;
+    }
+    if (node->match_length && (key->length < node->length_min || key->length > node->length_max)) {
+        return false;
+    }
+    if (node->match_acl &&
+        !(policy_acl_match && policy_acl_match(node->acl_number, key, policy_acl_ctx))) {
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Handle of a configured policy for policy_route_match_burst(), NULL when
+ * no policy has that name. Look it up when binding, not per packet.
+ */
+const struct pbr_policy *policy_route_find(const char *policy_name)
+{
+    struct policy_config *policy = policy_config_find(policy_name);
+
+    return policy ? &policy->handle : NULL;
+}
+
+/*
+ * Match count packets against the published program of a policy.
+ * node_ids[i] receives the ID of the first node matching packet i, -1
+ * when none does. Returns -1 when the policy has been deleted.
+ */
+int policy_route_match_burst(const struct pbr_policy *policy, const struct pbr_key *keys,
+                             uint32_t count, int *node_ids)
+{
+    const struct policy_program *prog =
+        policy ? __atomic_load_n(&policy->program, __ATOMIC_ACQUIRE) : NULL;
+    struct pkt_match_burst burst;
+
+    if (!prog) {
+        return -1;
+    }
+    if (!prog->burst) {
+        for (uint32_t k = 0; k < count; k++) {
+            node_ids[k] = -1;
+            for (int i = 0; i < prog->node_count; i++) {
+                const struct policy_node *node = &prog->nodes[i];
+                if (node_match(node, &keys[k])) {
+                    node_ids[k] = (int)node->node_id;
+                    break;
+                }
             }
-            policy_count--;
-            printf("Policy %s deleted\n", policy_name);
-            return 0;
         }
+        return 0;
+    }
+    for (uint32_t base = 0; base < count; base += PKT_MATCH_BURST) {
+        burst.count = count - base < PKT_MATCH_BURST ? count - base : PKT_MATCH_BURST;
+        for (uint32_t n = 0; n < burst.count; n++) {
+            const struct pbr_key *key = &keys[base + n];
+            pkt_match_burst_set(&burst, n, key->src_ip, key->dst_ip, key->src_port,
+                                key->dst_port, key->protocol);
+        }
+        pkt_match_burst(prog->burst, &burst, &node_ids[base]);
     }
-
-    printf("Error: Policy not found\n");
-    return -1;
+    return 0;
 }
 
 /* Command registration */
 struct cmd_element policy_route_cmds[] = {
     HUAWEI_CMD_WITH_CATEGORY("policy-based-route", cmd_policy_based_route, "route-map",
                              "Configure policy-based routing", CMD_CAT_ROUTING),
+    HUAWEI_CMD_WITH_CATEGORY("ip policy-based-route", cmd_interface_apply_policy, "ip policy route-map",
+                             "Apply policy to interface", CMD_CAT_ROUTING),
+    HUAWEI_CMD_WITH_CATEGORY("display policy-based-route", cmd_display_policy, "show route-map",
+                             "Display policy configuration", CMD_CAT_ROUTING),
+    HUAWEI_CMD_WITH_CATEGORY("undo policy-based-route", cmd_undo_policy, "no route-map",
+                             "Delete policy", CMD_CAT_ROUTING),
+    { .name = NULL }
+};
+
+/* Matches and actions of a policy node, in its view */
+struct cmd_element policy_route_node_cmds[] = {
     HUAWEI_CMD_WITH_CATEGORY("if-match acl", cmd_policy_if_match_acl, "match ip address",
                              "Match ACL", CMD_CAT_ROUTING),
-    HUAWEI_CMD_WITH_CATEGORY("if-match ip-address source", cmd_policy_if_match_source, "match ip address",
+    HUAWEI_CMD_WITH_CATEGORY("if-match ip-address source", cmd_policy_if_match_source, "match src-ip",
                              "Match source address", CMD_CAT_ROUTING),
-    HUAWEI_CMD_WITH_CATEGORY("if-match ip-address destination", cmd_policy_if_match_destination, "match ip address",
+    HUAWEI_CMD_WITH_CATEGORY("if-match ip-address destination", cmd_policy_if_match_destination, "match dst-ip",
                              "Match destination address", CMD_CAT_ROUTING),
     HUAWEI_CMD_WITH_CATEGORY("if-match interface", cmd_policy_if_match_interface, "match interface",
                              "Match interface", CMD_CAT_ROUTING),
@@ -601,12 +877,6 @@ struct cmd_element policy_route_cmds[] = {
                              "Set IP precedence", CMD_CAT_ROUTING),
     HUAWEI_CMD_WITH_CATEGORY("apply dscp", cmd_policy_apply_dscp, "set ip dscp",
                              "Set DSCP value", CMD_CAT_ROUTING),
-    HUAWEI_CMD_WITH_CATEGORY("ip policy-based-route", cmd_interface_apply_policy, "ip policy route-map",
-                             "Apply policy to interface", CMD_CAT_ROUTING),
-    HUAWEI_CMD_WITH_CATEGORY("display policy-based-route", cmd_display_policy, "show route-map",
-                             "Display policy configuration", CMD_CAT_ROUTING),
-    HUAWEI_CMD_WITH_CATEGORY("undo policy-based-route", cmd_undo_policy, "no route-map",
-                             "Delete policy", CMD_CAT_ROUTING),
     { .name = NULL }
 };
 
@@ -614,4 +884,6 @@ struct cmd_element policy_route_cmds[] = {
 void register_policy_route_cmds(void)
 {
     printf("Registering policy-based routing commands...\n");
+    huawei_cli_register_table(policy_route_cmds, NULL);
+    huawei_cli_register_table(policy_route_node_cmds, "policy-based-route");
 }
@@ -0,0 +1,46 @@
+/*
+ * Policy-Based Routing for Huawei VRP Style
+ * Copyright (C) 2026 WhiteBox NE Team
+ *
+ * Packet matching against a configured PBR policy. Nodes are matched in
+ * ascending node ID and all if-match conditions of a node must hold; a
+ * node without conditions matches every packet. Policies whose nodes
+ * only match source and destination prefixes are matched a burst at a
+ * time by the pkt_match vector kernel.
+ *
+ * Policies are compiled when a command or commit applies, not while
+ * matching; the datapath holds a handle from policy_route_find() and
+ * matches the program last published for it.
+ */
+
+#ifndef _POLICY_ROUTE_H
+#define _POLICY_ROUTE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "../lib/if_registry.h"
+
+/* Parsed packet header, addresses in host byte order */
+struct pbr_key {
+    uint32_t src_ip;
+    uint32_t dst_ip;
+    uint16_t src_port;
+    uint16_t dst_port;
+    uint8_t protocol;
+    uint16_t length;
+    ifid_t ifid;                /* Receiving interface */
+};
+
+/* ACL verdict for nodes matching an ACL */
+typedef bool (*pbr_acl_fn)(uint32_t acl_number, const struct pbr_key *key, void *ctx);
+
+/* A configured policy as the datapath matches it */
+struct pbr_policy;
+
+void policy_route_set_acl_hook(pbr_acl_fn acl_match, void *acl_ctx);
+const struct pbr_policy *policy_route_find(const char *policy_name);
+int policy_route_match_burst(const struct pbr_policy *policy, const struct pbr_key *keys,
+                             uint32_t count, int *node_ids);
+void register_policy_route_cmds(void);
+
+#endif /* _POLICY_ROUTE_H */
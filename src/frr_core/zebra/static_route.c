@@ -220,6 +220,6 @@ struct cmd_element static_route_cmds[] = {
 /* Register static route commands */
 void register_static_route_cmds(void)
 {
-    /* Commands will be registered with the main command system */
     printf("Registering static route commands...\n");
+    huawei_cli_register_table(static_route_cmds, NULL);
 }
@@ -17,6 +17,9 @@
 #include <stdbool.h>
 #include <time.h>
 #include "../frr_core/lib/huawei_cli.h"
+#include "../frr_core/lib/slab.h"
+#include "../frr_core/lib/if_registry.h"
+#include "../frr_core/lib/pcpu_stats.h"
 
 /* BFD session type */
 typedef enum {
@@ -45,6 +48,14 @@ typedef enum {
     BFD_DIAG_REVERSE_CONCATENATED_PATH_DOWN
 } bfd_diag_t;
 
+/* Session counters, one per-CPU group per session */
+enum {
+    BFD_STAT_SENT = 0,
+    BFD_STAT_RECEIVED,
+    BFD_STAT_DOWN,
+    BFD_STAT_MAX
+};
+
 /* BFD session */
 struct bfd_session {
     char name[64];
@@ -57,7 +68,7 @@ struct bfd_session {
     /* Peer information */
     char peer_ip[64];
     char source_ip[64];
-    char interface[64];
+    ifid_t ifid;
     uint16_t vrf_id;
 
     /* Timers (in microseconds) */
@@ -74,20 +85,18 @@ struct bfd_session {
     uint32_t remote_discriminator;
 
     /* Statistics */
-    uint64_t packets_sent;
-    uint64_t packets_received;
+    pcpu_counter_t stats;           /* BFD_STAT_* */
     uint64_t up_time;
-    uint64_t down_count;
     time_t last_up_time;
     time_t last_down_time;
 
     /* Binding */
-    char bind_interface[64];
+    ifid_t bind_ifid;
     char bind_peer_ip[64];
 };
 
-static struct bfd_session bfd_sessions[512];
-static int bfd_session_count = 0;
+/* Sessions never move once allocated, current_bfd stays valid */
+static struct slab bfd_slab = SLAB_INIT("bfd-session", struct bfd_session);
 static struct bfd_session *current_bfd = NULL;
 
 /*
@@ -105,18 +114,43 @@ static int cmd_bfd_session(struct cmd_element *cmd, struct cmd_args *args)
     const char *name = args->argv[0];
     const char *peer_ip = args->argv[3];
 
+    /* Resolve the interface before a session is created or changed */
+    ifid_t ifid = IFID_NONE;
+    for (int i = 4; i + 1 < args->argc; i++) {
+        if (strcmp(args->argv[i], "interface") == 0) {
+            ifid = if_intern(args->argv[++i]);
+            if (ifid == IFID_NONE) {
+                printf("Error: Invalid interface name %s\n", args->argv[i]);
+                return -1;
+            }
+        } else if (strcmp(args->argv[i], "source-ip") == 0) {
+            i++;
+        }
+    }
+
     /* Find or create BFD session */
+    struct bfd_session *bfd;
     current_bfd = NULL;
-    for (int i = 0; i < bfd_session_count; i++) {
-        if (strcmp(bfd_sessions[i].name, name) == 0) {
-            current_bfd = &bfd_sessions[i];
+    SLAB_FOREACH(&bfd_slab, cursor, bfd) {
+        if (strcmp(bfd->name, name) == 0) {
+            current_bfd = bfd;
             break;
         }
     }
 
-    if (!current_bfd && bfd_session_count < 512) {
-        current_bfd = &bfd_sessions[bfd_session_count++];
-        memset(current_bfd, 0, sizeof(struct bfd_session));
+    if (!current_bfd) {
+        current_bfd = slab_alloc(&bfd_slab, NULL);
+        if (!current_bfd) {
+            printf("Error: Out of memory for BFD session %s\n", name);
+            return -1;
+        }
+        current_bfd->stats = pcpu_counter_alloc(BFD_STAT_MAX);
+        if (current_bfd->stats == PCPU_COUNTER_NONE) {
+            slab_free(&bfd_slab, current_bfd);
+            current_bfd = NULL;
+            printf("Error: Out of memory for BFD session %s\n", name);
+            return -1;
+        }
         strncpy(current_bfd->name, name, sizeof(current_bfd->name) - 1);
 
         /* Default values */
@@ -131,18 +165,13 @@ static int cmd_bfd_session(struct cmd_element *cmd, struct cmd_args *args)
         current_bfd->local_discriminator = rand();
     }
 
-    if (!current_bfd) {
-        printf("Error: Maximum BFD sessions reached\n");
-        return -1;
-    }
-
     strncpy(current_bfd->peer_ip, peer_ip, sizeof(current_bfd->peer_ip) - 1);
 
     /* Parse optional parameters */
     for (int i = 4; i < args->argc; i++) {
         if (strcmp(args->argv[i], "interface") == 0 && i + 1 < args->argc) {
-            strncpy(current_bfd->interface, args->argv[++i],
-                    sizeof(current_bfd->interface) - 1);
+            current_bfd->ifid = ifid;
+            i++;
         } else if (strcmp(args->argv[i], "source-ip") == 0 && i + 1 < args->argc) {
             strncpy(current_bfd->source_ip, args->argv[++i],
                     sizeof(current_bfd->source_ip) - 1);
@@ -366,9 +395,8 @@ static int cmd_display_bfd_session(struct cmd_element *cmd, struct cmd_args *arg
 
     printf("BFD Session Information:\n\n");
 
-    for (int i = 0; i < bfd_session_count; i++) {
-        struct bfd_session *bfd = &bfd_sessions[i];
-
+    struct bfd_session *bfd;
+    SLAB_FOREACH(&bfd_slab, cursor, bfd) {
         if (session_name && strcmp(bfd->name, session_name) != 0) {
             continue;
         }
@@ -379,8 +407,8 @@ static int cmd_display_bfd_session(struct cmd_element *cmd, struct cmd_args *arg
         if (bfd->source_ip[0]) {
             printf("  Source IP: %s\n", bfd->source_ip);
         }
-        if (bfd->interface[0]) {
-            printf("  Interface: %s\n", bfd->interface);
+        if (bfd->ifid != IFID_NONE) {
+            printf("  Interface: %s\n", if_name(bfd->ifid));
         }
 
         const char *local_state_str, *remote_state_str;
@@ -418,16 +446,18 @@ static int cmd_display_bfd_session(struct cmd_element *cmd, struct cmd_args *arg
                    bfd->echo_interval / 1000);
         }
 
+        struct pcpu_snapshot stats;
+        pcpu_counter_read(bfd->stats, BFD_STAT_MAX, &stats);
         printf("  Statistics:\n");
-        printf("    Packets Sent: %lu\n", bfd->packets_sent);
-        printf("    Packets Received: %lu\n", bfd->packets_received);
+        printf("    Packets Sent: %lu\n", stats.values[BFD_STAT_SENT]);
+        printf("    Packets Received: %lu\n", stats.values[BFD_STAT_RECEIVED]);
         printf("    Up Time: %lu seconds\n", bfd->up_time);
-        printf("    Down Count: %lu\n", bfd->down_count);
+        printf("    Down Count: %lu\n", stats.values[BFD_STAT_DOWN]);
 
         printf("\n");
     }
 
-    if (bfd_session_count == 0) {
+    if (slab_count(&bfd_slab) == 0) {
         printf("No BFD sessions configured\n");
     }
 
@@ -447,9 +477,8 @@ static int cmd_display_bfd_statistics(struct cmd_element *cmd, struct cmd_args *
            "--------------------", "----------", "---------------",
            "---------------", "----------");
 
-    for (int i = 0; i < bfd_session_count; i++) {
-        struct bfd_session *bfd = &bfd_sessions[i];
-
+    struct bfd_session *bfd;
+    SLAB_FOREACH(&bfd_slab, cursor, bfd) {
         const char *state_str;
         switch (bfd->local_state) {
             case BFD_STATE_ADMIN_DOWN: state_str = "AdminDown"; break;
@@ -459,12 +488,14 @@ static int cmd_display_bfd_statistics(struct cmd_element *cmd, struct cmd_args *
             default: state_str = "Unknown";
         }
 
+        struct pcpu_snapshot stats;
+        pcpu_counter_read(bfd->stats, BFD_STAT_MAX, &stats);
         printf("%-20s %-10s %-15lu %-15lu %-10lu\n",
                bfd->name,
                state_str,
-               bfd->packets_sent,
-               bfd->packets_received,
-               bfd->down_count);
+               stats.values[BFD_STAT_SENT],
+               stats.values[BFD_STAT_RECEIVED],
+               stats.values[BFD_STAT_DOWN]);
     }
 
     return 0;
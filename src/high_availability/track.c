@@ -17,6 +17,7 @@
 #include <stdbool.h>
 #include <time.h>
 #include "../frr_core/lib/huawei_cli.h"
+#include "../frr_core/lib/if_registry.h"
 
 /* Track type */
 typedef enum {
@@ -50,7 +51,7 @@ struct track_entry {
     /* Type-specific data */
     union {
         struct {
-            char interface[64];
+            ifid_t ifid;
             bool protocol_up;
             bool line_up;
         } interface;
@@ -167,9 +168,14 @@ static int cmd_track_interface(struct cmd_element *cmd, struct cmd_args *args)
         return -1;
     }
 
+    ifid_t ifid = if_intern(args->argv[0]);
+    if (ifid == IFID_NONE) {
+        printf("Error: Invalid interface name %s\n", args->argv[0]);
+        return -1;
+    }
+
     current_track->type = TRACK_TYPE_INTERFACE;
-    strncpy(current_track->data.interface.interface, args->argv[0],
-            sizeof(current_track->data.interface.interface) - 1);
+    current_track->data.interface.ifid = ifid;
 
     /* Default: track both protocol and line */
     current_track->data.interface.protocol_up = true;
@@ -439,7 +445,7 @@ static int cmd_display_track(struct cmd_element *cmd, struct cmd_args *args)
             /* Type-specific information */
             switch (track->type) {
                 case TRACK_TYPE_INTERFACE:
-                    printf("  Interface: %s\n", track->data.interface.interface);
+                    printf("  Interface: %s\n", if_name(track->data.interface.ifid));
                     printf("  Track: %s%s\n",
                            track->data.interface.protocol_up ? "Protocol" : "",
                            track->data.interface.line_up ? " Line" : "");
@@ -18,6 +18,8 @@
 #include <stdbool.h>
 #include <arpa/inet.h>
 #include "../frr_core/lib/huawei_cli.h"
+#include "../frr_core/lib/if_registry.h"
+#include "../frr_core/lib/pcpu_stats.h"
 
 /* VRRP version */
 typedef enum {
@@ -39,6 +41,16 @@ typedef enum {
     VRRP_AUTH_MD5
 } vrrp_auth_type_t;
 
+/* Instance counters, one per-CPU group per instance */
+enum {
+    VRRP_STAT_MASTER_TRANSITIONS = 0,
+    VRRP_STAT_ADVERT_SENT,
+    VRRP_STAT_ADVERT_RECEIVED,
+    VRRP_STAT_PRIORITY_ZERO_SENT,
+    VRRP_STAT_PRIORITY_ZERO_RECEIVED,
+    VRRP_STAT_MAX
+};
+
 /* Track object */
 struct vrrp_track {
     char name[64];
@@ -50,7 +62,7 @@ struct vrrp_track {
 /* VRRP instance */
 struct vrrp_instance {
     uint8_t vrid;                    /* Virtual Router ID (1-255) */
-    char interface[64];              /* Interface name */
+    ifid_t ifid;                     /* Interface */
     vrrp_version_t version;          /* VRRP version */
     vrrp_state_t state;              /* Current state */
     uint8_t priority;                /* Priority (1-254) */
@@ -72,11 +84,7 @@ struct vrrp_instance {
     int track_count;
 
     /* Statistics */
-    uint64_t master_transitions;
-    uint64_t advert_sent;
-    uint64_t advert_received;
-    uint64_t priority_zero_sent;
-    uint64_t priority_zero_received;
+    pcpu_counter_t stats;            /* VRRP_STAT_* */
 
     /* Timers */
     time_t last_advert_time;
@@ -115,8 +123,14 @@ static int cmd_vrrp_vrid(struct cmd_element *cmd, struct cmd_args *args)
     }
 
     if (!current_vrrp && vrrp_instance_count < 256) {
+        pcpu_counter_t stats = pcpu_counter_alloc(VRRP_STAT_MAX);
+        if (stats == PCPU_COUNTER_NONE) {
+            printf("Error: Out of memory for VRRP %u counters\n", vrid);
+            return -1;
+        }
         current_vrrp = &vrrp_instances[vrrp_instance_count++];
         memset(current_vrrp, 0, sizeof(struct vrrp_instance));
+        current_vrrp->stats = stats;
         current_vrrp->vrid = vrid;
         current_vrrp->version = VRRP_VERSION_2;
         current_vrrp->state = VRRP_STATE_INITIALIZE;
@@ -438,6 +452,7 @@ static int cmd_display_vrrp(struct cmd_element *cmd, struct cmd_args *args)
             interface = args->argv[++i];
         }
     }
+    ifid_t filter = interface ? if_lookup(interface) : IFID_NONE;
 
     if (brief) {
         /* Brief display */
@@ -449,7 +464,7 @@ static int cmd_display_vrrp(struct cmd_element *cmd, struct cmd_args *args)
 
         for (int i = 0; i < vrrp_instance_count; i++) {
             struct vrrp_instance *vrrp = &vrrp_instances[i];
-            if (interface && strcmp(vrrp->interface, interface) != 0) {
+            if (interface && (filter == IFID_NONE || vrrp->ifid != filter)) {
                 continue;
             }
 
@@ -463,7 +478,7 @@ static int cmd_display_vrrp(struct cmd_element *cmd, struct cmd_args *args)
 
             printf("%-6u %-15s %-10s %-10u %-15s\n",
                    vrrp->vrid,
-                   vrrp->interface[0] ? vrrp->interface : "-",
+                   vrrp->ifid != IFID_NONE ? if_name(vrrp->ifid) : "-",
                    state_str,
                    vrrp->effective_priority,
                    vrrp->virtual_ip_count > 0 ? vrrp->virtual_ips[0] : "-");
@@ -472,12 +487,12 @@ static int cmd_display_vrrp(struct cmd_element *cmd, struct cmd_args *args)
         /* Detailed display */
         for (int i = 0; i < vrrp_instance_count; i++) {
             struct vrrp_instance *vrrp = &vrrp_instances[i];
-            if (interface && strcmp(vrrp->interface, interface) != 0) {
+            if (interface && (filter == IFID_NONE || vrrp->ifid != filter)) {
                 continue;
             }
 
             printf("\nVRRP Instance %u:\n", vrrp->vrid);
-            printf("  Interface: %s\n", vrrp->interface[0] ? vrrp->interface : "Not configured");
+            printf("  Interface: %s\n", vrrp->ifid != IFID_NONE ? if_name(vrrp->ifid) : "Not configured");
             printf("  Version: %d\n", vrrp->version);
 
             const char *state_str;
@@ -521,10 +536,15 @@ static int cmd_display_vrrp(struct cmd_element *cmd, struct cmd_args *args)
                 }
             }
 
+            struct pcpu_snapshot stats;
+            pcpu_counter_read(vrrp->stats, VRRP_STAT_MAX, &stats);
             printf("  Statistics:\n");
-            printf("    Master transitions: %lu\n", vrrp->master_transitions);
-            printf("    Advertisements sent: %lu\n", vrrp->advert_sent);
-            printf("    Advertisements received: %lu\n", vrrp->advert_received);
+            printf("    Master transitions: %lu\n", stats.values[VRRP_STAT_MASTER_TRANSITIONS]);
+            printf("    Advertisements sent: %lu\n", stats.values[VRRP_STAT_ADVERT_SENT]);
+            printf("    Advertisements received: %lu\n", stats.values[VRRP_STAT_ADVERT_RECEIVED]);
+            printf("    Priority zero sent: %lu\n", stats.values[VRRP_STAT_PRIORITY_ZERO_SENT]);
+            printf("    Priority zero received: %lu\n",
+                   stats.values[VRRP_STAT_PRIORITY_ZERO_RECEIVED]);
         }
     }
 
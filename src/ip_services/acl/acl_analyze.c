@@ -0,0 +1,540 @@
+/*
+ * ACL Rule Analysis
+ * Copyright (C) 2026 WhiteBox NE Team
+ *
+ * This module provides the rule analysis of acl_analyze.h including:
+ * - Rules widened into masked words and port ranges, exact for
+ *   discontiguous IPv4 wildcards, with overlap and cover tests
+ * - Static interval trees per field, each rule's range projected to 64
+ *   bits, queried for the rules overlapping a range
+ * - Overlap counts per field by binary search, to enumerate the field
+ *   with the fewest candidates
+ * - Shadowed, redundant and correlated rules in one pass in rule order
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include "acl_analyze.h"
+
+/* Words: source and destination word 0, protocol, then IPv6 words 1-3 */
+#define ANALYZE_WORDS           9
+#define ANALYZE_WORDS_V4        3
+#define ANALYZE_WORD_PROTOCOL   2
+#define ANALYZE_NONE            UINT32_MAX
+#define ANALYZE_SCAN            64      /* Later rules tried in order before the tree */
+
+/* Fields with an interval tree */
+enum {
+    ANALYZE_DIM_SRC = 0,
+    ANALYZE_DIM_DST,
+    ANALYZE_DIM_SRC_PORT,
+    ANALYZE_DIM_DST_PORT,
+    ANALYZE_DIMS
+};
+
+/* Rule widened for the pairwise tests; value is masked */
+struct analyze_rule {
+    uint32_t value[ANALYZE_WORDS];
+    uint32_t mask[ANALYZE_WORDS];
+    uint16_t port_lo[2];        /* Source, destination */
+    uint16_t port_hi[2];
+    uint64_t lo[ANALYZE_DIMS];  /* Range of each field, addresses cut to 64 bits */
+    uint64_t hi[ANALYZE_DIMS];
+    uint32_t index;             /* In the ACL */
+    bool permit;
+};
+
+/*
+ * Rules sorted by low bound. Position m is the root of the subtree over
+ * a range of positions centred on it, as in a binary search, and
+ * max_hi[m] is the highest bound in that subtree. The live fields cover
+ * only the rules inserted so far: the earlier rules that stayed live.
+ */
+struct analyze_tree {
+    uint32_t *order;
+    uint32_t *position;         /* Of each rule in order */
+    uint64_t *lo;
+    uint64_t *hi;
+    uint64_t *max_hi;
+    uint64_t *live_max_hi;
+    uint32_t *live_count;       /* Inserted rules in the subtree */
+    uint64_t *hi_sorted;        /* For counting */
+};
+
+/* Rules of one address family */
+struct analyze_family {
+    struct analyze_rule *rules;
+    uint32_t count;
+    uint32_t words;
+    struct analyze_tree trees[ANALYZE_DIMS];
+    bool *inserted;
+    uint32_t *found;            /* Candidates of the current rule, earlier then later */
+};
+
+struct analyze_sort {
+    uint64_t key;
+    uint32_t rule;
+};
+
+static uint32_t addr_word(const uint8_t *addr, int word)
+{
+    const uint8_t *b = addr + word * 4;
+    return ((uint32_t)b[0] << 24) | ((uint32_t)b[1] << 16) | ((uint32_t)b[2] << 8) | b[3];
+}
+
+static uint32_t plen_mask(uint8_t plen, int word)
+{
+    int bits = (int)plen - word * 32;
+    return bits >= 32 ? ~0u : bits <= 0 ? 0 : ~0u << (32 - bits);
+}
+
+/* Slot of address word w of the source or destination */
+static int addr_slot(bool source, int word)
+{
+    if (word == 0) {
+        return source ? 0 : 1;
+    }
+    return (source ? 2 : 5) + word;
+}
+
+static void rule_widen(const struct acl_rule *rule, uint32_t index, struct analyze_rule *out)
+{
+    memset(out, 0, sizeof(*out));
+    if (rule->flags & ACL_RULE_IPV6) {
+        for (int w = 0; w < 4; w++) {
+            out->mask[addr_slot(true, w)] = plen_mask(rule->src_plen, w);
+            out->value[addr_slot(true, w)] = addr_word(rule->v6.src, w);
+            out->mask[addr_slot(false, w)] = plen_mask(rule->dst_plen, w);
+            out->value[addr_slot(false, w)] = addr_word(rule->v6.dst, w);
+        }
+    } else {
+        out->mask[0] = rule->v4.src_mask;
+        out->value[0] = rule->v4.src;
+        out->mask[1] = rule->v4.dst_mask;
+        out->value[1] = rule->v4.dst;
+    }
+    if (!(rule->flags & ACL_RULE_ANY_PROTOCOL)) {
+        out->mask[ANALYZE_WORD_PROTOCOL] = 0xff;
+        out->value[ANALYZE_WORD_PROTOCOL] = rule->protocol;
+    }
+    for (int i = 0; i < ANALYZE_WORDS; i++) {
+        out->value[i] &= out->mask[i];
+    }
+    out->port_lo[0] = rule->src_port[0];
+    out->port_hi[0] = rule->src_port[1];
+    out->port_lo[1] = rule->dst_port[0];
+    out->port_hi[1] = rule->dst_port[1];
+
+    /* Bounding ranges; a discontiguous wildcard gets the range of its set bits */
+    for (int source = 1; source >= 0; source--) {
+        int dim = source ? ANALYZE_DIM_SRC : ANALYZE_DIM_DST;
+        uint64_t value = (uint64_t)out->value[addr_slot(source, 0)] << 32;
+        uint64_t mask = (uint64_t)out->mask[addr_slot(source, 0)] << 32;
+        if (rule->flags & ACL_RULE_IPV6) {
+            value |= out->value[addr_slot(source, 1)];
+            mask |= out->mask[addr_slot(source, 1)];
+        }
+        out->lo[dim] = value;
+        out->hi[dim] = value | ~mask;
+    }
+    out->lo[ANALYZE_DIM_SRC_PORT] = rule->src_port[0];
+    out->hi[ANALYZE_DIM_SRC_PORT] = rule->src_port[1];
+    out->lo[ANALYZE_DIM_DST_PORT] = rule->dst_port[0];
+    out->hi[ANALYZE_DIM_DST_PORT] = rule->dst_port[1];
+    out->index = index;
+    out->permit = rule->flags & ACL_RULE_PERMIT;
+}
+
+/* Some packet matches both rules */
+static inline bool rule_overlap(const struct analyze_rule *a, const struct analyze_rule *b,
+                                uint32_t words)
+{
+    for (uint32_t i = 0; i < words; i++) {
+        if ((a->value[i] ^ b->value[i]) & a->mask[i] & b->mask[i]) {
+            return false;
+        }
+    }
+    for (int p = 0; p < 2; p++) {
+        if (a->port_lo[p] > b->port_hi[p] || b->port_lo[p] > a->port_hi[p]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Every packet of b matches a */
+static inline bool rule_covers(const struct analyze_rule *a, const struct analyze_rule *b,
+                               uint32_t words)
+{
+    for (uint32_t i = 0; i < words; i++) {
+        if ((a->mask[i] & ~b->mask[i]) || ((a->value[i] ^ b->value[i]) & a->mask[i])) {
+            return false;
+        }
+    }
+    for (int p = 0; p < 2; p++) {
+        if (a->port_lo[p] > b->port_lo[p] || b->port_hi[p] > a->port_hi[p]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static int sort_by_key(const void *a, const void *b)
+{
+    const struct analyze_sort *x = a, *y = b;
+    if (x->key != y->key) {
+        return x->key < y->key ? -1 : 1;
+    }
+    return x->rule < y->rule ? -1 : x->rule > y->rule;
+}
+
+static int sort_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static uint64_t tree_fill(struct analyze_tree *tree, uint32_t l, uint32_t r)
+{
+    if (l >= r) {
+        return 0;
+    }
+    uint32_t m = l + (r - l) / 2;
+    uint64_t max = tree->hi[m];
+    uint64_t left = tree_fill(tree, l, m);
+    uint64_t right = tree_fill(tree, m + 1, r);
+    max = left > max ? left : max;
+    max = right > max ? right : max;
+    tree->max_hi[m] = max;
+    return max;
+}
+
+static int tree_build(struct analyze_family *family, int dim, struct analyze_sort *sort)
+{
+    struct analyze_tree *tree = &family->trees[dim];
+    uint32_t n = family->count, slots = n ? n : 1;
+
+    tree->order = malloc(slots * sizeof(*tree->order));
+    tree->position = malloc(slots * sizeof(*tree->position));
+    tree->lo = malloc(slots * sizeof(*tree->lo));
+    tree->hi = malloc(slots * sizeof(*tree->hi));
+    tree->max_hi = malloc(slots * sizeof(*tree->max_hi));
+    tree->live_max_hi = calloc(slots, sizeof(*tree->live_max_hi));
+    tree->live_count = calloc(slots, sizeof(*tree->live_count));
+    tree->hi_sorted = malloc(slots * sizeof(*tree->hi_sorted));
+    if (!tree->order || !tree->position || !tree->lo || !tree->hi || !tree->max_hi ||
+        !tree->live_max_hi || !tree->live_count || !tree->hi_sorted) {
+        return -ENOMEM;
+    }
+    for (uint32_t r = 0; r < n; r++) {
+        sort[r] = (struct analyze_sort) { .key = family->rules[r].lo[dim], .rule = r };
+        tree->hi_sorted[r] = family->rules[r].hi[dim];
+    }
+    qsort(sort, n, sizeof(*sort), sort_by_key);
+    qsort(tree->hi_sorted, n, sizeof(*tree->hi_sorted), sort_u64);
+    for (uint32_t p = 0; p < n; p++) {
+        tree->order[p] = sort[p].rule;
+        tree->position[sort[p].rule] = p;
+        tree->lo[p] = sort[p].key;
+        tree->hi[p] = family->rules[sort[p].rule].hi[dim];
+    }
+    tree_fill(tree, 0, n);
+    return 0;
+}
+
+/* Add a rule to the live fields on the path from the root to it */
+static void tree_insert(struct analyze_tree *tree, uint32_t n, uint32_t rule)
+{
+    uint32_t p = tree->position[rule], l = 0, r = n;
+
+    for (;;) {
+        uint32_t m = l + (r - l) / 2;
+        tree->live_count[m]++;
+        if (tree->live_max_hi[m] < tree->hi[p]) {
+            tree->live_max_hi[m] = tree->hi[p];
+        }
+        if (m == p) {
+            return;
+        }
+        if (p < m) {
+            r = m;
+        } else {
+            l = m + 1;
+        }
+    }
+}
+
+/* Positions of a sorted array with values <= v, or < v */
+static uint32_t count_upto(const uint64_t *sorted, uint32_t n, uint64_t v, bool inclusive)
+{
+    uint32_t l = 0, r = n;
+
+    while (l < r) {
+        uint32_t m = l + (r - l) / 2;
+        if (sorted[m] < v || (inclusive && sorted[m] == v)) {
+            l = m + 1;
+        } else {
+            r = m;
+        }
+    }
+    return l;
+}
+
+/* Rules whose range overlaps [a, b]: low bound <= b minus high bound < a */
+static uint32_t tree_count(const struct analyze_tree *tree, uint32_t n, uint64_t a, uint64_t b)
+{
+    return count_upto(tree->lo, n, b, true) - count_upto(tree->hi_sorted, n, a, false);
+}
+
+/* Append the rules overlapping [a, b] in one field, all or only inserted ones */
+static void tree_query(const struct analyze_family *family, int dim, bool live, uint32_t l,
+                       uint32_t r, uint64_t a, uint64_t b, uint32_t *found)
+{
+    const struct analyze_tree *tree = &family->trees[dim];
+
+    while (l < r) {
+        uint32_t m = l + (r - l) / 2;
+        if (live ? !tree->live_count[m] || tree->live_max_hi[m] < a : tree->max_hi[m] < a) {
+            return;
+        }
+        tree_query(family, dim, live, l, m, a, b, found);
+        if (tree->lo[m] > b) {
+            return;
+        }
+        if (tree->hi[m] >= a && (!live || family->inserted[tree->order[m]])) {
+            family->found[(*found)++] = tree->order[m];
+        }
+        l = m + 1;
+    }
+}
+
+static void family_free(struct analyze_family *family)
+{
+    for (int d = 0; d < ANALYZE_DIMS; d++) {
+        struct analyze_tree *tree = &family->trees[d];
+        free(tree->order);
+        free(tree->position);
+        free(tree->lo);
+        free(tree->hi);
+        free(tree->max_hi);
+        free(tree->live_max_hi);
+        free(tree->live_count);
+        free(tree->hi_sorted);
+    }
+    free(family->rules);
+    free(family->inserted);
+    free(family->found);
+    memset(family, 0, sizeof(*family));
+}
+
+static int family_build(struct analyze_family *family, const struct acl_rule *rules,
+                        uint32_t count, bool v6)
+{
+    uint32_t slots = count ? count : 1;
+
+    memset(family, 0, sizeof(*family));
+    family->words = v6 ? ANALYZE_WORDS : ANALYZE_WORDS_V4;
+    family->rules = malloc(slots * sizeof(*family->rules));
+    family->inserted = calloc(slots, sizeof(*family->inserted));
+    family->found = malloc(2 * slots * sizeof(*family->found));
+    if (!family->rules || !family->inserted || !family->found) {
+        return -ENOMEM;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        if (((rules[i].flags & ACL_RULE_IPV6) != 0) == v6) {
+            rule_widen(&rules[i], i, &family->rules[family->count++]);
+        }
+    }
+
+    struct analyze_sort *sort = malloc((family->count ? family->count : 1) * sizeof(*sort));
+    int ret = sort ? 0 : -ENOMEM;
+    for (int d = 0; d < ANALYZE_DIMS && ret == 0; d++) {
+        ret = tree_build(family, d, sort);
+    }
+    free(sort);
+    return ret;
+}
+
+/* Field whose tree holds the fewest rules overlapping the rule */
+static int best_dim(const struct analyze_family *family, const struct analyze_rule *rule)
+{
+    uint32_t best_count = UINT32_MAX;
+    int best = 0;
+
+    for (int d = 0; d < ANALYZE_DIMS; d++) {
+        uint32_t c = tree_count(&family->trees[d], family->count, rule->lo[d], rule->hi[d]);
+        if (c < best_count) {
+            best_count = c;
+            best = d;
+        }
+    }
+    return best;
+}
+
+/*
+ * Later rule that makes rule j redundant, or ANALYZE_NONE. The first
+ * later rule overlapping it decides unless it only overlaps with the
+ * same action: the other action keeps rule j, a covering rule makes it
+ * redundant. That rule is usually close, so the next ANALYZE_SCAN rules
+ * are tried in order before the tree is searched.
+ */
+static uint32_t later_cover(const struct analyze_family *family, uint32_t j, int dim,
+                            uint32_t *found, struct acl_analysis *analysis)
+{
+    const struct analyze_rule *rule = &family->rules[j];
+    uint32_t n = family->count, words = family->words;
+    uint32_t end = j + 1 + ANALYZE_SCAN < n ? j + 1 + ANALYZE_SCAN : n;
+
+    for (uint32_t c = j + 1; c < end; c++) {
+        const struct analyze_rule *other = &family->rules[c];
+        analysis->compared++;
+        if (!rule_overlap(rule, other, words)) {
+            continue;
+        }
+        if (other->permit != rule->permit) {
+            return ANALYZE_NONE;
+        }
+        if (rule_covers(other, rule, words)) {
+            return c;
+        }
+    }
+    if (end == n) {
+        return ANALYZE_NONE;
+    }
+
+    uint32_t first = *found, later = ANALYZE_NONE, conflict = ANALYZE_NONE;
+    tree_query(family, dim, false, 0, n, rule->lo[dim], rule->hi[dim], found);
+    analysis->compared += *found - first;
+    for (uint32_t f = first; f < *found; f++) {
+        uint32_t c = family->found[f];
+        const struct analyze_rule *other = &family->rules[c];
+        if (c < end || !rule_overlap(rule, other, words)) {
+            continue;
+        }
+        if (other->permit != rule->permit) {
+            conflict = c < conflict ? c : conflict;
+        } else if (c < later && rule_covers(other, rule, words)) {
+            later = c;
+        }
+    }
+    return later < conflict ? later : ANALYZE_NONE;
+}
+
+/*
+ * Classify rule j of a family. Only earlier rules that stayed live can
+ * cover it or correlate with it; it joins them when it stays live too.
+ */
+static void analyze_rule(struct analyze_family *family, uint32_t j, struct acl_analysis *analysis)
+{
+    const struct analyze_rule *rule = &family->rules[j];
+    uint32_t words = family->words, found = 0;
+    int dim = best_dim(family, rule);
+
+    tree_query(family, dim, true, 0, family->count, rule->lo[dim], rule->hi[dim], &found);
+    analysis->compared += found;
+
+    uint32_t cover = ANALYZE_NONE;
+    for (uint32_t f = 0; f < found; f++) {
+        uint32_t c = family->found[f];
+        if (c < cover && rule_covers(&family->rules[c], rule, words)) {
+            cover = c;
+        }
+    }
+    if (cover != ANALYZE_NONE) {
+        const struct analyze_rule *by = &family->rules[cover];
+        bool shadowed = by->permit != rule->permit;
+        analysis->status[rule->index] = shadowed ? ACL_ANALYSIS_SHADOWED : ACL_ANALYSIS_REDUNDANT;
+        analysis->by[rule->index] = by->index;
+        if (shadowed) {
+            analysis->shadowed++;
+        } else {
+            analysis->redundant++;
+        }
+        return;
+    }
+
+    uint32_t earlier = found, later = later_cover(family, j, dim, &found, analysis);
+    if (later != ANALYZE_NONE) {
+        analysis->status[rule->index] = ACL_ANALYSIS_REDUNDANT;
+        analysis->by[rule->index] = family->rules[later].index;
+        analysis->redundant++;
+        return;
+    }
+
+    for (uint32_t f = 0; f < earlier; f++) {
+        const struct analyze_rule *other = &family->rules[family->found[f]];
+        if (other->permit == rule->permit || !rule_overlap(rule, other, words) ||
+            rule_covers(rule, other, words)) {
+            continue;
+        }
+        if (analysis->pair_count < ACL_ANALYSIS_MAX_PAIRS) {
+            analysis->pairs[analysis->pair_count][0] = other->index;
+            analysis->pairs[analysis->pair_count][1] = rule->index;
+            analysis->pair_count++;
+        }
+        analysis->correlated++;
+    }
+
+    family->inserted[j] = true;
+    for (int d = 0; d < ANALYZE_DIMS; d++) {
+        tree_insert(&family->trees[d], family->count, j);
+    }
+}
+
+/*
+ * Analyse the rules of an ACL, sorted by rule ID. Returns 0 or -ENOMEM;
+ * free the result with acl_analysis_free().
+ */
+int acl_analyze(const struct acl_rule *rules, uint32_t count, struct acl_analysis *analysis)
+{
+    struct analyze_family family;
+    int ret = 0;
+
+    memset(analysis, 0, sizeof(*analysis));
+    analysis->rules = count;
+    analysis->status = calloc(count ? count : 1, sizeof(*analysis->status));
+    analysis->by = malloc((count ? count : 1) * sizeof(*analysis->by));
+    analysis->pairs = malloc(ACL_ANALYSIS_MAX_PAIRS * sizeof(*analysis->pairs));
+    if (!analysis->status || !analysis->by || !analysis->pairs) {
+        acl_analysis_free(analysis);
+        return -ENOMEM;
+    }
+
+    for (int v6 = 0; v6 <= 1 && ret == 0; v6++) {
+        ret = family_build(&family, rules, count, v6);
+        for (uint32_t j = 0; j < family.count && ret == 0; j++) {
+            analyze_rule(&family, j, analysis);
+        }
+        family_free(&family);
+    }
+    if (ret < 0) {
+        acl_analysis_free(analysis);
+    }
+    return ret;
+}
+
+/* Copy the live rules, in order, to out; returns their number */
+uint32_t acl_analysis_optimize(const struct acl_rule *rules, const struct acl_analysis *analysis,
+                               struct acl_rule *out)
+{
+    uint32_t kept = 0;
+
+    for (uint32_t i = 0; i < analysis->rules; i++) {
+        if (analysis->status[i] == ACL_ANALYSIS_LIVE) {
+            out[kept++] = rules[i];
+        }
+    }
+    return kept;
+}
+
+void acl_analysis_free(struct acl_analysis *analysis)
+{
+    free(analysis->status);
+    free(analysis->by);
+    free(analysis->pairs);
+    memset(analysis, 0, sizeof(*analysis));
+}
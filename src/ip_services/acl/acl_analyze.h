@@ -0,0 +1,61 @@
+/*
+ * ACL Rule Analysis
+ * Copyright (C) 2026 WhiteBox NE Team
+ *
+ * Finds rules of an ACL that never decide a packet, and pairs of rules
+ * whose order matters, from the packed rules of acl_huawei.h:
+ *
+ * - Shadowed: an earlier rule with the other action matches every
+ *   packet of the rule, so it never matches
+ * - Redundant: an earlier rule with the same action matches every packet
+ *   of the rule, or a later one does and no rule in between that
+ *   overlaps it has the other action; removing it changes no verdict
+ * - Correlated: two rules with different actions overlap without either
+ *   covering the other; reordering them changes the verdict of the
+ *   packets they share
+ *
+ * Removing every shadowed and redundant rule at once keeps the verdict
+ * of every packet, which gives the optimized rule list.
+ *
+ * Candidate pairs come from static interval trees over the source and
+ * destination addresses and both port ranges. For each rule the field
+ * whose tree holds the fewest overlapping rules, counted by binary
+ * search, is enumerated and the candidates are checked on all fields,
+ * so a rule is compared with the rules it could overlap rather than
+ * with all of them.
+ */
+
+#ifndef _ACL_ANALYZE_H
+#define _ACL_ANALYZE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "acl_huawei.h"
+
+#define ACL_ANALYSIS_MAX_PAIRS  1024    /* Correlated pairs kept for display */
+
+/* Status of a rule */
+enum {
+    ACL_ANALYSIS_LIVE = 0,
+    ACL_ANALYSIS_SHADOWED,
+    ACL_ANALYSIS_REDUNDANT,
+};
+
+struct acl_analysis {
+    uint32_t rules;
+    uint32_t shadowed;
+    uint32_t redundant;         /* Covered by an earlier or a later rule */
+    uint64_t correlated;        /* Pairs of live rules */
+    uint64_t compared;          /* Candidate pairs checked on all fields */
+    uint8_t *status;            /* Per rule, ACL_ANALYSIS_* */
+    uint32_t *by;               /* Index of the covering rule of a dead rule */
+    uint32_t (*pairs)[2];       /* First correlated pairs, earlier rule first */
+    uint32_t pair_count;
+};
+
+int acl_analyze(const struct acl_rule *rules, uint32_t count, struct acl_analysis *analysis);
+uint32_t acl_analysis_optimize(const struct acl_rule *rules, const struct acl_analysis *analysis,
+                               struct acl_rule *out);
+void acl_analysis_free(struct acl_analysis *analysis);
+
+#endif /* _ACL_ANALYZE_H */
@@ -0,0 +1,246 @@
+/*
+ * ACL Analysis Benchmark for Huawei VRP Style
+ * Copyright (C) 2026 WhiteBox NE Team
+ *
+ * This program measures the rule analysis of acl_analyze.h including:
+ * - Analysis time at 1k, 10k, 50k and 100k rules
+ * - Candidate pairs checked per rule, against the n/2 of comparing
+ *   every pair
+ * - Shadowed, redundant and correlated rules found
+ * - Equivalence of the optimized list: the verdict of every sample key
+ *   is the same with and without the removed rules
+ *
+ * Rule sets imitate generated advanced ACLs as in acl_lookup_bench,
+ * with one rule in twenty a narrowed copy of an earlier rule, with
+ * either action, so it is shadowed or redundant.
+ *
+ * Usage: acl_analyze_bench [-m max_rules] [-s shape]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+#include "acl_analyze.h"
+#include "acl_lookup.h"
+
+#define BENCH_KEYS          65536
+#define BENCH_COPY_EVERY    20      /* One rule in this many narrows an earlier one */
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint32_t rand32(void)
+{
+    return ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+}
+
+static uint32_t prefix_mask(int len)
+{
+    return len ? ~0u << (32 - len) : 0;
+}
+
+static void random_ports(uint16_t range[2], bool ranges)
+{
+    static const uint16_t services[] = { 22, 53, 80, 123, 179, 443, 3306, 8080 };
+
+    if (ranges && rand() % 3 == 0) {
+        range[0] = (uint16_t)(rand() % 60000);
+        range[1] = (uint16_t)(range[0] + rand() % 4096);
+    } else if (rand() % 4 == 0) {
+        range[0] = 0;
+        range[1] = 65535;
+    } else {
+        range[0] = range[1] = services[rand() % 8];
+    }
+}
+
+static void random_rule(struct acl_rule *rule, const char *shape, uint32_t id)
+{
+    memset(rule, 0, sizeof(*rule));
+    rule->rule_id = id;
+    rule->flags = rand() % 8 ? ACL_RULE_PERMIT : 0;
+    rule->protocol = rand() % 2 ? 6 : 17;
+    rule->src_port[1] = rule->dst_port[1] = 65535;
+
+    if (strcmp(shape, "ipv6") == 0) {
+        static const uint8_t lens[] = { 48, 56, 64, 128 };
+        rule->flags |= ACL_RULE_IPV6;
+        rule->src_plen = lens[rand() % 4];
+        rule->dst_plen = lens[rand() % 4];
+        for (int b = 0; b < 16; b++) {
+            int keep_src = rule->src_plen - b * 8, keep_dst = rule->dst_plen - b * 8;
+            uint8_t v = b < 2 ? (uint8_t)(0x20 + b) : b < 7 ? (uint8_t)(rand() % 4) : (uint8_t)rand();
+            rule->v6.src[b] = v & (keep_src >= 8 ? 0xff : keep_src > 0 ? 0xff << (8 - keep_src) : 0);
+            v = b < 2 ? (uint8_t)(0x20 + b) : b < 7 ? (uint8_t)(rand() % 4) : (uint8_t)rand();
+            rule->v6.dst[b] = v & (keep_dst >= 8 ? 0xff : keep_dst > 0 ? 0xff << (8 - keep_dst) : 0);
+        }
+        random_ports(rule->dst_port, false);
+        return;
+    }
+
+    bool mixed = strcmp(shape, "mixed") == 0;
+    int src_len = mixed ? 8 + rand() % 25 : rand() % 2 ? 24 : 32;
+    int dst_len = mixed ? 8 + rand() % 25 : rand() % 2 ? 24 : 32;
+    rule->v4.src_mask = prefix_mask(src_len);
+    rule->v4.src = (0x0a000000 | (rand32() & 0x00ffffff)) & rule->v4.src_mask;
+    rule->v4.dst_mask = prefix_mask(dst_len);
+    rule->v4.dst = (0xac100000 | (rand32() & 0x000fffff)) & rule->v4.dst_mask;
+    if (mixed && rand() % 8 == 0) {
+        rule->flags |= ACL_RULE_ANY_PROTOCOL;
+        return;
+    }
+    random_ports(rule->dst_port, mixed);
+    if (mixed && rand() % 4 == 0) {
+        random_ports(rule->src_port, true);
+    }
+}
+
+/* A copy of an earlier rule, narrowed to a host pair and one port */
+static void narrowed_rule(struct acl_rule *rule, const struct acl_rule *earlier, uint32_t id)
+{
+    *rule = *earlier;
+    rule->rule_id = id;
+    rule->flags ^= rand() % 2 ? ACL_RULE_PERMIT : 0;
+    if (rule->flags & ACL_RULE_IPV6) {
+        rule->src_plen = rule->dst_plen = 128;
+        rule->v6.src[15] |= (uint8_t)rand() & (earlier->src_plen < 128 ? 0xff : 0);
+    } else {
+        rule->v4.src |= rand32() & ~rule->v4.src_mask;
+        rule->v4.src_mask = rule->v4.dst_mask = ~0u;
+        rule->v4.dst |= rand32() & ~earlier->v4.dst_mask;
+    }
+    rule->dst_port[1] = rule->dst_port[0];
+}
+
+static void random_key(struct acl_key *key, const struct acl_rule *rule)
+{
+    memset(key, 0, sizeof(*key));
+    key->v6 = rule->flags & ACL_RULE_IPV6;
+    key->protocol = rule->flags & ACL_RULE_ANY_PROTOCOL ? (rand() % 2 ? 6 : 17) : rule->protocol;
+    key->src_port = (uint16_t)(rule->src_port[0] +
+                               rand32() % (rule->src_port[1] - rule->src_port[0] + 1));
+    key->dst_port = (uint16_t)(rule->dst_port[0] +
+                               rand32() % (rule->dst_port[1] - rule->dst_port[0] + 1));
+    if (key->v6) {
+        for (int w = 0; w < 4; w++) {
+            int bits_src = rule->src_plen - w * 32, bits_dst = rule->dst_plen - w * 32;
+            uint32_t ms = bits_src >= 32 ? ~0u : bits_src <= 0 ? 0 : prefix_mask(bits_src);
+            uint32_t md = bits_dst >= 32 ? ~0u : bits_dst <= 0 ? 0 : prefix_mask(bits_dst);
+            const uint8_t *s = &rule->v6.src[w * 4], *d = &rule->v6.dst[w * 4];
+            uint32_t sw = ((uint32_t)s[0] << 24) | (s[1] << 16) | (s[2] << 8) | s[3];
+            uint32_t dw = ((uint32_t)d[0] << 24) | (d[1] << 16) | (d[2] << 8) | d[3];
+            key->src[w] = (sw & ms) | (rand32() & ~ms);
+            key->dst[w] = (dw & md) | (rand32() & ~md);
+        }
+    } else {
+        key->src[0] = rule->v4.src | (rand32() & ~rule->v4.src_mask);
+        key->dst[0] = rule->v4.dst | (rand32() & ~rule->v4.dst_mask);
+    }
+}
+
+/* Permit, deny, or no match */
+static int verdict(const struct acl_lookup *lookup, const struct acl_rule *rules,
+                   const struct acl_key *key)
+{
+    int first = acl_lookup_find(lookup, key);
+    return first < 0 ? 2 : rules[first].flags & ACL_RULE_PERMIT;
+}
+
+static void bench_shape(const char *shape, uint32_t count)
+{
+    struct acl_rule *rules = malloc(count * sizeof(*rules));
+    struct acl_rule *kept = malloc(count * sizeof(*kept));
+    struct acl_analysis analysis;
+
+    if (!rules || !kept) {
+        fprintf(stderr, "Error: Out of memory for %u rules\n", count);
+        exit(1);
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        if (i > 0 && rand() % BENCH_COPY_EVERY == 0) {
+            narrowed_rule(&rules[i], &rules[rand32() % i], (i + 1) * ACL_RULE_STEP);
+        } else {
+            random_rule(&rules[i], shape, (i + 1) * ACL_RULE_STEP);
+        }
+    }
+
+    double t0 = now_sec();
+    if (acl_analyze(rules, count, &analysis) < 0) {
+        printf("%-7s %7u  analysis failed\n", shape, count);
+        exit(1);
+    }
+    double elapsed = now_sec() - t0;
+    uint32_t kept_count = acl_analysis_optimize(rules, &analysis, kept);
+
+    /* Keys inside random rules of the original list, removed ones included */
+    struct acl_lookup *full = acl_lookup_build(rules, count, ACL_ENGINE_AUTO);
+    struct acl_lookup *optimized = acl_lookup_build(kept, kept_count, ACL_ENGINE_AUTO);
+    uint32_t same = 0;
+    if (!full || !optimized) {
+        fprintf(stderr, "Error: lookup build failed\n");
+        exit(1);
+    }
+    for (uint32_t k = 0; k < BENCH_KEYS; k++) {
+        struct acl_key key;
+        random_key(&key, &rules[rand32() % count]);
+        same += verdict(full, rules, &key) == verdict(optimized, kept, &key);
+    }
+
+    printf("%-7s %7u %10.1f %10.1f %9u %9u %11lu %7u  %u/%u\n", shape, count, elapsed * 1e3,
+           (double)analysis.compared / count, analysis.shadowed, analysis.redundant,
+           (unsigned long)analysis.correlated, kept_count, same, BENCH_KEYS);
+
+    acl_lookup_free(full);
+    acl_lookup_free(optimized);
+    acl_analysis_free(&analysis);
+    free(rules);
+    free(kept);
+}
+
+int main(int argc, char **argv)
+{
+    static const uint32_t counts[] = { 1000, 10000, 50000, 100000 };
+    uint32_t max_rules = 100000;
+    const char *only = NULL;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "m:s:")) != -1) {
+        switch (opt) {
+        case 'm':
+            max_rules = (uint32_t)atol(optarg);
+            break;
+        case 's':
+            only = optarg;
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-m max_rules] [-s prefix|mixed|ipv6]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    srand(1);
+    printf("ACL analysis: %d sample keys per ACL, inside random rules\n\n", BENCH_KEYS);
+    printf("%-7s %7s %10s %10s %9s %9s %11s %7s  %s\n", "Shape", "Rules", "Analyse ms",
+           "Pairs/rule", "Shadowed", "Redundant", "Correlated", "Kept", "Same verdict");
+
+    static const char *shapes[] = { "prefix", "mixed", "ipv6" };
+    for (int s = 0; s < 3; s++) {
+        if (only && strcmp(only, shapes[s]) != 0) {
+            continue;
+        }
+        for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+            if (counts[c] <= max_rules) {
+                bench_shape(shapes[s], counts[c]);
+            }
+        }
+    }
+    return 0;
+}
@@ -1,6 +1,22 @@
 /*
  * ACL Support for Huawei VRP Style
  * Copyright (C) 2026 WhiteBox NE Team
+ *
+ * This module provides basic and advanced ACLs including:
+ * - Rule parsing into the packed form of acl_huawei.h, IPv4 with
+ *   wildcard masks and IPv6 with prefix lengths
+ * - Rules kept sorted by ID, found by binary search; a rule with an
+ *   existing ID replaces it
+ * - First-match lookup through acl_lookup.c, per packet or per burst,
+ *   on a copy of the rules and its index built on the configuration side
+ *   once per edit or load and published with one pointer swap; the
+ *   replaced copy is retired through qsbr
+ * - Flow cache invalidation on every publish or binding change
+ * - traffic-filter bindings, enforced through the nftables backend; the
+ *   rule changes and bindings of a command, or of a whole load or
+ *   commit, push one atomic batch
+ * - Shadowed, redundant and correlated rule reports through
+ *   acl_analyze.c, and the equivalent list without the dead rules
  */
 
 #include <stdio.h>
@@ -8,34 +24,470 @@
 #include <string.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <errno.h>
+#include <arpa/inet.h>
 #include "../../frr_core/lib/huawei_cli.h"
+#include "../../frr_core/lib/slab.h"
+#include "../../frr_core/lib/flow_cache.h"
+#include "../../frr_core/lib/if_registry.h"
+#include "../../frr_core/lib/qsbr.h"
+#include "acl_huawei.h"
+#include "acl_lookup.h"
+#include "acl_analyze.h"
+#include "acl_nft.h"
 
-typedef enum {
-    ACL_TYPE_BASIC = 0,    /* 2000-2999 */
-    ACL_TYPE_ADVANCED = 1  /* 3000-3999 */
-} acl_type_t;
-
-struct acl_rule {
-    uint32_t rule_id;
-    bool permit;
-    char source[64];
-    char destination[64];
-    char protocol[16];
-    uint16_t src_port;
-    uint16_t dst_port;
+/* Protocol keywords of advanced rules */
+static const struct {
+    const char *name;
+    uint8_t number;
+    uint8_t flags;
+} acl_protocols[] = {
+    { "ip",     0,   ACL_RULE_ANY_PROTOCOL },
+    { "ipv6",   0,   ACL_RULE_ANY_PROTOCOL | ACL_RULE_IPV6 },
+    { "icmp",   1,   0 },
+    { "igmp",   2,   0 },
+    { "tcp",    6,   0 },
+    { "udp",    17,  0 },
+    { "gre",    47,  0 },
+    { "icmpv6", 58,  ACL_RULE_IPV6 },
+    { "ospf",   89,  0 },
+    { "sctp",   132, 0 },
 };
 
-struct acl_config {
-    uint32_t acl_number;
-    acl_type_t type;
-    char description[128];
-    struct acl_rule rules[128];
-    int rule_count;
+#define ACL_PROTOCOL_COUNT (sizeof(acl_protocols) / sizeof(acl_protocols[0]))
+
+/* Address operand while a rule is parsed, before the family is known */
+struct acl_addr {
+    bool set;
+    int family;                 /* AF_INET or AF_INET6, 0 for any */
+    uint32_t v4;
+    uint32_t v4_mask;
+    uint8_t v6_addr[16];
+    uint8_t plen;
 };
 
-static struct acl_config acls[1000];
-static int acl_count = 0;
-static struct acl_config *current_acl = NULL;
+/* Rules and index as the datapath sees them, immutable once published */
+struct acl_published {
+    struct acl_lookup *lookup;  /* NULL for an empty ACL */
+    struct acl_rule *rules;
+    uint32_t count;
+};
+
+static struct slab acl_slab = SLAB_INIT("acl", struct acl_config);
+static struct acl_config *acl_by_number[ACL_NUMBER_MAX - ACL_NUMBER_MIN + 1];
+static slab_handle_t current_acl = SLAB_HANDLE_NONE;
+static struct acl_nft_binding acl_filters[ACL_NFT_MAX_BINDINGS];
+static uint32_t acl_filter_count = 0;
+static bool acl_filters_changed = false;
+
+static struct acl_config *acl_find(uint32_t acl_num)
+{
+    if (acl_num < ACL_NUMBER_MIN || acl_num > ACL_NUMBER_MAX) {
+        return NULL;
+    }
+    return __atomic_load_n(&acl_by_number[acl_num - ACL_NUMBER_MIN], __ATOMIC_ACQUIRE);
+}
+
+/* Index of the first rule with an ID not below rule_id */
+static int acl_rule_index(const struct acl_config *acl, uint32_t rule_id)
+{
+    int lo = 0, hi = acl->rule_count;
+
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (acl->rules[mid].rule_id < rule_id) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static void acl_published_free(void *ptr)
+{
+    struct acl_published *pub = ptr;
+
+    acl_lookup_free(pub->lookup);
+    free(pub->rules);
+    free(pub);
+}
+
+/*
+ * Copy the rules of an ACL, index the copy and swap it in for the
+ * datapath. Returns 0 or -ENOMEM, leaving the previous copy in use.
+ */
+static int acl_publish(struct acl_config *acl)
+{
+    struct acl_published *pub = calloc(1, sizeof(*pub));
+
+    if (!pub) {
+        return -ENOMEM;
+    }
+    pub->count = acl->rule_count;
+    if (pub->count > 0) {
+        pub->rules = malloc(pub->count * sizeof(*pub->rules));
+        if (pub->rules) {
+            memcpy(pub->rules, acl->rules, pub->count * sizeof(*pub->rules));
+            pub->lookup = acl_lookup_build(pub->rules, pub->count, ACL_ENGINE_AUTO);
+        }
+        if (!pub->lookup) {
+            acl_published_free(pub);
+            return -ENOMEM;
+        }
+    }
+
+    struct acl_published *old = __atomic_exchange_n(&acl->published, pub, __ATOMIC_ACQ_REL);
+    qsbr_retire(old, acl_published_free);
+    acl->dirty = false;
+    return 0;
+}
+
+/*
+ * Store a rule at its place in ID order, replacing a rule with the same
+ * ID. Rules from a configuration file arrive in order and are appended.
+ * The datapath keeps matching the published copy until acl_publish().
+ */
+static int acl_rule_insert(struct acl_config *acl, const struct acl_rule *rule, bool *replaced)
+{
+    int idx = acl->rule_count;
+
+    acl->dirty = true;
+    if (acl->nft) {
+        acl->nft->stale = true;
+    }
+
+    if (idx > 0 && acl->rules[idx - 1].rule_id >= rule->rule_id) {
+        idx = acl_rule_index(acl, rule->rule_id);
+    }
+    *replaced = idx < acl->rule_count && acl->rules[idx].rule_id == rule->rule_id;
+    if (*replaced) {
+        acl->rules[idx] = *rule;
+        return 0;
+    }
+
+    if (acl->rule_count == acl->rule_capacity) {
+        int capacity = acl->rule_capacity ? acl->rule_capacity * 2 : 16;
+        struct acl_rule *rules = realloc(acl->rules, capacity * sizeof(*rules));
+        if (!rules) {
+            return -1;
+        }
+        acl->rules = rules;
+        acl->rule_capacity = capacity;
+    }
+    memmove(&acl->rules[idx + 1], &acl->rules[idx], (acl->rule_count - idx) * sizeof(*rule));
+    acl->rules[idx] = *rule;
+    acl->rule_count++;
+    return 0;
+}
+
+/* Rules the datapath matches against, NULL for an unknown or empty ACL */
+static const struct acl_published *acl_published_find(uint32_t acl_number)
+{
+    struct acl_config *acl = acl_find(acl_number);
+    const struct acl_published *pub;
+
+    if (!acl) {
+        return NULL;
+    }
+    pub = __atomic_load_n(&acl->published, __ATOMIC_ACQUIRE);
+    return pub && pub->lookup ? pub : NULL;
+}
+
+/*
+ * First rule of an ACL matching a packet, NULL for no match or an
+ * unknown ACL. The rule stays valid until the caller's next quiescent
+ * state.
+ */
+const struct acl_rule *acl_match(uint32_t acl_number, const struct acl_key *key)
+{
+    const struct acl_published *pub = acl_published_find(acl_number);
+
+    if (!pub) {
+        return NULL;
+    }
+    int idx = acl_lookup_find(pub->lookup, key);
+    return idx < 0 ? NULL : &pub->rules[idx];
+}
+
+/* acl_match() for count packets; small ACLs match them as a batch */
+void acl_match_burst(uint32_t acl_number, const struct acl_key *keys, uint32_t count,
+                     const struct acl_rule **rules)
+{
+    const struct acl_published *pub = acl_published_find(acl_number);
+    int first[PKT_MATCH_BURST];
+
+    for (uint32_t base = 0; base < count; base += PKT_MATCH_BURST) {
+        uint32_t n = count - base < PKT_MATCH_BURST ? count - base : PKT_MATCH_BURST;
+        if (pub) {
+            acl_lookup_find_burst(pub->lookup, &keys[base], n, first);
+        } else {
+            memset(first, 0xff, n * sizeof(*first));
+        }
+        for (uint32_t i = 0; i < n; i++) {
+            rules[base + i] = first[i] < 0 ? NULL : &pub->rules[first[i]];
+        }
+    }
+}
+
+/*
+ * ACL of the traffic-filter on an interface and direction, 0 for none.
+ * Bindings change on the configuration side; a datapath looks the ACL up
+ * once per batch, not per packet.
+ */
+uint32_t acl_filter_find(ifid_t ifid, bool outbound)
+{
+    for (uint32_t i = 0; i < acl_filter_count; i++) {
+        if (acl_filters[i].ifid == ifid && acl_filters[i].outbound == outbound) {
+            return acl_filters[i].acl_number;
+        }
+    }
+    return 0;
+}
+
+static bool acl_bound(uint32_t acl_number)
+{
+    for (uint32_t i = 0; i < acl_filter_count; i++) {
+        if (acl_filters[i].acl_number == acl_number) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Bring the kernel in line with the traffic-filter bindings in one
+ * batch: chains of bound ACLs that are new or changed, the jumps of the
+ * bindings, and removal of chains no longer bound. Returns 0 or a
+ * negative errno; the kernel keeps its previous state on error and the
+ * ACLs stay marked for the next attempt.
+ */
+static int acl_filter_sync(uint32_t *messages)
+{
+    struct acl_nft_batch *batch = acl_nft_begin();
+    int ret = 0;
+
+    if (!batch) {
+        return -ENOMEM;
+    }
+    for (uint32_t num = ACL_NUMBER_MIN; num <= ACL_NUMBER_MAX && ret == 0; num++) {
+        struct acl_config *acl = acl_find(num);
+        if (!acl || !acl_bound(num)) {
+            continue;
+        }
+        if (!acl->nft && !(acl->nft = calloc(1, sizeof(*acl->nft)))) {
+            ret = -ENOMEM;
+            break;
+        }
+        acl->nft->acl_number = num;
+        if (!acl->nft->installed || acl->nft->stale) {
+            ret = acl_nft_put_acl(batch, acl->nft, acl);
+        }
+    }
+    acl_nft_put_bindings(batch, acl_filters, acl_filter_count);
+    for (uint32_t num = ACL_NUMBER_MIN; num <= ACL_NUMBER_MAX; num++) {
+        struct acl_config *acl = acl_find(num);
+        if (acl && acl->nft && acl->nft->installed && !acl_bound(num)) {
+            acl_nft_put_remove(batch, acl->nft);
+        }
+    }
+
+    int sent = acl_nft_commit(batch, messages);
+    return ret ? ret : sent;
+}
+
+/* Report the result of a sync to the operator */
+static void acl_filter_report(int ret, uint32_t messages)
+{
+    if (ret < 0) {
+        printf("Warning: traffic-filter not installed in nftables: %s\n", strerror(-ret));
+    } else {
+        printf("Installed in nftables table %s: %u netlink messages in one batch\n",
+               ACL_NFT_TABLE, messages);
+    }
+}
+
+/*
+ * Apply the ACL edits of a command, or of a whole load or commit: publish
+ * every changed ACL, then bring the kernel in line in one batch when a
+ * bound ACL or a binding changed.
+ */
+static void acl_apply_changes(void)
+{
+    bool published = false, sync = acl_filters_changed;
+
+    for (uint32_t num = ACL_NUMBER_MIN; num <= ACL_NUMBER_MAX; num++) {
+        struct acl_config *acl = acl_find(num);
+        if (!acl || !acl->dirty) {
+            continue;
+        }
+        if (acl_publish(acl) < 0) {
+            printf("Error: Out of memory for ACL %u lookup, previous rules stay in use\n", num);
+            continue;
+        }
+        published = true;
+        sync = sync || acl_bound(num);
+    }
+    if (published || acl_filters_changed) {
+        flow_cache_invalidate();
+    }
+    acl_filters_changed = false;
+    if (sync) {
+        uint32_t messages = 0;
+        int ret = acl_filter_sync(&messages);
+        acl_filter_report(ret, messages);
+    }
+}
+
+static bool parse_u32(const char *str, unsigned long limit, uint32_t *value)
+{
+    char *end;
+
+    if (str[0] < '0' || str[0] > '9') {
+        return false;
+    }
+    unsigned long v = strtoul(str, &end, 10);
+    if (*end != '\0' || v > limit) {
+        return false;
+    }
+    *value = (uint32_t)v;
+    return true;
+}
+
+/* Dotted IPv4 address in host order */
+static bool parse_ipv4(const char *str, uint32_t *addr)
+{
+    struct in_addr in;
+
+    if (inet_pton(AF_INET, str, &in) != 1) {
+        return false;
+    }
+    *addr = ntohl(in.s_addr);
+    return true;
+}
+
+/*
+ * Parse an address operand at argv[*i], advancing *i past it:
+ *   any
+ *   <ipv4> <wildcard>   dotted wildcard, 0 for a host, or a mask length 1-32
+ *   <ipv4>/<len>
+ *   <ipv6> [<len>]      also <ipv6>/<len>; a bare address is a host
+ */
+static int parse_acl_addr(struct cmd_args *args, int *i, struct acl_addr *out)
+{
+    const char *token = args->argv[*i];
+    char text[INET6_ADDRSTRLEN + 4];
+    uint32_t len = 0;
+
+    memset(out, 0, sizeof(*out));
+    out->set = true;
+    if (strcmp(token, "any") == 0) {
+        (*i)++;
+        return 0;
+    }
+
+    strncpy(text, token, sizeof(text) - 1);
+    text[sizeof(text) - 1] = '\0';
+    char *slash = strchr(text, '/');
+    if (slash) {
+        *slash = '\0';
+    }
+    const char *next = *i + 1 < args->argc ? args->argv[*i + 1] : NULL;
+    (*i)++;
+
+    if (strchr(text, ':')) {
+        out->family = AF_INET6;
+        len = 128;
+        if (inet_pton(AF_INET6, text, out->v6_addr) != 1) {
+            return -1;
+        }
+        if (slash) {
+            if (!parse_u32(slash + 1, 128, &len)) {
+                return -1;
+            }
+        } else if (next && parse_u32(next, 128, &len)) {
+            (*i)++;
+        }
+        out->plen = (uint8_t)len;
+        for (int b = 0; b < 16; b++) {
+            int keep = (int)len - b * 8;
+            out->v6_addr[b] &= keep >= 8 ? 0xff : keep > 0 ? (uint8_t)(0xff << (8 - keep)) : 0;
+        }
+        return 0;
+    }
+
+    out->family = AF_INET;
+    if (!parse_ipv4(text, &out->v4)) {
+        return -1;
+    }
+    uint32_t wildcard;
+    if (slash) {
+        if (!parse_u32(slash + 1, 32, &len)) {
+            return -1;
+        }
+        out->v4_mask = len ? ~0u << (32 - len) : 0;
+    } else if (next && parse_u32(next, 32, &len)) {
+        /* 0 is the host wildcard, other numbers are mask lengths */
+        out->v4_mask = len ? ~0u << (32 - len) : ~0u;
+        (*i)++;
+    } else if (next && parse_ipv4(next, &wildcard)) {
+        out->v4_mask = ~wildcard;
+        (*i)++;
+    } else {
+        out->v4_mask = ~0u;
+    }
+    out->v4 &= out->v4_mask;
+    return 0;
+}
+
+/* Parse "eq|gt|lt <port>" or "range <low> <high>" at argv[*i] */
+static int parse_acl_ports(struct cmd_args *args, int *i, uint16_t range[2])
+{
+    uint32_t a, b;
+
+    if (*i + 1 >= args->argc || !parse_u32(args->argv[*i + 1], 65535, &a)) {
+        return -1;
+    }
+    const char *op = args->argv[*i];
+    if (strcmp(op, "eq") == 0) {
+        b = a;
+    } else if (strcmp(op, "gt") == 0 && a < 65535) {
+        b = 65535;
+        a++;
+    } else if (strcmp(op, "lt") == 0 && a > 0) {
+        b = a - 1;
+        a = 0;
+    } else if (strcmp(op, "range") == 0 && *i + 2 < args->argc &&
+               parse_u32(args->argv[*i + 2], 65535, &b)) {
+        if (a > b) {
+            uint32_t t = a;
+            a = b;
+            b = t;
+        }
+        (*i)++;
+    } else {
+        return -1;
+    }
+    *i += 2;
+    range[0] = (uint16_t)a;
+    range[1] = (uint16_t)b;
+    return 0;
+}
+
+/* Copy a parsed address operand into the rule, whose family is set */
+static void acl_rule_set_addr(struct acl_rule *rule, const struct acl_addr *addr, bool source)
+{
+    if (rule->flags & ACL_RULE_IPV6) {
+        memcpy(source ? rule->v6.src : rule->v6.dst, addr->v6_addr, 16);
+        *(source ? &rule->src_plen : &rule->dst_plen) = addr->plen;
+    } else if (source) {
+        rule->v4.src = addr->v4;
+        rule->v4.src_mask = addr->v4_mask;
+    } else {
+        rule->v4.dst = addr->v4;
+        rule->v4.dst_mask = addr->v4_mask;
+    }
+}
 
 /*
  * Create or enter ACL
@@ -61,20 +513,18 @@ static int cmd_acl(struct cmd_element *cmd, struct cmd_args *args)
     }
 
     /* Find or create ACL */
-    current_acl = NULL;
-    for (int i = 0; i < acl_count; i++) {
-        if (acls[i].acl_number == acl_num) {
-            current_acl = &acls[i];
-            break;
+    struct acl_config *acl = acl_find(acl_num);
+    if (!acl) {
+        acl = slab_alloc(&acl_slab, NULL);
+        if (!acl) {
+            printf("Error: Out of memory for ACL %u\n", acl_num);
+            return -1;
         }
+        acl->acl_number = acl_num;
+        acl->type = type;
+        __atomic_store_n(&acl_by_number[acl_num - ACL_NUMBER_MIN], acl, __ATOMIC_RELEASE);
     }
-
-    if (!current_acl && acl_count < 1000) {
-        current_acl = &acls[acl_count++];
-        memset(current_acl, 0, sizeof(struct acl_config));
-        current_acl->acl_number = acl_num;
-        current_acl->type = type;
-    }
+    current_acl = slab_handle(&acl_slab, acl);
 
     printf("Entering ACL %u (%s) configuration\n", acl_num,
            type == ACL_TYPE_BASIC ? "basic" : "advanced");
@@ -82,109 +532,447 @@ static int cmd_acl(struct cmd_element *cmd, struct cmd_args *args)
 }
 
 /*
- * Add ACL rule
- * Command: rule [<rule-id>] {permit|deny} [source <ip> <wildcard>] [destination <ip> <wildcard>]
+ * Add or replace ACL rule
+ * Command: rule [<rule-id>] {permit|deny} [<protocol>]
+ *          [source {<ip> <wildcard>|<ip>/<len>|any}] [source-port {eq|gt|lt <port>|range <low> <high>}]
+ *          [destination {<ip> <wildcard>|<ip>/<len>|any}] [destination-port ...]
+ * Basic ACLs take only the source address.
  */
 static int cmd_acl_rule(struct cmd_element *cmd, struct cmd_args *args)
 {
-    if (!current_acl) {
+    struct acl_config *acl = slab_get(&acl_slab, current_acl);
+    if (!acl) {
         printf("Error: No ACL configured\n");
         return -1;
     }
 
-    if (args->argc < 2) {
+    if (args->argc < 1) {
         printf("Error: Insufficient arguments\n");
         return -1;
     }
 
-    if (current_acl->rule_count >= 128) {
-        printf("Error: Maximum rules reached\n");
-        return -1;
-    }
-
-    struct acl_rule *rule = &current_acl->rules[current_acl->rule_count++];
-    memset(rule, 0, sizeof(struct acl_rule));
-
+    struct acl_rule rule = {
+        .flags = ACL_RULE_ANY_PROTOCOL,
+        .src_port = { 0, 65535 },
+        .dst_port = { 0, 65535 },
+    };
     int idx = 0;
-    /* Parse rule ID if present */
-    if (atoi(args->argv[0]) > 0) {
-        rule->rule_id = atoi(args->argv[0]);
+
+    /* Parse rule ID if present, else number after the last rule */
+    if (parse_u32(args->argv[0], UINT32_MAX - 1, &rule.rule_id)) {
         idx = 1;
+    } else if (acl->rule_count > 0) {
+        uint64_t next = ((uint64_t)acl->rules[acl->rule_count - 1].rule_id / ACL_RULE_STEP + 1) *
+                        ACL_RULE_STEP;
+        if (next > UINT32_MAX - 1) {
+            printf("Error: No rule ID left after %u, specify one\n",
+                   acl->rules[acl->rule_count - 1].rule_id);
+            return -1;
+        }
+        rule.rule_id = (uint32_t)next;
     } else {
-        rule->rule_id = current_acl->rule_count * 5;
+        rule.rule_id = ACL_RULE_STEP;
     }
 
     /* Parse permit/deny */
-    if (strcmp(args->argv[idx], "permit") == 0) {
-        rule->permit = true;
-    } else if (strcmp(args->argv[idx], "deny") == 0) {
-        rule->permit = false;
-    } else {
+    if (idx < args->argc && strcmp(args->argv[idx], "permit") == 0) {
+        rule.flags |= ACL_RULE_PERMIT;
+    } else if (idx >= args->argc || strcmp(args->argv[idx], "deny") != 0) {
         printf("Error: Expected 'permit' or 'deny'\n");
-        current_acl->rule_count--;
         return -1;
     }
     idx++;
 
-    /* Parse source */
-    for (int i = idx; i < args->argc; i++) {
-        if (strcmp(args->argv[i], "source") == 0 && i + 1 < args->argc) {
-            strncpy(rule->source, args->argv[i + 1], sizeof(rule->source) - 1);
-            i++;
-        } else if (strcmp(args->argv[i], "destination") == 0 && i + 1 < args->argc) {
-            strncpy(rule->destination, args->argv[i + 1], sizeof(rule->destination) - 1);
-            i++;
+    /* Parse the protocol, by keyword or number; ip and ipv6 fix the family */
+    int family = 0;
+    if (idx < args->argc && acl->type == ACL_TYPE_ADVANCED) {
+        uint32_t number;
+        size_t p = 0;
+        while (p < ACL_PROTOCOL_COUNT && strcmp(args->argv[idx], acl_protocols[p].name) != 0) {
+            p++;
+        }
+        if (p < ACL_PROTOCOL_COUNT) {
+            rule.flags = (rule.flags & ACL_RULE_PERMIT) | acl_protocols[p].flags;
+            rule.protocol = acl_protocols[p].number;
+            if (acl_protocols[p].flags & ACL_RULE_IPV6) {
+                family = AF_INET6;
+            } else if (acl_protocols[p].flags & ACL_RULE_ANY_PROTOCOL) {
+                family = AF_INET;
+            }
+            idx++;
+        } else if (parse_u32(args->argv[idx], 255, &number) && number > 0) {
+            rule.flags &= ~ACL_RULE_ANY_PROTOCOL;
+            rule.protocol = (uint8_t)number;
+            idx++;
         }
     }
 
-    printf("ACL rule %u added\n", rule->rule_id);
+    /* Parse addresses and ports */
+    struct acl_addr src = { 0 }, dst = { 0 };
+    bool ports = false;
+    for (int i = idx; i < args->argc;) {
+        const char *key = args->argv[i++];
+        int rc = -1;
+
+        if (i >= args->argc) {
+            printf("Error: Value required after '%s'\n", key);
+            return -1;
+        }
+        if (strcmp(key, "source") == 0) {
+            rc = parse_acl_addr(args, &i, &src);
+        } else if (acl->type == ACL_TYPE_BASIC) {
+            printf("Error: Basic ACL %u matches the source address only\n", acl->acl_number);
+            return -1;
+        } else if (strcmp(key, "destination") == 0) {
+            rc = parse_acl_addr(args, &i, &dst);
+        } else if (strcmp(key, "source-port") == 0) {
+            rc = parse_acl_ports(args, &i, rule.src_port);
+            ports = true;
+        } else if (strcmp(key, "destination-port") == 0) {
+            rc = parse_acl_ports(args, &i, rule.dst_port);
+            ports = true;
+        } else {
+            printf("Error: Unknown keyword '%s'\n", key);
+            return -1;
+        }
+        if (rc < 0) {
+            printf("Error: Invalid %s '%s'\n", key, args->argv[i - 1]);
+            return -1;
+        }
+    }
+
+    /* One address family per rule, IPv4 unless something says IPv6 */
+    const int families[] = { src.family, dst.family };
+    for (int f = 0; f < 2; f++) {
+        if (family && families[f] && families[f] != family) {
+            printf("Error: Rule mixes IPv4 and IPv6\n");
+            return -1;
+        }
+        family = family ? family : families[f];
+    }
+    if (family == AF_INET6) {
+        rule.flags |= ACL_RULE_IPV6;
+    }
+    if (ports && ((rule.flags & ACL_RULE_ANY_PROTOCOL) ||
+                  (rule.protocol != 6 && rule.protocol != 17 && rule.protocol != 132))) {
+        printf("Error: Ports require tcp, udp or sctp\n");
+        return -1;
+    }
+    if (src.set) {
+        acl_rule_set_addr(&rule, &src, true);
+    }
+    if (dst.set) {
+        acl_rule_set_addr(&rule, &dst, false);
+    }
+
+    bool replaced;
+    if (acl_rule_insert(acl, &rule, &replaced) < 0) {
+        printf("Error: Out of memory for ACL %u rules\n", acl->acl_number);
+        return -1;
+    }
+    printf("ACL rule %u %s\n", rule.rule_id, replaced ? "replaced" : "added");
+    cli_commit_defer(acl_apply_changes);
     return 0;
 }
 
 /*
- * Display ACL
- * Command: display acl [<acl-number>]
+ * Bind an ACL to an interface; it replaces an ACL bound in the same
+ * direction there
+ * Command: traffic-filter {inbound|outbound} acl <acl-number> interface <interface-name>
  */
-static int cmd_display_acl(struct cmd_element *cmd, struct cmd_args *args)
+static int cmd_traffic_filter(struct cmd_element *cmd, struct cmd_args *args)
+{
+    if (args->argc < 5 || strcmp(args->argv[1], "acl") != 0 ||
+        strcmp(args->argv[3], "interface") != 0) {
+        printf("Error: Direction, ACL and interface required\n");
+        printf("Usage: traffic-filter {inbound|outbound} acl <acl-number> interface <interface-name>\n");
+        return -1;
+    }
+
+    bool outbound = strcmp(args->argv[0], "outbound") == 0;
+    if (!outbound && strcmp(args->argv[0], "inbound") != 0) {
+        printf("Error: Direction must be 'inbound' or 'outbound'\n");
+        return -1;
+    }
+    uint32_t acl_num;
+    if (!parse_u32(args->argv[2], ACL_NUMBER_MAX, &acl_num) || !acl_find(acl_num)) {
+        printf("Error: ACL %s not found\n", args->argv[2]);
+        return -1;
+    }
+    ifid_t ifid = if_intern(args->argv[4]);
+    if (ifid == IFID_NONE) {
+        printf("Error: Invalid interface name %s\n", args->argv[4]);
+        return -1;
+    }
+
+    uint32_t i = 0;
+    while (i < acl_filter_count &&
+           (acl_filters[i].ifid != ifid || acl_filters[i].outbound != outbound)) {
+        i++;
+    }
+    if (i == ACL_NFT_MAX_BINDINGS) {
+        printf("Error: At most %d traffic-filter bindings\n", ACL_NFT_MAX_BINDINGS);
+        return -1;
+    }
+    if (i == acl_filter_count) {
+        acl_filter_count++;
+    }
+    acl_filters[i] = (struct acl_nft_binding) {
+        .ifid = ifid, .outbound = outbound, .acl_number = acl_num,
+    };
+
+    acl_filters_changed = true;
+
+    printf("ACL %u applied %s on %s\n", acl_num, args->argv[0], if_name(ifid));
+    if (if_kernel_index(ifid) <= 0) {
+        printf("Interface %s is not in the kernel; the filter waits for it\n", if_name(ifid));
+    }
+    cli_commit_defer(acl_apply_changes);
+    return 0;
+}
+
+/*
+ * Remove the ACL bound to an interface direction
+ * Command: undo traffic-filter {inbound|outbound} interface <interface-name>
+ */
+static int cmd_undo_traffic_filter(struct cmd_element *cmd, struct cmd_args *args)
+{
+    /* argv[0] is the "traffic-filter" keyword */
+    if (args->argc < 4 || strcmp(args->argv[2], "interface") != 0) {
+        printf("Error: Direction and interface required\n");
+        printf("Usage: undo traffic-filter {inbound|outbound} interface <interface-name>\n");
+        return -1;
+    }
+
+    bool outbound = strcmp(args->argv[1], "outbound") == 0;
+    if (!outbound && strcmp(args->argv[1], "inbound") != 0) {
+        printf("Error: Direction must be 'inbound' or 'outbound'\n");
+        return -1;
+    }
+    ifid_t ifid = if_lookup(args->argv[3]);
+    uint32_t i = 0;
+    while (i < acl_filter_count &&
+           (acl_filters[i].ifid != ifid || acl_filters[i].outbound != outbound)) {
+        i++;
+    }
+    if (ifid == IFID_NONE || i == acl_filter_count) {
+        printf("Error: No traffic-filter %s on %s\n", args->argv[1], args->argv[3]);
+        return -1;
+    }
+
+    uint32_t acl_num = acl_filters[i].acl_number;
+    acl_filters[i] = acl_filters[--acl_filter_count];
+    acl_filters_changed = true;
+
+    printf("ACL %u removed %s on %s\n", acl_num, args->argv[1], if_name(ifid));
+    cli_commit_defer(acl_apply_changes);
+    return 0;
+}
+
+/* Append " <key> <address>" for a rule address, nothing when it matches any */
+static void format_acl_addr(const struct acl_rule *rule, bool source, char *buf, size_t size)
+{
+    const char *key = source ? "source" : "destination";
+    size_t len = strlen(buf);
+    char text[INET6_ADDRSTRLEN];
+
+    if (rule->flags & ACL_RULE_IPV6) {
+        uint8_t plen = source ? rule->src_plen : rule->dst_plen;
+        if (plen) {
+            inet_ntop(AF_INET6, source ? rule->v6.src : rule->v6.dst, text, sizeof(text));
+            snprintf(buf + len, size - len, " %s %s/%u", key, text, plen);
+        }
+        return;
+    }
+
+    uint32_t mask = source ? rule->v4.src_mask : rule->v4.dst_mask;
+    if (mask) {
+        struct in_addr addr = { htonl(source ? rule->v4.src : rule->v4.dst) };
+        struct in_addr wildcard = { htonl(~mask) };
+        char wtext[INET_ADDRSTRLEN];
+        inet_ntop(AF_INET, &addr, text, sizeof(text));
+        inet_ntop(AF_INET, &wildcard, wtext, sizeof(wtext));
+        snprintf(buf + len, size - len, " %s %s %s", key, text, wtext);
+    }
+}
+
+static void format_acl_ports(const uint16_t range[2], const char *key, char *buf, size_t size)
 {
-    if (args->argc > 0) {
-        uint32_t acl_num = atoi(args->argv[0]);
-        struct acl_config *acl = NULL;
+    size_t len = strlen(buf);
 
-        for (int i = 0; i < acl_count; i++) {
-            if (acls[i].acl_number == acl_num) {
-                acl = &acls[i];
-                break;
+    if (range[0] == 0 && range[1] == 65535) {
+        return;
+    } else if (range[0] == range[1]) {
+        snprintf(buf + len, size - len, " %s eq %u", key, range[0]);
+    } else if (range[1] == 65535) {
+        snprintf(buf + len, size - len, " %s gt %u", key, range[0] - 1);
+    } else if (range[0] == 0) {
+        snprintf(buf + len, size - len, " %s lt %u", key, range[1] + 1);
+    } else {
+        snprintf(buf + len, size - len, " %s range %u %u", key, range[0], range[1]);
+    }
+}
+
+/* Rule in configuration syntax, without the rule keyword and ID */
+static void format_acl_rule(const struct acl_rule *rule, acl_type_t type, char *buf, size_t size)
+{
+    snprintf(buf, size, "%s", rule->flags & ACL_RULE_PERMIT ? "permit" : "deny");
+    if (type == ACL_TYPE_ADVANCED) {
+        const char *name = NULL;
+        if (rule->flags & ACL_RULE_ANY_PROTOCOL) {
+            name = rule->flags & ACL_RULE_IPV6 ? "ipv6" : "ip";
+        }
+        for (size_t p = 0; p < ACL_PROTOCOL_COUNT && !name; p++) {
+            if (!(acl_protocols[p].flags & ACL_RULE_ANY_PROTOCOL) &&
+                acl_protocols[p].number == rule->protocol) {
+                name = acl_protocols[p].name;
             }
         }
+        size_t len = strlen(buf);
+        if (name) {
+            snprintf(buf + len, size - len, " %s", name);
+        } else {
+            snprintf(buf + len, size - len, " %u", rule->protocol);
+        }
+    }
+    format_acl_addr(rule, true, buf, size);
+    format_acl_ports(rule->src_port, "source-port", buf, size);
+    format_acl_addr(rule, false, buf, size);
+    format_acl_ports(rule->dst_port, "destination-port", buf, size);
+}
+
+/*
+ * Report dead and correlated rules; with optimized, print the rules that
+ * remain in configuration syntax instead
+ */
+static int display_acl_analysis(const struct acl_config *acl, bool optimized)
+{
+    struct acl_analysis analysis;
+    char text[256];
+
+    if (acl_analyze(acl->rules, (uint32_t)acl->rule_count, &analysis) < 0) {
+        printf("Error: Out of memory analysing ACL %u\n", acl->acl_number);
+        return -1;
+    }
+
+    if (optimized) {
+        printf("ACL %u without shadowed and redundant rules, %u of %u rules:\n",
+               acl->acl_number, acl->rule_count - analysis.shadowed - analysis.redundant,
+               acl->rule_count);
+        for (int i = 0; i < acl->rule_count; i++) {
+            if (analysis.status[i] == ACL_ANALYSIS_LIVE) {
+                format_acl_rule(&acl->rules[i], acl->type, text, sizeof(text));
+                printf(" rule %u %s\n", acl->rules[i].rule_id, text);
+            }
+        }
+        acl_analysis_free(&analysis);
+        return 0;
+    }
+
+    printf("ACL %u analysis: %d rules, %.1f candidate pairs per rule\n", acl->acl_number,
+           acl->rule_count, acl->rule_count ? (double)analysis.compared / acl->rule_count : 0.0);
+    printf("  Shadowed: %u, redundant: %u, correlated pairs: %lu\n", analysis.shadowed,
+           analysis.redundant, (unsigned long)analysis.correlated);
+    for (int i = 0; i < acl->rule_count; i++) {
+        const struct acl_rule *rule = &acl->rules[i];
+        uint32_t by = analysis.by[i];
+        if (analysis.status[i] == ACL_ANALYSIS_SHADOWED) {
+            printf("    Rule %u: shadowed by rule %u\n", rule->rule_id, acl->rules[by].rule_id);
+        } else if (analysis.status[i] == ACL_ANALYSIS_REDUNDANT) {
+            printf("    Rule %u: redundant, covered by %srule %u\n", rule->rule_id,
+                   by > (uint32_t)i ? "later " : "", acl->rules[by].rule_id);
+        }
+    }
+    for (uint32_t p = 0; p < analysis.pair_count; p++) {
+        printf("    Rules %u and %u: correlated\n", acl->rules[analysis.pairs[p][0]].rule_id,
+               acl->rules[analysis.pairs[p][1]].rule_id);
+    }
+    if (analysis.correlated > analysis.pair_count) {
+        printf("    ... %lu more correlated pairs\n",
+               (unsigned long)(analysis.correlated - analysis.pair_count));
+    }
+    acl_analysis_free(&analysis);
+    return 0;
+}
+
+/*
+ * Display ACL
+ * Command: display acl [<acl-number> [analysis [optimized]]]
+ */
+static int cmd_display_acl(struct cmd_element *cmd, struct cmd_args *args)
+{
+    /* argv[0] is the "acl" keyword */
+    if (args->argc > 1) {
+        uint32_t acl_num = atoi(args->argv[1]);
+        struct acl_config *acl = acl_find(acl_num);
 
         if (!acl) {
             printf("Error: ACL not found\n");
             return -1;
         }
+        if (args->argc > 2) {
+            bool optimized = args->argc > 3 && strcmp(args->argv[3], "optimized") == 0;
+            if (strcmp(args->argv[2], "analysis") != 0 || (args->argc > 3 && !optimized)) {
+                printf("Error: Unknown option %s\n",
+                       strcmp(args->argv[2], "analysis") != 0 ? args->argv[2] : args->argv[3]);
+                printf("Usage: display acl <acl-number> [analysis [optimized]]\n");
+                return -1;
+            }
+            return display_acl_analysis(acl, optimized);
+        }
 
         printf("ACL %u (%s):\n", acl->acl_number,
                acl->type == ACL_TYPE_BASIC ? "Basic" : "Advanced");
-        printf("  Rules: %d\n", acl->rule_count);
-        for (int i = 0; i < acl->rule_count; i++) {
-            printf("    Rule %u: %s", acl->rules[i].rule_id,
-                   acl->rules[i].permit ? "permit" : "deny");
-            if (acl->rules[i].source[0]) {
-                printf(" source %s", acl->rules[i].source);
+        printf("  Rules: %d, %zu bytes\n", acl->rule_count,
+               (size_t)acl->rule_capacity * sizeof(struct acl_rule));
+        const struct acl_published *pub = acl->published;
+        if (pub && pub->lookup) {
+            if (acl->dirty) {
+                printf("  Lookup: %u rules, changes not yet committed\n", pub->count);
+            }
+            for (int v6 = 0; v6 <= 1; v6++) {
+                struct acl_lookup_info info;
+                acl_lookup_info(pub->lookup, v6, &info);
+                if (info.rules > 0) {
+                    printf("  %s lookup: %s, %u rules", v6 ? "IPv6" : "IPv4",
+                           acl_engine_name(info.engine), info.rules);
+                    if (info.batched) {
+                        printf(", bursts by %s kernel", pkt_match_impl_name(pkt_match_best()));
+                    }
+                    printf("\n");
+                }
             }
-            if (acl->rules[i].destination[0]) {
-                printf(" destination %s", acl->rules[i].destination);
+            printf("  Lookup memory: %zu bytes\n", acl_lookup_memory(pub->lookup));
+        }
+        if (acl->nft && (acl->nft->installed || acl->nft->error)) {
+            const struct acl_nft_state *nft = acl->nft;
+            if (nft->error) {
+                printf("  nftables: not installed, %s\n", strerror(-nft->error));
+            } else {
+                printf("  nftables: chain acl%u, %u verdict maps of %u intervals, "
+                       "%u standalone rules, %u redundant rules%s\n", acl->acl_number,
+                       nft->info.maps, nft->info.elements, nft->info.standalone,
+                       nft->info.redundant, nft->stale ? ", stale" : "");
             }
-            printf("\n");
+        }
+        for (int i = 0; i < acl->rule_count; i++) {
+            const struct acl_rule *rule = &acl->rules[i];
+            char text[256];
+            format_acl_rule(rule, acl->type, text, sizeof(text));
+            printf("    Rule %u: %s\n", rule->rule_id, text);
         }
     } else {
         printf("ACL Configuration:\n");
-        printf("  Total ACLs: %d\n", acl_count);
-        for (int i = 0; i < acl_count; i++) {
+        printf("  Total ACLs: %u\n", slab_count(&acl_slab));
+        for (uint32_t num = ACL_NUMBER_MIN; num <= ACL_NUMBER_MAX; num++) {
+            const struct acl_config *acl = acl_find(num);
+            if (!acl) {
+                continue;
+            }
             printf("    ACL %u (%s) - %d rules\n",
-                   acls[i].acl_number,
-                   acls[i].type == ACL_TYPE_BASIC ? "Basic" : "Advanced",
-                   acls[i].rule_count);
+                   acl->acl_number,
+                   acl->type == ACL_TYPE_BASIC ? "Basic" : "Advanced",
+                   acl->rule_count);
         }
     }
     return 0;
@@ -197,9 +985,14 @@ struct cmd_element acl_cmds[] = {
                              "Add ACL rule", CMD_CAT_IP_SERVICE),
     HUAWEI_CMD_WITH_CATEGORY("display acl", cmd_display_acl, "show access-list",
                              "Display ACL configuration", CMD_CAT_IP_SERVICE),
+    HUAWEI_CMD_WITH_CATEGORY("traffic-filter", cmd_traffic_filter, NULL,
+                             "Apply ACL to interface in the kernel", CMD_CAT_IP_SERVICE),
+    HUAWEI_CMD_WITH_CATEGORY("undo traffic-filter", cmd_undo_traffic_filter, NULL,
+                             "Remove ACL from interface", CMD_CAT_IP_SERVICE),
     { .name = NULL }
 };
 
 void register_acl_cmds(void) {
     printf("Registering ACL commands...\n");
+    huawei_cli_register_table(acl_cmds, "acl");
 }
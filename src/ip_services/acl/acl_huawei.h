@@ -0,0 +1,90 @@
+/*
+ * ACL Support for Huawei VRP Style
+ * Copyright (C) 2026 WhiteBox NE Team
+ *
+ * Rules are parsed at configuration time into a packed binary form:
+ * address and mask pairs, protocol number and port ranges, for IPv4 and
+ * IPv6. Each ACL keeps its rules inline in one array sorted by rule ID,
+ * which is also the matching order. Packets are matched against a copy of
+ * the rules and its lookup index, rebuilt on the configuration side after
+ * an edit or a load and swapped in for the datapath.
+ *
+ * ACLs bound to an interface with traffic-filter are also compiled into
+ * nftables by acl_nft.c and enforced by the kernel.
+ */
+
+#ifndef _ACL_HUAWEI_H
+#define _ACL_HUAWEI_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "../../frr_core/lib/if_registry.h"
+
+#define ACL_NUMBER_MIN          2000
+#define ACL_NUMBER_MAX          3999
+#define ACL_RULE_STEP           5       /* Spacing of automatic rule IDs */
+
+typedef enum {
+    ACL_TYPE_BASIC = 0,    /* 2000-2999 */
+    ACL_TYPE_ADVANCED = 1  /* 3000-3999 */
+} acl_type_t;
+
+/* Rule flags */
+#define ACL_RULE_PERMIT         0x01
+#define ACL_RULE_IPV6           0x02    /* Matches IPv6 packets only, else IPv4 only */
+#define ACL_RULE_ANY_PROTOCOL   0x04    /* ip, ipv6 or no protocol given */
+
+/*
+ * Packed rule, 48 bytes. IPv4 addresses are in host order with a mask
+ * taken from the wildcard, so discontiguous wildcards are kept; IPv6
+ * addresses are in network order with a prefix length. Addresses are
+ * stored masked; a zero mask or prefix length matches any address.
+ * Port ranges are inclusive, 0-65535 when not given.
+ */
+struct acl_rule {
+    uint32_t rule_id;
+    uint8_t flags;
+    uint8_t protocol;           /* Unused with ACL_RULE_ANY_PROTOCOL */
+    uint8_t src_plen;           /* IPv6 only */
+    uint8_t dst_plen;
+    uint16_t src_port[2];       /* Low, high */
+    uint16_t dst_port[2];
+    union {
+        struct {
+            uint32_t src;
+            uint32_t src_mask;
+            uint32_t dst;
+            uint32_t dst_mask;
+        } v4;
+        struct {
+            uint8_t src[16];
+            uint8_t dst[16];
+        } v6;
+    };
+};
+
+_Static_assert(sizeof(struct acl_rule) == 48, "struct acl_rule must stay 48 bytes");
+
+struct acl_key;
+struct acl_published;
+struct acl_nft_state;
+
+struct acl_config {
+    uint32_t acl_number;
+    acl_type_t type;
+    char description[128];
+    struct acl_rule *rules;     /* Sorted by rule_id */
+    int rule_count;
+    int rule_capacity;
+    struct acl_published *published; /* Matched by the datapath, qsbr retired */
+    bool dirty;                 /* Rules changed since published */
+    struct acl_nft_state *nft;  /* Kernel chain, NULL until first bound */
+};
+
+const struct acl_rule *acl_match(uint32_t acl_number, const struct acl_key *key);
+void acl_match_burst(uint32_t acl_number, const struct acl_key *keys, uint32_t count,
+                     const struct acl_rule **rules);
+uint32_t acl_filter_find(ifid_t ifid, bool outbound);
+void register_acl_cmds(void);
+
+#endif /* _ACL_HUAWEI_H */
@@ -0,0 +1,1209 @@
+/*
+ * ACL Lookup Engine
+ * Copyright (C) 2026 WhiteBox NE Team
+ *
+ * This module provides first-match ACL classification including:
+ * - Rules widened into masked key words, one form for IPv4 and IPv6
+ * - Tuple space search with a priority cutoff, one open-addressed hash
+ *   table per mask group
+ * - A HyperSplit-style decision tree over IPv4 prefix and port ranges
+ * - Selection between linear scan, tuples and tree by the work each
+ *   does on keys sampled from the rules
+ * - Bursts of IPv4 keys through the pkt_match vector kernel for ACLs
+ *   with few IPv4 rules
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "acl_lookup.h"
+
+/*
+ * Key words: source and destination word 0, ports, protocol, then the
+ * remaining IPv6 address words. IPv4 uses the first four.
+ */
+#define ACL_KEY_WORDS           10
+#define ACL_KEY_WORDS_V4        4
+#define ACL_WORD_PORTS          2
+#define ACL_WORD_PROTOCOL       3
+
+#define ACL_TUPLE_STEP_V4       8       /* Prefix granularity of tuple masks */
+#define ACL_TUPLE_STEP_V6       16
+#define ACL_TUPLE_CHAIN_MAX     8       /* Rules per entry before exact masks are kept */
+
+#define ACL_TREE_DIMS           5       /* Source, destination, ports, protocol */
+#define ACL_TREE_LEAF           0xff
+#define ACL_TREE_BINTH          8       /* Rules per leaf */
+#define ACL_TREE_MAX_DEPTH      64
+#define ACL_TREE_PARTS          4       /* Trees by short or long source and destination */
+#define ACL_TREE_SHORT          16      /* Prefixes shorter than this are short */
+#define ACL_TREE_MAX_NODES      (1u << 22)
+#define ACL_TREE_MAX_REPLICATION 8      /* Leaf entries per rule before giving up, */
+#define ACL_TREE_MIN_POOL       (1u << 20)      /* but at least this many */
+#define ACL_TREE_AUTO_MAX       32768   /* Rules above which building takes seconds */
+
+#define ACL_COST_SAMPLES        256     /* Keys costed per engine when choosing */
+#define ACL_COST_PROBE          24      /* Tuple hash probe, in rule evaluations */
+#define ACL_COST_NODE           8       /* Tree node */
+#define ACL_COST_BOX            4       /* Leaf rule */
+
+/* Rule widened to key words; value is masked */
+struct acl_wide {
+    uint32_t value[ACL_KEY_WORDS];
+    uint32_t mask[ACL_KEY_WORDS];
+    uint16_t src_port[2];
+    uint16_t dst_port[2];
+};
+
+/* Mask group of the tuple space */
+struct acl_tuple {
+    uint32_t mask[ACL_KEY_WORDS];
+    uint32_t best;              /* Lowest rule position in the group */
+    uint32_t slots;             /* Power of two */
+    uint32_t *table;            /* Slots of key words, chain start, chain length */
+};
+
+/* IPv4 rule as a box of inclusive ranges */
+struct acl_box {
+    uint32_t lo[ACL_TREE_DIMS];
+    uint32_t hi[ACL_TREE_DIMS];
+};
+
+struct acl_tree_node {
+    uint32_t split;             /* Left child holds values <= split */
+    uint32_t child;             /* Left child, right is child + 1; leaf: pool offset */
+    uint32_t count;             /* Leaf rules */
+    uint32_t dim;               /* ACL_TREE_LEAF for leaves */
+};
+
+/* Rules of one address family and their index */
+struct acl_family {
+    acl_engine_t engine;
+    uint32_t words;             /* Key words in use */
+    uint32_t count;
+    struct acl_wide *rules;     /* In rule ID order */
+    uint32_t *position;         /* Index of each rule in the ACL */
+
+    struct acl_tuple *tuples;   /* By best rule */
+    uint32_t tuple_count;
+    uint32_t *chains;           /* Rule numbers per tuple entry, ascending */
+
+    struct acl_box *boxes;
+    uint32_t roots[ACL_TREE_PARTS];
+    uint32_t tree_count;
+    struct acl_tree_node *nodes;        /* Of all trees */
+    uint32_t node_count;
+    uint32_t *pool;             /* Leaf rule numbers, ascending per leaf */
+    uint32_t pool_count;
+    uint32_t depth;
+};
+
+struct acl_lookup {
+    struct acl_family family[2];        /* IPv4, IPv6 */
+    struct pkt_match_table *burst;      /* IPv4 rules of small ACLs, or NULL */
+    size_t memory;
+};
+
+/* Host-order word of a network-order IPv6 address */
+static uint32_t addr_word(const uint8_t *addr, int word)
+{
+    const uint8_t *b = addr + word * 4;
+    return ((uint32_t)b[0] << 24) | ((uint32_t)b[1] << 16) | ((uint32_t)b[2] << 8) | b[3];
+}
+
+static uint32_t plen_mask(uint8_t plen, int word)
+{
+    int bits = (int)plen - word * 32;
+    return bits >= 32 ? ~0u : bits <= 0 ? 0 : ~0u << (32 - bits);
+}
+
+/* Put address word w of source or destination at its key word */
+static int addr_slot(bool source, int word)
+{
+    if (word == 0) {
+        return source ? 0 : 1;
+    }
+    return (source ? 3 : 6) + word;
+}
+
+static void key_words(const struct acl_key *key, uint32_t w[ACL_KEY_WORDS])
+{
+    for (int i = 0; i < 4; i++) {
+        w[addr_slot(true, i)] = key->src[i];
+        w[addr_slot(false, i)] = key->dst[i];
+    }
+    w[ACL_WORD_PORTS] = ((uint32_t)key->src_port << 16) | key->dst_port;
+    w[ACL_WORD_PROTOCOL] = key->protocol;
+}
+
+/* Widen a rule; ports are part of the mask only when matched exactly */
+static void rule_widen(const struct acl_rule *rule, struct acl_wide *wide)
+{
+    memset(wide, 0, sizeof(*wide));
+    if (rule->flags & ACL_RULE_IPV6) {
+        for (int i = 0; i < 4; i++) {
+            wide->mask[addr_slot(true, i)] = plen_mask(rule->src_plen, i);
+            wide->value[addr_slot(true, i)] = addr_word(rule->v6.src, i);
+            wide->mask[addr_slot(false, i)] = plen_mask(rule->dst_plen, i);
+            wide->value[addr_slot(false, i)] = addr_word(rule->v6.dst, i);
+        }
+    } else {
+        wide->mask[0] = rule->v4.src_mask;
+        wide->value[0] = rule->v4.src;
+        wide->mask[1] = rule->v4.dst_mask;
+        wide->value[1] = rule->v4.dst;
+    }
+
+    uint32_t ports = ((uint32_t)rule->src_port[0] << 16) | rule->dst_port[0];
+    if (rule->src_port[0] == rule->src_port[1]) {
+        wide->mask[ACL_WORD_PORTS] |= 0xffff0000u;
+    }
+    if (rule->dst_port[0] == rule->dst_port[1]) {
+        wide->mask[ACL_WORD_PORTS] |= 0x0000ffffu;
+    }
+    wide->value[ACL_WORD_PORTS] = ports;
+    if (!(rule->flags & ACL_RULE_ANY_PROTOCOL)) {
+        wide->mask[ACL_WORD_PROTOCOL] = 0xff;
+        wide->value[ACL_WORD_PROTOCOL] = rule->protocol;
+    }
+    for (int i = 0; i < ACL_KEY_WORDS; i++) {
+        wide->value[i] &= wide->mask[i];
+    }
+    memcpy(wide->src_port, rule->src_port, sizeof(wide->src_port));
+    memcpy(wide->dst_port, rule->dst_port, sizeof(wide->dst_port));
+}
+
+static inline bool wide_ports(const struct acl_wide *wide, const uint32_t *w)
+{
+    uint16_t sport = (uint16_t)(w[ACL_WORD_PORTS] >> 16), dport = (uint16_t)w[ACL_WORD_PORTS];
+    return sport >= wide->src_port[0] && sport <= wide->src_port[1] &&
+           dport >= wide->dst_port[0] && dport <= wide->dst_port[1];
+}
+
+static inline bool wide_match(const struct acl_wide *wide, const uint32_t *w, uint32_t words)
+{
+    for (uint32_t i = 0; i < words; i++) {
+        if ((w[i] & wide->mask[i]) != wide->value[i]) {
+            return false;
+        }
+    }
+    return wide_ports(wide, w);
+}
+
+static bool is_prefix(uint32_t mask)
+{
+    return (~mask & (~mask + 1)) == 0;
+}
+
+/* Reference evaluation of one rule */
+bool acl_rule_match(const struct acl_rule *rule, const struct acl_key *key)
+{
+    struct acl_wide wide;
+    uint32_t w[ACL_KEY_WORDS];
+
+    if (((rule->flags & ACL_RULE_IPV6) != 0) == key->v6) {
+        rule_widen(rule, &wide);
+        key_words(key, w);
+        return wide_match(&wide, w, key->v6 ? ACL_KEY_WORDS : ACL_KEY_WORDS_V4);
+    }
+    return false;
+}
+
+static inline uint32_t hash_words(const uint32_t *w, uint32_t words)
+{
+    uint64_t h = 0x9e3779b97f4a7c15ull;
+
+    for (uint32_t i = 0; i < words; i++) {
+        h = (h ^ w[i]) * 0xff51afd7ed558ccdull;
+    }
+    /* Products only carry entropy upwards; fold it into the slot bits */
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    return (uint32_t)(h ^ (h >> 29));
+}
+
+/* Tuple space search */
+
+/*
+ * Hash key of a rule: its masks with prefixes shortened to a multiple of
+ * step bits, so prefix lengths that differ a little share one group
+ * (tuple merging). Entries then hold rules that only agree on the
+ * shortened key and every rule on a chain is checked in full. Rules of
+ * chains that grow too long keep their exact masks instead.
+ */
+struct acl_tuple_key {
+    uint32_t mask[ACL_KEY_WORDS];
+    uint32_t value[ACL_KEY_WORDS];
+};
+
+static const struct acl_tuple_key *sort_keys;
+static uint32_t sort_words;
+
+static void tuple_key(const struct acl_wide *wide, uint32_t words, uint32_t step,
+                      struct acl_tuple_key *key)
+{
+    memcpy(key->mask, wide->mask, sizeof(key->mask));
+    for (uint32_t i = 0; i < words; i++) {
+        if (i != ACL_WORD_PORTS && i != ACL_WORD_PROTOCOL && is_prefix(key->mask[i])) {
+            uint32_t len = (uint32_t)__builtin_popcount(key->mask[i]) / step * step;
+            key->mask[i] = len ? ~0u << (32 - len) : 0;
+        }
+        key->value[i] = wide->value[i] & key->mask[i];
+    }
+}
+
+static int cmp_tuple_key(const void *a, const void *b)
+{
+    uint32_t ra = *(const uint32_t *)a, rb = *(const uint32_t *)b;
+    int c = memcmp(sort_keys[ra].mask, sort_keys[rb].mask, sort_words * sizeof(uint32_t));
+    if (c == 0) {
+        c = memcmp(sort_keys[ra].value, sort_keys[rb].value, sort_words * sizeof(uint32_t));
+    }
+    return c ? c : (ra > rb) - (ra < rb);
+}
+
+static bool same_key(const struct acl_tuple_key *a, const struct acl_tuple_key *b, uint32_t words)
+{
+    return memcmp(a->mask, b->mask, words * sizeof(uint32_t)) == 0 &&
+           memcmp(a->value, b->value, words * sizeof(uint32_t)) == 0;
+}
+
+static int cmp_tuple_best(const void *a, const void *b)
+{
+    const struct acl_tuple *ta = a, *tb = b;
+    return (ta->best > tb->best) - (ta->best < tb->best);
+}
+
+/*
+ * Rules sorted by tuple mask, then key value, then position. Groups are
+ * runs of equal masks. Returns the order; keys are returned in *keys.
+ */
+static uint32_t *tuple_order(const struct acl_family *fam, struct acl_tuple_key **keys,
+                             uint32_t *groups)
+{
+    uint32_t *order = malloc(fam->count * sizeof(*order));
+
+    *keys = malloc(fam->count * sizeof(**keys));
+    if (!order || !*keys) {
+        free(order);
+        free(*keys);
+        *keys = NULL;
+        return NULL;
+    }
+    uint32_t step = fam->words == ACL_KEY_WORDS_V4 ? ACL_TUPLE_STEP_V4 : ACL_TUPLE_STEP_V6;
+    for (uint32_t i = 0; i < fam->count; i++) {
+        order[i] = i;
+        tuple_key(&fam->rules[i], fam->words, step, &(*keys)[i]);
+    }
+    sort_keys = *keys;
+    sort_words = fam->words;
+    qsort(order, fam->count, sizeof(*order), cmp_tuple_key);
+
+    bool split = false;
+    for (uint32_t i = 0, run; i < fam->count; i = run) {
+        for (run = i + 1; run < fam->count && same_key(&(*keys)[order[i]], &(*keys)[order[run]],
+                                                        fam->words); run++) {
+        }
+        for (uint32_t r = i; run - i > ACL_TUPLE_CHAIN_MAX && r < run; r++) {
+            tuple_key(&fam->rules[order[r]], fam->words, 1, &(*keys)[order[r]]);
+            split = true;
+        }
+    }
+    if (split) {
+        qsort(order, fam->count, sizeof(*order), cmp_tuple_key);
+    }
+
+    *groups = 0;
+    for (uint32_t i = 0; i < fam->count; i++) {
+        if (i == 0 || memcmp((*keys)[order[i]].mask, (*keys)[order[i - 1]].mask,
+                             fam->words * sizeof(uint32_t)) != 0) {
+            (*groups)++;
+        }
+    }
+    return order;
+}
+
+static int tuple_build(struct acl_family *fam)
+{
+    struct acl_tuple_key *keys;
+    uint32_t groups = 0, stride = fam->words + 2;
+    uint32_t *order = tuple_order(fam, &keys, &groups);
+
+    if (!order) {
+        return -1;
+    }
+    fam->tuples = calloc(groups, sizeof(*fam->tuples));
+    fam->chains = malloc(fam->count * sizeof(*fam->chains));
+    if (!fam->tuples || !fam->chains) {
+        free(order);
+        free(keys);
+        return -1;
+    }
+
+    for (uint32_t start = 0, t = 0; start < fam->count; t++) {
+        const struct acl_tuple_key *first = &keys[order[start]];
+        uint32_t end = start, distinct = 0;
+        while (end < fam->count &&
+               memcmp(keys[order[end]].mask, first->mask, fam->words * sizeof(uint32_t)) == 0) {
+            if (end == start || memcmp(keys[order[end]].value, keys[order[end - 1]].value,
+                                       fam->words * sizeof(uint32_t)) != 0) {
+                distinct++;
+            }
+            end++;
+        }
+
+        struct acl_tuple *tuple = &fam->tuples[t];
+        memcpy(tuple->mask, first->mask, sizeof(tuple->mask));
+        tuple->best = UINT32_MAX;
+        tuple->slots = 4;
+        while (tuple->slots < distinct * 2) {
+            tuple->slots <<= 1;
+        }
+        tuple->table = calloc((size_t)tuple->slots * stride, sizeof(uint32_t));
+        if (!tuple->table) {
+            fam->tuple_count = t + 1;
+            free(order);
+            free(keys);
+            return -1;
+        }
+
+        /* One entry per distinct value; its rules form a chain in position order */
+        for (uint32_t i = start; i < end;) {
+            const uint32_t *value = keys[order[i]].value;
+            uint32_t run = i;
+            while (run < end && memcmp(keys[order[run]].value, value,
+                                       fam->words * sizeof(uint32_t)) == 0) {
+                fam->chains[run] = order[run];
+                run++;
+            }
+
+            uint32_t slot = hash_words(value, fam->words) & (tuple->slots - 1);
+            while (tuple->table[slot * stride + fam->words + 1] != 0) {
+                slot = (slot + 1) & (tuple->slots - 1);
+            }
+            uint32_t *entry = &tuple->table[slot * stride];
+            memcpy(entry, value, fam->words * sizeof(uint32_t));
+            entry[fam->words] = i;
+            entry[fam->words + 1] = run - i;
+            if (order[i] < tuple->best) {
+                tuple->best = order[i];
+            }
+            i = run;
+        }
+        start = end;
+        fam->tuple_count = t + 1;
+    }
+
+    free(order);
+    free(keys);
+    qsort(fam->tuples, fam->tuple_count, sizeof(*fam->tuples), cmp_tuple_best);
+    return 0;
+}
+
+/*
+ * Probe the groups in order of their best rule, stopping at the first
+ * group that cannot hold a better match. words is a constant per call
+ * site so the word loops unroll.
+ */
+static inline __attribute__((always_inline))
+uint32_t tuple_search(const struct acl_family *fam, const uint32_t *w, const uint32_t words)
+{
+    const uint32_t stride = words + 2;
+    uint32_t best = UINT32_MAX;
+    uint32_t masked[ACL_KEY_WORDS];
+
+    for (uint32_t t = 0; t < fam->tuple_count; t++) {
+        const struct acl_tuple *tuple = &fam->tuples[t];
+        if (tuple->best >= best) {
+            break;
+        }
+        for (uint32_t i = 0; i < words; i++) {
+            masked[i] = w[i] & tuple->mask[i];
+        }
+
+        uint32_t slot = hash_words(masked, words) & (tuple->slots - 1);
+        for (;;) {
+            const uint32_t *entry = &tuple->table[slot * stride];
+            uint32_t len = entry[words + 1];
+            if (len == 0) {
+                break;
+            }
+            uint32_t diff = 0;
+            for (uint32_t i = 0; i < words; i++) {
+                diff |= entry[i] ^ masked[i];
+            }
+            if (diff == 0) {
+                const uint32_t *chain = &fam->chains[entry[words]];
+                for (uint32_t c = 0; c < len && chain[c] < best; c++) {
+                    if (wide_match(&fam->rules[chain[c]], w, words)) {
+                        best = chain[c];
+                        break;
+                    }
+                }
+                break;
+            }
+            slot = (slot + 1) & (tuple->slots - 1);
+        }
+    }
+    return best;
+}
+
+static uint32_t tuple_find(const struct acl_family *fam, const uint32_t *w)
+{
+    if (fam->words == ACL_KEY_WORDS_V4) {
+        return tuple_search(fam, w, ACL_KEY_WORDS_V4);
+    }
+    return tuple_search(fam, w, ACL_KEY_WORDS);
+}
+
+/* Decision tree */
+
+struct tree_build {
+    struct acl_family *fam;
+    uint32_t node_cap;
+    uint32_t pool_cap;
+    uint32_t pool_limit;
+    bool failed;
+};
+
+static void rule_box(const struct acl_wide *wide, struct acl_box *box)
+{
+    box->lo[0] = wide->value[0];
+    box->hi[0] = wide->value[0] | ~wide->mask[0];
+    box->lo[1] = wide->value[1];
+    box->hi[1] = wide->value[1] | ~wide->mask[1];
+    box->lo[2] = wide->src_port[0];
+    box->hi[2] = wide->src_port[1];
+    box->lo[3] = wide->dst_port[0];
+    box->hi[3] = wide->dst_port[1];
+    box->lo[4] = wide->value[ACL_WORD_PROTOCOL];
+    box->hi[4] = wide->mask[ACL_WORD_PROTOCOL] ? wide->value[ACL_WORD_PROTOCOL] : 0xff;
+}
+
+static uint32_t tree_part(const struct acl_wide *wide)
+{
+    return ((uint32_t)__builtin_popcount(wide->mask[0]) < ACL_TREE_SHORT) +
+           ((uint32_t)__builtin_popcount(wide->mask[1]) < ACL_TREE_SHORT) * 2;
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+/* Number of sorted values <= v */
+static uint32_t count_le(const uint32_t *sorted, uint32_t n, uint32_t v)
+{
+    uint32_t lo = 0, hi = n;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (sorted[mid] <= v) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/*
+ * Best cut of the region on one field: the rule boundary that minimizes
+ * the larger side, then the rules copied to both. Returns false when no
+ * cut leaves fewer rules on both sides.
+ */
+static bool tree_cut(const struct acl_box *boxes, const uint32_t *rules, uint32_t count,
+                     uint32_t dim, uint32_t lo, uint32_t hi, uint32_t *scratch,
+                     uint32_t *split, uint64_t *cost)
+{
+    uint32_t *los = scratch, *his = scratch + count, *cands = scratch + 2 * count;
+    uint32_t ncand = 0;
+
+    for (uint32_t i = 0; i < count; i++) {
+        const struct acl_box *box = &boxes[rules[i]];
+        uint32_t l = box->lo[dim] > lo ? box->lo[dim] : lo;
+        uint32_t h = box->hi[dim] < hi ? box->hi[dim] : hi;
+        los[i] = l;
+        his[i] = h;
+        if (l > lo) {
+            cands[ncand++] = l - 1;
+        }
+        if (h < hi) {
+            cands[ncand++] = h;
+        }
+    }
+    if (ncand == 0) {
+        return false;
+    }
+    qsort(los, count, sizeof(*los), cmp_u32);
+    qsort(his, count, sizeof(*his), cmp_u32);
+    qsort(cands, ncand, sizeof(*cands), cmp_u32);
+
+    bool found = false;
+    for (uint32_t c = 0; c < ncand; c++) {
+        if (c > 0 && cands[c] == cands[c - 1]) {
+            continue;
+        }
+        uint32_t left = count_le(los, count, cands[c]);
+        uint32_t right = count - count_le(his, count, cands[c]);
+        uint32_t larger = left > right ? left : right;
+        uint64_t score = (uint64_t)larger * 2 * count + left + right;
+        if (larger < count && (!found || score < *cost)) {
+            *split = cands[c];
+            *cost = score;
+            found = true;
+        }
+    }
+    return found;
+}
+
+static uint32_t tree_alloc(struct tree_build *b, uint32_t n)
+{
+    struct acl_family *fam = b->fam;
+
+    if (fam->node_count + n > ACL_TREE_MAX_NODES) {
+        b->failed = true;
+        return 0;
+    }
+    if (fam->node_count + n > b->node_cap) {
+        uint32_t cap = b->node_cap ? b->node_cap * 2 : 256;
+        struct acl_tree_node *nodes = realloc(fam->nodes, cap * sizeof(*nodes));
+        if (!nodes) {
+            b->failed = true;
+            return 0;
+        }
+        fam->nodes = nodes;
+        b->node_cap = cap;
+    }
+    uint32_t idx = fam->node_count;
+    fam->node_count += n;
+    return idx;
+}
+
+static void tree_leaf(struct tree_build *b, uint32_t node, const uint32_t *rules, uint32_t count)
+{
+    struct acl_family *fam = b->fam;
+
+    if (fam->pool_count + count > b->pool_limit) {
+        b->failed = true;
+        return;
+    }
+    if (fam->pool_count + count > b->pool_cap) {
+        uint32_t cap = b->pool_cap ? b->pool_cap : 1024;
+        while (cap < fam->pool_count + count) {
+            cap *= 2;
+        }
+        uint32_t *pool = realloc(fam->pool, cap * sizeof(*pool));
+        if (!pool) {
+            b->failed = true;
+            return;
+        }
+        fam->pool = pool;
+        b->pool_cap = cap;
+    }
+    memcpy(&fam->pool[fam->pool_count], rules, count * sizeof(*rules));
+    fam->nodes[node] = (struct acl_tree_node){ .child = fam->pool_count, .count = count,
+                                               .dim = ACL_TREE_LEAF };
+    fam->pool_count += count;
+}
+
+/* Build the subtree of a region from its rules, in position order */
+static void tree_node(struct tree_build *b, uint32_t node, const uint32_t lo[ACL_TREE_DIMS],
+                      const uint32_t hi[ACL_TREE_DIMS], const uint32_t *rules, uint32_t count,
+                      uint32_t depth)
+{
+    const struct acl_box *boxes = b->fam->boxes;
+
+    if (depth > b->fam->depth) {
+        b->fam->depth = depth;
+    }
+
+    /* Rules after one that covers the whole region can never match in it */
+    for (uint32_t i = 0; i < count; i++) {
+        const struct acl_box *box = &boxes[rules[i]];
+        bool covers = true;
+        for (int d = 0; d < ACL_TREE_DIMS && covers; d++) {
+            covers = box->lo[d] <= lo[d] && box->hi[d] >= hi[d];
+        }
+        if (covers) {
+            count = i + 1;
+            break;
+        }
+    }
+    if (count <= ACL_TREE_BINTH || depth >= ACL_TREE_MAX_DEPTH) {
+        tree_leaf(b, node, rules, count);
+        return;
+    }
+
+    uint32_t *scratch = malloc((size_t)count * 4 * sizeof(*scratch));
+    if (!scratch) {
+        b->failed = true;
+        return;
+    }
+    uint32_t best_dim = ACL_TREE_LEAF, best_split = 0;
+    uint64_t best_cost = UINT64_MAX;
+    for (uint32_t d = 0; d < ACL_TREE_DIMS; d++) {
+        uint32_t split = 0;
+        uint64_t cost = 0;
+        if (tree_cut(boxes, rules, count, d, lo[d], hi[d], scratch, &split, &cost) &&
+            cost < best_cost) {
+            best_dim = d;
+            best_split = split;
+            best_cost = cost;
+        }
+    }
+    if (best_dim == ACL_TREE_LEAF) {
+        free(scratch);
+        tree_leaf(b, node, rules, count);
+        return;
+    }
+
+    /* Rules of each side keep their order */
+    uint32_t *left = scratch, *right = scratch + count;
+    uint32_t nleft = 0, nright = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        const struct acl_box *box = &boxes[rules[i]];
+        if (box->lo[best_dim] <= best_split) {
+            left[nleft++] = rules[i];
+        }
+        if (box->hi[best_dim] > best_split) {
+            right[nright++] = rules[i];
+        }
+    }
+
+    uint32_t child = tree_alloc(b, 2);
+    if (b->failed) {
+        free(scratch);
+        return;
+    }
+    b->fam->nodes[node] = (struct acl_tree_node){ .split = best_split, .child = child,
+                                                  .dim = best_dim };
+
+    uint32_t sub_lo[ACL_TREE_DIMS], sub_hi[ACL_TREE_DIMS];
+    memcpy(sub_lo, lo, sizeof(sub_lo));
+    memcpy(sub_hi, hi, sizeof(sub_hi));
+    sub_hi[best_dim] = best_split;
+    tree_node(b, child, sub_lo, sub_hi, left, nleft, depth + 1);
+    if (!b->failed) {
+        sub_hi[best_dim] = hi[best_dim];
+        sub_lo[best_dim] = best_split + 1;
+        tree_node(b, child + 1, sub_lo, sub_hi, right, nright, depth + 1);
+    }
+    free(scratch);
+}
+
+/*
+ * Rules short in an address field overlap most others there and would
+ * be copied into most leaves; they get their own trees, one per
+ * combination of short source and short destination.
+ */
+static int tree_build(struct acl_family *fam)
+{
+    static const uint32_t lo[ACL_TREE_DIMS] = { 0, 0, 0, 0, 0 };
+    static const uint32_t hi[ACL_TREE_DIMS] = { UINT32_MAX, UINT32_MAX, 65535, 65535, 255 };
+    struct tree_build b = { .fam = fam };
+    uint32_t *rules = malloc(fam->count * sizeof(*rules));
+    uint32_t part_count[ACL_TREE_PARTS] = { 0 }, part_start[ACL_TREE_PARTS];
+
+    fam->boxes = malloc(fam->count * sizeof(*fam->boxes));
+    if (!rules || !fam->boxes) {
+        free(rules);
+        return -1;
+    }
+    for (uint32_t i = 0; i < fam->count; i++) {
+        rule_box(&fam->rules[i], &fam->boxes[i]);
+        part_count[tree_part(&fam->rules[i])]++;
+    }
+    for (uint32_t p = 0, n = 0; p < ACL_TREE_PARTS; n += part_count[p++]) {
+        part_start[p] = n;
+    }
+    for (uint32_t i = 0; i < fam->count; i++) {
+        rules[part_start[tree_part(&fam->rules[i])]++] = i;
+    }
+
+    b.pool_limit = fam->count * ACL_TREE_MAX_REPLICATION;
+    if (b.pool_limit < ACL_TREE_MIN_POOL) {
+        b.pool_limit = ACL_TREE_MIN_POOL;
+    }
+    for (uint32_t p = 0, n = 0; p < ACL_TREE_PARTS && !b.failed; n += part_count[p++]) {
+        if (part_count[p] == 0) {
+            continue;
+        }
+        uint32_t root = tree_alloc(&b, 1);
+        if (!b.failed) {
+            fam->roots[fam->tree_count++] = root;
+            tree_node(&b, root, lo, hi, &rules[n], part_count[p], 1);
+        }
+    }
+    free(rules);
+    return b.failed ? -1 : 0;
+}
+
+/* First match over all trees; leaves stop at rules past the best so far */
+static uint32_t tree_find(const struct acl_family *fam, const uint32_t *w)
+{
+    const uint32_t f[ACL_TREE_DIMS] = { w[0], w[1], w[ACL_WORD_PORTS] >> 16,
+                                        w[ACL_WORD_PORTS] & 0xffff, w[ACL_WORD_PROTOCOL] };
+    uint32_t best = UINT32_MAX;
+
+    for (uint32_t t = 0; t < fam->tree_count; t++) {
+        const struct acl_tree_node *node = &fam->nodes[fam->roots[t]];
+        while (node->dim != ACL_TREE_LEAF) {
+            node = &fam->nodes[node->child + (f[node->dim] > node->split)];
+        }
+        for (uint32_t i = 0; i < node->count; i++) {
+            uint32_t r = fam->pool[node->child + i];
+            const struct acl_box *box = &fam->boxes[r];
+            if (r >= best) {
+                break;
+            }
+            if (f[0] >= box->lo[0] && f[0] <= box->hi[0] && f[1] >= box->lo[1] &&
+                f[1] <= box->hi[1] && f[2] >= box->lo[2] && f[2] <= box->hi[2] &&
+                f[3] >= box->lo[3] && f[3] <= box->hi[3] && f[4] >= box->lo[4] &&
+                f[4] <= box->hi[4]) {
+                best = r;
+                break;
+            }
+        }
+    }
+    return best;
+}
+
+/* Engine selection and the public interface */
+
+static void tuple_clear(struct acl_family *fam)
+{
+    for (uint32_t t = 0; t < fam->tuple_count; t++) {
+        free(fam->tuples[t].table);
+    }
+    free(fam->tuples);
+    free(fam->chains);
+    fam->tuples = NULL;
+    fam->chains = NULL;
+    fam->tuple_count = 0;
+}
+
+static void tree_clear(struct acl_family *fam)
+{
+    free(fam->boxes);
+    free(fam->nodes);
+    free(fam->pool);
+    fam->boxes = NULL;
+    fam->nodes = NULL;
+    fam->pool = NULL;
+    fam->node_count = fam->pool_count = fam->depth = fam->tree_count = 0;
+}
+
+static void family_clear_index(struct acl_family *fam)
+{
+    tuple_clear(fam);
+    tree_clear(fam);
+}
+
+static uint32_t sample_next(uint32_t *state)
+{
+    uint32_t x = *state;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+static uint16_t sample_port(const uint16_t range[2], uint32_t *state)
+{
+    return (uint16_t)(range[0] + sample_next(state) % ((uint32_t)range[1] - range[0] + 1));
+}
+
+/*
+ * Key words of a sample packet inside rule r. The bits r leaves open
+ * come from rule q, so samples stay where the rules put traffic, then
+ * at random; ports are anywhere unless inside.
+ */
+static void sample_key(const struct acl_family *fam, uint32_t r, uint32_t q, bool inside,
+                       uint32_t *state, uint32_t w[ACL_KEY_WORDS])
+{
+    static const uint16_t any[2] = { 0, 65535 };
+    const struct acl_wide *wide = &fam->rules[r], *other = &fam->rules[q];
+
+    memset(w, 0, ACL_KEY_WORDS * sizeof(*w));
+    for (uint32_t i = 0; i < fam->words; i++) {
+        uint32_t open = ~wide->mask[i];
+        w[i] = wide->value[i] | (other->value[i] & open) |
+               (sample_next(state) & open & ~other->mask[i]);
+    }
+    w[ACL_WORD_PORTS] = (uint32_t)sample_port(inside ? wide->src_port : any, state) << 16 |
+                        sample_port(inside ? wide->dst_port : any, state);
+    w[ACL_WORD_PROTOCOL] &= 0xff;
+}
+
+/* Lookup work for the sample keys, in rule evaluations */
+struct acl_cost {
+    uint64_t linear;
+    uint64_t tuple;
+    uint64_t tree;
+};
+
+static uint32_t linear_cost(const struct acl_family *fam, const uint32_t *w, uint32_t *first)
+{
+    for (uint32_t i = 0; i < fam->count; i++) {
+        if (wide_match(&fam->rules[i], w, fam->words)) {
+            *first = i;
+            return i + 1;
+        }
+    }
+    *first = UINT32_MAX;
+    return fam->count;
+}
+
+/* Groups whose best rule is not past the first match are all probed */
+static uint32_t tuple_cost(const struct acl_family *fam, uint32_t first)
+{
+    uint32_t probes = 0;
+
+    while (probes < fam->tuple_count && fam->tuples[probes].best <= first) {
+        probes++;
+    }
+    return probes * ACL_COST_PROBE;
+}
+
+/* Same walk as tree_find, counting nodes and leaf rules */
+static uint32_t tree_cost(const struct acl_family *fam, const uint32_t *w, uint32_t first)
+{
+    const uint32_t f[ACL_TREE_DIMS] = { w[0], w[1], w[ACL_WORD_PORTS] >> 16,
+                                        w[ACL_WORD_PORTS] & 0xffff, w[ACL_WORD_PROTOCOL] };
+    uint32_t cost = 0, best = UINT32_MAX;
+
+    for (uint32_t t = 0; t < fam->tree_count; t++) {
+        const struct acl_tree_node *node = &fam->nodes[fam->roots[t]];
+        while (node->dim != ACL_TREE_LEAF) {
+            node = &fam->nodes[node->child + (f[node->dim] > node->split)];
+            cost += ACL_COST_NODE;
+        }
+        for (uint32_t i = 0; i < node->count && fam->pool[node->child + i] < best; i++) {
+            cost += ACL_COST_BOX;
+            if (fam->pool[node->child + i] == first) {
+                best = first;
+            }
+        }
+    }
+    return cost;
+}
+
+/*
+ * Trees need IPv4 prefix masks. They pay off over tuples when the rules
+ * fall into many mask groups, each a hash probe, or when many port
+ * ranges leave long chains behind one tuple entry.
+ */
+static acl_engine_t family_choose(const struct acl_family *fam, acl_engine_t engine,
+                                  bool *tree_wanted)
+{
+    bool tree_ok = fam->words == ACL_KEY_WORDS_V4;
+    uint32_t ranges = 0;
+
+    for (uint32_t i = 0; i < fam->count && tree_ok; i++) {
+        const struct acl_wide *wide = &fam->rules[i];
+        tree_ok = is_prefix(wide->mask[0]) && is_prefix(wide->mask[1]);
+        if ((wide->mask[ACL_WORD_PORTS] & 0xffff0000u) == 0 &&
+            (wide->src_port[0] != 0 || wide->src_port[1] != 65535)) {
+            ranges++;
+        } else if ((wide->mask[ACL_WORD_PORTS] & 0xffffu) == 0 &&
+                   (wide->dst_port[0] != 0 || wide->dst_port[1] != 65535)) {
+            ranges++;
+        }
+    }
+    *tree_wanted = tree_ok && fam->count <= ACL_TREE_AUTO_MAX && ranges * 4 > fam->count;
+
+    if (engine == ACL_ENGINE_TREE) {
+        return tree_ok ? ACL_ENGINE_TREE : ACL_ENGINE_TUPLE;
+    }
+    if (engine == ACL_ENGINE_AUTO && fam->count <= ACL_LINEAR_MAX) {
+        return ACL_ENGINE_LINEAR;
+    }
+    return engine;
+}
+
+/*
+ * Tuples only bound the lookup while the mask groups are few: each group
+ * before the match is one hash probe, and rule sets without prefix masks
+ * can fall into hundreds. Past ACL_TUPLE_MAX groups, and for port ranges,
+ * a tree is tried where the rules allow one. The candidates are then
+ * costed on sample keys drawn from the rules, half of them with ports
+ * outside the rule, against scanning the rules in order, and the
+ * cheapest kept.
+ */
+static int family_auto(struct acl_family *fam, bool tree_wanted)
+{
+    struct acl_cost cost = { 0, 0, 0 };
+    uint32_t state = 0x9e3779b9u;
+
+    if (tuple_build(fam) < 0) {
+        return -1;
+    }
+    tree_wanted = tree_wanted || (fam->words == ACL_KEY_WORDS_V4 &&
+                                  fam->count <= ACL_TREE_AUTO_MAX &&
+                                  fam->tuple_count > ACL_TUPLE_MAX);
+    if (tree_wanted && tree_build(fam) < 0) {
+        /* Too much replication */
+        tree_clear(fam);
+        tree_wanted = false;
+    }
+
+    for (uint32_t s = 0; s < ACL_COST_SAMPLES; s++) {
+        uint32_t w[ACL_KEY_WORDS], first;
+        uint32_t r = sample_next(&state) % fam->count, q = sample_next(&state) % fam->count;
+        sample_key(fam, r, q, s & 1, &state, w);
+        cost.linear += linear_cost(fam, w, &first);
+        cost.tuple += tuple_cost(fam, first);
+        if (tree_wanted) {
+            cost.tree += tree_cost(fam, w, first);
+        }
+    }
+
+    fam->engine = ACL_ENGINE_TUPLE;
+    if (tree_wanted && cost.tree < cost.tuple) {
+        fam->engine = ACL_ENGINE_TREE;
+    }
+    if (cost.linear <= (fam->engine == ACL_ENGINE_TREE ? cost.tree : cost.tuple)) {
+        fam->engine = ACL_ENGINE_LINEAR;
+    }
+    if (fam->engine != ACL_ENGINE_TUPLE) {
+        tuple_clear(fam);
+    }
+    if (fam->engine != ACL_ENGINE_TREE) {
+        tree_clear(fam);
+    }
+    return 0;
+}
+
+static int family_build(struct acl_family *fam, acl_engine_t engine)
+{
+    bool tree_wanted;
+
+    fam->engine = family_choose(fam, engine, &tree_wanted);
+    if (fam->engine == ACL_ENGINE_AUTO) {
+        return family_auto(fam, tree_wanted);
+    }
+    if (fam->engine == ACL_ENGINE_TREE && tree_build(fam) < 0) {
+        /* Too much replication; tuples always fit */
+        family_clear_index(fam);
+        fam->engine = ACL_ENGINE_TUPLE;
+    }
+    if (fam->engine == ACL_ENGINE_TUPLE && tuple_build(fam) < 0) {
+        return -1;
+    }
+    return 0;
+}
+
+static size_t family_memory(const struct acl_family *fam)
+{
+    size_t bytes = fam->count * (sizeof(*fam->rules) + sizeof(*fam->position));
+
+    if (fam->engine == ACL_ENGINE_TUPLE) {
+        bytes += fam->tuple_count * sizeof(*fam->tuples) + fam->count * sizeof(*fam->chains);
+        for (uint32_t t = 0; t < fam->tuple_count; t++) {
+            bytes += (size_t)fam->tuples[t].slots * (fam->words + 2) * sizeof(uint32_t);
+        }
+    } else if (fam->engine == ACL_ENGINE_TREE) {
+        bytes += fam->count * sizeof(*fam->boxes) + fam->node_count * sizeof(*fam->nodes) +
+                 fam->pool_count * sizeof(*fam->pool);
+    }
+    return bytes;
+}
+
+void acl_lookup_free(struct acl_lookup *lookup)
+{
+    if (!lookup) {
+        return;
+    }
+    for (int f = 0; f < 2; f++) {
+        family_clear_index(&lookup->family[f]);
+        free(lookup->family[f].rules);
+        free(lookup->family[f].position);
+    }
+    free(lookup->burst);
+    free(lookup);
+}
+
+/* Kernel table for bursts when the IPv4 rules are few enough */
+static int burst_build(struct acl_lookup *lookup, const struct acl_rule *rules)
+{
+    const struct acl_family *fam = &lookup->family[0];
+
+    if (fam->count == 0 || fam->count > PKT_MATCH_MAX_RULES ||
+        fam->position[fam->count - 1] > UINT16_MAX) {
+        return 0;
+    }
+    lookup->burst = aligned_alloc(64, sizeof(*lookup->burst));
+    if (!lookup->burst) {
+        return -1;
+    }
+    pkt_match_init(lookup->burst);
+    for (uint32_t i = 0; i < fam->count; i++) {
+        const struct acl_rule *rule = &rules[fam->position[i]];
+        struct pkt_match_rule m = {
+            .src = rule->v4.src,
+            .src_mask = rule->v4.src_mask,
+            .dst = rule->v4.dst,
+            .dst_mask = rule->v4.dst_mask,
+            .src_port = { rule->src_port[0], rule->src_port[1] },
+            .dst_port = { rule->dst_port[0], rule->dst_port[1] },
+            .protocol = rule->protocol,
+            .protocol_mask = rule->flags & ACL_RULE_ANY_PROTOCOL ? 0 : 0xff,
+            .result = (uint16_t)fam->position[i],
+        };
+        pkt_match_add(lookup->burst, &m);
+    }
+    lookup->memory += sizeof(*lookup->burst);
+    return 0;
+}
+
+/*
+ * Build the lookup structure for rules sorted by rule ID. engine forces
+ * an engine for both families, for comparison; ACL_ENGINE_AUTO picks one
+ * per family. Returns NULL when out of memory.
+ */
+struct acl_lookup *acl_lookup_build(const struct acl_rule *rules, uint32_t count,
+                                    acl_engine_t engine)
+{
+    struct acl_lookup *lookup = calloc(1, sizeof(*lookup));
+
+    if (!lookup) {
+        return NULL;
+    }
+    for (int f = 0; f < 2; f++) {
+        struct acl_family *fam = &lookup->family[f];
+        fam->words = f ? ACL_KEY_WORDS : ACL_KEY_WORDS_V4;
+        fam->rules = malloc((count ? count : 1) * sizeof(*fam->rules));
+        fam->position = malloc((count ? count : 1) * sizeof(*fam->position));
+        if (!fam->rules || !fam->position) {
+            acl_lookup_free(lookup);
+            return NULL;
+        }
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        struct acl_family *fam = &lookup->family[rules[i].flags & ACL_RULE_IPV6 ? 1 : 0];
+        rule_widen(&rules[i], &fam->rules[fam->count]);
+        fam->position[fam->count++] = i;
+    }
+
+    for (int f = 0; f < 2; f++) {
+        if (family_build(&lookup->family[f], engine) < 0) {
+            acl_lookup_free(lookup);
+            return NULL;
+        }
+        lookup->memory += family_memory(&lookup->family[f]);
+    }
+    if (burst_build(lookup, rules) < 0) {
+        acl_lookup_free(lookup);
+        return NULL;
+    }
+    return lookup;
+}
+
+/* Position of the first matching rule in the ACL, -1 when none matches */
+int acl_lookup_find(const struct acl_lookup *lookup, const struct acl_key *key)
+{
+    const struct acl_family *fam = &lookup->family[key->v6 ? 1 : 0];
+    uint32_t w[ACL_KEY_WORDS];
+    uint32_t r = UINT32_MAX;
+
+    key_words(key, w);
+    switch (fam->engine) {
+    case ACL_ENGINE_TUPLE:
+        r = tuple_find(fam, w);
+        break;
+    case ACL_ENGINE_TREE:
+        r = tree_find(fam, w);
+        break;
+    default:
+        for (uint32_t i = 0; i < fam->count; i++) {
+            if (wide_match(&fam->rules[i], w, fam->words)) {
+                r = i;
+                break;
+            }
+        }
+        break;
+    }
+    return r == UINT32_MAX ? -1 : (int)fam->position[r];
+}
+
+/*
+ * acl_lookup_find() for count keys. With few IPv4 rules the IPv4 keys
+ * go through the vector kernel PKT_MATCH_BURST at a time.
+ */
+void acl_lookup_find_burst(const struct acl_lookup *lookup, const struct acl_key *keys,
+                           uint32_t count, int *first)
+{
+    struct pkt_match_burst burst;
+    uint32_t lane_key[PKT_MATCH_BURST];
+    int lane_first[PKT_MATCH_BURST];
+
+    if (!lookup->burst) {
+        for (uint32_t i = 0; i < count; i++) {
+            first[i] = acl_lookup_find(lookup, &keys[i]);
+        }
+        return;
+    }
+
+    burst.count = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        const struct acl_key *key = &keys[i];
+        if (key->v6) {
+            first[i] = acl_lookup_find(lookup, key);
+            continue;
+        }
+        pkt_match_burst_set(&burst, burst.count, key->src[0], key->dst[0], key->src_port,
+                            key->dst_port, key->protocol);
+        lane_key[burst.count++] = i;
+        if (burst.count == PKT_MATCH_BURST) {
+            pkt_match_burst(lookup->burst, &burst, lane_first);
+            for (uint32_t n = 0; n < burst.count; n++) {
+                first[lane_key[n]] = lane_first[n];
+            }
+            burst.count = 0;
+        }
+    }
+    if (burst.count > 0) {
+        pkt_match_burst(lookup->burst, &burst, lane_first);
+        for (uint32_t n = 0; n < burst.count; n++) {
+            first[lane_key[n]] = lane_first[n];
+        }
+    }
+}
+
+void acl_lookup_info(const struct acl_lookup *lookup, bool v6, struct acl_lookup_info *info)
+{
+    const struct acl_family *fam = &lookup->family[v6 ? 1 : 0];
+
+    info->engine = fam->engine;
+    info->rules = fam->count;
+    info->tuples = fam->tuple_count;
+    info->trees = fam->tree_count;
+    info->nodes = fam->node_count;
+    info->leaf_rules = fam->pool_count;
+    info->depth = fam->depth;
+    info->batched = !v6 && lookup->burst;
+}
+
+size_t acl_lookup_memory(const struct acl_lookup *lookup)
+{
+    return lookup->memory;
+}
+
+const char *acl_engine_name(acl_engine_t engine)
+{
+    switch (engine) {
+    case ACL_ENGINE_LINEAR:
+        return "linear";
+    case ACL_ENGINE_TUPLE:
+        return "tuple space";
+    case ACL_ENGINE_TREE:
+        return "decision tree";
+    default:
+        return "auto";
+    }
+}
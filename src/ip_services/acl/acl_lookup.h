@@ -0,0 +1,87 @@
+/*
+ * ACL Lookup Engine
+ * Copyright (C) 2026 WhiteBox NE Team
+ *
+ * First-match packet classification over the sorted rules of an ACL.
+ * The result is always the first matching rule in rule ID order, the
+ * same as evaluating the rules one by one. IPv4 and IPv6 rules are
+ * compiled separately, each with the engine that suits its rules:
+ *
+ * - Linear scan, for a handful of rules
+ * - Tuple space search: rules are grouped by their masks, one hash
+ *   table per group; groups are probed in order of their best rule and
+ *   the search stops at the first group that cannot beat the match
+ * - Decision trees, HyperSplit style: binary cuts at rule boundaries on
+ *   one field per node, down to leaves of a few rules, one tree per
+ *   class of short and long address prefixes. Used for IPv4 rules with
+ *   prefix masks when they fall into many mask groups or have many port
+ *   ranges
+ *
+ * With ACL_ENGINE_AUTO each family above ACL_LINEAR_MAX rules gets the
+ * engine that does the least work on sample keys drawn from its rules,
+ * linear scan included, so rule sets that split into many mask groups
+ * never pay a hash probe per group.
+ *
+ * ACLs with at most PKT_MATCH_MAX_RULES IPv4 rules also get a table for
+ * the batched vector kernel of pkt_match.h, used by
+ * acl_lookup_find_burst() for IPv4 keys.
+ *
+ * A lookup structure is immutable once built; rebuild it when the rules
+ * change.
+ */
+
+#ifndef _ACL_LOOKUP_H
+#define _ACL_LOOKUP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "acl_huawei.h"
+#include "../../frr_core/lib/pkt_match.h"
+
+/* Packet fields matched by ACL rules */
+struct acl_key {
+    uint32_t src[4];            /* IPv4 in src[0]; IPv6 as four words; host order */
+    uint32_t dst[4];
+    uint16_t src_port;
+    uint16_t dst_port;
+    uint8_t protocol;
+    bool v6;
+};
+
+typedef enum {
+    ACL_ENGINE_AUTO = 0,        /* Cheapest on keys sampled from the rules */
+    ACL_ENGINE_LINEAR,
+    ACL_ENGINE_TUPLE,
+    ACL_ENGINE_TREE,            /* Falls back to tuples where it does not apply */
+} acl_engine_t;
+
+#define ACL_LINEAR_MAX          16      /* Rules scanned without an index */
+#define ACL_TUPLE_MAX           16      /* Mask groups before a tree is also tried */
+
+/* Shape of the index of one address family */
+struct acl_lookup_info {
+    acl_engine_t engine;
+    uint32_t rules;
+    uint32_t tuples;            /* Mask groups */
+    uint32_t trees;
+    uint32_t nodes;             /* Tree nodes */
+    uint32_t leaf_rules;        /* Rule references in tree leaves */
+    uint32_t depth;
+    bool batched;               /* Bursts go through the pkt_match kernel */
+};
+
+struct acl_lookup;
+
+struct acl_lookup *acl_lookup_build(const struct acl_rule *rules, uint32_t count,
+                                    acl_engine_t engine);
+int acl_lookup_find(const struct acl_lookup *lookup, const struct acl_key *key);
+void acl_lookup_find_burst(const struct acl_lookup *lookup, const struct acl_key *keys,
+                           uint32_t count, int *first);
+void acl_lookup_free(struct acl_lookup *lookup);
+void acl_lookup_info(const struct acl_lookup *lookup, bool v6, struct acl_lookup_info *info);
+size_t acl_lookup_memory(const struct acl_lookup *lookup);
+const char *acl_engine_name(acl_engine_t engine);
+bool acl_rule_match(const struct acl_rule *rule, const struct acl_key *key);
+
+#endif /* _ACL_LOOKUP_H */
@@ -0,0 +1,352 @@
+/*
+ * ACL Lookup Benchmark for Huawei VRP Style
+ * Copyright (C) 2026 WhiteBox NE Team
+ *
+ * This program measures the ACL lookup engines including:
+ * - Build time, memory and index shape at 1k, 10k and 100k rules
+ * - Lookup time per packet for the automatic choice and each engine
+ * - Agreement of every engine with rule-by-rule evaluation
+ * - Small IPv4 ACLs looked up in bursts, full and with short tails,
+ *   against the same ACL looked up one key at a time
+ *
+ * Rule sets imitate generated advanced ACLs: "prefix" uses /24 and host
+ * addresses with exact ports, "mixed" any prefix length with port
+ * ranges, "ipv6" /48 to /128 prefixes.
+ *
+ * Usage: acl_lookup_bench [-n lookups] [-m max_rules] [-s shape]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+#include "acl_lookup.h"
+
+#define BENCH_KEYS          65536
+#define BENCH_CHECK_OPS     200000000ull    /* Rule evaluations spent on agreement */
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint32_t rand32(void)
+{
+    return ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+}
+
+static uint32_t prefix_mask(int len)
+{
+    return len ? ~0u << (32 - len) : 0;
+}
+
+static void random_ports(uint16_t range[2], bool ranges)
+{
+    static const uint16_t services[] = { 22, 53, 80, 123, 179, 443, 3306, 8080 };
+
+    if (ranges && rand() % 3 == 0) {
+        range[0] = (uint16_t)(rand() % 60000);
+        range[1] = (uint16_t)(range[0] + rand() % 4096);
+    } else if (rand() % 4 == 0) {
+        range[0] = 0;
+        range[1] = 65535;
+    } else {
+        range[0] = range[1] = services[rand() % 8];
+    }
+}
+
+static void random_rule(struct acl_rule *rule, const char *shape, uint32_t id)
+{
+    memset(rule, 0, sizeof(*rule));
+    rule->rule_id = id;
+    rule->flags = rand() % 8 ? ACL_RULE_PERMIT : 0;
+    rule->protocol = rand() % 2 ? 6 : 17;
+    rule->src_port[1] = rule->dst_port[1] = 65535;
+
+    if (strcmp(shape, "ipv6") == 0) {
+        static const uint8_t lens[] = { 48, 56, 64, 128 };
+        rule->flags |= ACL_RULE_IPV6;
+        rule->src_plen = lens[rand() % 4];
+        rule->dst_plen = lens[rand() % 4];
+        for (int b = 0; b < 16; b++) {
+            int keep_src = rule->src_plen - b * 8, keep_dst = rule->dst_plen - b * 8;
+            uint8_t v = b < 2 ? (uint8_t)(0x20 + b) : b < 7 ? (uint8_t)(rand() % 4) : (uint8_t)rand();
+            rule->v6.src[b] = v & (keep_src >= 8 ? 0xff : keep_src > 0 ? 0xff << (8 - keep_src) : 0);
+            v = b < 2 ? (uint8_t)(0x20 + b) : b < 7 ? (uint8_t)(rand() % 4) : (uint8_t)rand();
+            rule->v6.dst[b] = v & (keep_dst >= 8 ? 0xff : keep_dst > 0 ? 0xff << (8 - keep_dst) : 0);
+        }
+        random_ports(rule->dst_port, false);
+        return;
+    }
+
+    bool mixed = strcmp(shape, "mixed") == 0;
+    int src_len = mixed ? 8 + rand() % 25 : rand() % 2 ? 24 : 32;
+    int dst_len = mixed ? 8 + rand() % 25 : rand() % 2 ? 24 : 32;
+    rule->v4.src_mask = prefix_mask(src_len);
+    rule->v4.src = (0x0a000000 | (rand32() & 0x00ffffff)) & rule->v4.src_mask;
+    rule->v4.dst_mask = prefix_mask(dst_len);
+    rule->v4.dst = (0xac100000 | (rand32() & 0x000fffff)) & rule->v4.dst_mask;
+    if (mixed && rand() % 8 == 0) {
+        rule->flags |= ACL_RULE_ANY_PROTOCOL;
+        return;
+    }
+    random_ports(rule->dst_port, mixed);
+    if (mixed && rand() % 4 == 0) {
+        random_ports(rule->src_port, true);
+    }
+}
+
+/* Half the keys fall inside a random rule, half are random */
+static void random_key(struct acl_key *key, const struct acl_rule *rules, uint32_t count)
+{
+    const struct acl_rule *rule = &rules[rand32() % count];
+    bool inside = rand() % 2;
+
+    memset(key, 0, sizeof(*key));
+    key->v6 = rule->flags & ACL_RULE_IPV6;
+    key->protocol = rule->flags & ACL_RULE_ANY_PROTOCOL ? (rand() % 2 ? 6 : 17) : rule->protocol;
+    key->src_port = inside ? (uint16_t)(rule->src_port[0] +
+                                        rand32() % (rule->src_port[1] - rule->src_port[0] + 1))
+                           : (uint16_t)rand();
+    key->dst_port = inside ? (uint16_t)(rule->dst_port[0] +
+                                        rand32() % (rule->dst_port[1] - rule->dst_port[0] + 1))
+                           : (uint16_t)rand();
+    if (key->v6) {
+        for (int w = 0; w < 4; w++) {
+            int bits_src = rule->src_plen - w * 32, bits_dst = rule->dst_plen - w * 32;
+            uint32_t ms = bits_src >= 32 ? ~0u : bits_src <= 0 ? 0 : prefix_mask(bits_src);
+            uint32_t md = bits_dst >= 32 ? ~0u : bits_dst <= 0 ? 0 : prefix_mask(bits_dst);
+            const uint8_t *s = &rule->v6.src[w * 4], *d = &rule->v6.dst[w * 4];
+            uint32_t sw = ((uint32_t)s[0] << 24) | (s[1] << 16) | (s[2] << 8) | s[3];
+            uint32_t dw = ((uint32_t)d[0] << 24) | (d[1] << 16) | (d[2] << 8) | d[3];
+            key->src[w] = (sw & ms) | (rand32() & ~ms);
+            key->dst[w] = inside ? (dw & md) | (rand32() & ~md) : rand32();
+        }
+    } else {
+        key->src[0] = (rule->v4.src & rule->v4.src_mask) | (rand32() & ~rule->v4.src_mask);
+        key->dst[0] = inside ? (rule->v4.dst & rule->v4.dst_mask) | (rand32() & ~rule->v4.dst_mask)
+                             : 0xac100000 | (rand32() & 0x000fffff);
+    }
+}
+
+static int linear_find(const struct acl_rule *rules, uint32_t count, const struct acl_key *key)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        if (acl_rule_match(&rules[i], key)) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+static void bench_engine(const char *shape, const struct acl_rule *rules, uint32_t count,
+                         const struct acl_key *keys, const int *expect, uint32_t checks,
+                         acl_engine_t engine, long lookups)
+{
+    double t0 = now_sec();
+    struct acl_lookup *lookup = acl_lookup_build(rules, count, engine);
+    double build = now_sec() - t0;
+
+    if (!lookup) {
+        printf("%-7s %7u  %-14s  build failed\n", shape, count, acl_engine_name(engine));
+        return;
+    }
+
+    struct acl_lookup_info info;
+    acl_lookup_info(lookup, strcmp(shape, "ipv6") == 0, &info);
+    if (info.engine == ACL_ENGINE_LINEAR) {
+        /* Same keys and count as the linear row, whichever engine was asked for */
+        lookups = lookups / (count / 1000 + 1) + 1;
+    }
+
+    uint32_t agree = 0;
+    for (uint32_t i = 0; i < checks; i++) {
+        agree += acl_lookup_find(lookup, &keys[i]) == expect[i];
+    }
+
+    volatile long sink = 0;
+    t0 = now_sec();
+    for (long i = 0; i < lookups; i++) {
+        sink += acl_lookup_find(lookup, &keys[i & (BENCH_KEYS - 1)]);
+    }
+    double elapsed = now_sec() - t0;
+    (void)sink;
+
+    char engine_name[32];
+    snprintf(engine_name, sizeof(engine_name), "%s%s", engine == ACL_ENGINE_AUTO ? "auto: " : "",
+             acl_engine_name(info.engine));
+    printf("%-7s %7u  %-19s %9.1f %10zu %7u %8u %6u %6.1f %10.1f  %u/%u\n", shape, count,
+           engine_name, build * 1e3, acl_lookup_memory(lookup) / 1024, info.tuples, info.nodes,
+           info.depth, (double)info.leaf_rules / count, elapsed * 1e9 / lookups, agree, checks);
+    acl_lookup_free(lookup);
+}
+
+static void bench_shape(const char *shape, uint32_t count, long lookups)
+{
+    struct acl_rule *rules = malloc(count * sizeof(*rules));
+    struct acl_key *keys = malloc(BENCH_KEYS * sizeof(*keys));
+    int *expect = malloc(BENCH_KEYS * sizeof(*expect));
+
+    if (!rules || !keys || !expect) {
+        fprintf(stderr, "Error: Out of memory for %u rules\n", count);
+        exit(1);
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        random_rule(&rules[i], shape, (i + 1) * ACL_RULE_STEP);
+    }
+    for (uint32_t i = 0; i < BENCH_KEYS; i++) {
+        random_key(&keys[i], rules, count);
+    }
+
+    /* Rule-by-rule results for as many keys as the budget allows */
+    uint32_t checks = (uint32_t)(BENCH_CHECK_OPS / count);
+    if (checks > BENCH_KEYS) {
+        checks = BENCH_KEYS;
+    }
+    for (uint32_t i = 0; i < checks; i++) {
+        expect[i] = linear_find(rules, count, &keys[i]);
+    }
+
+    static const acl_engine_t engines[] = { ACL_ENGINE_AUTO, ACL_ENGINE_TUPLE, ACL_ENGINE_TREE,
+                                            ACL_ENGINE_LINEAR };
+    for (size_t e = 0; e < sizeof(engines) / sizeof(engines[0]); e++) {
+        if (engines[e] == ACL_ENGINE_TREE && strcmp(shape, "ipv6") == 0) {
+            continue;
+        }
+        bench_engine(shape, rules, count, keys, expect, checks, engines[e], lookups);
+    }
+
+    free(rules);
+    free(keys);
+    free(expect);
+}
+
+/* Small ACLs go through the pkt_match kernel in bursts; odd sizes cover the tail */
+static void bench_burst(const char *shape, uint32_t count, uint32_t size, long lookups)
+{
+    struct acl_rule rules[PKT_MATCH_MAX_RULES];
+    struct acl_key *keys = malloc(BENCH_KEYS * sizeof(*keys));
+    int *first = malloc(BENCH_KEYS * sizeof(*first));
+
+    if (!keys || !first) {
+        fprintf(stderr, "Error: Out of memory for %d keys\n", BENCH_KEYS);
+        exit(1);
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        random_rule(&rules[i], shape, (i + 1) * ACL_RULE_STEP);
+    }
+    for (uint32_t i = 0; i < BENCH_KEYS; i++) {
+        random_key(&keys[i], rules, count);
+    }
+
+    struct acl_lookup *lookup = acl_lookup_build(rules, count, ACL_ENGINE_AUTO);
+    struct acl_lookup_info info;
+    if (!lookup) {
+        printf("%-7s %7u %6u  build failed\n", shape, count, size);
+        free(keys);
+        free(first);
+        return;
+    }
+    acl_lookup_info(lookup, false, &info);
+
+    /* Whole key set in bursts of size, checked against linear_find */
+    uint32_t agree = 0, bursts = BENCH_KEYS / size;
+    for (uint32_t b = 0; b < bursts; b++) {
+        acl_lookup_find_burst(lookup, &keys[b * size], size, &first[b * size]);
+    }
+    for (uint32_t i = 0; i < bursts * size; i++) {
+        agree += first[i] == linear_find(rules, count, &keys[i]);
+    }
+
+    volatile long sink = 0;
+    double t0 = now_sec();
+    for (long i = 0; i < lookups; i++) {
+        sink += acl_lookup_find(lookup, &keys[i & (BENCH_KEYS - 1)]);
+    }
+    double single = now_sec() - t0;
+
+    long rounds = lookups / size + 1;
+    t0 = now_sec();
+    for (long r = 0; r < rounds; r++) {
+        uint32_t b = (uint32_t)(r % bursts);
+        acl_lookup_find_burst(lookup, &keys[b * size], size, &first[b * size]);
+        sink += first[b * size];
+    }
+    double batched = now_sec() - t0;
+    (void)sink;
+
+    printf("%-7s %7u %6u  %-8s %10.1f %10.1f %8.2fx  %u/%u\n", shape, count, size,
+           info.batched ? "kernel" : "per-key", single * 1e9 / lookups,
+           batched * 1e9 / (rounds * size), single / lookups / (batched / (rounds * size)),
+           agree, bursts * size);
+    acl_lookup_free(lookup);
+    free(keys);
+    free(first);
+}
+
+int main(int argc, char **argv)
+{
+    long lookups = 2000000;
+    uint32_t max_rules = 100000;
+    const char *only = NULL;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:m:s:")) != -1) {
+        switch (opt) {
+        case 'n':
+            lookups = atol(optarg);
+            break;
+        case 'm':
+            max_rules = (uint32_t)atol(optarg);
+            break;
+        case 's':
+            only = optarg;
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-n lookups] [-m max_rules] [-s prefix|mixed|ipv6]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (lookups < 1 || max_rules < 1) {
+        fprintf(stderr, "Error: lookups and max_rules must be positive\n");
+        return 1;
+    }
+
+    srand(1);
+    printf("ACL lookup: %ld lookups per engine, %d keys, half inside a rule\n\n", lookups,
+           BENCH_KEYS);
+    printf("%-7s %7s  %-19s %9s %10s %7s %8s %6s %6s %10s  %s\n", "Shape", "Rules", "Engine",
+           "Build ms", "Memory KB", "Tuples", "Nodes", "Depth", "Repl", "Lookup ns", "Agree");
+
+    static const char *shapes[] = { "prefix", "mixed", "ipv6" };
+    for (int s = 0; s < 3; s++) {
+        if (only && strcmp(only, shapes[s]) != 0) {
+            continue;
+        }
+        for (uint32_t count = 1000; count <= max_rules; count *= 10) {
+            bench_shape(shapes[s], count, lookups);
+        }
+    }
+
+    printf("\nSmall IPv4 ACLs in bursts of up to %d keys\n\n", PKT_MATCH_BURST);
+    printf("%-7s %7s %6s  %-8s %10s %10s %9s  %s\n", "Shape", "Rules", "Burst", "Path",
+           "Single ns", "Burst ns", "Speedup", "Agree");
+    static const uint32_t small[] = { 8, 32, PKT_MATCH_MAX_RULES };
+    static const uint32_t sizes[] = { PKT_MATCH_BURST, 13, 3, 1 };
+    for (int s = 0; s < 2; s++) {
+        if (only && strcmp(only, shapes[s]) != 0) {
+            continue;
+        }
+        for (size_t c = 0; c < sizeof(small) / sizeof(small[0]); c++) {
+            for (size_t z = 0; z < sizeof(sizes) / sizeof(sizes[0]); z++) {
+                bench_burst(shapes[s], small[c], sizes[z], lookups);
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,1322 @@
+/*
+ * ACL Kernel Backend for Huawei VRP Style
+ * Copyright (C) 2026 WhiteBox NE Team
+ *
+ * This module provides the nftables backend of acl_nft.h including:
+ * - Grouping of the rules of each address family into verdict maps of
+ *   non-overlapping intervals, keyed by the fields the group matches on
+ * - Static interval trees per field over the rules of a family, finding
+ *   the members of the open group a rule overlaps
+ * - Standalone chain rules for discontiguous IPv4 wildcards
+ * - nfnetlink batches carrying table, chains, maps, elements and rules,
+ *   sent in one sendmsg and committed by the kernel as one transaction
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <linux/netlink.h>
+#include <linux/netfilter.h>
+#include <linux/netfilter/nfnetlink.h>
+#include <linux/netfilter/nf_tables.h>
+#include "acl_nft.h"
+
+#define NFT_MSG_MAX             65536   /* Largest single message */
+#define NFT_NL_BUFFER_SIZE      65536   /* Receive buffer */
+#define NFT_ELEMS_PER_MSG       256     /* Map elements per NEWSETELEM */
+#define NFT_KEY_MAX             44      /* IPv6 key: two addresses, protocol, two ports */
+#define NFT_FILTER_PRIORITY     0
+#define NFT_INDEX_DIMS          4       /* Fields with an interval tree: addresses, ports */
+
+/* Fields of a map key */
+enum {
+    NFT_FIELD_SRC = 0,
+    NFT_FIELD_DST,
+    NFT_FIELD_PROTOCOL,
+    NFT_FIELD_SRC_PORT,
+    NFT_FIELD_DST_PORT,
+    NFT_FIELD_MAX
+};
+
+/* Bytes of each field in the packet, per family */
+static const uint8_t field_len[2][NFT_FIELD_MAX] = {
+    { 4, 4, 1, 2, 2 },
+    { 16, 16, 1, 2, 2 },
+};
+
+static const uint8_t index_field[NFT_INDEX_DIMS] = {
+    NFT_FIELD_SRC, NFT_FIELD_DST, NFT_FIELD_SRC_PORT, NFT_FIELD_DST_PORT,
+};
+
+/* Rule as a box of closed intervals, each bound big-endian in its field bytes */
+struct nft_box {
+    uint8_t lo[NFT_FIELD_MAX][16];
+    uint8_t hi[NFT_FIELD_MAX][16];
+};
+
+/* A verdict map, or one standalone rule */
+struct nft_group {
+    bool v6;
+    bool standalone;
+    uint8_t fields;             /* Key fields, bit per NFT_FIELD_* */
+    uint32_t first;             /* In the member list */
+    uint32_t count;
+};
+
+/*
+ * Interval rules of one family sorted by low bound in one field, as in
+ * acl_analyze.c: position m roots the subtree over a range of positions
+ * centred on it and max_hi[m] is the highest bound there. Bounds are
+ * the first 8 bytes of the field, so overlapping rules overlap here.
+ * live[m] counts the members of the open group in the subtree.
+ */
+struct nft_tree {
+    uint32_t *order;            /* Rule index by position */
+    uint32_t *position;         /* Of each rule in order, by rule index */
+    uint64_t *lo;
+    uint64_t *hi;
+    uint64_t *max_hi;
+    uint32_t *live;
+    uint64_t *hi_sorted;
+};
+
+struct nft_sort {
+    uint64_t lo;
+    uint64_t hi;
+    uint32_t rule;
+};
+
+/* Members of the open group, found without comparing the rule to each */
+struct nft_index {
+    struct nft_tree trees[NFT_INDEX_DIMS];
+    uint32_t count;             /* Interval rules of the family */
+    bool *member;               /* By rule index */
+    uint32_t *found;
+};
+
+/* Compiled ACL */
+struct nft_plan {
+    struct nft_group *groups;
+    uint32_t group_count;
+    uint32_t *members;          /* Rule indexes, by group */
+    uint32_t member_count;
+    struct nft_box *boxes;      /* Per rule */
+    struct acl_nft_info info;
+};
+
+/* Message being encoded */
+struct nft_msg {
+    struct nlmsghdr *nlh;
+    size_t max;
+    bool overflow;
+};
+
+/* State change applied once the batch commits */
+struct nft_pending {
+    struct acl_nft_state *state;
+    bool remove;
+    uint8_t generation;
+    uint32_t maps;
+    struct acl_nft_info info;
+};
+
+struct acl_nft_batch {
+    char *buf;
+    size_t len;
+    size_t cap;
+    uint32_t acks;              /* Messages answered by the kernel */
+    uint32_t seq_first;
+    uint32_t set_id;
+    struct nft_pending *pending;
+    uint32_t pending_count;
+    int error;                  /* Encoding failure, negative errno */
+};
+
+static int nft_nl_fd = -1;
+static uint32_t nft_nl_seq = 0;
+static pthread_mutex_t nft_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int nft_socket(void)
+{
+    if (nft_nl_fd >= 0) {
+        return nft_nl_fd;
+    }
+    int fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_NETFILTER);
+    if (fd < 0) {
+        return -1;
+    }
+    /* Errors echo only the header, so a failed batch fits the receive buffer */
+    int one = 1;
+    setsockopt(fd, SOL_NETLINK, NETLINK_CAP_ACK, &one, sizeof(one));
+    nft_nl_fd = fd;
+    return fd;
+}
+
+/* ---- Rule shapes ---- */
+
+static void put_be(uint8_t *p, uint32_t value, int len)
+{
+    for (int i = len - 1; i >= 0; i--) {
+        p[i] = (uint8_t)value;
+        value >>= 8;
+    }
+}
+
+/* IPv4 masks that are a prefix, the only ones an interval can hold */
+static bool mask_contiguous(uint32_t mask)
+{
+    uint32_t host = ~mask;
+    return (host & (host + 1)) == 0;
+}
+
+static bool rule_is_interval(const struct acl_rule *rule)
+{
+    return (rule->flags & ACL_RULE_IPV6) ||
+           (mask_contiguous(rule->v4.src_mask) && mask_contiguous(rule->v4.dst_mask));
+}
+
+static void prefix_bounds(const uint8_t *addr, uint8_t plen, uint8_t *lo, uint8_t *hi)
+{
+    for (int i = 0; i < 16; i++) {
+        int bits = plen - i * 8;
+        uint8_t mask = bits >= 8 ? 0xff : bits <= 0 ? 0 : (uint8_t)(0xff << (8 - bits));
+        lo[i] = addr[i] & mask;
+        hi[i] = addr[i] | (uint8_t)~mask;
+    }
+}
+
+static void rule_box(const struct acl_rule *rule, struct nft_box *box)
+{
+    memset(box, 0, sizeof(*box));
+    if (rule->flags & ACL_RULE_IPV6) {
+        prefix_bounds(rule->v6.src, rule->src_plen, box->lo[NFT_FIELD_SRC], box->hi[NFT_FIELD_SRC]);
+        prefix_bounds(rule->v6.dst, rule->dst_plen, box->lo[NFT_FIELD_DST], box->hi[NFT_FIELD_DST]);
+    } else {
+        put_be(box->lo[NFT_FIELD_SRC], rule->v4.src, 4);
+        put_be(box->hi[NFT_FIELD_SRC], rule->v4.src | ~rule->v4.src_mask, 4);
+        put_be(box->lo[NFT_FIELD_DST], rule->v4.dst, 4);
+        put_be(box->hi[NFT_FIELD_DST], rule->v4.dst | ~rule->v4.dst_mask, 4);
+    }
+    bool any = rule->flags & ACL_RULE_ANY_PROTOCOL;
+    box->lo[NFT_FIELD_PROTOCOL][0] = any ? 0 : rule->protocol;
+    box->hi[NFT_FIELD_PROTOCOL][0] = any ? 0xff : rule->protocol;
+    put_be(box->lo[NFT_FIELD_SRC_PORT], rule->src_port[0], 2);
+    put_be(box->hi[NFT_FIELD_SRC_PORT], rule->src_port[1], 2);
+    put_be(box->lo[NFT_FIELD_DST_PORT], rule->dst_port[0], 2);
+    put_be(box->hi[NFT_FIELD_DST_PORT], rule->dst_port[1], 2);
+}
+
+static bool box_overlap(const struct nft_box *a, const struct nft_box *b, bool v6)
+{
+    for (int f = 0; f < NFT_FIELD_MAX; f++) {
+        int len = field_len[v6][f];
+        if (memcmp(a->lo[f], b->hi[f], len) > 0 || memcmp(b->lo[f], a->hi[f], len) > 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Every packet of b is in a */
+static bool box_covers(const struct nft_box *a, const struct nft_box *b, bool v6)
+{
+    for (int f = 0; f < NFT_FIELD_MAX; f++) {
+        int len = field_len[v6][f];
+        if (memcmp(a->lo[f], b->lo[f], len) > 0 || memcmp(b->hi[f], a->hi[f], len) > 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Fields a rule restricts; addresses are always in the key */
+static uint8_t rule_fields(const struct acl_rule *rule)
+{
+    uint8_t fields = 1u << NFT_FIELD_SRC | 1u << NFT_FIELD_DST;
+
+    if (!(rule->flags & ACL_RULE_ANY_PROTOCOL)) {
+        fields |= 1u << NFT_FIELD_PROTOCOL;
+    }
+    if (rule->src_port[0] != 0 || rule->src_port[1] != 65535) {
+        fields |= 1u << NFT_FIELD_SRC_PORT;
+    }
+    if (rule->dst_port[0] != 0 || rule->dst_port[1] != 65535) {
+        fields |= 1u << NFT_FIELD_DST_PORT;
+    }
+    return fields;
+}
+
+/* Fields loaded from the transport header, which non-first fragments lack */
+static uint8_t port_fields(uint8_t fields)
+{
+    return fields & (1u << NFT_FIELD_SRC_PORT | 1u << NFT_FIELD_DST_PORT);
+}
+
+static void plan_free(struct nft_plan *plan)
+{
+    free(plan->groups);
+    free(plan->members);
+    free(plan->boxes);
+    memset(plan, 0, sizeof(*plan));
+}
+
+static int plan_group(struct nft_plan *plan, bool v6, bool standalone)
+{
+    if (plan->group_count == ACL_NFT_MAX_GROUPS) {
+        return -E2BIG;
+    }
+    plan->groups[plan->group_count++] = (struct nft_group) {
+        .v6 = v6, .standalone = standalone, .first = plan->member_count,
+    };
+    return 0;
+}
+
+/* ---- Overlap index ---- */
+
+/* Leading 8 bytes of a field bound, ordered as the bound */
+static uint64_t bound64(const uint8_t *bound, int len)
+{
+    uint64_t value = 0;
+
+    for (int i = 0; i < 8; i++) {
+        value = value << 8 | (i < len ? bound[i] : 0);
+    }
+    return value;
+}
+
+static int sort_by_lo(const void *a, const void *b)
+{
+    const struct nft_sort *x = a, *y = b;
+    if (x->lo != y->lo) {
+        return x->lo < y->lo ? -1 : 1;
+    }
+    return x->rule < y->rule ? -1 : x->rule > y->rule;
+}
+
+static int sort_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static uint64_t tree_fill(struct nft_tree *tree, uint32_t l, uint32_t r)
+{
+    if (l >= r) {
+        return 0;
+    }
+    uint32_t m = l + (r - l) / 2;
+    uint64_t max = tree->hi[m];
+    uint64_t left = tree_fill(tree, l, m);
+    uint64_t right = tree_fill(tree, m + 1, r);
+    max = left > max ? left : max;
+    max = right > max ? right : max;
+    tree->max_hi[m] = max;
+    return max;
+}
+
+static void index_free(struct nft_index *index)
+{
+    for (int d = 0; d < NFT_INDEX_DIMS; d++) {
+        struct nft_tree *tree = &index->trees[d];
+        free(tree->order);
+        free(tree->position);
+        free(tree->lo);
+        free(tree->hi);
+        free(tree->max_hi);
+        free(tree->live);
+        free(tree->hi_sorted);
+    }
+    free(index->member);
+    free(index->found);
+    memset(index, 0, sizeof(*index));
+}
+
+/* Trees over the interval rules of one family */
+static int index_build(struct nft_index *index, const struct nft_plan *plan,
+                       const struct acl_config *acl, bool v6)
+{
+    uint32_t rules = acl->rule_count > 0 ? (uint32_t)acl->rule_count : 1;
+
+    memset(index, 0, sizeof(*index));
+    for (int i = 0; i < acl->rule_count; i++) {
+        const struct acl_rule *rule = &acl->rules[i];
+        if (((rule->flags & ACL_RULE_IPV6) != 0) == v6 && rule_is_interval(rule)) {
+            index->count++;
+        }
+    }
+    uint32_t n = index->count, slots = n ? n : 1;
+    struct nft_sort *sort = malloc(slots * sizeof(*sort));
+    index->member = calloc(rules, sizeof(*index->member));
+    index->found = malloc(slots * sizeof(*index->found));
+    if (!sort || !index->member || !index->found) {
+        free(sort);
+        return -ENOMEM;
+    }
+
+    for (int d = 0; d < NFT_INDEX_DIMS; d++) {
+        struct nft_tree *tree = &index->trees[d];
+        int field = index_field[d], len = field_len[v6][field];
+        tree->order = malloc(slots * sizeof(*tree->order));
+        tree->position = malloc(rules * sizeof(*tree->position));
+        tree->lo = malloc(slots * sizeof(*tree->lo));
+        tree->hi = malloc(slots * sizeof(*tree->hi));
+        tree->max_hi = malloc(slots * sizeof(*tree->max_hi));
+        tree->live = calloc(slots, sizeof(*tree->live));
+        tree->hi_sorted = malloc(slots * sizeof(*tree->hi_sorted));
+        if (!tree->order || !tree->position || !tree->lo || !tree->hi || !tree->max_hi ||
+            !tree->live || !tree->hi_sorted) {
+            free(sort);
+            return -ENOMEM;
+        }
+        uint32_t p = 0;
+        for (int i = 0; i < acl->rule_count; i++) {
+            const struct acl_rule *rule = &acl->rules[i];
+            if (((rule->flags & ACL_RULE_IPV6) != 0) != v6 || !rule_is_interval(rule)) {
+                continue;
+            }
+            const struct nft_box *box = &plan->boxes[i];
+            sort[p] = (struct nft_sort) {
+                .lo = bound64(box->lo[field], len),
+                .hi = bound64(box->hi[field], len),
+                .rule = (uint32_t)i,
+            };
+            tree->hi_sorted[p] = sort[p].hi;
+            p++;
+        }
+        qsort(sort, n, sizeof(*sort), sort_by_lo);
+        qsort(tree->hi_sorted, n, sizeof(*tree->hi_sorted), sort_u64);
+        for (p = 0; p < n; p++) {
+            tree->order[p] = sort[p].rule;
+            tree->position[sort[p].rule] = p;
+            tree->lo[p] = sort[p].lo;
+            tree->hi[p] = sort[p].hi;
+        }
+        tree_fill(tree, 0, n);
+    }
+    free(sort);
+    return 0;
+}
+
+/* Count a rule in or out of the live fields on the path from the root to it */
+static void index_update(struct nft_index *index, uint32_t rule, bool insert)
+{
+    index->member[rule] = insert;
+    for (int d = 0; d < NFT_INDEX_DIMS; d++) {
+        struct nft_tree *tree = &index->trees[d];
+        uint32_t p = tree->position[rule], l = 0, r = index->count;
+        for (;;) {
+            uint32_t m = l + (r - l) / 2;
+            tree->live[m] += insert ? 1 : -1;
+            if (m == p) {
+                break;
+            }
+            if (p < m) {
+                r = m;
+            } else {
+                l = m + 1;
+            }
+        }
+    }
+}
+
+/* Positions of a sorted array with values <= v, or < v */
+static uint32_t count_upto(const uint64_t *sorted, uint32_t n, uint64_t v, bool inclusive)
+{
+    uint32_t l = 0, r = n;
+
+    while (l < r) {
+        uint32_t m = l + (r - l) / 2;
+        if (sorted[m] < v || (inclusive && sorted[m] == v)) {
+            l = m + 1;
+        } else {
+            r = m;
+        }
+    }
+    return l;
+}
+
+/* Field in which the fewest rules of the family overlap the box */
+static int index_best_dim(const struct nft_index *index, const struct nft_box *box, bool v6)
+{
+    uint32_t best_count = UINT32_MAX;
+    int best = 0;
+
+    for (int d = 0; d < NFT_INDEX_DIMS; d++) {
+        const struct nft_tree *tree = &index->trees[d];
+        int field = index_field[d], len = field_len[v6][field];
+        uint64_t a = bound64(box->lo[field], len), b = bound64(box->hi[field], len);
+        uint32_t c = count_upto(tree->lo, index->count, b, true) -
+                     count_upto(tree->hi_sorted, index->count, a, false);
+        if (c < best_count) {
+            best_count = c;
+            best = d;
+        }
+    }
+    return best;
+}
+
+/* Append the members overlapping [a, b] in one field */
+static void index_query(struct nft_index *index, int dim, uint32_t l, uint32_t r, uint64_t a,
+                        uint64_t b, uint32_t *found)
+{
+    const struct nft_tree *tree = &index->trees[dim];
+
+    while (l < r) {
+        uint32_t m = l + (r - l) / 2;
+        if (!tree->live[m] || tree->max_hi[m] < a) {
+            return;
+        }
+        index_query(index, dim, l, m, a, b, found);
+        if (tree->lo[m] > b) {
+            return;
+        }
+        if (tree->hi[m] >= a && index->member[tree->order[m]]) {
+            index->found[(*found)++] = tree->order[m];
+        }
+        l = m + 1;
+    }
+}
+
+/* Members of the open group the box may overlap, in index->found */
+static uint32_t index_candidates(struct nft_index *index, const struct nft_box *box, bool v6)
+{
+    int dim = index_best_dim(index, box, v6);
+    int field = index_field[dim], len = field_len[v6][field];
+    uint32_t found = 0;
+
+    index_query(index, dim, 0, index->count, bound64(box->lo[field], len),
+                bound64(box->hi[field], len), &found);
+    return found;
+}
+
+/*
+ * Close the open group: drop the members absorbed by later rules from
+ * the member list and empty the index for the next group.
+ */
+static void plan_close(struct nft_plan *plan, struct nft_group *open, struct nft_index *index)
+{
+    uint32_t kept = 0;
+
+    if (!open) {
+        return;
+    }
+    for (uint32_t m = 0; m < open->count; m++) {
+        uint32_t idx = plan->members[open->first + m];
+        if (index->member[idx]) {
+            index_update(index, idx, false);
+            plan->members[open->first + kept++] = idx;
+        }
+    }
+    plan->member_count -= open->count - kept;
+    open->count = kept;
+}
+
+/*
+ * Add the rules of one family to the plan in ID order. A rule joins the
+ * open group if no member it overlaps has another action and each one
+ * it overlaps covers it or is covered by it. Rules with and without
+ * ports never share a group: a key with ports aborts the lookup for a
+ * fragment, which must still meet the rules that match any port. The
+ * members a rule overlaps are found through the index, so a family
+ * costs O(n log n) when each rule overlaps few of them.
+ */
+static int plan_family(struct nft_plan *plan, const struct acl_config *acl, bool v6)
+{
+    struct nft_group *open = NULL;
+    struct nft_index index;
+    int ret = index_build(&index, plan, acl, v6);
+
+    for (int i = 0; i < acl->rule_count && ret == 0; i++) {
+        const struct acl_rule *rule = &acl->rules[i];
+        if (((rule->flags & ACL_RULE_IPV6) != 0) != v6) {
+            continue;
+        }
+        if (!rule_is_interval(rule)) {
+            plan_close(plan, open, &index);
+            open = NULL;
+            if ((ret = plan_group(plan, v6, true)) < 0) {
+                break;
+            }
+            plan->members[plan->member_count++] = (uint32_t)i;
+            plan->groups[plan->group_count - 1].count = 1;
+            plan->info.standalone++;
+            continue;
+        }
+
+        const struct nft_box *box = &plan->boxes[i];
+        bool fits = open != NULL &&
+                    !port_fields(open->fields) == !port_fields(rule_fields(rule));
+        bool covered = false;
+        uint32_t absorbed = 0, found = fits ? index_candidates(&index, box, v6) : 0;
+        for (uint32_t f = 0; fits && f < found; f++) {
+            uint32_t idx = index.found[f];
+            const struct nft_box *other = &plan->boxes[idx];
+            if (!box_overlap(box, other, v6)) {
+                continue;
+            }
+            if ((acl->rules[idx].flags ^ rule->flags) & ACL_RULE_PERMIT) {
+                fits = false;
+            } else if (box_covers(other, box, v6)) {
+                covered = true;
+                break;
+            } else if (box_covers(box, other, v6)) {
+                index.found[absorbed++] = idx;
+            } else {
+                fits = false;
+            }
+        }
+        if (covered) {
+            plan->info.redundant++;
+            continue;
+        }
+
+        if (fits) {
+            /* Members inside the new rule would overlap it in the map */
+            for (uint32_t f = 0; f < absorbed; f++) {
+                index_update(&index, index.found[f], false);
+            }
+            plan->info.redundant += absorbed;
+        } else {
+            plan_close(plan, open, &index);
+            if ((ret = plan_group(plan, v6, false)) < 0) {
+                break;
+            }
+            open = &plan->groups[plan->group_count - 1];
+        }
+        plan->members[plan->member_count++] = (uint32_t)i;
+        open->count++;
+        open->fields |= rule_fields(rule);
+        index_update(&index, (uint32_t)i, true);
+    }
+    if (ret == 0) {
+        plan_close(plan, open, &index);
+    }
+    index_free(&index);
+    return ret;
+}
+
+static int plan_build(const struct acl_config *acl, struct nft_plan *plan)
+{
+    uint32_t count = acl->rule_count > 0 ? (uint32_t)acl->rule_count : 1;
+    int ret = 0;
+
+    memset(plan, 0, sizeof(*plan));
+    plan->groups = malloc(ACL_NFT_MAX_GROUPS * sizeof(*plan->groups));
+    plan->members = malloc(count * sizeof(*plan->members));
+    plan->boxes = malloc(count * sizeof(*plan->boxes));
+    if (!plan->groups || !plan->members || !plan->boxes) {
+        plan_free(plan);
+        return -ENOMEM;
+    }
+    for (int i = 0; i < acl->rule_count; i++) {
+        rule_box(&acl->rules[i], &plan->boxes[i]);
+    }
+    if ((ret = plan_family(plan, acl, false)) == 0) {
+        ret = plan_family(plan, acl, true);
+    }
+    if (ret < 0) {
+        plan_free(plan);
+        return ret;
+    }
+    for (uint32_t g = 0; g < plan->group_count; g++) {
+        if (!plan->groups[g].standalone) {
+            plan->info.maps++;
+            plan->info.elements += plan->groups[g].count;
+        }
+    }
+    return 0;
+}
+
+/* ---- Message encoding ---- */
+
+/* Start a message at the end of the batch; false when out of memory */
+static bool nft_msg_begin(struct acl_nft_batch *batch, struct nft_msg *m, uint16_t type,
+                          uint16_t flags, uint8_t family)
+{
+    if (batch->error) {
+        return false;
+    }
+    if (batch->len + NFT_MSG_MAX > batch->cap) {
+        size_t cap = batch->cap * 2 > batch->len + NFT_MSG_MAX ? batch->cap * 2 :
+                     batch->len + NFT_MSG_MAX;
+        char *buf = realloc(batch->buf, cap);
+        if (!buf) {
+            batch->error = -ENOMEM;
+            return false;
+        }
+        batch->buf = buf;
+        batch->cap = cap;
+    }
+
+    memset(batch->buf + batch->len, 0, NLMSG_SPACE(sizeof(struct nfgenmsg)));
+    m->nlh = (struct nlmsghdr *)(batch->buf + batch->len);
+    m->max = NFT_MSG_MAX;
+    m->overflow = false;
+    m->nlh->nlmsg_len = NLMSG_LENGTH(sizeof(struct nfgenmsg));
+    m->nlh->nlmsg_type = type;
+    m->nlh->nlmsg_flags = NLM_F_REQUEST | flags;
+    m->nlh->nlmsg_seq = ++nft_nl_seq;
+
+    struct nfgenmsg *nfg = NLMSG_DATA(m->nlh);
+    nfg->nfgen_family = family;
+    nfg->version = NFNETLINK_V0;
+    return true;
+}
+
+static void nft_msg_end(struct acl_nft_batch *batch, struct nft_msg *m)
+{
+    if (m->overflow) {
+        batch->error = -EMSGSIZE;
+        return;
+    }
+    if (m->nlh->nlmsg_flags & NLM_F_ACK) {
+        if (batch->acks == 0) {
+            batch->seq_first = m->nlh->nlmsg_seq;
+        }
+        batch->acks++;
+    }
+    batch->len += NLMSG_ALIGN(m->nlh->nlmsg_len);
+}
+
+/* nf_tables request, acknowledged */
+static bool nft_request(struct acl_nft_batch *batch, struct nft_msg *m, int type, uint16_t flags)
+{
+    return nft_msg_begin(batch, m, (uint16_t)(NFNL_SUBSYS_NFTABLES << 8 | type),
+                         NLM_F_ACK | flags, NFPROTO_INET);
+}
+
+static struct nlattr *nft_put(struct nft_msg *m, uint16_t type, const void *data, size_t len)
+{
+    size_t offset = NLMSG_ALIGN(m->nlh->nlmsg_len);
+    if (m->overflow || offset + NLA_ALIGN(NLA_HDRLEN + len) > m->max) {
+        m->overflow = true;
+        return NULL;
+    }
+    struct nlattr *nla = (struct nlattr *)((char *)m->nlh + offset);
+    nla->nla_type = type;
+    nla->nla_len = (uint16_t)(NLA_HDRLEN + len);
+    if (len) {
+        memcpy((char *)nla + NLA_HDRLEN, data, len);
+    }
+    m->nlh->nlmsg_len = (uint32_t)(offset + NLA_ALIGN(NLA_HDRLEN + len));
+    return nla;
+}
+
+static void nft_put_be32(struct nft_msg *m, uint16_t type, uint32_t value)
+{
+    uint32_t be = htonl(value);
+    nft_put(m, type, &be, sizeof(be));
+}
+
+static void nft_put_str(struct nft_msg *m, uint16_t type, const char *value)
+{
+    nft_put(m, type, value, strlen(value) + 1);
+}
+
+static struct nlattr *nft_nest(struct nft_msg *m, uint16_t type)
+{
+    return nft_put(m, type | NLA_F_NESTED, NULL, 0);
+}
+
+static void nft_nest_end(struct nft_msg *m, struct nlattr *nest)
+{
+    if (nest && !m->overflow) {
+        size_t len = (size_t)((char *)m->nlh + m->nlh->nlmsg_len - (char *)nest);
+        if (len > UINT16_MAX) {
+            m->overflow = true;
+            return;
+        }
+        nest->nla_len = (uint16_t)len;
+    }
+}
+
+/* nft_data value nested under type */
+static void nft_put_data(struct nft_msg *m, uint16_t type, const void *data, size_t len)
+{
+    struct nlattr *nest = nft_nest(m, type);
+    nft_put(m, NFTA_DATA_VALUE, data, len);
+    nft_nest_end(m, nest);
+}
+
+/* nft_data verdict nested under type, with a chain for jumps */
+static void nft_put_verdict(struct nft_msg *m, uint16_t type, int code, const char *chain)
+{
+    struct nlattr *data = nft_nest(m, type);
+    struct nlattr *verdict = nft_nest(m, NFTA_DATA_VERDICT);
+    nft_put_be32(m, NFTA_VERDICT_CODE, (uint32_t)code);
+    if (chain) {
+        nft_put_str(m, NFTA_VERDICT_CHAIN, chain);
+    }
+    nft_nest_end(m, verdict);
+    nft_nest_end(m, data);
+}
+
+/* ---- Expressions ---- */
+
+static struct nlattr *nft_expr_begin(struct nft_msg *m, const char *name, struct nlattr **data)
+{
+    struct nlattr *elem = nft_nest(m, NFTA_LIST_ELEM);
+    nft_put_str(m, NFTA_EXPR_NAME, name);
+    *data = nft_nest(m, NFTA_EXPR_DATA);
+    return elem;
+}
+
+static void nft_expr_end(struct nft_msg *m, struct nlattr *elem, struct nlattr *data)
+{
+    nft_nest_end(m, data);
+    nft_nest_end(m, elem);
+}
+
+static void nft_expr_meta(struct nft_msg *m, uint32_t key, uint32_t dreg)
+{
+    struct nlattr *data, *elem = nft_expr_begin(m, "meta", &data);
+    nft_put_be32(m, NFTA_META_DREG, dreg);
+    nft_put_be32(m, NFTA_META_KEY, key);
+    nft_expr_end(m, elem, data);
+}
+
+static void nft_expr_payload(struct nft_msg *m, uint32_t base, uint32_t offset, uint32_t len,
+                             uint32_t dreg)
+{
+    struct nlattr *data, *elem = nft_expr_begin(m, "payload", &data);
+    nft_put_be32(m, NFTA_PAYLOAD_DREG, dreg);
+    nft_put_be32(m, NFTA_PAYLOAD_BASE, base);
+    nft_put_be32(m, NFTA_PAYLOAD_OFFSET, offset);
+    nft_put_be32(m, NFTA_PAYLOAD_LEN, len);
+    nft_expr_end(m, elem, data);
+}
+
+static void nft_expr_cmp(struct nft_msg *m, uint32_t sreg, const void *value, size_t len)
+{
+    struct nlattr *data, *elem = nft_expr_begin(m, "cmp", &data);
+    nft_put_be32(m, NFTA_CMP_SREG, sreg);
+    nft_put_be32(m, NFTA_CMP_OP, NFT_CMP_EQ);
+    nft_put_data(m, NFTA_CMP_DATA, value, len);
+    nft_expr_end(m, elem, data);
+}
+
+static void nft_expr_mask(struct nft_msg *m, uint32_t reg, const void *mask, size_t len)
+{
+    static const uint8_t zero[16];
+    struct nlattr *data, *elem = nft_expr_begin(m, "bitwise", &data);
+    nft_put_be32(m, NFTA_BITWISE_SREG, reg);
+    nft_put_be32(m, NFTA_BITWISE_DREG, reg);
+    nft_put_be32(m, NFTA_BITWISE_LEN, (uint32_t)len);
+    nft_put_data(m, NFTA_BITWISE_MASK, mask, len);
+    nft_put_data(m, NFTA_BITWISE_XOR, zero, len);
+    nft_expr_end(m, elem, data);
+}
+
+static void nft_expr_range(struct nft_msg *m, uint32_t sreg, const void *from, const void *to,
+                           size_t len)
+{
+    struct nlattr *data, *elem = nft_expr_begin(m, "range", &data);
+    nft_put_be32(m, NFTA_RANGE_SREG, sreg);
+    nft_put_be32(m, NFTA_RANGE_OP, NFT_RANGE_EQ);
+    nft_put_data(m, NFTA_RANGE_FROM_DATA, from, len);
+    nft_put_data(m, NFTA_RANGE_TO_DATA, to, len);
+    nft_expr_end(m, elem, data);
+}
+
+static void nft_expr_verdict(struct nft_msg *m, int code, const char *chain)
+{
+    struct nlattr *data, *elem = nft_expr_begin(m, "immediate", &data);
+    nft_put_be32(m, NFTA_IMMEDIATE_DREG, NFT_REG_VERDICT);
+    nft_put_verdict(m, NFTA_IMMEDIATE_DATA, code, chain);
+    nft_expr_end(m, elem, data);
+}
+
+static void nft_expr_lookup(struct nft_msg *m, const char *set, uint32_t set_id, uint32_t sreg)
+{
+    struct nlattr *data, *elem = nft_expr_begin(m, "lookup", &data);
+    nft_put_str(m, NFTA_LOOKUP_SET, set);
+    nft_put_be32(m, NFTA_LOOKUP_SET_ID, set_id);
+    nft_put_be32(m, NFTA_LOOKUP_SREG, sreg);
+    nft_put_be32(m, NFTA_LOOKUP_DREG, NFT_REG_VERDICT);
+    nft_expr_end(m, elem, data);
+}
+
+/* Load a field of the packet into a register, from NFT_REG32_00 up */
+static void nft_expr_field(struct nft_msg *m, bool v6, int field, uint32_t reg)
+{
+    switch (field) {
+    case NFT_FIELD_SRC:
+        nft_expr_payload(m, NFT_PAYLOAD_NETWORK_HEADER, v6 ? 8 : 12, field_len[v6][field], reg);
+        break;
+    case NFT_FIELD_DST:
+        nft_expr_payload(m, NFT_PAYLOAD_NETWORK_HEADER, v6 ? 24 : 16, field_len[v6][field], reg);
+        break;
+    case NFT_FIELD_PROTOCOL:
+        nft_expr_meta(m, NFT_META_L4PROTO, reg);
+        break;
+    case NFT_FIELD_SRC_PORT:
+        nft_expr_payload(m, NFT_PAYLOAD_TRANSPORT_HEADER, 0, 2, reg);
+        break;
+    default:
+        nft_expr_payload(m, NFT_PAYLOAD_TRANSPORT_HEADER, 2, 2, reg);
+        break;
+    }
+}
+
+static void nft_expr_family(struct nft_msg *m, bool v6)
+{
+    uint8_t proto = v6 ? NFPROTO_IPV6 : NFPROTO_IPV4;
+    nft_expr_meta(m, NFT_META_NFPROTO, NFT_REG32_00);
+    nft_expr_cmp(m, NFT_REG32_00, &proto, 1);
+}
+
+/* ---- Objects ---- */
+
+static void acl_chain_name(uint32_t acl_number, char *buf, size_t size)
+{
+    snprintf(buf, size, "acl%u", acl_number);
+}
+
+static void acl_map_name(uint32_t acl_number, uint8_t generation, uint32_t map, char *buf,
+                         size_t size)
+{
+    snprintf(buf, size, "acl%u_%c%u", acl_number, generation & 1 ? 'b' : 'a', map);
+}
+
+static void put_table(struct acl_nft_batch *batch)
+{
+    struct nft_msg m;
+    if (nft_request(batch, &m, NFT_MSG_NEWTABLE, NLM_F_CREATE)) {
+        nft_put_str(&m, NFTA_TABLE_NAME, ACL_NFT_TABLE);
+        nft_msg_end(batch, &m);
+    }
+}
+
+/* Regular chain, or a base chain on a hook with accept policy */
+static void put_chain(struct acl_nft_batch *batch, const char *name, int hook)
+{
+    struct nft_msg m;
+    if (!nft_request(batch, &m, NFT_MSG_NEWCHAIN, NLM_F_CREATE)) {
+        return;
+    }
+    nft_put_str(&m, NFTA_CHAIN_TABLE, ACL_NFT_TABLE);
+    nft_put_str(&m, NFTA_CHAIN_NAME, name);
+    if (hook >= 0) {
+        struct nlattr *nest = nft_nest(&m, NFTA_CHAIN_HOOK);
+        nft_put_be32(&m, NFTA_HOOK_HOOKNUM, (uint32_t)hook);
+        nft_put_be32(&m, NFTA_HOOK_PRIORITY, NFT_FILTER_PRIORITY);
+        nft_nest_end(&m, nest);
+        nft_put_str(&m, NFTA_CHAIN_TYPE, "filter");
+        nft_put_be32(&m, NFTA_CHAIN_POLICY, NF_ACCEPT);
+    }
+    nft_msg_end(batch, &m);
+}
+
+static void put_flush(struct acl_nft_batch *batch, const char *chain)
+{
+    struct nft_msg m;
+    if (nft_request(batch, &m, NFT_MSG_DELRULE, 0)) {
+        nft_put_str(&m, NFTA_RULE_TABLE, ACL_NFT_TABLE);
+        nft_put_str(&m, NFTA_RULE_CHAIN, chain);
+        nft_msg_end(batch, &m);
+    }
+}
+
+static void put_named(struct acl_nft_batch *batch, int type, uint16_t table_attr,
+                      uint16_t name_attr, const char *name)
+{
+    struct nft_msg m;
+    if (nft_request(batch, &m, type, 0)) {
+        nft_put_str(&m, table_attr, ACL_NFT_TABLE);
+        nft_put_str(&m, name_attr, name);
+        nft_msg_end(batch, &m);
+    }
+}
+
+static void put_delete_maps(struct acl_nft_batch *batch, const struct acl_nft_state *state)
+{
+    char name[32];
+    for (uint32_t i = 0; i < state->maps; i++) {
+        acl_map_name(state->acl_number, state->generation, i, name, sizeof(name));
+        put_named(batch, NFT_MSG_DELSET, NFTA_SET_TABLE, NFTA_SET_NAME, name);
+    }
+}
+
+/* Key bytes of a group: each field padded to a 32-bit register */
+static uint32_t key_len(const struct nft_group *group)
+{
+    uint32_t len = 0;
+    for (int f = 0; f < NFT_FIELD_MAX; f++) {
+        if (group->fields & (1u << f)) {
+            len += (field_len[group->v6][f] + 3u) & ~3u;
+        }
+    }
+    return len;
+}
+
+static void key_bound(const struct nft_group *group, const struct nft_box *box, bool high,
+                      uint8_t *key)
+{
+    uint32_t off = 0;
+
+    memset(key, 0, NFT_KEY_MAX);
+    for (int f = 0; f < NFT_FIELD_MAX; f++) {
+        if (group->fields & (1u << f)) {
+            memcpy(key + off, high ? box->hi[f] : box->lo[f], field_len[group->v6][f]);
+            off += (field_len[group->v6][f] + 3u) & ~3u;
+        }
+    }
+}
+
+static void put_map(struct acl_nft_batch *batch, const struct nft_plan *plan,
+                    const struct acl_config *acl, const struct nft_group *group, const char *name,
+                    uint32_t set_id)
+{
+    struct nft_msg m;
+
+    if (nft_request(batch, &m, NFT_MSG_NEWSET, NLM_F_CREATE | NLM_F_EXCL)) {
+        nft_put_str(&m, NFTA_SET_TABLE, ACL_NFT_TABLE);
+        nft_put_str(&m, NFTA_SET_NAME, name);
+        nft_put_be32(&m, NFTA_SET_FLAGS, NFT_SET_INTERVAL | NFT_SET_MAP | NFT_SET_CONCAT);
+        nft_put_be32(&m, NFTA_SET_KEY_TYPE, 0);
+        nft_put_be32(&m, NFTA_SET_KEY_LEN, key_len(group));
+        nft_put_be32(&m, NFTA_SET_DATA_TYPE, NFT_DATA_VERDICT);
+        nft_put_be32(&m, NFTA_SET_ID, set_id);
+        struct nlattr *desc = nft_nest(&m, NFTA_SET_DESC);
+        nft_put_be32(&m, NFTA_SET_DESC_SIZE, group->count);
+        struct nlattr *concat = nft_nest(&m, NFTA_SET_DESC_CONCAT);
+        for (int f = 0; f < NFT_FIELD_MAX; f++) {
+            if (group->fields & (1u << f)) {
+                struct nlattr *elem = nft_nest(&m, NFTA_LIST_ELEM);
+                nft_put_be32(&m, NFTA_SET_FIELD_LEN, field_len[group->v6][f]);
+                nft_nest_end(&m, elem);
+            }
+        }
+        nft_nest_end(&m, concat);
+        nft_nest_end(&m, desc);
+        nft_msg_end(batch, &m);
+    }
+
+    for (uint32_t base = 0; base < group->count; base += NFT_ELEMS_PER_MSG) {
+        if (!nft_request(batch, &m, NFT_MSG_NEWSETELEM, NLM_F_CREATE | NLM_F_EXCL)) {
+            return;
+        }
+        nft_put_str(&m, NFTA_SET_ELEM_LIST_TABLE, ACL_NFT_TABLE);
+        nft_put_str(&m, NFTA_SET_ELEM_LIST_SET, name);
+        nft_put_be32(&m, NFTA_SET_ELEM_LIST_SET_ID, set_id);
+        struct nlattr *list = nft_nest(&m, NFTA_SET_ELEM_LIST_ELEMENTS);
+        for (uint32_t i = base; i < group->count && i < base + NFT_ELEMS_PER_MSG; i++) {
+            uint32_t idx = plan->members[group->first + i];
+            uint8_t key[NFT_KEY_MAX];
+            struct nlattr *elem = nft_nest(&m, NFTA_LIST_ELEM);
+            key_bound(group, &plan->boxes[idx], false, key);
+            nft_put_data(&m, NFTA_SET_ELEM_KEY, key, key_len(group));
+            key_bound(group, &plan->boxes[idx], true, key);
+            nft_put_data(&m, NFTA_SET_ELEM_KEY_END, key, key_len(group));
+            nft_put_verdict(&m, NFTA_SET_ELEM_DATA,
+                            acl->rules[idx].flags & ACL_RULE_PERMIT ? NF_ACCEPT : NF_DROP, NULL);
+            nft_nest_end(&m, elem);
+        }
+        nft_nest_end(&m, list);
+        nft_msg_end(batch, &m);
+    }
+}
+
+static struct nlattr *rule_begin(struct acl_nft_batch *batch, struct nft_msg *m, const char *chain)
+{
+    if (!nft_request(batch, m, NFT_MSG_NEWRULE, NLM_F_CREATE | NLM_F_APPEND)) {
+        return NULL;
+    }
+    nft_put_str(m, NFTA_RULE_TABLE, ACL_NFT_TABLE);
+    nft_put_str(m, NFTA_RULE_CHAIN, chain);
+    return nft_nest(m, NFTA_RULE_EXPRESSIONS);
+}
+
+static void rule_end(struct acl_nft_batch *batch, struct nft_msg *m, struct nlattr *exprs)
+{
+    nft_nest_end(m, exprs);
+    nft_msg_end(batch, m);
+}
+
+/* Lookup of the group key in its map; the map's verdict ends the chain */
+static void put_map_rule(struct acl_nft_batch *batch, const char *chain,
+                         const struct nft_group *group, const char *map, uint32_t set_id)
+{
+    struct nft_msg m;
+    struct nlattr *exprs = rule_begin(batch, &m, chain);
+    uint32_t reg = NFT_REG32_00;
+
+    if (!exprs) {
+        return;
+    }
+    nft_expr_family(&m, group->v6);
+    for (int f = 0; f < NFT_FIELD_MAX; f++) {
+        if (group->fields & (1u << f)) {
+            nft_expr_field(&m, group->v6, f, reg);
+            reg += (field_len[group->v6][f] + 3u) / 4u;
+        }
+    }
+    nft_expr_lookup(&m, map, set_id, NFT_REG32_00);
+    rule_end(batch, &m, exprs);
+}
+
+/* IPv4 rule with a discontiguous wildcard, field by field */
+static void put_standalone_rule(struct acl_nft_batch *batch, const char *chain,
+                                const struct acl_rule *rule, const struct nft_box *box)
+{
+    struct nft_msg m;
+    struct nlattr *exprs = rule_begin(batch, &m, chain);
+    const uint32_t addr[2] = { rule->v4.src, rule->v4.dst };
+    const uint32_t mask[2] = { rule->v4.src_mask, rule->v4.dst_mask };
+    uint8_t be[4];
+
+    if (!exprs) {
+        return;
+    }
+    nft_expr_family(&m, false);
+    if (!(rule->flags & ACL_RULE_ANY_PROTOCOL)) {
+        nft_expr_meta(&m, NFT_META_L4PROTO, NFT_REG32_00);
+        nft_expr_cmp(&m, NFT_REG32_00, &rule->protocol, 1);
+    }
+    for (int i = 0; i < 2; i++) {
+        if (mask[i] == 0) {
+            continue;
+        }
+        nft_expr_field(&m, false, i == 0 ? NFT_FIELD_SRC : NFT_FIELD_DST, NFT_REG32_00);
+        if (mask[i] != ~0u) {
+            put_be(be, mask[i], 4);
+            nft_expr_mask(&m, NFT_REG32_00, be, 4);
+        }
+        put_be(be, addr[i], 4);
+        nft_expr_cmp(&m, NFT_REG32_00, be, 4);
+    }
+    uint8_t fields = rule_fields(rule);
+    for (int f = NFT_FIELD_SRC_PORT; f <= NFT_FIELD_DST_PORT; f++) {
+        if (fields & (1u << f)) {
+            nft_expr_field(&m, false, f, NFT_REG32_00);
+            nft_expr_range(&m, NFT_REG32_00, box->lo[f], box->hi[f], 2);
+        }
+    }
+    nft_expr_verdict(&m, rule->flags & ACL_RULE_PERMIT ? NF_ACCEPT : NF_DROP, NULL);
+    rule_end(batch, &m, exprs);
+}
+
+/* ---- Batches ---- */
+
+struct acl_nft_batch *acl_nft_begin(void)
+{
+    struct acl_nft_batch *batch = calloc(1, sizeof(*batch));
+    struct nft_msg m;
+
+    if (!batch) {
+        return NULL;
+    }
+    pthread_mutex_lock(&nft_lock);
+    if (nft_msg_begin(batch, &m, NFNL_MSG_BATCH_BEGIN, 0, AF_UNSPEC)) {
+        ((struct nfgenmsg *)NLMSG_DATA(m.nlh))->res_id = htons(NFNL_SUBSYS_NFTABLES);
+        nft_msg_end(batch, &m);
+    }
+    put_table(batch);
+    return batch;
+}
+
+static struct nft_pending *batch_pending(struct acl_nft_batch *batch, struct acl_nft_state *state)
+{
+    struct nft_pending *pending = realloc(batch->pending,
+                                          (batch->pending_count + 1) * sizeof(*pending));
+    if (!pending) {
+        batch->error = -ENOMEM;
+        return NULL;
+    }
+    batch->pending = pending;
+    pending = &batch->pending[batch->pending_count++];
+    memset(pending, 0, sizeof(*pending));
+    pending->state = state;
+    return pending;
+}
+
+/*
+ * Replace the chain of an ACL: flush its rules, delete the maps of the
+ * last commit, then add maps under the other name suffix and the rules
+ * using them, in rule order. Returns 0 or a negative errno; the batch
+ * fails as a whole on error.
+ */
+int acl_nft_put_acl(struct acl_nft_batch *batch, struct acl_nft_state *state,
+                    const struct acl_config *acl)
+{
+    struct nft_plan plan;
+    char chain[32], map[32];
+    int ret = plan_build(acl, &plan);
+
+    if (ret < 0) {
+        batch->error = ret;
+        return ret;
+    }
+    struct nft_pending *pending = batch_pending(batch, state);
+    if (!pending) {
+        plan_free(&plan);
+        return -ENOMEM;
+    }
+    pending->generation = state->installed ? (uint8_t)(state->generation + 1) : 0;
+    pending->info = plan.info;
+
+    acl_chain_name(acl->acl_number, chain, sizeof(chain));
+    put_chain(batch, chain, -1);
+    if (state->installed) {
+        put_flush(batch, chain);
+        put_delete_maps(batch, state);
+    }
+    for (uint32_t g = 0; g < plan.group_count; g++) {
+        const struct nft_group *group = &plan.groups[g];
+        if (group->standalone) {
+            uint32_t idx = plan.members[group->first];
+            put_standalone_rule(batch, chain, &acl->rules[idx], &plan.boxes[idx]);
+            continue;
+        }
+        uint32_t set_id = ++batch->set_id;
+        acl_map_name(acl->acl_number, pending->generation, pending->maps++, map, sizeof(map));
+        put_map(batch, &plan, acl, group, map, set_id);
+        put_map_rule(batch, chain, group, map, set_id);
+    }
+    plan_free(&plan);
+    return batch->error;
+}
+
+/* Delete the chain and maps of an ACL no longer bound; jumps must be gone first */
+void acl_nft_put_remove(struct acl_nft_batch *batch, struct acl_nft_state *state)
+{
+    char chain[32];
+    struct nft_pending *pending = batch_pending(batch, state);
+
+    if (!pending || !state->installed) {
+        return;
+    }
+    pending->remove = true;
+    acl_chain_name(state->acl_number, chain, sizeof(chain));
+    put_flush(batch, chain);
+    put_delete_maps(batch, state);
+    put_named(batch, NFT_MSG_DELCHAIN, NFTA_CHAIN_TABLE, NFTA_CHAIN_NAME, chain);
+}
+
+/*
+ * Rewrite the base chains with one jump per binding whose interface is
+ * in the kernel. Must come after the chains of bound ACLs are put and
+ * before unbound ones are removed.
+ */
+void acl_nft_put_bindings(struct acl_nft_batch *batch, const struct acl_nft_binding *bindings,
+                          uint32_t count)
+{
+    static const char *const base[2] = { "filter_in", "filter_out" };
+
+    for (int dir = 0; dir < 2; dir++) {
+        put_chain(batch, base[dir], dir ? NF_INET_POST_ROUTING : NF_INET_PRE_ROUTING);
+        put_flush(batch, base[dir]);
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        const struct acl_nft_binding *b = &bindings[i];
+        int ifindex = if_kernel_index(b->ifid);
+        char chain[32];
+        struct nft_msg m;
+        struct nlattr *exprs;
+
+        if (ifindex <= 0 || !(exprs = rule_begin(batch, &m, base[b->outbound]))) {
+            continue;
+        }
+        uint32_t index = (uint32_t)ifindex;
+        acl_chain_name(b->acl_number, chain, sizeof(chain));
+        nft_expr_meta(&m, b->outbound ? NFT_META_OIF : NFT_META_IIF, NFT_REG32_00);
+        nft_expr_cmp(&m, NFT_REG32_00, &index, sizeof(index));
+        nft_expr_verdict(&m, NFT_JUMP, chain);
+        rule_end(batch, &m, exprs);
+    }
+}
+
+/* Send the batch in one sendmsg; wait for every acknowledgement or an error */
+static int batch_send(struct acl_nft_batch *batch)
+{
+    int ret = 0, size = (int)batch->len;
+    uint32_t pending = batch->acks;
+
+    setsockopt(nft_nl_fd, SOL_SOCKET, SO_SNDBUFFORCE, &size, sizeof(size));
+    if (send(nft_nl_fd, batch->buf, batch->len, 0) < 0) {
+        return -errno;
+    }
+
+    char *buf = malloc(NFT_NL_BUFFER_SIZE);
+    if (!buf) {
+        return -ENOMEM;
+    }
+    while (pending) {
+        /* After an error the kernel may not answer the rest; take what is queued */
+        ssize_t len = recv(nft_nl_fd, buf, NFT_NL_BUFFER_SIZE, ret ? MSG_DONTWAIT : 0);
+        if (len < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (ret == 0) {
+                ret = -errno;
+            }
+            break;
+        }
+        for (struct nlmsghdr *nlh = (struct nlmsghdr *)buf; NLMSG_OK(nlh, len);
+             nlh = NLMSG_NEXT(nlh, len)) {
+            if (nlh->nlmsg_type != NLMSG_ERROR || nlh->nlmsg_seq - batch->seq_first >= batch->acks) {
+                continue;
+            }
+            const struct nlmsgerr *err = NLMSG_DATA(nlh);
+            if (err->error && ret == 0) {
+                ret = err->error;
+            }
+            pending--;
+        }
+    }
+    free(buf);
+    return ret;
+}
+
+/*
+ * Send the batch and fold the result into the states it touches. Every
+ * change of the batch is applied, or none. Frees the batch. Returns 0 or
+ * a negative errno; messages is set to the messages sent.
+ */
+int acl_nft_commit(struct acl_nft_batch *batch, uint32_t *messages)
+{
+    struct nft_msg m;
+    int ret = batch->error;
+
+    if (ret == 0 && nft_msg_begin(batch, &m, NFNL_MSG_BATCH_END, 0, AF_UNSPEC)) {
+        ((struct nfgenmsg *)NLMSG_DATA(m.nlh))->res_id = htons(NFNL_SUBSYS_NFTABLES);
+        nft_msg_end(batch, &m);
+        ret = batch->error;
+    }
+    if (ret == 0 && nft_socket() < 0) {
+        ret = -errno;
+    }
+    if (ret == 0) {
+        ret = batch_send(batch);
+    }
+    if (messages) {
+        *messages = batch->acks;
+    }
+
+    for (uint32_t i = 0; i < batch->pending_count; i++) {
+        struct nft_pending *p = &batch->pending[i];
+        struct acl_nft_state *state = p->state;
+        state->error = ret;
+        if (ret < 0) {
+            continue;
+        }
+        state->installed = !p->remove;
+        state->stale = false;
+        state->generation = p->generation;
+        state->maps = p->remove ? 0 : p->maps;
+        state->info = p->info;
+    }
+    pthread_mutex_unlock(&nft_lock);
+
+    free(batch->pending);
+    free(batch->buf);
+    free(batch);
+    return ret;
+}
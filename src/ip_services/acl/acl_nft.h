@@ -0,0 +1,81 @@
+/*
+ * ACL Kernel Backend for Huawei VRP Style
+ * Copyright (C) 2026 WhiteBox NE Team
+ *
+ * Compiles ACLs into nftables. Each ACL becomes a regular chain
+ * "acl<number>" in table inet whitebox_acl; traffic-filter bindings
+ * jump to it from the base chains filter_in (prerouting) and filter_out
+ * (postrouting), matched on the kernel ifindex. A permit rule accepts,
+ * a deny rule drops, a packet no rule matches returns to the caller.
+ *
+ * Rules are grouped in ID order into verdict maps: a rule joins the
+ * current group when it does not overlap any member with a different
+ * action, or fully covers or is covered by the same-action members it
+ * overlaps (the covered rule is dropped as redundant). Within a group at
+ * most one element matches a packet, so one lookup in an interval set
+ * keyed by source . destination . protocol . ports gives the same
+ * verdict as evaluating its rules in order, and thousands of prefixes
+ * cost one O(log n) lookup. IPv4 rules with discontiguous wildcards
+ * cannot be intervals; each becomes a chain rule of its own.
+ *
+ * The map key holds the protocol and ports only when a rule of the
+ * group matches on them, and rules that match on ports are grouped
+ * apart from those that do not. Non-first fragments have no transport
+ * header, so they skip the groups keyed by ports but still meet every
+ * rule that matches any port.
+ *
+ * An update is one nfnetlink batch: rules flushed, old maps deleted,
+ * new maps filled, chains and bindings rewritten. The kernel commits it
+ * as one transaction or rejects all of it; the state changes only when
+ * it is committed.
+ */
+
+#ifndef _ACL_NFT_H
+#define _ACL_NFT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "acl_huawei.h"
+#include "../../frr_core/lib/if_registry.h"
+
+#define ACL_NFT_TABLE           "whitebox_acl"
+#define ACL_NFT_MAX_BINDINGS    256
+#define ACL_NFT_MAX_GROUPS      4096    /* Verdict maps plus standalone rules per ACL */
+
+/* traffic-filter binding of an ACL to an interface direction */
+struct acl_nft_binding {
+    ifid_t ifid;
+    bool outbound;
+    uint32_t acl_number;
+};
+
+/* Shape of the compiled chain */
+struct acl_nft_info {
+    uint32_t maps;              /* Verdict maps, one lookup rule each */
+    uint32_t elements;          /* Intervals in all maps */
+    uint32_t standalone;        /* Rules matched outside a map */
+    uint32_t redundant;         /* Rules covered by a same-action rule of their group */
+};
+
+/* Kernel state of one ACL */
+struct acl_nft_state {
+    uint32_t acl_number;
+    bool installed;             /* Chain committed */
+    bool stale;                 /* Rules changed since the last commit */
+    uint8_t generation;         /* Suffix of the map names, alternates per commit */
+    uint32_t maps;              /* Maps committed under that suffix */
+    struct acl_nft_info info;
+    int error;                  /* Last commit result, negative errno */
+};
+
+struct acl_nft_batch;
+
+struct acl_nft_batch *acl_nft_begin(void);
+int acl_nft_put_acl(struct acl_nft_batch *batch, struct acl_nft_state *state,
+                    const struct acl_config *acl);
+void acl_nft_put_remove(struct acl_nft_batch *batch, struct acl_nft_state *state);
+void acl_nft_put_bindings(struct acl_nft_batch *batch, const struct acl_nft_binding *bindings,
+                          uint32_t count);
+int acl_nft_commit(struct acl_nft_batch *batch, uint32_t *messages);
+
+#endif /* _ACL_NFT_H */
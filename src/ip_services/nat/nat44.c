@@ -9,10 +9,11 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "../../frr_core/lib/huawei_cli.h"
+#include "../../frr_core/lib/if_registry.h"
 
 struct nat_outbound_rule {
     uint32_t acl_number;
-    char interface[64];
+    ifid_t ifid;
     bool enabled;
 };
 
@@ -114,4 +115,5 @@ struct cmd_element nat_cmds[] = {
 
 void register_nat_cmds(void) {
     printf("Registering NAT commands...\n");
+    huawei_cli_register_table(nat_cmds, NULL);
 }
@@ -4,7 +4,7 @@
  *
  * This module provides traffic behavior functionality including:
  * - Remark DSCP/IP precedence
- * - Rate limiting (CAR)
+ * - Rate limiting (CAR) with single-rate and two-rate three-color policers
  * - Traffic shaping
  * - Priority marking
  * - Packet filtering
@@ -15,52 +15,45 @@
 #include <string.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <errno.h>
+#include <unistd.h>
 #include "../frr_core/lib/huawei_cli.h"
+#include "../frr_core/lib/slab.h"
+#include "../frr_core/lib/if_registry.h"
+#include "qos_behavior.h"
+#include "qos_policy.h"
 
-/* Action types */
-typedef enum {
-    ACTION_TYPE_REMARK_DSCP = 0,
-    ACTION_TYPE_REMARK_IP_PRECEDENCE,
-    ACTION_TYPE_CAR,
-    ACTION_TYPE_PRIORITY,
-    ACTION_TYPE_DENY,
-    ACTION_TYPE_REDIRECT
-} action_type_t;
-
-/* CAR (Committed Access Rate) configuration */
-struct car_config {
-    uint32_t cir;  /* Committed Information Rate (kbps) */
-    uint32_t cbs;  /* Committed Burst Size (bytes) */
-    uint32_t pir;  /* Peak Information Rate (kbps) */
-    uint32_t pbs;  /* Peak Burst Size (bytes) */
-    bool green_pass;
-    bool yellow_pass;
-    bool red_discard;
-};
+static struct slab behavior_slab = SLAB_INIT("traffic-behavior", struct traffic_behavior);
+static struct traffic_behavior *current_behavior = NULL;
 
-/* Traffic action */
-struct traffic_action {
-    action_type_t type;
-    union {
-        uint8_t dscp;
-        uint8_t ip_precedence;
-        struct car_config car;
-        uint8_t priority;
-        char redirect_interface[64];
-    } value;
-};
+struct traffic_behavior *qos_behavior_find(const char *name)
+{
+    struct traffic_behavior *behavior;
+    SLAB_FOREACH(&behavior_slab, cursor, behavior) {
+        if (strcmp(behavior->name, name) == 0) {
+            return behavior;
+        }
+    }
+    return NULL;
+}
 
-/* Traffic behavior */
-struct traffic_behavior {
-    char name[64];
-    struct traffic_action actions[8];
-    int action_count;
-    uint64_t apply_count;
-};
+/*
+ * Append an action to a behavior. Compiled programs point at the
+ * behavior and the datapath walks its actions without locks, so the
+ * slot is written in full before the count that exposes it is released.
+ */
+static int behavior_add_action(struct traffic_behavior *behavior,
+                               const struct traffic_action *action)
+{
+    int count = behavior->action_count;
 
-static struct traffic_behavior behaviors[256];
-static int behavior_count = 0;
-static struct traffic_behavior *current_behavior = NULL;
+    if (count >= QOS_BEHAVIOR_MAX_ACTIONS) {
+        return -1;
+    }
+    behavior->actions[count] = *action;
+    __atomic_store_n(&behavior->action_count, count + 1, __ATOMIC_RELEASE);
+    return 0;
+}
 
 /*
  * Create or enter traffic behavior
@@ -77,23 +70,23 @@ static int cmd_traffic_behavior(struct cmd_element *cmd, struct cmd_args *args)
     const char *name = args->argv[1];
 
     /* Find or create behavior */
-    current_behavior = NULL;
-    for (int i = 0; i < behavior_count; i++) {
-        if (strcmp(behaviors[i].name, name) == 0) {
-            current_behavior = &behaviors[i];
-            break;
+    current_behavior = qos_behavior_find(name);
+    if (!current_behavior) {
+        current_behavior = slab_alloc(&behavior_slab, NULL);
+        if (!current_behavior) {
+            printf("Error: Out of memory for behavior %s\n", name);
+            return -1;
+        }
+        current_behavior->apply_stats = pcpu_counter_alloc(1);
+        if (current_behavior->apply_stats == PCPU_COUNTER_NONE) {
+            slab_free(&behavior_slab, current_behavior);
+            current_behavior = NULL;
+            printf("Error: Out of memory for behavior %s\n", name);
+            return -1;
         }
-    }
-
-    if (!current_behavior && behavior_count < 256) {
-        current_behavior = &behaviors[behavior_count++];
-        memset(current_behavior, 0, sizeof(struct traffic_behavior));
         strncpy(current_behavior->name, name, sizeof(current_behavior->name) - 1);
-    }
-
-    if (!current_behavior) {
-        printf("Error: Maximum behaviors reached\n");
-        return -1;
+        /* Resolves rules bound to it by name */
+        qos_policy_behavior_changed(current_behavior);
     }
 
     printf("Entering traffic behavior %s configuration\n", name);
@@ -125,22 +118,59 @@ static int cmd_remark_dscp(struct cmd_element *cmd, struct cmd_args *args)
         return -1;
     }
 
-    if (current_behavior->action_count < 8) {
-        struct traffic_action *action = &current_behavior->actions[current_behavior->action_count++];
-        action->type = ACTION_TYPE_REMARK_DSCP;
-        action->value.dscp = dscp;
+    struct traffic_action action = { .type = ACTION_TYPE_REMARK_DSCP, .value.dscp = dscp };
+    if (behavior_add_action(current_behavior, &action) == 0) {
         printf("Remark DSCP %u configured\n", dscp);
     } else {
         printf("Error: Maximum actions reached\n");
         return -1;
     }
 
+    qos_policy_behavior_changed(current_behavior);
+    return 0;
+}
+
+/*
+ * Parse a CAR rate or burst: decimal digits only, within 32 bits
+ */
+static int parse_car_value(const char *str, uint32_t *value)
+{
+    char *end;
+
+    if (str[0] < '0' || str[0] > '9') {
+        return -1;
+    }
+    errno = 0;
+    unsigned long v = strtoul(str, &end, 10);
+    if (errno == ERANGE || *end != '\0' || v > UINT32_MAX) {
+        return -1;
+    }
+    *value = (uint32_t)v;
+    return 0;
+}
+
+/*
+ * Parse "pass" / "discard" after a color keyword
+ */
+static int parse_car_color_action(struct cmd_args *args, int i, bool *pass)
+{
+    if (i >= args->argc) {
+        return -1;
+    }
+    if (strcmp(args->argv[i], "pass") == 0) {
+        *pass = true;
+    } else if (strcmp(args->argv[i], "discard") == 0) {
+        *pass = false;
+    } else {
+        return -1;
+    }
     return 0;
 }
 
 /*
  * Configure CAR (Committed Access Rate)
- * Command: car cir <cir> [cbs <cbs>] [pir <pir>] [pbs <pbs>] [green pass] [yellow pass] [red discard]
+ * Command: car cir <cir> [pir <pir>] [cbs <cbs>] [pbs <pbs>] [mode {color-blind|color-aware}]
+ *          [green {pass|discard}] [yellow {pass|discard}] [red {pass|discard}]
  */
 static int cmd_car(struct cmd_element *cmd, struct cmd_args *args)
 {
@@ -149,45 +179,128 @@ static int cmd_car(struct cmd_element *cmd, struct cmd_args *args)
         return -1;
     }
 
-    if (args->argc < 2) {
+    if (args->argc < 2 || strcmp(args->argv[0], "cir") != 0) {
         printf("Error: CIR value required\n");
-        printf("Usage: car cir <cir> [cbs <cbs>] [pir <pir>] [pbs <pbs>]\n");
+        printf("Usage: car cir <cir> [pir <pir>] [cbs <cbs>] [pbs <pbs>]\n");
         return -1;
     }
 
-    if (current_behavior->action_count >= 8) {
+    if (current_behavior->action_count >= QOS_BEHAVIOR_MAX_ACTIONS) {
         printf("Error: Maximum actions reached\n");
         return -1;
     }
 
-    struct traffic_action *action = &current_behavior->actions[current_behavior->action_count++];
-    action->type = ACTION_TYPE_CAR;
-
-    /* Parse CIR */
-    action->value.car.cir = atoi(args->argv[1]);
+    struct car_config car = {
+        .green_pass = true,
+        .yellow_pass = true,
+        .red_discard = true,
+    };
+    bool has_cbs = false, has_pbs = false;
 
-    /* Default values */
-    action->value.car.cbs = action->value.car.cir * 125;  /* 1 second burst */
-    action->value.car.pir = action->value.car.cir;
-    action->value.car.pbs = action->value.car.cbs;
-    action->value.car.green_pass = true;
-    action->value.car.yellow_pass = true;
-    action->value.car.red_discard = true;
+    if (parse_car_value(args->argv[1], &car.cir) != 0) {
+        printf("Error: Invalid CIR value %s\n", args->argv[1]);
+        return -1;
+    }
+    if (car.cir == 0) {
+        printf("Error: CIR must be greater than 0\n");
+        return -1;
+    }
 
     /* Parse optional parameters */
     for (int i = 2; i < args->argc; i++) {
-        if (strcmp(args->argv[i], "cbs") == 0 && i + 1 < args->argc) {
-            action->value.car.cbs = atoi(args->argv[++i]);
-        } else if (strcmp(args->argv[i], "pir") == 0 && i + 1 < args->argc) {
-            action->value.car.pir = atoi(args->argv[++i]);
-        } else if (strcmp(args->argv[i], "pbs") == 0 && i + 1 < args->argc) {
-            action->value.car.pbs = atoi(args->argv[++i]);
+        const char *key = args->argv[i];
+        bool pass;
+
+        if (i + 1 >= args->argc) {
+            printf("Error: Value required after %s\n", key);
+            return -1;
+        }
+        if (strcmp(key, "cbs") == 0 || strcmp(key, "pir") == 0 || strcmp(key, "pbs") == 0) {
+            bool cbs = strcmp(key, "cbs") == 0, pbs = strcmp(key, "pbs") == 0;
+            uint32_t *value = cbs ? &car.cbs : pbs ? &car.pbs : &car.pir;
+            if (parse_car_value(args->argv[++i], value) != 0) {
+                printf("Error: Invalid %s value %s\n", key, args->argv[i]);
+                return -1;
+            }
+            has_cbs |= cbs;
+            has_pbs |= pbs;
+        } else if (strcmp(key, "mode") == 0) {
+            const char *mode = args->argv[++i];
+            if (strcmp(mode, "color-aware") != 0 && strcmp(mode, "color-blind") != 0) {
+                printf("Error: Mode must be color-blind or color-aware\n");
+                return -1;
+            }
+            car.color_aware = strcmp(mode, "color-aware") == 0;
+        } else if (strcmp(key, "green") == 0 || strcmp(key, "yellow") == 0 ||
+                   strcmp(key, "red") == 0) {
+            if (parse_car_color_action(args, ++i, &pass) != 0) {
+                printf("Error: Action for %s must be pass or discard\n", key);
+                return -1;
+            }
+            if (key[0] == 'g') {
+                car.green_pass = pass;
+            } else if (key[0] == 'y') {
+                car.yellow_pass = pass;
+            } else {
+                car.red_discard = !pass;
+            }
+        } else {
+            printf("Error: Unknown CAR parameter %s\n", key);
+            return -1;
         }
     }
 
-    printf("CAR configured: CIR %u kbps, CBS %u bytes\n",
-           action->value.car.cir, action->value.car.cbs);
+    if (car.pir && car.pir < car.cir) {
+        printf("Error: PIR must not be less than CIR\n");
+        return -1;
+    }
+
+    /* Default bursts: 1 second at CIR / PIR, within the policer limit */
+    if (!has_cbs) {
+        uint64_t cbs = (uint64_t)car.cir * 125;
+        car.cbs = cbs > QOS_CAR_MAX_BURST ? QOS_CAR_MAX_BURST : (uint32_t)cbs;
+    }
+    if (!has_pbs) {
+        uint64_t pbs = car.pir ? (uint64_t)car.pir * 125 : car.cbs;
+        car.pbs = pbs > QOS_CAR_MAX_BURST ? QOS_CAR_MAX_BURST : (uint32_t)pbs;
+    }
+    if (car.cbs > QOS_CAR_MAX_BURST || car.pbs > QOS_CAR_MAX_BURST) {
+        printf("Error: Burst size must not exceed %u bytes\n", QOS_CAR_MAX_BURST);
+        return -1;
+    }
+
+    struct qos_car_params params = {
+        .mode = car.pir ? QOS_CAR_TRTCM : QOS_CAR_SRTCM,
+        .cir = car.cir,
+        .cbs = car.cbs,
+        .pir = car.pir,
+        .pbs = car.pbs,
+        .color_aware = car.color_aware,
+    };
+    long cpus = sysconf(_SC_NPROCESSORS_CONF);
+    struct qos_car *policer = qos_car_create(&params, cpus > 0 ? (uint32_t)cpus : 1);
+    if (!policer) {
+        printf("Error: Out of memory for CAR policer\n");
+        return -1;
+    }
 
+    struct traffic_action action = {
+        .type = ACTION_TYPE_CAR, .value.car = car, .policer = policer,
+    };
+    if (behavior_add_action(current_behavior, &action) != 0) {
+        qos_car_destroy(policer);
+        printf("Error: Maximum actions reached\n");
+        return -1;
+    }
+
+    printf("CAR configured: CIR %u kbps, CBS %u bytes", car.cir, car.cbs);
+    if (car.pir) {
+        printf(", PIR %u kbps, PBS %u bytes\n", car.pir, car.pbs);
+    } else {
+        printf(", EBS %u bytes\n", car.pbs);
+    }
+
+    qos_policy_behavior_changed(current_behavior);
     return 0;
 }
 
@@ -214,16 +327,15 @@ static int cmd_priority(struct cmd_element *cmd, struct cmd_args *args)
         return -1;
     }
 
-    if (current_behavior->action_count < 8) {
-        struct traffic_action *action = &current_behavior->actions[current_behavior->action_count++];
-        action->type = ACTION_TYPE_PRIORITY;
-        action->value.priority = priority;
+    struct traffic_action action = { .type = ACTION_TYPE_PRIORITY, .value.priority = priority };
+    if (behavior_add_action(current_behavior, &action) == 0) {
         printf("Priority %u configured\n", priority);
     } else {
         printf("Error: Maximum actions reached\n");
         return -1;
     }
 
+    qos_policy_behavior_changed(current_behavior);
     return 0;
 }
 
@@ -238,18 +350,45 @@ static int cmd_deny(struct cmd_element *cmd, struct cmd_args *args)
         return -1;
     }
 
-    if (current_behavior->action_count < 8) {
-        struct traffic_action *action = &current_behavior->actions[current_behavior->action_count++];
-        action->type = ACTION_TYPE_DENY;
+    struct traffic_action action = { .type = ACTION_TYPE_DENY };
+    if (behavior_add_action(current_behavior, &action) == 0) {
         printf("Deny action configured\n");
     } else {
         printf("Error: Maximum actions reached\n");
         return -1;
     }
 
+    qos_policy_behavior_changed(current_behavior);
     return 0;
 }
 
+static void display_car(const struct traffic_action *action)
+{
+    const struct car_config *car = &action->value.car;
+    static const char *const names[QOS_COLOR_MAX] = { "Green", "Yellow", "Red" };
+    const bool pass[QOS_COLOR_MAX] = { car->green_pass, car->yellow_pass, !car->red_discard };
+
+    if (car->pir) {
+        printf("CAR CIR %u kbps, CBS %u bytes, PIR %u kbps, PBS %u bytes, %s\n",
+               car->cir, car->cbs, car->pir, car->pbs,
+               car->color_aware ? "color-aware" : "color-blind");
+    } else {
+        printf("CAR CIR %u kbps, CBS %u bytes, EBS %u bytes, %s\n",
+               car->cir, car->cbs, car->pbs,
+               car->color_aware ? "color-aware" : "color-blind");
+    }
+    if (!action->policer) {
+        return;
+    }
+
+    struct qos_car_stats stats;
+    qos_car_get_stats(action->policer, &stats);
+    for (int c = 0; c < QOS_COLOR_MAX; c++) {
+        printf("    %-7s %-8s %lu packets, %lu bytes\n", names[c],
+               pass[c] ? "pass" : "discard", stats.packets[c], stats.bytes[c]);
+    }
+}
+
 /*
  * Display traffic behaviors
  * Command: display traffic behavior [name]
@@ -259,39 +398,38 @@ static int cmd_display_traffic_behavior(struct cmd_element *cmd, struct cmd_args
     if (args->argc > 1) {
         /* Display specific behavior */
         const char *name = args->argv[1];
-        for (int i = 0; i < behavior_count; i++) {
-            if (strcmp(behaviors[i].name, name) == 0) {
-                printf("Traffic Behavior: %s\n", behaviors[i].name);
-                printf("  Actions: %d\n", behaviors[i].action_count);
-                printf("  Apply count: %lu\n", behaviors[i].apply_count);
-
-                for (int j = 0; j < behaviors[i].action_count; j++) {
-                    struct traffic_action *action = &behaviors[i].actions[j];
-                    printf("  Action %d: ", j + 1);
-
-                    switch (action->type) {
-                        case ACTION_TYPE_REMARK_DSCP:
-                            printf("Remark DSCP %u\n", action->value.dscp);
-                            break;
-                        case ACTION_TYPE_CAR:
-                            printf("CAR CIR %u kbps, CBS %u bytes\n",
-                                   action->value.car.cir, action->value.car.cbs);
-                            break;
-                        case ACTION_TYPE_PRIORITY:
-                            printf("Priority %u\n", action->value.priority);
-                            break;
-                        case ACTION_TYPE_DENY:
-                            printf("Deny\n");
-                            break;
-                        default:
-                            printf("Unknown\n");
-                    }
-                }
-                return 0;
+        const struct traffic_behavior *behavior = qos_behavior_find(name);
+        if (!behavior) {
+            printf("Error: Behavior %s not found\n", name);
+            return -1;
+        }
+
+        printf("Traffic Behavior: %s\n", behavior->name);
+        printf("  Actions: %d\n", behavior->action_count);
+        printf("  Apply count: %lu\n", pcpu_counter_sum(behavior->apply_stats));
+
+        for (int j = 0; j < behavior->action_count; j++) {
+            const struct traffic_action *action = &behavior->actions[j];
+            printf("  Action %d: ", j + 1);
+
+            switch (action->type) {
+                case ACTION_TYPE_REMARK_DSCP:
+                    printf("Remark DSCP %u\n", action->value.dscp);
+                    break;
+                case ACTION_TYPE_CAR:
+                    display_car(action);
+                    break;
+                case ACTION_TYPE_PRIORITY:
+                    printf("Priority %u\n", action->value.priority);
+                    break;
+                case ACTION_TYPE_DENY:
+                    printf("Deny\n");
+                    break;
+                default:
+                    printf("Unknown\n");
             }
         }
-        printf("Error: Behavior %s not found\n", name);
-        return -1;
+        return 0;
     }
 
     /* Display all behaviors */
@@ -299,34 +437,39 @@ static int cmd_display_traffic_behavior(struct cmd_element *cmd, struct cmd_args
     printf("%-20s %-10s %-15s\n", "Name", "Actions", "Apply Count");
     printf("%-20s %-10s %-15s\n", "--------------------", "----------", "---------------");
 
-    for (int i = 0; i < behavior_count; i++) {
+    const struct traffic_behavior *behavior;
+    SLAB_FOREACH(&behavior_slab, cursor, behavior) {
         printf("%-20s %-10d %-15lu\n",
-               behaviors[i].name,
-               behaviors[i].action_count,
-               behaviors[i].apply_count);
+               behavior->name,
+               behavior->action_count,
+               pcpu_counter_sum(behavior->apply_stats));
     }
 
     return 0;
 }
 
-/*
- * Initialize QoS behavior module
- */
-void qos_behavior_init(void)
-{
-    /* Register commands */
+/* Command registration */
+struct cmd_element behavior_cmds[] = {
     HUAWEI_CMD_WITH_CATEGORY("traffic behavior", cmd_traffic_behavior, NULL,
-                            "Configure traffic behavior", "QoS");
+                             "Configure traffic behavior", CMD_CAT_QOS),
     HUAWEI_CMD_WITH_CATEGORY("remark dscp", cmd_remark_dscp, NULL,
-                            "Remark DSCP value", "QoS");
+                             "Remark DSCP value", CMD_CAT_QOS),
     HUAWEI_CMD_WITH_CATEGORY("car", cmd_car, NULL,
-                            "Configure CAR", "QoS");
+                             "Configure CAR", CMD_CAT_QOS),
     HUAWEI_CMD_WITH_CATEGORY("priority", cmd_priority, NULL,
-                            "Set priority", "QoS");
+                             "Set priority", CMD_CAT_QOS),
     HUAWEI_CMD_WITH_CATEGORY("deny", cmd_deny, NULL,
-                            "Deny traffic", "QoS");
+                             "Deny traffic", CMD_CAT_QOS),
     HUAWEI_CMD_WITH_CATEGORY("display traffic behavior", cmd_display_traffic_behavior, NULL,
-                            "Display traffic behaviors", "QoS");
-}
-
+                             "Display traffic behaviors", CMD_CAT_QOS),
+    { .name = NULL }
+};
 
+/*
+ * Initialize QoS behavior module
+ */
+void qos_behavior_init(void)
+{
+    /* Register commands */
+    huawei_cli_register_table(behavior_cmds, NULL);
+}
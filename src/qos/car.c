@@ -0,0 +1,290 @@
+/*
+ * QoS CAR Policer for Huawei VRP Style
+ * Copyright (C) 2026 WhiteBox NE Team
+ *
+ * This module implements the token bucket policer including:
+ * - srTCM (RFC 2697) and trTCM (RFC 2698) marking, color-blind and
+ *   color-aware
+ * - Fixed-point tokens (QOS_CAR_SCALE fraction bits) refilled lazily
+ *   from the packet time
+ * - Per-CPU token credit borrowed from the shared buckets once per burst
+ * - Per-CPU green/yellow/red counters
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <sched.h>
+#include <time.h>
+#include "qos_car.h"
+
+/*
+ * Credit a CPU borrows beyond its immediate need, as a fraction of the
+ * bucket. Credit held by other CPUs is invisible to the shared bucket,
+ * so this bounds the extra burst all CPUs together can pass.
+ */
+#define QOS_CAR_QUANTUM_DIV 16
+
+/* kbit/s -> scaled tokens (bytes << QOS_CAR_SCALE) per ns */
+static uint64_t rate_scaled(uint64_t kbps)
+{
+    return (uint64_t)(((unsigned __int128)kbps * 125 << QOS_CAR_SCALE) / 1000000000u);
+}
+
+static uint64_t burst_scaled(uint32_t bytes)
+{
+    if (bytes > QOS_CAR_MAX_BURST) {
+        bytes = QOS_CAR_MAX_BURST;
+    }
+    return (uint64_t)bytes << QOS_CAR_SCALE;
+}
+
+struct qos_car *qos_car_create(const struct qos_car_params *params, uint32_t cpu_count)
+{
+    if (cpu_count == 0) {
+        cpu_count = 1;
+    }
+    if (cpu_count > QOS_CAR_MAX_CPUS) {
+        cpu_count = QOS_CAR_MAX_CPUS;
+    }
+
+    struct qos_car *car = calloc(1, sizeof(*car));
+    if (!car) {
+        return NULL;
+    }
+    car->cpus = aligned_alloc(QOS_CAR_CACHELINE, cpu_count * sizeof(*car->cpus));
+    if (!car->cpus) {
+        free(car);
+        return NULL;
+    }
+    memset(car->cpus, 0, cpu_count * sizeof(*car->cpus));
+    pthread_spin_init(&car->lock, PTHREAD_PROCESS_PRIVATE);
+
+    car->params = *params;
+    car->cpu_count = cpu_count;
+    car->rate_c = rate_scaled(params->cir);
+    car->rate_p = params->mode == QOS_CAR_TRTCM ? rate_scaled(params->pir) : 0;
+    car->size_c = burst_scaled(params->cbs);
+    car->size_p = burst_scaled(params->pbs);
+    car->quantum = car->size_c / (QOS_CAR_QUANTUM_DIV * cpu_count);
+
+    /* Buckets start full */
+    car->tokens_c = car->size_c;
+    car->tokens_p = car->size_p;
+    car->last_ns = qos_car_now_ns();
+    return car;
+}
+
+void qos_car_destroy(struct qos_car *car)
+{
+    if (!car) {
+        return;
+    }
+    pthread_spin_destroy(&car->lock);
+    free(car->cpus);
+    free(car);
+}
+
+/* Add elapsed * rate tokens, returning the part that did not fit */
+static uint64_t bucket_fill(uint64_t *tokens, uint64_t size, uint64_t rate, uint64_t elapsed)
+{
+    unsigned __int128 add = (unsigned __int128)elapsed * rate;
+    uint64_t room = size - *tokens;
+
+    if (add <= room) {
+        *tokens += (uint64_t)add;
+        return 0;
+    }
+    *tokens = size;
+    add -= room;
+    return add > UINT64_MAX ? UINT64_MAX : (uint64_t)add;
+}
+
+/* Lazy refill of the shared buckets, under lock */
+static void car_refill(struct qos_car *car, uint64_t now_ns)
+{
+    /* A CPU that read the clock before another one took the lock */
+    if (now_ns <= car->last_ns) {
+        return;
+    }
+    uint64_t elapsed = now_ns - car->last_ns;
+    car->last_ns = now_ns;
+
+    uint64_t spill = bucket_fill(&car->tokens_c, car->size_c, car->rate_c, elapsed);
+    if (car->params.mode == QOS_CAR_SRTCM) {
+        /* RFC 2697: tokens overflowing C go to E */
+        uint64_t room = car->size_p - car->tokens_p;
+        car->tokens_p += spill < room ? spill : room;
+    } else {
+        bucket_fill(&car->tokens_p, car->size_p, car->rate_p, elapsed);
+    }
+}
+
+static uint64_t bucket_take(uint64_t *tokens, uint64_t want)
+{
+    uint64_t got = want < *tokens ? want : *tokens;
+    *tokens -= got;
+    return got;
+}
+
+/* Time until rate earns the tokens credit is short of need */
+static uint64_t car_wait(uint64_t credit, uint64_t need, uint64_t rate)
+{
+    return rate ? (need - credit) / rate : UINT64_MAX / 2;
+}
+
+/*
+ * Top up the CPU credit to cover need scaled tokens, if the buckets allow.
+ * A bucket found dry is left alone by this CPU until the shortfall has
+ * been earned, so an overloaded policer is not a contended one. aware
+ * marks a color-aware burst, whose yellow packets spend E directly.
+ */
+static void car_borrow(struct qos_car *car, struct qos_car_cpu *pc, uint64_t now_ns,
+                       uint64_t need, bool want_c, bool want_p, bool aware)
+{
+    bool srtcm = car->params.mode == QOS_CAR_SRTCM;
+
+    pthread_spin_lock(&car->lock);
+    car_refill(car, now_ns);
+    if (want_c) {
+        pc->credit_c += bucket_take(&car->tokens_c, need - pc->credit_c + car->quantum);
+        if (pc->credit_c < need) {
+            pc->retry_c_ns = now_ns + car_wait(pc->credit_c, need, car->rate_c);
+        }
+    }
+    /*
+     * Color-blind srTCM only spends E on what C cannot cover; trTCM spends
+     * P on every pass, color-aware srTCM on every pre-colored yellow
+     */
+    if (want_p && (!srtcm || aware || pc->credit_c < need) && pc->credit_p < need) {
+        pc->credit_p += bucket_take(&car->tokens_p, need - pc->credit_p + car->quantum);
+        if (pc->credit_p < need) {
+            /* E only earns what overflows C */
+            pc->retry_p_ns = now_ns + car_wait(pc->credit_p, need, srtcm ? car->rate_c : car->rate_p);
+        }
+    }
+    pthread_spin_unlock(&car->lock);
+}
+
+/* Color one packet from the CPU credit */
+static inline qos_color_t car_mark(const struct qos_car *car, struct qos_car_cpu *pc,
+                                   uint64_t length, qos_color_t in_color)
+{
+    uint64_t tokens = length << QOS_CAR_SCALE;
+
+    if (car->params.mode == QOS_CAR_SRTCM) {
+        if (in_color == QOS_COLOR_GREEN && pc->credit_c >= tokens) {
+            pc->credit_c -= tokens;
+            return QOS_COLOR_GREEN;
+        }
+        if (in_color != QOS_COLOR_RED && pc->credit_p >= tokens) {
+            pc->credit_p -= tokens;
+            return QOS_COLOR_YELLOW;
+        }
+        return QOS_COLOR_RED;
+    }
+
+    if (in_color == QOS_COLOR_RED || pc->credit_p < tokens) {
+        return QOS_COLOR_RED;
+    }
+    if (in_color == QOS_COLOR_YELLOW || pc->credit_c < tokens) {
+        pc->credit_p -= tokens;
+        return QOS_COLOR_YELLOW;
+    }
+    pc->credit_c -= tokens;
+    pc->credit_p -= tokens;
+    return QOS_COLOR_GREEN;
+}
+
+/*
+ * Color a burst of packets received on one CPU at now_ns. in_colors is
+ * only read in color-aware mode and may be NULL otherwise.
+ */
+void qos_car_color_burst(struct qos_car *car, uint32_t cpu, uint64_t now_ns,
+                         const uint16_t *lengths, const uint8_t *in_colors,
+                         uint8_t *out_colors, uint32_t count)
+{
+    struct qos_car_cpu *pc = &car->cpus[cpu < car->cpu_count ? cpu : cpu % car->cpu_count];
+    bool aware = car->params.color_aware && in_colors;
+    uint64_t need = 0;
+
+    for (uint32_t i = 0; i < count; i++) {
+        need += lengths[i];
+    }
+    need <<= QOS_CAR_SCALE;
+    bool want_c = pc->credit_c < need && now_ns >= pc->retry_c_ns;
+    bool want_p = pc->credit_p < need && now_ns >= pc->retry_p_ns &&
+                  (car->params.mode == QOS_CAR_TRTCM || aware || pc->credit_c < need);
+    if (want_c || want_p) {
+        car_borrow(car, pc, now_ns, need, want_c, want_p, aware);
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        qos_color_t in = aware && in_colors[i] < QOS_COLOR_MAX ? in_colors[i] : QOS_COLOR_GREEN;
+        qos_color_t color = car_mark(car, pc, lengths[i], in);
+        out_colors[i] = (uint8_t)color;
+        pc->packets[color]++;
+        pc->bytes[color] += lengths[i];
+    }
+}
+
+/* Color a single packet */
+qos_color_t qos_car_color(struct qos_car *car, uint32_t cpu, uint64_t now_ns,
+                          uint32_t length, qos_color_t in_color)
+{
+    uint16_t len = length > UINT16_MAX ? UINT16_MAX : (uint16_t)length;
+    uint8_t in = (uint8_t)in_color;
+    uint8_t out;
+
+    qos_car_color_burst(car, cpu, now_ns, &len, &in, &out, 1);
+    return (qos_color_t)out;
+}
+
+/*
+ * Return the unused credit of every CPU to the shared buckets. Only safe
+ * while no CPU is coloring, e.g. after reconfiguration or in tests.
+ */
+void qos_car_reconcile(struct qos_car *car)
+{
+    pthread_spin_lock(&car->lock);
+    for (uint32_t i = 0; i < car->cpu_count; i++) {
+        struct qos_car_cpu *pc = &car->cpus[i];
+        uint64_t room_c = car->size_c - car->tokens_c;
+        uint64_t room_p = car->size_p - car->tokens_p;
+
+        car->tokens_c += pc->credit_c < room_c ? pc->credit_c : room_c;
+        car->tokens_p += pc->credit_p < room_p ? pc->credit_p : room_p;
+        pc->credit_c = 0;
+        pc->credit_p = 0;
+    }
+    pthread_spin_unlock(&car->lock);
+}
+
+/* Sum of the per-CPU counters; concurrent updates may be missed by one */
+void qos_car_get_stats(const struct qos_car *car, struct qos_car_stats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    for (uint32_t i = 0; i < car->cpu_count; i++) {
+        for (int c = 0; c < QOS_COLOR_MAX; c++) {
+            stats->packets[c] += car->cpus[i].packets[c];
+            stats->bytes[c] += car->cpus[i].bytes[c];
+        }
+    }
+}
+
+uint64_t qos_car_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* Per-CPU slot of the calling thread */
+uint32_t qos_car_cpu(const struct qos_car *car)
+{
+    int cpu = sched_getcpu();
+    return cpu < 0 ? 0 : (uint32_t)cpu % car->cpu_count;
+}
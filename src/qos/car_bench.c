@@ -0,0 +1,307 @@
+/*
+ * QoS CAR Policer Benchmark for Huawei VRP Style
+ * Copyright (C) 2026 WhiteBox NE Team
+ *
+ * This program measures the CAR policer including:
+ * - Marking accuracy against the configured rates on a simulated clock,
+ *   1 Gbit/s to 40 Gbit/s, traffic spread over several CPUs
+ * - Color-aware srTCM and trTCM on pre-colored traffic: rates against
+ *   the offered colors, and no packet promoted to a better color
+ * - Packets per second per core on the real clock, by burst size
+ * - Lock sharing when several threads color through one policer
+ *
+ * Usage: car_bench [-n packets] [-t threads] [-c simulated_cpus]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "qos_car.h"
+
+#define BENCH_BURST_MAX     64
+
+static double now_sec(void)
+{
+    return qos_car_now_ns() / 1e9;
+}
+
+/* IMIX-like packet length */
+static uint16_t random_length(void)
+{
+    int r = rand() % 12;
+    return r < 7 ? 64 : r < 11 ? 576 : 1500;
+}
+
+/*
+ * Offer load_pct percent of the CIR for one simulated second, bursts of
+ * 32 packets handed to the CPUs in turn, and compare the marked rates
+ * with the configured ones.
+ */
+static void accuracy_run(qos_car_mode_t mode, uint64_t cir_kbps, int load_pct, uint32_t cpus)
+{
+    struct qos_car_params params = {
+        .mode = mode,
+        .cir = cir_kbps,
+        .cbs = (uint32_t)(cir_kbps * 125 / 100),    /* 10 ms of CIR */
+        .pir = cir_kbps * 3 / 2,
+        .pbs = (uint32_t)(cir_kbps * 125 / 100),
+    };
+    struct qos_car *car = qos_car_create(&params, cpus);
+    if (!car) {
+        fprintf(stderr, "Error: Out of memory\n");
+        exit(1);
+    }
+
+    uint64_t start = car->last_ns;
+    uint64_t duration = 1000000000ull;
+    double offered_bps = cir_kbps * 1000.0 * load_pct / 100;
+    uint16_t lengths[32];
+    uint8_t colors[32];
+    uint64_t offered = 0;
+    uint32_t cpu = 0;
+
+    srand(1);
+    for (double t = 0; t < duration; ) {
+        uint32_t bytes = 0;
+        for (int i = 0; i < 32; i++) {
+            lengths[i] = random_length();
+            bytes += lengths[i];
+        }
+        qos_car_color_burst(car, cpu, start + (uint64_t)t, lengths, NULL, colors, 32);
+        offered += bytes;
+        cpu = (cpu + 1) % cpus;
+        t += bytes * 8 / offered_bps * 1e9;
+    }
+    qos_car_reconcile(car);
+
+    struct qos_car_stats stats;
+    qos_car_get_stats(car, &stats);
+    double secs = duration / 1e9;
+    double green = stats.bytes[QOS_COLOR_GREEN] * 8 / secs / 1e6;
+    double passed = (stats.bytes[QOS_COLOR_GREEN] + stats.bytes[QOS_COLOR_YELLOW]) * 8 / secs / 1e6;
+    double cir = cir_kbps / 1e3;
+
+    /* Expected: the rate plus one bucket of initial credit */
+    double expect_green = cir + params.cbs * 8 / secs / 1e6;
+    double expect_pass = mode == QOS_CAR_TRTCM ? params.pir / 1e3 + params.pbs * 8 / secs / 1e6 :
+                         expect_green + params.pbs * 8 / secs / 1e6;
+    if (expect_green > offered * 8 / secs / 1e6) {
+        expect_green = offered * 8 / secs / 1e6;
+    }
+    if (expect_pass > offered * 8 / secs / 1e6) {
+        expect_pass = offered * 8 / secs / 1e6;
+    }
+
+    printf("%-6s %10.0f %6d%% %5u %12.1f %9.3f%% %12.1f %9.3f%%\n",
+           mode == QOS_CAR_TRTCM ? "trTCM" : "srTCM", cir, load_pct, cpus,
+           green, (green - expect_green) / expect_green * 100,
+           passed, (passed - expect_pass) / expect_pass * 100);
+    qos_car_destroy(car);
+}
+
+/*
+ * Color-aware run: load_pct percent of the CIR, packets pre-colored 50%
+ * green, 30% yellow and 20% red. Green is bounded by the CIR and the
+ * offered green, pass by the tokens (CIR for srTCM, PIR for trTCM) and
+ * the offered green and yellow; a packet never leaves with a better color
+ * than it came with. Under trTCM overload green also competes with yellow
+ * for P, so it may stay below its bound.
+ */
+static void aware_run(qos_car_mode_t mode, uint64_t cir_kbps, int load_pct, uint32_t cpus)
+{
+    struct qos_car_params params = {
+        .mode = mode,
+        .cir = cir_kbps,
+        .cbs = (uint32_t)(cir_kbps * 125 / 100),
+        .pir = cir_kbps * 3 / 2,
+        .pbs = (uint32_t)(cir_kbps * 125 / 100),
+        .color_aware = true,
+    };
+    struct qos_car *car = qos_car_create(&params, cpus);
+    if (!car) {
+        fprintf(stderr, "Error: Out of memory\n");
+        exit(1);
+    }
+
+    uint64_t start = car->last_ns;
+    uint64_t duration = 1000000000ull;
+    double offered_bps = cir_kbps * 1000.0 * load_pct / 100;
+    uint16_t lengths[32];
+    uint8_t in[32], out[32];
+    uint64_t offered[QOS_COLOR_MAX] = { 0 };
+    uint64_t promoted = 0;
+    uint32_t cpu = 0;
+
+    srand(1);
+    for (double t = 0; t < duration; ) {
+        uint32_t bytes = 0;
+        for (int i = 0; i < 32; i++) {
+            int r = rand() % 10;
+            lengths[i] = random_length();
+            in[i] = r < 5 ? QOS_COLOR_GREEN : r < 8 ? QOS_COLOR_YELLOW : QOS_COLOR_RED;
+            offered[in[i]] += lengths[i];
+            bytes += lengths[i];
+        }
+        qos_car_color_burst(car, cpu, start + (uint64_t)t, lengths, in, out, 32);
+        for (int i = 0; i < 32; i++) {
+            promoted += out[i] < in[i];
+        }
+        cpu = (cpu + 1) % cpus;
+        t += bytes * 8 / offered_bps * 1e9;
+    }
+    qos_car_reconcile(car);
+
+    struct qos_car_stats stats;
+    qos_car_get_stats(car, &stats);
+    double secs = duration / 1e9;
+    double green = stats.bytes[QOS_COLOR_GREEN] * 8 / secs / 1e6;
+    double passed = (stats.bytes[QOS_COLOR_GREEN] + stats.bytes[QOS_COLOR_YELLOW]) * 8 / secs / 1e6;
+    double offered_green = offered[QOS_COLOR_GREEN] * 8 / secs / 1e6;
+    double offered_pass = offered_green + offered[QOS_COLOR_YELLOW] * 8 / secs / 1e6;
+
+    double expect_green = cir_kbps / 1e3 + params.cbs * 8 / secs / 1e6;
+    double expect_pass = (mode == QOS_CAR_TRTCM ? params.pir : cir_kbps) / 1e3 +
+                         (mode == QOS_CAR_TRTCM ? 0 : params.cbs * 8 / secs / 1e6) +
+                         params.pbs * 8 / secs / 1e6;
+    if (expect_green > offered_green) {
+        expect_green = offered_green;
+    }
+    if (expect_pass > offered_pass) {
+        expect_pass = offered_pass;
+    }
+
+    printf("%-6s %10.0f %6d%% %5u %12.1f %9.3f%% %12.1f %9.3f%% %9lu\n",
+           mode == QOS_CAR_TRTCM ? "trTCM" : "srTCM", cir_kbps / 1e3, load_pct, cpus,
+           green, (green - expect_green) / expect_green * 100,
+           passed, (passed - expect_pass) / expect_pass * 100, (unsigned long)promoted);
+    qos_car_destroy(car);
+}
+
+struct thread_arg {
+    struct qos_car *car;
+    uint32_t cpu;
+    uint32_t burst;
+    long packets;
+};
+
+static void *throughput_thread(void *data)
+{
+    struct thread_arg *arg = data;
+    uint16_t lengths[BENCH_BURST_MAX];
+    uint8_t colors[BENCH_BURST_MAX];
+
+    for (uint32_t i = 0; i < arg->burst; i++) {
+        lengths[i] = (uint16_t)(64 + (i * 97) % 1437);
+    }
+    for (long n = 0; n < arg->packets; n += arg->burst) {
+        qos_car_color_burst(arg->car, arg->cpu, qos_car_now_ns(), lengths, NULL, colors,
+                            arg->burst);
+    }
+    return NULL;
+}
+
+/* Real clock, 10 Gbit/s trTCM, offered as fast as the threads can */
+static void throughput_run(uint32_t burst, int threads, long packets)
+{
+    struct qos_car_params params = {
+        .mode = QOS_CAR_TRTCM,
+        .cir = 10000000,
+        .cbs = 12500000,
+        .pir = 15000000,
+        .pbs = 18750000,
+    };
+    struct qos_car *car = qos_car_create(&params, (uint32_t)threads);
+    pthread_t tids[QOS_CAR_MAX_CPUS];
+    struct thread_arg args[QOS_CAR_MAX_CPUS];
+
+    if (!car) {
+        fprintf(stderr, "Error: Out of memory\n");
+        exit(1);
+    }
+
+    double start = now_sec();
+    for (int i = 0; i < threads; i++) {
+        args[i] = (struct thread_arg){ car, (uint32_t)i, burst, packets / threads };
+        pthread_create(&tids[i], NULL, throughput_thread, &args[i]);
+    }
+    for (int i = 0; i < threads; i++) {
+        pthread_join(tids[i], NULL);
+    }
+    double elapsed = now_sec() - start;
+
+    struct qos_car_stats stats;
+    qos_car_get_stats(car, &stats);
+    uint64_t total = stats.packets[0] + stats.packets[1] + stats.packets[2];
+    printf("%-6u %8d %14.2f %14.2f %9.1f %9.1f %9.1f\n", burst, threads,
+           total / elapsed / 1e6, total / elapsed / 1e6 / threads, elapsed * 1e9 / total,
+           100.0 * stats.packets[QOS_COLOR_GREEN] / total,
+           100.0 * stats.packets[QOS_COLOR_RED] / total);
+    qos_car_destroy(car);
+}
+
+int main(int argc, char *argv[])
+{
+    long packets = 20000000;
+    int threads = 1;
+    uint32_t cpus = 4;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:t:c:")) != -1) {
+        switch (opt) {
+        case 'n':
+            packets = atol(optarg);
+            break;
+        case 't':
+            threads = atoi(optarg);
+            break;
+        case 'c':
+            cpus = (uint32_t)atoi(optarg);
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-n packets] [-t threads] [-c simulated_cpus]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (threads < 1 || threads > QOS_CAR_MAX_CPUS || cpus < 1 || cpus > QOS_CAR_MAX_CPUS) {
+        fprintf(stderr, "Error: threads and CPUs must be 1-%d\n", QOS_CAR_MAX_CPUS);
+        return 1;
+    }
+
+    printf("CAR accuracy: 1 simulated second, IMIX bursts of 32, CBS = PBS = 10 ms\n\n");
+    printf("%-6s %10s %7s %5s %12s %10s %12s %10s\n", "Mode", "CIR Mbps", "Load",
+           "CPUs", "Green Mbps", "Error", "Pass Mbps", "Error");
+    uint64_t rates[] = { 1000000, 10000000, 40000000 };
+    for (int m = 0; m < 2; m++) {
+        for (int r = 0; r < 3; r++) {
+            accuracy_run(m ? QOS_CAR_TRTCM : QOS_CAR_SRTCM, rates[r], 200, 1);
+            accuracy_run(m ? QOS_CAR_TRTCM : QOS_CAR_SRTCM, rates[r], 200, cpus);
+        }
+    }
+    accuracy_run(QOS_CAR_TRTCM, 10000000, 80, cpus);
+    accuracy_run(QOS_CAR_TRTCM, 10000000, 130, cpus);
+
+    printf("\nCAR color-aware: offered 50%% green, 30%% yellow, 20%% red\n\n");
+    printf("%-6s %10s %7s %5s %12s %10s %12s %10s %9s\n", "Mode", "CIR Mbps", "Load",
+           "CPUs", "Green Mbps", "vs Bound", "Pass Mbps", "vs Bound", "Promoted");
+    for (int m = 0; m < 2; m++) {
+        aware_run(m ? QOS_CAR_TRTCM : QOS_CAR_SRTCM, 10000000, 100, 1);
+        aware_run(m ? QOS_CAR_TRTCM : QOS_CAR_SRTCM, 10000000, 100, cpus);
+        aware_run(m ? QOS_CAR_TRTCM : QOS_CAR_SRTCM, 10000000, 300, cpus);
+    }
+
+    printf("\nCAR throughput: %ld packets, trTCM 10 Gbit/s, real clock\n\n", packets);
+    printf("%-6s %8s %14s %14s %9s %9s %9s\n", "Burst", "Threads", "Total Mpps",
+           "Mpps/thread", "ns/pkt", "Green %", "Red %");
+    uint32_t bursts[] = { 1, 8, 32, 64 };
+    for (int b = 0; b < 4; b++) {
+        throughput_run(bursts[b], 1, packets);
+    }
+    if (threads > 1) {
+        throughput_run(32, threads, packets);
+    }
+    return 0;
+}
@@ -8,6 +8,7 @@
  * - 5-tuple matching (src/dst IP, src/dst port, protocol)
  * - Interface matching
  * - Packet length matching
+ * - Recompilation of only the policies using an edited classifier
  */
 
 #include <stdio.h>
@@ -16,50 +17,124 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "../frr_core/lib/huawei_cli.h"
+#include "../frr_core/lib/slab.h"
+#include "../frr_core/lib/if_registry.h"
+#include "qos_classifier.h"
+#include "qos_policy.h"
 
-/* Match types */
-typedef enum {
-    MATCH_TYPE_ACL = 0,
-    MATCH_TYPE_DSCP,
-    MATCH_TYPE_IP_PRECEDENCE,
-    MATCH_TYPE_SOURCE_IP,
-    MATCH_TYPE_DEST_IP,
-    MATCH_TYPE_SOURCE_PORT,
-    MATCH_TYPE_DEST_PORT,
-    MATCH_TYPE_PROTOCOL,
-    MATCH_TYPE_INTERFACE,
-    MATCH_TYPE_PACKET_LENGTH
-} match_type_t;
-
-/* Match condition */
-struct match_condition {
-    match_type_t type;
-    union {
-        uint16_t acl_number;
-        uint8_t dscp;
-        uint8_t ip_precedence;
-        char ip_address[64];
-        uint16_t port;
-        uint8_t protocol;
-        char interface[64];
-        struct {
-            uint16_t min;
-            uint16_t max;
-        } packet_length;
-    } value;
-};
+static struct slab classifier_slab = SLAB_INIT("traffic-classifier", struct traffic_classifier);
+static struct traffic_classifier *current_classifier = NULL;
 
-/* Traffic classifier */
-struct traffic_classifier {
-    char name[64];
-    struct match_condition conditions[16];
-    int condition_count;
-    uint64_t match_count;
-};
+/* Evaluator for if-match acl conditions, used by the policy programs */
+static qos_cls_acl_fn classifier_acl_match = NULL;
+static void *classifier_acl_ctx = NULL;
 
-static struct traffic_classifier classifiers[256];
-static int classifier_count = 0;
-static struct traffic_classifier *current_classifier = NULL;
+static struct traffic_classifier *classifier_find(const char *name)
+{
+    struct traffic_classifier *classifier;
+    SLAB_FOREACH(&classifier_slab, cursor, classifier) {
+        if (strcmp(classifier->name, name) == 0) {
+            return classifier;
+        }
+    }
+    return NULL;
+}
+
+struct traffic_classifier *qos_classifier_find(const char *name)
+{
+    return classifier_find(name);
+}
+
+/* Evaluator for if-match acl conditions; recompiles every applied policy */
+void qos_classifier_set_acl_hook(qos_cls_acl_fn acl_match, void *acl_ctx)
+{
+    classifier_acl_match = acl_match;
+    classifier_acl_ctx = acl_ctx;
+    qos_policy_refresh();
+}
+
+qos_cls_acl_fn qos_classifier_acl_hook(void **acl_ctx)
+{
+    *acl_ctx = classifier_acl_ctx;
+    return classifier_acl_match;
+}
+
+/* Append a condition to the current classifier */
+static struct match_condition *classifier_add_condition(match_type_t type)
+{
+    if (!current_classifier) {
+        printf("Error: No classifier configured\n");
+        return NULL;
+    }
+
+    if (current_classifier->condition_count >= QOS_CLASSIFIER_MAX_CONDITIONS) {
+        printf("Error: Maximum match conditions reached\n");
+        return NULL;
+    }
+
+    struct match_condition *cond = &current_classifier->conditions[current_classifier->condition_count++];
+    memset(cond, 0, sizeof(*cond));
+    cond->type = type;
+    return cond;
+}
+
+/* Parse "<ip>[/<len>]" or "<ip> <mask>" into a host-order prefix */
+static int parse_ip_prefix(const char *ip, const char *mask, uint32_t *addr, uint8_t *prefix_len)
+{
+    unsigned int a, b, c, d, len = 32;
+    char tail;
+
+    int n = sscanf(ip, "%u.%u.%u.%u/%u%c", &a, &b, &c, &d, &len, &tail);
+    if ((n != 4 && n != 5) || a > 255 || b > 255 || c > 255 || d > 255 || len > 32) {
+        return -1;
+    }
+
+    if (n == 4 && mask) {
+        unsigned int m[4];
+        if (sscanf(mask, "%u.%u.%u.%u%c", &m[0], &m[1], &m[2], &m[3], &tail) != 4 ||
+            m[0] > 255 || m[1] > 255 || m[2] > 255 || m[3] > 255) {
+            return -1;
+        }
+        uint32_t bits = (m[0] << 24) | (m[1] << 16) | (m[2] << 8) | m[3];
+        len = (uint32_t)__builtin_popcount(bits);
+        if (bits != (len ? ~0u << (32 - len) : 0)) {
+            return -1;
+        }
+    }
+
+    *addr = (a << 24) | (b << 16) | (c << 8) | d;
+    *prefix_len = (uint8_t)len;
+    return 0;
+}
+
+/* Parse "<min> [to <max>]" from argv[first] */
+static int parse_range(struct cmd_args *args, int first, uint32_t limit, uint16_t *min, uint16_t *max)
+{
+    char *end;
+    unsigned long lo = strtoul(args->argv[first], &end, 10);
+    if (*end != '\0' || lo > limit) {
+        return -1;
+    }
+
+    unsigned long hi = lo;
+    if (args->argc > first + 2 && strcmp(args->argv[first + 1], "to") == 0) {
+        hi = strtoul(args->argv[first + 2], &end, 10);
+        if (*end != '\0' || hi > limit || hi < lo) {
+            return -1;
+        }
+    }
+
+    *min = (uint16_t)lo;
+    *max = (uint16_t)hi;
+    return 0;
+}
+
+static void format_prefix(const struct match_condition *cond, char *buf, size_t size)
+{
+    uint32_t a = cond->value.ip.addr;
+    snprintf(buf, size, "%u.%u.%u.%u/%u", a >> 24, (a >> 16) & 0xff, (a >> 8) & 0xff,
+             a & 0xff, cond->value.ip.prefix_len);
+}
 
 /*
  * Create or enter traffic classifier
@@ -74,25 +149,47 @@ static int cmd_traffic_classifier(struct cmd_element *cmd, struct cmd_args *args
     }
 
     const char *name = args->argv[1];
-
-    /* Find or create classifier */
-    current_classifier = NULL;
-    for (int i = 0; i < classifier_count; i++) {
-        if (strcmp(classifiers[i].name, name) == 0) {
-            current_classifier = &classifiers[i];
-            break;
+    int operator = -1;
+    bool changed = false;
+
+    if (args->argc > 3 && strcmp(args->argv[2], "operator") == 0) {
+        if (strcmp(args->argv[3], "and") == 0) {
+            operator = CLASSIFIER_OPERATOR_AND;
+        } else if (strcmp(args->argv[3], "or") == 0) {
+            operator = CLASSIFIER_OPERATOR_OR;
+        } else {
+            printf("Error: Operator must be 'and' or 'or'\n");
+            return -1;
         }
     }
 
-    if (!current_classifier && classifier_count < 256) {
-        current_classifier = &classifiers[classifier_count++];
-        memset(current_classifier, 0, sizeof(struct traffic_classifier));
+    /* Find or create classifier */
+    current_classifier = classifier_find(name);
+    if (!current_classifier) {
+        current_classifier = slab_alloc(&classifier_slab, NULL);
+        if (!current_classifier) {
+            printf("Error: Out of memory for classifier %s\n", name);
+            return -1;
+        }
+        current_classifier->match_stats = pcpu_counter_alloc(1);
+        if (current_classifier->match_stats == PCPU_COUNTER_NONE) {
+            slab_free(&classifier_slab, current_classifier);
+            current_classifier = NULL;
+            printf("Error: Out of memory for classifier %s\n", name);
+            return -1;
+        }
         strncpy(current_classifier->name, name, sizeof(current_classifier->name) - 1);
+        current_classifier->operator = CLASSIFIER_OPERATOR_OR;
+        changed = true;
     }
 
-    if (!current_classifier) {
-        printf("Error: Maximum classifiers reached\n");
-        return -1;
+    if (operator >= 0 && current_classifier->operator != (classifier_operator_t)operator) {
+        current_classifier->operator = operator;
+        changed = true;
+    }
+    if (changed) {
+        /* A new classifier resolves rules bound to it by name */
+        qos_policy_classifier_changed(current_classifier);
     }
 
     printf("Entering traffic classifier %s configuration\n", name);
@@ -107,11 +204,6 @@ static int cmd_traffic_classifier(struct cmd_element *cmd, struct cmd_args *args
  */
 static int cmd_if_match_acl(struct cmd_element *cmd, struct cmd_args *args)
 {
-    if (!current_classifier) {
-        printf("Error: No classifier configured\n");
-        return -1;
-    }
-
     if (args->argc < 2) {
         printf("Error: ACL number required\n");
         printf("Usage: if-match acl <acl-number>\n");
@@ -124,16 +216,14 @@ static int cmd_if_match_acl(struct cmd_element *cmd, struct cmd_args *args)
         return -1;
     }
 
-    if (current_classifier->condition_count < 16) {
-        struct match_condition *cond = &current_classifier->conditions[current_classifier->condition_count++];
-        cond->type = MATCH_TYPE_ACL;
-        cond->value.acl_number = acl_num;
-        printf("Match ACL %u configured\n", acl_num);
-    } else {
-        printf("Error: Maximum match conditions reached\n");
+    struct match_condition *cond = classifier_add_condition(MATCH_TYPE_ACL);
+    if (!cond) {
         return -1;
     }
+    cond->value.acl_number = acl_num;
+    printf("Match ACL %u configured\n", acl_num);
 
+    qos_policy_classifier_changed(current_classifier);
     return 0;
 }
 
@@ -143,93 +233,249 @@ static int cmd_if_match_acl(struct cmd_element *cmd, struct cmd_args *args)
  */
 static int cmd_if_match_dscp(struct cmd_element *cmd, struct cmd_args *args)
 {
-    if (!current_classifier) {
-        printf("Error: No classifier configured\n");
-        return -1;
-    }
-
     if (args->argc < 2) {
         printf("Error: DSCP value required\n");
         printf("Usage: if-match dscp <dscp-value>\n");
         return -1;
     }
 
-    uint8_t dscp = atoi(args->argv[1]);
-    if (dscp > 63) {
+    int dscp = atoi(args->argv[1]);
+    if (dscp < 0 || dscp > 63) {
         printf("Error: DSCP value must be 0-63\n");
         return -1;
     }
 
-    if (current_classifier->condition_count < 16) {
-        struct match_condition *cond = &current_classifier->conditions[current_classifier->condition_count++];
-        cond->type = MATCH_TYPE_DSCP;
-        cond->value.dscp = dscp;
-        printf("Match DSCP %u configured\n", dscp);
-    } else {
-        printf("Error: Maximum match conditions reached\n");
+    struct match_condition *cond = classifier_add_condition(MATCH_TYPE_DSCP);
+    if (!cond) {
         return -1;
     }
+    cond->value.dscp = (uint8_t)dscp;
+    printf("Match DSCP %d configured\n", dscp);
 
+    qos_policy_classifier_changed(current_classifier);
     return 0;
 }
 
 /*
- * Match source IP address
- * Command: if-match ip-address source <ip-address>
+ * Match IP precedence
+ * Command: if-match ip-precedence <precedence-value>
  */
-static int cmd_if_match_source_ip(struct cmd_element *cmd, struct cmd_args *args)
+static int cmd_if_match_ip_precedence(struct cmd_element *cmd, struct cmd_args *args)
 {
-    if (!current_classifier) {
-        printf("Error: No classifier configured\n");
+    if (args->argc < 2) {
+        printf("Error: IP precedence value required\n");
+        printf("Usage: if-match ip-precedence <precedence-value>\n");
+        return -1;
+    }
+
+    int precedence = atoi(args->argv[1]);
+    if (precedence < 0 || precedence > 7) {
+        printf("Error: IP precedence value must be 0-7\n");
+        return -1;
+    }
+
+    struct match_condition *cond = classifier_add_condition(MATCH_TYPE_IP_PRECEDENCE);
+    if (!cond) {
         return -1;
     }
+    cond->value.ip_precedence = (uint8_t)precedence;
+    printf("Match IP precedence %d configured\n", precedence);
+
+    qos_policy_classifier_changed(current_classifier);
+    return 0;
+}
 
+/*
+ * Match source IP address
+ * Command: if-match ip-address source <ip-address>[/<mask-length>] [<mask>]
+ */
+static int cmd_if_match_source_ip(struct cmd_element *cmd, struct cmd_args *args)
+{
     if (args->argc < 3) {
         printf("Error: IP address required\n");
-        printf("Usage: if-match ip-address source <ip-address>\n");
+        printf("Usage: if-match ip-address source <ip-address>[/<mask-length>] [<mask>]\n");
         return -1;
     }
 
-    if (current_classifier->condition_count < 16) {
-        struct match_condition *cond = &current_classifier->conditions[current_classifier->condition_count++];
-        cond->type = MATCH_TYPE_SOURCE_IP;
-        strncpy(cond->value.ip_address, args->argv[2], sizeof(cond->value.ip_address) - 1);
-        printf("Match source IP %s configured\n", args->argv[2]);
-    } else {
-        printf("Error: Maximum match conditions reached\n");
+    uint32_t addr;
+    uint8_t prefix_len;
+    if (parse_ip_prefix(args->argv[2], args->argc > 3 ? args->argv[3] : NULL,
+                        &addr, &prefix_len) != 0) {
+        printf("Error: Invalid IP address %s\n", args->argv[2]);
         return -1;
     }
 
+    struct match_condition *cond = classifier_add_condition(MATCH_TYPE_SOURCE_IP);
+    if (!cond) {
+        return -1;
+    }
+    cond->value.ip.addr = addr;
+    cond->value.ip.prefix_len = prefix_len;
+    printf("Match source IP %s configured\n", args->argv[2]);
+
+    qos_policy_classifier_changed(current_classifier);
     return 0;
 }
 
 /*
  * Match destination IP address
- * Command: if-match ip-address destination <ip-address>
+ * Command: if-match ip-address destination <ip-address>[/<mask-length>] [<mask>]
  */
 static int cmd_if_match_dest_ip(struct cmd_element *cmd, struct cmd_args *args)
 {
-    if (!current_classifier) {
-        printf("Error: No classifier configured\n");
+    if (args->argc < 3) {
+        printf("Error: IP address required\n");
+        printf("Usage: if-match ip-address destination <ip-address>[/<mask-length>] [<mask>]\n");
         return -1;
     }
 
-    if (args->argc < 3) {
-        printf("Error: IP address required\n");
-        printf("Usage: if-match ip-address destination <ip-address>\n");
+    uint32_t addr;
+    uint8_t prefix_len;
+    if (parse_ip_prefix(args->argv[2], args->argc > 3 ? args->argv[3] : NULL,
+                        &addr, &prefix_len) != 0) {
+        printf("Error: Invalid IP address %s\n", args->argv[2]);
+        return -1;
+    }
+
+    struct match_condition *cond = classifier_add_condition(MATCH_TYPE_DEST_IP);
+    if (!cond) {
+        return -1;
+    }
+    cond->value.ip.addr = addr;
+    cond->value.ip.prefix_len = prefix_len;
+    printf("Match destination IP %s configured\n", args->argv[2]);
+
+    qos_policy_classifier_changed(current_classifier);
+    return 0;
+}
+
+/*
+ * Match source or destination port
+ * Command: if-match {source-port|destination-port} <port> [to <port>]
+ */
+static int cmd_if_match_port(struct cmd_element *cmd, struct cmd_args *args)
+{
+    if (args->argc < 2) {
+        printf("Error: Port required\n");
+        printf("Usage: if-match {source-port|destination-port} <port> [to <port>]\n");
+        return -1;
+    }
+
+    bool source = strcmp(args->argv[0], "source-port") == 0;
+    uint16_t min, max;
+    if (parse_range(args, 1, 65535, &min, &max) != 0) {
+        printf("Error: Port must be 0-65535\n");
+        return -1;
+    }
+
+    struct match_condition *cond = classifier_add_condition(source ? MATCH_TYPE_SOURCE_PORT :
+                                                                     MATCH_TYPE_DEST_PORT);
+    if (!cond) {
+        return -1;
+    }
+    cond->value.port.min = min;
+    cond->value.port.max = max;
+    printf("Match %s port %u-%u configured\n", source ? "source" : "destination", min, max);
+
+    qos_policy_classifier_changed(current_classifier);
+    return 0;
+}
+
+/*
+ * Match protocol
+ * Command: if-match protocol {tcp|udp|icmp|<protocol-number>}
+ */
+static int cmd_if_match_protocol(struct cmd_element *cmd, struct cmd_args *args)
+{
+    if (args->argc < 2) {
+        printf("Error: Protocol required\n");
+        printf("Usage: if-match protocol {tcp|udp|icmp|<protocol-number>}\n");
         return -1;
     }
 
-    if (current_classifier->condition_count < 16) {
-        struct match_condition *cond = &current_classifier->conditions[current_classifier->condition_count++];
-        cond->type = MATCH_TYPE_DEST_IP;
-        strncpy(cond->value.ip_address, args->argv[2], sizeof(cond->value.ip_address) - 1);
-        printf("Match destination IP %s configured\n", args->argv[2]);
+    const char *proto = args->argv[1];
+    int protocol;
+    if (strcmp(proto, "tcp") == 0) {
+        protocol = 6;
+    } else if (strcmp(proto, "udp") == 0) {
+        protocol = 17;
+    } else if (strcmp(proto, "icmp") == 0) {
+        protocol = 1;
     } else {
-        printf("Error: Maximum match conditions reached\n");
+        protocol = atoi(proto);
+        if (protocol < 0 || protocol > 255 || (protocol == 0 && strcmp(proto, "0") != 0)) {
+            printf("Error: Invalid protocol %s\n", proto);
+            return -1;
+        }
+    }
+
+    struct match_condition *cond = classifier_add_condition(MATCH_TYPE_PROTOCOL);
+    if (!cond) {
         return -1;
     }
+    cond->value.protocol = (uint8_t)protocol;
+    printf("Match protocol %d configured\n", protocol);
 
+    qos_policy_classifier_changed(current_classifier);
+    return 0;
+}
+
+/*
+ * Match inbound interface
+ * Command: if-match inbound-interface <interface>
+ */
+static int cmd_if_match_interface(struct cmd_element *cmd, struct cmd_args *args)
+{
+    if (args->argc < 2) {
+        printf("Error: Interface name required\n");
+        printf("Usage: if-match inbound-interface <interface>\n");
+        return -1;
+    }
+
+    ifid_t ifid = if_intern(args->argv[1]);
+    if (ifid == IFID_NONE) {
+        printf("Error: Invalid interface name %s\n", args->argv[1]);
+        return -1;
+    }
+
+    struct match_condition *cond = classifier_add_condition(MATCH_TYPE_INTERFACE);
+    if (!cond) {
+        return -1;
+    }
+    cond->value.ifid = ifid;
+    printf("Match inbound interface %s configured\n", args->argv[1]);
+
+    qos_policy_classifier_changed(current_classifier);
+    return 0;
+}
+
+/*
+ * Match packet length
+ * Command: if-match packet-length <min-length> [to <max-length>]
+ */
+static int cmd_if_match_packet_length(struct cmd_element *cmd, struct cmd_args *args)
+{
+    if (args->argc < 2) {
+        printf("Error: Packet length required\n");
+        printf("Usage: if-match packet-length <min-length> [to <max-length>]\n");
+        return -1;
+    }
+
+    uint16_t min, max;
+    if (parse_range(args, 1, 65535, &min, &max) != 0) {
+        printf("Error: Packet length must be 0-65535\n");
+        return -1;
+    }
+
+    struct match_condition *cond = classifier_add_condition(MATCH_TYPE_PACKET_LENGTH);
+    if (!cond) {
+        return -1;
+    }
+    cond->value.packet_length.min = min;
+    cond->value.packet_length.max = max;
+    printf("Match packet length %u-%u configured\n", min, max);
+
+    qos_policy_classifier_changed(current_classifier);
     return 0;
 }
 
@@ -242,74 +488,126 @@ static int cmd_display_traffic_classifier(struct cmd_element *cmd, struct cmd_ar
     if (args->argc > 1) {
         /* Display specific classifier */
         const char *name = args->argv[1];
-        for (int i = 0; i < classifier_count; i++) {
-            if (strcmp(classifiers[i].name, name) == 0) {
-                printf("Traffic Classifier: %s\n", classifiers[i].name);
-                printf("  Match conditions: %d\n", classifiers[i].condition_count);
-                printf("  Match count: %lu\n", classifiers[i].match_count);
-
-                for (int j = 0; j < classifiers[i].condition_count; j++) {
-                    struct match_condition *cond = &classifiers[i].conditions[j];
-                    printf("  Condition %d: ", j + 1);
-
-                    switch (cond->type) {
-                        case MATCH_TYPE_ACL:
-                            printf("ACL %u\n", cond->value.acl_number);
-                            break;
-                        case MATCH_TYPE_DSCP:
-                            printf("DSCP %u\n", cond->value.dscp);
-                            break;
-                        case MATCH_TYPE_SOURCE_IP:
-                            printf("Source IP %s\n", cond->value.ip_address);
-                            break;
-                        case MATCH_TYPE_DEST_IP:
-                            printf("Destination IP %s\n", cond->value.ip_address);
-                            break;
-                        case MATCH_TYPE_PROTOCOL:
-                            printf("Protocol %u\n", cond->value.protocol);
-                            break;
-                        default:
-                            printf("Unknown\n");
-                    }
-                }
-                return 0;
+        const struct traffic_classifier *classifier = classifier_find(name);
+        if (!classifier) {
+            printf("Error: Classifier %s not found\n", name);
+            return -1;
+        }
+
+        printf("Traffic Classifier: %s\n", classifier->name);
+        printf("  Operator: %s\n", classifier->operator == CLASSIFIER_OPERATOR_AND ? "AND" : "OR");
+        printf("  Match conditions: %d\n", classifier->condition_count);
+        printf("  Match count: %lu\n", pcpu_counter_sum(classifier->match_stats));
+        int users = 0;
+        for (const struct qos_dep *dep = classifier->users; dep; dep = dep->next) {
+            users++;
+        }
+        printf("  Used by: %d policy rules\n", users);
+
+        for (int j = 0; j < classifier->condition_count; j++) {
+            const struct match_condition *cond = &classifier->conditions[j];
+            char prefix[32];
+            printf("  Condition %d: ", j + 1);
+
+            switch (cond->type) {
+                case MATCH_TYPE_ACL:
+                    printf("ACL %u\n", cond->value.acl_number);
+                    break;
+                case MATCH_TYPE_DSCP:
+                    printf("DSCP %u\n", cond->value.dscp);
+                    break;
+                case MATCH_TYPE_IP_PRECEDENCE:
+                    printf("IP precedence %u\n", cond->value.ip_precedence);
+                    break;
+                case MATCH_TYPE_SOURCE_IP:
+                    format_prefix(cond, prefix, sizeof(prefix));
+                    printf("Source IP %s\n", prefix);
+                    break;
+                case MATCH_TYPE_DEST_IP:
+                    format_prefix(cond, prefix, sizeof(prefix));
+                    printf("Destination IP %s\n", prefix);
+                    break;
+                case MATCH_TYPE_SOURCE_PORT:
+                    printf("Source port %u-%u\n", cond->value.port.min, cond->value.port.max);
+                    break;
+                case MATCH_TYPE_DEST_PORT:
+                    printf("Destination port %u-%u\n", cond->value.port.min, cond->value.port.max);
+                    break;
+                case MATCH_TYPE_PROTOCOL:
+                    printf("Protocol %u\n", cond->value.protocol);
+                    break;
+                case MATCH_TYPE_INTERFACE:
+                    printf("Inbound interface %s\n", if_name(cond->value.ifid));
+                    break;
+                case MATCH_TYPE_PACKET_LENGTH:
+                    printf("Packet length %u-%u\n", cond->value.packet_length.min,
+                           cond->value.packet_length.max);
+                    break;
+                default:
+                    printf("Unknown\n");
             }
         }
-        printf("Error: Classifier %s not found\n", name);
-        return -1;
+        return 0;
     }
 
     /* Display all classifiers */
     printf("Traffic Classifiers:\n");
-    printf("%-20s %-10s %-15s\n", "Name", "Conditions", "Match Count");
-    printf("%-20s %-10s %-15s\n", "--------------------", "----------", "---------------");
-
-    for (int i = 0; i < classifier_count; i++) {
-        printf("%-20s %-10d %-15lu\n",
-               classifiers[i].name,
-               classifiers[i].condition_count,
-               classifiers[i].match_count);
+    printf("%-20s %-10s %-10s %-15s\n", "Name", "Operator", "Conditions", "Match Count");
+    printf("%-20s %-10s %-10s %-15s\n", "--------------------", "----------", "----------",
+           "---------------");
+
+    const struct traffic_classifier *classifier;
+    SLAB_FOREACH(&classifier_slab, cursor, classifier) {
+        printf("%-20s %-10s %-10d %-15lu\n",
+               classifier->name,
+               classifier->operator == CLASSIFIER_OPERATOR_AND ? "AND" : "OR",
+               classifier->condition_count,
+               pcpu_counter_sum(classifier->match_stats));
     }
 
     return 0;
 }
 
+/* Command registration */
+struct cmd_element classifier_cmds[] = {
+    HUAWEI_CMD_WITH_CATEGORY("traffic classifier", cmd_traffic_classifier, NULL,
+                             "Configure traffic classifier", CMD_CAT_QOS),
+    HUAWEI_CMD_WITH_CATEGORY("display traffic classifier", cmd_display_traffic_classifier, NULL,
+                             "Display traffic classifiers", CMD_CAT_QOS),
+    { .name = NULL }
+};
+
+/* Conditions of a classifier, in its view */
+struct cmd_element classifier_match_cmds[] = {
+    HUAWEI_CMD_WITH_CATEGORY("if-match acl", cmd_if_match_acl, NULL,
+                             "Match ACL", CMD_CAT_QOS),
+    HUAWEI_CMD_WITH_CATEGORY("if-match dscp", cmd_if_match_dscp, NULL,
+                             "Match DSCP value", CMD_CAT_QOS),
+    HUAWEI_CMD_WITH_CATEGORY("if-match ip-precedence", cmd_if_match_ip_precedence, NULL,
+                             "Match IP precedence", CMD_CAT_QOS),
+    HUAWEI_CMD_WITH_CATEGORY("if-match ip-address source", cmd_if_match_source_ip, NULL,
+                             "Match source IP address", CMD_CAT_QOS),
+    HUAWEI_CMD_WITH_CATEGORY("if-match ip-address destination", cmd_if_match_dest_ip, NULL,
+                             "Match destination IP address", CMD_CAT_QOS),
+    HUAWEI_CMD_WITH_CATEGORY("if-match source-port", cmd_if_match_port, NULL,
+                             "Match source port", CMD_CAT_QOS),
+    HUAWEI_CMD_WITH_CATEGORY("if-match destination-port", cmd_if_match_port, NULL,
+                             "Match destination port", CMD_CAT_QOS),
+    HUAWEI_CMD_WITH_CATEGORY("if-match protocol", cmd_if_match_protocol, NULL,
+                             "Match protocol", CMD_CAT_QOS),
+    HUAWEI_CMD_WITH_CATEGORY("if-match inbound-interface", cmd_if_match_interface, NULL,
+                             "Match inbound interface", CMD_CAT_QOS),
+    HUAWEI_CMD_WITH_CATEGORY("if-match packet-length", cmd_if_match_packet_length, NULL,
+                             "Match packet length", CMD_CAT_QOS),
+    { .name = NULL }
+};
+
 /*
  * Initialize QoS classifier module
  */
 void qos_classifier_init(void)
 {
     /* Register commands */
-    HUAWEI_CMD_WITH_CATEGORY("traffic classifier", cmd_traffic_classifier, NULL,
-                            "Configure traffic classifier", "QoS");
-    HUAWEI_CMD_WITH_CATEGORY("if-match acl", cmd_if_match_acl, NULL,
-                            "Match ACL", "QoS");
-    HUAWEI_CMD_WITH_CATEGORY("if-match dscp", cmd_if_match_dscp, NULL,
-                            "Match DSCP value", "QoS");
-    HUAWEI_CMD_WITH_CATEGORY("if-match ip-address source", cmd_if_match_source_ip, NULL,
-                            "Match source IP address", "QoS");
-    HUAWEI_CMD_WITH_CATEGORY("if-match ip-address destination", cmd_if_match_dest_ip, NULL,
-                            "Match destination IP address", "QoS");
-    HUAWEI_CMD_WITH_CATEGORY("display traffic classifier", cmd_display_traffic_classifier, NULL,
-                            "Display traffic classifiers", "QoS");
+    huawei_cli_register_table(classifier_cmds, NULL);
+    huawei_cli_register_table(classifier_match_cmds, "classifier");
 }
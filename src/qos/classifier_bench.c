@@ -0,0 +1,260 @@
+/*
+ * QoS Classifier Benchmark for Huawei VRP Style
+ * Copyright (C) 2026 WhiteBox NE Team
+ *
+ * This program measures classifier lookup throughput including:
+ * - Compiled program lookup against all classifiers at once
+ * - Per-classifier, per-condition evaluation for comparison, stopping at
+ *   the first match and evaluating every classifier
+ * - Agreement of both methods on every generated header
+ *
+ * Usage: classifier_bench [-n lookups] [-m max_classifiers]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+#include "qos_classifier.h"
+
+#define BENCH_INTERFACES    16
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint32_t rand32(void)
+{
+    return ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+}
+
+static void random_condition(struct match_condition *cond)
+{
+    uint16_t lo;
+
+    memset(cond, 0, sizeof(*cond));
+    switch (rand() % 9) {
+    case 0:
+        cond->type = MATCH_TYPE_DSCP;
+        cond->value.dscp = rand() % 64;
+        break;
+    case 1:
+        cond->type = MATCH_TYPE_IP_PRECEDENCE;
+        cond->value.ip_precedence = rand() % 8;
+        break;
+    case 2:
+    case 3:
+        cond->type = rand() % 2 ? MATCH_TYPE_SOURCE_IP : MATCH_TYPE_DEST_IP;
+        cond->value.ip.addr = 0x0a000000 | (rand32() & 0x00ffffff);
+        cond->value.ip.prefix_len = 8 + rand() % 25;
+        break;
+    case 4:
+    case 5:
+        cond->type = rand() % 2 ? MATCH_TYPE_SOURCE_PORT : MATCH_TYPE_DEST_PORT;
+        lo = rand() % 2 ? rand() % 1024 : 1024 + rand() % 64000;
+        cond->value.port.min = lo;
+        cond->value.port.max = lo + (rand() % 4 ? 0 : rand() % 512);
+        break;
+    case 6:
+        cond->type = MATCH_TYPE_PROTOCOL;
+        cond->value.protocol = (uint8_t[]){ 1, 6, 17, 47 }[rand() % 4];
+        break;
+    case 7:
+        cond->type = MATCH_TYPE_PACKET_LENGTH;
+        lo = 64 + rand() % 1400;
+        cond->value.packet_length.min = lo;
+        cond->value.packet_length.max = lo + rand() % 200;
+        break;
+    default:
+        cond->type = MATCH_TYPE_INTERFACE;
+        cond->value.ifid = 1 + rand() % BENCH_INTERFACES;
+        break;
+    }
+}
+
+/* Header satisfying cond, other fields random */
+static void random_key(struct qos_flow_key *key, const struct match_condition *cond)
+{
+    key->src_ip = 0x0a000000 | (rand32() & 0x00ffffff);
+    key->dst_ip = 0x0a000000 | (rand32() & 0x00ffffff);
+    key->src_port = rand() % 65536;
+    key->dst_port = rand() % 2 ? rand() % 1024 : rand() % 65536;
+    key->protocol = (uint8_t[]){ 1, 6, 17, 47 }[rand() % 4];
+    key->dscp = rand() % 64;
+    key->length = 64 + rand() % 1436;
+    key->ifid = 1 + rand() % BENCH_INTERFACES;
+
+    if (!cond) {
+        return;
+    }
+
+    uint32_t host = rand32();
+    uint32_t mask;
+    switch (cond->type) {
+    case MATCH_TYPE_DSCP:
+        key->dscp = cond->value.dscp;
+        break;
+    case MATCH_TYPE_IP_PRECEDENCE:
+        key->dscp = (cond->value.ip_precedence << 3) | (rand() % 8);
+        break;
+    case MATCH_TYPE_SOURCE_IP:
+    case MATCH_TYPE_DEST_IP:
+        mask = cond->value.ip.prefix_len ? ~0u << (32 - cond->value.ip.prefix_len) : 0;
+        host = (cond->value.ip.addr & mask) | (host & ~mask);
+        if (cond->type == MATCH_TYPE_SOURCE_IP) {
+            key->src_ip = host;
+        } else {
+            key->dst_ip = host;
+        }
+        break;
+    case MATCH_TYPE_SOURCE_PORT:
+        key->src_port = cond->value.port.min;
+        break;
+    case MATCH_TYPE_DEST_PORT:
+        key->dst_port = cond->value.port.max;
+        break;
+    case MATCH_TYPE_PROTOCOL:
+        key->protocol = cond->value.protocol;
+        break;
+    case MATCH_TYPE_PACKET_LENGTH:
+        key->length = cond->value.packet_length.min;
+        break;
+    case MATCH_TYPE_INTERFACE:
+        key->ifid = cond->value.ifid;
+        break;
+    default:
+        break;
+    }
+}
+
+static int linear_first(struct traffic_classifier **list, uint32_t count,
+                        const struct qos_flow_key *key)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        if (qos_classifier_match(list[i], key, NULL, NULL)) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+/* Number of matching classifiers, the full set a lookup produces */
+static int linear_all(struct traffic_classifier **list, uint32_t count,
+                      const struct qos_flow_key *key)
+{
+    int matches = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        matches += qos_classifier_match(list[i], key, NULL, NULL);
+    }
+    return matches;
+}
+
+int main(int argc, char *argv[])
+{
+    int lookups = 1000000;
+    uint32_t max_classifiers = 1024;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:m:")) != -1) {
+        switch (opt) {
+        case 'n':
+            lookups = atoi(optarg);
+            break;
+        case 'm':
+            max_classifiers = (uint32_t)atoi(optarg);
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-n lookups] [-m max_classifiers]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    struct traffic_classifier *store = calloc(max_classifiers, sizeof(*store));
+    struct traffic_classifier **list = calloc(max_classifiers, sizeof(*list));
+    struct qos_flow_key *keys = malloc((size_t)lookups * sizeof(*keys));
+    int *expect = malloc((size_t)lookups * sizeof(*expect));
+    if (!store || !list || !keys || !expect) {
+        fprintf(stderr, "Error: Out of memory\n");
+        return 1;
+    }
+
+    printf("Classifier lookup benchmark: %d lookups per size\n\n", lookups);
+    printf("%-12s %10s %10s %8s %12s %12s %14s %8s %10s\n", "Classifiers", "Compile ms",
+           "Memory KB", "Classes", "First Mlps", "All Mlps", "Compiled Mlps", "Speedup",
+           "Mismatch");
+
+    for (uint32_t count = 16; count <= max_classifiers; count *= 2) {
+        srand(count);
+        for (uint32_t i = 0; i < count; i++) {
+            struct traffic_classifier *cls = &store[i];
+            memset(cls, 0, sizeof(*cls));
+            snprintf(cls->name, sizeof(cls->name), "class-%u", i);
+            cls->operator = rand() % 2 ? CLASSIFIER_OPERATOR_AND : CLASSIFIER_OPERATOR_OR;
+            cls->condition_count = 1 + rand() % 4;
+            for (int c = 0; c < cls->condition_count; c++) {
+                random_condition(&cls->conditions[c]);
+            }
+            list[i] = cls;
+        }
+
+        /* Half the headers are aimed at one condition of some classifier */
+        for (int i = 0; i < lookups; i++) {
+            const struct traffic_classifier *cls = list[rand() % count];
+            random_key(&keys[i], rand() % 2 ? &cls->conditions[rand() % cls->condition_count] : NULL);
+        }
+
+        double start = now_sec();
+        struct qos_cls_program *prog = qos_cls_compile(list, count, NULL, NULL);
+        double compile = now_sec() - start;
+        if (!prog) {
+            fprintf(stderr, "Error: Compilation failed at %u classifiers\n", count);
+            return 1;
+        }
+
+        start = now_sec();
+        for (int i = 0; i < lookups; i++) {
+            expect[i] = linear_first(list, count, &keys[i]);
+        }
+        double linear = now_sec() - start;
+
+        volatile int sink = 0;
+        start = now_sec();
+        for (int i = 0; i < lookups; i++) {
+            sink += linear_all(list, count, &keys[i]);
+        }
+        double linear_full = now_sec() - start;
+        (void)sink;
+
+        int mismatches = 0;
+        start = now_sec();
+        for (int i = 0; i < lookups; i++) {
+            if (qos_cls_first(prog, &keys[i]) != expect[i]) {
+                mismatches++;
+            }
+        }
+        double compiled = now_sec() - start;
+
+        uint32_t classes = 0;
+        for (int f = 0; f < QOS_FIELD_MAX; f++) {
+            classes += prog->fields[f].class_count;
+        }
+
+        printf("%-12u %10.2f %10.1f %8u %12.2f %12.2f %14.2f %7.1fx %10d\n", count,
+               compile * 1e3, prog->memory / 1024.0, classes, lookups / linear / 1e6,
+               lookups / linear_full / 1e6, lookups / compiled / 1e6, linear_full / compiled,
+               mismatches);
+        qos_cls_free(prog);
+    }
+
+    free(store);
+    free(list);
+    free(keys);
+    free(expect);
+    return 0;
+}
@@ -0,0 +1,727 @@
+/*
+ * QoS Classifier Compiler for Huawei VRP Style
+ * Copyright (C) 2026 WhiteBox NE Team
+ *
+ * This module compiles all traffic classifiers into one lookup program
+ * including:
+ * - Per-field reduction of conditions to intervals (precedence folds
+ *   into DSCP, prefixes become address ranges)
+ * - Elementary segments per field, each mapped to a deduplicated
+ *   classifier bitset
+ * - Direct tables for small domains, otherwise a first-level index on the
+ *   high value bits narrowing a binary search over segment bounds
+ * - AND / OR combination of the field bitsets per classifier operator
+ * - 5-tuple rules for the pkt_match kernel when the classifiers allow
+ * - A reference evaluator with the per-condition semantics
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "qos_classifier.h"
+
+#define QOS_DIRECT_MAX      4096    /* Largest direct value -> class table */
+#define QOS_CLS_STACK_WORDS 16      /* Lookups up to 1024 classifiers need no allocation */
+#define QOS_INDEX_BITS      16      /* First-level index over the high value bits */
+#define QOS_INDEX_MIN_SEGS  64      /* Fewer segments are searched directly */
+
+/* Closed interval of one classifier on one field */
+struct qos_interval {
+    uint32_t lo;
+    uint32_t hi;
+    uint32_t cls;
+};
+
+/* Interval list of one field */
+struct qos_interval_list {
+    struct qos_interval *items;
+    uint32_t count;
+    uint32_t capacity;
+};
+
+static int interval_add(struct qos_interval_list *list, uint32_t lo, uint32_t hi, uint32_t cls)
+{
+    if (list->count == list->capacity) {
+        uint32_t capacity = list->capacity ? list->capacity * 2 : 64;
+        struct qos_interval *items = realloc(list->items, capacity * sizeof(*items));
+        if (!items) {
+            return -1;
+        }
+        list->items = items;
+        list->capacity = capacity;
+    }
+    list->items[list->count++] = (struct qos_interval){ lo, hi, cls };
+    return 0;
+}
+
+static uint32_t prefix_mask(uint8_t prefix_len)
+{
+    return prefix_len == 0 ? 0 : prefix_len >= 32 ? 0xffffffffu : ~(0xffffffffu >> prefix_len);
+}
+
+/*
+ * Field and interval of a condition. Returns false for ACL conditions,
+ * which are evaluated through the ACL hook.
+ */
+static bool condition_interval(const struct match_condition *cond, qos_field_t *field,
+                               uint32_t *lo, uint32_t *hi)
+{
+    switch (cond->type) {
+        case MATCH_TYPE_DSCP:
+            *field = QOS_FIELD_DSCP;
+            *lo = *hi = cond->value.dscp;
+            return true;
+        case MATCH_TYPE_IP_PRECEDENCE:
+            *field = QOS_FIELD_DSCP;
+            *lo = (uint32_t)cond->value.ip_precedence << 3;
+            *hi = *lo | 7;
+            return true;
+        case MATCH_TYPE_SOURCE_IP:
+        case MATCH_TYPE_DEST_IP: {
+            uint32_t mask = prefix_mask(cond->value.ip.prefix_len);
+            *field = cond->type == MATCH_TYPE_SOURCE_IP ? QOS_FIELD_SRC_IP : QOS_FIELD_DST_IP;
+            *lo = cond->value.ip.addr & mask;
+            *hi = *lo | ~mask;
+            return true;
+        }
+        case MATCH_TYPE_SOURCE_PORT:
+        case MATCH_TYPE_DEST_PORT:
+            *field = cond->type == MATCH_TYPE_SOURCE_PORT ? QOS_FIELD_SRC_PORT : QOS_FIELD_DST_PORT;
+            *lo = cond->value.port.min;
+            *hi = cond->value.port.max;
+            return true;
+        case MATCH_TYPE_PROTOCOL:
+            *field = QOS_FIELD_PROTOCOL;
+            *lo = *hi = cond->value.protocol;
+            return true;
+        case MATCH_TYPE_INTERFACE:
+            *field = QOS_FIELD_INTERFACE;
+            *lo = *hi = cond->value.ifid;
+            return true;
+        case MATCH_TYPE_PACKET_LENGTH:
+            *field = QOS_FIELD_LENGTH;
+            *lo = cond->value.packet_length.min;
+            *hi = cond->value.packet_length.max;
+            return true;
+        default:
+            return false;
+    }
+}
+
+/* Header values indexed by qos_field_t */
+static inline void field_values(const struct qos_flow_key *key, uint32_t *values)
+{
+    values[QOS_FIELD_DSCP] = key->dscp;
+    values[QOS_FIELD_PROTOCOL] = key->protocol;
+    values[QOS_FIELD_SRC_IP] = key->src_ip;
+    values[QOS_FIELD_DST_IP] = key->dst_ip;
+    values[QOS_FIELD_SRC_PORT] = key->src_port;
+    values[QOS_FIELD_DST_PORT] = key->dst_port;
+    values[QOS_FIELD_LENGTH] = key->length;
+    values[QOS_FIELD_INTERFACE] = key->ifid;
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+/*
+ * Index of the segment containing value: last bound <= value.
+ * Branch-free so that random headers do not mispredict every step.
+ */
+static inline uint32_t segment_of(const uint32_t *bounds, uint32_t count, uint32_t value)
+{
+    const uint32_t *base = bounds;
+    uint32_t n = count;
+
+    while (n > 1) {
+        uint32_t half = n / 2;
+        base = (base[half] <= value) ? base + half : base;
+        n -= half;
+    }
+    return (uint32_t)(base - bounds);
+}
+
+static uint64_t bitset_hash(const uint64_t *bits, uint32_t words)
+{
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (uint32_t w = 0; w < words; w++) {
+        h = (h ^ bits[w]) * 0x100000001b3ull;
+    }
+    return h ^ (h >> 29);
+}
+
+/*
+ * Build the segment map of one field. base holds the bits every segment
+ * starts with: operator-and classifiers without a condition on the field.
+ */
+static int build_field(struct qos_cls_program *prog, struct qos_cls_field *field,
+                       const struct qos_interval_list *list, const uint64_t *base)
+{
+    uint32_t words = prog->words;
+    uint32_t npts = 0;
+    uint32_t *pts = malloc((2 * list->count + 1) * sizeof(*pts));
+    if (!pts) {
+        return -1;
+    }
+
+    pts[npts++] = 0;
+    for (uint32_t i = 0; i < list->count; i++) {
+        pts[npts++] = list->items[i].lo;
+        if (list->items[i].hi != UINT32_MAX) {
+            pts[npts++] = list->items[i].hi + 1;
+        }
+    }
+    qsort(pts, npts, sizeof(*pts), cmp_u32);
+    uint32_t segments = 0;
+    for (uint32_t i = 0; i < npts; i++) {
+        if (segments == 0 || pts[i] != pts[segments - 1]) {
+            pts[segments++] = pts[i];
+        }
+    }
+
+    /* Bitset of every elementary segment */
+    uint64_t *seg_bits = malloc((size_t)segments * words * sizeof(uint64_t));
+    if (!seg_bits) {
+        free(pts);
+        return -1;
+    }
+    for (uint32_t s = 0; s < segments; s++) {
+        memcpy(seg_bits + (size_t)s * words, base, words * sizeof(uint64_t));
+    }
+    for (uint32_t i = 0; i < list->count; i++) {
+        const struct qos_interval *iv = &list->items[i];
+        uint32_t first = segment_of(pts, segments, iv->lo);
+        uint32_t last = segment_of(pts, segments, iv->hi);
+        for (uint32_t s = first; s <= last; s++) {
+            seg_bits[(size_t)s * words + iv->cls / 64] |= 1ull << (iv->cls % 64);
+        }
+    }
+
+    /* Deduplicate bitsets into classes, merging equal neighbours */
+    uint32_t table_size = 16;
+    while (table_size < segments * 2) {
+        table_size *= 2;
+    }
+    uint32_t *table = malloc(table_size * sizeof(*table));
+    uint16_t *seg_class = malloc(segments * sizeof(*seg_class));
+    uint64_t *classes = malloc((size_t)segments * words * sizeof(uint64_t));
+    if (!table || !seg_class || !classes) {
+        free(table);
+        free(seg_class);
+        free(classes);
+        free(seg_bits);
+        free(pts);
+        return -1;
+    }
+    memset(table, 0xff, table_size * sizeof(*table));
+
+    uint32_t class_count = 0;
+    uint32_t merged = 0;
+    int ret = 0;
+    for (uint32_t s = 0; s < segments; s++) {
+        const uint64_t *bits = seg_bits + (size_t)s * words;
+        uint32_t slot = (uint32_t)bitset_hash(bits, words) & (table_size - 1);
+        while (table[slot] != UINT32_MAX &&
+               memcmp(classes + (size_t)table[slot] * words, bits, words * sizeof(uint64_t)) != 0) {
+            slot = (slot + 1) & (table_size - 1);
+        }
+        if (table[slot] == UINT32_MAX) {
+            if (class_count > UINT16_MAX) {
+                ret = -1;
+                break;
+            }
+            memcpy(classes + (size_t)class_count * words, bits, words * sizeof(uint64_t));
+            table[slot] = class_count++;
+        }
+
+        if (merged > 0 && seg_class[merged - 1] == table[slot]) {
+            continue;
+        }
+        pts[merged] = pts[s];
+        seg_class[merged++] = (uint16_t)table[slot];
+    }
+    free(table);
+    free(seg_bits);
+    if (ret != 0) {
+        free(seg_class);
+        free(classes);
+        free(pts);
+        return -1;
+    }
+
+    field->segment_count = merged;
+    field->bounds = pts;
+    field->segment_class = seg_class;
+    field->class_count = class_count;
+    field->classes = realloc(classes, (size_t)class_count * words * sizeof(uint64_t));
+    if (!field->classes) {
+        field->classes = classes;
+    }
+    prog->memory += merged * (sizeof(*pts) + sizeof(*seg_class)) +
+                    (size_t)class_count * words * sizeof(uint64_t);
+
+    /* Small domains: one table read instead of a search */
+    if (pts[merged - 1] < QOS_DIRECT_MAX) {
+        field->direct_size = pts[merged - 1] + 1;
+        field->direct = malloc(field->direct_size * sizeof(*field->direct));
+        if (field->direct) {
+            for (uint32_t v = 0; v < field->direct_size; v++) {
+                field->direct[v] = seg_class[segment_of(pts, merged, v)];
+            }
+            prog->memory += field->direct_size * sizeof(*field->direct);
+        }
+    } else if (merged >= QOS_INDEX_MIN_SEGS) {
+        /* Wide domains: index[h] is the segment holding h << shift */
+        uint32_t shift = 0;
+        while ((pts[merged - 1] >> shift) >= (1u << QOS_INDEX_BITS)) {
+            shift++;
+        }
+        field->index_shift = shift;
+        field->index_size = (pts[merged - 1] >> shift) + 1;
+        field->index = malloc((field->index_size + 1) * sizeof(*field->index));
+        if (field->index) {
+            for (uint32_t h = 0; h < field->index_size; h++) {
+                field->index[h] = segment_of(pts, merged, h << shift);
+            }
+            field->index[field->index_size] = merged - 1;
+            prog->memory += (field->index_size + 1) * sizeof(*field->index);
+        }
+    }
+
+    return 0;
+}
+
+/* Adds a 5-tuple rule for classifier cls, fields given as intervals */
+static int burst_add(struct pkt_match_table *table, uint32_t cls, const bool *has,
+                     const uint32_t *lo, const uint32_t *hi)
+{
+    struct pkt_match_rule rule = {
+        .src_port = { 0, 65535 },
+        .dst_port = { 0, 65535 },
+        .result = (uint16_t)cls,
+    };
+
+    for (int f = 0; f < QOS_FIELD_MAX; f++) {
+        if (!has[f]) {
+            continue;
+        }
+        uint32_t mask = ~(lo[f] ^ hi[f]);
+        switch (f) {
+            case QOS_FIELD_SRC_IP:
+            case QOS_FIELD_DST_IP:
+                /* Intersections of prefixes are prefixes */
+                if ((lo[f] & ~mask) != 0 || (hi[f] | mask) != UINT32_MAX) {
+                    return -1;
+                }
+                if (f == QOS_FIELD_SRC_IP) {
+                    rule.src = lo[f];
+                    rule.src_mask = mask;
+                } else {
+                    rule.dst = lo[f];
+                    rule.dst_mask = mask;
+                }
+                break;
+            case QOS_FIELD_SRC_PORT:
+                rule.src_port[0] = (uint16_t)lo[f];
+                rule.src_port[1] = (uint16_t)hi[f];
+                break;
+            case QOS_FIELD_DST_PORT:
+                rule.dst_port[0] = (uint16_t)lo[f];
+                rule.dst_port[1] = (uint16_t)hi[f];
+                break;
+            case QOS_FIELD_PROTOCOL:
+                rule.protocol = (uint8_t)lo[f];
+                rule.protocol_mask = 0xff;
+                break;
+            default:
+                return -1;
+        }
+    }
+    return pkt_match_add(table, &rule);
+}
+
+/*
+ * 5-tuple rules in classifier order: one per classifier with operator
+ * and, one per condition with operator or. NULL when a classifier uses
+ * anything else or the rules do not fit.
+ */
+static struct pkt_match_table *burst_compile(struct traffic_classifier **classifiers,
+                                             uint32_t count)
+{
+    struct pkt_match_table *table;
+
+    if (count == 0 || count > PKT_MATCH_MAX_RULES) {
+        return NULL;
+    }
+    table = aligned_alloc(64, sizeof(*table));
+    if (!table) {
+        return NULL;
+    }
+    pkt_match_init(table);
+
+    for (uint32_t c = 0; c < count; c++) {
+        const struct traffic_classifier *cls = classifiers[c];
+        bool is_and = cls->operator == CLASSIFIER_OPERATOR_AND;
+        bool has[QOS_FIELD_MAX] = { false };
+        uint32_t lo[QOS_FIELD_MAX], hi[QOS_FIELD_MAX];
+        bool empty = false;
+
+        for (int i = 0; i < cls->condition_count; i++) {
+            const struct match_condition *cond = &cls->conditions[i];
+            qos_field_t f;
+            uint32_t l, h;
+
+            if (!condition_interval(cond, &f, &l, &h) || f == QOS_FIELD_DSCP ||
+                f == QOS_FIELD_LENGTH || f == QOS_FIELD_INTERFACE) {
+                free(table);
+                return NULL;
+            }
+            if (!is_and) {
+                bool one[QOS_FIELD_MAX] = { false };
+                one[f] = true;
+                lo[f] = l;
+                hi[f] = h;
+                if (burst_add(table, c, one, lo, hi) < 0) {
+                    free(table);
+                    return NULL;
+                }
+            } else if (!has[f]) {
+                has[f] = true;
+                lo[f] = l;
+                hi[f] = h;
+            } else {
+                lo[f] = l > lo[f] ? l : lo[f];
+                hi[f] = h < hi[f] ? h : hi[f];
+                empty = empty || lo[f] > hi[f];
+            }
+        }
+        if (is_and && cls->condition_count > 0 && !empty &&
+            burst_add(table, c, has, lo, hi) < 0) {
+            free(table);
+            return NULL;
+        }
+    }
+    return table;
+}
+
+/*
+ * Compile classifiers into one program. Bit i of a lookup result is
+ * classifiers[i]. acl_match evaluates if-match acl conditions; without
+ * it those conditions never match.
+ */
+struct qos_cls_program *qos_cls_compile(struct traffic_classifier **classifiers, uint32_t count,
+                                        qos_cls_acl_fn acl_match, void *acl_ctx)
+{
+    struct qos_cls_program *prog = calloc(1, sizeof(*prog));
+    if (!prog) {
+        return NULL;
+    }
+
+    uint32_t words = count ? (count + 63) / 64 : 1;
+    prog->classifier_count = count;
+    prog->words = words;
+    prog->acl_match = acl_match;
+    prog->acl_ctx = acl_ctx;
+    prog->classifiers = malloc((count ? count : 1) * sizeof(*prog->classifiers));
+    prog->and_mask = calloc(words, sizeof(uint64_t));
+    prog->or_mask = calloc(words, sizeof(uint64_t));
+
+    struct qos_interval_list lists[QOS_FIELD_MAX];
+    uint64_t *bases = calloc((size_t)QOS_FIELD_MAX * words, sizeof(uint64_t));
+    memset(lists, 0, sizeof(lists));
+    if (!prog->classifiers || !prog->and_mask || !prog->or_mask || !bases) {
+        free(bases);
+        qos_cls_free(prog);
+        return NULL;
+    }
+    if (count) {
+        memcpy(prog->classifiers, classifiers, count * sizeof(*classifiers));
+    }
+
+    int ret = 0;
+    for (uint32_t c = 0; c < count && ret == 0; c++) {
+        const struct traffic_classifier *cls = classifiers[c];
+        uint64_t bit = 1ull << (c % 64);
+        bool is_and = cls->operator == CLASSIFIER_OPERATOR_AND;
+        bool live = cls->condition_count > 0;
+
+        /* operator and: intersect the intervals of each field */
+        bool has[QOS_FIELD_MAX] = { false };
+        uint32_t lo[QOS_FIELD_MAX], hi[QOS_FIELD_MAX];
+
+        for (int i = 0; i < cls->condition_count && ret == 0; i++) {
+            const struct match_condition *cond = &cls->conditions[i];
+            qos_field_t f;
+            uint32_t l, h;
+
+            if (cond->type == MATCH_TYPE_ACL) {
+                uint32_t a = 0;
+                while (a < prog->acl_count && prog->acl_numbers[a] != cond->value.acl_number) {
+                    a++;
+                }
+                if (a == prog->acl_count) {
+                    uint16_t *numbers = realloc(prog->acl_numbers, (a + 1) * sizeof(*numbers));
+                    uint64_t *masks = numbers ? realloc(prog->acl_masks,
+                                                        (size_t)(a + 1) * words * sizeof(uint64_t)) : NULL;
+                    if (numbers) {
+                        prog->acl_numbers = numbers;
+                    }
+                    if (!masks) {
+                        ret = -1;
+                        break;
+                    }
+                    prog->acl_masks = masks;
+                    numbers[a] = cond->value.acl_number;
+                    memset(masks + (size_t)a * words, 0, words * sizeof(uint64_t));
+                    prog->acl_count++;
+                }
+                prog->acl_masks[(size_t)a * words + c / 64] |= bit;
+                continue;
+            }
+            if (!condition_interval(cond, &f, &l, &h)) {
+                /* Unknown condition never matches */
+                live = live && !is_and;
+                continue;
+            }
+
+            if (!is_and) {
+                ret = interval_add(&lists[f], l, h, c);
+            } else if (!has[f]) {
+                has[f] = true;
+                lo[f] = l;
+                hi[f] = h;
+            } else {
+                lo[f] = l > lo[f] ? l : lo[f];
+                hi[f] = h < hi[f] ? h : hi[f];
+            }
+        }
+
+        if (is_and) {
+            for (int f = 0; f < QOS_FIELD_MAX && ret == 0; f++) {
+                if (!has[f]) {
+                    bases[(size_t)f * words + c / 64] |= bit;
+                } else if (lo[f] > hi[f]) {
+                    live = false;       /* Contradicting conditions */
+                } else {
+                    ret = interval_add(&lists[f], lo[f], hi[f], c);
+                }
+            }
+        }
+
+        if (live) {
+            if (is_and) {
+                prog->and_mask[c / 64] |= bit;
+            } else {
+                prog->or_mask[c / 64] |= bit;
+            }
+        }
+    }
+
+    for (int f = 0; f < QOS_FIELD_MAX && ret == 0; f++) {
+        if (lists[f].count == 0) {
+            continue;
+        }
+        ret = build_field(prog, &prog->fields[f], &lists[f], bases + (size_t)f * words);
+        prog->active[prog->active_count++] = f;
+    }
+
+    for (int f = 0; f < QOS_FIELD_MAX; f++) {
+        free(lists[f].items);
+    }
+    free(bases);
+    if (ret != 0) {
+        qos_cls_free(prog);
+        return NULL;
+    }
+
+    prog->memory += sizeof(*prog) + count * sizeof(*prog->classifiers) +
+                    (2 + (size_t)prog->acl_count) * words * sizeof(uint64_t);
+    prog->burst = burst_compile(classifiers, count);
+    if (prog->burst) {
+        prog->memory += sizeof(*prog->burst);
+    }
+    return prog;
+}
+
+void qos_cls_free(struct qos_cls_program *prog)
+{
+    if (!prog) {
+        return;
+    }
+    for (int f = 0; f < QOS_FIELD_MAX; f++) {
+        free(prog->fields[f].bounds);
+        free(prog->fields[f].segment_class);
+        free(prog->fields[f].direct);
+        free(prog->fields[f].index);
+        free(prog->fields[f].classes);
+    }
+    free(prog->classifiers);
+    free(prog->and_mask);
+    free(prog->or_mask);
+    free(prog->acl_numbers);
+    free(prog->acl_masks);
+    free(prog->burst);
+    free(prog);
+}
+
+/*
+ * Match a header against all classifiers. match receives prog->words
+ * words, bit i set when classifiers[i] matches.
+ */
+void qos_cls_lookup(const struct qos_cls_program *prog, const struct qos_flow_key *key,
+                    uint64_t *match)
+{
+    uint32_t words = prog->words;
+    uint64_t any_stack[QOS_CLS_STACK_WORDS];
+    uint64_t *any = words <= QOS_CLS_STACK_WORDS ? any_stack : calloc(words, sizeof(uint64_t));
+    uint32_t values[QOS_FIELD_MAX];
+
+    if (!any) {
+        memset(match, 0, words * sizeof(uint64_t));
+        return;
+    }
+    for (uint32_t w = 0; w < words; w++) {
+        match[w] = ~0ull;
+        any[w] = 0;
+    }
+    field_values(key, values);
+
+    for (int i = 0; i < prog->active_count; i++) {
+        const struct qos_cls_field *field = &prog->fields[prog->active[i]];
+        uint32_t value = values[prog->active[i]];
+        uint32_t cls;
+
+        if (field->direct) {
+            cls = field->direct[value < field->direct_size ? value : field->direct_size - 1];
+        } else if (field->index) {
+            uint32_t h = value >> field->index_shift;
+            h = h < field->index_size ? h : field->index_size;
+            uint32_t first = field->index[h];
+            uint32_t n = (h < field->index_size ? field->index[h + 1] : field->segment_count - 1) - first + 1;
+            cls = field->segment_class[first + segment_of(field->bounds + first, n, value)];
+        } else {
+            cls = field->segment_class[segment_of(field->bounds, field->segment_count, value)];
+        }
+
+        const uint64_t *bits = field->classes + (size_t)cls * words;
+        for (uint32_t w = 0; w < words; w++) {
+            match[w] &= bits[w];
+            any[w] |= bits[w];
+        }
+    }
+
+    for (uint32_t a = 0; a < prog->acl_count; a++) {
+        const uint64_t *mask = prog->acl_masks + (size_t)a * words;
+        bool hit = prog->acl_match && prog->acl_match(prog->acl_numbers[a], key, prog->acl_ctx);
+        for (uint32_t w = 0; w < words; w++) {
+            if (hit) {
+                any[w] |= mask[w];
+            } else {
+                match[w] &= ~mask[w];
+            }
+        }
+    }
+
+    for (uint32_t w = 0; w < words; w++) {
+        match[w] = (match[w] & prog->and_mask[w]) | (any[w] & prog->or_mask[w]);
+    }
+    if (any != any_stack) {
+        free(any);
+    }
+}
+
+/* Index of the first matching classifier, -1 if none */
+int qos_cls_first(const struct qos_cls_program *prog, const struct qos_flow_key *key)
+{
+    uint64_t match_stack[QOS_CLS_STACK_WORDS];
+    uint64_t *match = prog->words <= QOS_CLS_STACK_WORDS ? match_stack :
+                      malloc(prog->words * sizeof(uint64_t));
+    int first = -1;
+
+    if (!match) {
+        return -1;
+    }
+    qos_cls_lookup(prog, key, match);
+    for (uint32_t w = 0; w < prog->words; w++) {
+        if (match[w]) {
+            first = (int)(w * 64 + __builtin_ctzll(match[w]));
+            break;
+        }
+    }
+    if (match != match_stack) {
+        free(match);
+    }
+    return first;
+}
+
+/*
+ * qos_cls_first() for count headers. Programs with a 5-tuple table
+ * match them PKT_MATCH_BURST at a time.
+ */
+void qos_cls_first_burst(const struct qos_cls_program *prog, const struct qos_flow_key *keys,
+                         uint32_t count, int *first)
+{
+    struct pkt_match_burst burst;
+
+    if (!prog->burst) {
+        for (uint32_t i = 0; i < count; i++) {
+            first[i] = qos_cls_first(prog, &keys[i]);
+        }
+        return;
+    }
+    for (uint32_t base = 0; base < count; base += PKT_MATCH_BURST) {
+        burst.count = count - base < PKT_MATCH_BURST ? count - base : PKT_MATCH_BURST;
+        for (uint32_t n = 0; n < burst.count; n++) {
+            const struct qos_flow_key *key = &keys[base + n];
+            pkt_match_burst_set(&burst, n, key->src_ip, key->dst_ip, key->src_port,
+                                key->dst_port, key->protocol);
+        }
+        pkt_match_burst(prog->burst, &burst, &first[base]);
+    }
+}
+
+/*
+ * Reference evaluation of one classifier, condition by condition.
+ * A classifier without conditions matches nothing.
+ */
+bool qos_classifier_match(const struct traffic_classifier *classifier,
+                          const struct qos_flow_key *key,
+                          qos_cls_acl_fn acl_match, void *acl_ctx)
+{
+    bool is_and = classifier->operator == CLASSIFIER_OPERATOR_AND;
+
+    if (classifier->condition_count == 0) {
+        return false;
+    }
+
+    for (int i = 0; i < classifier->condition_count; i++) {
+        const struct match_condition *cond = &classifier->conditions[i];
+        qos_field_t f;
+        uint32_t lo, hi;
+        bool hit;
+
+        if (cond->type == MATCH_TYPE_ACL) {
+            hit = acl_match && acl_match(cond->value.acl_number, key, acl_ctx);
+        } else if (condition_interval(cond, &f, &lo, &hi)) {
+            uint32_t values[QOS_FIELD_MAX];
+            field_values(key, values);
+            uint32_t v = values[f];
+            hit = v >= lo && v <= hi;
+        } else {
+            hit = false;
+        }
+
+        if (hit && !is_and) {
+            return true;
+        }
+        if (!hit && is_and) {
+            return false;
+        }
+    }
+    return is_and;
+}
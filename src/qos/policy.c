@@ -5,7 +5,11 @@
  * This module provides traffic policy functionality including:
  * - Binding classifiers to behaviors
  * - Policy application to interfaces
- * - Statistics collection
+ * - Per-CPU rule statistics, with rates since the last display
+ * - Offload of applied policies to tc/flower, with counters read back
+ * - Dependency tracking from classifiers and behaviors to rules, so an
+ *   edit recompiles and resyncs only the affected policies and rules
+ * - Flow cache invalidation by the generation stamped on each program
  */
 
 #include <stdio.h>
@@ -13,30 +17,363 @@
 #include <string.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <errno.h>
 #include "../frr_core/lib/huawei_cli.h"
-
-/* Policy rule */
-struct policy_rule {
-    char classifier_name[64];
-    char behavior_name[64];
-    uint64_t match_packets;
-    uint64_t match_bytes;
-};
-
-/* Traffic policy */
-struct traffic_policy {
-    char name[64];
-    struct policy_rule rules[32];
-    int rule_count;
-    bool applied;
-    char applied_interface[64];
-    char direction[16];  /* inbound/outbound */
-};
+#include "../frr_core/lib/if_registry.h"
+#include "../frr_core/lib/qsbr.h"
+#include "../frr_core/lib/flow_cache.h"
+#include "qos_classifier.h"
+#include "qos_behavior.h"
+#include "qos_policy.h"
 
 static struct traffic_policy policies[128];
 static int policy_count = 0;
 static struct traffic_policy *current_policy = NULL;
 
+static struct traffic_policy *policy_find(const char *name)
+{
+    for (int i = 0; i < policy_count; i++) {
+        if (strcmp(policies[i].name, name) == 0) {
+            return &policies[i];
+        }
+    }
+    return NULL;
+}
+
+static void dep_link(struct qos_dep **head, struct qos_dep *dep)
+{
+    dep->next = *head;
+    *head = dep;
+}
+
+static void dep_unlink(struct qos_dep **head, struct qos_dep *dep)
+{
+    for (struct qos_dep **p = head; *p; p = &(*p)->next) {
+        if (*p == dep) {
+            *p = dep->next;
+            break;
+        }
+    }
+    dep->next = NULL;
+}
+
+/*
+ * Link a rule to its classifier and behavior once they exist. Returns
+ * true when either was newly resolved.
+ */
+static bool rule_resolve(struct policy_rule *rule)
+{
+    bool resolved = false;
+
+    if (!rule->classifier && (rule->classifier = qos_classifier_find(rule->classifier_name))) {
+        dep_link(&rule->classifier->users, &rule->classifier_dep);
+        resolved = true;
+    }
+    if (!rule->behavior && (rule->behavior = qos_behavior_find(rule->behavior_name))) {
+        dep_link(&rule->behavior->users, &rule->behavior_dep);
+        resolved = true;
+    }
+    return resolved;
+}
+
+static void policy_program_free(void *ptr)
+{
+    struct qos_policy_program *prog = ptr;
+    qos_cls_free(prog->cls);
+    free(prog);
+}
+
+/* Compile the rules whose classifier and behavior exist, in rule order */
+static struct qos_policy_program *policy_compile(struct traffic_policy *policy)
+{
+    struct traffic_classifier *list[QOS_POLICY_MAX_RULES];
+    struct qos_policy_program *prog = calloc(1, sizeof(*prog));
+    void *acl_ctx;
+
+    if (!prog) {
+        return NULL;
+    }
+    for (int i = 0; i < policy->rule_count; i++) {
+        struct policy_rule *rule = &policy->rules[i];
+        if (!rule->classifier || !rule->behavior) {
+            continue;
+        }
+        list[prog->match_count] = rule->classifier;
+        prog->matches[prog->match_count++] = (struct qos_policy_match) {
+            .rule = i, .classifier = rule->classifier, .behavior = rule->behavior,
+            .stats = rule->stats,
+        };
+    }
+
+    qos_cls_acl_fn acl_match = qos_classifier_acl_hook(&acl_ctx);
+    prog->cls = qos_cls_compile(list, prog->match_count, acl_match, acl_ctx);
+    if (!prog->cls) {
+        free(prog);
+        return NULL;
+    }
+    prog->generation = ++policy->generation;
+    prog->flow_cacheable = prog->cls->fields[QOS_FIELD_DSCP].segment_count == 0 &&
+                           prog->cls->fields[QOS_FIELD_LENGTH].segment_count == 0;
+    prog->flow_generation = flow_cache_invalidate();
+    return prog;
+}
+
+/*
+ * Recompile a stale policy and publish the program with one pointer
+ * swap. Datapath threads finish with the old program undisturbed; it is
+ * freed once each of them has passed a quiescent state.
+ */
+static int policy_publish(struct traffic_policy *policy)
+{
+    if (policy->program && !policy->stale) {
+        return 0;
+    }
+
+    struct qos_policy_program *prog = policy_compile(policy);
+    if (!prog) {
+        return -ENOMEM;
+    }
+    struct qos_policy_program *old = __atomic_exchange_n(&policy->program, prog, __ATOMIC_ACQ_REL);
+    qsbr_retire(old, policy_program_free);
+    policy->stale = false;
+    return 0;
+}
+
+/*
+ * Push an applied policy to the kernel. The filters follow the interface
+ * and direction; a policy that is not applied, or applied without an
+ * interface, holds no filters and is not an error. A bound interface that
+ * is not in the kernel is -ENODEV. Only rules marked dirty are encoded
+ * again; they stay dirty until a sync succeeds.
+ */
+static int policy_sync(struct traffic_policy *policy)
+{
+    int ifindex = policy->applied ? if_kernel_index(policy->applied_ifid) : 0;
+    bool egress = strcmp(policy->direction, "outbound") == 0;
+
+    if (policy->offload && (policy->offload->ifindex != ifindex || policy->offload->egress != egress)) {
+        qos_tc_detach(policy->offload);
+        policy->offload = NULL;
+    }
+    if (ifindex <= 0) {
+        bool bound = policy->applied && policy->applied_ifid != IFID_NONE;
+        policy->offload_error = bound ? -ENODEV : 0;
+        return policy->offload_error;
+    }
+    if (!policy->offload) {
+        policy->offload = qos_tc_attach(ifindex, egress);
+        if (!policy->offload) {
+            policy->offload_error = -ENOMEM;
+            return policy->offload_error;
+        }
+        policy->dirty_rules = ~0u;
+    }
+
+    struct qos_tc_rule rules[QOS_POLICY_MAX_RULES];
+    for (int i = 0; i < policy->rule_count; i++) {
+        rules[i].classifier = policy->rules[i].classifier;
+        rules[i].behavior = policy->rules[i].behavior;
+        rules[i].changed = (policy->dirty_rules >> i) & 1;
+    }
+    policy->offload_error = qos_tc_sync(policy->offload, rules, (uint32_t)policy->rule_count);
+    if (policy->offload_error == 0) {
+        policy->dirty_rules = 0;
+    }
+    return policy->offload_error;
+}
+
+/* Offload state for display */
+static void policy_offload_status(const struct traffic_policy *policy, char *buf, size_t size)
+{
+    if (policy->offload && policy->offload->error_rule >= 0) {
+        snprintf(buf, size, "software, classifier %s cannot be offloaded",
+                 policy->rules[policy->offload->error_rule].classifier_name);
+    } else if (policy->offload_error) {
+        snprintf(buf, size, "software, %s", strerror(-policy->offload_error));
+    } else if (policy->offload) {
+        snprintf(buf, size, "tc flower, %u filters", policy->offload->filter_count);
+    } else {
+        snprintf(buf, size, "software");
+    }
+}
+
+/* Report the result of a sync to the operator */
+static void policy_report(const struct traffic_policy *policy)
+{
+    char status[128];
+
+    if (!policy->applied) {
+        return;
+    }
+    policy_offload_status(policy, status, sizeof(status));
+    if (policy->offload_error) {
+        printf("Warning: Traffic policy %s not offloaded: %s\n", policy->name, status);
+    }
+}
+
+/*
+ * Bring an applied policy up to date after an edit: program, then kernel.
+ * A policy applied without an interface runs in software only.
+ */
+static void policy_update(struct traffic_policy *policy)
+{
+    if (!policy->applied) {
+        return;
+    }
+    if (policy_publish(policy) < 0) {
+        printf("Error: Out of memory compiling traffic policy %s\n", policy->name);
+    }
+    if (policy->applied_ifid != IFID_NONE && policy_sync(policy) < 0) {
+        policy_report(policy);
+    }
+}
+
+/* Sum the software counters since the last bind and the kernel filter counters */
+static void policy_read_counters(struct traffic_policy *policy)
+{
+    uint64_t packets[QOS_POLICY_MAX_RULES] = { 0 };
+    uint64_t bytes[QOS_POLICY_MAX_RULES] = { 0 };
+
+    if (policy->offload && policy->offload->filter_count > 0 &&
+        qos_tc_stats(policy->offload, packets, bytes, (uint32_t)policy->rule_count) < 0) {
+        memset(packets, 0, sizeof(packets));
+        memset(bytes, 0, sizeof(bytes));
+    }
+    for (int i = 0; i < policy->rule_count; i++) {
+        struct policy_rule *rule = &policy->rules[i];
+        struct pcpu_snapshot now, delta;
+
+        pcpu_counter_read(rule->stats, QOS_RULE_STAT_MAX, &now);
+        pcpu_snapshot_delta(&now, &rule->base, QOS_RULE_STAT_MAX, &delta);
+        rule->match_packets = delta.values[QOS_RULE_STAT_PACKETS] + packets[i];
+        rule->match_bytes = delta.values[QOS_RULE_STAT_BYTES] + bytes[i];
+    }
+}
+
+/* Packet and bit rates of a rule since its previous statistics display */
+static void policy_rule_rate(struct policy_rule *rule, double *pps, double *bps)
+{
+    struct pcpu_snapshot now = { .time_ns = pcpu_stats_now() };
+    struct pcpu_snapshot delta;
+
+    now.values[QOS_RULE_STAT_PACKETS] = rule->match_packets;
+    now.values[QOS_RULE_STAT_BYTES] = rule->match_bytes;
+    *pps = 0;
+    *bps = 0;
+    if (rule->shown.time_ns) {
+        pcpu_snapshot_delta(&now, &rule->shown, QOS_RULE_STAT_MAX, &delta);
+        *pps = pcpu_snapshot_rate(&delta, QOS_RULE_STAT_PACKETS);
+        *bps = pcpu_snapshot_rate(&delta, QOS_RULE_STAT_BYTES) * 8;
+    }
+    rule->shown = now;
+}
+
+/*
+ * Policy applied in a direction on an interface, or failing that one
+ * applied in that direction without an interface. NULL if none.
+ */
+struct traffic_policy *qos_policy_applied(ifid_t ifid, bool outbound)
+{
+    struct traffic_policy *any = NULL;
+
+    for (int i = 0; i < policy_count; i++) {
+        struct traffic_policy *policy = &policies[i];
+        if (!policy->applied || (strcmp(policy->direction, "outbound") == 0) != outbound) {
+            continue;
+        }
+        if (ifid != IFID_NONE && policy->applied_ifid == ifid) {
+            return policy;
+        }
+        if (policy->applied_ifid == IFID_NONE && !any) {
+            any = policy;
+        }
+    }
+    return any;
+}
+
+/*
+ * Recompile and resynchronize every applied policy, after a change that
+ * affects all classifiers such as a new ACL evaluator.
+ */
+void qos_policy_refresh(void)
+{
+    for (int i = 0; i < policy_count; i++) {
+        policies[i].stale = true;
+        policies[i].dirty_rules = ~0u;
+        policy_update(&policies[i]);
+    }
+}
+
+/* Add a policy to the set touched by an edit */
+static void touch(struct traffic_policy **touched, int *count, struct traffic_policy *policy)
+{
+    for (int i = 0; i < *count; i++) {
+        if (touched[i] == policy) {
+            return;
+        }
+    }
+    touched[(*count)++] = policy;
+}
+
+/*
+ * A classifier was created or edited: rules waiting for its name link to
+ * it, and the policies of its rules are recompiled and resynchronized.
+ * Other policies are not touched.
+ */
+void qos_policy_classifier_changed(struct traffic_classifier *classifier)
+{
+    struct traffic_policy *touched[128];
+    int count = 0;
+
+    for (int i = 0; i < policy_count; i++) {
+        for (int j = 0; j < policies[i].rule_count; j++) {
+            struct policy_rule *rule = &policies[i].rules[j];
+            if (!rule->classifier && strcmp(rule->classifier_name, classifier->name) == 0) {
+                rule_resolve(rule);
+            }
+        }
+    }
+
+    for (struct qos_dep *dep = classifier->users; dep; dep = dep->next) {
+        dep->policy->dirty_rules |= 1u << dep->rule;
+        dep->policy->stale = true;
+        touch(touched, &count, dep->policy);
+    }
+    for (int i = 0; i < count; i++) {
+        policy_update(touched[i]);
+    }
+}
+
+/*
+ * A behavior was created or edited. The programs of the policies using
+ * it are published again, so cached flow results taken before the edit
+ * go stale with them, and the filters of its rules are re-encoded.
+ */
+void qos_policy_behavior_changed(struct traffic_behavior *behavior)
+{
+    struct traffic_policy *touched[128];
+    int count = 0;
+
+    for (int i = 0; i < policy_count; i++) {
+        for (int j = 0; j < policies[i].rule_count; j++) {
+            struct policy_rule *rule = &policies[i].rules[j];
+            if (!rule->behavior && strcmp(rule->behavior_name, behavior->name) == 0 &&
+                rule_resolve(rule)) {
+                policies[i].stale = true;
+            }
+        }
+    }
+
+    for (struct qos_dep *dep = behavior->users; dep; dep = dep->next) {
+        dep->policy->dirty_rules |= 1u << dep->rule;
+        dep->policy->stale = true;
+        touch(touched, &count, dep->policy);
+    }
+    for (int i = 0; i < count; i++) {
+        policy_update(touched[i]);
+    }
+}
+
 /*
  * Create or enter traffic policy
  * Command: traffic policy <name>
@@ -52,13 +389,7 @@ static int cmd_traffic_policy(struct cmd_element *cmd, struct cmd_args *args)
     const char *name = args->argv[1];
 
     /* Find or create policy */
-    current_policy = NULL;
-    for (int i = 0; i < policy_count; i++) {
-        if (strcmp(policies[i].name, name) == 0) {
-            current_policy = &policies[i];
-            break;
-        }
-    }
+    current_policy = policy_find(name);
 
     if (!current_policy && policy_count < 128) {
         current_policy = &policies[policy_count++];
@@ -97,30 +428,64 @@ static int cmd_classifier_behavior(struct cmd_element *cmd, struct cmd_args *arg
     const char *classifier_name = args->argv[0];
     const char *behavior_name = args->argv[2];
 
-    if (current_policy->rule_count < 32) {
-        struct policy_rule *rule = &current_policy->rules[current_policy->rule_count++];
+    /* Binding a classifier again replaces its behavior, keeping its place */
+    struct policy_rule *rule = NULL;
+    for (int i = 0; i < current_policy->rule_count; i++) {
+        if (strcmp(current_policy->rules[i].classifier_name, classifier_name) == 0) {
+            rule = &current_policy->rules[i];
+            break;
+        }
+    }
+
+    if (!rule && current_policy->rule_count < QOS_POLICY_MAX_RULES) {
+        pcpu_counter_t stats = pcpu_counter_alloc(QOS_RULE_STAT_MAX);
+        if (stats == PCPU_COUNTER_NONE) {
+            printf("Error: Out of memory for rule counters\n");
+            return -1;
+        }
+        rule = &current_policy->rules[current_policy->rule_count++];
+        memset(rule, 0, sizeof(*rule));
         strncpy(rule->classifier_name, classifier_name, sizeof(rule->classifier_name) - 1);
-        strncpy(rule->behavior_name, behavior_name, sizeof(rule->behavior_name) - 1);
-        rule->match_packets = 0;
-        rule->match_bytes = 0;
-        printf("Classifier %s bound to behavior %s\n", classifier_name, behavior_name);
-    } else {
+        rule->stats = stats;
+        rule->classifier_dep = (struct qos_dep){ .policy = current_policy,
+                                                 .rule = current_policy->rule_count - 1 };
+        rule->behavior_dep = rule->classifier_dep;
+    }
+
+    if (!rule) {
         printf("Error: Maximum rules reached\n");
         return -1;
     }
 
+    if (rule->behavior) {
+        dep_unlink(&rule->behavior->users, &rule->behavior_dep);
+        rule->behavior = NULL;
+    }
+    memset(rule->behavior_name, 0, sizeof(rule->behavior_name));
+    strncpy(rule->behavior_name, behavior_name, sizeof(rule->behavior_name) - 1);
+    rule_resolve(rule);
+    /* Counting restarts with the new behavior */
+    pcpu_counter_read(rule->stats, QOS_RULE_STAT_MAX, &rule->base);
+    memset(&rule->shown, 0, sizeof(rule->shown));
+    rule->match_packets = 0;
+    rule->match_bytes = 0;
+    printf("Classifier %s bound to behavior %s\n", classifier_name, behavior_name);
+
+    current_policy->dirty_rules |= 1u << (rule - current_policy->rules);
+    current_policy->stale = true;
+    policy_update(current_policy);
     return 0;
 }
 
 /*
  * Apply policy to interface
- * Command: traffic-policy <policy-name> {inbound|outbound}
+ * Command: traffic-policy <policy-name> {inbound|outbound} [interface <interface-name>]
  */
 static int cmd_apply_traffic_policy(struct cmd_element *cmd, struct cmd_args *args)
 {
     if (args->argc < 2) {
         printf("Error: Policy name and direction required\n");
-        printf("Usage: traffic-policy <policy-name> {inbound|outbound}\n");
+        printf("Usage: traffic-policy <policy-name> {inbound|outbound} [interface <interface-name>]\n");
         return -1;
     }
 
@@ -132,24 +497,53 @@ static int cmd_apply_traffic_policy(struct cmd_element *cmd, struct cmd_args *ar
         return -1;
     }
 
-    /* Find policy */
-    struct traffic_policy *policy = NULL;
-    for (int i = 0; i < policy_count; i++) {
-        if (strcmp(policies[i].name, policy_name) == 0) {
-            policy = &policies[i];
-            break;
+    ifid_t ifid = IFID_NONE;
+    if (args->argc > 3 && strcmp(args->argv[2], "interface") == 0) {
+        ifid = if_intern(args->argv[3]);
+        if (ifid == IFID_NONE) {
+            printf("Error: Invalid interface name %s\n", args->argv[3]);
+            return -1;
         }
     }
 
+    /* Find policy */
+    struct traffic_policy *policy = policy_find(policy_name);
     if (!policy) {
         printf("Error: Policy %s not found\n", policy_name);
         return -1;
     }
 
+    /* One policy per interface and direction: their filters share the priorities */
+    for (int i = 0; i < policy_count && ifid != IFID_NONE; i++) {
+        if (&policies[i] != policy && policies[i].applied && policies[i].applied_ifid == ifid &&
+            strcmp(policies[i].direction, direction) == 0) {
+            printf("Error: Traffic policy %s already applied %s on %s\n",
+                   policies[i].name, direction, if_name(ifid));
+            return -1;
+        }
+    }
+
     policy->applied = true;
+    policy->applied_ifid = ifid;
+    memset(policy->direction, 0, sizeof(policy->direction));
     strncpy(policy->direction, direction, sizeof(policy->direction) - 1);
-    printf("Traffic policy %s applied %s\n", policy_name, direction);
 
+    if (policy_publish(policy) < 0) {
+        printf("Error: Out of memory compiling traffic policy %s\n", policy_name);
+        return -1;
+    }
+    if (ifid == IFID_NONE) {
+        printf("Traffic policy %s applied %s\n", policy_name, direction);
+        return 0;
+    }
+
+    printf("Traffic policy %s applied %s on %s\n", policy_name, direction, if_name(ifid));
+    if (policy_sync(policy) < 0) {
+        policy_report(policy);
+    } else {
+        printf("Offloaded to tc flower: %u filters, %u netlink messages\n",
+               policy->offload->filter_count, policy->offload->batch_messages);
+    }
     return 0;
 }
 
@@ -168,8 +562,20 @@ static int cmd_display_traffic_policy(struct cmd_element *cmd, struct cmd_args *
                 printf("  Rules: %d\n", policies[i].rule_count);
                 printf("  Applied: %s\n", policies[i].applied ? "Yes" : "No");
                 if (policies[i].applied) {
+                    char status[128];
+                    policy_offload_status(&policies[i], status, sizeof(status));
                     printf("  Direction: %s\n", policies[i].direction);
+                    if (policies[i].applied_ifid != IFID_NONE) {
+                        printf("  Interface: %s\n", if_name(policies[i].applied_ifid));
+                    }
+                    printf("  Offload: %s\n", status);
+                }
+                if (policies[i].program) {
+                    const struct qos_policy_program *prog = policies[i].program;
+                    printf("  Compiled: generation %lu, %u rules, %zu bytes\n",
+                           (unsigned long)prog->generation, prog->match_count, prog->cls->memory);
                 }
+                policy_read_counters(&policies[i]);
 
                 printf("\n  Policy Rules:\n");
                 printf("  %-20s %-20s %-15s %-15s\n",
@@ -223,28 +629,34 @@ static int cmd_display_qos_statistics(struct cmd_element *cmd, struct cmd_args *
     }
 
     const char *interface = args->argv[3];
+    ifid_t ifid = if_lookup(interface);
 
     printf("QoS Statistics for interface %s:\n\n", interface);
 
-    /* Find applied policies */
+    /* Find applied policies, including those applied without an interface */
     bool found = false;
     for (int i = 0; i < policy_count; i++) {
-        if (policies[i].applied) {
+        if (policies[i].applied &&
+            (policies[i].applied_ifid == IFID_NONE || policies[i].applied_ifid == ifid)) {
             found = true;
+            policy_read_counters(&policies[i]);
             printf("Policy: %s (%s)\n", policies[i].name, policies[i].direction);
-            printf("%-20s %-20s %-15s %-15s\n",
-                   "Classifier", "Behavior", "Packets", "Bytes");
-            printf("%-20s %-20s %-15s %-15s\n",
+            printf("%-20s %-20s %-15s %-15s %-12s %-12s\n",
+                   "Classifier", "Behavior", "Packets", "Bytes", "pps", "bps");
+            printf("%-20s %-20s %-15s %-15s %-12s %-12s\n",
                    "--------------------", "--------------------",
-                   "---------------", "---------------");
+                   "---------------", "---------------", "------------", "------------");
 
             for (int j = 0; j < policies[i].rule_count; j++) {
                 struct policy_rule *rule = &policies[i].rules[j];
-                printf("%-20s %-20s %-15lu %-15lu\n",
+                double pps, bps;
+                policy_rule_rate(rule, &pps, &bps);
+                printf("%-20s %-20s %-15lu %-15lu %-12.0f %-12.0f\n",
                        rule->classifier_name,
                        rule->behavior_name,
                        rule->match_packets,
-                       rule->match_bytes);
+                       rule->match_bytes,
+                       pps, bps);
             }
             printf("\n");
         }
@@ -257,21 +669,26 @@ static int cmd_display_qos_statistics(struct cmd_element *cmd, struct cmd_args *
     return 0;
 }
 
+/* Command registration */
+struct cmd_element policy_cmds[] = {
+    HUAWEI_CMD_WITH_CATEGORY("traffic policy", cmd_traffic_policy, NULL,
+                             "Configure traffic policy", CMD_CAT_QOS),
+    HUAWEI_CMD_WITH_CATEGORY("classifier", cmd_classifier_behavior, NULL,
+                             "Bind classifier to behavior", CMD_CAT_QOS),
+    HUAWEI_CMD_WITH_CATEGORY("traffic-policy", cmd_apply_traffic_policy, NULL,
+                             "Apply traffic policy to interface", CMD_CAT_QOS),
+    HUAWEI_CMD_WITH_CATEGORY("display traffic policy", cmd_display_traffic_policy, NULL,
+                             "Display traffic policies", CMD_CAT_QOS),
+    HUAWEI_CMD_WITH_CATEGORY("display qos statistics", cmd_display_qos_statistics, NULL,
+                             "Display QoS statistics", CMD_CAT_QOS),
+    { .name = NULL }
+};
+
 /*
  * Initialize QoS policy module
  */
 void qos_policy_init(void)
 {
     /* Register commands */
-    HUAWEI_CMD_WITH_CATEGORY("traffic policy", cmd_traffic_policy, NULL,
-                            "Configure traffic policy", "QoS");
-    HUAWEI_CMD_WITH_CATEGORY("classifier", cmd_classifier_behavior, NULL,
-                            "Bind classifier to behavior", "QoS");
-    HUAWEI_CMD_WITH_CATEGORY("traffic-policy", cmd_apply_traffic_policy, NULL,
-                            "Apply traffic policy to interface", "QoS");
-    HUAWEI_CMD_WITH_CATEGORY("display traffic policy", cmd_display_traffic_policy, NULL,
-                            "Display traffic policies", "QoS");
-    HUAWEI_CMD_WITH_CATEGORY("display qos statistics", cmd_display_qos_statistics, NULL,
-                            "Display QoS statistics", "QoS");
+    huawei_cli_register_table(policy_cmds, NULL);
 }
-
@@ -0,0 +1,67 @@
+/*
+ * QoS Traffic Behavior for Huawei VRP Style
+ * Copyright (C) 2026 WhiteBox NE Team
+ *
+ * Behavior definitions shared by the CLI, the policy module and the
+ * kernel offload backend.
+ */
+
+#ifndef _QOS_BEHAVIOR_H
+#define _QOS_BEHAVIOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "../frr_core/lib/if_registry.h"
+#include "../frr_core/lib/pcpu_stats.h"
+#include "qos_car.h"
+
+#define QOS_BEHAVIOR_MAX_ACTIONS 8
+
+/* Action types */
+typedef enum {
+    ACTION_TYPE_REMARK_DSCP = 0,
+    ACTION_TYPE_REMARK_IP_PRECEDENCE,
+    ACTION_TYPE_CAR,
+    ACTION_TYPE_PRIORITY,
+    ACTION_TYPE_DENY,
+    ACTION_TYPE_REDIRECT
+} action_type_t;
+
+/* CAR (Committed Access Rate) configuration */
+struct car_config {
+    uint32_t cir;  /* Committed Information Rate (kbps) */
+    uint32_t cbs;  /* Committed Burst Size (bytes) */
+    uint32_t pir;  /* Peak Information Rate (kbps), 0 for single rate */
+    uint32_t pbs;  /* Peak Burst Size (bytes), excess burst for single rate */
+    bool green_pass;
+    bool yellow_pass;
+    bool red_discard;
+    bool color_aware;
+};
+
+/* Traffic action */
+struct traffic_action {
+    action_type_t type;
+    union {
+        uint8_t dscp;
+        uint8_t ip_precedence;
+        struct car_config car;
+        uint8_t priority;
+        ifid_t redirect_ifid;
+    } value;
+    struct qos_car *policer;    /* ACTION_TYPE_CAR */
+};
+
+/* Traffic behavior */
+struct traffic_behavior {
+    char name[64];
+    struct traffic_action actions[QOS_BEHAVIOR_MAX_ACTIONS];
+    int action_count;           /* Released after the new slot is written */
+    pcpu_counter_t apply_stats;     /* Packets acted on, per-CPU */
+    struct qos_dep *users;          /* Policy rules using it, see qos_policy.h */
+};
+
+/* Behavior registry, behavior.c */
+struct traffic_behavior *qos_behavior_find(const char *name);
+
+#endif /* _QOS_BEHAVIOR_H */
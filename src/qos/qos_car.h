@@ -0,0 +1,89 @@
+/*
+ * QoS CAR Policer for Huawei VRP Style
+ * Copyright (C) 2026 WhiteBox NE Team
+ *
+ * Token bucket policer behind the "car" behavior action. Implements the
+ * single-rate (RFC 2697) and two-rate (RFC 2698) three-color markers in
+ * color-blind and color-aware mode. Tokens are kept in fixed point and
+ * refilled lazily from the time of the packet, so an idle policer costs
+ * nothing. Each CPU colors from a local token credit and borrows from the
+ * shared buckets under a lock only when the credit runs out, at most once
+ * per burst.
+ */
+
+#ifndef _QOS_CAR_H
+#define _QOS_CAR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "qos_color.h"
+
+#define QOS_CAR_SCALE       32          /* Token fraction bits */
+#define QOS_CAR_MAX_BURST   (1u << 30)  /* Largest bucket in bytes */
+#define QOS_CAR_MAX_CPUS    64
+#define QOS_CAR_CACHELINE   64
+
+/* Marker algorithm */
+typedef enum {
+    QOS_CAR_SRTCM = 0,      /* CIR, CBS, EBS: excess tokens spill into the E bucket */
+    QOS_CAR_TRTCM           /* CIR, CBS, PIR, PBS */
+} qos_car_mode_t;
+
+/* Policer parameters, rates in kbit/s and bursts in bytes */
+struct qos_car_params {
+    qos_car_mode_t mode;
+    uint64_t cir;
+    uint32_t cbs;
+    uint64_t pir;           /* trTCM only */
+    uint32_t pbs;           /* EBS for srTCM */
+    bool color_aware;       /* Packets arrive pre-colored */
+};
+
+/* Per-CPU token credit and counters, one cache line each */
+struct qos_car_cpu {
+    uint64_t credit_c;      /* Scaled tokens borrowed from the C bucket */
+    uint64_t credit_p;      /* Scaled tokens borrowed from the P / E bucket */
+    uint64_t retry_c_ns;    /* C bucket ran dry: no borrowing before this time */
+    uint64_t retry_p_ns;
+    uint64_t packets[QOS_COLOR_MAX];
+    uint64_t bytes[QOS_COLOR_MAX];
+} __attribute__((aligned(QOS_CAR_CACHELINE)));
+
+/* Policer instance */
+struct qos_car {
+    struct qos_car_params params;
+    uint64_t rate_c;        /* Scaled tokens per ns */
+    uint64_t rate_p;
+    uint64_t size_c;        /* Scaled bucket sizes */
+    uint64_t size_p;
+    uint64_t quantum;       /* Scaled tokens a CPU borrows beyond its need */
+
+    pthread_spinlock_t lock;
+    uint64_t tokens_c;      /* Shared buckets, under lock */
+    uint64_t tokens_p;
+    uint64_t last_ns;
+
+    uint32_t cpu_count;
+    struct qos_car_cpu *cpus;
+};
+
+/* Policer totals */
+struct qos_car_stats {
+    uint64_t packets[QOS_COLOR_MAX];
+    uint64_t bytes[QOS_COLOR_MAX];
+};
+
+struct qos_car *qos_car_create(const struct qos_car_params *params, uint32_t cpu_count);
+void qos_car_destroy(struct qos_car *car);
+qos_color_t qos_car_color(struct qos_car *car, uint32_t cpu, uint64_t now_ns,
+                          uint32_t length, qos_color_t in_color);
+void qos_car_color_burst(struct qos_car *car, uint32_t cpu, uint64_t now_ns,
+                         const uint16_t *lengths, const uint8_t *in_colors,
+                         uint8_t *out_colors, uint32_t count);
+void qos_car_reconcile(struct qos_car *car);
+void qos_car_get_stats(const struct qos_car *car, struct qos_car_stats *stats);
+uint64_t qos_car_now_ns(void);
+uint32_t qos_car_cpu(const struct qos_car *car);
+
+#endif /* _QOS_CAR_H */
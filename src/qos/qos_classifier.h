@@ -0,0 +1,161 @@
+/*
+ * QoS Traffic Classifier for Huawei VRP Style
+ * Copyright (C) 2026 WhiteBox NE Team
+ *
+ * Classifier definitions shared by the CLI and the compiled classifier.
+ * The classifiers of a policy are compiled into one program that matches
+ * a parsed packet header against all of them at once: each header
+ * field is mapped to a bitset of classifiers by a small lookup table
+ * or a binary search over interval boundaries, and the field bitsets
+ * are combined with AND / OR per classifier operator.
+ *
+ * Small programs whose classifiers only use addresses, ports and the
+ * protocol are also compiled into a pkt_match table, and bursts of
+ * headers are matched by its vector kernel.
+ */
+
+#ifndef _QOS_CLASSIFIER_H
+#define _QOS_CLASSIFIER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "../frr_core/lib/if_registry.h"
+#include "../frr_core/lib/pcpu_stats.h"
+#include "../frr_core/lib/pkt_match.h"
+
+#define QOS_CLASSIFIER_MAX_CONDITIONS 16
+
+/* Match types */
+typedef enum {
+    MATCH_TYPE_ACL = 0,
+    MATCH_TYPE_DSCP,
+    MATCH_TYPE_IP_PRECEDENCE,
+    MATCH_TYPE_SOURCE_IP,
+    MATCH_TYPE_DEST_IP,
+    MATCH_TYPE_SOURCE_PORT,
+    MATCH_TYPE_DEST_PORT,
+    MATCH_TYPE_PROTOCOL,
+    MATCH_TYPE_INTERFACE,
+    MATCH_TYPE_PACKET_LENGTH
+} match_type_t;
+
+/* Relation between the conditions of a classifier */
+typedef enum {
+    CLASSIFIER_OPERATOR_OR = 0,     /* Any condition matches (default) */
+    CLASSIFIER_OPERATOR_AND         /* All conditions match */
+} classifier_operator_t;
+
+/* Match condition, addresses and ranges parsed at configuration time */
+struct match_condition {
+    match_type_t type;
+    union {
+        uint16_t acl_number;
+        uint8_t dscp;
+        uint8_t ip_precedence;
+        struct {
+            uint32_t addr;          /* Host byte order */
+            uint8_t prefix_len;
+        } ip;
+        struct {
+            uint16_t min;
+            uint16_t max;
+        } port;
+        uint8_t protocol;
+        ifid_t ifid;
+        struct {
+            uint16_t min;
+            uint16_t max;
+        } packet_length;
+    } value;
+};
+
+/* Traffic classifier */
+struct traffic_classifier {
+    char name[64];
+    classifier_operator_t operator;
+    struct match_condition conditions[QOS_CLASSIFIER_MAX_CONDITIONS];
+    int condition_count;
+    pcpu_counter_t match_stats;     /* Matched packets, per-CPU */
+    struct qos_dep *users;          /* Policy rules using it, see qos_policy.h */
+};
+
+/* Parsed packet header, addresses in host byte order */
+struct qos_flow_key {
+    uint32_t src_ip;
+    uint32_t dst_ip;
+    uint16_t src_port;
+    uint16_t dst_port;
+    uint8_t protocol;
+    uint8_t dscp;               /* IP precedence is dscp >> 3 */
+    uint16_t length;
+    ifid_t ifid;                /* Receiving interface */
+};
+
+/* Header fields the program dispatches on */
+typedef enum {
+    QOS_FIELD_DSCP = 0,
+    QOS_FIELD_PROTOCOL,
+    QOS_FIELD_SRC_IP,
+    QOS_FIELD_DST_IP,
+    QOS_FIELD_SRC_PORT,
+    QOS_FIELD_DST_PORT,
+    QOS_FIELD_LENGTH,
+    QOS_FIELD_INTERFACE,
+    QOS_FIELD_MAX
+} qos_field_t;
+
+/* Per-field map from header value to a classifier bitset */
+struct qos_cls_field {
+    uint32_t segment_count;     /* 0 when no classifier matches on the field */
+    uint32_t *bounds;           /* Segment start values, ascending, bounds[0] = 0 */
+    uint16_t *segment_class;    /* Segment -> class */
+    uint16_t *direct;           /* Value -> class for small domains, or NULL */
+    uint32_t direct_size;
+    uint32_t *index;            /* value >> index_shift -> first candidate segment, or NULL */
+    uint32_t index_shift;
+    uint32_t index_size;
+    uint32_t class_count;
+    uint64_t *classes;          /* class_count bitsets of program->words words */
+};
+
+/* ACL verdict for classifiers matching an ACL */
+typedef bool (*qos_cls_acl_fn)(uint16_t acl_number, const struct qos_flow_key *key, void *ctx);
+
+/* Compiled classifier program */
+struct qos_cls_program {
+    uint32_t classifier_count;
+    uint32_t words;             /* 64-bit words per bitset */
+    struct traffic_classifier **classifiers;   /* Bit index -> classifier */
+    uint64_t *and_mask;         /* Classifiers using operator and */
+    uint64_t *or_mask;          /* Classifiers using operator or */
+    int active[QOS_FIELD_MAX];  /* Fields with conditions, in lookup order */
+    int active_count;
+    struct qos_cls_field fields[QOS_FIELD_MAX];
+    uint32_t acl_count;
+    uint16_t *acl_numbers;
+    uint64_t *acl_masks;        /* acl_count bitsets of classifiers using the ACL */
+    qos_cls_acl_fn acl_match;
+    void *acl_ctx;
+    struct pkt_match_table *burst;      /* 5-tuple rules of small programs, or NULL */
+    size_t memory;              /* Bytes held by the program */
+};
+
+/* Compiler, classifier_compile.c */
+struct qos_cls_program *qos_cls_compile(struct traffic_classifier **classifiers, uint32_t count,
+                                        qos_cls_acl_fn acl_match, void *acl_ctx);
+void qos_cls_free(struct qos_cls_program *prog);
+void qos_cls_lookup(const struct qos_cls_program *prog, const struct qos_flow_key *key,
+                    uint64_t *match);
+int qos_cls_first(const struct qos_cls_program *prog, const struct qos_flow_key *key);
+void qos_cls_first_burst(const struct qos_cls_program *prog, const struct qos_flow_key *keys,
+                         uint32_t count, int *first);
+bool qos_classifier_match(const struct traffic_classifier *classifier,
+                          const struct qos_flow_key *key,
+                          qos_cls_acl_fn acl_match, void *acl_ctx);
+
+/* Classifier registry, classifier.c */
+struct traffic_classifier *qos_classifier_find(const char *name);
+void qos_classifier_set_acl_hook(qos_cls_acl_fn acl_match, void *acl_ctx);
+qos_cls_acl_fn qos_classifier_acl_hook(void **acl_ctx);
+
+#endif /* _QOS_CLASSIFIER_H */
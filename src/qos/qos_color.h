@@ -0,0 +1,32 @@
+/*
+ * QoS Packet Color for Huawei VRP Style
+ * Copyright (C) 2026 WhiteBox NE Team
+ *
+ * Drop precedence assigned by the CAR policer and consumed by the
+ * congestion avoidance and scheduling stages. Packets enter pre-colored
+ * from the drop precedence of their Assured Forwarding DSCP (RFC 2597).
+ */
+
+#ifndef _QOS_COLOR_H
+#define _QOS_COLOR_H
+
+/* Packet color */
+typedef enum {
+    QOS_COLOR_GREEN = 0,
+    QOS_COLOR_YELLOW,
+    QOS_COLOR_RED,
+    QOS_COLOR_MAX
+} qos_color_t;
+
+/* AFx1 is green, AFx2 yellow, AFx3 red; any other DSCP is green */
+static inline qos_color_t qos_color_from_dscp(unsigned int dscp)
+{
+    unsigned int af_class = dscp >> 3, precedence = (dscp >> 1) & 3;
+
+    if (af_class < 1 || af_class > 4 || (dscp & 1) || precedence == 0) {
+        return QOS_COLOR_GREEN;
+    }
+    return (qos_color_t)(precedence - 1);
+}
+
+#endif /* _QOS_COLOR_H */
@@ -0,0 +1,122 @@
+/*
+ * QoS Traffic Policy for Huawei VRP Style
+ * Copyright (C) 2026 WhiteBox NE Team
+ *
+ * Policy definitions shared by the CLI and the kernel offload. A policy
+ * is an ordered list of classifier -> behavior rules; applied to an
+ * interface it is pushed to tc/flower when every rule can be expressed
+ * there, and runs in software otherwise.
+ *
+ * Rule counters are the sum of the software path, kept in a per-CPU
+ * group, and the kernel filter counters when offloaded.
+ *
+ * Every rule links itself into the user lists of its classifier and
+ * behavior. An edit follows those edges to the affected rules and
+ * policies only: their compiled programs are rebuilt and published with
+ * one pointer swap, the old program freed under QSBR once no datapath
+ * thread can hold it, and only the filters of the affected rules are
+ * re-encoded for the kernel.
+ *
+ * Programs that do not match on DSCP or packet length decide the same
+ * for every packet of a flow; the datapath may keep their results in a
+ * flow cache, tagged with the program's flow generation.
+ */
+
+#ifndef _QOS_POLICY_H
+#define _QOS_POLICY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "../frr_core/lib/if_registry.h"
+#include "../frr_core/lib/pcpu_stats.h"
+#include "qos_classifier.h"
+#include "qos_behavior.h"
+#include "tc_offload.h"
+
+#define QOS_POLICY_MAX_RULES    32
+
+/* Counters of the per-CPU group of a rule */
+enum {
+    QOS_RULE_STAT_PACKETS = 0,
+    QOS_RULE_STAT_BYTES,
+    QOS_RULE_STAT_MAX
+};
+
+struct traffic_policy;
+
+/* Dependency edge: a policy rule using a classifier or behavior */
+struct qos_dep {
+    struct qos_dep *next;           /* Next user of the same classifier / behavior */
+    struct traffic_policy *policy;
+    int rule;
+};
+
+/* Policy rule */
+struct policy_rule {
+    char classifier_name[64];
+    char behavior_name[64];
+    struct traffic_classifier *classifier;  /* NULL until a classifier of that name exists */
+    struct traffic_behavior *behavior;
+    struct qos_dep classifier_dep;  /* On classifier->users while resolved */
+    struct qos_dep behavior_dep;    /* On behavior->users while resolved */
+    pcpu_counter_t stats;           /* Software path, updated with pcpu_counter_add2() */
+    struct pcpu_snapshot base;      /* Software totals at the last bind */
+    struct pcpu_snapshot shown;     /* Totals at the last statistics display */
+    uint64_t match_packets;         /* Software + kernel, as last read */
+    uint64_t match_bytes;
+};
+
+/* Rule of a compiled program */
+struct qos_policy_match {
+    int rule;                       /* Index in the policy */
+    struct traffic_classifier *classifier;
+    struct traffic_behavior *behavior;
+    pcpu_counter_t stats;
+};
+
+/*
+ * Compiled form of a policy, read by the datapath without locks. Bit i
+ * of the classifier program is matches[i]; matches are in rule order,
+ * so the first matching bit is the first matching rule.
+ */
+struct qos_policy_program {
+    struct qos_cls_program *cls;
+    uint32_t match_count;
+    struct qos_policy_match matches[QOS_POLICY_MAX_RULES];
+    uint64_t generation;            /* Compilations of the policy so far */
+    uint64_t flow_generation;       /* flow_cache_invalidate() at compile time */
+    bool flow_cacheable;            /* Decided by 5-tuple and interface alone */
+};
+
+/* Traffic policy */
+struct traffic_policy {
+    char name[64];
+    struct policy_rule rules[QOS_POLICY_MAX_RULES];
+    int rule_count;
+    bool applied;
+    ifid_t applied_ifid;
+    char direction[16];  /* inbound/outbound */
+    struct qos_tc_state *offload;   /* Kernel filters, NULL when not offloaded */
+    int offload_error;              /* Last sync result, negative errno */
+    struct qos_policy_program *program;     /* Applied policies, swapped under QSBR */
+    bool stale;                     /* Program predates an edit */
+    uint32_t dirty_rules;           /* Rules not synced to the kernel since an edit */
+    uint64_t generation;
+};
+
+/* Policy registry, policy.c */
+void qos_policy_refresh(void);
+void qos_policy_classifier_changed(struct traffic_classifier *classifier);
+void qos_policy_behavior_changed(struct traffic_behavior *behavior);
+struct traffic_policy *qos_policy_applied(ifid_t ifid, bool outbound);
+
+/*
+ * Program of an applied policy, NULL if it has none. The caller must be
+ * a QSBR reader; the program stays valid until its next quiescent state.
+ */
+static inline const struct qos_policy_program *qos_policy_program(const struct traffic_policy *policy)
+{
+    return __atomic_load_n(&policy->program, __ATOMIC_ACQUIRE);
+}
+
+#endif /* _QOS_POLICY_H */
@@ -0,0 +1,1178 @@
+/*
+ * QoS Packet Replay Benchmark for Huawei VRP Style
+ * Copyright (C) 2026 WhiteBox NE Team
+ *
+ * This program measures the QoS chain under recorded traffic including:
+ * - Loading a VRP-format configuration through the QoS command handlers
+ * - Reading a pcap or pcapng trace with mmap, headers parsed into batches
+ * - Classification, behavior actions with CAR, and WRED / PQ + DRR
+ *   queueing of every batch, exactly as configured
+ * - Mpps, ns/packet and cache misses (perf_event_open) per stage
+ * - Per-class packets, colors, drops and transmissions
+ * - Optionally a flow cache in front of the traffic-filter ACL and
+ *   classification, with its hit rate, evictions, bypassed lookups and
+ *   lookup latency
+ *
+ * The policy applied inbound on the ingress interface (or applied without
+ * an interface) selects the rules, the queue profile of the egress
+ * interface (or the first profile) the queues. A packet goes to the queue
+ * of its behavior priority, otherwise to its IP precedence after any
+ * remark. It reaches CAR colored by its AF drop precedence, and chained
+ * policers see the previous color. CAR and the shapers run on trace time,
+ * so marking does not depend on replay speed.
+ * An inbound traffic-filter on the ingress interface drops the packets
+ * its ACL denies before QoS; if-match acl conditions hold when the first
+ * matching rule of the ACL permits.
+ *
+ * Usage: qos_replay_bench -c config -f trace [-i ingress] [-o egress]
+ *                         [-r repeats] [-b batch] [-F flows]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "../frr_core/lib/huawei_cli.h"
+#include "../frr_core/lib/cfg_loader.h"
+#include "../frr_core/lib/if_registry.h"
+#include "../frr_core/lib/pcpu_stats.h"
+#include "../frr_core/lib/qsbr.h"
+#include "../frr_core/lib/flow_cache.h"
+#include "../ip_services/acl/acl_huawei.h"
+#include "../ip_services/acl/acl_lookup.h"
+#include "qos_classifier.h"
+#include "qos_behavior.h"
+#include "qos_policy.h"
+#include "qos_sched.h"
+
+#define REPLAY_MAX_BATCH        1024
+#define REPLAY_MAX_IFACES       16      /* pcapng interfaces per section */
+#define REPLAY_CLASSES          (QOS_POLICY_MAX_RULES + 1)  /* Rules + default */
+#define REPLAY_POOL             65536   /* Packet handles */
+
+#define LINKTYPE_NULL           0
+#define LINKTYPE_ETHERNET       1
+#define LINKTYPE_RAW            101
+#define LINKTYPE_LINUX_SLL      113
+#define LINKTYPE_IPV4           228
+#define LINKTYPE_LINUX_SLL2     276
+
+/* Pipeline stages */
+enum {
+    STAGE_PARSE = 0,
+    STAGE_CLASSIFY,
+    STAGE_BEHAVIOR,
+    STAGE_QUEUE,
+    STAGE_MAX
+};
+
+static const char *const stage_names[STAGE_MAX] = { "parse", "classify", "behavior+car",
+                                                    "queue" };
+
+/* Hardware counters read per stage */
+enum {
+    PERF_CACHE_MISSES = 0,
+    PERF_INSTRUCTIONS,
+    PERF_CYCLES,
+    PERF_MAX
+};
+
+/* Trace formats */
+typedef enum {
+    TRACE_PCAP = 0,
+    TRACE_PCAPNG
+} trace_format_t;
+
+/* Memory-mapped capture file */
+struct trace {
+    const uint8_t *base;
+    size_t size;
+    size_t pos;
+    trace_format_t format;
+    bool swap;                  /* File byte order differs from ours */
+    uint32_t linktype;          /* pcap */
+    uint64_t ts_scale;          /* pcap: ns per fraction unit */
+    uint32_t iface_count;       /* pcapng, current section */
+    uint32_t iface_linktype[REPLAY_MAX_IFACES];
+    uint32_t iface_snaplen[REPLAY_MAX_IFACES];
+    uint64_t iface_units[REPLAY_MAX_IFACES];   /* Timestamp units per second */
+};
+
+/* One captured frame */
+struct trace_record {
+    const uint8_t *data;
+    uint32_t caplen;
+    uint32_t wirelen;
+    uint32_t linktype;
+    uint64_t ts_ns;
+};
+
+/* Parsed headers of a batch, one slot per packet */
+struct replay_batch {
+    uint32_t count;
+    struct qos_flow_key keys[REPLAY_MAX_BATCH];
+    uint32_t length[REPLAY_MAX_BATCH];      /* Frame length on the wire */
+    uint64_t ts_ns[REPLAY_MAX_BATCH];       /* Trace time */
+    int8_t match[REPLAY_MAX_BATCH];         /* Matched program entry, -1 for none */
+    int8_t rule[REPLAY_MAX_BATCH];          /* Its policy rule, -1 for default */
+    uint8_t verdict[REPLAY_MAX_BATCH];      /* FLOW_ACL_* of the traffic-filter */
+    uint8_t queue[REPLAY_MAX_BATCH];
+    uint8_t color[REPLAY_MAX_BATCH];
+    bool drop[REPLAY_MAX_BATCH];
+};
+
+/* Results of one class */
+struct replay_class {
+    uint64_t packets;
+    uint64_t bytes;
+    uint64_t colors[QOS_COLOR_MAX];
+    uint64_t denied;            /* deny action or CAR discard */
+    uint64_t queue_drops;       /* WRED, tail drop or no packet handle */
+    uint64_t sent;
+    uint64_t sent_bytes;
+};
+
+/* Cost of one stage */
+struct replay_stage {
+    uint64_t ns;
+    uint64_t perf[PERF_MAX];
+};
+
+/* Replay state */
+struct replay {
+    struct traffic_policy *policy;
+    const struct qos_policy_program *prog;  /* Of the current batch */
+    struct flow_cache *flows;   /* NULL without -F */
+    uint64_t generation;        /* Flow cache generation of the current batch */
+    uint32_t acl;               /* Inbound traffic-filter of the ingress, 0 for none */
+    struct qos_sched *sched;
+    int port;
+    ifid_t ingress;
+
+    struct qos_pkt *pool;
+    struct qos_pkt *free_list;
+    uint64_t clock_ns;          /* Trace time of the pipeline, never goes back */
+    uint64_t offset_ns;         /* Added to trace time, one trace span per repeat */
+    uint64_t trace_start_ns;    /* Time of the first packet in the trace */
+
+    struct replay_class classes[REPLAY_CLASSES];
+    struct replay_stage stages[STAGE_MAX];
+    uint64_t packets;
+    uint64_t skipped;           /* Non-IPv4 or truncated frames */
+    uint64_t pool_drops;        /* Admitted with every packet handle queued */
+    uint64_t acl_denied;        /* Dropped by the traffic-filter */
+
+    int perf_fd[PERF_MAX];
+    int perf_count;
+    uint64_t boundary_ns;       /* Cost of one stage boundary */
+    uint64_t boundary_perf[PERF_MAX];
+};
+
+void qos_module_init(void);
+void register_acl_cmds(void);
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static inline uint16_t rd16be(const uint8_t *p)
+{
+    return (uint16_t)(p[0] << 8 | p[1]);
+}
+
+static inline uint32_t rd32be(const uint8_t *p)
+{
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+static inline uint16_t trace16(const struct trace *t, const uint8_t *p)
+{
+    uint16_t v;
+    memcpy(&v, p, sizeof(v));
+    return t->swap ? __builtin_bswap16(v) : v;
+}
+
+static inline uint32_t trace32(const struct trace *t, const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return t->swap ? __builtin_bswap32(v) : v;
+}
+
+/* ------------------------------------------------------------------ */
+/* Capture files                                                       */
+/* ------------------------------------------------------------------ */
+
+/* pcapng section header at t->pos: byte order of the section */
+static int trace_pcapng_section(struct trace *t)
+{
+    const uint8_t *p = t->base + t->pos;
+    uint32_t magic;
+
+    if (t->size - t->pos < 28) {
+        return -1;
+    }
+    memcpy(&magic, p + 8, sizeof(magic));
+    if (magic == 0x1A2B3C4D) {
+        t->swap = false;
+    } else if (magic == 0x4D3C2B1A) {
+        t->swap = true;
+    } else {
+        return -1;
+    }
+    t->iface_count = 0;
+    return 0;
+}
+
+/* pcapng interface description: link type, snap length, timestamp resolution */
+static void trace_pcapng_iface(struct trace *t, const uint8_t *body, uint32_t body_len)
+{
+    if (t->iface_count >= REPLAY_MAX_IFACES || body_len < 8) {
+        return;
+    }
+    uint32_t i = t->iface_count++;
+    t->iface_linktype[i] = trace16(t, body);
+    t->iface_snaplen[i] = trace32(t, body + 4);
+    t->iface_units[i] = 1000000;
+
+    /* Options: code, length, value padded to 32 bits */
+    for (uint32_t off = 8; off + 4 <= body_len;) {
+        uint16_t code = trace16(t, body + off);
+        uint16_t len = trace16(t, body + off + 2);
+        if (code == 0 || off + 4 + len > body_len) {
+            break;
+        }
+        if (code == 9 && len >= 1) {    /* if_tsresol */
+            uint8_t res = body[off + 4];
+            uint64_t units = 1;
+            for (uint32_t e = 0; e < (res & 0x7f) && units < 1000000000000ull; e++) {
+                units *= res & 0x80 ? 2 : 10;
+            }
+            t->iface_units[i] = units;
+        }
+        off += 4 + ((len + 3u) & ~3u);
+    }
+}
+
+static int trace_open(struct trace *t, const char *path)
+{
+    memset(t, 0, sizeof(*t));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < 24) {
+        close(fd);
+        errno = EINVAL;
+        return -1;
+    }
+    void *base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        return -1;
+    }
+    madvise(base, (size_t)st.st_size, MADV_SEQUENTIAL);
+    t->base = base;
+    t->size = (size_t)st.st_size;
+
+    uint32_t magic;
+    memcpy(&magic, t->base, sizeof(magic));
+    switch (magic) {
+    case 0xA1B2C3D4:
+    case 0xA1B23C4D:
+    case 0xD4C3B2A1:
+    case 0x4D3CB2A1:
+        t->format = TRACE_PCAP;
+        t->swap = magic == 0xD4C3B2A1 || magic == 0x4D3CB2A1;
+        t->ts_scale = magic == 0xA1B23C4D || magic == 0x4D3CB2A1 ? 1 : 1000;
+        t->linktype = trace32(t, t->base + 20) & 0x0fffffff;
+        t->pos = 24;
+        return 0;
+    case 0x0A0D0D0A:
+        t->format = TRACE_PCAPNG;
+        if (trace_pcapng_section(t) == 0) {
+            return 0;
+        }
+        break;
+    default:
+        break;
+    }
+    munmap((void *)t->base, t->size);
+    t->base = NULL;
+    errno = EINVAL;
+    return -1;
+}
+
+static void trace_close(struct trace *t)
+{
+    if (t->base) {
+        munmap((void *)t->base, t->size);
+        t->base = NULL;
+    }
+}
+
+static void trace_rewind(struct trace *t)
+{
+    if (t->format == TRACE_PCAP) {
+        t->pos = 24;
+    } else {
+        t->pos = 0;
+        trace_pcapng_section(t);
+    }
+}
+
+/* Next frame, false at the end of the file or on a malformed record */
+static bool trace_next(struct trace *t, struct trace_record *rec)
+{
+    if (t->format == TRACE_PCAP) {
+        if (t->size - t->pos < 16) {
+            return false;
+        }
+        const uint8_t *hdr = t->base + t->pos;
+        uint32_t caplen = trace32(t, hdr + 8);
+        if (caplen > t->size - t->pos - 16) {
+            return false;
+        }
+        rec->ts_ns = (uint64_t)trace32(t, hdr) * 1000000000ull +
+                     (uint64_t)trace32(t, hdr + 4) * t->ts_scale;
+        rec->caplen = caplen;
+        rec->wirelen = trace32(t, hdr + 12);
+        rec->linktype = t->linktype;
+        rec->data = hdr + 16;
+        t->pos += 16 + caplen;
+        return true;
+    }
+
+    while (t->size - t->pos >= 12) {
+        const uint8_t *blk = t->base + t->pos;
+        uint32_t type = trace32(t, blk);    /* Section header type reads the same either way */
+        if (type == 0x0A0D0D0A && trace_pcapng_section(t) != 0) {
+            return false;
+        }
+        uint32_t len = trace32(t, blk + 4);
+        if (len < 12 || (len & 3) || len > t->size - t->pos) {
+            return false;
+        }
+        const uint8_t *body = blk + 8;
+        uint32_t body_len = len - 12;
+        t->pos += len;
+
+        if (type == 1) {
+            trace_pcapng_iface(t, body, body_len);
+        } else if (type == 6 && body_len >= 20) {           /* Enhanced packet */
+            uint32_t iface = trace32(t, body);
+            uint32_t caplen = trace32(t, body + 12);
+            if (iface >= t->iface_count || caplen > body_len - 20) {
+                continue;
+            }
+            uint64_t ts = (uint64_t)trace32(t, body + 4) << 32 | trace32(t, body + 8);
+            uint64_t units = t->iface_units[iface];
+            rec->ts_ns = ts / units * 1000000000ull + ts % units * 1000000000ull / units;
+            rec->caplen = caplen;
+            rec->wirelen = trace32(t, body + 16);
+            rec->linktype = t->iface_linktype[iface];
+            rec->data = body + 20;
+            return true;
+        } else if (type == 3 && body_len >= 4 && t->iface_count > 0) {  /* Simple packet */
+            uint32_t wirelen = trace32(t, body);
+            uint32_t caplen = wirelen;
+            if (t->iface_snaplen[0] && caplen > t->iface_snaplen[0]) {
+                caplen = t->iface_snaplen[0];
+            }
+            if (caplen > body_len - 4) {
+                caplen = body_len - 4;
+            }
+            rec->ts_ns = 0;
+            rec->caplen = caplen;
+            rec->wirelen = wirelen;
+            rec->linktype = t->iface_linktype[0];
+            rec->data = body + 4;
+            return true;
+        }
+    }
+    return false;
+}
+
+/* ------------------------------------------------------------------ */
+/* Header parsing                                                      */
+/* ------------------------------------------------------------------ */
+
+/* IPv4 header of a frame, NULL for other link or network protocols */
+static const uint8_t *frame_ipv4(const struct trace_record *rec, uint32_t *avail)
+{
+    const uint8_t *p = rec->data;
+    uint32_t len = rec->caplen;
+    uint16_t ethertype;
+
+    switch (rec->linktype) {
+    case LINKTYPE_ETHERNET:
+        if (len < 14) {
+            return NULL;
+        }
+        ethertype = rd16be(p + 12);
+        p += 14;
+        len -= 14;
+        /* 802.1Q / 802.1ad tags */
+        while ((ethertype == 0x8100 || ethertype == 0x88a8) && len >= 4) {
+            ethertype = rd16be(p + 2);
+            p += 4;
+            len -= 4;
+        }
+        break;
+    case LINKTYPE_LINUX_SLL:
+        if (len < 16) {
+            return NULL;
+        }
+        ethertype = rd16be(p + 14);
+        p += 16;
+        len -= 16;
+        break;
+    case LINKTYPE_LINUX_SLL2:
+        if (len < 20) {
+            return NULL;
+        }
+        ethertype = rd16be(p);
+        p += 20;
+        len -= 20;
+        break;
+    case LINKTYPE_NULL:
+        if (len < 4) {
+            return NULL;
+        }
+        ethertype = (p[0] == 2 || p[3] == 2) ? 0x0800 : 0;  /* AF_INET, either order */
+        p += 4;
+        len -= 4;
+        break;
+    case LINKTYPE_RAW:
+    case LINKTYPE_IPV4:
+        ethertype = 0x0800;
+        break;
+    default:
+        return NULL;
+    }
+
+    if (ethertype != 0x0800 || len < 20 || (p[0] >> 4) != 4) {
+        return NULL;
+    }
+    *avail = len;
+    return p;
+}
+
+/* Fill key from a frame, false for frames the QoS chain does not see */
+static bool frame_parse(const struct trace_record *rec, ifid_t ifid, struct qos_flow_key *key)
+{
+    uint32_t avail;
+    const uint8_t *ip = frame_ipv4(rec, &avail);
+    if (!ip) {
+        return false;
+    }
+    uint32_t ihl = (ip[0] & 0x0f) * 4u;
+    if (ihl < 20 || ihl > avail) {
+        return false;
+    }
+
+    key->dscp = ip[1] >> 2;
+    key->length = rd16be(ip + 2);
+    key->protocol = ip[9];
+    key->src_ip = rd32be(ip + 12);
+    key->dst_ip = rd32be(ip + 16);
+    key->src_port = 0;
+    key->dst_port = 0;
+    key->ifid = ifid;
+
+    /* Ports of the first fragment only */
+    bool ports = key->protocol == 6 || key->protocol == 17 || key->protocol == 132;
+    if (ports && (rd16be(ip + 6) & 0x1fff) == 0 && avail >= ihl + 4) {
+        key->src_port = rd16be(ip + ihl);
+        key->dst_port = rd16be(ip + ihl + 2);
+    }
+    return true;
+}
+
+/* ------------------------------------------------------------------ */
+/* Hardware counters                                                   */
+/* ------------------------------------------------------------------ */
+
+static void perf_open(struct replay *r)
+{
+    static const uint64_t configs[PERF_MAX] = {
+        PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CPU_CYCLES
+    };
+
+    r->perf_count = 0;
+    for (int i = 0; i < PERF_MAX; i++) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = configs[i];
+        attr.disabled = i == 0;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP;
+
+        int fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1,
+                              i == 0 ? -1 : r->perf_fd[0], 0);
+        if (fd < 0) {
+            if (i == 0) {
+                fprintf(stderr, "Warning: perf_event_open: %s, no cache miss counts\n",
+                        strerror(errno));
+                return;
+            }
+            break;
+        }
+        r->perf_fd[i] = fd;
+        r->perf_count++;
+    }
+    ioctl(r->perf_fd[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+static void perf_close(struct replay *r)
+{
+    for (int i = r->perf_count - 1; i >= 0; i--) {
+        close(r->perf_fd[i]);
+    }
+    r->perf_count = 0;
+}
+
+/* Stage boundary: time and hardware counter values */
+struct replay_mark {
+    uint64_t ns;
+    uint64_t perf[PERF_MAX];
+};
+
+static inline void replay_mark(const struct replay *r, struct replay_mark *mark)
+{
+    if (r->perf_count) {
+        uint64_t buf[1 + PERF_MAX];
+        if (read(r->perf_fd[0], buf, sizeof(buf)) > 0) {
+            memcpy(mark->perf, buf + 1, (size_t)r->perf_count * sizeof(uint64_t));
+        }
+    }
+    mark->ns = now_ns();
+}
+
+/* Charge the interval between two marks to a stage, less the mark itself */
+static inline void replay_charge(struct replay *r, int stage, const struct replay_mark *from,
+                                 const struct replay_mark *to)
+{
+    struct replay_stage *s = &r->stages[stage];
+    uint64_t ns = to->ns - from->ns;
+
+    s->ns += ns > r->boundary_ns ? ns - r->boundary_ns : 0;
+    for (int i = 0; i < r->perf_count; i++) {
+        uint64_t v = to->perf[i] - from->perf[i];
+        s->perf[i] += v > r->boundary_perf[i] ? v - r->boundary_perf[i] : 0;
+    }
+}
+
+/* Median cost of a mark, subtracted from every stage interval */
+static void replay_calibrate(struct replay *r)
+{
+    enum { SAMPLES = 255 };
+    uint64_t ns[SAMPLES], perf[PERF_MAX][SAMPLES];
+    struct replay_mark a, b;
+
+    memset(&a, 0, sizeof(a));
+    memset(&b, 0, sizeof(b));
+    for (int i = 0; i < SAMPLES; i++) {
+        replay_mark(r, &a);
+        replay_mark(r, &b);
+        ns[i] = b.ns - a.ns;
+        for (int p = 0; p < r->perf_count; p++) {
+            perf[p][i] = b.perf[p] - a.perf[p];
+        }
+    }
+
+    /* Partial selection sort up to the median */
+    for (int p = -1; p < r->perf_count; p++) {
+        uint64_t *v = p < 0 ? ns : perf[p];
+        for (int i = 0; i <= SAMPLES / 2; i++) {
+            for (int j = i + 1; j < SAMPLES; j++) {
+                if (v[j] < v[i]) {
+                    uint64_t tmp = v[i];
+                    v[i] = v[j];
+                    v[j] = tmp;
+                }
+            }
+        }
+        if (p < 0) {
+            r->boundary_ns = v[SAMPLES / 2];
+        } else {
+            r->boundary_perf[p] = v[SAMPLES / 2];
+        }
+    }
+}
+
+/* ------------------------------------------------------------------ */
+/* Pipeline                                                            */
+/* ------------------------------------------------------------------ */
+
+/* Parse up to max frames into the batch */
+static void stage_parse(struct replay *r, struct trace *t, struct replay_batch *b, uint32_t max,
+                        bool *eof)
+{
+    struct trace_record rec;
+
+    b->count = 0;
+    while (b->count < max) {
+        if (!trace_next(t, &rec)) {
+            *eof = true;
+            return;
+        }
+        uint32_t n = b->count;
+        if (!frame_parse(&rec, r->ingress, &b->keys[n])) {
+            r->skipped++;
+            continue;
+        }
+        if (r->packets == 0 && n == 0 && r->offset_ns == 0) {
+            r->trace_start_ns = rec.ts_ns;
+        }
+        uint64_t ts = rec.ts_ns + r->offset_ns;
+        if (ts < r->clock_ns) {
+            ts = r->clock_ns;   /* Out-of-order capture */
+        }
+        r->clock_ns = ts;
+        b->ts_ns[n] = ts;
+        b->length[n] = rec.wirelen;
+        b->count++;
+    }
+}
+
+static struct acl_key acl_key_of(const struct qos_flow_key *key)
+{
+    struct acl_key acl_key = {
+        .src = { key->src_ip }, .dst = { key->dst_ip }, .src_port = key->src_port,
+        .dst_port = key->dst_port, .protocol = key->protocol,
+    };
+    return acl_key;
+}
+
+/* if-match acl: the first matching rule permits */
+static bool replay_acl_match(uint16_t acl_number, const struct qos_flow_key *key, void *ctx)
+{
+    struct acl_key acl_key = acl_key_of(key);
+    const struct acl_rule *rule = acl_match(acl_number, &acl_key);
+
+    return rule && (rule->flags & ACL_RULE_PERMIT);
+}
+
+/* Traffic-filter verdicts of count packets, and the deciding rule IDs if asked */
+static void acl_verdicts(uint32_t acl, const struct qos_flow_key *keys, uint32_t count,
+                         uint8_t *verdict, int32_t *rule_id)
+{
+    static struct acl_key acl_keys[REPLAY_MAX_BATCH];
+    static const struct acl_rule *rules[REPLAY_MAX_BATCH];
+
+    if (acl == 0) {
+        memset(verdict, FLOW_ACL_NONE, count);
+        for (uint32_t n = 0; rule_id && n < count; n++) {
+            rule_id[n] = -1;
+        }
+        return;
+    }
+    for (uint32_t n = 0; n < count; n++) {
+        acl_keys[n] = acl_key_of(&keys[n]);
+    }
+    acl_match_burst(acl, acl_keys, count, rules);
+    for (uint32_t n = 0; n < count; n++) {
+        const struct acl_rule *rule = rules[n];
+        verdict[n] = !rule ? FLOW_ACL_NONE :
+                     rule->flags & ACL_RULE_PERMIT ? FLOW_ACL_PERMIT : FLOW_ACL_DENY;
+        if (rule_id) {
+            rule_id[n] = rule ? (int32_t)rule->rule_id : -1;
+        }
+    }
+}
+
+/*
+ * Traffic-filter verdicts and program entries of the packets of a batch
+ * through the flow cache; only the misses are filtered and classified,
+ * as one burst each, and then cached.
+ */
+static void classify_cached(struct replay *r, struct replay_batch *b, int *first)
+{
+    static struct qos_flow_key missed[REPLAY_MAX_BATCH];
+    const struct qos_policy_program *prog = r->prog;
+    uint64_t tag = flow_cache_tag(r->generation, prog ? prog->flow_generation : 0);
+    uint32_t slots[REPLAY_MAX_BATCH];
+    int found[REPLAY_MAX_BATCH];
+    uint8_t verdict[REPLAY_MAX_BATCH];
+    int32_t acl_rule[REPLAY_MAX_BATCH];
+    uint32_t count = 0;
+
+    for (uint32_t n = 0; n < b->count; n++) {
+        const struct qos_flow_key *key = &b->keys[n];
+        struct flow_key fk = {
+            .src_ip = key->src_ip, .dst_ip = key->dst_ip, .src_port = key->src_port,
+            .dst_port = key->dst_port, .protocol = key->protocol, .ifid = key->ifid,
+        };
+        const struct flow_value *cached = flow_cache_lookup(r->flows, &fk, tag);
+        if (cached) {
+            first[n] = cached->classifier;
+            b->verdict[n] = cached->acl_verdict;
+        } else {
+            slots[count] = n;
+            missed[count++] = *key;
+        }
+    }
+    if (count == 0) {
+        return;
+    }
+
+    if (prog) {
+        qos_cls_first_burst(prog->cls, missed, count, found);
+    } else {
+        memset(found, 0xff, count * sizeof(found[0]));
+    }
+    acl_verdicts(r->acl, missed, count, verdict, acl_rule);
+    for (uint32_t m = 0; m < count; m++) {
+        const struct qos_flow_key *key = &missed[m];
+        struct flow_key fk = {
+            .src_ip = key->src_ip, .dst_ip = key->dst_ip, .src_port = key->src_port,
+            .dst_port = key->dst_port, .protocol = key->protocol, .ifid = key->ifid,
+        };
+        struct flow_value value = {
+            .acl_verdict = verdict[m], .acl_rule = acl_rule[m], .classifier = (int16_t)found[m],
+            .rule = (int16_t)(found[m] < 0 ? -1 : prog->matches[found[m]].rule),
+        };
+        flow_cache_insert(r->flows, &fk, tag, &value);
+        first[slots[m]] = found[m];
+        b->verdict[slots[m]] = verdict[m];
+    }
+}
+
+/* Traffic-filter verdict and first rule of the policy whose classifier matches each packet */
+static void stage_classify(struct replay *r, struct replay_batch *b)
+{
+    const struct qos_policy_program *prog = r->prog;
+    int first[REPLAY_MAX_BATCH];
+
+    if (r->flows && (prog ? prog->flow_cacheable : r->acl != 0)) {
+        classify_cached(r, b, first);
+    } else {
+        if (prog) {
+            qos_cls_first_burst(prog->cls, b->keys, b->count, first);
+        }
+        acl_verdicts(r->acl, b->keys, b->count, b->verdict, NULL);
+    }
+    for (uint32_t n = 0; n < b->count; n++) {
+        int match = prog ? first[n] : -1;
+        b->match[n] = (int8_t)match;
+        b->rule[n] = (int8_t)(match < 0 ? -1 : prog->matches[match].rule);
+    }
+}
+
+/* Behavior actions and CAR; decides color, queue and drop of each packet */
+static void stage_behavior(struct replay *r, struct replay_batch *b)
+{
+    for (uint32_t n = 0; n < b->count; n++) {
+        struct qos_flow_key *key = &b->keys[n];
+        int idx = b->rule[n];
+        struct replay_class *cls = &r->classes[idx < 0 ? QOS_POLICY_MAX_RULES : idx];
+        int queue = -1;
+
+        /* Pre-colored by the drop precedence the packet arrived with */
+        b->color[n] = (uint8_t)qos_color_from_dscp(key->dscp);
+        b->drop[n] = b->verdict[n] == FLOW_ACL_DENY;
+        if (b->drop[n]) {
+            /* Filtered before QoS, in no class */
+            r->acl_denied++;
+            continue;
+        }
+        cls->packets++;
+        cls->bytes += b->length[n];
+
+        if (idx >= 0) {
+            const struct qos_policy_match *match = &r->prog->matches[b->match[n]];
+            struct traffic_behavior *behavior = match->behavior;
+
+            pcpu_counter_inc(match->classifier->match_stats);
+            pcpu_counter_inc(behavior->apply_stats);
+            pcpu_counter_add2(match->stats, 1, key->length);
+
+            int actions = __atomic_load_n(&behavior->action_count, __ATOMIC_ACQUIRE);
+            for (int a = 0; a < actions && !b->drop[n]; a++) {
+                const struct traffic_action *action = &behavior->actions[a];
+                const struct car_config *car = &action->value.car;
+                qos_color_t color;
+
+                switch (action->type) {
+                case ACTION_TYPE_REMARK_DSCP:
+                    key->dscp = action->value.dscp;
+                    b->color[n] = (uint8_t)qos_color_from_dscp(key->dscp);
+                    break;
+                case ACTION_TYPE_REMARK_IP_PRECEDENCE:
+                    key->dscp = (uint8_t)(action->value.ip_precedence << 3 | (key->dscp & 7));
+                    b->color[n] = (uint8_t)qos_color_from_dscp(key->dscp);
+                    break;
+                case ACTION_TYPE_PRIORITY:
+                    queue = action->value.priority;
+                    break;
+                case ACTION_TYPE_DENY:
+                    b->drop[n] = true;
+                    break;
+                case ACTION_TYPE_CAR:
+                    if (!action->policer) {
+                        break;
+                    }
+                    color = qos_car_color(action->policer, 0, b->ts_ns[n], b->length[n],
+                                          (qos_color_t)b->color[n]);
+                    b->color[n] = (uint8_t)color;
+                    b->drop[n] = color == QOS_COLOR_GREEN ? !car->green_pass :
+                                 color == QOS_COLOR_YELLOW ? !car->yellow_pass : car->red_discard;
+                    break;
+                default:
+                    break;
+                }
+            }
+        }
+
+        /* An explicit priority wins, else the class of the remarked DSCP */
+        if (queue < 0) {
+            queue = key->dscp >> 3;
+        }
+        b->queue[n] = (uint8_t)(queue & (QOS_SCHED_QUEUES - 1));
+        cls->colors[b->color[n]]++;
+        cls->denied += b->drop[n];
+    }
+}
+
+static void replay_transmit(struct replay *r, struct qos_pkt *pkt)
+{
+    struct replay_class *cls = &r->classes[(uintptr_t)pkt->data];
+    cls->sent++;
+    cls->sent_bytes += pkt->length;
+    pkt->next = r->free_list;
+    r->free_list = pkt;
+}
+
+/* Enqueue the admitted packets, then send what the shapers allow by now */
+static void stage_queue(struct replay *r, struct replay_batch *b)
+{
+    if (!r->sched) {
+        /* No queue profile: everything admitted is sent */
+        for (uint32_t n = 0; n < b->count; n++) {
+            struct replay_class *cls =
+                &r->classes[b->rule[n] < 0 ? QOS_POLICY_MAX_RULES : b->rule[n]];
+            if (!b->drop[n]) {
+                cls->sent++;
+                cls->sent_bytes += b->length[n];
+            }
+        }
+        return;
+    }
+
+    for (uint32_t n = 0; n < b->count; n++) {
+        uintptr_t idx = b->rule[n] < 0 ? QOS_POLICY_MAX_RULES : (uintptr_t)b->rule[n];
+        if (b->drop[n]) {
+            continue;
+        }
+        struct qos_pkt *pkt = r->free_list;
+        if (!pkt) {
+            r->classes[idx].queue_drops++;
+            r->pool_drops++;
+            continue;
+        }
+        r->free_list = pkt->next;
+        pkt->length = b->length[n];
+        pkt->port = (uint16_t)r->port;
+        pkt->queue = b->queue[n];
+        pkt->color = b->color[n];
+        pkt->data = (void *)idx;
+        if (!qos_sched_enqueue(r->sched, 0, pkt)) {
+            r->classes[idx].queue_drops++;
+            pkt->next = r->free_list;
+            r->free_list = pkt;
+        }
+    }
+
+    struct qos_pkt *pkt;
+    while ((pkt = qos_sched_dequeue(r->sched, r->clock_ns)) != NULL) {
+        replay_transmit(r, pkt);
+    }
+}
+
+/* Send the packets still queued at the end of the trace, on trace time */
+static void replay_drain(struct replay *r)
+{
+    while (r->sched) {
+        uint64_t next = qos_sched_next_ns(r->sched);
+        if (next == UINT64_MAX) {
+            return;
+        }
+        if (next > r->clock_ns) {
+            r->clock_ns = next;
+        }
+        struct qos_pkt *pkt;
+        while ((pkt = qos_sched_dequeue(r->sched, r->clock_ns)) != NULL) {
+            replay_transmit(r, pkt);
+        }
+    }
+}
+
+static void replay_run(struct replay *r, struct trace *t, uint32_t batch_size, int repeats)
+{
+    static struct replay_batch batch;
+    struct replay_mark m[STAGE_MAX + 1];
+
+    memset(m, 0, sizeof(m));
+    for (int loop = 0; loop < repeats; loop++) {
+        bool eof = false;
+
+        trace_rewind(t);
+        while (!eof) {
+            /* Pick up a program published by an edit; the old one stays valid to the batch end */
+            r->generation = flow_cache_generation();
+            r->prog = r->policy ? qos_policy_program(r->policy) : NULL;
+            r->acl = acl_filter_find(r->ingress, false);
+            replay_mark(r, &m[0]);
+            stage_parse(r, t, &batch, batch_size, &eof);
+            replay_mark(r, &m[1]);
+            stage_classify(r, &batch);
+            replay_mark(r, &m[2]);
+            stage_behavior(r, &batch);
+            replay_mark(r, &m[3]);
+            stage_queue(r, &batch);
+            replay_mark(r, &m[4]);
+
+            for (int s = 0; s < STAGE_MAX; s++) {
+                replay_charge(r, s, &m[s], &m[s + 1]);
+            }
+            r->packets += batch.count;
+            qsbr_quiescent();
+        }
+
+        /* The next pass starts 1 us after this one ended */
+        r->offset_ns = r->clock_ns + 1000 - r->trace_start_ns;
+    }
+    replay_drain(r);
+}
+
+/* ------------------------------------------------------------------ */
+/* Report                                                              */
+/* ------------------------------------------------------------------ */
+
+static void replay_report(const struct replay *r, int repeats)
+{
+    uint64_t total_ns = 0;
+    for (int s = 0; s < STAGE_MAX; s++) {
+        total_ns += r->stages[s].ns;
+    }
+    double packets = r->packets ? (double)r->packets : 1;
+
+    printf("\nReplayed %lu packets (%d passes), %lu frames skipped\n",
+           (unsigned long)r->packets, repeats, (unsigned long)r->skipped);
+    if (r->acl_denied) {
+        printf("Denied %lu packets by the inbound traffic-filter\n",
+               (unsigned long)r->acl_denied);
+    }
+    if (r->pool_drops) {
+        printf("Dropped %lu packets with all %d packet handles queued\n",
+               (unsigned long)r->pool_drops, REPLAY_POOL);
+    }
+    printf("Throughput: %.2f Mpps, %.1f ns/packet\n\n",
+           total_ns ? r->packets * 1e3 / total_ns : 0.0, total_ns / packets);
+
+    printf("%-14s %10s %8s %12s %12s %10s\n", "Stage", "ns/packet", "Share",
+           "Misses/pkt", "Instr/pkt", "IPC");
+    printf("%-14s %10s %8s %12s %12s %10s\n", "--------------", "----------", "--------",
+           "------------", "------------", "----------");
+    for (int s = 0; s < STAGE_MAX; s++) {
+        const struct replay_stage *st = &r->stages[s];
+        char misses[16] = "n/a", instr[16] = "n/a", ipc[16] = "n/a";
+        if (r->perf_count > PERF_CACHE_MISSES) {
+            snprintf(misses, sizeof(misses), "%.3f", st->perf[PERF_CACHE_MISSES] / packets);
+        }
+        if (r->perf_count > PERF_INSTRUCTIONS) {
+            snprintf(instr, sizeof(instr), "%.1f", st->perf[PERF_INSTRUCTIONS] / packets);
+        }
+        if (r->perf_count > PERF_CYCLES && st->perf[PERF_CYCLES]) {
+            snprintf(ipc, sizeof(ipc), "%.2f",
+                     (double)st->perf[PERF_INSTRUCTIONS] / st->perf[PERF_CYCLES]);
+        }
+        printf("%-14s %10.1f %7.1f%% %12s %12s %10s\n", stage_names[s], st->ns / packets,
+               total_ns ? 100.0 * st->ns / total_ns : 0.0, misses, instr, ipc);
+    }
+
+    printf("\n%-20s %-20s %12s %14s %10s %10s %10s %10s %10s %12s\n", "Classifier", "Behavior",
+           "Packets", "Bytes", "Green", "Yellow", "Red", "Denied", "Q-Drops", "Sent");
+    printf("%-20s %-20s %12s %14s %10s %10s %10s %10s %10s %12s\n", "--------------------",
+           "--------------------", "------------", "--------------", "----------", "----------",
+           "----------", "----------", "----------", "------------");
+    int rule_count = r->policy ? r->policy->rule_count : 0;
+    for (int i = 0; i <= rule_count; i++) {
+        bool dflt = i == rule_count;
+        const struct replay_class *cls = &r->classes[dflt ? QOS_POLICY_MAX_RULES : i];
+        printf("%-20s %-20s %12lu %14lu %10lu %10lu %10lu %10lu %10lu %12lu\n",
+               dflt ? "default" : r->policy->rules[i].classifier_name,
+               dflt ? "-" : r->policy->rules[i].behavior_name,
+               (unsigned long)cls->packets, (unsigned long)cls->bytes,
+               (unsigned long)cls->colors[QOS_COLOR_GREEN],
+               (unsigned long)cls->colors[QOS_COLOR_YELLOW],
+               (unsigned long)cls->colors[QOS_COLOR_RED],
+               (unsigned long)cls->denied, (unsigned long)cls->queue_drops,
+               (unsigned long)cls->sent);
+    }
+
+    if (r->sched) {
+        const struct qos_sched_port *port = &r->sched->ports[r->port];
+        printf("\n%-5s %12s %12s %12s %14s\n", "Queue", "Enqueued", "Dequeued", "Drops",
+               "Bytes Sent");
+        printf("%-5s %12s %12s %12s %14s\n", "-----", "------------", "------------",
+               "------------", "--------------");
+        for (int q = 0; q < QOS_SCHED_QUEUES; q++) {
+            const struct qos_sched_queue *queue = &port->queues[q];
+            if (!queue->enqueue_packets && !queue->drop_packets) {
+                continue;
+            }
+            printf("%-5d %12lu %12lu %12lu %14lu\n", q,
+                   (unsigned long)queue->enqueue_packets, (unsigned long)queue->dequeue_packets,
+                   (unsigned long)queue->drop_packets, (unsigned long)queue->dequeue_bytes);
+        }
+    }
+
+    if (r->flows) {
+        struct flow_cache_stats fs;
+        flow_cache_stats(r->flows, &fs);
+        printf("\nFlow cache: %u entries", fs.entries);
+        if (r->prog && !r->prog->flow_cacheable) {
+            printf(", unused: the policy matches on DSCP or packet length\n");
+            return;
+        }
+        printf(", %.1f%% hits of %lu lookups, %lu stale, %lu evictions, %lu bypassed\n",
+               fs.lookups ? fs.hits * 100.0 / fs.lookups : 0.0, (unsigned long)fs.lookups,
+               (unsigned long)fs.stale, (unsigned long)fs.evictions,
+               (unsigned long)fs.bypassed);
+        if (fs.samples > 0) {
+            printf("Lookup latency: avg %lu ns, max %lu ns (%lu samples, timer included)\n",
+                   (unsigned long)(fs.latency_ns / fs.samples), (unsigned long)fs.latency_max_ns,
+                   (unsigned long)fs.samples);
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    const char *config = NULL, *path = NULL;
+    const char *ingress = NULL, *egress = NULL;
+    int repeats = 1;
+    uint32_t batch_size = 256;
+    long flows = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "c:f:i:o:r:b:F:")) != -1) {
+        switch (opt) {
+        case 'c':
+            config = optarg;
+            break;
+        case 'f':
+            path = optarg;
+            break;
+        case 'i':
+            ingress = optarg;
+            break;
+        case 'o':
+            egress = optarg;
+            break;
+        case 'r':
+            repeats = atoi(optarg);
+            break;
+        case 'b':
+            batch_size = (uint32_t)atoi(optarg);
+            break;
+        case 'F':
+            flows = atol(optarg);
+            break;
+        default:
+            config = NULL;
+            break;
+        }
+    }
+    if (!config || !path || repeats < 1 || batch_size < 1 || batch_size > REPLAY_MAX_BATCH ||
+        flows < 0 || flows > (1l << 26)) {
+        fprintf(stderr, "Usage: %s -c config -f trace [-i ingress] [-o egress] "
+                "[-r repeats] [-b batch(1-%d)] [-F flow cache entries]\n", argv[0],
+                REPLAY_MAX_BATCH);
+        return 1;
+    }
+
+    static struct replay r;
+    struct trace t;
+
+    if (trace_open(&t, path) != 0) {
+        fprintf(stderr, "Error: Cannot read %s: %s\n", path, strerror(errno));
+        return 1;
+    }
+
+    /* Configure through the QoS and ACL command handlers */
+    qos_module_init();
+    register_acl_cmds();
+    qos_classifier_set_acl_hook(replay_acl_match, NULL);
+    struct cfg_load_stats load;
+    if (cfg_load_file(config, CFG_LOAD_QUIET | CFG_LOAD_DRY_RUN, &load) != 0 && load.lines == 0) {
+        fprintf(stderr, "Error: Cannot load %s\n", config);
+        return 1;
+    }
+    printf("Loaded %s: %lu commands, %lu errors\n", config, (unsigned long)load.commands,
+           (unsigned long)load.errors);
+
+    r.ingress = ingress ? if_intern(ingress) : IFID_NONE;
+    r.policy = qos_policy_applied(r.ingress, false);
+    if (r.policy && !r.policy->program) {
+        fprintf(stderr, "Error: Cannot compile traffic policy %s\n", r.policy->name);
+        return 1;
+    }
+    r.port = qos_queue_port(egress ? if_lookup(egress) : IFID_NONE, &r.sched);
+    if (r.port < 0) {
+        r.sched = NULL;
+    }
+    printf("Policy: %s, %d rules, %u compiled; queue profile: %s\n",
+           r.policy ? r.policy->name : "none", r.policy ? r.policy->rule_count : 0,
+           r.policy ? r.policy->program->match_count : 0, r.sched ? "yes" : "none");
+    if (acl_filter_find(r.ingress, false)) {
+        printf("Traffic-filter: ACL %u inbound\n", acl_filter_find(r.ingress, false));
+    }
+
+    r.pool = calloc(REPLAY_POOL, sizeof(*r.pool));
+    r.flows = flows ? flow_cache_create((uint32_t)flows) : NULL;
+    if (!r.pool || (flows && !r.flows)) {
+        fprintf(stderr, "Error: Out of memory\n");
+        return 1;
+    }
+    for (int i = REPLAY_POOL - 1; i >= 0; i--) {
+        r.pool[i].next = r.free_list;
+        r.free_list = &r.pool[i];
+    }
+
+    pcpu_stats_thread_register();
+    qsbr_thread_register();
+    perf_open(&r);
+    replay_calibrate(&r);
+    replay_run(&r, &t, batch_size, repeats);
+    perf_close(&r);
+    qsbr_thread_unregister();
+    pcpu_stats_thread_unregister();
+
+    replay_report(&r, repeats);
+
+    flow_cache_destroy(r.flows);
+    free(r.pool);
+    trace_close(&t);
+    return 0;
+}
@@ -0,0 +1,97 @@
+/*
+ * QoS Packet Scheduler for Huawei VRP Style
+ * Copyright (C) 2026 WhiteBox NE Team
+ *
+ * Two-level scheduler behind the queue profiles. The root serves the
+ * interfaces (ports) round robin, each held to its line-rate shaper;
+ * within a port, PQ queues are served in strict priority (queue 7
+ * first) and the WFQ/CBWFQ queues by deficit round robin with quanta
+ * proportional to their bandwidth. Every level keeps its backlogged
+ * members in a bitmap, so enqueue and dequeue are O(1).
+ *
+ * One scheduler is driven by one transmit context and is not locked.
+ */
+
+#ifndef _QOS_SCHED_H
+#define _QOS_SCHED_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "../frr_core/lib/if_registry.h"
+#include "qos_color.h"
+#include "qos_wred.h"
+
+#define QOS_SCHED_QUEUES        8
+#define QOS_SCHED_MAX_PORTS     64
+#define QOS_SCHED_MTU           1536    /* Smallest DRR quantum */
+#define QOS_SCHED_SCALE         32      /* Shaper token fraction bits */
+
+/* Packet handle queued by the scheduler */
+struct qos_pkt {
+    struct qos_pkt *next;
+    uint32_t length;
+    uint16_t port;
+    uint8_t queue;
+    uint8_t color;
+    void *data;
+};
+
+/* Queue parameters */
+struct qos_sched_queue_params {
+    bool pq;                    /* Strict priority, otherwise DRR */
+    uint32_t weight;            /* DRR share, 0 for the smallest configured one */
+    uint32_t limit;             /* Tail drop depth in packets, 0 for none */
+    struct qos_wred *wred;      /* Early drop, or NULL */
+};
+
+/* FIFO queue of one port */
+struct qos_sched_queue {
+    struct qos_pkt *head;
+    struct qos_pkt *tail;
+    uint32_t qlen;
+    uint32_t quantum;           /* DRR bytes per turn */
+    int32_t deficit;
+    struct qos_sched_queue_params params;
+    uint64_t enqueue_packets;
+    uint64_t enqueue_bytes;
+    uint64_t dequeue_packets;
+    uint64_t dequeue_bytes;
+    uint64_t drop_packets;
+};
+
+/* Port: shaper and its queues */
+struct qos_sched_port {
+    struct qos_sched_queue queues[QOS_SCHED_QUEUES];
+    uint8_t pq_active;          /* Backlogged PQ queues */
+    uint8_t drr_active;         /* Backlogged DRR queues */
+    int8_t drr_current;         /* Queue whose turn it is, -1 between turns */
+    uint32_t qlen;
+
+    uint64_t shape_rate;        /* Scaled bytes per ns, 0 for no shaping */
+    int64_t shape_tokens;       /* Scaled, may go negative by one packet */
+    int64_t shape_burst;
+    uint64_t shape_last_ns;
+    uint64_t throttled_until;   /* Tokens back above zero */
+};
+
+/* Root scheduler over the ports */
+struct qos_sched {
+    uint32_t port_count;
+    uint64_t active;            /* Ports with packets */
+    uint64_t throttled;         /* Backlogged ports waiting for tokens */
+    uint32_t rr;                /* Port served last */
+    struct qos_sched_port *ports;
+};
+
+struct qos_sched *qos_sched_create(uint32_t port_count);
+void qos_sched_destroy(struct qos_sched *sched);
+int qos_sched_port_config(struct qos_sched *sched, uint32_t port, uint64_t shape_kbps,
+                          uint32_t shape_burst, const struct qos_sched_queue_params *queues);
+bool qos_sched_enqueue(struct qos_sched *sched, uint32_t cpu, struct qos_pkt *pkt);
+struct qos_pkt *qos_sched_dequeue(struct qos_sched *sched, uint64_t now_ns);
+uint64_t qos_sched_next_ns(const struct qos_sched *sched);
+
+/* Queue profiles, queue.c */
+int qos_queue_port(ifid_t ifid, struct qos_sched **sched);
+
+#endif /* _QOS_SCHED_H */
@@ -0,0 +1,71 @@
+/*
+ * QoS WRED Engine for Huawei VRP Style
+ * Copyright (C) 2026 WhiteBox NE Team
+ *
+ * Weighted random early detection for one queue. The average queue
+ * length is an EWMA in 16.16 fixed point with weight 2^-exponent; each
+ * color has its own thresholds and maximum drop probability. The drop
+ * decision compares a per-CPU random number with the probability of the
+ * current average without branching on the packet.
+ */
+
+#ifndef _QOS_WRED_H
+#define _QOS_WRED_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "qos_color.h"
+
+#define QOS_WRED_SHIFT          16      /* Average fraction bits */
+#define QOS_WRED_EXPONENT       9       /* Default EWMA weight 1/512 */
+#define QOS_WRED_MAX_CPUS       64
+#define QOS_WRED_CACHELINE      64
+
+/* Thresholds of one color, in packets */
+struct qos_wred_profile {
+    uint16_t min_threshold;
+    uint16_t max_threshold;
+    uint8_t drop_probability;   /* Percent at max_threshold */
+};
+
+/* Compiled thresholds of one color */
+struct qos_wred_color {
+    uint32_t min;               /* 16.16 average units */
+    uint32_t max;
+    uint32_t range;             /* max - min */
+    uint64_t slope;             /* Probability (2^32 = 1) per average unit, << 16 */
+};
+
+/* Per-CPU random state and counters, one cache line each */
+struct qos_wred_cpu {
+    uint32_t random;
+    uint64_t enqueue[QOS_COLOR_MAX];
+    uint64_t drop[QOS_COLOR_MAX];
+} __attribute__((aligned(QOS_WRED_CACHELINE)));
+
+/* WRED instance of one queue */
+struct qos_wred {
+    struct qos_wred_color colors[QOS_COLOR_MAX];
+    uint32_t limit;             /* Tail drop at this queue length */
+    uint8_t exponent;
+    uint32_t average;           /* 16.16 packets, updated under the queue lock */
+    uint32_t cpu_count;
+    struct qos_wred_cpu *cpus;
+};
+
+/* Queue totals */
+struct qos_wred_stats {
+    uint64_t enqueue[QOS_COLOR_MAX];
+    uint64_t drop[QOS_COLOR_MAX];
+};
+
+struct qos_wred *qos_wred_create(const struct qos_wred_profile profiles[QOS_COLOR_MAX],
+                                 uint8_t exponent, uint32_t limit, uint32_t cpu_count);
+void qos_wred_destroy(struct qos_wred *wred);
+bool qos_wred_enqueue(struct qos_wred *wred, uint32_t cpu, uint32_t qlen, qos_color_t color);
+void qos_wred_idle(struct qos_wred *wred, uint32_t slots);
+uint64_t qos_wred_drop_probability(const struct qos_wred *wred, qos_color_t color,
+                                   uint32_t average);
+void qos_wred_get_stats(const struct qos_wred *wred, struct qos_wred_stats *stats);
+
+#endif /* _QOS_WRED_H */
@@ -3,8 +3,8 @@
  * Copyright (C) 2026 WhiteBox NE Team
  *
  * This module provides queue management functionality including:
- * - Queue scheduling (PQ, WFQ, CBWFQ)
- * - Congestion avoidance (WRED)
+ * - Queue scheduling (PQ, WFQ, CBWFQ) under a per-interface shaper
+ * - Congestion avoidance (WRED) with per-color drop profiles
  * - Queue depth management
  */
 
@@ -13,7 +13,14 @@
 #include <string.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <unistd.h>
 #include "../frr_core/lib/huawei_cli.h"
+#include "../frr_core/lib/if_registry.h"
+#include "../frr_core/lib/qsbr.h"
+#include "qos_wred.h"
+#include "qos_sched.h"
+
+#define QUEUE_DEFAULT_DEPTH     64      /* Packets, for queues without max-depth */
 
 /* Queue scheduling types */
 typedef enum {
@@ -25,9 +32,9 @@ typedef enum {
 /* WRED configuration */
 struct wred_config {
     bool enabled;
-    uint16_t min_threshold;
-    uint16_t max_threshold;
-    uint8_t drop_probability;
+    uint8_t exponent;                               /* EWMA weight 2^-exponent */
+    struct qos_wred_profile colors[QOS_COLOR_MAX];  /* Green, yellow, red */
+    struct qos_wred *engine;
 };
 
 /* Queue configuration */
@@ -45,16 +52,138 @@ struct queue_config {
 
 /* Interface queue profile */
 struct queue_profile {
-    char interface[64];
+    ifid_t ifid;
     struct queue_config queues[8];
     int queue_count;
     sched_type_t default_sched;
+    uint32_t lr_cir;         /* Interface shaper, kbps, 0 for none */
+    uint32_t lr_cbs;         /* bytes */
 };
 
-static struct queue_profile profiles[64];
+static struct queue_profile profiles[QOS_SCHED_MAX_PORTS];
 static int profile_count = 0;
 static struct queue_profile *current_profile = NULL;
 
+static const char *const color_names[QOS_COLOR_MAX] = { "green", "yellow", "red" };
+
+/* Scheduler of all profiles, port index = profile index */
+static struct qos_sched *queue_sched = NULL;
+
+/*
+ * Push the queue and shaper configuration of a profile to its scheduler
+ * port. PQ queues are served in strict priority, WFQ and CBWFQ queues by
+ * DRR weighted by their bandwidth. Queues not in the profile use the
+ * profile's scheduling type and the default depth; they and queues with
+ * no bandwidth limit get the mean configured weight.
+ */
+static int queue_profile_apply(struct queue_profile *profile)
+{
+    struct qos_sched_queue_params params[QOS_SCHED_QUEUES];
+
+    if (!queue_sched) {
+        queue_sched = qos_sched_create(QOS_SCHED_MAX_PORTS);
+        if (!queue_sched) {
+            return -1;
+        }
+    }
+
+    uint32_t weight_sum = 0, weighted = 0;
+    for (int i = 0; i < profile->queue_count; i++) {
+        if (profile->queues[i].sched_type != SCHED_TYPE_PQ && profile->queues[i].bandwidth) {
+            weight_sum += profile->queues[i].bandwidth;
+            weighted++;
+        }
+    }
+    uint32_t default_weight = weighted ? (weight_sum + weighted / 2) / weighted : 1;
+
+    memset(params, 0, sizeof(params));
+    for (int q = 0; q < QOS_SCHED_QUEUES; q++) {
+        params[q].pq = profile->default_sched == SCHED_TYPE_PQ;
+        params[q].weight = default_weight;
+        params[q].limit = QUEUE_DEFAULT_DEPTH;
+    }
+    for (int i = 0; i < profile->queue_count; i++) {
+        const struct queue_config *queue = &profile->queues[i];
+        struct qos_sched_queue_params *p = &params[queue->queue_id];
+        p->pq = queue->sched_type == SCHED_TYPE_PQ;
+        p->weight = queue->bandwidth ? queue->bandwidth : default_weight;
+        p->limit = queue->max_depth;
+        p->wred = queue->wred.engine;
+    }
+    return qos_sched_port_config(queue_sched, (uint32_t)(profile - profiles), profile->lr_cir,
+                                 profile->lr_cbs, params);
+}
+
+static void queue_wred_free(void *ptr)
+{
+    qos_wred_destroy(ptr);
+}
+
+/*
+ * Rebuild the WRED engine of a queue after its profile or depth changed.
+ * Counters start over with the new engine. The engine replaced is
+ * returned in *old: the scheduler keeps using it until the profile is
+ * applied again, so the caller retires it through qsbr after that.
+ */
+static int queue_wred_rebuild(struct queue_config *queue, struct qos_wred **old)
+{
+    struct qos_wred *engine = NULL;
+
+    if (queue->wred.enabled) {
+        long cpus = sysconf(_SC_NPROCESSORS_CONF);
+        engine = qos_wred_create(queue->wred.colors, queue->wred.exponent, queue->max_depth,
+                                 cpus > 0 ? (uint32_t)cpus : 1);
+        if (!engine) {
+            return -1;
+        }
+    }
+    *old = queue->wred.engine;
+    queue->wred.engine = engine;
+    return 0;
+}
+
+/*
+ * Fold the scheduler counters, and the per-CPU WRED counters when WRED
+ * makes the admission, into the queue counters
+ */
+static void queue_sync_counters(const struct queue_profile *profile, struct queue_config *queue)
+{
+    struct qos_wred_stats stats;
+
+    if (queue_sched) {
+        const struct qos_sched_queue *sq =
+            &queue_sched->ports[profile - profiles].queues[queue->queue_id];
+        queue->enqueue_packets = sq->enqueue_packets;
+        queue->dequeue_packets = sq->dequeue_packets;
+        queue->drop_packets = sq->drop_packets;
+    }
+    if (!queue->wred.engine) {
+        return;
+    }
+    qos_wred_get_stats(queue->wred.engine, &stats);
+    queue->enqueue_packets = 0;
+    queue->drop_packets = 0;
+    for (int c = 0; c < QOS_COLOR_MAX; c++) {
+        queue->enqueue_packets += stats.enqueue[c];
+        queue->drop_packets += stats.drop[c];
+    }
+}
+
+/*
+ * Scheduler port of the queue profile of an interface, or of the first
+ * profile for IFID_NONE. -1 if there is none.
+ */
+int qos_queue_port(ifid_t ifid, struct qos_sched **sched)
+{
+    for (int i = 0; i < profile_count; i++) {
+        if (ifid == IFID_NONE || profiles[i].ifid == ifid) {
+            *sched = queue_sched;
+            return queue_sched ? i : -1;
+        }
+    }
+    return -1;
+}
+
 /*
  * Configure queue scheduling
  * Command: qos queue-profile <interface>
@@ -68,20 +197,25 @@ static int cmd_qos_queue_profile(struct cmd_element *cmd, struct cmd_args *args)
     }
 
     const char *interface = args->argv[1];
+    ifid_t ifid = if_intern(interface);
+    if (ifid == IFID_NONE) {
+        printf("Error: Invalid interface name %s\n", interface);
+        return -1;
+    }
 
     /* Find or create profile */
     current_profile = NULL;
     for (int i = 0; i < profile_count; i++) {
-        if (strcmp(profiles[i].interface, interface) == 0) {
+        if (profiles[i].ifid == ifid) {
             current_profile = &profiles[i];
             break;
         }
     }
 
-    if (!current_profile && profile_count < 64) {
+    if (!current_profile && profile_count < QOS_SCHED_MAX_PORTS) {
         current_profile = &profiles[profile_count++];
         memset(current_profile, 0, sizeof(struct queue_profile));
-        strncpy(current_profile->interface, interface, sizeof(current_profile->interface) - 1);
+        current_profile->ifid = ifid;
         current_profile->default_sched = SCHED_TYPE_WFQ;
     }
 
@@ -134,7 +268,7 @@ static int cmd_queue(struct cmd_element *cmd, struct cmd_args *args)
         snprintf(queue->name, sizeof(queue->name), "queue-%u", queue_id);
         queue->sched_type = current_profile->default_sched;
         queue->bandwidth = 0;  /* 0 means no limit */
-        queue->max_depth = 64; /* default 64 packets */
+        queue->max_depth = QUEUE_DEFAULT_DEPTH;
     }
 
     if (!queue) {
@@ -151,6 +285,19 @@ static int cmd_queue(struct cmd_element *cmd, struct cmd_args *args)
         }
     }
 
+    /* WRED tail-drops at the queue depth */
+    struct qos_wred *old = NULL;
+    if (queue->wred.enabled && queue_wred_rebuild(queue, &old) != 0) {
+        printf("Error: Out of memory for WRED on queue %u\n", queue_id);
+        return -1;
+    }
+    int ret = queue_profile_apply(current_profile);
+    qsbr_retire(old, queue_wred_free);
+    if (ret != 0) {
+        printf("Error: Out of memory for queue scheduler\n");
+        return -1;
+    }
+
     printf("Queue %u configured: bandwidth %u kbps, max-depth %u packets\n",
            queue_id, queue->bandwidth, queue->max_depth);
 
@@ -175,27 +322,90 @@ static int cmd_qos_schedule(struct cmd_element *cmd, struct cmd_args *args)
     }
 
     const char *sched = args->argv[1];
+    sched_type_t type;
 
     if (strcmp(sched, "pq") == 0) {
-        current_profile->default_sched = SCHED_TYPE_PQ;
-        printf("Priority Queuing (PQ) configured\n");
+        type = SCHED_TYPE_PQ;
     } else if (strcmp(sched, "wfq") == 0) {
-        current_profile->default_sched = SCHED_TYPE_WFQ;
-        printf("Weighted Fair Queuing (WFQ) configured\n");
+        type = SCHED_TYPE_WFQ;
     } else if (strcmp(sched, "cbwfq") == 0) {
-        current_profile->default_sched = SCHED_TYPE_CBWFQ;
-        printf("Class-Based WFQ (CBWFQ) configured\n");
+        type = SCHED_TYPE_CBWFQ;
     } else {
         printf("Error: Invalid scheduling type\n");
         return -1;
     }
 
+    /* Queues created under the old default follow the new one */
+    for (int i = 0; i < current_profile->queue_count; i++) {
+        if (current_profile->queues[i].sched_type == current_profile->default_sched) {
+            current_profile->queues[i].sched_type = type;
+        }
+    }
+    current_profile->default_sched = type;
+    if (queue_profile_apply(current_profile) != 0) {
+        printf("Error: Out of memory for queue scheduler\n");
+        return -1;
+    }
+
+    if (type == SCHED_TYPE_PQ) {
+        printf("Priority Queuing (PQ) configured\n");
+    } else if (type == SCHED_TYPE_WFQ) {
+        printf("Weighted Fair Queuing (WFQ) configured\n");
+    } else {
+        printf("Class-Based WFQ (CBWFQ) configured\n");
+    }
+
+    return 0;
+}
+
+/*
+ * Configure the interface shaper above the queues
+ * Command: qos lr cir <cir> [cbs <cbs>]
+ */
+static int cmd_qos_lr(struct cmd_element *cmd, struct cmd_args *args)
+{
+    if (!current_profile) {
+        printf("Error: No queue profile configured\n");
+        return -1;
+    }
+
+    if (args->argc < 3 || strcmp(args->argv[1], "cir") != 0) {
+        printf("Error: CIR value required\n");
+        printf("Usage: qos lr cir <cir> [cbs <cbs>]\n");
+        return -1;
+    }
+
+    uint32_t cir = (uint32_t)strtoul(args->argv[2], NULL, 10);
+    uint32_t cbs = 0;
+    if (args->argc >= 5 && strcmp(args->argv[3], "cbs") == 0) {
+        cbs = (uint32_t)strtoul(args->argv[4], NULL, 10);
+    }
+    if (cbs == 0) {
+        /* Default burst: 10 ms at CIR, at least one MTU */
+        uint64_t burst = (uint64_t)cir * 125 / 100;
+        cbs = burst < QOS_SCHED_MTU ? QOS_SCHED_MTU : burst > UINT32_MAX ? UINT32_MAX : (uint32_t)burst;
+    }
+
+    current_profile->lr_cir = cir;
+    current_profile->lr_cbs = cbs;
+    if (queue_profile_apply(current_profile) != 0) {
+        printf("Error: Out of memory for queue scheduler\n");
+        return -1;
+    }
+
+    if (cir) {
+        printf("Interface shaping configured: CIR %u kbps, CBS %u bytes\n", cir, cbs);
+    } else {
+        printf("Interface shaping disabled\n");
+    }
+
     return 0;
 }
 
 /*
- * Configure WRED
+ * Configure WRED, for all colors unless one is given
  * Command: wred queue <queue-id> min-threshold <min> max-threshold <max> drop-probability <prob>
+ *          [color {green|yellow|red}] [exponent <1-15>]
  */
 static int cmd_wred(struct cmd_element *cmd, struct cmd_args *args)
 {
@@ -206,7 +416,8 @@ static int cmd_wred(struct cmd_element *cmd, struct cmd_args *args)
 
     if (args->argc < 8) {
         printf("Error: WRED parameters required\n");
-        printf("Usage: wred queue <queue-id> min-threshold <min> max-threshold <max> drop-probability <prob>\n");
+        printf("Usage: wred queue <queue-id> min-threshold <min> max-threshold <max> drop-probability <prob>"
+               " [color {green|yellow|red}] [exponent <1-15>]\n");
         return -1;
     }
 
@@ -227,14 +438,69 @@ static int cmd_wred(struct cmd_element *cmd, struct cmd_args *args)
     }
 
     /* Parse WRED parameters */
+    struct qos_wred_profile profile = {
+        .min_threshold = atoi(args->argv[3]),
+        .max_threshold = atoi(args->argv[5]),
+        .drop_probability = atoi(args->argv[7]),
+    };
+    int color = -1;
+    uint8_t exponent = queue->wred.exponent ? queue->wred.exponent : QOS_WRED_EXPONENT;
+
+    for (int i = 8; i < args->argc; i++) {
+        if (strcmp(args->argv[i], "color") == 0 && i + 1 < args->argc) {
+            const char *name = args->argv[++i];
+            for (int c = 0; c < QOS_COLOR_MAX; c++) {
+                if (strcmp(name, color_names[c]) == 0) {
+                    color = c;
+                }
+            }
+            if (color < 0) {
+                printf("Error: Color must be green, yellow or red\n");
+                return -1;
+            }
+        } else if (strcmp(args->argv[i], "exponent") == 0 && i + 1 < args->argc) {
+            exponent = atoi(args->argv[++i]);
+            if (exponent < 1 || exponent > 15) {
+                printf("Error: Exponent must be 1-15\n");
+                return -1;
+            }
+        } else {
+            printf("Error: Unknown WRED parameter %s\n", args->argv[i]);
+            return -1;
+        }
+    }
+
+    if (profile.min_threshold >= profile.max_threshold) {
+        printf("Error: min-threshold must be less than max-threshold\n");
+        return -1;
+    }
+    if (atoi(args->argv[7]) < 0 || atoi(args->argv[7]) > 100) {
+        printf("Error: drop-probability must be 0-100\n");
+        return -1;
+    }
+
+    for (int c = 0; c < QOS_COLOR_MAX; c++) {
+        if (color < 0 || color == c) {
+            queue->wred.colors[c] = profile;
+        }
+    }
     queue->wred.enabled = true;
-    queue->wred.min_threshold = atoi(args->argv[3]);
-    queue->wred.max_threshold = atoi(args->argv[5]);
-    queue->wred.drop_probability = atoi(args->argv[7]);
+    queue->wred.exponent = exponent;
+    struct qos_wred *old = NULL;
+    if (queue_wred_rebuild(queue, &old) != 0) {
+        printf("Error: Out of memory for WRED on queue %u\n", queue_id);
+        return -1;
+    }
+    int ret = queue_profile_apply(current_profile);
+    qsbr_retire(old, queue_wred_free);
+    if (ret != 0) {
+        printf("Error: Out of memory for queue scheduler\n");
+        return -1;
+    }
 
-    printf("WRED configured for queue %u: min %u, max %u, drop-prob %u%%\n",
-           queue_id, queue->wred.min_threshold, queue->wred.max_threshold,
-           queue->wred.drop_probability);
+    printf("WRED configured for queue %u%s%s: min %u, max %u, drop-prob %u%%\n",
+           queue_id, color < 0 ? "" : " color ", color < 0 ? "" : color_names[color],
+           profile.min_threshold, profile.max_threshold, profile.drop_probability);
 
     return 0;
 }
@@ -252,11 +518,12 @@ static int cmd_display_qos_queue(struct cmd_element *cmd, struct cmd_args *args)
     }
 
     const char *interface = args->argv[3];
+    ifid_t ifid = if_lookup(interface);
 
     /* Find profile */
     struct queue_profile *profile = NULL;
-    for (int i = 0; i < profile_count; i++) {
-        if (strcmp(profiles[i].interface, interface) == 0) {
+    for (int i = 0; ifid != IFID_NONE && i < profile_count; i++) {
+        if (profiles[i].ifid == ifid) {
             profile = &profiles[i];
             break;
         }
@@ -280,6 +547,9 @@ static int cmd_display_qos_queue(struct cmd_element *cmd, struct cmd_args *args)
             printf("CBWFQ (Class-Based WFQ)\n");
             break;
     }
+    if (profile->lr_cir) {
+        printf("Interface Shaping: CIR %u kbps, CBS %u bytes\n", profile->lr_cir, profile->lr_cbs);
+    }
 
     printf("\n%-5s %-15s %-10s %-10s %-10s %-10s %-10s\n",
            "Queue", "Bandwidth", "Max-Depth", "WRED", "Enqueue", "Dequeue", "Drops");
@@ -289,6 +559,7 @@ static int cmd_display_qos_queue(struct cmd_element *cmd, struct cmd_args *args)
 
     for (int i = 0; i < profile->queue_count; i++) {
         struct queue_config *q = &profile->queues[i];
+        queue_sync_counters(profile, q);
         printf("%-5u %-15u %-10u %-10s %-10lu %-10lu %-10lu\n",
                q->queue_id,
                q->bandwidth,
@@ -299,24 +570,50 @@ static int cmd_display_qos_queue(struct cmd_element *cmd, struct cmd_args *args)
                q->drop_packets);
     }
 
+    /* Per-color WRED profiles and drops */
+    for (int i = 0; i < profile->queue_count; i++) {
+        const struct queue_config *q = &profile->queues[i];
+        if (!q->wred.enabled || !q->wred.engine) {
+            continue;
+        }
+
+        struct qos_wred_stats stats;
+        qos_wred_get_stats(q->wred.engine, &stats);
+        printf("\nQueue %u WRED (exponent %u, average %.1f packets):\n", q->queue_id,
+               q->wred.exponent, q->wred.engine->average / 65536.0);
+        for (int c = 0; c < QOS_COLOR_MAX; c++) {
+            const struct qos_wred_profile *color = &q->wred.colors[c];
+            printf("  %-7s min %-5u max %-5u drop-prob %3u%%  enqueue %-10lu drop %-10lu\n",
+                   color_names[c], color->min_threshold, color->max_threshold,
+                   color->drop_probability, stats.enqueue[c], stats.drop[c]);
+        }
+    }
+
     return 0;
 }
 
+/* Command registration */
+struct cmd_element queue_cmds[] = {
+    HUAWEI_CMD_WITH_CATEGORY("qos queue-profile", cmd_qos_queue_profile, NULL,
+                             "Configure queue profile", CMD_CAT_QOS),
+    HUAWEI_CMD_WITH_CATEGORY("queue", cmd_queue, NULL,
+                             "Configure queue", CMD_CAT_QOS),
+    HUAWEI_CMD_WITH_CATEGORY("qos schedule", cmd_qos_schedule, NULL,
+                             "Configure queue scheduling", CMD_CAT_QOS),
+    HUAWEI_CMD_WITH_CATEGORY("qos lr", cmd_qos_lr, NULL,
+                             "Configure interface shaping", CMD_CAT_QOS),
+    HUAWEI_CMD_WITH_CATEGORY("wred", cmd_wred, NULL,
+                             "Configure WRED", CMD_CAT_QOS),
+    HUAWEI_CMD_WITH_CATEGORY("display qos queue", cmd_display_qos_queue, NULL,
+                             "Display queue configuration", CMD_CAT_QOS),
+    { .name = NULL }
+};
+
 /*
  * Initialize QoS queue module
  */
 void qos_queue_init(void)
 {
     /* Register commands */
-    HUAWEI_CMD_WITH_CATEGORY("qos queue-profile", cmd_qos_queue_profile, NULL,
-                            "Configure queue profile", "QoS");
-    HUAWEI_CMD_WITH_CATEGORY("queue", cmd_queue, NULL,
-                            "Configure queue", "QoS");
-    HUAWEI_CMD_WITH_CATEGORY("qos schedule", cmd_qos_schedule, NULL,
-                            "Configure queue scheduling", "QoS");
-    HUAWEI_CMD_WITH_CATEGORY("wred", cmd_wred, NULL,
-                            "Configure WRED", "QoS");
-    HUAWEI_CMD_WITH_CATEGORY("display qos queue", cmd_display_qos_queue, NULL,
-                            "Display queue configuration", "QoS");
+    huawei_cli_register_table(queue_cmds, NULL);
 }
-
@@ -0,0 +1,287 @@
+/*
+ * QoS Packet Scheduler for Huawei VRP Style
+ * Copyright (C) 2026 WhiteBox NE Team
+ *
+ * This module implements the hierarchical scheduler including:
+ * - Round robin over backlogged ports, skipping ports held by their shaper
+ * - Line-rate shaper per port, fixed-point tokens refilled lazily
+ * - Strict priority over the PQ queues of a port, highest queue first
+ * - Deficit round robin over the WFQ/CBWFQ queues, quanta by bandwidth
+ * - WRED or tail drop admission per queue
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "qos_sched.h"
+
+#define QOS_SCHED_MAX_QUANTUM   (1u << 24)
+#define QOS_SCHED_MAX_BURST     (1u << 30)
+
+/* Lowest set bit of mask above position pos, wrapping to the lowest */
+static inline uint32_t next_set(uint64_t mask, uint32_t pos)
+{
+    uint64_t above = pos >= 63 ? 0 : mask & (~0ull << (pos + 1));
+    return (uint32_t)__builtin_ctzll(above ? above : mask);
+}
+
+struct qos_sched *qos_sched_create(uint32_t port_count)
+{
+    if (port_count == 0 || port_count > QOS_SCHED_MAX_PORTS) {
+        return NULL;
+    }
+
+    struct qos_sched *sched = calloc(1, sizeof(*sched));
+    if (!sched) {
+        return NULL;
+    }
+    sched->ports = calloc(port_count, sizeof(*sched->ports));
+    if (!sched->ports) {
+        free(sched);
+        return NULL;
+    }
+    sched->port_count = port_count;
+    sched->rr = port_count - 1;
+    for (uint32_t p = 0; p < port_count; p++) {
+        struct qos_sched_port *port = &sched->ports[p];
+        port->drr_current = -1;
+        for (int q = 0; q < QOS_SCHED_QUEUES; q++) {
+            port->queues[q].quantum = QOS_SCHED_MTU;
+        }
+    }
+    return sched;
+}
+
+/* Queued packets are left to the caller, who owns them */
+void qos_sched_destroy(struct qos_sched *sched)
+{
+    if (!sched) {
+        return;
+    }
+    free(sched->ports);
+    free(sched);
+}
+
+/*
+ * Set the shaper and queue parameters of a port. shape_kbps 0 disables
+ * shaping. DRR quanta are MTU times the weight relative to the smallest
+ * weight, so every turn sends at least one packet. Queued packets stay.
+ */
+int qos_sched_port_config(struct qos_sched *sched, uint32_t port_id, uint64_t shape_kbps,
+                          uint32_t shape_burst, const struct qos_sched_queue_params *queues)
+{
+    if (port_id >= sched->port_count) {
+        return -1;
+    }
+    struct qos_sched_port *port = &sched->ports[port_id];
+
+    uint32_t min_weight = UINT32_MAX;
+    for (int q = 0; q < QOS_SCHED_QUEUES; q++) {
+        if (!queues[q].pq && queues[q].weight && queues[q].weight < min_weight) {
+            min_weight = queues[q].weight;
+        }
+    }
+    if (min_weight == UINT32_MAX) {
+        min_weight = 1;
+    }
+
+    for (int q = 0; q < QOS_SCHED_QUEUES; q++) {
+        struct qos_sched_queue *queue = &port->queues[q];
+        uint32_t weight = queues[q].weight ? queues[q].weight : min_weight;
+        uint64_t quantum = (uint64_t)QOS_SCHED_MTU * weight / min_weight;
+
+        queue->params = queues[q];
+        queue->quantum = quantum > QOS_SCHED_MAX_QUANTUM ? QOS_SCHED_MAX_QUANTUM : (uint32_t)quantum;
+
+        /* A queue changing class moves to the matching active set */
+        uint8_t bit = 1u << q;
+        if (queue->qlen) {
+            port->pq_active = queue->params.pq ? port->pq_active | bit : port->pq_active & ~bit;
+            port->drr_active = queue->params.pq ? port->drr_active & ~bit : port->drr_active | bit;
+        }
+    }
+    port->drr_current = -1;
+
+    port->shape_rate = (uint64_t)(((unsigned __int128)shape_kbps * 125 << QOS_SCHED_SCALE) /
+                                  1000000000u);
+    if (shape_burst == 0) {
+        shape_burst = QOS_SCHED_MTU;
+    }
+    port->shape_burst = (int64_t)(shape_burst > QOS_SCHED_MAX_BURST ? QOS_SCHED_MAX_BURST :
+                                  shape_burst) << QOS_SCHED_SCALE;
+    port->shape_tokens = port->shape_burst;
+    port->shape_last_ns = 0;
+    sched->throttled &= ~(1ull << port_id);
+    return 0;
+}
+
+/*
+ * Queue a packet on pkt->port / pkt->queue. Returns false when the packet
+ * is dropped; it then still belongs to the caller.
+ */
+bool qos_sched_enqueue(struct qos_sched *sched, uint32_t cpu, struct qos_pkt *pkt)
+{
+    if (pkt->port >= sched->port_count) {
+        return false;
+    }
+    struct qos_sched_port *port = &sched->ports[pkt->port];
+    uint32_t q = pkt->queue & (QOS_SCHED_QUEUES - 1);
+    struct qos_sched_queue *queue = &port->queues[q];
+    bool admit;
+
+    if (queue->params.wred) {
+        admit = qos_wred_enqueue(queue->params.wred, cpu, queue->qlen, (qos_color_t)pkt->color);
+    } else {
+        admit = queue->params.limit == 0 || queue->qlen < queue->params.limit;
+    }
+    if (!admit) {
+        queue->drop_packets++;
+        return false;
+    }
+
+    pkt->next = NULL;
+    if (queue->tail) {
+        queue->tail->next = pkt;
+    } else {
+        queue->head = pkt;
+    }
+    queue->tail = pkt;
+    queue->qlen++;
+    queue->enqueue_packets++;
+    queue->enqueue_bytes += pkt->length;
+
+    if (queue->params.pq) {
+        port->pq_active |= 1u << q;
+    } else {
+        port->drr_active |= 1u << q;
+    }
+    port->qlen++;
+    sched->active |= 1ull << pkt->port;
+    return true;
+}
+
+static struct qos_pkt *queue_pop(struct qos_sched_port *port, uint32_t q)
+{
+    struct qos_sched_queue *queue = &port->queues[q];
+    struct qos_pkt *pkt = queue->head;
+
+    queue->head = pkt->next;
+    if (!queue->head) {
+        queue->tail = NULL;
+    }
+    queue->qlen--;
+    queue->dequeue_packets++;
+    queue->dequeue_bytes += pkt->length;
+    if (queue->qlen == 0) {
+        port->pq_active &= ~(1u << q);
+        port->drr_active &= ~(1u << q);
+    }
+    port->qlen--;
+    return pkt;
+}
+
+/* Next packet of a backlogged port: PQ first, then the DRR turn */
+static struct qos_pkt *port_dequeue(struct qos_sched_port *port)
+{
+    if (port->pq_active) {
+        return queue_pop(port, 31 - __builtin_clz(port->pq_active));
+    }
+
+    for (;;) {
+        int cur = port->drr_current;
+        if (cur < 0 || !(port->drr_active & (1u << cur))) {
+            /* Start the turn of the next backlogged queue */
+            cur = (int)next_set(port->drr_active, cur < 0 ? 7 : (uint32_t)cur);
+            port->drr_current = (int8_t)cur;
+            port->queues[cur].deficit += port->queues[cur].quantum;
+        }
+
+        struct qos_sched_queue *queue = &port->queues[cur];
+        if ((int32_t)queue->head->length <= queue->deficit) {
+            queue->deficit -= queue->head->length;
+            struct qos_pkt *pkt = queue_pop(port, (uint32_t)cur);
+            if (queue->qlen == 0) {
+                queue->deficit = 0;
+            }
+            return pkt;
+        }
+
+        /* Turn over: the remainder carries to the next round */
+        port->drr_current = (int8_t)next_set(port->drr_active, (uint32_t)cur);
+        port->queues[port->drr_current].deficit += port->queues[port->drr_current].quantum;
+    }
+}
+
+/* Shaper tokens of a port at now_ns */
+static void port_refill(struct qos_sched_port *port, uint64_t now_ns)
+{
+    if (now_ns <= port->shape_last_ns) {
+        return;
+    }
+    unsigned __int128 add = (unsigned __int128)(now_ns - port->shape_last_ns) * port->shape_rate;
+    port->shape_last_ns = now_ns;
+    if (add >= (unsigned __int128)(port->shape_burst - port->shape_tokens)) {
+        port->shape_tokens = port->shape_burst;
+    } else {
+        port->shape_tokens += (int64_t)add;
+    }
+}
+
+/*
+ * Next packet to transmit at now_ns, or NULL when every backlogged port
+ * is held by its shaper (see qos_sched_next_ns) or nothing is queued.
+ */
+struct qos_pkt *qos_sched_dequeue(struct qos_sched *sched, uint64_t now_ns)
+{
+    /* Release ports whose shaper has earned back its debt */
+    for (uint64_t held = sched->throttled; held; held &= held - 1) {
+        uint32_t p = (uint32_t)__builtin_ctzll(held);
+        if (sched->ports[p].throttled_until <= now_ns) {
+            sched->throttled &= ~(1ull << p);
+        }
+    }
+
+    uint64_t eligible = sched->active & ~sched->throttled;
+    if (!eligible) {
+        return NULL;
+    }
+    uint32_t p = next_set(eligible, sched->rr);
+    struct qos_sched_port *port = &sched->ports[p];
+    sched->rr = p;
+
+    struct qos_pkt *pkt = port_dequeue(port);
+    if (port->qlen == 0) {
+        sched->active &= ~(1ull << p);
+    }
+
+    if (port->shape_rate) {
+        port_refill(port, now_ns);
+        port->shape_tokens -= (int64_t)pkt->length << QOS_SCHED_SCALE;
+        if (port->shape_tokens < 0) {
+            port->throttled_until = now_ns + (uint64_t)(-port->shape_tokens) / port->shape_rate + 1;
+            sched->throttled |= 1ull << p;
+        }
+    }
+    return pkt;
+}
+
+/*
+ * Earliest time a held port may send again, 0 when a packet can be sent
+ * now, UINT64_MAX when nothing is queued.
+ */
+uint64_t qos_sched_next_ns(const struct qos_sched *sched)
+{
+    if (sched->active & ~sched->throttled) {
+        return 0;
+    }
+    uint64_t next = UINT64_MAX;
+    for (uint64_t held = sched->throttled & sched->active; held; held &= held - 1) {
+        uint32_t p = (uint32_t)__builtin_ctzll(held);
+        if (sched->ports[p].throttled_until < next) {
+            next = sched->ports[p].throttled_until;
+        }
+    }
+    return next;
+}
@@ -0,0 +1,238 @@
+/*
+ * QoS Scheduler Benchmark for Huawei VRP Style
+ * Copyright (C) 2026 WhiteBox NE Team
+ *
+ * This program measures the hierarchical scheduler including:
+ * - Enqueue + dequeue throughput with PQ and DRR queues backlogged
+ * - DRR byte shares against the configured bandwidth, with mixed packet
+ *   sizes, and Jain's fairness index of the weighted shares
+ * - Strict priority of PQ traffic over DRR traffic
+ * - Shaper accuracy of several ports on a simulated clock
+ *
+ * Usage: sched_bench [-n packets]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+#include "qos_sched.h"
+
+#define BENCH_POOL      4096
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint32_t random_length(void)
+{
+    int r = rand() % 12;
+    return r < 7 ? 64 : r < 11 ? 576 : 1500;
+}
+
+/* Two PQ queues (6, 7) and six DRR queues weighted 1:1:2:2:4:8 */
+static void bench_queues(struct qos_sched_queue_params *queues, uint32_t limit)
+{
+    static const uint32_t weights[QOS_SCHED_QUEUES] = { 1000, 1000, 2000, 2000, 4000, 8000, 0, 0 };
+
+    memset(queues, 0, QOS_SCHED_QUEUES * sizeof(*queues));
+    for (int q = 0; q < QOS_SCHED_QUEUES; q++) {
+        queues[q].pq = q >= 6;
+        queues[q].weight = weights[q];
+        queues[q].limit = limit;
+    }
+}
+
+/* Keep every queue backlogged: each dequeued packet is queued again */
+static void throughput_run(long packets, uint32_t ports)
+{
+    struct qos_sched *sched = qos_sched_create(ports);
+    struct qos_sched_queue_params queues[QOS_SCHED_QUEUES];
+    struct qos_pkt *pool = calloc(BENCH_POOL, sizeof(*pool));
+
+    if (!sched || !pool) {
+        fprintf(stderr, "Error: Out of memory\n");
+        exit(1);
+    }
+    bench_queues(queues, 0);
+    queues[6].pq = queues[7].pq = false;    /* PQ would starve the rest */
+    for (uint32_t p = 0; p < ports; p++) {
+        qos_sched_port_config(sched, p, 0, 0, queues);
+    }
+
+    srand(3);
+    for (int i = 0; i < BENCH_POOL; i++) {
+        pool[i].length = random_length();
+        pool[i].port = (uint16_t)(i % ports);
+        pool[i].queue = (uint8_t)(rand() % QOS_SCHED_QUEUES);
+        qos_sched_enqueue(sched, 0, &pool[i]);
+    }
+
+    double start = now_sec();
+    for (long i = 0; i < packets; i++) {
+        struct qos_pkt *pkt = qos_sched_dequeue(sched, 0);
+        qos_sched_enqueue(sched, 0, pkt);
+    }
+    double elapsed = now_sec() - start;
+
+    printf("%-6u %12.2f %12.2f\n", ports, packets / elapsed / 1e6, elapsed * 1e9 / packets);
+    qos_sched_destroy(sched);
+    free(pool);
+}
+
+/*
+ * Saturate the DRR queues of one port with random sizes and compare the
+ * byte shares with the weights; then add PQ traffic and check it is
+ * served first.
+ */
+static void fairness_run(long packets)
+{
+    struct qos_sched *sched = qos_sched_create(1);
+    struct qos_sched_queue_params queues[QOS_SCHED_QUEUES];
+    struct qos_pkt *pool = calloc(BENCH_POOL, sizeof(*pool));
+    uint64_t bytes[QOS_SCHED_QUEUES] = { 0 };
+
+    if (!sched || !pool) {
+        fprintf(stderr, "Error: Out of memory\n");
+        exit(1);
+    }
+    bench_queues(queues, 0);
+    qos_sched_port_config(sched, 0, 0, 0, queues);
+
+    srand(5);
+    for (int i = 0; i < BENCH_POOL; i++) {
+        pool[i].length = random_length();
+        pool[i].queue = (uint8_t)(i % 6);
+        qos_sched_enqueue(sched, 0, &pool[i]);
+    }
+    for (long i = 0; i < packets; i++) {
+        struct qos_pkt *pkt = qos_sched_dequeue(sched, 0);
+        bytes[pkt->queue] += pkt->length;
+        pkt->length = random_length();
+        qos_sched_enqueue(sched, 0, pkt);
+    }
+
+    uint64_t total = 0, weight_total = 0;
+    for (int q = 0; q < 6; q++) {
+        total += bytes[q];
+        weight_total += queues[q].weight;
+    }
+
+    printf("\nDRR fairness: %ld packets, IMIX sizes, all six WFQ queues backlogged\n\n", packets);
+    printf("%-6s %8s %12s %12s %10s\n", "Queue", "Weight", "Expected %", "Measured %", "Ratio");
+    double sum = 0, sum2 = 0;
+    for (int q = 0; q < 6; q++) {
+        double expect = 100.0 * queues[q].weight / weight_total;
+        double share = 100.0 * bytes[q] / total;
+        double ratio = share / expect;
+        sum += ratio;
+        sum2 += ratio * ratio;
+        printf("%-6d %8u %12.2f %12.2f %10.4f\n", q, queues[q].weight, expect, share, ratio);
+    }
+    printf("Jain's fairness index: %.6f\n", sum * sum / (6 * sum2));
+
+    /* Queue PQ packets behind the backlog: they must all leave first */
+    struct qos_pkt pq[64];
+    for (int i = 0; i < 64; i++) {
+        memset(&pq[i], 0, sizeof(pq[i]));
+        pq[i].length = 1500;
+        pq[i].queue = (uint8_t)(6 + i % 2);
+        qos_sched_enqueue(sched, 0, &pq[i]);
+    }
+    int pq_first = 0;
+    for (int i = 0; i < 64; i++) {
+        struct qos_pkt *pkt = qos_sched_dequeue(sched, 0);
+        pq_first += pkt->queue >= 6;
+    }
+    printf("Strict priority: %d of 64 PQ packets sent before any WFQ packet\n", pq_first);
+
+    qos_sched_destroy(sched);
+    free(pool);
+}
+
+/* Four ports shaped to different rates, fed faster than their rates */
+static void shaper_run(void)
+{
+    static const uint64_t rates[] = { 100000, 1000000, 2500000, 10000000 };
+    struct qos_sched *sched = qos_sched_create(4);
+    struct qos_sched_queue_params queues[QOS_SCHED_QUEUES];
+    struct qos_pkt *pool = calloc(BENCH_POOL, sizeof(*pool));
+    uint64_t bytes[4] = { 0 };
+    uint64_t duration = 1000000000ull;
+
+    if (!sched || !pool) {
+        fprintf(stderr, "Error: Out of memory\n");
+        exit(1);
+    }
+    bench_queues(queues, 0);
+    for (uint32_t p = 0; p < 4; p++) {
+        qos_sched_port_config(sched, p, rates[p], 15000, queues);
+    }
+
+    srand(9);
+    for (int i = 0; i < BENCH_POOL; i++) {
+        pool[i].length = random_length();
+        pool[i].port = (uint16_t)(i % 4);
+        pool[i].queue = (uint8_t)(rand() % 6);
+        qos_sched_enqueue(sched, 0, &pool[i]);
+    }
+
+    /* The link sends one packet at a time; idle time jumps to the next release */
+    uint64_t now = 1;
+    while (now < duration) {
+        struct qos_pkt *pkt = qos_sched_dequeue(sched, now);
+        if (!pkt) {
+            now = qos_sched_next_ns(sched);
+            continue;
+        }
+        bytes[pkt->port] += pkt->length;
+        qos_sched_enqueue(sched, 0, pkt);
+        now += 1;
+    }
+
+    printf("\nShaper: 4 ports, 15000 byte burst, 1 simulated second\n\n");
+    printf("%-6s %12s %12s %10s\n", "Port", "Rate Mbps", "Sent Mbps", "Error");
+    for (int p = 0; p < 4; p++) {
+        double expect = rates[p] / 1e3 + 15000 * 8 / 1e6;
+        double sent = bytes[p] * 8 / 1e6;
+        printf("%-6d %12.1f %12.1f %9.3f%%\n", p, rates[p] / 1e3, sent,
+               (sent - expect) / expect * 100);
+    }
+    qos_sched_destroy(sched);
+    free(pool);
+}
+
+int main(int argc, char *argv[])
+{
+    long packets = 20000000;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:")) != -1) {
+        switch (opt) {
+        case 'n':
+            packets = atol(optarg);
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-n packets]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    printf("Scheduler throughput: %ld dequeue + enqueue pairs, %d packets queued\n\n",
+           packets, BENCH_POOL);
+    printf("%-6s %12s %12s\n", "Ports", "Mpps", "ns/packet");
+    uint32_t ports[] = { 1, 4, 16, 64 };
+    for (int i = 0; i < 4; i++) {
+        throughput_run(packets, ports[i]);
+    }
+
+    fairness_run(packets);
+    shaper_run();
+    return 0;
+}
@@ -0,0 +1,1022 @@
+/*
+ * QoS Kernel Offload for Huawei VRP Style
+ * Copyright (C) 2026 WhiteBox NE Team
+ *
+ * This module implements the tc/flower offload of traffic policies including:
+ * - clsact qdisc creation on the interface
+ * - Expansion of classifiers to flower match sets
+ * - Behavior actions as police, pedit + csum, skbedit, gact and mirred
+ * - Incremental filter diff by a hash of the encoded attributes
+ * - Batched RTNETLINK requests with per-message acknowledgements
+ * - Filter counters read back from a filter dump
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <linux/if_ether.h>
+#include <linux/gen_stats.h>
+#include <linux/pkt_sched.h>
+#include <linux/pkt_cls.h>
+#include <linux/tc_act/tc_gact.h>
+#include <linux/tc_act/tc_mirred.h>
+#include <linux/tc_act/tc_skbedit.h>
+#include <linux/tc_act/tc_pedit.h>
+#include <linux/tc_act/tc_csum.h>
+#include "tc_offload.h"
+
+#define TC_NL_BUFFER_SIZE       65536
+#define TC_MSG_SIZE             16384   /* Largest single request */
+#define TC_MAX_SETS             (2 * QOS_CLASSIFIER_MAX_CONDITIONS)
+#define TC_RTAB_CELL_LOG        8       /* Rate table covers 64 KB packets */
+#define TC_POLICE_MTU           65535
+#define TC_TICK_NS              64      /* Kernel psched tick */
+
+/* Flower keys of a match set */
+#define TC_KEY_PROTO            (1u << 0)
+#define TC_KEY_SRC_IP           (1u << 1)
+#define TC_KEY_DST_IP           (1u << 2)
+#define TC_KEY_SRC_PORT         (1u << 3)
+#define TC_KEY_DST_PORT         (1u << 4)
+#define TC_KEY_TOS              (1u << 5)
+#define TC_KEY_INDEV            (1u << 6)
+#define TC_KEY_PORTS            (TC_KEY_SRC_PORT | TC_KEY_DST_PORT)
+
+/* One flower filter worth of match keys, host byte order */
+struct tc_match {
+    uint32_t keys;
+    uint8_t protocol;
+    uint32_t src_ip;
+    uint32_t src_mask;
+    uint32_t dst_ip;
+    uint32_t dst_mask;
+    uint16_t sport_min;
+    uint16_t sport_max;
+    uint16_t dport_min;
+    uint16_t dport_max;
+    uint8_t tos;
+    uint8_t tos_mask;
+    ifid_t indev;
+};
+
+/* Request being encoded */
+struct tc_msg {
+    struct nlmsghdr *nlh;
+    size_t max;
+    bool overflow;
+};
+
+/* Filter change sent to the kernel */
+struct tc_op {
+    uint16_t prio;
+    uint16_t handle;
+    uint32_t hash;
+    bool remove;
+    bool used;
+    int error;
+};
+
+/* Requests sent in one sendmsg */
+struct tc_batch {
+    char *buf;
+    size_t len;
+    uint32_t count;
+    uint32_t seq_first;
+    struct tc_op *ops;          /* Op of each request, in sequence order */
+};
+
+/* Desired filter */
+struct tc_want {
+    uint16_t prio;
+    uint16_t handle;
+    uint32_t hash;
+    uint16_t rule;
+    uint16_t set;
+};
+
+static int tc_nl_fd = -1;
+static uint32_t tc_nl_seq = 0;
+static pthread_mutex_t tc_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int tc_socket(void)
+{
+    if (tc_nl_fd >= 0) {
+        return tc_nl_fd;
+    }
+    int fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (fd < 0) {
+        return -1;
+    }
+    /* Errors echo only the header, so a failed batch fits the receive buffer */
+    int one = 1;
+    setsockopt(fd, SOL_NETLINK, NETLINK_CAP_ACK, &one, sizeof(one));
+    tc_nl_fd = fd;
+    return fd;
+}
+
+/* ---- Message encoding ---- */
+
+static struct tcmsg *tc_msg_init(struct tc_msg *m, char *buf, size_t max, uint16_t type,
+                                 uint16_t flags)
+{
+    memset(buf, 0, NLMSG_SPACE(sizeof(struct tcmsg)));
+    m->nlh = (struct nlmsghdr *)buf;
+    m->max = max;
+    m->overflow = false;
+    m->nlh->nlmsg_len = NLMSG_LENGTH(sizeof(struct tcmsg));
+    m->nlh->nlmsg_type = type;
+    m->nlh->nlmsg_flags = NLM_F_REQUEST | flags;
+    return NLMSG_DATA(m->nlh);
+}
+
+static struct rtattr *tc_put(struct tc_msg *m, uint16_t type, const void *data, size_t len)
+{
+    size_t offset = NLMSG_ALIGN(m->nlh->nlmsg_len);
+    if (m->overflow || offset + RTA_SPACE(len) > m->max) {
+        m->overflow = true;
+        return NULL;
+    }
+    struct rtattr *rta = (struct rtattr *)((char *)m->nlh + offset);
+    rta->rta_type = type;
+    rta->rta_len = RTA_LENGTH(len);
+    if (len) {
+        memcpy(RTA_DATA(rta), data, len);
+    }
+    m->nlh->nlmsg_len = offset + RTA_SPACE(len);
+    return rta;
+}
+
+static void tc_put_u8(struct tc_msg *m, uint16_t type, uint8_t value)
+{
+    tc_put(m, type, &value, sizeof(value));
+}
+
+static void tc_put_u16(struct tc_msg *m, uint16_t type, uint16_t value)
+{
+    tc_put(m, type, &value, sizeof(value));
+}
+
+static void tc_put_u32(struct tc_msg *m, uint16_t type, uint32_t value)
+{
+    tc_put(m, type, &value, sizeof(value));
+}
+
+static void tc_put_str(struct tc_msg *m, uint16_t type, const char *value)
+{
+    tc_put(m, type, value, strlen(value) + 1);
+}
+
+static struct rtattr *tc_nest(struct tc_msg *m, uint16_t type)
+{
+    return tc_put(m, type | NLA_F_NESTED, NULL, 0);
+}
+
+static void tc_nest_end(struct tc_msg *m, struct rtattr *nest)
+{
+    if (nest && !m->overflow) {
+        nest->rta_len = (unsigned short)((char *)m->nlh + m->nlh->nlmsg_len - (char *)nest);
+    }
+}
+
+/* FNV-1a of the attributes after the tcmsg header */
+static uint32_t tc_msg_hash(const struct tc_msg *m)
+{
+    const uint8_t *p = (const uint8_t *)m->nlh + NLMSG_LENGTH(sizeof(struct tcmsg));
+    const uint8_t *end = (const uint8_t *)m->nlh + m->nlh->nlmsg_len;
+    uint32_t hash = 2166136261u;
+
+    while (p < end) {
+        hash = (hash ^ *p++) * 16777619u;
+    }
+    return hash;
+}
+
+static uint32_t tc_parent(const struct qos_tc_state *state)
+{
+    return TC_H_MAKE(TC_H_CLSACT, state->egress ? TC_H_MIN_EGRESS : TC_H_MIN_INGRESS);
+}
+
+/* ---- Classifier expansion ---- */
+
+static uint32_t prefix_mask(uint8_t prefix_len)
+{
+    return prefix_len ? ~0u << (32 - prefix_len) : 0;
+}
+
+/* Add one condition to a match set; fails for conditions flower cannot express */
+static int tc_match_add(struct tc_match *match, const struct match_condition *cond)
+{
+    uint32_t key;
+
+    switch (cond->type) {
+        case MATCH_TYPE_DSCP:
+            key = TC_KEY_TOS;
+            match->tos = (uint8_t)(cond->value.dscp << 2);
+            match->tos_mask = 0xfc;
+            break;
+        case MATCH_TYPE_IP_PRECEDENCE:
+            key = TC_KEY_TOS;
+            match->tos = (uint8_t)(cond->value.ip_precedence << 5);
+            match->tos_mask = 0xe0;
+            break;
+        case MATCH_TYPE_SOURCE_IP:
+            key = TC_KEY_SRC_IP;
+            match->src_mask = prefix_mask(cond->value.ip.prefix_len);
+            match->src_ip = cond->value.ip.addr & match->src_mask;
+            break;
+        case MATCH_TYPE_DEST_IP:
+            key = TC_KEY_DST_IP;
+            match->dst_mask = prefix_mask(cond->value.ip.prefix_len);
+            match->dst_ip = cond->value.ip.addr & match->dst_mask;
+            break;
+        case MATCH_TYPE_SOURCE_PORT:
+            key = TC_KEY_SRC_PORT;
+            match->sport_min = cond->value.port.min;
+            match->sport_max = cond->value.port.max;
+            break;
+        case MATCH_TYPE_DEST_PORT:
+            key = TC_KEY_DST_PORT;
+            match->dport_min = cond->value.port.min;
+            match->dport_max = cond->value.port.max;
+            break;
+        case MATCH_TYPE_PROTOCOL:
+            key = TC_KEY_PROTO;
+            match->protocol = cond->value.protocol;
+            break;
+        case MATCH_TYPE_INTERFACE:
+            key = TC_KEY_INDEV;
+            match->indev = cond->value.ifid;
+            break;
+        default:
+            /* ACLs and packet length have no flower key */
+            return -EOPNOTSUPP;
+    }
+
+    if (match->keys & key) {
+        return -EOPNOTSUPP;
+    }
+    match->keys |= key;
+    return 0;
+}
+
+static bool port_protocol(uint8_t protocol)
+{
+    return protocol == IPPROTO_TCP || protocol == IPPROTO_UDP || protocol == IPPROTO_SCTP;
+}
+
+/*
+ * Match sets of a classifier: one for operator and, one per condition
+ * for operator or. Port matches without a protocol become a TCP and a
+ * UDP set. Returns the number of sets or a negative errno.
+ */
+static int tc_expand(const struct traffic_classifier *classifier, struct tc_match *sets)
+{
+    int count = 0;
+
+    for (int i = 0; i < classifier->condition_count; i++) {
+        if (classifier->operator == CLASSIFIER_OPERATOR_OR || count == 0) {
+            memset(&sets[count++], 0, sizeof(sets[0]));
+        }
+        int ret = tc_match_add(&sets[count - 1], &classifier->conditions[i]);
+        if (ret < 0) {
+            return ret;
+        }
+    }
+
+    int expanded = count;
+    for (int i = 0; i < count; i++) {
+        struct tc_match *set = &sets[i];
+        if (!(set->keys & TC_KEY_PORTS)) {
+            continue;
+        }
+        if (set->keys & TC_KEY_PROTO) {
+            if (!port_protocol(set->protocol)) {
+                return -EOPNOTSUPP;
+            }
+            continue;
+        }
+        set->keys |= TC_KEY_PROTO;
+        set->protocol = IPPROTO_TCP;
+        sets[expanded] = *set;
+        sets[expanded++].protocol = IPPROTO_UDP;
+    }
+    return expanded;
+}
+
+static void tc_put_port(struct tc_msg *m, uint8_t protocol, bool source, uint16_t min, uint16_t max)
+{
+    if (min != max) {
+        tc_put_u16(m, source ? TCA_FLOWER_KEY_PORT_SRC_MIN : TCA_FLOWER_KEY_PORT_DST_MIN, htons(min));
+        tc_put_u16(m, source ? TCA_FLOWER_KEY_PORT_SRC_MAX : TCA_FLOWER_KEY_PORT_DST_MAX, htons(max));
+        return;
+    }
+
+    uint16_t key, mask;
+    if (protocol == IPPROTO_TCP) {
+        key = source ? TCA_FLOWER_KEY_TCP_SRC : TCA_FLOWER_KEY_TCP_DST;
+        mask = source ? TCA_FLOWER_KEY_TCP_SRC_MASK : TCA_FLOWER_KEY_TCP_DST_MASK;
+    } else if (protocol == IPPROTO_UDP) {
+        key = source ? TCA_FLOWER_KEY_UDP_SRC : TCA_FLOWER_KEY_UDP_DST;
+        mask = source ? TCA_FLOWER_KEY_UDP_SRC_MASK : TCA_FLOWER_KEY_UDP_DST_MASK;
+    } else {
+        key = source ? TCA_FLOWER_KEY_SCTP_SRC : TCA_FLOWER_KEY_SCTP_DST;
+        mask = source ? TCA_FLOWER_KEY_SCTP_SRC_MASK : TCA_FLOWER_KEY_SCTP_DST_MASK;
+    }
+    tc_put_u16(m, key, htons(min));
+    tc_put_u16(m, mask, 0xffff);
+}
+
+static int tc_put_match(struct tc_msg *m, const struct tc_match *match)
+{
+    tc_put_u16(m, TCA_FLOWER_KEY_ETH_TYPE, htons(ETH_P_IP));
+    tc_put_u32(m, TCA_FLOWER_FLAGS, 0);
+
+    if (match->keys & TC_KEY_INDEV) {
+        const char *name = if_name(match->indev);
+        if (!name) {
+            return -ENODEV;
+        }
+        tc_put_str(m, TCA_FLOWER_INDEV, name);
+    }
+    if (match->keys & TC_KEY_PROTO) {
+        tc_put_u8(m, TCA_FLOWER_KEY_IP_PROTO, match->protocol);
+    }
+    if ((match->keys & TC_KEY_SRC_IP) && match->src_mask) {
+        tc_put_u32(m, TCA_FLOWER_KEY_IPV4_SRC, htonl(match->src_ip));
+        tc_put_u32(m, TCA_FLOWER_KEY_IPV4_SRC_MASK, htonl(match->src_mask));
+    }
+    if ((match->keys & TC_KEY_DST_IP) && match->dst_mask) {
+        tc_put_u32(m, TCA_FLOWER_KEY_IPV4_DST, htonl(match->dst_ip));
+        tc_put_u32(m, TCA_FLOWER_KEY_IPV4_DST_MASK, htonl(match->dst_mask));
+    }
+    if (match->keys & TC_KEY_SRC_PORT) {
+        tc_put_port(m, match->protocol, true, match->sport_min, match->sport_max);
+    }
+    if (match->keys & TC_KEY_DST_PORT) {
+        tc_put_port(m, match->protocol, false, match->dport_min, match->dport_max);
+    }
+    if (match->keys & TC_KEY_TOS) {
+        tc_put_u8(m, TCA_FLOWER_KEY_IP_TOS, match->tos);
+        tc_put_u8(m, TCA_FLOWER_KEY_IP_TOS_MASK, match->tos_mask);
+    }
+    return 0;
+}
+
+/* ---- Actions ---- */
+
+/* Kernel ticks to send bytes at rate bytes per second */
+static uint32_t tc_xmit_ticks(uint64_t bytes, uint64_t rate)
+{
+    uint64_t ticks = bytes * (1000000000ull / TC_TICK_NS) / rate;
+    return ticks > UINT32_MAX ? UINT32_MAX : (uint32_t)ticks;
+}
+
+static struct rtattr *tc_action_begin(struct tc_msg *m, int order, const char *kind)
+{
+    struct rtattr *nest = tc_nest(m, (uint16_t)order);
+    tc_put_str(m, TCA_ACT_KIND, kind);
+    return nest;
+}
+
+static void tc_put_gact(struct tc_msg *m, int order, int verdict)
+{
+    struct tc_gact gact = { .action = verdict };
+    struct rtattr *act = tc_action_begin(m, order, "gact");
+    struct rtattr *opt = tc_nest(m, TCA_ACT_OPTIONS);
+    tc_put(m, TCA_GACT_PARMS, &gact, sizeof(gact));
+    tc_nest_end(m, opt);
+    tc_nest_end(m, act);
+}
+
+/*
+ * The kernel policer is a single color-blind token bucket. Keep the
+ * traffic the CAR passes: when yellow passes, police at PIR / PBS
+ * (CIR with CBS + EBS for a single rate CAR) and apply the red action
+ * above it; otherwise police at CIR / CBS and drop the excess.
+ */
+static int tc_put_police(struct tc_msg *m, int order, const struct car_config *car)
+{
+    if (car->color_aware) {
+        return -EOPNOTSUPP;
+    }
+
+    uint64_t kbps = car->cir;
+    uint64_t burst = car->cbs;
+    if (car->yellow_pass) {
+        if (car->pir) {
+            kbps = car->pir;
+            burst = car->pbs;
+        } else {
+            burst += car->pbs;
+        }
+    }
+    uint64_t rate = kbps * 125;
+    if (rate == 0) {
+        return -EINVAL;
+    }
+
+    struct tc_police police;
+    memset(&police, 0, sizeof(police));
+    police.action = car->yellow_pass && !car->red_discard ? TC_ACT_PIPE : TC_ACT_SHOT;
+    police.mtu = TC_POLICE_MTU;
+    police.burst = tc_xmit_ticks(burst, rate);
+    police.rate.rate = rate > UINT32_MAX ? UINT32_MAX : (uint32_t)rate;
+    police.rate.cell_log = TC_RTAB_CELL_LOG;
+    police.rate.linklayer = TC_LINKLAYER_ETHERNET;
+
+    uint32_t rtab[TC_RTAB_SIZE / sizeof(uint32_t)];
+    for (uint32_t i = 0; i < TC_RTAB_SIZE / sizeof(uint32_t); i++) {
+        rtab[i] = tc_xmit_ticks((uint64_t)(i + 1) << TC_RTAB_CELL_LOG, rate);
+    }
+
+    struct rtattr *act = tc_action_begin(m, order, "police");
+    struct rtattr *opt = tc_nest(m, TCA_ACT_OPTIONS);
+    tc_put(m, TCA_POLICE_TBF, &police, sizeof(police));
+    tc_put(m, TCA_POLICE_RATE, rtab, sizeof(rtab));
+    if (rate > UINT32_MAX) {
+        uint64_t rate64 = rate;
+        tc_put(m, TCA_POLICE_RATE64, &rate64, sizeof(rate64));
+    }
+    tc_put_u32(m, TCA_POLICE_RESULT, car->green_pass ? TC_ACT_PIPE : TC_ACT_SHOT);
+    tc_nest_end(m, opt);
+    tc_nest_end(m, act);
+    return 0;
+}
+
+/* Rewrite the TOS bits under mask, then fix the IPv4 header checksum */
+static int tc_put_remark(struct tc_msg *m, int order, uint8_t tos, uint8_t tos_mask)
+{
+    struct tc_pedit_key key = {
+        .mask = htonl(~((uint32_t)tos_mask << 16)),
+        .val = htonl((uint32_t)tos << 16),
+        .off = 0,
+    };
+    struct tc_pedit_sel sel;
+    char parms[sizeof(sel) + sizeof(key)];
+
+    memset(&sel, 0, sizeof(sel));
+    sel.action = TC_ACT_PIPE;
+    sel.nkeys = 1;
+    memcpy(parms, &sel, sizeof(sel));
+    memcpy(parms + sizeof(sel), &key, sizeof(key));
+
+    struct rtattr *act = tc_action_begin(m, order, "pedit");
+    struct rtattr *opt = tc_nest(m, TCA_ACT_OPTIONS);
+    tc_put(m, TCA_PEDIT_PARMS, parms, sizeof(parms));
+    tc_nest_end(m, opt);
+    tc_nest_end(m, act);
+
+    struct tc_csum csum = { .action = TC_ACT_PIPE, .update_flags = TCA_CSUM_UPDATE_FLAG_IPV4HDR };
+    act = tc_action_begin(m, order + 1, "csum");
+    opt = tc_nest(m, TCA_ACT_OPTIONS);
+    tc_put(m, TCA_CSUM_PARMS, &csum, sizeof(csum));
+    tc_nest_end(m, opt);
+    tc_nest_end(m, act);
+    return 2;
+}
+
+static void tc_put_skbedit(struct tc_msg *m, int order, uint32_t priority)
+{
+    struct tc_skbedit skbedit = { .action = TC_ACT_PIPE };
+    struct rtattr *act = tc_action_begin(m, order, "skbedit");
+    struct rtattr *opt = tc_nest(m, TCA_ACT_OPTIONS);
+    tc_put(m, TCA_SKBEDIT_PARMS, &skbedit, sizeof(skbedit));
+    tc_put_u32(m, TCA_SKBEDIT_PRIORITY, priority);
+    tc_nest_end(m, opt);
+    tc_nest_end(m, act);
+}
+
+static int tc_put_redirect(struct tc_msg *m, int order, ifid_t ifid)
+{
+    int ifindex = if_kernel_index(ifid);
+    if (ifindex <= 0) {
+        return -ENODEV;
+    }
+
+    struct tc_mirred mirred = {
+        .action = TC_ACT_STOLEN,
+        .eaction = TCA_EGRESS_REDIR,
+        .ifindex = (uint32_t)ifindex,
+    };
+    struct rtattr *act = tc_action_begin(m, order, "mirred");
+    struct rtattr *opt = tc_nest(m, TCA_ACT_OPTIONS);
+    tc_put(m, TCA_MIRRED_PARMS, &mirred, sizeof(mirred));
+    tc_nest_end(m, opt);
+    tc_nest_end(m, act);
+    return 0;
+}
+
+/*
+ * Action list of a behavior. Deny and redirect end the list; otherwise
+ * a final accept stops the packet from matching later rules.
+ */
+static int tc_put_actions(struct tc_msg *m, const struct traffic_behavior *behavior)
+{
+    struct rtattr *list = tc_nest(m, TCA_FLOWER_ACT);
+    int order = 1;
+    bool final = false;
+
+    for (int i = 0; i < behavior->action_count && !final; i++) {
+        const struct traffic_action *action = &behavior->actions[i];
+        int ret = 0;
+
+        switch (action->type) {
+            case ACTION_TYPE_REMARK_DSCP:
+                order += tc_put_remark(m, order, (uint8_t)(action->value.dscp << 2), 0xfc);
+                break;
+            case ACTION_TYPE_REMARK_IP_PRECEDENCE:
+                order += tc_put_remark(m, order, (uint8_t)(action->value.ip_precedence << 5), 0xe0);
+                break;
+            case ACTION_TYPE_CAR:
+                ret = tc_put_police(m, order++, &action->value.car);
+                break;
+            case ACTION_TYPE_PRIORITY:
+                tc_put_skbedit(m, order++, action->value.priority);
+                break;
+            case ACTION_TYPE_DENY:
+                tc_put_gact(m, order++, TC_ACT_SHOT);
+                final = true;
+                break;
+            case ACTION_TYPE_REDIRECT:
+                ret = tc_put_redirect(m, order++, action->value.redirect_ifid);
+                final = true;
+                break;
+        }
+        if (ret < 0) {
+            return ret;
+        }
+        if (order > TCA_ACT_MAX_PRIO) {
+            return -E2BIG;
+        }
+    }
+    if (!final) {
+        tc_put_gact(m, order, TC_ACT_OK);
+    }
+    tc_nest_end(m, list);
+    return 0;
+}
+
+static int tc_encode_filter(struct tc_msg *m, char *buf, size_t max, const struct qos_tc_state *state,
+                            uint16_t prio, uint16_t handle, const struct tc_match *match,
+                            const struct traffic_behavior *behavior)
+{
+    struct tcmsg *tcm = tc_msg_init(m, buf, max, RTM_NEWTFILTER,
+                                    NLM_F_ACK | NLM_F_CREATE | NLM_F_REPLACE);
+    tcm->tcm_family = AF_UNSPEC;
+    tcm->tcm_ifindex = state->ifindex;
+    tcm->tcm_parent = tc_parent(state);
+    tcm->tcm_handle = handle;
+    tcm->tcm_info = TC_H_MAKE((uint32_t)prio << 16, htons(ETH_P_IP));
+
+    tc_put_str(m, TCA_KIND, "flower");
+    struct rtattr *opt = tc_nest(m, TCA_OPTIONS);
+    int ret = tc_put_match(m, match);
+    if (ret == 0) {
+        ret = tc_put_actions(m, behavior);
+    }
+    tc_nest_end(m, opt);
+
+    if (ret == 0 && m->overflow) {
+        ret = -EMSGSIZE;
+    }
+    return ret;
+}
+
+static void tc_encode_delete(struct tc_msg *m, char *buf, size_t max, const struct qos_tc_state *state,
+                             uint16_t prio, uint16_t handle)
+{
+    struct tcmsg *tcm = tc_msg_init(m, buf, max, RTM_DELTFILTER, NLM_F_ACK);
+    tcm->tcm_family = AF_UNSPEC;
+    tcm->tcm_ifindex = state->ifindex;
+    tcm->tcm_parent = tc_parent(state);
+    tcm->tcm_handle = handle;
+    tcm->tcm_info = TC_H_MAKE((uint32_t)prio << 16, htons(ETH_P_IP));
+    tc_put_str(m, TCA_KIND, "flower");
+}
+
+/* ---- Batches ---- */
+
+/* Send the queued requests and record each acknowledgement in its op */
+static int tc_batch_flush(struct tc_batch *batch)
+{
+    if (batch->count == 0) {
+        return 0;
+    }
+
+    int ret = 0;
+    uint32_t pending = batch->count;
+    if (send(tc_nl_fd, batch->buf, batch->len, 0) < 0) {
+        ret = -errno;
+    }
+
+    char *buf = ret == 0 ? malloc(TC_NL_BUFFER_SIZE) : NULL;
+    if (ret == 0 && !buf) {
+        ret = -ENOMEM;
+    }
+    while (ret == 0 && pending) {
+        ssize_t len = recv(tc_nl_fd, buf, TC_NL_BUFFER_SIZE, 0);
+        if (len < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ret = -errno;
+            break;
+        }
+        for (struct nlmsghdr *nlh = (struct nlmsghdr *)buf; NLMSG_OK(nlh, len);
+             nlh = NLMSG_NEXT(nlh, len)) {
+            uint32_t i = nlh->nlmsg_seq - batch->seq_first;
+            if (nlh->nlmsg_type != NLMSG_ERROR || i >= batch->count || batch->ops[i].used) {
+                continue;
+            }
+            const struct nlmsgerr *err = NLMSG_DATA(nlh);
+            batch->ops[i].error = err->error;
+            batch->ops[i].used = true;
+            pending--;
+        }
+    }
+    free(buf);
+
+    /* Requests without an answer count as failed */
+    for (uint32_t i = 0; i < batch->count; i++) {
+        if (!batch->ops[i].used) {
+            batch->ops[i].error = ret ? ret : -EIO;
+        }
+        batch->ops[i].used = false;
+    }
+    batch->ops += batch->count;
+    batch->len = 0;
+    batch->count = 0;
+    return ret;
+}
+
+/* Room for the next request, flushing when the buffer is full */
+static char *tc_batch_reserve(struct tc_batch *batch)
+{
+    if (batch->len + TC_MSG_SIZE > TC_NL_BUFFER_SIZE) {
+        tc_batch_flush(batch);
+    }
+    return batch->buf + batch->len;
+}
+
+static void tc_batch_commit(struct tc_batch *batch, struct tc_msg *m, uint16_t prio,
+                            uint16_t handle, uint32_t hash, bool remove)
+{
+    struct tc_op *op = &batch->ops[batch->count];
+
+    if (batch->count == 0) {
+        batch->seq_first = tc_nl_seq + 1;
+    }
+    m->nlh->nlmsg_seq = ++tc_nl_seq;
+    batch->len += NLMSG_ALIGN(m->nlh->nlmsg_len);
+    batch->count++;
+
+    op->prio = prio;
+    op->handle = handle;
+    op->hash = hash;
+    op->remove = remove;
+    op->used = false;
+    op->error = 0;
+}
+
+/* ---- State ---- */
+
+static int tc_filter_cmp(const void *a, const void *b)
+{
+    const struct qos_tc_filter *fa = a, *fb = b;
+    uint32_t ka = (uint32_t)fa->prio << 16 | fa->handle;
+    uint32_t kb = (uint32_t)fb->prio << 16 | fb->handle;
+    return ka < kb ? -1 : ka > kb;
+}
+
+static struct qos_tc_filter *tc_state_find(struct qos_tc_state *state, uint16_t prio, uint16_t handle)
+{
+    struct qos_tc_filter key = { .prio = prio, .handle = handle };
+    return bsearch(&key, state->filters, state->filter_count, sizeof(key), tc_filter_cmp);
+}
+
+/* Fold the acknowledged ops into the installed filter list */
+static void tc_state_apply(struct qos_tc_state *state, const struct tc_op *ops, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        const struct tc_op *op = &ops[i];
+        if (op->error) {
+            continue;
+        }
+        struct qos_tc_filter *filter = tc_state_find(state, op->prio, op->handle);
+        if (op->remove) {
+            if (filter) {
+                *filter = state->filters[--state->filter_count];
+                qsort(state->filters, state->filter_count, sizeof(*filter), tc_filter_cmp);
+            }
+        } else if (filter) {
+            filter->hash = op->hash;
+        } else if (state->filter_count < QOS_TC_MAX_FILTERS) {
+            filter = &state->filters[state->filter_count++];
+            filter->prio = op->prio;
+            filter->handle = op->handle;
+            filter->hash = op->hash;
+            qsort(state->filters, state->filter_count, sizeof(*filter), tc_filter_cmp);
+        }
+    }
+}
+
+/* clsact on the interface; an existing one is fine */
+static int tc_qdisc_create(struct qos_tc_state *state)
+{
+    char buf[256];
+    struct tc_msg m;
+    struct tcmsg *tcm = tc_msg_init(&m, buf, sizeof(buf), RTM_NEWQDISC,
+                                    NLM_F_ACK | NLM_F_CREATE | NLM_F_EXCL);
+    tcm->tcm_family = AF_UNSPEC;
+    tcm->tcm_ifindex = state->ifindex;
+    tcm->tcm_handle = TC_H_MAKE(TC_H_CLSACT, 0);
+    tcm->tcm_parent = TC_H_CLSACT;
+    tc_put_str(&m, TCA_KIND, "clsact");
+
+    struct tc_op op;
+    struct tc_batch batch = { .buf = buf, .ops = &op };
+    tc_batch_commit(&batch, &m, 0, 0, 0, false);
+    int ret = tc_batch_flush(&batch);
+    if (ret == 0 && op.error && op.error != -EEXIST) {
+        ret = op.error;
+    }
+    state->qdisc = ret == 0;
+    return ret;
+}
+
+struct qos_tc_state *qos_tc_attach(int ifindex, bool egress)
+{
+    if (ifindex <= 0) {
+        return NULL;
+    }
+    struct qos_tc_state *state = calloc(1, sizeof(*state));
+    if (!state) {
+        return NULL;
+    }
+    state->ifindex = ifindex;
+    state->egress = egress;
+    state->error_rule = -1;
+    return state;
+}
+
+/*
+ * Bring the kernel filters in line with the rules. Rules with a missing
+ * classifier or behavior are skipped, as in software. If any rule cannot
+ * be offloaded, state->error_rule names it and every filter is removed,
+ * leaving the whole policy to software. Returns 0 or a negative errno,
+ * the first error of the batch.
+ */
+int qos_tc_sync(struct qos_tc_state *state, const struct qos_tc_rule *rules, uint32_t count)
+{
+    struct tc_match sets[TC_MAX_SETS];
+    struct tc_want *want = malloc(QOS_TC_MAX_FILTERS * sizeof(*want));
+    struct tc_op *ops = malloc(2 * QOS_TC_MAX_FILTERS * sizeof(*ops));
+    char *scratch = malloc(TC_MSG_SIZE);
+    char *buf = malloc(TC_NL_BUFFER_SIZE);
+    uint32_t want_count = 0;
+    int ret = 0;
+
+    if (!want || !ops || !scratch || !buf) {
+        ret = -ENOMEM;
+        goto out;
+    }
+
+    pthread_mutex_lock(&tc_lock);
+    if (tc_socket() < 0) {
+        ret = -errno;
+        goto unlock;
+    }
+    if (!state->qdisc && (ret = tc_qdisc_create(state)) < 0) {
+        goto unlock;
+    }
+
+    /* Desired filters and the hash of their encoding. After a failed rule nothing is installed */
+    bool full = state->error_rule >= 0;
+    state->error_rule = -1;
+    for (uint32_t r = 0; r < count && state->error_rule < 0; r++) {
+        if (!rules[r].classifier || !rules[r].behavior) {
+            continue;
+        }
+        if (!full && !rules[r].changed) {
+            /* Unchanged rule: its filters stay as installed */
+            for (uint32_t i = 0; i < state->filter_count && want_count < QOS_TC_MAX_FILTERS; i++) {
+                const struct qos_tc_filter *filter = &state->filters[i];
+                if (filter->prio == r + 1) {
+                    want[want_count++] = (struct tc_want) {
+                        .prio = filter->prio, .handle = filter->handle, .hash = filter->hash,
+                        .rule = (uint16_t)r, .set = (uint16_t)(filter->handle - 1),
+                    };
+                }
+            }
+            continue;
+        }
+        int n = tc_expand(rules[r].classifier, sets);
+        for (int s = 0; s < n; s++) {
+            struct tc_msg m;
+            int err = want_count < QOS_TC_MAX_FILTERS ?
+                      tc_encode_filter(&m, scratch, TC_MSG_SIZE, state, (uint16_t)(r + 1),
+                                       (uint16_t)(s + 1), &sets[s], rules[r].behavior) : -E2BIG;
+            if (err < 0) {
+                n = err;
+                break;
+            }
+            want[want_count++] = (struct tc_want) {
+                .prio = (uint16_t)(r + 1), .handle = (uint16_t)(s + 1),
+                .hash = tc_msg_hash(&m), .rule = (uint16_t)r, .set = (uint16_t)s,
+            };
+        }
+        if (n < 0) {
+            state->error_rule = (int)r;
+            ret = n;
+            want_count = 0;
+        }
+    }
+
+    /* Changed and new filters, then stale ones */
+    struct tc_batch batch = { .buf = buf, .ops = ops };
+    int expanded = -1;
+    for (uint32_t i = 0; i < want_count; i++) {
+        const struct qos_tc_filter *old = tc_state_find(state, want[i].prio, want[i].handle);
+        if (old && old->hash == want[i].hash) {
+            continue;
+        }
+        if (want[i].rule != expanded) {
+            expanded = want[i].rule;
+            tc_expand(rules[expanded].classifier, sets);
+        }
+        struct tc_msg m;
+        tc_encode_filter(&m, tc_batch_reserve(&batch), TC_MSG_SIZE, state, want[i].prio,
+                         want[i].handle, &sets[want[i].set], rules[expanded].behavior);
+        tc_batch_commit(&batch, &m, want[i].prio, want[i].handle, want[i].hash, false);
+    }
+    for (uint32_t i = 0; i < state->filter_count; i++) {
+        const struct qos_tc_filter *filter = &state->filters[i];
+        bool keep = false;
+        for (uint32_t j = 0; j < want_count && !keep; j++) {
+            keep = want[j].prio == filter->prio && want[j].handle == filter->handle;
+        }
+        if (!keep) {
+            struct tc_msg m;
+            tc_encode_delete(&m, tc_batch_reserve(&batch), TC_MSG_SIZE, state, filter->prio,
+                             filter->handle);
+            tc_batch_commit(&batch, &m, filter->prio, filter->handle, 0, true);
+        }
+    }
+    tc_batch_flush(&batch);
+
+    uint32_t op_count = (uint32_t)(batch.ops - ops);
+    state->batch_messages = op_count;
+    for (uint32_t i = 0; i < op_count && ret == 0; i++) {
+        /* A filter already gone is as good as deleted */
+        if (ops[i].remove && ops[i].error == -ENOENT) {
+            ops[i].error = 0;
+        }
+        ret = ops[i].error;
+    }
+    tc_state_apply(state, ops, op_count);
+
+unlock:
+    pthread_mutex_unlock(&tc_lock);
+out:
+    free(want);
+    free(ops);
+    free(scratch);
+    free(buf);
+    return ret;
+}
+
+/* ---- Counters ---- */
+
+static struct rtattr *tc_attr_find(struct rtattr *rta, int len, uint16_t type)
+{
+    for (; RTA_OK(rta, len); rta = RTA_NEXT(rta, len)) {
+        if ((rta->rta_type & NLA_TYPE_MASK) == type) {
+            return rta;
+        }
+    }
+    return NULL;
+}
+
+static struct rtattr *tc_attr_nested(struct rtattr *nest, uint16_t type)
+{
+    return nest ? tc_attr_find(RTA_DATA(nest), (int)RTA_PAYLOAD(nest), type) : NULL;
+}
+
+/* Counters of the first action of a filter: every match passes it */
+static void tc_handle_filter(struct qos_tc_state *state, struct nlmsghdr *nlh,
+                             uint64_t *packets, uint64_t *bytes, uint32_t count)
+{
+    struct tcmsg *tcm = NLMSG_DATA(nlh);
+    if (nlh->nlmsg_len < NLMSG_LENGTH(sizeof(*tcm)) || tcm->tcm_handle == 0) {
+        return;
+    }
+    uint32_t prio = TC_H_MAJ(tcm->tcm_info) >> 16;
+    if (prio == 0 || prio > count || prio > UINT16_MAX ||
+        !tc_state_find(state, (uint16_t)prio, (uint16_t)tcm->tcm_handle)) {
+        return;
+    }
+
+    int len = (int)(nlh->nlmsg_len - NLMSG_LENGTH(sizeof(*tcm)));
+    struct rtattr *opt = tc_attr_find(TCA_RTA(tcm), len, TCA_OPTIONS);
+    struct rtattr *act = tc_attr_nested(tc_attr_nested(opt, TCA_FLOWER_ACT), 1);
+    struct rtattr *stats = tc_attr_nested(act, TCA_ACT_STATS);
+    struct rtattr *basic = tc_attr_nested(stats, TCA_STATS_BASIC);
+    struct rtattr *pkt64 = tc_attr_nested(stats, TCA_STATS_PKT64);
+    struct gnet_stats_basic sb;
+
+    if (!basic || RTA_PAYLOAD(basic) < sizeof(sb)) {
+        return;
+    }
+    memcpy(&sb, RTA_DATA(basic), sizeof(sb));
+    bytes[prio - 1] += sb.bytes;
+    if (pkt64 && RTA_PAYLOAD(pkt64) >= sizeof(uint64_t)) {
+        uint64_t value;
+        memcpy(&value, RTA_DATA(pkt64), sizeof(value));
+        packets[prio - 1] += value;
+    } else {
+        packets[prio - 1] += sb.packets;
+    }
+}
+
+/*
+ * Sum the kernel counters per rule into packets[] / bytes[], count
+ * entries each. The counters of a filter restart when it is replaced.
+ */
+int qos_tc_stats(struct qos_tc_state *state, uint64_t *packets, uint64_t *bytes, uint32_t count)
+{
+    memset(packets, 0, count * sizeof(*packets));
+    memset(bytes, 0, count * sizeof(*bytes));
+    if (state->filter_count == 0) {
+        return 0;
+    }
+
+    char *buf = malloc(TC_NL_BUFFER_SIZE);
+    if (!buf) {
+        return -ENOMEM;
+    }
+
+    pthread_mutex_lock(&tc_lock);
+    int ret = tc_socket() < 0 ? -errno : 0;
+    struct tc_msg m;
+    if (ret == 0) {
+        struct tcmsg *tcm = tc_msg_init(&m, buf, TC_NL_BUFFER_SIZE, RTM_GETTFILTER, NLM_F_DUMP);
+        tcm->tcm_family = AF_UNSPEC;
+        tcm->tcm_ifindex = state->ifindex;
+        tcm->tcm_parent = tc_parent(state);
+        m.nlh->nlmsg_seq = ++tc_nl_seq;
+        if (send(tc_nl_fd, buf, m.nlh->nlmsg_len, 0) < 0) {
+            ret = -errno;
+        }
+    }
+
+    uint32_t seq = tc_nl_seq;
+    bool done = ret != 0;
+    while (!done) {
+        ssize_t len = recv(tc_nl_fd, buf, TC_NL_BUFFER_SIZE, 0);
+        if (len < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ret = -errno;
+            break;
+        }
+        for (struct nlmsghdr *nlh = (struct nlmsghdr *)buf; NLMSG_OK(nlh, len);
+             nlh = NLMSG_NEXT(nlh, len)) {
+            if (nlh->nlmsg_seq != seq) {
+                continue;
+            }
+            if (nlh->nlmsg_type == NLMSG_DONE) {
+                done = true;
+            } else if (nlh->nlmsg_type == NLMSG_ERROR) {
+                ret = ((struct nlmsgerr *)NLMSG_DATA(nlh))->error;
+                done = true;
+            } else if (nlh->nlmsg_type == RTM_NEWTFILTER) {
+                tc_handle_filter(state, nlh, packets, bytes, count);
+            }
+        }
+    }
+    pthread_mutex_unlock(&tc_lock);
+    free(buf);
+    return ret;
+}
+
+/* Remove the filters of the policy; the clsact qdisc stays */
+void qos_tc_detach(struct qos_tc_state *state)
+{
+    if (!state) {
+        return;
+    }
+    if (state->filter_count) {
+        qos_tc_sync(state, NULL, 0);
+    }
+    free(state);
+}
@@ -0,0 +1,62 @@
+/*
+ * QoS Kernel Offload for Huawei VRP Style
+ * Copyright (C) 2026 WhiteBox NE Team
+ *
+ * Pushes an applied traffic policy into the Linux traffic control
+ * layer. The policy becomes flower filters on the clsact qdisc of the
+ * interface, one priority per policy rule in rule order, carrying
+ * police / pedit / skbedit / gact / mirred actions for the behavior.
+ * The kernel (or a NIC driver that accepts the filters) then does the
+ * classification, and the per-filter action counters are read back.
+ *
+ * Filters are diffed against the last synchronized state by a hash of
+ * their encoded attributes: only changed filters are replaced and only
+ * stale ones deleted, all sent in one netlink batch. Replacements and
+ * additions go before deletions, so traffic never sees a rule missing.
+ * Rules not marked changed keep their installed filters without being
+ * encoded again. A batch is not a transaction; the state records what
+ * the kernel accepted, so the caller keeps rules marked changed until a
+ * synchronization succeeds.
+ */
+
+#ifndef _QOS_TC_OFFLOAD_H
+#define _QOS_TC_OFFLOAD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "qos_classifier.h"
+#include "qos_behavior.h"
+
+#define QOS_TC_MAX_FILTERS      512
+
+/* One rule of a policy, in match order */
+struct qos_tc_rule {
+    const struct traffic_classifier *classifier;
+    const struct traffic_behavior *behavior;
+    bool changed;               /* Edited since the last successful sync */
+};
+
+/* Filter installed in the kernel */
+struct qos_tc_filter {
+    uint16_t prio;              /* Rule index + 1 */
+    uint16_t handle;            /* Match set of the rule + 1 */
+    uint32_t hash;              /* Of the encoded options */
+};
+
+/* Offload state of one policy on one interface direction */
+struct qos_tc_state {
+    int ifindex;
+    bool egress;
+    bool qdisc;                 /* clsact known to exist */
+    int error_rule;             /* Rule that cannot be offloaded, or -1 */
+    uint32_t filter_count;
+    struct qos_tc_filter filters[QOS_TC_MAX_FILTERS];   /* Sorted by prio, handle */
+    uint32_t batch_messages;    /* Messages sent by the last sync */
+};
+
+struct qos_tc_state *qos_tc_attach(int ifindex, bool egress);
+int qos_tc_sync(struct qos_tc_state *state, const struct qos_tc_rule *rules, uint32_t count);
+int qos_tc_stats(struct qos_tc_state *state, uint64_t *packets, uint64_t *bytes, uint32_t count);
+void qos_tc_detach(struct qos_tc_state *state);
+
+#endif /* _QOS_TC_OFFLOAD_H */
@@ -0,0 +1,170 @@
+/*
+ * QoS WRED Engine for Huawei VRP Style
+ * Copyright (C) 2026 WhiteBox NE Team
+ *
+ * This module implements weighted random early detection including:
+ * - EWMA average queue length in 16.16 fixed point, decayed over idle time
+ * - Green/yellow/red threshold profiles compiled to a linear slope
+ * - Branch-free drop decision against a per-CPU xorshift generator
+ * - Tail drop at the queue limit
+ * - Per-CPU enqueue and drop counters
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "qos_wred.h"
+
+/* Probability 1 in the 2^32 scale of the random numbers */
+#define QOS_WRED_P_ONE          (1ull << 32)
+
+static void wred_compile_color(struct qos_wred_color *color, const struct qos_wred_profile *profile)
+{
+    if (profile->max_threshold == 0 || profile->max_threshold <= profile->min_threshold) {
+        /* No profile: never drop early */
+        color->min = UINT32_MAX;
+        color->max = UINT32_MAX;
+        color->range = 0;
+        color->slope = 0;
+        return;
+    }
+
+    uint64_t maxp = QOS_WRED_P_ONE * (profile->drop_probability > 100 ? 100 :
+                                      profile->drop_probability) / 100;
+    color->min = (uint32_t)profile->min_threshold << QOS_WRED_SHIFT;
+    color->max = (uint32_t)profile->max_threshold << QOS_WRED_SHIFT;
+    color->range = color->max - color->min;
+    color->slope = (maxp << QOS_WRED_SHIFT) / color->range;
+}
+
+struct qos_wred *qos_wred_create(const struct qos_wred_profile profiles[QOS_COLOR_MAX],
+                                 uint8_t exponent, uint32_t limit, uint32_t cpu_count)
+{
+    if (cpu_count == 0) {
+        cpu_count = 1;
+    }
+    if (cpu_count > QOS_WRED_MAX_CPUS) {
+        cpu_count = QOS_WRED_MAX_CPUS;
+    }
+    if (exponent == 0 || exponent > 15) {
+        exponent = QOS_WRED_EXPONENT;
+    }
+
+    struct qos_wred *wred = calloc(1, sizeof(*wred));
+    if (!wred) {
+        return NULL;
+    }
+    wred->cpus = aligned_alloc(QOS_WRED_CACHELINE, cpu_count * sizeof(*wred->cpus));
+    if (!wred->cpus) {
+        free(wred);
+        return NULL;
+    }
+    memset(wred->cpus, 0, cpu_count * sizeof(*wred->cpus));
+    for (uint32_t i = 0; i < cpu_count; i++) {
+        wred->cpus[i].random = 0x9e3779b9u * (i + 1);
+    }
+
+    for (int c = 0; c < QOS_COLOR_MAX; c++) {
+        wred_compile_color(&wred->colors[c], &profiles[c]);
+    }
+    wred->exponent = exponent;
+    wred->limit = limit ? limit : UINT32_MAX;
+    wred->cpu_count = cpu_count;
+    return wred;
+}
+
+void qos_wred_destroy(struct qos_wred *wred)
+{
+    if (!wred) {
+        return;
+    }
+    free(wred->cpus);
+    free(wred);
+}
+
+/* Drop probability at an average, 2^32 = certain drop */
+static inline uint64_t wred_probability(const struct qos_wred_color *color, uint32_t average)
+{
+    /* Distance above min, clamped to [0, range] with selects, not branches */
+    uint32_t above = average >= color->min;
+    uint32_t d = (average - color->min) & (0u - above);
+    d = d < color->range ? d : color->range;
+
+    uint64_t p = ((uint64_t)d * color->slope) >> QOS_WRED_SHIFT;
+    uint64_t full = 0ull - (uint64_t)(average >= color->max);
+    return (p & ~full) | (QOS_WRED_P_ONE & full);
+}
+
+uint64_t qos_wred_drop_probability(const struct qos_wred *wred, qos_color_t color,
+                                   uint32_t average)
+{
+    return wred_probability(&wred->colors[color < QOS_COLOR_MAX ? color : QOS_COLOR_RED], average);
+}
+
+static inline uint32_t xorshift32(uint32_t *state)
+{
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+/*
+ * Admission of one packet to a queue currently holding qlen packets.
+ * Updates the average, so it runs under the same lock as the enqueue.
+ * Returns false when the packet is to be dropped.
+ */
+bool qos_wred_enqueue(struct qos_wred *wred, uint32_t cpu, uint32_t qlen, qos_color_t color)
+{
+    struct qos_wred_cpu *pc = &wred->cpus[cpu < wred->cpu_count ? cpu : cpu % wred->cpu_count];
+    uint32_t c = color < QOS_COLOR_MAX ? color : QOS_COLOR_RED;
+
+    /* avg += (q - avg) * 2^-exponent, in signed 16.16 */
+    int64_t sample = (int64_t)(qlen > 0xffff ? 0xffff : qlen) << QOS_WRED_SHIFT;
+    int64_t average = wred->average;
+    average += (sample - average) >> wred->exponent;
+    wred->average = (uint32_t)average;
+
+    uint64_t p = wred_probability(&wred->colors[c], wred->average);
+    uint64_t tail = 0ull - (uint64_t)(qlen >= wred->limit);
+    bool drop = xorshift32(&pc->random) < (p | tail);
+
+    pc->drop[c] += drop;
+    pc->enqueue[c] += !drop;
+    return !drop;
+}
+
+/*
+ * The queue has been empty for slots packet transmission times: decay
+ * the average as if that many zero-length samples had been taken.
+ */
+void qos_wred_idle(struct qos_wred *wred, uint32_t slots)
+{
+    uint32_t average = wred->average;
+
+    /* After 16 time constants the average is below 1e-6 of its value */
+    if (slots >= (16u << wred->exponent)) {
+        wred->average = 0;
+        return;
+    }
+    while (slots-- && average) {
+        average -= (average + (1u << wred->exponent) - 1) >> wred->exponent;
+    }
+    wred->average = average;
+}
+
+/* Sum of the per-CPU counters; concurrent updates may be missed by one */
+void qos_wred_get_stats(const struct qos_wred *wred, struct qos_wred_stats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    for (uint32_t i = 0; i < wred->cpu_count; i++) {
+        for (int c = 0; c < QOS_COLOR_MAX; c++) {
+            stats->enqueue[c] += wred->cpus[i].enqueue[c];
+            stats->drop[c] += wred->cpus[i].drop[c];
+        }
+    }
+}
@@ -0,0 +1,200 @@
+/*
+ * QoS WRED Simulation for Huawei VRP Style
+ * Copyright (C) 2026 WhiteBox NE Team
+ *
+ * This program exercises the WRED engine including:
+ * - Drop curves per color, measured against the configured profile
+ * - A single queue under increasing overload with colored traffic
+ * - Cost of the admission decision per packet
+ *
+ * Usage: wred_bench [-n packets] [-e exponent]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+#include "qos_wred.h"
+
+#define BENCH_LIMIT     64
+
+static const char *const color_names[QOS_COLOR_MAX] = { "green", "yellow", "red" };
+
+/* Typical Huawei-style profile: red drops first and hardest */
+static const struct qos_wred_profile bench_profiles[QOS_COLOR_MAX] = {
+    { .min_threshold = 32, .max_threshold = 56, .drop_probability = 10 },
+    { .min_threshold = 20, .max_threshold = 48, .drop_probability = 30 },
+    { .min_threshold = 8,  .max_threshold = 32, .drop_probability = 60 },
+};
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Expected drop fraction of the profile at a whole-packet average */
+static double profile_drop(const struct qos_wred_profile *profile, uint32_t average)
+{
+    if (average < profile->min_threshold) {
+        return 0;
+    }
+    if (average >= profile->max_threshold) {
+        return 1;
+    }
+    return profile->drop_probability / 100.0 * (average - profile->min_threshold) /
+           (profile->max_threshold - profile->min_threshold);
+}
+
+/* Hold the queue at each length and count drops per color */
+static void drop_curves(struct qos_wred *wred, long samples)
+{
+    printf("Drop curves: %ld packets per point, measured / configured %%\n\n", samples);
+    printf("%-8s", "Avg");
+    for (int c = 0; c < QOS_COLOR_MAX; c++) {
+        printf(" %18s", color_names[c]);
+    }
+    printf("\n");
+
+    for (uint32_t q = 0; q <= 60; q += 4) {
+        printf("%-8u", q);
+        for (int c = 0; c < QOS_COLOR_MAX; c++) {
+            long drops = 0;
+            wred->average = q << QOS_WRED_SHIFT;
+            for (long i = 0; i < samples; i++) {
+                drops += !qos_wred_enqueue(wred, 0, q, (qos_color_t)c);
+            }
+            printf("    %6.2f / %6.2f", 100.0 * drops / samples,
+                   100 * profile_drop(&bench_profiles[c], q));
+        }
+        printf("\n");
+    }
+}
+
+/*
+ * One queue served one packet per tick, fed by 0-4 arrivals per tick
+ * at the given mean load; half the traffic green, 30% yellow, 20% red.
+ */
+static void overload_run(uint8_t exponent, double load, long ticks)
+{
+    struct qos_wred *wred = qos_wred_create(bench_profiles, exponent, BENCH_LIMIT, 1);
+    uint32_t qlen = 0, idle = 0;
+    uint64_t offered[QOS_COLOR_MAX] = { 0 };
+    double qsum = 0, avgsum = 0;
+
+    if (!wred) {
+        fprintf(stderr, "Error: Out of memory\n");
+        exit(1);
+    }
+
+    srand(7);
+    for (long t = 0; t < ticks; t++) {
+        int arrivals = 0;
+        for (int k = 0; k < 4; k++) {
+            arrivals += rand() < load / 4 * RAND_MAX;
+        }
+        if (arrivals && qlen == 0 && idle) {
+            qos_wred_idle(wred, idle);
+        }
+        for (int a = 0; a < arrivals; a++) {
+            int r = rand() % 10;
+            qos_color_t color = r < 5 ? QOS_COLOR_GREEN : r < 8 ? QOS_COLOR_YELLOW : QOS_COLOR_RED;
+            offered[color]++;
+            qlen += qos_wred_enqueue(wred, 0, qlen, color);
+        }
+        if (qlen) {
+            qlen--;
+            idle = 0;
+        } else {
+            idle++;
+        }
+        qsum += qlen;
+        avgsum += wred->average / 65536.0;
+    }
+
+    struct qos_wred_stats stats;
+    qos_wred_get_stats(wred, &stats);
+    printf("%-6.2f %8u %10.1f %10.1f", load, exponent, qsum / ticks, avgsum / ticks);
+    for (int c = 0; c < QOS_COLOR_MAX; c++) {
+        printf(" %9.2f%%", offered[c] ? 100.0 * stats.drop[c] / offered[c] : 0);
+    }
+    printf("\n");
+    qos_wred_destroy(wred);
+}
+
+/* Admission cost with random queue lengths and colors */
+static void cost_run(long packets)
+{
+    struct qos_wred *wred = qos_wred_create(bench_profiles, QOS_WRED_EXPONENT, BENCH_LIMIT, 1);
+    uint8_t *qlens = malloc(65536);
+    uint8_t *colors = malloc(65536);
+    long admitted = 0;
+
+    if (!wred || !qlens || !colors) {
+        fprintf(stderr, "Error: Out of memory\n");
+        exit(1);
+    }
+    srand(11);
+    for (int i = 0; i < 65536; i++) {
+        qlens[i] = rand() % (BENCH_LIMIT + 8);
+        colors[i] = rand() % QOS_COLOR_MAX;
+    }
+
+    double start = now_sec();
+    for (long i = 0; i < packets; i++) {
+        admitted += qos_wred_enqueue(wred, 0, qlens[i & 0xffff], (qos_color_t)colors[i & 0xffff]);
+    }
+    double elapsed = now_sec() - start;
+
+    printf("\nAdmission cost: %ld packets, random length and color: %.2f ns/packet, "
+           "%.1f Mpps, %.1f%% admitted\n", packets, elapsed * 1e9 / packets,
+           packets / elapsed / 1e6, 100.0 * admitted / packets);
+    free(qlens);
+    free(colors);
+    qos_wred_destroy(wred);
+}
+
+int main(int argc, char *argv[])
+{
+    long packets = 20000000;
+    uint8_t exponent = QOS_WRED_EXPONENT;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:e:")) != -1) {
+        switch (opt) {
+        case 'n':
+            packets = atol(optarg);
+            break;
+        case 'e':
+            exponent = (uint8_t)atoi(optarg);
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-n packets] [-e exponent]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    struct qos_wred *wred = qos_wred_create(bench_profiles, exponent, BENCH_LIMIT, 1);
+    if (!wred) {
+        fprintf(stderr, "Error: Out of memory\n");
+        return 1;
+    }
+    drop_curves(wred, packets / 100);
+    qos_wred_destroy(wred);
+
+    printf("\nOverload: one packet served per tick, limit %d, %ld ticks\n\n", BENCH_LIMIT,
+           packets / 4);
+    printf("%-6s %8s %10s %10s %10s %10s %10s\n", "Load", "Exponent", "Queue", "Average",
+           "Drop green", "Drop yel.", "Drop red");
+    double loads[] = { 0.8, 0.95, 1.05, 1.2, 1.5, 2.0 };
+    for (int i = 0; i < 6; i++) {
+        overload_run(exponent, loads[i], packets / 4);
+    }
+
+    cost_run(packets);
+    return 0;
+}
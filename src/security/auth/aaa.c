@@ -211,4 +211,5 @@ struct cmd_element aaa_cmds[] = {
 
 void register_aaa_cmds(void) {
     printf("Registering AAA commands...\n");
+    huawei_cli_register_table(aaa_cmds, "aaa");
 }
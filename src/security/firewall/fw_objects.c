@@ -0,0 +1,546 @@
+/*
+ * Firewall Address and Service Sets
+ * Copyright (C) 2026 WhiteBox NE Team
+ *
+ * This module provides the object groups of fw_objects.h including:
+ * - Path-compressed binary tries of IPv4 and IPv6 prefixes, edited in
+ *   place under concurrent lookups
+ * - Port-range interval tables of merged service members, rebuilt and
+ *   republished on each edit
+ * - Set tables by ID for O(1) resolution from compiled rules
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include "../../frr_core/lib/qsbr.h"
+#include "fw_objects.h"
+
+/* Trie node; the key is zero beyond plen and never changes once linked */
+struct trie_node {
+    uint32_t key[4];
+    uint8_t plen;
+    bool member;                /* The prefix itself is in the set */
+    struct trie_node *child[2];
+};
+
+struct address_set {
+    char name[FW_OBJECT_NAME_SIZE];
+    struct trie_node *root[2];  /* IPv4, IPv6 */
+    uint32_t prefixes[2];
+    uint32_t nodes[2];
+};
+
+/* Disjoint intervals over protocol << 16 | port, sorted */
+struct service_table {
+    uint32_t count;
+    struct {
+        uint32_t lo;
+        uint32_t hi;
+    } ranges[];
+};
+
+struct service_set {
+    char name[FW_OBJECT_NAME_SIZE];
+    struct fw_service_member *members;
+    uint32_t member_count;
+    uint32_t member_capacity;
+    struct service_table *table;
+};
+
+/* ID - 1 -> set; published once, never freed */
+static struct address_set *address_sets[FW_OBJECT_MAX_SETS];
+static uint32_t address_set_count = 0;
+static struct service_set *service_sets[FW_OBJECT_MAX_SETS];
+static uint32_t service_set_count = 0;
+
+static const uint8_t family_bits[2] = { 32, 128 };
+
+/* ---- Sets ---- */
+
+uint16_t fw_address_set_find(const char *name)
+{
+    for (uint32_t i = 0; i < address_set_count; i++) {
+        if (strcmp(address_sets[i]->name, name) == 0) {
+            return (uint16_t)(i + 1);
+        }
+    }
+    return FW_SET_NONE;
+}
+
+uint16_t fw_address_set_create(const char *name)
+{
+    uint16_t id = fw_address_set_find(name);
+
+    if (id != FW_SET_NONE || address_set_count == FW_OBJECT_MAX_SETS) {
+        return id;
+    }
+    struct address_set *set = calloc(1, sizeof(*set));
+    if (!set) {
+        return FW_SET_NONE;
+    }
+    strncpy(set->name, name, sizeof(set->name) - 1);
+    __atomic_store_n(&address_sets[address_set_count], set, __ATOMIC_RELEASE);
+    return (uint16_t)++address_set_count;
+}
+
+uint16_t fw_service_set_find(const char *name)
+{
+    for (uint32_t i = 0; i < service_set_count; i++) {
+        if (strcmp(service_sets[i]->name, name) == 0) {
+            return (uint16_t)(i + 1);
+        }
+    }
+    return FW_SET_NONE;
+}
+
+uint16_t fw_service_set_create(const char *name)
+{
+    uint16_t id = fw_service_set_find(name);
+
+    if (id != FW_SET_NONE || service_set_count == FW_OBJECT_MAX_SETS) {
+        return id;
+    }
+    struct service_set *set = calloc(1, sizeof(*set));
+    struct service_table *table = calloc(1, sizeof(*table));
+    if (!set || !table) {
+        free(set);
+        free(table);
+        return FW_SET_NONE;
+    }
+    strncpy(set->name, name, sizeof(set->name) - 1);
+    set->table = table;
+    __atomic_store_n(&service_sets[service_set_count], set, __ATOMIC_RELEASE);
+    return (uint16_t)++service_set_count;
+}
+
+static struct address_set *address_set_get(uint16_t id)
+{
+    return id > 0 && id <= FW_OBJECT_MAX_SETS
+           ? __atomic_load_n(&address_sets[id - 1], __ATOMIC_ACQUIRE) : NULL;
+}
+
+static struct service_set *service_set_get(uint16_t id)
+{
+    return id > 0 && id <= FW_OBJECT_MAX_SETS
+           ? __atomic_load_n(&service_sets[id - 1], __ATOMIC_ACQUIRE) : NULL;
+}
+
+/* ---- Prefix trie ---- */
+
+static inline int key_bit(const uint32_t *key, int pos)
+{
+    return key[pos >> 5] >> (31 - (pos & 31)) & 1;
+}
+
+static inline uint32_t word_mask(int bits)
+{
+    return bits >= 32 ? ~0u : bits <= 0 ? 0 : ~0u << (32 - bits);
+}
+
+/* Leading bits a and b share, at most max */
+static int common_len(const uint32_t *a, const uint32_t *b, int max)
+{
+    for (int w = 0; w * 32 < max; w++) {
+        uint32_t diff = a[w] ^ b[w];
+        if (diff) {
+            int len = w * 32 + __builtin_clz(diff);
+            return len < max ? len : max;
+        }
+    }
+    return max;
+}
+
+static struct trie_node *node_new(const uint32_t *key, int plen, bool member)
+{
+    struct trie_node *node = calloc(1, sizeof(*node));
+
+    if (node) {
+        for (int w = 0; w < 4; w++) {
+            node->key[w] = key[w] & word_mask(plen - w * 32);
+        }
+        node->plen = (uint8_t)plen;
+        node->member = member;
+    }
+    return node;
+}
+
+static inline void link_store(struct trie_node **link, struct trie_node *node)
+{
+    __atomic_store_n(link, node, __ATOMIC_RELEASE);
+}
+
+/*
+ * Add a prefix. New nodes are complete before the one store that links
+ * them, so a concurrent lookup sees the trie before or after the edit.
+ */
+static int trie_insert(struct address_set *set, int v6, const uint32_t *key, int plen)
+{
+    struct trie_node **link = &set->root[v6];
+
+    for (;;) {
+        struct trie_node *node = *link;
+        if (!node) {
+            struct trie_node *leaf = node_new(key, plen, true);
+            if (!leaf) {
+                return -ENOMEM;
+            }
+            link_store(link, leaf);
+            set->nodes[v6]++;
+            break;
+        }
+
+        int common = common_len(node->key, key, node->plen < plen ? node->plen : plen);
+        if (common == node->plen && common == plen) {
+            if (node->member) {
+                return -EEXIST;
+            }
+            __atomic_store_n(&node->member, true, __ATOMIC_RELEASE);
+            break;
+        }
+        if (common == node->plen) {
+            link = &node->child[key_bit(key, node->plen)];
+            continue;
+        }
+
+        /* Split above node: the new prefix itself, or a branch node */
+        struct trie_node *top = node_new(key, common, common == plen);
+        if (!top) {
+            return -ENOMEM;
+        }
+        top->child[key_bit(node->key, common)] = node;
+        if (common < plen) {
+            struct trie_node *leaf = node_new(key, plen, true);
+            if (!leaf) {
+                free(top);
+                return -ENOMEM;
+            }
+            top->child[key_bit(key, common)] = leaf;
+            set->nodes[v6]++;
+        }
+        link_store(link, top);
+        set->nodes[v6]++;
+        break;
+    }
+    set->prefixes[v6]++;
+    return 0;
+}
+
+/*
+ * Remove a prefix, then unlink nodes left without a purpose: a
+ * non-member with one child is bypassed, one without children dropped.
+ * Unlinked nodes are freed after a grace period.
+ */
+static int trie_remove(struct address_set *set, int v6, const uint32_t *key, int plen)
+{
+    struct trie_node **links[130];
+    struct trie_node **link = &set->root[v6];
+    struct trie_node *node;
+    int depth = 0;
+
+    for (;;) {
+        node = *link;
+        if (!node || node->plen > plen || common_len(node->key, key, node->plen) < node->plen) {
+            return -ENOENT;
+        }
+        if (node->plen == plen) {
+            break;
+        }
+        links[depth++] = link;
+        link = &node->child[key_bit(key, node->plen)];
+    }
+    if (!node->member) {
+        return -ENOENT;
+    }
+    __atomic_store_n(&node->member, false, __ATOMIC_RELEASE);
+    set->prefixes[v6]--;
+
+    while (!node->member && !(node->child[0] && node->child[1])) {
+        struct trie_node *rest = node->child[0] ? node->child[0] : node->child[1];
+        link_store(link, rest);
+        qsbr_retire(node, free);
+        set->nodes[v6]--;
+        if (rest || depth == 0) {
+            break;
+        }
+        link = links[--depth];
+        node = *link;
+    }
+    return 0;
+}
+
+/* Canonical key of an address and prefix length, or -EINVAL */
+static int prefix_key(bool v6, const uint32_t addr[4], uint8_t plen, uint32_t key[4])
+{
+    if (plen > family_bits[v6]) {
+        return -EINVAL;
+    }
+    memset(key, 0, 4 * sizeof(uint32_t));
+    for (int w = 0; w < (v6 ? 4 : 1); w++) {
+        key[w] = addr[w] & word_mask(plen - w * 32);
+    }
+    return 0;
+}
+
+int fw_address_set_add(uint16_t id, bool v6, const uint32_t addr[4], uint8_t plen)
+{
+    struct address_set *set = address_set_get(id);
+    uint32_t key[4];
+
+    if (!set || prefix_key(v6, addr, plen, key) < 0) {
+        return -EINVAL;
+    }
+    return trie_insert(set, v6, key, plen);
+}
+
+int fw_address_set_remove(uint16_t id, bool v6, const uint32_t addr[4], uint8_t plen)
+{
+    struct address_set *set = address_set_get(id);
+    uint32_t key[4];
+
+    if (!set || prefix_key(v6, addr, plen, key) < 0) {
+        return -EINVAL;
+    }
+    return trie_remove(set, v6, key, plen);
+}
+
+/* Stops at the first node whose prefix is in the set */
+bool fw_address_set_match_v4(uint16_t id, uint32_t addr)
+{
+    const struct address_set *set = address_set_get(id);
+    const struct trie_node *node = set ? __atomic_load_n(&set->root[0], __ATOMIC_ACQUIRE) : NULL;
+
+    while (node) {
+        uint32_t plen = node->plen;
+        if ((addr ^ node->key[0]) & word_mask((int)plen)) {
+            return false;
+        }
+        if (__atomic_load_n(&node->member, __ATOMIC_ACQUIRE)) {
+            return true;
+        }
+        if (plen == 32) {
+            return false;
+        }
+        node = __atomic_load_n(&node->child[addr >> (31 - plen) & 1], __ATOMIC_ACQUIRE);
+    }
+    return false;
+}
+
+bool fw_address_set_match_v6(uint16_t id, const uint32_t addr[4])
+{
+    const struct address_set *set = address_set_get(id);
+    const struct trie_node *node = set ? __atomic_load_n(&set->root[1], __ATOMIC_ACQUIRE) : NULL;
+
+    while (node) {
+        int plen = node->plen;
+        if (common_len(node->key, addr, plen) < plen) {
+            return false;
+        }
+        if (__atomic_load_n(&node->member, __ATOMIC_ACQUIRE)) {
+            return true;
+        }
+        if (plen == 128) {
+            return false;
+        }
+        node = __atomic_load_n(&node->child[key_bit(addr, plen)], __ATOMIC_ACQUIRE);
+    }
+    return false;
+}
+
+static uint32_t trie_walk(const struct trie_node *node,
+                          void (*fn)(const uint32_t addr[4], uint8_t plen, void *arg), void *arg)
+{
+    uint32_t count = 0;
+
+    if (!node) {
+        return 0;
+    }
+    if (node->member) {
+        fn(node->key, node->plen, arg);
+        count++;
+    }
+    return count + trie_walk(node->child[0], fn, arg) + trie_walk(node->child[1], fn, arg);
+}
+
+/* Call fn for each prefix of a family in address order; returns their number */
+uint32_t fw_address_set_walk(uint16_t id, bool v6,
+                             void (*fn)(const uint32_t addr[4], uint8_t plen, void *arg),
+                             void *arg)
+{
+    const struct address_set *set = address_set_get(id);
+    return set ? trie_walk(set->root[v6], fn, arg) : 0;
+}
+
+int fw_address_set_info(uint16_t id, struct fw_address_set_info *info)
+{
+    const struct address_set *set = address_set_get(id);
+
+    if (!set) {
+        return -ENOENT;
+    }
+    info->name = set->name;
+    for (int v6 = 0; v6 < 2; v6++) {
+        info->prefixes[v6] = set->prefixes[v6];
+        info->nodes[v6] = set->nodes[v6];
+    }
+    info->memory = sizeof(*set) +
+                   (size_t)(set->nodes[0] + set->nodes[1]) * sizeof(struct trie_node);
+    return 0;
+}
+
+/* ---- Service interval table ---- */
+
+static int range_compare(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+/*
+ * Rebuild the interval table from the members and publish it; lookups
+ * in flight finish on the old table, freed after a grace period.
+ */
+static int service_publish(struct service_set *set)
+{
+    struct service_table *table = malloc(sizeof(*table) +
+                                         (set->member_count + 1) * sizeof(table->ranges[0]));
+
+    if (!table) {
+        return -ENOMEM;
+    }
+    for (uint32_t i = 0; i < set->member_count; i++) {
+        const struct fw_service_member *m = &set->members[i];
+        bool any = m->protocol == FW_PROTOCOL_ANY;
+        table->ranges[i].lo = any ? 0 : (uint32_t)m->protocol << 16 | m->port_lo;
+        table->ranges[i].hi = any ? 0xffffff : (uint32_t)m->protocol << 16 | m->port_hi;
+    }
+    qsort(table->ranges, set->member_count, sizeof(table->ranges[0]), range_compare);
+
+    /* Merge overlapping and adjacent ranges */
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < set->member_count; i++) {
+        if (count > 0 && table->ranges[i].lo <= table->ranges[count - 1].hi + 1) {
+            if (table->ranges[i].hi > table->ranges[count - 1].hi) {
+                table->ranges[count - 1].hi = table->ranges[i].hi;
+            }
+        } else {
+            table->ranges[count++] = table->ranges[i];
+        }
+    }
+    table->count = count;
+
+    struct service_table *old = __atomic_exchange_n(&set->table, table, __ATOMIC_ACQ_REL);
+    qsbr_retire(old, free);
+    return 0;
+}
+
+static int service_member_find(const struct service_set *set, const struct fw_service_member *m)
+{
+    for (uint32_t i = 0; i < set->member_count; i++) {
+        const struct fw_service_member *other = &set->members[i];
+        if (other->protocol == m->protocol && other->port_lo == m->port_lo &&
+            other->port_hi == m->port_hi) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+int fw_service_set_add(uint16_t id, const struct fw_service_member *member)
+{
+    struct service_set *set = service_set_get(id);
+
+    if (!set || member->port_lo > member->port_hi) {
+        return -EINVAL;
+    }
+    if (service_member_find(set, member) >= 0) {
+        return -EEXIST;
+    }
+    if (set->member_count == set->member_capacity) {
+        uint32_t capacity = set->member_capacity ? set->member_capacity * 2 : 16;
+        struct fw_service_member *members = realloc(set->members, capacity * sizeof(*members));
+        if (!members) {
+            return -ENOMEM;
+        }
+        set->members = members;
+        set->member_capacity = capacity;
+    }
+    set->members[set->member_count++] = *member;
+    if (service_publish(set) < 0) {
+        set->member_count--;
+        return -ENOMEM;
+    }
+    return 0;
+}
+
+int fw_service_set_remove(uint16_t id, const struct fw_service_member *member)
+{
+    struct service_set *set = service_set_get(id);
+
+    if (!set) {
+        return -EINVAL;
+    }
+    int index = service_member_find(set, member);
+    if (index < 0) {
+        return -ENOENT;
+    }
+    struct fw_service_member removed = set->members[index];
+    set->members[index] = set->members[--set->member_count];
+    if (service_publish(set) < 0) {
+        set->members[set->member_count++] = removed;
+        return -ENOMEM;
+    }
+    return 0;
+}
+
+bool fw_service_set_match(uint16_t id, uint8_t protocol, uint16_t port)
+{
+    const struct service_set *set = service_set_get(id);
+    if (!set) {
+        return false;
+    }
+
+    const struct service_table *table = __atomic_load_n(&set->table, __ATOMIC_ACQUIRE);
+    uint32_t key = (uint32_t)protocol << 16 | port;
+    uint32_t lo = 0, hi = table->count;
+
+    /* Last range starting at or below key */
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        if (table->ranges[mid].lo <= key) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo > 0 && key <= table->ranges[lo - 1].hi;
+}
+
+uint32_t fw_service_set_members(uint16_t id, struct fw_service_member *out, uint32_t max)
+{
+    const struct service_set *set = service_set_get(id);
+    uint32_t count = 0;
+
+    for (; set && count < set->member_count && count < max; count++) {
+        out[count] = set->members[count];
+    }
+    return count;
+}
+
+int fw_service_set_info(uint16_t id, struct fw_service_set_info *info)
+{
+    const struct service_set *set = service_set_get(id);
+
+    if (!set) {
+        return -ENOENT;
+    }
+    info->name = set->name;
+    info->members = set->member_count;
+    info->intervals = set->table->count;
+    info->memory = sizeof(*set) + set->member_capacity * sizeof(struct fw_service_member) +
+                   sizeof(*set->table) + set->table->count * sizeof(set->table->ranges[0]);
+    return 0;
+}
@@ -0,0 +1,85 @@
+/*
+ * Firewall Address and Service Sets
+ * Copyright (C) 2026 WhiteBox NE Team
+ *
+ * Named object groups referenced by security rules by ID:
+ *
+ * - An address set holds IPv4 and IPv6 prefixes in two path-compressed
+ *   binary tries. A lookup walks at most one node per distinct prefix
+ *   length on the address's path and stops at the first prefix of the
+ *   set covering it
+ * - A service set holds protocol and destination port ranges, merged
+ *   into sorted disjoint intervals over protocol << 16 | port and
+ *   searched by bisection
+ *
+ * Sets are edited in place while the datapath reads them. A trie edit
+ * links fully built nodes with one pointer store and retires unlinked
+ * nodes through qsbr; a service set edit publishes a rebuilt interval
+ * table. The policy refers to a set by ID only, so an edit never
+ * recompiles it. Lookups must run on qsbr readers; edits are made from
+ * one thread at a time.
+ *
+ * Addresses are in host order, IPv6 as four 32-bit words, most
+ * significant first.
+ */
+
+#ifndef _FW_OBJECTS_H
+#define _FW_OBJECTS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define FW_OBJECT_MAX_SETS      256     /* Of each kind */
+#define FW_OBJECT_NAME_SIZE     64
+#define FW_SET_NONE             0       /* IDs start at 1 */
+
+#define FW_PROTOCOL_ANY         0       /* Service member of every protocol */
+
+struct fw_address_set_info {
+    const char *name;
+    uint32_t prefixes[2];       /* IPv4, IPv6 */
+    uint32_t nodes[2];
+    size_t memory;
+};
+
+struct fw_service_set_info {
+    const char *name;
+    uint32_t members;
+    uint32_t intervals;         /* After merging */
+    size_t memory;
+};
+
+/* A service set member */
+struct fw_service_member {
+    uint8_t protocol;           /* FW_PROTOCOL_ANY for all */
+    uint16_t port_lo;           /* Destination ports */
+    uint16_t port_hi;
+};
+
+/* Sets by name; create returns the existing ID for a known name, FW_SET_NONE when full */
+uint16_t fw_address_set_create(const char *name);
+uint16_t fw_address_set_find(const char *name);
+uint16_t fw_service_set_create(const char *name);
+uint16_t fw_service_set_find(const char *name);
+
+/* Edits; 0, -EEXIST or -ENOENT for a member, -EINVAL or -ENOMEM */
+int fw_address_set_add(uint16_t id, bool v6, const uint32_t addr[4], uint8_t plen);
+int fw_address_set_remove(uint16_t id, bool v6, const uint32_t addr[4], uint8_t plen);
+int fw_service_set_add(uint16_t id, const struct fw_service_member *member);
+int fw_service_set_remove(uint16_t id, const struct fw_service_member *member);
+
+/* Membership, false for an unknown set */
+bool fw_address_set_match_v4(uint16_t id, uint32_t addr);
+bool fw_address_set_match_v6(uint16_t id, const uint32_t addr[4]);
+bool fw_service_set_match(uint16_t id, uint8_t protocol, uint16_t port);
+
+/* Display */
+int fw_address_set_info(uint16_t id, struct fw_address_set_info *info);
+int fw_service_set_info(uint16_t id, struct fw_service_set_info *info);
+uint32_t fw_address_set_walk(uint16_t id, bool v6,
+                             void (*fn)(const uint32_t addr[4], uint8_t plen, void *arg),
+                             void *arg);
+uint32_t fw_service_set_members(uint16_t id, struct fw_service_member *out, uint32_t max);
+
+#endif /* _FW_OBJECTS_H */
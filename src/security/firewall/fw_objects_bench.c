@@ -0,0 +1,344 @@
+/*
+ * Firewall Address and Service Set Benchmark
+ * Copyright (C) 2026 WhiteBox NE Team
+ *
+ * This program measures the object sets of fw_objects.h including:
+ * - Building address sets of 1k, 10k and 100k IPv4 and IPv6 prefixes
+ * - Membership lookup latency against a linear scan of the prefixes,
+ *   with every sampled verdict checked against the scan
+ * - Removing every prefix again, with node reclamation through qsbr
+ * - Service set lookup over 1k protocol and port ranges
+ * - A rule referencing both kinds of set through firewall_process(),
+ *   whose verdict follows in-place set edits
+ *
+ * Usage: fw_objects_bench [-l lookups]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+#include "../../frr_core/lib/huawei_cli.h"
+#include "../../frr_core/lib/pcpu_stats.h"
+#include "../../frr_core/lib/qsbr.h"
+#include "fw_objects.h"
+#include "fw_session.h"
+#include "zone_firewall.h"
+
+#define BENCH_SAMPLES           4096    /* Lookups checked against the linear scan */
+#define BENCH_SERVICES          1024
+#define BENCH_EDITS_PER_QUIESCENT 256
+
+struct bench_prefix {
+    uint32_t addr[4];
+    uint8_t plen;
+};
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint32_t rand32(void)
+{
+    return ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+}
+
+static uint32_t mask_word(int plen, int word)
+{
+    int bits = plen - word * 32;
+    return bits >= 32 ? ~0u : bits <= 0 ? 0 : ~0u << (32 - bits);
+}
+
+/* Prefixes of realistic lengths: /16 to /32 for IPv4, /32 to /64 and /128 for IPv6 */
+static void random_prefix(struct bench_prefix *p, bool v6)
+{
+    int words = v6 ? 4 : 1;
+
+    p->plen = v6 ? (rand() % 8 ? 32 + rand() % 33 : 128) : 16 + rand() % 17;
+    memset(p->addr, 0, sizeof(p->addr));
+    for (int w = 0; w < words; w++) {
+        p->addr[w] = rand32() & mask_word(p->plen, w);
+    }
+    if (v6) {
+        p->addr[0] = 0x20010000 | (p->addr[0] & 0x0000ffff);    /* 2001::/16 */
+    } else {
+        p->addr[0] = 0x0a000000 | (p->addr[0] & 0x00ffffff);    /* 10/8 */
+    }
+}
+
+/* Half inside a random prefix of the set, half anywhere in its /8 or /16 */
+static void random_address(uint32_t addr[4], const struct bench_prefix *prefixes, uint32_t count,
+                           bool v6)
+{
+    int words = v6 ? 4 : 1;
+
+    memset(addr, 0, 4 * sizeof(uint32_t));
+    if (rand() % 2) {
+        const struct bench_prefix *p = &prefixes[rand32() % count];
+        for (int w = 0; w < words; w++) {
+            addr[w] = p->addr[w] | (rand32() & ~mask_word(p->plen, w));
+        }
+    } else {
+        for (int w = 0; w < words; w++) {
+            addr[w] = rand32();
+        }
+        addr[0] = v6 ? 0x20010000 | (addr[0] & 0x0000ffff) : 0x0a000000 | (addr[0] & 0x00ffffff);
+    }
+}
+
+static bool linear_match(const struct bench_prefix *prefixes, uint32_t count, bool v6,
+                         const uint32_t addr[4])
+{
+    int words = v6 ? 4 : 1;
+
+    for (uint32_t i = 0; i < count; i++) {
+        bool hit = true;
+        for (int w = 0; w < words && hit; w++) {
+            hit = ((addr[w] ^ prefixes[i].addr[w]) & mask_word(prefixes[i].plen, w)) == 0;
+        }
+        if (hit) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void bench_address_set(uint32_t count, bool v6, uint32_t lookups)
+{
+    struct bench_prefix *prefixes = malloc((size_t)count * sizeof(*prefixes));
+    uint32_t (*addrs)[4] = malloc((size_t)lookups * sizeof(*addrs));
+    struct fw_address_set_info info;
+    char name[32];
+
+    if (!prefixes || !addrs) {
+        fprintf(stderr, "Error: Out of memory for %u prefixes\n", count);
+        exit(1);
+    }
+    snprintf(name, sizeof(name), "bench-%s-%u", v6 ? "v6" : "v4", count);
+    uint16_t id = fw_address_set_create(name);
+
+    /* Build; random prefixes may repeat, the set keeps one */
+    uint32_t added = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        random_prefix(&prefixes[i], v6);
+    }
+    double t0 = now_sec();
+    for (uint32_t i = 0; i < count; i++) {
+        added += fw_address_set_add(id, v6, prefixes[i].addr, prefixes[i].plen) == 0;
+    }
+    double add_ns = (now_sec() - t0) * 1e9 / count;
+    fw_address_set_info(id, &info);
+
+    /* Lookups */
+    for (uint32_t i = 0; i < lookups; i++) {
+        random_address(addrs[i], prefixes, count, v6);
+    }
+    uint32_t hits = 0;
+    t0 = now_sec();
+    if (v6) {
+        for (uint32_t i = 0; i < lookups; i++) {
+            hits += fw_address_set_match_v6(id, addrs[i]);
+        }
+    } else {
+        for (uint32_t i = 0; i < lookups; i++) {
+            hits += fw_address_set_match_v4(id, addrs[i][0]);
+        }
+    }
+    double trie_ns = (now_sec() - t0) * 1e9 / lookups;
+
+    /* The linear scan on a sample, which also checks the trie's verdicts */
+    uint32_t samples = lookups < BENCH_SAMPLES ? lookups : BENCH_SAMPLES, wrong = 0;
+    bool volatile sink = false;
+    t0 = now_sec();
+    for (uint32_t i = 0; i < samples; i++) {
+        sink = linear_match(prefixes, count, v6, addrs[i]);
+        bool trie = v6 ? fw_address_set_match_v6(id, addrs[i])
+                       : fw_address_set_match_v4(id, addrs[i][0]);
+        wrong += sink != trie;
+    }
+    double linear_ns = (now_sec() - t0) * 1e9 / samples - trie_ns;
+
+    /* Remove everything; unlinked nodes go through qsbr, quiescent between commands */
+    uint32_t removed = 0;
+    t0 = now_sec();
+    for (uint32_t i = 0; i < count; i++) {
+        removed += fw_address_set_remove(id, v6, prefixes[i].addr, prefixes[i].plen) == 0;
+        if (i % BENCH_EDITS_PER_QUIESCENT == 0) {
+            qsbr_quiescent();
+        }
+    }
+    double remove_ns = (now_sec() - t0) * 1e9 / count;
+    qsbr_quiescent();
+    qsbr_reclaim();
+    struct fw_address_set_info after;
+    fw_address_set_info(id, &after);
+
+    printf("  %s %6u prefixes: %u nodes, %zu KB, add %6.1f ns, remove %6.1f ns (%u/%u)\n",
+           v6 ? "IPv6" : "IPv4", added, info.nodes[v6], info.memory / 1024, add_ns,
+           remove_ns, removed, added);
+    printf("               lookup %6.1f ns vs linear %9.1f ns, %.1f%% hits, %u/%u wrong, "
+           "%u nodes left\n", trie_ns, linear_ns, 100.0 * hits / lookups, wrong, samples,
+           after.nodes[v6]);
+    free(prefixes);
+    free(addrs);
+}
+
+static void bench_service_set(uint32_t lookups)
+{
+    struct fw_service_member *members = malloc(BENCH_SERVICES * sizeof(*members));
+    struct fw_service_set_info info;
+    uint16_t id = fw_service_set_create("bench-services");
+
+    if (!members) {
+        fprintf(stderr, "Error: Out of memory for services\n");
+        exit(1);
+    }
+    static const uint8_t protocols[] = { 6, 17, 6, 17, 132 };
+    double t0 = now_sec();
+    for (uint32_t i = 0; i < BENCH_SERVICES; i++) {
+        uint16_t lo = (uint16_t)(rand() % 65536);
+        uint16_t span = rand() % 4 ? 0 : (uint16_t)(rand() % 64);
+        members[i] = (struct fw_service_member) {
+            .protocol = protocols[rand() % 5], .port_lo = lo,
+            .port_hi = lo + span > 65535 ? 65535 : (uint16_t)(lo + span),
+        };
+        fw_service_set_add(id, &members[i]);
+    }
+    double add_us = (now_sec() - t0) * 1e6 / BENCH_SERVICES;
+    fw_service_set_info(id, &info);
+
+    uint8_t *protocol = malloc(lookups);
+    uint16_t *port = malloc((size_t)lookups * sizeof(*port));
+    for (uint32_t i = 0; i < lookups; i++) {
+        protocol[i] = protocols[rand() % 5];
+        port[i] = (uint16_t)(rand() % 65536);
+    }
+    uint32_t hits = 0, wrong = 0;
+    t0 = now_sec();
+    for (uint32_t i = 0; i < lookups; i++) {
+        hits += fw_service_set_match(id, protocol[i], port[i]);
+    }
+    double lookup_ns = (now_sec() - t0) * 1e9 / lookups;
+
+    for (uint32_t i = 0; i < BENCH_SAMPLES && i < lookups; i++) {
+        bool linear = false;
+        for (uint32_t m = 0; m < BENCH_SERVICES && !linear; m++) {
+            linear = members[m].protocol == protocol[i] && members[m].port_lo <= port[i] &&
+                     port[i] <= members[m].port_hi;
+        }
+        wrong += linear != fw_service_set_match(id, protocol[i], port[i]);
+    }
+    qsbr_quiescent();
+    qsbr_reclaim();
+
+    printf("  Services %u members: %u intervals, %zu KB, add %.1f us, lookup %.1f ns, "
+           "%.1f%% hits, %u wrong\n", info.members, info.intervals, info.memory / 1024, add_us,
+           lookup_ns, 100.0 * hits / lookups, wrong);
+    free(members);
+    free(protocol);
+    free(port);
+}
+
+static int packet_verdict(ifid_t inside, ifid_t outside, uint32_t src_ip, uint16_t dst_port)
+{
+    static uint16_t src_port = 1024;
+    struct firewall_packet pkt = {
+        .in_ifid = inside, .out_ifid = outside, .src_ip = src_ip, .dst_ip = 0xac100001,
+        .src_port = src_port++, .dst_port = dst_port, .protocol = 6,
+        .tcp_flags = FW_TCP_SYN, .length = 64,
+    };
+    return firewall_process(&pkt, fw_session_now());
+}
+
+/* A rule referencing an address set and a service set, edited while in use */
+static void bench_firewall(void)
+{
+    static const char *config[] = {
+        "firewall zone trust", "add interface GigabitEthernet0/0/1",
+        "firewall zone untrust", "add interface GigabitEthernet0/0/2",
+        "ip address-set clients type object",
+        "ip service-set web type object",
+        "security-policy", "rule name sets", "source-zone trust", "destination-zone untrust",
+        "source-address address-set clients", "service web", "action permit",
+    };
+    ifid_t inside = if_intern("GigabitEthernet0/0/1");
+    ifid_t outside = if_intern("GigabitEthernet0/0/2");
+
+    for (size_t i = 0; i < sizeof(config) / sizeof(config[0]); i++) {
+        huawei_cli_execute(config[i], NULL);
+    }
+
+    printf("\nRule \"sets\": source-address address-set clients, service web\n");
+    printf("  Empty sets:                      10.1.2.3:443 %s\n",
+           packet_verdict(inside, outside, 0x0a010203, 443) ? "permit" : "deny");
+
+    huawei_cli_execute("address 0 10.1.0.0 mask 16", "address-set-clients");
+    huawei_cli_execute("service 0 protocol tcp destination-port 443", "service-set-web");
+    printf("  After address 10.1.0.0/16 and tcp 443:\n");
+    printf("                                   10.1.2.3:443 %s, 10.2.0.1:443 %s, "
+           "10.1.2.3:80 %s\n",
+           packet_verdict(inside, outside, 0x0a010203, 443) ? "permit" : "deny",
+           packet_verdict(inside, outside, 0x0a020001, 443) ? "permit" : "deny",
+           packet_verdict(inside, outside, 0x0a010203, 80) ? "permit" : "deny");
+
+    huawei_cli_execute("service 1 protocol tcp destination-port 80 to 81", "service-set-web");
+    huawei_cli_execute("undo address 0 10.1.0.0 mask 16", "address-set-clients");
+    huawei_cli_execute("address 1 10.2.0.0/15", "address-set-clients");
+    printf("  After moving to 10.2.0.0/15 and adding tcp 80-81:\n");
+    printf("                                   10.1.2.3:443 %s, 10.3.0.1:80 %s\n",
+           packet_verdict(inside, outside, 0x0a010203, 443) ? "permit" : "deny",
+           packet_verdict(inside, outside, 0x0a030001, 80) ? "permit" : "deny");
+
+    bool unknown = huawei_cli_execute("service web2", NULL) < 0;
+    bool bad_len = huawei_cli_execute("address 2 10.4.0.0/1x", "address-set-clients") < 0;
+    printf("  Service web2 (no such set) %s, address 10.4.0.0/1x %s\n",
+           unknown ? "rejected" : "ACCEPTED", bad_len ? "rejected" : "ACCEPTED");
+    qsbr_quiescent();
+    qsbr_reclaim();
+
+    printf("\n");
+    huawei_cli_execute("display ip address-set clients", NULL);
+    huawei_cli_execute("display ip service-set web", NULL);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t lookups = 1 << 20;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "l:")) != -1) {
+        switch (opt) {
+        case 'l':
+            lookups = (uint32_t)atol(optarg);
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-l lookups]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (lookups == 0) {
+        fprintf(stderr, "Error: Lookups must be positive\n");
+        return 1;
+    }
+
+    srand(1);
+    qsbr_thread_register();
+    pcpu_stats_thread_register();
+    printf("Address and service sets: %u lookups per set\n\n", lookups);
+    for (int v6 = 0; v6 <= 1; v6++) {
+        for (uint32_t count = 1000; count <= 100000; count *= 10) {
+            bench_address_set(count, v6, lookups);
+        }
+    }
+    bench_service_set(lookups);
+
+    register_firewall_cmds();
+    bench_firewall();
+    return 0;
+}
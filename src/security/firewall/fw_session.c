@@ -0,0 +1,773 @@
+/*
+ * Firewall Session Table
+ * Copyright (C) 2026 WhiteBox NE Team
+ *
+ * This module provides the session table of fw_session.h including:
+ * - A session pool with in-order allocation and a tagged Treiber stack
+ *   of freed slots
+ * - Cache-line hash buckets locked by their sequence count, read as a
+ *   seqlock; entries never move, and each bucket counts the entries
+ *   that probed past it so a lookup stops at the first bucket nothing
+ *   passed
+ * - Duplicate-free insertion: the home bucket of a key stays locked
+ *   while it is searched and placed
+ * - The TCP state machine and per-state timeouts
+ * - Incremental aging from a cursor, with slots returned in batches
+ *   through qsbr, and an aging thread
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "../../frr_core/lib/qsbr.h"
+#include "fw_session.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define FW_SESSION_X86 1
+#endif
+
+#define FW_BUCKET_MIN           64
+#define FW_REF_NONE             UINT32_MAX
+
+/* Keys of one cache line; entry refs are session index * 2 + reply */
+struct fw_bucket {
+    uint32_t seq;               /* Odd while a writer holds the bucket */
+    uint16_t overflow;          /* Entries stored past this bucket from earlier homes */
+    uint16_t sig[FW_SESSION_SLOTS];     /* 0 for an empty slot */
+    uint32_t ref[FW_SESSION_SLOTS];
+} __attribute__((aligned(64)));
+
+struct fw_session_table {
+    struct fw_session *pool;
+    struct fw_bucket *buckets;
+    uint32_t capacity;
+    uint32_t mask;              /* Buckets - 1 */
+    uint32_t next_unused;       /* Pool slots below this have been handed out */
+    uint64_t free_head;         /* Tag << 32 | index + 1 of the top free slot */
+    uint32_t timeout[FW_STATE_COUNT];
+    pcpu_counter_t stats;       /* FW_STAT_COUNT counters */
+
+    pthread_mutex_t aging_lock;
+    uint32_t cursor;            /* Next pool slot to age */
+    pthread_t aging_thread;
+    bool aging_running;
+    bool aging_stop;
+};
+
+/* Slots leaving the table together after a grace period */
+struct fw_release {
+    struct fw_session_table *table;
+    uint32_t count;
+    uint32_t index[];
+};
+
+static const uint32_t default_timeout[FW_STATE_COUNT] = {
+    [FW_STATE_SYN_SENT] = 20,
+    [FW_STATE_SYN_RECV] = 20,
+    [FW_STATE_ESTABLISHED] = 1200,
+    [FW_STATE_FIN_WAIT] = 60,
+    [FW_STATE_LAST_ACK] = 30,
+    [FW_STATE_TIME_WAIT] = 30,
+    [FW_STATE_CLOSE] = 10,
+    [FW_STATE_UDP] = 120,
+    [FW_STATE_ICMP] = 20,
+    [FW_STATE_OTHER] = 600,
+};
+
+static const char *const state_names[FW_STATE_COUNT] = {
+    [FW_STATE_FREE] = "FREE",
+    [FW_STATE_SYN_SENT] = "SYN_SENT",
+    [FW_STATE_SYN_RECV] = "SYN_RECV",
+    [FW_STATE_ESTABLISHED] = "ESTABLISHED",
+    [FW_STATE_FIN_WAIT] = "FIN_WAIT",
+    [FW_STATE_LAST_ACK] = "LAST_ACK",
+    [FW_STATE_TIME_WAIT] = "TIME_WAIT",
+    [FW_STATE_CLOSE] = "CLOSE",
+    [FW_STATE_UDP] = "UDP",
+    [FW_STATE_ICMP] = "ICMP",
+    [FW_STATE_OTHER] = "OTHER",
+};
+
+static __thread uint32_t lookup_tick = 0;
+
+static uint64_t key_hash(const struct fw_session_key *key)
+{
+    uint64_t a, b;
+
+    memcpy(&a, key, sizeof(a));
+    memcpy(&b, (const uint8_t *)key + sizeof(a), sizeof(b));
+    uint64_t h = (a ^ 0x9e3779b97f4a7c15ull) * 0xff51afd7ed558ccdull;
+    h = (h ^ (h >> 32) ^ b) * 0xc4ceb9fe1a85ec53ull;
+    return h ^ (h >> 29);
+}
+
+static inline uint16_t key_sig(uint64_t hash)
+{
+    uint16_t sig = (uint16_t)(hash >> 48);
+    return sig ? sig : 1;
+}
+
+static inline bool key_equal(const struct fw_session_key *a, const struct fw_session_key *b)
+{
+    return memcmp(a, b, sizeof(*a)) == 0;
+}
+
+/* Key an entry ref stands for */
+static inline void ref_key(const struct fw_session_table *table, uint32_t ref,
+                           struct fw_session_key *key)
+{
+    const struct fw_session_key *orig = &table->pool[ref >> 1].key;
+
+    if (ref & 1) {
+        fw_session_key_reply(orig, key);
+    } else {
+        *key = *orig;
+    }
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/*
+ * Create a table of capacity sessions with twice as many hash slots as
+ * keys. Memory is reserved, not touched: pages are used as sessions
+ * are first handed out.
+ */
+struct fw_session_table *fw_session_table_create(uint32_t capacity)
+{
+    struct fw_session_table *table = calloc(1, sizeof(*table));
+    uint32_t buckets = FW_BUCKET_MIN;
+
+    if (!table || capacity == 0 || capacity > (1u << 30)) {
+        free(table);
+        return NULL;
+    }
+    while ((uint64_t)buckets * FW_SESSION_SLOTS < (uint64_t)capacity * 4) {
+        buckets <<= 1;
+    }
+    table->pool = calloc(capacity, sizeof(*table->pool));
+    table->buckets = calloc(buckets, sizeof(*table->buckets));
+    table->stats = pcpu_counter_alloc(FW_STAT_COUNT);
+    if (!table->pool || !table->buckets || table->stats == PCPU_COUNTER_NONE) {
+        free(table->pool);
+        free(table->buckets);
+        if (table->stats != PCPU_COUNTER_NONE) {
+            pcpu_counter_free(table->stats, FW_STAT_COUNT);
+        }
+        free(table);
+        return NULL;
+    }
+    table->capacity = capacity;
+    table->mask = buckets - 1;
+    memcpy(table->timeout, default_timeout, sizeof(table->timeout));
+    pthread_mutex_init(&table->aging_lock, NULL);
+    return table;
+}
+
+static void table_free(void *ptr)
+{
+    struct fw_session_table *table = ptr;
+
+    pthread_mutex_destroy(&table->aging_lock);
+    pcpu_counter_free(table->stats, FW_STAT_COUNT);
+    free(table->pool);
+    free(table->buckets);
+    free(table);
+}
+
+/* Stop aging and retire the table; no thread may look it up any more */
+void fw_session_table_destroy(struct fw_session_table *table)
+{
+    if (!table) {
+        return;
+    }
+    if (table->aging_running) {
+        __atomic_store_n(&table->aging_stop, true, __ATOMIC_RELEASE);
+        pthread_join(table->aging_thread, NULL);
+    }
+    /* After the slot releases still pending, which point into it */
+    qsbr_retire(table, table_free);
+    qsbr_reclaim();
+}
+
+/* ---- Hash ---- */
+
+/* Spin-wait hint; a compiler barrier where the CPU has none */
+static inline void cpu_relax(void)
+{
+#ifdef FW_SESSION_X86
+    _mm_pause();
+#else
+    __asm__ __volatile__("" ::: "memory");
+#endif
+}
+
+static bool bucket_trylock(struct fw_bucket *bucket)
+{
+    uint32_t seq = __atomic_load_n(&bucket->seq, __ATOMIC_RELAXED);
+    return !(seq & 1) && __atomic_compare_exchange_n(&bucket->seq, &seq, seq + 1, false,
+                                                     __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+static void bucket_lock(struct fw_bucket *bucket)
+{
+    while (!bucket_trylock(bucket)) {
+        cpu_relax();
+    }
+}
+
+static void bucket_unlock(struct fw_bucket *bucket)
+{
+    __atomic_store_n(&bucket->seq, bucket->seq + 1, __ATOMIC_RELEASE);
+}
+
+/*
+ * Ref of the key in one bucket, FW_REF_NONE if absent, read under the
+ * seqlock unless the caller holds the bucket. *more tells whether
+ * entries from earlier homes lie beyond.
+ */
+static uint32_t bucket_find(const struct fw_session_table *table, const struct fw_bucket *bucket,
+                            uint16_t sig, const struct fw_session_key *key, bool held, bool *more)
+{
+    uint32_t seq, found;
+
+    do {
+        while (((seq = __atomic_load_n(&bucket->seq, __ATOMIC_ACQUIRE)) & 1) && !held) {
+            cpu_relax();
+        }
+        found = FW_REF_NONE;
+        for (int s = 0; s < FW_SESSION_SLOTS; s++) {
+            if (__atomic_load_n(&bucket->sig[s], __ATOMIC_RELAXED) != sig) {
+                continue;
+            }
+            uint32_t ref = __atomic_load_n(&bucket->ref[s], __ATOMIC_RELAXED);
+            struct fw_session_key other;
+            if ((ref >> 1) < table->capacity) {
+                ref_key(table, ref, &other);
+                if (key_equal(&other, key)) {
+                    found = ref;
+                    break;
+                }
+            }
+        }
+        *more = __atomic_load_n(&bucket->overflow, __ATOMIC_RELAXED) != 0;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while (__atomic_load_n(&bucket->seq, __ATOMIC_RELAXED) != seq);
+    return found;
+}
+
+/* Ref of a key, FW_REF_NONE if absent; held when the caller holds its home bucket */
+static uint32_t hash_find(const struct fw_session_table *table, const struct fw_session_key *key,
+                          uint64_t hash, bool held)
+{
+    uint32_t b = (uint32_t)hash & table->mask;
+    uint16_t sig = key_sig(hash);
+    bool more = true;
+
+    for (int probe = 0; probe < FW_SESSION_MAX_PROBE && more; probe++) {
+        uint32_t ref = bucket_find(table, &table->buckets[b], sig, key, held && probe == 0,
+                                   &more);
+        if (ref != FW_REF_NONE) {
+            return ref;
+        }
+        b = (b + 1) & table->mask;
+    }
+    return FW_REF_NONE;
+}
+
+static void overflow_sub(struct fw_session_table *table, uint32_t home, uint32_t end)
+{
+    for (uint32_t b = home; b != end; b = (b + 1) & table->mask) {
+        __atomic_sub_fetch(&table->buckets[b].overflow, 1, __ATOMIC_RELAXED);
+    }
+}
+
+/*
+ * Add an entry for key unless the key is present. Returns the ref found
+ * or FW_REF_NONE when ref was added; *full is set when no slot was free
+ * within the probe range.
+ *
+ * The home bucket stays locked throughout, so two inserts of one key
+ * are serialized. Other buckets are only tried: a writer holding one as
+ * its home may be waiting for ours, so on contention everything is
+ * undone and the insert starts over.
+ */
+static uint32_t hash_insert(struct fw_session_table *table, const struct fw_session_key *key,
+                            uint32_t ref, bool *full)
+{
+    uint64_t hash = key_hash(key);
+    uint32_t home = (uint32_t)hash & table->mask;
+    uint16_t sig = key_sig(hash);
+
+    *full = false;
+    for (;;) {
+        bucket_lock(&table->buckets[home]);
+        uint32_t existing = hash_find(table, key, hash, true);
+        if (existing != FW_REF_NONE) {
+            bucket_unlock(&table->buckets[home]);
+            return existing;
+        }
+
+        uint32_t b = home;
+        bool contended = false;
+        for (int probe = 0; probe < FW_SESSION_MAX_PROBE; probe++) {
+            struct fw_bucket *bucket = &table->buckets[b];
+            if (b != home && !bucket_trylock(bucket)) {
+                contended = true;
+                break;
+            }
+            for (int s = 0; s < FW_SESSION_SLOTS; s++) {
+                if (bucket->sig[s] == 0) {
+                    /* Passed buckets already count the entry */
+                    __atomic_store_n(&bucket->ref[s], ref, __ATOMIC_RELAXED);
+                    __atomic_store_n(&bucket->sig[s], sig, __ATOMIC_RELAXED);
+                    if (b != home) {
+                        bucket_unlock(bucket);
+                    }
+                    bucket_unlock(&table->buckets[home]);
+                    return FW_REF_NONE;
+                }
+            }
+            if (b != home) {
+                bucket_unlock(bucket);
+            }
+            __atomic_add_fetch(&bucket->overflow, 1, __ATOMIC_RELAXED);
+            b = (b + 1) & table->mask;
+        }
+
+        /* Take back the counts of the buckets passed */
+        overflow_sub(table, home, b);
+        bucket_unlock(&table->buckets[home]);
+        if (!contended) {
+            *full = true;
+            return FW_REF_NONE;
+        }
+        cpu_relax();
+    }
+}
+
+/* Remove the entry holding ref for key; trylock as in hash_insert() */
+static void hash_remove(struct fw_session_table *table, const struct fw_session_key *key,
+                        uint32_t ref)
+{
+    uint64_t hash = key_hash(key);
+    uint32_t home = (uint32_t)hash & table->mask;
+    uint16_t sig = key_sig(hash);
+
+    for (;;) {
+        bool contended = false;
+        bucket_lock(&table->buckets[home]);
+        uint32_t b = home;
+        for (int probe = 0; probe < FW_SESSION_MAX_PROBE && !contended; probe++) {
+            struct fw_bucket *bucket = &table->buckets[b];
+            if (b != home && !bucket_trylock(bucket)) {
+                contended = true;
+                break;
+            }
+            for (int s = 0; s < FW_SESSION_SLOTS; s++) {
+                if (bucket->sig[s] == sig && bucket->ref[s] == ref) {
+                    __atomic_store_n(&bucket->sig[s], 0, __ATOMIC_RELAXED);
+                    if (b != home) {
+                        bucket_unlock(bucket);
+                    }
+                    overflow_sub(table, home, b);
+                    bucket_unlock(&table->buckets[home]);
+                    return;
+                }
+            }
+            if (b != home) {
+                bucket_unlock(bucket);
+            }
+            b = (b + 1) & table->mask;
+        }
+        bucket_unlock(&table->buckets[home]);
+        if (!contended) {
+            return;
+        }
+        cpu_relax();
+    }
+}
+
+/* ---- Pool ---- */
+
+static uint32_t pool_alloc(struct fw_session_table *table)
+{
+    if (__atomic_load_n(&table->next_unused, __ATOMIC_RELAXED) < table->capacity) {
+        uint32_t index = __atomic_fetch_add(&table->next_unused, 1, __ATOMIC_RELAXED);
+        if (index < table->capacity) {
+            return index;
+        }
+    }
+
+    uint64_t head = __atomic_load_n(&table->free_head, __ATOMIC_ACQUIRE), next;
+    do {
+        uint32_t top = (uint32_t)head;
+        if (top == 0) {
+            return FW_REF_NONE;
+        }
+        /* A stale link read here fails the exchange through the tag */
+        uint32_t link = __atomic_load_n(&table->pool[top - 1].next_free, __ATOMIC_RELAXED);
+        next = ((head >> 32) + 1) << 32 | link;
+    } while (!__atomic_compare_exchange_n(&table->free_head, &head, next, false,
+                                          __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE));
+    return (uint32_t)head - 1;
+}
+
+/* Push a chain of slots, first to last linked through next_free */
+static void pool_free_chain(struct fw_session_table *table, uint32_t first, uint32_t last)
+{
+    uint64_t head = __atomic_load_n(&table->free_head, __ATOMIC_RELAXED), next;
+
+    do {
+        __atomic_store_n(&table->pool[last].next_free, (uint32_t)head, __ATOMIC_RELAXED);
+        next = ((head >> 32) + 1) << 32 | (first + 1);
+    } while (!__atomic_compare_exchange_n(&table->free_head, &head, next, false,
+                                          __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+static void pool_release(void *ptr)
+{
+    struct fw_release *release = ptr;
+
+    for (uint32_t i = 0; i + 1 < release->count; i++) {
+        release->table->pool[release->index[i]].next_free = release->index[i + 1] + 1;
+    }
+    pool_free_chain(release->table, release->index[0], release->index[release->count - 1]);
+    free(release);
+}
+
+/* ---- Sessions ---- */
+
+/*
+ * Session of a packet's key, NULL on a miss; *reply tells the
+ * direction. Valid until the calling thread's next qsbr_quiescent().
+ */
+struct fw_session *fw_session_lookup(struct fw_session_table *table,
+                                     const struct fw_session_key *key, bool *reply)
+{
+    uint64_t start = 0;
+
+    if (__builtin_expect((++lookup_tick & (FW_SESSION_SAMPLE - 1)) == 0, 0)) {
+        start = now_ns();
+    }
+    uint32_t ref = hash_find(table, key, key_hash(key), false);
+    if (__builtin_expect(start != 0, 0)) {
+        pcpu_counter_add(table->stats + FW_STAT_SAMPLES, 1);
+        pcpu_counter_add(table->stats + FW_STAT_LATENCY_NS, now_ns() - start);
+    }
+
+    pcpu_counter_add(table->stats + FW_STAT_LOOKUPS, 1);
+    if (ref == FW_REF_NONE) {
+        return NULL;
+    }
+    pcpu_counter_add(table->stats + FW_STAT_HITS, 1);
+    *reply = ref & 1;
+    return &table->pool[ref >> 1];
+}
+
+static uint8_t initial_state(uint8_t protocol)
+{
+    switch (protocol) {
+    case 6:
+        return FW_STATE_SYN_SENT;
+    case 17:
+        return FW_STATE_UDP;
+    case 1:
+        return FW_STATE_ICMP;
+    default:
+        return FW_STATE_OTHER;
+    }
+}
+
+/*
+ * Create the session of a permitted first packet, keyed in its
+ * direction; a TCP session starts in SYN_SENT. When another thread
+ * created it first, that session is returned instead and *reply tells
+ * the packet's direction in it. NULL when the pool or hash is full.
+ * Account the packet with fw_session_update().
+ */
+struct fw_session *fw_session_create(struct fw_session_table *table,
+                                     const struct fw_session_key *key, uint16_t rule,
+                                     uint32_t now, bool *reply)
+{
+    uint32_t index = pool_alloc(table);
+    bool full;
+
+    if (index == FW_REF_NONE) {
+        pcpu_counter_add(table->stats + FW_STAT_FAILED, 1);
+        return NULL;
+    }
+
+    struct fw_session *session = &table->pool[index];
+    uint8_t state = initial_state(key->protocol);
+    *session = (struct fw_session) {
+        .key = *key, .created = now, .deadline = now + table->timeout[state], .rule = rule,
+    };
+    __atomic_store_n(&session->state, state, __ATOMIC_RELEASE);
+
+    uint32_t existing = hash_insert(table, key, index << 1, &full);
+    if (existing != FW_REF_NONE || full) {
+        /* Never published; back to the free list at once */
+        __atomic_store_n(&session->state, FW_STATE_FREE, __ATOMIC_RELAXED);
+        pool_free_chain(table, index, index);
+        if (full) {
+            pcpu_counter_add(table->stats + FW_STAT_FAILED, 1);
+            return NULL;
+        }
+        *reply = existing & 1;
+        return &table->pool[existing >> 1];
+    }
+
+    struct fw_session_key back;
+    fw_session_key_reply(key, &back);
+    if (!key_equal(&back, key) && (hash_insert(table, &back, index << 1 | 1, &full) !=
+                                   FW_REF_NONE || full)) {
+        /* Reply packets will find the other session, or nothing */
+        session->flags |= FW_SESSION_NO_REPLY;
+    }
+    pcpu_counter_add(table->stats + FW_STAT_CREATED, 1);
+    *reply = false;
+    return session;
+}
+
+/* TCP state after a segment in a direction */
+static uint8_t tcp_next(uint8_t state, bool reply, uint8_t flags)
+{
+    if (flags & FW_TCP_RST) {
+        return FW_STATE_CLOSE;
+    }
+    switch (state & FW_STATE_MASK) {
+    case FW_STATE_SYN_SENT:
+        if (reply && (flags & (FW_TCP_SYN | FW_TCP_ACK)) == (FW_TCP_SYN | FW_TCP_ACK)) {
+            return FW_STATE_SYN_RECV;
+        }
+        break;
+    case FW_STATE_SYN_RECV:
+        if (!reply && (flags & (FW_TCP_SYN | FW_TCP_ACK)) == FW_TCP_ACK) {
+            return FW_STATE_ESTABLISHED;
+        }
+        break;
+    case FW_STATE_ESTABLISHED:
+        if (flags & FW_TCP_FIN) {
+            return FW_STATE_FIN_WAIT | (reply ? FW_STATE_FIN_REPLY : 0);
+        }
+        break;
+    case FW_STATE_FIN_WAIT:
+        if ((flags & FW_TCP_FIN) && reply != ((state & FW_STATE_FIN_REPLY) != 0)) {
+            return FW_STATE_LAST_ACK;
+        }
+        break;
+    case FW_STATE_LAST_ACK:
+        if ((flags & (FW_TCP_FIN | FW_TCP_ACK)) == FW_TCP_ACK) {
+            return FW_STATE_TIME_WAIT;
+        }
+        break;
+    case FW_STATE_TIME_WAIT:
+    case FW_STATE_CLOSE:
+        if (!reply && (flags & (FW_TCP_SYN | FW_TCP_ACK)) == FW_TCP_SYN) {
+            return FW_STATE_SYN_SENT;
+        }
+        break;
+    }
+    return state;
+}
+
+/*
+ * Account a packet of a session: counters of its direction, the TCP
+ * state for its flags, and the deadline for the resulting state.
+ */
+void fw_session_update(struct fw_session_table *table, struct fw_session *session, bool reply,
+                       uint8_t tcp_flags, uint32_t length, uint32_t now)
+{
+    uint8_t state = __atomic_load_n(&session->state, __ATOMIC_RELAXED);
+
+    if ((state & FW_STATE_MASK) < FW_STATE_UDP) {
+        uint8_t next;
+        do {
+            next = tcp_next(state, reply, tcp_flags);
+        } while (next != state && state != FW_STATE_FREE &&
+                 !__atomic_compare_exchange_n(&session->state, &state, next, false,
+                                              __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+        state = next;
+    }
+    if (state == FW_STATE_FREE) {
+        return;
+    }
+    __atomic_store_n(&session->deadline, now + table->timeout[state & FW_STATE_MASK],
+                     __ATOMIC_RELAXED);
+    __atomic_add_fetch(&session->packets[reply], 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&session->bytes[reply], length, __ATOMIC_RELAXED);
+}
+
+/*
+ * Take a session out of the hash, then mark it free; false when it is
+ * free already. The hash entries go first, under their bucket locks, so
+ * a create racing with aging inserts a new session rather than finding
+ * this one on its way out. Called under the aging lock, which makes the
+ * caller the only one unlinking.
+ */
+static bool session_unlink(struct fw_session_table *table, uint32_t index)
+{
+    struct fw_session *session = &table->pool[index];
+
+    if (__atomic_load_n(&session->state, __ATOMIC_RELAXED) == FW_STATE_FREE) {
+        return false;
+    }
+    hash_remove(table, &session->key, index << 1);
+    if (!(session->flags & FW_SESSION_NO_REPLY)) {
+        struct fw_session_key back;
+        fw_session_key_reply(&session->key, &back);
+        if (!key_equal(&back, &session->key)) {
+            hash_remove(table, &back, index << 1 | 1);
+        }
+    }
+    /* fw_session_update() stops at FREE, so no transition revives it */
+    __atomic_store_n(&session->state, FW_STATE_FREE, __ATOMIC_RELEASE);
+    return true;
+}
+
+/* Age up to budget pool slots from the cursor, all of them when clearing */
+static uint32_t session_sweep(struct fw_session_table *table, uint32_t now, uint32_t budget,
+                              bool clear)
+{
+    uint32_t used = __atomic_load_n(&table->next_unused, __ATOMIC_RELAXED);
+    uint32_t removed = 0;
+
+    used = used < table->capacity ? used : table->capacity;
+    budget = budget < used ? budget : used;
+    if (budget == 0) {
+        return 0;
+    }
+    struct fw_release *release = malloc(sizeof(*release) + budget * sizeof(uint32_t));
+    if (!release) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&table->aging_lock);
+    for (uint32_t n = 0; n < budget; n++) {
+        uint32_t index = table->cursor;
+        const struct fw_session *session = &table->pool[index];
+        table->cursor = index + 1 < used ? index + 1 : 0;
+        if (__atomic_load_n(&session->state, __ATOMIC_RELAXED) == FW_STATE_FREE) {
+            continue;
+        }
+        int32_t left = (int32_t)(__atomic_load_n(&session->deadline, __ATOMIC_RELAXED) - now);
+        if ((clear || left < 0) && session_unlink(table, index)) {
+            release->index[removed++] = index;
+        }
+    }
+    pthread_mutex_unlock(&table->aging_lock);
+
+    if (removed == 0) {
+        free(release);
+        return 0;
+    }
+    release->table = table;
+    release->count = removed;
+    pcpu_counter_add(table->stats + FW_STAT_REMOVED, removed);
+    qsbr_retire(release, pool_release);
+    return removed;
+}
+
+/*
+ * Remove expired sessions among the next budget pool slots. Their slots
+ * are reused once every datapath thread has passed a quiescent state.
+ * Returns the number removed.
+ */
+uint32_t fw_session_expire(struct fw_session_table *table, uint32_t now, uint32_t budget)
+{
+    return session_sweep(table, now, budget, false);
+}
+
+/* Remove every session; returns the number removed */
+uint32_t fw_session_clear(struct fw_session_table *table)
+{
+    return session_sweep(table, 0, table->capacity, true);
+}
+
+static void *aging_worker(void *arg)
+{
+    struct fw_session_table *table = arg;
+    uint32_t budget = table->capacity / FW_SESSION_AGING_PASSES + 1;
+
+    while (!__atomic_load_n(&table->aging_stop, __ATOMIC_ACQUIRE)) {
+        fw_session_expire(table, fw_session_now(), budget);
+        qsbr_reclaim();
+        sleep(1);
+    }
+    return NULL;
+}
+
+/*
+ * Age the table from a thread of its own, a pool pass every
+ * FW_SESSION_AGING_PASSES seconds; a session outlives its deadline by
+ * at most that long. Returns 0 or -1.
+ */
+int fw_session_aging_start(struct fw_session_table *table)
+{
+    if (table->aging_running) {
+        return 0;
+    }
+    table->aging_stop = false;
+    if (pthread_create(&table->aging_thread, NULL, aging_worker, table) != 0) {
+        return -1;
+    }
+    table->aging_running = true;
+    return 0;
+}
+
+/* Timeout of a state for packets from now on */
+void fw_session_set_timeout(struct fw_session_table *table, uint8_t state, uint32_t seconds)
+{
+    if (state > FW_STATE_FREE && state < FW_STATE_COUNT) {
+        __atomic_store_n(&table->timeout[state], seconds, __ATOMIC_RELAXED);
+    }
+}
+
+uint32_t fw_session_timeout(const struct fw_session_table *table, uint8_t state)
+{
+    return state < FW_STATE_COUNT ? table->timeout[state] : 0;
+}
+
+/* Pool slots handed out so far; fw_session_get() below this bound */
+uint32_t fw_session_slots(const struct fw_session_table *table)
+{
+    uint32_t used = __atomic_load_n(&table->next_unused, __ATOMIC_RELAXED);
+    return used < table->capacity ? used : table->capacity;
+}
+
+/* Session in a pool slot, NULL when free; a snapshot for display */
+const struct fw_session *fw_session_get(const struct fw_session_table *table, uint32_t index)
+{
+    const struct fw_session *session = &table->pool[index];
+    return __atomic_load_n(&session->state, __ATOMIC_ACQUIRE) == FW_STATE_FREE ? NULL : session;
+}
+
+void fw_session_stats(const struct fw_session_table *table, struct fw_session_stats *stats)
+{
+    const struct pcpu_snapshot *c = &stats->counters;
+
+    memset(stats, 0, sizeof(*stats));
+    stats->capacity = table->capacity;
+    stats->buckets = table->mask + 1;
+    stats->memory = (uint64_t)table->capacity * sizeof(struct fw_session) +
+                    (uint64_t)stats->buckets * sizeof(struct fw_bucket);
+    pcpu_counter_read(table->stats, FW_STAT_COUNT, &stats->counters);
+    stats->active = c->values[FW_STAT_CREATED] - c->values[FW_STAT_REMOVED];
+}
+
+const char *fw_session_state_name(uint8_t state)
+{
+    state &= FW_STATE_MASK;
+    return state < FW_STATE_COUNT ? state_names[state] : "?";
+}
@@ -0,0 +1,157 @@
+/*
+ * Firewall Session Table
+ * Copyright (C) 2026 WhiteBox NE Team
+ *
+ * Connection tracking for the zone-based firewall. A session is created
+ * by the first packet of a flow that the security policy permits; every
+ * later packet of either direction finds it by its 5-tuple and zone
+ * pair and skips the policy.
+ *
+ * - Sessions live in a pool preallocated at creation, one cache line
+ *   each; a full pool refuses new sessions instead of growing. Slots
+ *   are handed out in order first, then from a lock-free free list
+ * - Each session is indexed twice, by its original and its reply key,
+ *   in an open-addressing hash of cache-line buckets with 16-bit
+ *   signatures. A bucket's sequence count is both its writer lock and a
+ *   seqlock for readers, so lookups take no lock and write nothing
+ * - TCP sessions follow the handshake and teardown in a state machine;
+ *   every state has its own timeout, and each packet pushes the deadline
+ *   out by the timeout of the state it leaves the session in. No
+ *   sequence window tracking
+ * - An aging pass unlinks expired sessions and hands their slots back
+ *   through qsbr once no datapath thread can hold them, so a session
+ *   pointer stays valid until the thread's next qsbr_quiescent()
+ * - Lookups, hits, creations and sampled lookup latency in per-CPU
+ *   counters
+ *
+ * Addresses are IPv4 in host order; ICMP flows carry the echo
+ * identifier as both ports.
+ */
+
+#ifndef _FW_SESSION_H
+#define _FW_SESSION_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include "../../frr_core/lib/pcpu_stats.h"
+
+#define FW_SESSION_CAPACITY     (2u << 20)      /* Default pool, 2M sessions */
+#define FW_SESSION_SLOTS        8       /* Keys per bucket */
+#define FW_SESSION_MAX_PROBE    32      /* Buckets searched from the home bucket */
+#define FW_SESSION_SAMPLE       1024    /* Lookups per latency sample */
+#define FW_SESSION_AGING_PASSES 8       /* Aging ticks, one per second, per pool pass */
+
+/* TCP flags as in the header */
+#define FW_TCP_FIN              0x01
+#define FW_TCP_SYN              0x02
+#define FW_TCP_RST              0x04
+#define FW_TCP_ACK              0x10
+
+/* Session states; TCP states first */
+enum {
+    FW_STATE_FREE = 0,
+    FW_STATE_SYN_SENT,
+    FW_STATE_SYN_RECV,
+    FW_STATE_ESTABLISHED,
+    FW_STATE_FIN_WAIT,          /* One side closed */
+    FW_STATE_LAST_ACK,          /* Both closed, last ACK outstanding */
+    FW_STATE_TIME_WAIT,
+    FW_STATE_CLOSE,             /* Reset */
+    FW_STATE_UDP,
+    FW_STATE_ICMP,
+    FW_STATE_OTHER,
+    FW_STATE_COUNT
+};
+
+#define FW_STATE_MASK           0x0f
+#define FW_STATE_FIN_REPLY      0x10    /* FIN_WAIT: the reply side closed first */
+
+/* Counters of the table, one pcpu group */
+enum {
+    FW_STAT_LOOKUPS = 0,
+    FW_STAT_HITS,
+    FW_STAT_CREATED,
+    FW_STAT_FAILED,             /* Pool or probe range full */
+    FW_STAT_REMOVED,            /* Aged out or cleared */
+    FW_STAT_SAMPLES,
+    FW_STAT_LATENCY_NS,         /* Sum over the sampled lookups */
+    FW_STAT_COUNT
+};
+
+/* Original direction of a flow; pad must be zero */
+struct fw_session_key {
+    uint32_t src_ip;
+    uint32_t dst_ip;
+    uint16_t src_port;
+    uint16_t dst_port;
+    uint8_t protocol;
+    uint8_t src_zone;
+    uint8_t dst_zone;
+    uint8_t pad;
+};
+
+_Static_assert(sizeof(struct fw_session_key) == 16, "struct fw_session_key must stay 16 bytes");
+
+struct fw_session {
+    struct fw_session_key key;
+    uint64_t bytes[2];          /* Original, reply */
+    uint32_t packets[2];
+    uint32_t created;           /* fw_session_now() seconds */
+    uint32_t deadline;
+    uint32_t next_free;         /* Free list link, index + 1 */
+    uint16_t rule;              /* Policy rule that permitted the flow */
+    uint8_t state;              /* FW_STATE_*, FW_STATE_FREE when not in use */
+    uint8_t flags;
+} __attribute__((aligned(64)));
+
+#define FW_SESSION_NO_REPLY     0x01    /* Reply key taken by another session */
+
+struct fw_session_stats {
+    uint32_t capacity;
+    uint32_t buckets;
+    uint64_t memory;            /* Bytes of pool and hash */
+    uint64_t active;
+    struct pcpu_snapshot counters;      /* FW_STAT_* */
+};
+
+struct fw_session_table;
+
+/* Coarse monotonic seconds, the clock of created and deadline */
+static inline uint32_t fw_session_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return (uint32_t)ts.tv_sec;
+}
+
+static inline void fw_session_key_reply(const struct fw_session_key *key,
+                                        struct fw_session_key *reply)
+{
+    *reply = (struct fw_session_key) {
+        .src_ip = key->dst_ip, .dst_ip = key->src_ip,
+        .src_port = key->dst_port, .dst_port = key->src_port,
+        .protocol = key->protocol, .src_zone = key->dst_zone, .dst_zone = key->src_zone,
+    };
+}
+
+struct fw_session_table *fw_session_table_create(uint32_t capacity);
+void fw_session_table_destroy(struct fw_session_table *table);
+struct fw_session *fw_session_lookup(struct fw_session_table *table,
+                                     const struct fw_session_key *key, bool *reply);
+struct fw_session *fw_session_create(struct fw_session_table *table,
+                                     const struct fw_session_key *key, uint16_t rule,
+                                     uint32_t now, bool *reply);
+void fw_session_update(struct fw_session_table *table, struct fw_session *session, bool reply,
+                       uint8_t tcp_flags, uint32_t length, uint32_t now);
+uint32_t fw_session_expire(struct fw_session_table *table, uint32_t now, uint32_t budget);
+uint32_t fw_session_clear(struct fw_session_table *table);
+int fw_session_aging_start(struct fw_session_table *table);
+void fw_session_set_timeout(struct fw_session_table *table, uint8_t state, uint32_t seconds);
+uint32_t fw_session_timeout(const struct fw_session_table *table, uint8_t state);
+uint32_t fw_session_slots(const struct fw_session_table *table);
+const struct fw_session *fw_session_get(const struct fw_session_table *table, uint32_t index);
+void fw_session_stats(const struct fw_session_table *table, struct fw_session_stats *stats);
+const char *fw_session_state_name(uint8_t state);
+
+#endif /* _FW_SESSION_H */
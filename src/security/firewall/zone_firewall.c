@@ -5,8 +5,13 @@
  * This module provides zone-based firewall functionality including:
  * - Security zones
  * - Zone member management
- * - Security policies
- * - Stateful inspection
+ * - Security policies, compiled into per-zone-pair rule lists with
+ *   pre-parsed addresses and services, and an interface to zone table
+ * - Stateful inspection: only the first packet of a flow is matched
+ *   against the policy, later packets hit its session (fw_session.c)
+ * - Session display, aging times and reset
+ * - Address and service sets referenced by rules (fw_objects.c)
+ * - Per-CPU rule hit counters
  */
 
 #include <stdio.h>
@@ -14,14 +19,36 @@
 #include <string.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <errno.h>
+#include <pthread.h>
+#include <arpa/inet.h>
 #include "../../frr_core/lib/huawei_cli.h"
+#include "../../frr_core/lib/if_registry.h"
+#include "../../frr_core/lib/pcpu_stats.h"
+#include "../../frr_core/lib/qsbr.h"
+#include "fw_objects.h"
+#include "fw_session.h"
+#include "zone_firewall.h"
+
+#define FW_ZONE_NONE            0xff
+#define FW_DISPLAY_SESSIONS     64      /* Sessions listed by display firewall session table */
+#define FW_DISPLAY_MEMBERS      64      /* Members listed per set by display ip address-set */
+
+/* Packet counters of the firewall, one pcpu group */
+enum {
+    FW_PKT_SESSION = 0,         /* Permitted by a session */
+    FW_PKT_POLICY,              /* Permitted by a rule, session created */
+    FW_PKT_DENY,                /* Denied by a rule, no rule or no zone */
+    FW_PKT_INVALID,             /* TCP without a session and not a SYN */
+    FW_PKT_COUNT
+};
 
 /* Security zone configuration */
 struct security_zone {
     char name[64];
     uint8_t priority;
     char description[128];
-    char member_interfaces[32][64];
+    ifid_t member_interfaces[32];
     int member_count;
 };
 
@@ -35,9 +62,11 @@ struct security_rule {
     char destination_address[64];
     char service[64];
     char action[16];  /* permit/deny */
+    uint16_t source_set;        /* Address set ID in place of source_address */
+    uint16_t destination_set;
+    uint16_t service_set;       /* Service set ID; service holds its name */
     bool logging;
-    uint64_t packet_count;
-    uint64_t byte_count;
+    pcpu_counter_t stats;   /* Packets, bytes; updated with pcpu_counter_add2() */
 };
 
 /* Security policy */
@@ -55,6 +84,325 @@ static int policy_count = 0;
 static struct security_zone *current_zone = NULL;
 static struct security_policy *current_policy = NULL;
 static struct security_rule *current_rule = NULL;
+static uint16_t current_address_set = FW_SET_NONE;
+static uint16_t current_service_set = FW_SET_NONE;
+
+static struct fw_session_table *sessions = NULL;
+static pcpu_counter_t packet_stats = PCPU_COUNTER_NONE;
+static struct pcpu_snapshot session_last;      /* For the creation rate */
+static pthread_once_t sessions_once = PTHREAD_ONCE_INIT;
+
+/* ---- Compiled policy ---- */
+
+/*
+ * A rule pre-parsed for one zone pair. A rule whose service stands for
+ * two protocols, like dns, has one match per protocol, next to each
+ * other so the rule order is kept.
+ */
+struct policy_match {
+    uint32_t src;
+    uint32_t src_mask;
+    uint32_t dst;
+    uint32_t dst_mask;
+    uint16_t port_lo;           /* Destination port range */
+    uint16_t port_hi;
+    uint8_t protocol;           /* 0 for any */
+    bool permit;
+    uint16_t rule;              /* Index in the policy */
+    uint16_t src_set;           /* Object sets, FW_SET_NONE for the fields above */
+    uint16_t dst_set;
+    uint16_t service_set;
+};
+
+/*
+ * The default policy compiled for the datapath: a zone lookup table by
+ * interface ID, and the matches of each (source zone, destination zone)
+ * cell in rule order, so a packet is checked against the rules of its
+ * zone pair only. A rule without a zone appears in every cell of that
+ * side. Replaced as a whole after a change and retired through qsbr.
+ * Address and service sets are referenced by ID; their edits take
+ * effect in place, without a new program.
+ */
+struct policy_program {
+    uint32_t zone_count;
+    uint32_t ifid_count;        /* Entries of zone_by_ifid */
+    uint8_t *zone_by_ifid;      /* FW_ZONE_NONE for an interface in no zone */
+    uint32_t *cells;            /* zone_count^2 + 1 offsets into matches, src-major */
+    uint32_t rule_count;
+    pcpu_counter_t *rule_stats; /* By rule index */
+    uint32_t match_count;
+    struct policy_match *matches;
+};
+
+static struct policy_program *policy_program = NULL;
+static pthread_mutex_t policy_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static struct security_policy *firewall_policy(void)
+{
+    for (int i = 0; i < policy_count; i++) {
+        if (strcmp(policies[i].name, "default") == 0) {
+            return &policies[i];
+        }
+    }
+    return NULL;
+}
+
+/* Zone ID of a rule's zone name: -1 for any, -2 for an unknown zone */
+static int zone_parse(const char *name)
+{
+    if (name[0] == '\0') {
+        return -1;
+    }
+    for (int z = 0; z < zone_count; z++) {
+        if (strcmp(zones[z].name, name) == 0) {
+            return z;
+        }
+    }
+    return -2;
+}
+
+/* Prefix length of 1-3 decimal digits, no sign or trailing text; -1 if invalid */
+static long prefix_len_parse(const char *str)
+{
+    size_t digits = strspn(str, "0123456789");
+
+    if (digits == 0 || digits > 3 || str[digits] != '\0') {
+        return -1;
+    }
+    return atol(str);
+}
+
+/* "any", a.b.c.d or a.b.c.d/len; an empty address matches any */
+static bool address_parse(const char *spec, uint32_t *addr, uint32_t *mask)
+{
+    char text[64];
+    struct in_addr in;
+    long len = 32;
+
+    if (spec[0] == '\0' || strcmp(spec, "any") == 0) {
+        *addr = *mask = 0;
+        return true;
+    }
+    strncpy(text, spec, sizeof(text) - 1);
+    text[sizeof(text) - 1] = '\0';
+    char *slash = strchr(text, '/');
+    if (slash) {
+        *slash = '\0';
+        len = prefix_len_parse(slash + 1);
+    }
+    if (inet_pton(AF_INET, text, &in) != 1 || len < 0 || len > 32) {
+        return false;
+    }
+    *mask = len ? ~0u << (32 - len) : 0;
+    *addr = ntohl(in.s_addr) & *mask;
+    return true;
+}
+
+/* Predefined services; port 0 for any port of the protocol */
+static const struct {
+    const char *name;
+    uint8_t protocol;
+    uint16_t port;
+} services[] = {
+    { "http", 6, 80 }, { "https", 6, 443 }, { "ssh", 6, 22 }, { "telnet", 6, 23 },
+    { "ftp", 6, 21 }, { "smtp", 6, 25 }, { "dns", 17, 53 }, { "dns", 6, 53 },
+    { "ntp", 17, 123 }, { "snmp", 17, 161 }, { "icmp", 1, 0 }, { "tcp", 6, 0 },
+    { "udp", 17, 0 },
+};
+
+#define SERVICE_MAX_PROTOCOLS   2
+
+/*
+ * Fill the protocol and port range of each protocol a service stands
+ * for; returns their number, 0 for an unknown service.
+ */
+static int service_parse(const char *name, struct policy_match *alts)
+{
+    int count = 0;
+
+    if (name[0] == '\0' || strcmp(name, "any") == 0) {
+        alts[0].protocol = 0;
+        alts[0].port_lo = 0;
+        alts[0].port_hi = 65535;
+        return 1;
+    }
+    for (size_t i = 0; i < sizeof(services) / sizeof(services[0]); i++) {
+        if (strcmp(services[i].name, name) == 0 && count < SERVICE_MAX_PROTOCOLS) {
+            alts[count].protocol = services[i].protocol;
+            alts[count].port_lo = services[i].port;
+            alts[count].port_hi = services[i].port ? services[i].port : 65535;
+            count++;
+        }
+    }
+    return count;
+}
+
+static void policy_program_free(void *ptr)
+{
+    struct policy_program *prog = ptr;
+
+    if (prog) {
+        free(prog->zone_by_ifid);
+        free(prog->cells);
+        free(prog->rule_stats);
+        free(prog->matches);
+        free(prog);
+    }
+}
+
+/* Rule pre-parsed once, before it is copied into its cells */
+struct policy_parsed {
+    int src_zone;
+    int dst_zone;
+    int alt_count;              /* 0 for a rule that matches nothing */
+    struct policy_match alts[SERVICE_MAX_PROTOCOLS];
+};
+
+static bool zone_in(int rule_zone, int zone)
+{
+    return rule_zone == -1 || rule_zone == zone;
+}
+
+static struct policy_program *policy_compile(void)
+{
+    struct security_policy *policy = firewall_policy();
+    struct policy_program *prog = calloc(1, sizeof(*prog));
+    uint32_t rule_count = policy ? (uint32_t)policy->rule_count : 0;
+    uint32_t n = (uint32_t)zone_count, ifid_max = 0;
+    struct policy_parsed parsed[256];
+
+    if (!prog) {
+        return NULL;
+    }
+    for (uint32_t z = 0; z < n; z++) {
+        for (int m = 0; m < zones[z].member_count; m++) {
+            ifid_max = zones[z].member_interfaces[m] > ifid_max
+                       ? zones[z].member_interfaces[m] : ifid_max;
+        }
+    }
+    prog->zone_count = n;
+    prog->ifid_count = ifid_max + 1;
+    prog->rule_count = rule_count;
+    prog->zone_by_ifid = malloc(prog->ifid_count);
+    prog->cells = calloc((size_t)n * n + 1, sizeof(uint32_t));
+    prog->rule_stats = calloc(rule_count + 1, sizeof(pcpu_counter_t));
+    if (!prog->zone_by_ifid || !prog->cells || !prog->rule_stats) {
+        policy_program_free(prog);
+        return NULL;
+    }
+    memset(prog->zone_by_ifid, FW_ZONE_NONE, prog->ifid_count);
+    for (uint32_t z = 0; z < n; z++) {
+        for (int m = 0; m < zones[z].member_count; m++) {
+            prog->zone_by_ifid[zones[z].member_interfaces[m]] = (uint8_t)z;
+        }
+    }
+
+    /* Parse every rule once; count the matches of each cell */
+    uint32_t *fill = calloc((size_t)n * n + 1, sizeof(uint32_t));
+    if (!fill) {
+        policy_program_free(prog);
+        return NULL;
+    }
+    for (uint32_t r = 0; r < rule_count; r++) {
+        const struct security_rule *rule = &policy->rules[r];
+        struct policy_parsed *p = &parsed[r];
+        struct policy_match base = { .permit = strcmp(rule->action, "permit") == 0,
+                                     .rule = (uint16_t)r };
+
+        prog->rule_stats[r] = rule->stats;
+        p->src_zone = zone_parse(rule->source_zone);
+        p->dst_zone = zone_parse(rule->destination_zone);
+        p->alt_count = rule->service_set ? 1 : service_parse(rule->service, p->alts);
+        if (rule->service_set) {
+            p->alts[0] = (struct policy_match) { .port_hi = 65535 };
+        }
+        base.src_set = rule->source_set;
+        base.dst_set = rule->destination_set;
+        base.service_set = rule->service_set;
+        if (p->src_zone == -2 || p->dst_zone == -2 ||
+            !address_parse(rule->source_address, &base.src, &base.src_mask) ||
+            !address_parse(rule->destination_address, &base.dst, &base.dst_mask)) {
+            p->alt_count = 0;
+        }
+        for (int a = 0; a < p->alt_count; a++) {
+            base.protocol = p->alts[a].protocol;
+            base.port_lo = p->alts[a].port_lo;
+            base.port_hi = p->alts[a].port_hi;
+            p->alts[a] = base;
+        }
+        for (uint32_t s = 0; s < n && p->alt_count; s++) {
+            for (uint32_t d = 0; d < n; d++) {
+                if (zone_in(p->src_zone, s) && zone_in(p->dst_zone, d)) {
+                    prog->cells[s * n + d + 1] += p->alt_count;
+                }
+            }
+        }
+    }
+    for (uint32_t c = 0; c < n * n; c++) {
+        prog->cells[c + 1] += prog->cells[c];
+        fill[c] = prog->cells[c];
+    }
+
+    /* Copy the matches into their cells in rule order */
+    prog->match_count = prog->cells[n * n];
+    prog->matches = malloc((prog->match_count + 1) * sizeof(*prog->matches));
+    if (!prog->matches) {
+        free(fill);
+        policy_program_free(prog);
+        return NULL;
+    }
+    for (uint32_t r = 0; r < rule_count; r++) {
+        const struct policy_parsed *p = &parsed[r];
+        for (uint32_t s = 0; s < n && p->alt_count; s++) {
+            for (uint32_t d = 0; d < n; d++) {
+                if (zone_in(p->src_zone, s) && zone_in(p->dst_zone, d)) {
+                    for (int a = 0; a < p->alt_count; a++) {
+                        prog->matches[fill[s * n + d]++] = p->alts[a];
+                    }
+                }
+            }
+        }
+    }
+    free(fill);
+    return prog;
+}
+
+/*
+ * Compile the policy and publish it with one pointer swap; the old
+ * program is freed once every datapath thread has passed a quiescent
+ * state. Called by the configuration handlers only, which are the only
+ * writers of zones and policies, so the compile never races an edit
+ * and never runs on the packet path. A failed compile keeps the old
+ * program.
+ */
+static int policy_publish(void)
+{
+    pthread_mutex_lock(&policy_lock);
+    struct policy_program *prog = policy_compile();
+    if (prog) {
+        struct policy_program *old = __atomic_exchange_n(&policy_program, prog,
+                                                         __ATOMIC_ACQ_REL);
+        if (old) {
+            qsbr_retire(old, policy_program_free);
+        }
+    }
+    pthread_mutex_unlock(&policy_lock);
+    return prog ? 0 : -ENOMEM;
+}
+
+/* Zones, members or rules changed; the next packet sees the new program */
+static void policy_update(void)
+{
+    if (policy_publish() < 0) {
+        printf("Error: Out of memory compiling the security policy\n");
+    }
+}
+
+/* Program for the next packet, as last published */
+static struct policy_program *policy_current(void)
+{
+    return __atomic_load_n(&policy_program, __ATOMIC_ACQUIRE);
+}
 
 /*
  * Create or enter security zone
@@ -84,6 +432,7 @@ static int cmd_firewall_zone(struct cmd_element *cmd, struct cmd_args *args)
         memset(current_zone, 0, sizeof(struct security_zone));
         strncpy(current_zone->name, zone_name, sizeof(current_zone->name) - 1);
         current_zone->priority = 50;
+        policy_update();
     }
 
     if (!current_zone) {
@@ -144,11 +493,22 @@ static int cmd_zone_add_interface(struct cmd_element *cmd, struct cmd_args *args
     }
 
     const char *interface = args->argv[1];
+    ifid_t ifid = if_intern(interface);
+    if (ifid == IFID_NONE) {
+        printf("Error: Invalid interface name %s\n", interface);
+        return -1;
+    }
+
+    for (int i = 0; i < current_zone->member_count; i++) {
+        if (current_zone->member_interfaces[i] == ifid) {
+            printf("Interface %s is already in zone %s\n", interface, current_zone->name);
+            return 0;
+        }
+    }
 
     if (current_zone->member_count < 32) {
-        strncpy(current_zone->member_interfaces[current_zone->member_count],
-                interface, 63);
-        current_zone->member_count++;
+        current_zone->member_interfaces[current_zone->member_count++] = ifid;
+        policy_update();
         printf("Interface %s added to zone %s\n", interface, current_zone->name);
     } else {
         printf("Error: Maximum interfaces reached for zone\n");
@@ -177,6 +537,7 @@ static int cmd_security_policy(struct cmd_element *cmd, struct cmd_args *args)
         current_policy = &policies[policy_count++];
         memset(current_policy, 0, sizeof(struct security_policy));
         strncpy(current_policy->name, "default", sizeof(current_policy->name) - 1);
+        policy_update();
     }
 
     printf("Entering security policy configuration\n");
@@ -214,11 +575,18 @@ static int cmd_security_rule(struct cmd_element *cmd, struct cmd_args *args)
     }
 
     if (!current_rule && current_policy->rule_count < 256) {
+        pcpu_counter_t stats = pcpu_counter_alloc(2);
+        if (stats == PCPU_COUNTER_NONE) {
+            printf("Error: Out of memory for rule counters\n");
+            return -1;
+        }
         current_rule = &current_policy->rules[current_policy->rule_count++];
         memset(current_rule, 0, sizeof(struct security_rule));
+        current_rule->stats = stats;
         strncpy(current_rule->name, rule_name, sizeof(current_rule->name) - 1);
         current_rule->rule_id = current_policy->rule_count;
         strncpy(current_rule->action, "deny", sizeof(current_rule->action) - 1);
+        policy_update();
     }
 
     if (!current_rule) {
@@ -251,6 +619,7 @@ static int cmd_rule_source_zone(struct cmd_element *cmd, struct cmd_args *args)
 
     strncpy(current_rule->source_zone, args->argv[0],
             sizeof(current_rule->source_zone) - 1);
+    policy_update();
     printf("Source zone set to %s\n", args->argv[0]);
 
     return 0;
@@ -275,61 +644,72 @@ static int cmd_rule_destination_zone(struct cmd_element *cmd, struct cmd_args *a
 
     strncpy(current_rule->destination_zone, args->argv[0],
             sizeof(current_rule->destination_zone) - 1);
+    policy_update();
     printf("Destination zone set to %s\n", args->argv[0]);
 
     return 0;
 }
 
-/*
- * Set source address
- * Command: source-address <address>
- */
-static int cmd_rule_source_address(struct cmd_element *cmd, struct cmd_args *args)
+/* Point a rule address at a literal or, by "address-set <name>", at a set */
+static int rule_set_address(const char *label, const char *command, char *address, size_t size,
+                            uint16_t *set, struct cmd_args *args)
 {
     if (!current_rule) {
         printf("Error: No rule configured\n");
         return -1;
     }
 
-    if (args->argc < 1) {
+    if (args->argc < 1 || (strcmp(args->argv[0], "address-set") == 0 && args->argc < 2)) {
         printf("Error: Address required\n");
-        printf("Usage: source-address <address>\n");
+        printf("Usage: %s {<address>|address-set <set-name>}\n", command);
         return -1;
     }
 
-    strncpy(current_rule->source_address, args->argv[0],
-            sizeof(current_rule->source_address) - 1);
-    printf("Source address set to %s\n", args->argv[0]);
+    if (strcmp(args->argv[0], "address-set") == 0) {
+        uint16_t id = fw_address_set_find(args->argv[1]);
+        if (id == FW_SET_NONE) {
+            printf("Error: Address set %s does not exist\n", args->argv[1]);
+            return -1;
+        }
+        address[0] = '\0';
+        *set = id;
+        printf("%s address set to address-set %s\n", label, args->argv[1]);
+    } else {
+        strncpy(address, args->argv[0], size - 1);
+        *set = FW_SET_NONE;
+        printf("%s address set to %s\n", label, args->argv[0]);
+    }
+    policy_update();
 
     return 0;
 }
 
+/*
+ * Set source address
+ * Command: source-address {<address>|address-set <set-name>}
+ */
+static int cmd_rule_source_address(struct cmd_element *cmd, struct cmd_args *args)
+{
+    return rule_set_address("Source", "source-address",
+                            current_rule ? current_rule->source_address : NULL,
+                            sizeof(current_rule->source_address),
+                            current_rule ? &current_rule->source_set : NULL, args);
+}
+
 /*
  * Set destination address
- * Command: destination-address <address>
+ * Command: destination-address {<address>|address-set <set-name>}
  */
 static int cmd_rule_destination_address(struct cmd_element *cmd, struct cmd_args *args)
 {
-    if (!current_rule) {
-        printf("Error: No rule configured\n");
-        return -1;
-    }
-
-    if (args->argc < 1) {
-        printf("Error: Address required\n");
-        printf("Usage: destination-address <address>\n");
-        return -1;
-    }
-
-    strncpy(current_rule->destination_address, args->argv[0],
-            sizeof(current_rule->destination_address) - 1);
-    printf("Destination address set to %s\n", args->argv[0]);
-
-    return 0;
+    return rule_set_address("Destination", "destination-address",
+                            current_rule ? current_rule->destination_address : NULL,
+                            sizeof(current_rule->destination_address),
+                            current_rule ? &current_rule->destination_set : NULL, args);
 }
 
 /*
- * Set service
+ * Set service, a predefined service or a service set
  * Command: service <service-name>
  */
 static int cmd_rule_service(struct cmd_element *cmd, struct cmd_args *args)
@@ -345,8 +725,18 @@ static int cmd_rule_service(struct cmd_element *cmd, struct cmd_args *args)
         return -1;
     }
 
+    /* A set must exist before a rule names it, as for address sets */
+    struct policy_match alts[SERVICE_MAX_PROTOCOLS];
+    uint16_t id = fw_service_set_find(args->argv[0]);
+    if (id == FW_SET_NONE && service_parse(args->argv[0], alts) == 0) {
+        printf("Error: Service %s does not exist\n", args->argv[0]);
+        return -1;
+    }
+
     strncpy(current_rule->service, args->argv[0],
             sizeof(current_rule->service) - 1);
+    current_rule->service_set = id;
+    policy_update();
     printf("Service set to %s\n", args->argv[0]);
 
     return 0;
@@ -376,6 +766,7 @@ static int cmd_rule_action(struct cmd_element *cmd, struct cmd_args *args)
     }
 
     strncpy(current_rule->action, action, sizeof(current_rule->action) - 1);
+    policy_update();
     printf("Action set to %s\n", action);
 
     return 0;
@@ -395,7 +786,7 @@ static int cmd_display_firewall_zone(struct cmd_element *cmd, struct cmd_args *a
         printf("    Priority: %u\n", zones[i].priority);
         printf("    Members: %d interfaces\n", zones[i].member_count);
         for (int j = 0; j < zones[i].member_count; j++) {
-            printf("      - %s\n", zones[i].member_interfaces[j]);
+            printf("      - %s\n", if_name(zones[i].member_interfaces[j]));
         }
         printf("\n");
     }
@@ -418,18 +809,712 @@ static int cmd_display_security_policy(struct cmd_element *cmd, struct cmd_args
 
         for (int j = 0; j < policies[i].rule_count; j++) {
             struct security_rule *rule = &policies[i].rules[j];
+            struct pcpu_snapshot hits;
+            pcpu_counter_read(rule->stats, 2, &hits);
             printf("      Rule %u: %s\n", rule->rule_id, rule->name);
             printf("        Source zone: %s\n", rule->source_zone);
             printf("        Destination zone: %s\n", rule->destination_zone);
             printf("        Action: %s\n", rule->action);
-            if (rule->packet_count > 0) {
+            if (hits.values[0] > 0) {
                 printf("        Packets: %lu, Bytes: %lu\n",
-                       rule->packet_count, rule->byte_count);
+                       hits.values[0], hits.values[1]);
             }
         }
         printf("\n");
     }
 
+    const struct policy_program *prog = policy_current();
+    if (prog) {
+        uint32_t pairs = 0, largest = 0;
+        for (uint32_t c = 0; c < prog->zone_count * prog->zone_count; c++) {
+            uint32_t size = prog->cells[c + 1] - prog->cells[c];
+            pairs += size > 0;
+            largest = size > largest ? size : largest;
+        }
+        printf("  Compiled: %u matches in %u of %u zone pairs, at most %u per pair\n",
+               prog->match_count, pairs, prog->zone_count * prog->zone_count, largest);
+    }
+
+    return 0;
+}
+
+/* ---- Packet path ---- */
+
+static void sessions_start(void)
+{
+    packet_stats = pcpu_counter_alloc(FW_PKT_COUNT);
+    sessions = fw_session_table_create(FW_SESSION_CAPACITY);
+    if (!sessions) {
+        /* Stateless: every packet is matched against the policy */
+        printf("Warning: No memory for the firewall session table\n");
+        return;
+    }
+    struct fw_session_stats stats;
+    fw_session_stats(sessions, &stats);
+    session_last = stats.counters;
+    if (fw_session_aging_start(sessions) < 0) {
+        printf("Warning: Firewall session aging thread not started\n");
+    }
+}
+
+/* First match for a packet in the cell of its zone pair, NULL if none */
+static const struct policy_match *policy_match(const struct policy_program *prog,
+                                               const struct firewall_packet *pkt,
+                                               uint8_t src_zone, uint8_t dst_zone)
+{
+    uint32_t cell = src_zone * prog->zone_count + dst_zone;
+    const struct policy_match *m = &prog->matches[prog->cells[cell]];
+    const struct policy_match *end = &prog->matches[prog->cells[cell + 1]];
+
+    for (; m < end; m++) {
+        if (((pkt->src_ip ^ m->src) & m->src_mask) == 0 &&
+            ((pkt->dst_ip ^ m->dst) & m->dst_mask) == 0 &&
+            (m->protocol == 0 || m->protocol == pkt->protocol) &&
+            pkt->dst_port >= m->port_lo && pkt->dst_port <= m->port_hi &&
+            (m->src_set == FW_SET_NONE || fw_address_set_match_v4(m->src_set, pkt->src_ip)) &&
+            (m->dst_set == FW_SET_NONE || fw_address_set_match_v4(m->dst_set, pkt->dst_ip)) &&
+            (m->service_set == FW_SET_NONE ||
+             fw_service_set_match(m->service_set, pkt->protocol, pkt->dst_port))) {
+            return m;
+        }
+    }
+    return NULL;
+}
+
+static inline uint8_t zone_of(const struct policy_program *prog, ifid_t ifid)
+{
+    return ifid < prog->ifid_count ? prog->zone_by_ifid[ifid] : FW_ZONE_NONE;
+}
+
+static int packet_deny(int counter)
+{
+    pcpu_counter_inc(packet_stats + counter);
+    return FIREWALL_DENY;
+}
+
+/*
+ * Verdict for a packet at now (fw_session_now() seconds). Session hits
+ * count against the rule that permitted the flow. The caller is a qsbr
+ * reader: the compiled policy and sessions are replaced concurrently.
+ */
+int firewall_process(const struct firewall_packet *pkt, uint32_t now)
+{
+    pthread_once(&sessions_once, sessions_start);
+
+    const struct policy_program *prog = policy_current();
+    if (!prog) {
+        return packet_deny(FW_PKT_DENY);
+    }
+    uint8_t src_zone = zone_of(prog, pkt->in_ifid);
+    uint8_t dst_zone = zone_of(prog, pkt->out_ifid);
+    if (src_zone == FW_ZONE_NONE || dst_zone == FW_ZONE_NONE) {
+        return packet_deny(FW_PKT_DENY);
+    }
+
+    struct fw_session_key key = {
+        .src_ip = pkt->src_ip, .dst_ip = pkt->dst_ip,
+        .src_port = pkt->src_port, .dst_port = pkt->dst_port,
+        .protocol = pkt->protocol, .src_zone = src_zone, .dst_zone = dst_zone,
+    };
+    bool reply = false;
+    if (sessions) {
+        struct fw_session *session = fw_session_lookup(sessions, &key, &reply);
+        if (session) {
+            fw_session_update(sessions, session, reply, pkt->tcp_flags, pkt->length, now);
+            if (session->rule < prog->rule_count) {
+                pcpu_counter_add2(prog->rule_stats[session->rule], 1, pkt->length);
+            }
+            pcpu_counter_inc(packet_stats + FW_PKT_SESSION);
+            return FIREWALL_PERMIT;
+        }
+        if (pkt->protocol == 6 &&
+            (pkt->tcp_flags & (FW_TCP_SYN | FW_TCP_ACK | FW_TCP_RST)) != FW_TCP_SYN) {
+            return packet_deny(FW_PKT_INVALID);
+        }
+    }
+
+    const struct policy_match *match = policy_match(prog, pkt, src_zone, dst_zone);
+    if (!match) {
+        return packet_deny(FW_PKT_DENY);
+    }
+    pcpu_counter_add2(prog->rule_stats[match->rule], 1, pkt->length);
+    if (!match->permit) {
+        return packet_deny(FW_PKT_DENY);
+    }
+
+    if (sessions) {
+        struct fw_session *session = fw_session_create(sessions, &key, match->rule, now, &reply);
+        if (session) {
+            fw_session_update(sessions, session, reply, pkt->tcp_flags, pkt->length, now);
+        }
+    }
+    pcpu_counter_inc(packet_stats + FW_PKT_POLICY);
+    return FIREWALL_PERMIT;
+}
+
+/* ---- Session commands ---- */
+
+static const char *protocol_name(uint8_t protocol, char *buf, size_t size)
+{
+    switch (protocol) {
+    case 1:
+        return "icmp";
+    case 6:
+        return "tcp";
+    case 17:
+        return "udp";
+    default:
+        snprintf(buf, size, "%u", protocol);
+        return buf;
+    }
+}
+
+static void format_endpoint(uint32_t ip, uint16_t port, char *buf, size_t size)
+{
+    snprintf(buf, size, "%u.%u.%u.%u:%u", ip >> 24, (ip >> 16) & 0xff, (ip >> 8) & 0xff,
+             ip & 0xff, port);
+}
+
+static const char *zone_name(uint8_t zone)
+{
+    return zone < zone_count ? zones[zone].name : "-";
+}
+
+static int display_session_table(void)
+{
+    struct security_policy *policy = firewall_policy();
+    struct fw_session_stats stats;
+    uint32_t now = fw_session_now(), shown = 0;
+
+    fw_session_stats(sessions, &stats);
+    printf("Current total sessions: %lu\n", (unsigned long)stats.active);
+
+    uint32_t slots = fw_session_slots(sessions);
+    for (uint32_t i = 0; i < slots && shown < FW_DISPLAY_SESSIONS; i++) {
+        const struct fw_session *session = fw_session_get(sessions, i);
+        if (!session) {
+            continue;
+        }
+        char proto[8], src[24], dst[24];
+        int32_t ttl = (int32_t)(session->deadline - now);
+        const char *rule = policy && session->rule < policy->rule_count
+                           ? policy->rules[session->rule].name : "-";
+
+        format_endpoint(session->key.src_ip, session->key.src_port, src, sizeof(src));
+        format_endpoint(session->key.dst_ip, session->key.dst_port, dst, sizeof(dst));
+        printf("  %s  %s --> %s\n",
+               protocol_name(session->key.protocol, proto, sizeof(proto)), src, dst);
+        printf("    Zone: %s --> %s  State: %s  TTL: %ds  Rule: %s\n",
+               zone_name(session->key.src_zone), zone_name(session->key.dst_zone),
+               fw_session_state_name(session->state), ttl > 0 ? ttl : 0, rule);
+        printf("    Packets: %u/%u  Bytes: %lu/%lu\n", session->packets[0], session->packets[1],
+               (unsigned long)session->bytes[0], (unsigned long)session->bytes[1]);
+        shown++;
+    }
+    if (shown < stats.active) {
+        printf("  ... %lu more\n", (unsigned long)(stats.active - shown));
+    }
+    return 0;
+}
+
+static int display_session_statistics(void)
+{
+    struct fw_session_stats stats;
+    struct pcpu_snapshot delta, packets;
+
+    fw_session_stats(sessions, &stats);
+    pcpu_snapshot_delta(&stats.counters, &session_last, FW_STAT_COUNT, &delta);
+    session_last = stats.counters;
+    pcpu_counter_read(packet_stats, FW_PKT_COUNT, &packets);
+
+    const uint64_t *c = stats.counters.values;
+    printf("Firewall session statistics:\n");
+    printf("  Capacity: %u sessions, %u buckets, %lu bytes\n", stats.capacity, stats.buckets,
+           (unsigned long)stats.memory);
+    printf("  Active sessions: %lu\n", (unsigned long)stats.active);
+    printf("  Created: %lu (%.1f/s since last display)\n", (unsigned long)c[FW_STAT_CREATED],
+           pcpu_snapshot_rate(&delta, FW_STAT_CREATED));
+    printf("  Creation failures: %lu\n", (unsigned long)c[FW_STAT_FAILED]);
+    printf("  Aged out or reset: %lu\n", (unsigned long)c[FW_STAT_REMOVED]);
+    printf("  Lookups: %lu, hits: %lu (%.1f%%)\n", (unsigned long)c[FW_STAT_LOOKUPS],
+           (unsigned long)c[FW_STAT_HITS],
+           c[FW_STAT_LOOKUPS] ? 100.0 * c[FW_STAT_HITS] / c[FW_STAT_LOOKUPS] : 0.0);
+    printf("  Mean lookup latency: %.0f ns (%lu samples)\n",
+           c[FW_STAT_SAMPLES] ? (double)c[FW_STAT_LATENCY_NS] / c[FW_STAT_SAMPLES] : 0.0,
+           (unsigned long)c[FW_STAT_SAMPLES]);
+    printf("  Packets: session %lu, policy %lu, denied %lu, invalid %lu\n",
+           (unsigned long)packets.values[FW_PKT_SESSION],
+           (unsigned long)packets.values[FW_PKT_POLICY],
+           (unsigned long)packets.values[FW_PKT_DENY],
+           (unsigned long)packets.values[FW_PKT_INVALID]);
+    printf("  Aging time (s): tcp-handshake %u, tcp %u, tcp-close %u, udp %u, icmp %u, "
+           "other %u\n", fw_session_timeout(sessions, FW_STATE_SYN_SENT),
+           fw_session_timeout(sessions, FW_STATE_ESTABLISHED),
+           fw_session_timeout(sessions, FW_STATE_FIN_WAIT),
+           fw_session_timeout(sessions, FW_STATE_UDP),
+           fw_session_timeout(sessions, FW_STATE_ICMP),
+           fw_session_timeout(sessions, FW_STATE_OTHER));
+    return 0;
+}
+
+/*
+ * Display firewall sessions
+ * Command: display firewall session {table|statistics}
+ */
+static int cmd_display_firewall_session(struct cmd_element *cmd, struct cmd_args *args)
+{
+    /* argv[0..1] are the "firewall session" keywords */
+    if (args->argc < 3 || (strcmp(args->argv[2], "table") != 0 &&
+                           strcmp(args->argv[2], "statistics") != 0)) {
+        printf("Error: Session view required\n");
+        printf("Usage: display firewall session {table|statistics}\n");
+        return -1;
+    }
+
+    pthread_once(&sessions_once, sessions_start);
+    if (!sessions) {
+        printf("Error: Session table not available\n");
+        return -1;
+    }
+    return strcmp(args->argv[2], "table") == 0 ? display_session_table()
+                                                 : display_session_statistics();
+}
+
+/* States set by each aging-time protocol */
+static const struct {
+    const char *name;
+    uint8_t states[4];
+} aging_protocols[] = {
+    { "tcp", { FW_STATE_ESTABLISHED } },
+    { "tcp-handshake", { FW_STATE_SYN_SENT, FW_STATE_SYN_RECV } },
+    { "tcp-close", { FW_STATE_FIN_WAIT, FW_STATE_LAST_ACK, FW_STATE_TIME_WAIT,
+                     FW_STATE_CLOSE } },
+    { "udp", { FW_STATE_UDP } },
+    { "icmp", { FW_STATE_ICMP } },
+    { "other", { FW_STATE_OTHER } },
+};
+
+/*
+ * Set session aging time; sessions pick it up with their next packet
+ * Command: firewall session aging-time {tcp|tcp-handshake|tcp-close|udp|icmp|other} <seconds>
+ */
+static int cmd_firewall_session_aging(struct cmd_element *cmd, struct cmd_args *args)
+{
+    if (args->argc < 4) {
+        printf("Error: Protocol and aging time required\n");
+        printf("Usage: firewall session aging-time "
+               "{tcp|tcp-handshake|tcp-close|udp|icmp|other} <seconds>\n");
+        return -1;
+    }
+
+    long seconds = atol(args->argv[3]);
+    if (seconds < 1 || seconds > 86400) {
+        printf("Error: Aging time must be 1-86400 seconds\n");
+        return -1;
+    }
+
+    pthread_once(&sessions_once, sessions_start);
+    if (!sessions) {
+        printf("Error: Session table not available\n");
+        return -1;
+    }
+    for (size_t i = 0; i < sizeof(aging_protocols) / sizeof(aging_protocols[0]); i++) {
+        if (strcmp(aging_protocols[i].name, args->argv[2]) != 0) {
+            continue;
+        }
+        for (int s = 0; s < 4 && aging_protocols[i].states[s]; s++) {
+            fw_session_set_timeout(sessions, aging_protocols[i].states[s], (uint32_t)seconds);
+        }
+        printf("Session aging time of %s set to %ld seconds\n", args->argv[2], seconds);
+        return 0;
+    }
+
+    printf("Error: Unknown protocol %s\n", args->argv[2]);
+    return -1;
+}
+
+/*
+ * Remove all sessions; their flows are matched against the policy again
+ * Command: reset firewall session table
+ */
+static int cmd_reset_firewall_session(struct cmd_element *cmd, struct cmd_args *args)
+{
+    if (args->argc < 3 || strcmp(args->argv[2], "table") != 0) {
+        printf("Error: Session table keyword required\n");
+        printf("Usage: reset firewall session table\n");
+        return -1;
+    }
+
+    pthread_once(&sessions_once, sessions_start);
+    if (!sessions) {
+        printf("Error: Session table not available\n");
+        return -1;
+    }
+    printf("Info: %u sessions removed\n", fw_session_clear(sessions));
+
+    return 0;
+}
+
+/* ---- Address and service sets ---- */
+
+static bool predefined_service(const char *name)
+{
+    for (size_t i = 0; i < sizeof(services) / sizeof(services[0]); i++) {
+        if (strcmp(services[i].name, name) == 0) {
+            return true;
+        }
+    }
+    return strcmp(name, "any") == 0;
+}
+
+/*
+ * Create or enter address set
+ * Command: ip address-set <set-name> [type object]
+ */
+static int cmd_ip_address_set(struct cmd_element *cmd, struct cmd_args *args)
+{
+    /* argv[0] is the "address-set" keyword */
+    if (args->argc < 2) {
+        printf("Error: Address set name required\n");
+        printf("Usage: ip address-set <set-name> [type object]\n");
+        return -1;
+    }
+
+    uint16_t id = fw_address_set_create(args->argv[1]);
+    if (id == FW_SET_NONE) {
+        printf("Error: Maximum address sets reached\n");
+        return -1;
+    }
+    current_address_set = id;
+
+    printf("Entering address set %s configuration\n", args->argv[1]);
+    printf("[Huawei-object-address-set-%s]\n", args->argv[1]);
+
+    return 0;
+}
+
+/* Parse "[<id>] <address>[/<len>] [mask {<len>|<mask>}]" from argv[first] */
+static int set_prefix_parse(struct cmd_args *args, int first, bool *v6, uint32_t addr[4],
+                            uint8_t *plen)
+{
+    char text[64];
+    uint8_t bytes[16];
+    int i = first;
+
+    if (i + 1 < args->argc && strspn(args->argv[i], "0123456789") == strlen(args->argv[i])) {
+        i++;    /* Member ID, kept for VRP syntax */
+    }
+    if (i >= args->argc) {
+        return -1;
+    }
+    strncpy(text, args->argv[i], sizeof(text) - 1);
+    text[sizeof(text) - 1] = '\0';
+    char *slash = strchr(text, '/');
+    if (slash) {
+        *slash = '\0';
+    }
+
+    *v6 = strchr(text, ':') != NULL;
+    if (inet_pton(*v6 ? AF_INET6 : AF_INET, text, bytes) != 1) {
+        return -1;
+    }
+    memset(addr, 0, 4 * sizeof(uint32_t));
+    for (int w = 0; w < (*v6 ? 4 : 1); w++) {
+        addr[w] = (uint32_t)bytes[w * 4] << 24 | bytes[w * 4 + 1] << 16 |
+                  bytes[w * 4 + 2] << 8 | bytes[w * 4 + 3];
+    }
+
+    long len = *v6 ? 128 : 32;
+    if (slash) {
+        len = prefix_len_parse(slash + 1);
+    } else if (i + 2 < args->argc && strcmp(args->argv[i + 1], "mask") == 0) {
+        struct in_addr mask;
+        if (strchr(args->argv[i + 2], '.') && !*v6 &&
+            inet_pton(AF_INET, args->argv[i + 2], &mask) == 1) {
+            uint32_t m = ntohl(mask.s_addr);
+            len = __builtin_popcount(m);
+            if (m != (len ? ~0u << (32 - len) : 0)) {
+                return -1;
+            }
+        } else {
+            len = prefix_len_parse(args->argv[i + 2]);
+        }
+    }
+    if (len < 0 || len > (*v6 ? 128 : 32)) {
+        return -1;
+    }
+    *plen = (uint8_t)len;
+    return 0;
+}
+
+/* Add or remove a prefix of the current address set */
+static int address_set_edit(struct cmd_args *args, int first, bool add)
+{
+    bool v6;
+    uint32_t addr[4];
+    uint8_t plen;
+
+    if (current_address_set == FW_SET_NONE) {
+        printf("Error: No address set configured\n");
+        return -1;
+    }
+    if (set_prefix_parse(args, first, &v6, addr, &plen) < 0) {
+        printf("Error: Invalid address\n");
+        printf("Usage: %saddress [<id>] {<address>[/<len>]|<address> mask <mask>}\n",
+               add ? "" : "undo ");
+        return -1;
+    }
+
+    int ret = add ? fw_address_set_add(current_address_set, v6, addr, plen)
+                  : fw_address_set_remove(current_address_set, v6, addr, plen);
+    if (ret == -EEXIST || ret == -ENOENT) {
+        printf("Info: Address %s in the set\n", add ? "is already" : "is not");
+        return 0;
+    } else if (ret < 0) {
+        printf("Error: Out of memory for address set\n");
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Add address to set; rules using the set see it at once
+ * Command: address [<id>] {<address>[/<len>]|<address> mask <mask>}
+ */
+static int cmd_address_set_address(struct cmd_element *cmd, struct cmd_args *args)
+{
+    return address_set_edit(args, 0, true);
+}
+
+/*
+ * Remove address from set
+ * Command: undo address [<id>] {<address>[/<len>]|<address> mask <mask>}
+ */
+static int cmd_address_set_undo_address(struct cmd_element *cmd, struct cmd_args *args)
+{
+    /* argv[0] is the "address" keyword */
+    return address_set_edit(args, 1, false);
+}
+
+/*
+ * Create or enter service set
+ * Command: ip service-set <set-name> [type object]
+ */
+static int cmd_ip_service_set(struct cmd_element *cmd, struct cmd_args *args)
+{
+    /* argv[0] is the "service-set" keyword */
+    if (args->argc < 2) {
+        printf("Error: Service set name required\n");
+        printf("Usage: ip service-set <set-name> [type object]\n");
+        return -1;
+    }
+    if (predefined_service(args->argv[1])) {
+        printf("Error: %s is a predefined service\n", args->argv[1]);
+        return -1;
+    }
+
+    uint16_t id = fw_service_set_create(args->argv[1]);
+    if (id == FW_SET_NONE) {
+        printf("Error: Maximum service sets reached\n");
+        return -1;
+    }
+    current_service_set = id;
+
+    printf("Entering service set %s configuration\n", args->argv[1]);
+    printf("[Huawei-object-service-set-%s]\n", args->argv[1]);
+
+    return 0;
+}
+
+/* Parse "[<id>] protocol <protocol> [destination-port <lo> [to <hi>]]" from argv[first] */
+static int set_service_parse(struct cmd_args *args, int first, struct fw_service_member *member)
+{
+    int i = first;
+
+    if (i < args->argc && strcmp(args->argv[i], "protocol") != 0) {
+        i++;    /* Member ID */
+    }
+    if (i + 1 >= args->argc || strcmp(args->argv[i], "protocol") != 0) {
+        return -1;
+    }
+
+    const char *protocol = args->argv[i + 1];
+    long number = atol(protocol);
+    if (strcmp(protocol, "tcp") == 0) {
+        number = 6;
+    } else if (strcmp(protocol, "udp") == 0) {
+        number = 17;
+    } else if (strcmp(protocol, "icmp") == 0) {
+        number = 1;
+    } else if (strspn(protocol, "0123456789") != strlen(protocol) || number > 255) {
+        return -1;
+    }
+    *member = (struct fw_service_member) { .protocol = (uint8_t)number, .port_hi = 65535 };
+
+    i += 2;
+    if (i < args->argc) {
+        if (strcmp(args->argv[i], "destination-port") != 0 || i + 1 >= args->argc) {
+            return -1;
+        }
+        long lo = atol(args->argv[i + 1]), hi = lo;
+        if (i + 2 < args->argc) {
+            if (strcmp(args->argv[i + 2], "to") != 0 || i + 3 >= args->argc) {
+                return -1;
+            }
+            hi = atol(args->argv[i + 3]);
+        }
+        if (lo < 0 || hi > 65535 || lo > hi) {
+            return -1;
+        }
+        member->port_lo = (uint16_t)lo;
+        member->port_hi = (uint16_t)hi;
+    }
+    return 0;
+}
+
+/* Add or remove a member of the current service set */
+static int service_set_edit(struct cmd_args *args, int first, bool add)
+{
+    struct fw_service_member member;
+
+    if (current_service_set == FW_SET_NONE) {
+        printf("Error: No service set configured\n");
+        return -1;
+    }
+    if (set_service_parse(args, first, &member) < 0) {
+        printf("Error: Invalid service\n");
+        printf("Usage: %sservice [<id>] protocol {tcp|udp|icmp|<0-255>} "
+               "[destination-port <port> [to <port>]]\n", add ? "" : "undo ");
+        return -1;
+    }
+
+    int ret = add ? fw_service_set_add(current_service_set, &member)
+                  : fw_service_set_remove(current_service_set, &member);
+    if (ret == -EEXIST || ret == -ENOENT) {
+        printf("Info: Service %s in the set\n", add ? "is already" : "is not");
+        return 0;
+    } else if (ret < 0) {
+        printf("Error: Out of memory for service set\n");
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Add service to set; rules using the set see it at once
+ * Command: service [<id>] protocol {tcp|udp|icmp|<0-255>} [destination-port <port> [to <port>]]
+ */
+static int cmd_service_set_service(struct cmd_element *cmd, struct cmd_args *args)
+{
+    return service_set_edit(args, 0, true);
+}
+
+/*
+ * Remove service from set
+ * Command: undo service [<id>] protocol <protocol> [destination-port <port> [to <port>]]
+ */
+static int cmd_service_set_undo_service(struct cmd_element *cmd, struct cmd_args *args)
+{
+    /* argv[0] is the "service" keyword */
+    return service_set_edit(args, 1, false);
+}
+
+static void print_prefix(const uint32_t addr[4], uint8_t plen, void *arg)
+{
+    uint32_t *shown = arg;
+    char text[INET6_ADDRSTRLEN];
+    uint8_t bytes[16];
+    bool v6 = shown[1];
+
+    if (shown[0]++ >= FW_DISPLAY_MEMBERS) {
+        return;
+    }
+    for (int w = 0; w < 4; w++) {
+        bytes[w * 4] = (uint8_t)(addr[w] >> 24);
+        bytes[w * 4 + 1] = (uint8_t)(addr[w] >> 16);
+        bytes[w * 4 + 2] = (uint8_t)(addr[w] >> 8);
+        bytes[w * 4 + 3] = (uint8_t)addr[w];
+    }
+    inet_ntop(v6 ? AF_INET6 : AF_INET, bytes, text, sizeof(text));
+    printf("    %s/%u\n", text, plen);
+}
+
+/*
+ * Display address sets
+ * Command: display ip address-set [<set-name>]
+ */
+static int cmd_display_ip_address_set(struct cmd_element *cmd, struct cmd_args *args)
+{
+    /* argv[0..1] are the "ip address-set" keywords */
+    const char *only = args->argc > 2 ? args->argv[2] : NULL;
+    struct fw_address_set_info info;
+
+    if (only && fw_address_set_find(only) == FW_SET_NONE) {
+        printf("Error: Address set %s does not exist\n", only);
+        return -1;
+    }
+    for (uint16_t id = 1; fw_address_set_info(id, &info) == 0; id++) {
+        if (only && strcmp(only, info.name) != 0) {
+            continue;
+        }
+        printf("Address set %s (ID %u): %u IPv4, %u IPv6 prefixes, %u trie nodes, %zu bytes\n",
+               info.name, id, info.prefixes[0], info.prefixes[1], info.nodes[0] + info.nodes[1],
+               info.memory);
+        if (only) {
+            uint32_t shown[2] = { 0, 0 };
+            uint32_t total = fw_address_set_walk(id, false, print_prefix, shown);
+            shown[1] = 1;
+            total += fw_address_set_walk(id, true, print_prefix, shown);
+            if (total > FW_DISPLAY_MEMBERS) {
+                printf("    ... %u more\n", total - FW_DISPLAY_MEMBERS);
+            }
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Display service sets
+ * Command: display ip service-set [<set-name>]
+ */
+static int cmd_display_ip_service_set(struct cmd_element *cmd, struct cmd_args *args)
+{
+    /* argv[0..1] are the "ip service-set" keywords */
+    const char *only = args->argc > 2 ? args->argv[2] : NULL;
+    struct fw_service_set_info info;
+    struct fw_service_member members[FW_DISPLAY_MEMBERS];
+
+    if (only && fw_service_set_find(only) == FW_SET_NONE) {
+        printf("Error: Service set %s does not exist\n", only);
+        return -1;
+    }
+    for (uint16_t id = 1; fw_service_set_info(id, &info) == 0; id++) {
+        if (only && strcmp(only, info.name) != 0) {
+            continue;
+        }
+        printf("Service set %s (ID %u): %u members, %u intervals, %zu bytes\n", info.name, id,
+               info.members, info.intervals, info.memory);
+        if (!only) {
+            continue;
+        }
+        uint32_t count = fw_service_set_members(id, members, FW_DISPLAY_MEMBERS);
+        for (uint32_t i = 0; i < count; i++) {
+            char proto[8];
+            printf("    protocol %s", members[i].protocol == FW_PROTOCOL_ANY ? "any"
+                   : protocol_name(members[i].protocol, proto, sizeof(proto)));
+            if (members[i].port_lo == members[i].port_hi) {
+                printf(" destination-port %u", members[i].port_lo);
+            } else if (members[i].port_lo != 0 || members[i].port_hi != 65535) {
+                printf(" destination-port %u to %u", members[i].port_lo, members[i].port_hi);
+            }
+            printf("\n");
+        }
+        if (info.members > count) {
+            printf("    ... %u more\n", info.members - count);
+        }
+    }
+
     return 0;
 }
 
@@ -461,10 +1546,47 @@ struct cmd_element firewall_cmds[] = {
                              "Display firewall zones", CMD_CAT_SECURITY),
     HUAWEI_CMD_WITH_CATEGORY("display security-policy", cmd_display_security_policy, "show policy-map",
                              "Display security policies", CMD_CAT_SECURITY),
+    HUAWEI_CMD_WITH_CATEGORY("display firewall session", cmd_display_firewall_session,
+                             "show conn", "Display firewall sessions", CMD_CAT_SECURITY),
+    HUAWEI_CMD_WITH_CATEGORY("firewall session aging-time", cmd_firewall_session_aging,
+                             "timeout conn", "Set session aging time", CMD_CAT_SECURITY),
+    HUAWEI_CMD_WITH_CATEGORY("reset firewall session", cmd_reset_firewall_session,
+                             "clear conn", "Remove all firewall sessions", CMD_CAT_SECURITY),
+    HUAWEI_CMD_WITH_CATEGORY("ip address-set", cmd_ip_address_set, "object-group network",
+                             "Create or enter address set", CMD_CAT_SECURITY),
+    HUAWEI_CMD_WITH_CATEGORY("ip service-set", cmd_ip_service_set, "object-group service",
+                             "Create or enter service set", CMD_CAT_SECURITY),
+    HUAWEI_CMD_WITH_CATEGORY("display ip address-set", cmd_display_ip_address_set,
+                             "show object-group network", "Display address sets",
+                             CMD_CAT_SECURITY),
+    HUAWEI_CMD_WITH_CATEGORY("display ip service-set", cmd_display_ip_service_set,
+                             "show object-group service", "Display service sets",
+                             CMD_CAT_SECURITY),
+    { .name = NULL }
+};
+
+/* Members of an address set, in its view */
+struct cmd_element address_set_cmds[] = {
+    HUAWEI_CMD_WITH_CATEGORY("address", cmd_address_set_address, "network-object",
+                             "Add address to set", CMD_CAT_SECURITY),
+    HUAWEI_CMD_WITH_CATEGORY("undo address", cmd_address_set_undo_address,
+                             "no network-object", "Remove address from set", CMD_CAT_SECURITY),
+    { .name = NULL }
+};
+
+/* Members of a service set, in its view */
+struct cmd_element service_set_cmds[] = {
+    HUAWEI_CMD_WITH_CATEGORY("service", cmd_service_set_service, "service-object",
+                             "Add service to set", CMD_CAT_SECURITY),
+    HUAWEI_CMD_WITH_CATEGORY("undo service", cmd_service_set_undo_service,
+                             "no service-object", "Remove service from set", CMD_CAT_SECURITY),
     { .name = NULL }
 };
 
 void register_firewall_cmds(void)
 {
     printf("Registering firewall commands...\n");
+    huawei_cli_register_table(firewall_cmds, NULL);
+    huawei_cli_register_table(address_set_cmds, "address-set");
+    huawei_cli_register_table(service_set_cmds, "service-set");
 }
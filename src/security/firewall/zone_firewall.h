@@ -0,0 +1,46 @@
+/*
+ * Zone-Based Firewall for Huawei VRP Style
+ * Copyright (C) 2026 WhiteBox NE Team
+ *
+ * Packet entry point of the zone firewall. The first packet of a flow
+ * is matched against the security policy of its zone pair, in rule
+ * order; a permitted flow gets a session (fw_session.h) and its later
+ * packets, both directions, are permitted by the session alone. A TCP
+ * flow is only opened by a SYN: other segments without a session are
+ * dropped as invalid. Denied packets create no session.
+ *
+ * Traffic on an interface that belongs to no zone is denied. Zones are
+ * found by interface ID in one table lookup; a kernel ifindex gives its
+ * ID through if_by_kernel_index().
+ */
+
+#ifndef _ZONE_FIREWALL_H
+#define _ZONE_FIREWALL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "../../frr_core/lib/if_registry.h"
+
+/* Verdicts of firewall_process() */
+enum {
+    FIREWALL_DENY = 0,
+    FIREWALL_PERMIT = 1,
+};
+
+/* Header fields of a packet, addresses and ports in host order */
+struct firewall_packet {
+    ifid_t in_ifid;
+    ifid_t out_ifid;
+    uint32_t src_ip;
+    uint32_t dst_ip;
+    uint16_t src_port;          /* ICMP: the echo identifier, as dst_port */
+    uint16_t dst_port;
+    uint8_t protocol;
+    uint8_t tcp_flags;          /* FW_TCP_* */
+    uint32_t length;
+};
+
+int firewall_process(const struct firewall_packet *pkt, uint32_t now);
+void register_firewall_cmds(void);
+
+#endif /* _ZONE_FIREWALL_H */
@@ -171,4 +171,5 @@ struct cmd_element gre_cmds[] = {
 
 void register_gre_cmds(void) {
     printf("Registering GRE tunnel commands...\n");
+    huawei_cli_register_table(gre_cmds, NULL);
 }